@@ -42,7 +42,7 @@ VS_Output VS_Main(VS_Input input)
 
 float4 PS_Main(VS_Output input) : SV_TARGET
 {
-    float alpha = atlasTexture.Sample(atlasSampler, input.texCoord).a;
+    float alpha = atlasTexture.Sample(atlasSampler, input.texCoord).r;
     alpha = clamp(alpha, 0.0f, 1.0f);
     float4 color = alpha * float4(textForeColor, 1.0) + (1.0 - alpha) * float4(textBackColor, input.backAlpha);
     return color;
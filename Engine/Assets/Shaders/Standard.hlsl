@@ -28,14 +28,16 @@ cbuffer constants : register(b0)
     float3 cameraEyePoint;
     
     // These are additional variables needed for the shadow calculations.
-    float3 lightCameraEyePoint;
+    // The light cameras of all the shadow cascades look the same way.
     float3 lightCameraXAxis;
-    float3 lightCameraYAxis;
-    float lightCameraWidth;
-    float lightCameraHeight;
-    float lightCameraNear;
-    float lightCameraFar;
     float shadowScale;
+    float3 lightCameraYAxis;
+    float numShadowCascades;
+    
+    // Each cascade has its own light camera, rendered into its own quarter of the
+    // shadow texture.  The extents are the width, height, near and far distances.
+    float4 lightCameraEyePoint[4];
+    float4 lightCameraExtents[4];
 };
 
 struct VS_Input
@@ -72,22 +74,30 @@ float4 PS_Main(VS_Output input) : SV_TARGET
     float shadowFactor = 1.0;
     if(dot(lightDirection, input.normal) < -0.1)
     {
-        float lambda = dot(lightCameraEyePoint - input.worldPosition, lightDirection);
-        float3 lightCameraPoint = input.worldPosition + lambda * lightDirection;
-        float lightCameraPointX = dot(lightCameraPoint - lightCameraEyePoint, lightCameraXAxis);
-        float lightCameraPointY = dot(lightCameraPoint - lightCameraEyePoint, lightCameraYAxis);
-        float2 lightCameraUVs;
-        lightCameraUVs.x = lightCameraPointX / lightCameraWidth + 0.5;
-        lightCameraUVs.y = -lightCameraPointY / lightCameraHeight + 0.5;
-        if (0.0 <= lightCameraUVs.x && lightCameraUVs.x <= 1.0 &&
-            0.0 <= lightCameraUVs.y && lightCameraUVs.y <= 1.0)
+        // The cascades go from nearest to furthest, so the first one to see this point has the most detail.
+        for(int i = 0; i < int(numShadowCascades); i++)
         {
-            float depth = shadowTexture.Sample(shadowSampler, lightCameraUVs);
-            float shadowBufferDistance = lightCameraNear + depth * (lightCameraFar - lightCameraNear);
-            float surfacePointDistance = abs(lambda);
-            float tolerance = 0.5;
-            if(shadowBufferDistance + tolerance < surfacePointDistance)
-                shadowFactor = shadowScale;
+            float3 eyePoint = lightCameraEyePoint[i].xyz;
+            float4 extents = lightCameraExtents[i];
+            float lambda = dot(eyePoint - input.worldPosition, lightDirection);
+            float3 lightCameraPoint = input.worldPosition + lambda * lightDirection;
+            float lightCameraPointX = dot(lightCameraPoint - eyePoint, lightCameraXAxis);
+            float lightCameraPointY = dot(lightCameraPoint - eyePoint, lightCameraYAxis);
+            float2 lightCameraUVs;
+            lightCameraUVs.x = lightCameraPointX / extents.x + 0.5;
+            lightCameraUVs.y = -lightCameraPointY / extents.y + 0.5;
+            if (0.0 <= lightCameraUVs.x && lightCameraUVs.x <= 1.0 &&
+                0.0 <= lightCameraUVs.y && lightCameraUVs.y <= 1.0)
+            {
+                float2 atlasUVs = (float2(i % 2, i / 2) + lightCameraUVs) * 0.5;
+                float depth = shadowTexture.SampleLevel(shadowSampler, atlasUVs, 0);
+                float shadowBufferDistance = extents.z + depth * (extents.w - extents.z);
+                float surfacePointDistance = abs(lambda);
+                float tolerance = 0.5;
+                if(shadowBufferDistance + tolerance < surfacePointDistance)
+                    shadowFactor = shadowScale;
+                break;
+            }
         }
     }
 
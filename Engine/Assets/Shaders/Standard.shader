@@ -15,38 +15,53 @@
             "size": 4,
             "type": "float"
         },
-        "lightCameraEyePoint": {
-            "offset": 176,
-            "size": 12,
+        "lightCameraExtents0": {
+            "offset": 272,
+            "size": 16,
             "type": "float"
         },
-        "lightCameraFar": {
-            "offset": 232,
-            "size": 4,
+        "lightCameraExtents1": {
+            "offset": 288,
+            "size": 16,
+            "type": "float"
+        },
+        "lightCameraExtents2": {
+            "offset": 304,
+            "size": 16,
+            "type": "float"
+        },
+        "lightCameraExtents3": {
+            "offset": 320,
+            "size": 16,
+            "type": "float"
+        },
+        "lightCameraEyePoint0": {
+            "offset": 208,
+            "size": 12,
             "type": "float"
         },
-        "lightCameraHeight": {
+        "lightCameraEyePoint1": {
             "offset": 224,
-            "size": 4,
+            "size": 12,
             "type": "float"
         },
-        "lightCameraNear": {
-            "offset": 228,
-            "size": 4,
+        "lightCameraEyePoint2": {
+            "offset": 240,
+            "size": 12,
             "type": "float"
         },
-        "lightCameraWidth": {
-            "offset": 220,
-            "size": 4,
+        "lightCameraEyePoint3": {
+            "offset": 256,
+            "size": 12,
             "type": "float"
         },
         "lightCameraXAxis": {
-            "offset": 192,
+            "offset": 176,
             "size": 12,
             "type": "float"
         },
         "lightCameraYAxis": {
-            "offset": 208,
+            "offset": 192,
             "size": 12,
             "type": "float"
         },
@@ -55,6 +70,11 @@
             "size": 12,
             "type": "float"
         },
+        "numShadowCascades": {
+            "offset": 204,
+            "size": 4,
+            "type": "float"
+        },
         "objectToProjection": {
             "offset": 0,
             "size": 64,
@@ -66,7 +86,7 @@
             "type": "float"
         },
         "shadowScale": {
-            "offset": 236,
+            "offset": 188,
             "size": 4,
             "type": "float"
         },
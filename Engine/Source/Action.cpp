@@ -78,7 +78,7 @@ void ActionManager::Tick(double deltaTime)
 
 	std::vector<Button> unbindArray;
 
-	for (auto pair : this->actionMap)
+	for (auto& pair : this->actionMap)
 	{
 		Action* action = pair.second;
 		Button inputKey = pair.first;
@@ -98,7 +98,7 @@ void ActionManager::Tick(double deltaTime)
 
 void ActionManager::Clear()
 {
-	for (auto pair : this->actionMap)
+	for (auto& pair : this->actionMap)
 	{
 		Action* action = pair.second;
 		action->Deinit();
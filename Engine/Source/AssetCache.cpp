@@ -17,6 +17,8 @@
 #include "Assets/TriggerBoxData.h"
 #include "Assets/Audio.h"
 #include "Assets/NavGraph.h"
+#include "Assets/InputTrack.h"
+#include "Assets/PerformanceReport.h"
 #include "Math/Angle.h"
 #include "Log.h"
 #include "Game.h"
@@ -44,7 +46,7 @@ AssetCache::AssetCache()
 
 /*virtual*/ void AssetCache::Clear()
 {
-	for (auto pair : this->assetMap)
+	for (auto& pair : this->assetMap)
 	{
 		Asset* asset = pair.second.Get();
 		asset->Unload();
@@ -191,6 +193,10 @@ std::string AssetCache::MakeKey(const std::string& assetFile)
 		return new MidiSong();
 	else if (ext == ".nav_graph")
 		return new NavGraph();
+	else if (ext == ".input_track")
+		return new InputTrack();
+	else if (ext == ".perf_report")
+		return new PerformanceReport();
 
 	return nullptr;
 }
@@ -286,6 +286,38 @@ bool Animation::CanAnimateSkeleton(const Skeleton* skeleton, double threshold) c
 	return matchRatio > threshold;
 }
 
+bool Animation::BindToSkeleton(const Skeleton* skeleton, BoneBinding& boneBinding) const
+{
+	boneBinding.clear();
+
+	if (this->keyFrameArray.size() == 0)
+		return true;
+
+	const KeyFrame* firstKeyFrame = this->keyFrameArray[0];
+	for (int i = 0; i < firstKeyFrame->GetPoseCount(); i++)
+		boneBinding.push_back(skeleton->FindBoneIndex(firstKeyFrame->GetPoseInfo(i).boneName));
+
+	for (const KeyFrame* keyFrame : this->keyFrameArray)
+	{
+		if (keyFrame->GetPoseCount() != firstKeyFrame->GetPoseCount())
+		{
+			IMZADI_LOG_ERROR(std::format("Key-frames of animation \"{}\" do not all pose the same number of bones.", this->name.c_str()));
+			return false;
+		}
+
+		for (int i = 0; i < keyFrame->GetPoseCount(); i++)
+		{
+			if (keyFrame->GetPoseInfo(i).boneName != firstKeyFrame->GetPoseInfo(i).boneName)
+			{
+				IMZADI_LOG_ERROR(std::format("Key-frames of animation \"{}\" do not all list their bones in the same order.", this->name.c_str()));
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
 bool Animation::CalculateKeyFrameFromTime(double timeSeconds, KeyFrame& keyFrame) const
 {
 	Cursor cursor;
@@ -460,18 +492,20 @@ bool KeyFrame::Interpolate(const KeyFramePair& keyFramePair, double timeSeconds)
 	return true;
 }
 
-int KeyFrame::PoseSkeleton(Skeleton* skeleton) const
+int KeyFrame::PoseSkeleton(Skeleton* skeleton, const BoneBinding& boneBinding, int maxBoneDepth /*= -1*/) const
 {
 	int poseCount = 0;
 
-	for (const PoseInfo& poseInfo : this->poseInfoArray)
+	// Note that an interpolated key-frame may be cut short if interpolation failed part-way.
+	size_t numPoses = std::min(this->poseInfoArray.size(), boneBinding.size());
+	for (size_t i = 0; i < numPoses; i++)
 	{
-		Bone* bone = skeleton->FindBone(poseInfo.boneName);
-		if (bone)
+		int boneIndex = boneBinding[i];
+		if (boneIndex >= 0 && (maxBoneDepth < 0 || skeleton->GetBoneDepth(boneIndex) <= maxBoneDepth))
 		{
 			Transform childToParent;
-			poseInfo.childToParent.GetToTransform(childToParent);
-			bone->SetCurrentPoseChildToParent(childToParent);
+			this->poseInfoArray[i].childToParent.GetToTransform(childToParent);
+			skeleton->SetCurrentPoseChildToParent(boneIndex, childToParent);
 			poseCount++;
 		}
 	}
@@ -479,21 +513,25 @@ int KeyFrame::PoseSkeleton(Skeleton* skeleton) const
 	return poseCount;
 }
 
+int KeyFrame::PoseSkeleton(Skeleton* skeleton) const
+{
+	BoneBinding boneBinding;
+	for (const PoseInfo& poseInfo : this->poseInfoArray)
+		boneBinding.push_back(skeleton->FindBoneIndex(poseInfo.boneName));
+
+	return this->PoseSkeleton(skeleton, boneBinding);
+}
+
 bool KeyFrame::MakePoseFromSkeleton(const Skeleton* skeleton)
 {
 	this->Clear();
 
-	std::vector<Bone*> boneArray;
-	const_cast<Skeleton*>(skeleton)->GatherBones(boneArray);
-
-	for (const Bone* bone : boneArray)
+	for (int i = 0; i < (int)skeleton->GetNumBones(); i++)
 	{
-		const Bone::Transforms* transform = bone->GetTransforms(BoneTransformType::CURRENT_POSE);
-
 		PoseInfo poseInfo;
-		poseInfo.boneName = bone->GetName();
+		poseInfo.boneName = skeleton->GetBone(i)->GetName();
 
-		if (!poseInfo.childToParent.SetFromTransform(transform->childToParent))
+		if (!poseInfo.childToParent.SetFromTransform(skeleton->GetChildToParent(BoneTransformType::CURRENT_POSE, i)))
 			return false;
 
 		if (!this->AddPoseInfo(poseInfo))
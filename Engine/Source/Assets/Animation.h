@@ -13,6 +13,14 @@ namespace Imzadi
 		const KeyFrame* upperBound;
 	};
 
+	/**
+	 * A bone binding maps the i^{th} pose-info of a key-frame to the index of the
+	 * bone it drives in a particular (flattened) skeleton, or to -1 if that skeleton
+	 * has no such bone.  Bindings are made at load-time so that we don't have to look
+	 * up bones by name every frame.
+	 */
+	typedef std::vector<int> BoneBinding;
+
 	/**
 	 * An animation is a sequence of key-frames.  Each key-frame specifies a moment in
 	 * time along with a set of bone orientations.  Each of these points to a named bone.
@@ -143,6 +151,18 @@ namespace Imzadi
 		 */
 		bool CanAnimateSkeleton(const Skeleton* skeleton, double threshold) const;
 
+		/**
+		 * Resolve the bone names of this animation against the given skeleton.  All key-frames
+		 * of an animation are expected to list their bones in the same order, so the resulting
+		 * binding can be used with any key-frame of this animation, or any key-frame interpolated
+		 * from them.
+		 *
+		 * @param[in] skeleton This is the skeleton that is to be driven by this animation.
+		 * @param[out] boneBinding This receives the mapping from pose-info index to bone index.
+		 * @return False is returned if the key-frames of this animation do not share a common bone order; true, otherwise.
+		 */
+		bool BindToSkeleton(const Skeleton* skeleton, BoneBinding& boneBinding) const;
+
 		/**
 		 * Calculate an interpolate key-frame from the given time.  An animation
 		 * is a sequence of key-frames, and actual animation-frames are what's
@@ -207,8 +227,16 @@ namespace Imzadi
 		 * not found in the given skeleton, then we just ignore it.
 		 *
 		 * @param[in,out] skeleton This is the skeleton who's bones are posed by this key-frame.
+		 * @param[in] boneBinding This maps our pose-info to the bones of the given skeleton.  See @ref Animation::BindToSkeleton.
+		 * @param[in] maxBoneDepth If non-negative, bones deeper than this in the skeleton hierarchy are left as they are.  This is used to animate a reduced bone set for far-away characters.
 		 * @return We return the number of bones posed in the given skeleton.
 		 */
+		int PoseSkeleton(Skeleton* skeleton, const BoneBinding& boneBinding, int maxBoneDepth = -1) const;
+
+		/**
+		 * This is the same as the above, but bones are looked up by name.  This is
+		 * convenient for tools, but shouldn't be used to pose a skeleton every frame.
+		 */
 		int PoseSkeleton(Skeleton* skeleton) const;
 
 		/**
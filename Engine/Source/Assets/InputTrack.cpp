@@ -0,0 +1,150 @@
+#include "InputTrack.h"
+#include "Log.h"
+#include <algorithm>
+
+using namespace Imzadi;
+
+InputTrack::InputTrack()
+{
+	this->idleKeyFrame.frameNumber = 0;
+	this->idleKeyFrame.buttonFlags = 0;
+	this->idleKeyFrame.leftJoyStick.SetComponents(0.0, 0.0);
+	this->idleKeyFrame.rightJoyStick.SetComponents(0.0, 0.0);
+	this->idleKeyFrame.leftTrigger = 0.0;
+	this->idleKeyFrame.rightTrigger = 0.0;
+}
+
+/*virtual*/ InputTrack::~InputTrack()
+{
+}
+
+/*virtual*/ bool InputTrack::Load(const rapidjson::Document& jsonDoc, AssetCache* assetCache)
+{
+	this->keyFrameArray.clear();
+
+	if (!jsonDoc.IsObject() || !jsonDoc.HasMember("key_frames") || !jsonDoc["key_frames"].IsArray())
+	{
+		IMZADI_LOG_ERROR("No \"key_frames\" member found or it's not an array.");
+		return false;
+	}
+
+	const rapidjson::Value& keyFrameArrayValue = jsonDoc["key_frames"];
+	for (int i = 0; i < (int)keyFrameArrayValue.Size(); i++)
+	{
+		const rapidjson::Value& keyFrameValue = keyFrameArrayValue[i];
+		if (!keyFrameValue.IsObject() || !keyFrameValue.HasMember("frame") || !keyFrameValue["frame"].IsUint())
+		{
+			IMZADI_LOG_ERROR("Key-frame %d is not an object or has no \"frame\" number.", i);
+			return false;
+		}
+
+		KeyFrame keyFrame = this->idleKeyFrame;
+		keyFrame.frameNumber = keyFrameValue["frame"].GetUint();
+
+		if (keyFrameValue.HasMember("buttons"))
+		{
+			std::vector<std::string> buttonNameArray;
+			if (!Asset::LoadStringArray(keyFrameValue["buttons"], buttonNameArray))
+			{
+				IMZADI_LOG_ERROR("The \"buttons\" member of key-frame %d is not an array of strings.", i);
+				return false;
+			}
+
+			for (const std::string& buttonName : buttonNameArray)
+			{
+				Button button;
+				if (!ButtonFromName(buttonName, button))
+				{
+					IMZADI_LOG_ERROR("Unknown button \"%s\" in key-frame %d.", buttonName.c_str(), i);
+					return false;
+				}
+
+				keyFrame.buttonFlags |= (1 << uint32_t(button));
+			}
+		}
+
+		auto loadJoyStick = [&keyFrameValue](const char* name, Vector2& joyStick)
+		{
+			if (keyFrameValue.HasMember(name) && keyFrameValue[name].IsArray() && keyFrameValue[name].Size() == 2)
+				joyStick.SetComponents(keyFrameValue[name][0].GetDouble(), keyFrameValue[name][1].GetDouble());
+		};
+
+		loadJoyStick("left_stick", keyFrame.leftJoyStick);
+		loadJoyStick("right_stick", keyFrame.rightJoyStick);
+
+		if (keyFrameValue.HasMember("left_trigger") && keyFrameValue["left_trigger"].IsNumber())
+			keyFrame.leftTrigger = keyFrameValue["left_trigger"].GetDouble();
+
+		if (keyFrameValue.HasMember("right_trigger") && keyFrameValue["right_trigger"].IsNumber())
+			keyFrame.rightTrigger = keyFrameValue["right_trigger"].GetDouble();
+
+		this->keyFrameArray.push_back(keyFrame);
+	}
+
+	std::stable_sort(this->keyFrameArray.begin(), this->keyFrameArray.end(), [](const KeyFrame& keyFrameA, const KeyFrame& keyFrameB) {
+		return keyFrameA.frameNumber < keyFrameB.frameNumber;
+	});
+
+	return true;
+}
+
+/*virtual*/ bool InputTrack::Unload()
+{
+	this->keyFrameArray.clear();
+	return true;
+}
+
+const InputTrack::KeyFrame& InputTrack::GetKeyFrame(uint32_t frameNumber) const
+{
+	// Find the last key-frame that starts at or before the given frame.
+	auto iter = std::upper_bound(this->keyFrameArray.begin(), this->keyFrameArray.end(), frameNumber, [](uint32_t frameNumber, const KeyFrame& keyFrame) {
+		return frameNumber < keyFrame.frameNumber;
+	});
+
+	if (iter == this->keyFrameArray.begin())
+		return this->idleKeyFrame;
+
+	return *(--iter);
+}
+
+uint32_t InputTrack::GetLastFrameNumber() const
+{
+	if (this->keyFrameArray.size() == 0)
+		return 0;
+
+	return this->keyFrameArray[this->keyFrameArray.size() - 1].frameNumber;
+}
+
+/*static*/ bool InputTrack::ButtonFromName(const std::string& buttonName, Button& button)
+{
+	static const char* buttonNameArray[] =
+	{
+		"X_BUTTON",
+		"Y_BUTTON",
+		"A_BUTTON",
+		"B_BUTTON",
+		"DPAD_UP",
+		"DPAD_DOWN",
+		"DPAD_LEFT",
+		"DPAD_RIGHT",
+		"L_JOY_STICK",
+		"R_JOY_STICK",
+		"L_SHOULDER",
+		"R_SHOULDER",
+		"L_TRIGGER",
+		"R_TRIGGER",
+		"BACK",
+		"START"
+	};
+
+	for (int i = 0; i < sizeof(buttonNameArray) / sizeof(const char*); i++)
+	{
+		if (buttonName == buttonNameArray[i])
+		{
+			button = Button(i);
+			return true;
+		}
+	}
+
+	return false;
+}
\ No newline at end of file
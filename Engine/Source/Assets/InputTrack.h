@@ -0,0 +1,58 @@
+#pragma once
+
+#include "AssetCache.h"
+#include "Input/Input.h"
+#include "Math/Vector2.h"
+
+namespace Imzadi
+{
+	/**
+	 * This is a recording of controller input, frame by frame, that can be played back
+	 * by the @ref ScriptedInput class to drive the game without anyone at the controls.
+	 * It's stored as a list of key-frames, each of which holds until the next one.
+	 */
+	class IMZADI_API InputTrack : public Asset
+	{
+	public:
+		InputTrack();
+		virtual ~InputTrack();
+
+		virtual bool Load(const rapidjson::Document& jsonDoc, AssetCache* assetCache) override;
+		virtual bool Unload() override;
+
+		/**
+		 * This is the state of the controller from a given frame onward.
+		 */
+		struct KeyFrame
+		{
+			uint32_t frameNumber;
+			uint32_t buttonFlags;		///< Bit N is set if button N of the Button enum is down.
+			Vector2 leftJoyStick;
+			Vector2 rightJoyStick;
+			double leftTrigger;
+			double rightTrigger;
+		};
+
+		/**
+		 * Return the key-frame in effect for the given frame number.
+		 * Before the first key-frame, nothing is pressed.
+		 */
+		const KeyFrame& GetKeyFrame(uint32_t frameNumber) const;
+
+		/**
+		 * Return the number of the frame at which the last key-frame starts.
+		 */
+		uint32_t GetLastFrameNumber() const;
+
+		/**
+		 * Map a button name, such as "A_BUTTON", to its value in the Button enum.
+		 *
+		 * @return True is returned on success; false, if the name is unknown.
+		 */
+		static bool ButtonFromName(const std::string& buttonName, Button& button);
+
+	private:
+		std::vector<KeyFrame> keyFrameArray;
+		KeyFrame idleKeyFrame;
+	};
+}
\ No newline at end of file
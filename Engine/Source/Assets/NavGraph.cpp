@@ -1,7 +1,7 @@
 #include "NavGraph.h"
 #include "Log.h"
 #include "RenderObjects/DebugLines.h"
-#include <queue>
+#include <algorithm>
 #include <unordered_map>
 
 using namespace Imzadi;
@@ -10,6 +10,7 @@ using namespace Imzadi;
 
 NavGraph::NavGraph()
 {
+	this->version = 0;
 }
 
 /*virtual*/ NavGraph::~NavGraph()
@@ -47,6 +48,7 @@ NavGraph::NavGraph()
 		const rapidjson::Value& nodeValue = nodeArrayValue[i];
 
 		Node* node = new Node();
+		node->ordinal = (int)this->nodeArray.size();
 		this->nodeArray.push_back(node);
 
 		if (!nodeValue.IsObject())
@@ -69,6 +71,7 @@ NavGraph::NavGraph()
 		const rapidjson::Value& pathValue = pathArrayValue[i];
 
 		Path* path = new Path();
+		path->ordinal = (int)this->pathArray.size();
 		this->pathArray.push_back(path);
 
 		if (!pathValue.IsObject())
@@ -141,6 +144,8 @@ NavGraph::NavGraph()
 		return false;
 	}
 
+	this->RebuildSpatialIndex();
+
 	return true;
 }
 
@@ -223,6 +228,66 @@ void NavGraph::Clear()
 
 	this->nodeArray.clear();
 	this->pathArray.clear();
+
+	this->spatialIndex.Clear(this->spatialIndex.GetCellSize());
+	this->version++;
+}
+
+void NavGraph::CopyFrom(const NavGraph& navGraph)
+{
+	this->Clear();
+
+	for (const Reference<Node>& otherNode : navGraph.nodeArray)
+	{
+		Node* node = new Node();
+		node->location = otherNode->location;
+		node->ordinal = otherNode->ordinal;
+		this->nodeArray.push_back(node);
+	}
+
+	for (const Reference<Path>& otherPath : navGraph.pathArray)
+	{
+		Path* path = new Path();
+		path->terminalNode[0] = this->nodeArray[otherPath->terminalNode[0]->ordinal];
+		path->terminalNode[1] = this->nodeArray[otherPath->terminalNode[1]->ordinal];
+		path->length = otherPath->length;
+		path->ordinal = otherPath->ordinal;
+		this->pathArray.push_back(path);
+	}
+
+	for (int i = 0; i < (int)this->nodeArray.size(); i++)
+		for (const Reference<Path>& otherPath : navGraph.nodeArray[i]->adjacentPathArray)
+			this->nodeArray[i]->adjacentPathArray.push_back(this->pathArray[otherPath->ordinal]);
+
+	this->RebuildSpatialIndex(navGraph.spatialIndex.GetCellSize());
+	this->version = navGraph.version;
+}
+
+void NavGraph::RebuildSpatialIndex(double cellSize /*= 0.0*/)
+{
+	if (cellSize <= 0.0)
+	{
+		// A cell about as wide as an edge is long should hold a node or two.
+		cellSize = this->spatialIndex.GetCellSize();
+		if (this->pathArray.size() > 0)
+		{
+			double totalLength = 0.0;
+			for (const Reference<Path>& path : this->pathArray)
+				totalLength += path->length;
+
+			double averageLength = totalLength / double(this->pathArray.size());
+			if (averageLength > 1e-3)
+				cellSize = averageLength;
+		}
+	}
+
+	this->spatialIndex.Clear(cellSize);
+
+	for (const Reference<Node>& node : this->nodeArray)
+		this->spatialIndex.AddNode(node);
+
+	for (const Reference<Path>& path : this->pathArray)
+		this->spatialIndex.AddPath(path);
 }
 
 bool NavGraph::IsValid() const
@@ -290,22 +355,18 @@ NavGraph::Node* NavGraph::AddLocation(const Vector3& location, double snapTolera
 	{
 		node = new Node();
 		node->location = location;
+		node->ordinal = (int)this->nodeArray.size();
 		this->nodeArray.push_back(node);
+		this->spatialIndex.AddNode(node);
+		this->version++;
 
-		for (int i = 0; i < (int)this->pathArray.size(); i++)
+		Reference<Path> path(const_cast<Path*>(this->FindNearestPathWithinDistance(location, snapTolerance)));
+		if (path.Get())
 		{
-			Reference<Path> path = this->pathArray[i];
-			LineSegment pathSegment = path->GetPathSegment();
-			double distance = pathSegment.ShortestDistanceTo(location);
-			if (distance <= snapTolerance)
-			{
-				this->RemovePath(i);
+			this->RemovePath(path->ordinal);
 
-				this->AddPathBetweenNodes(path->terminalNode[0], node);
-				this->AddPathBetweenNodes(path->terminalNode[1], node);
-
-				break;
-			}
+			this->AddPathBetweenNodes(path->terminalNode[0], node);
+			this->AddPathBetweenNodes(path->terminalNode[1], node);
 		}
 	}
 
@@ -322,9 +383,13 @@ bool NavGraph::AddPathBetweenNodes(Node* nodeA, Node* nodeB)
 	Reference<Path> path(new Path());
 	path->terminalNode[0].Set(nodeA);
 	path->terminalNode[1].Set(nodeB);
+	path->UpdateLength();
+	path->ordinal = (int)this->pathArray.size();
 	this->pathArray.push_back(path);
 	nodeA->adjacentPathArray.push_back(path);
 	nodeB->adjacentPathArray.push_back(path);
+	this->spatialIndex.AddPath(path);
+	this->version++;
 	return true;
 }
 
@@ -343,12 +408,9 @@ bool NavGraph::RemovePathBetweenNodes(Node* nodeA, Node* nodeB)
 
 int NavGraph::FindPathJoiningNodes(Node* nodeA, Node* nodeB)
 {
-	for (int i = 0; i < (int)this->pathArray.size(); i++)
-	{
-		Path* path = this->pathArray[i];
+	for (const Reference<Path>& path : nodeA->adjacentPathArray)
 		if (path->JoinsNodes(nodeA, nodeB))
-			return i;
-	}
+			return path->ordinal;
 
 	return -1;
 }
@@ -359,14 +421,19 @@ bool NavGraph::RemovePath(int i)
 		return false;
 
 	Path* path = this->pathArray[i];
+	this->spatialIndex.RemovePath(path);
 	bool removed0 = path->terminalNode[0]->RemovePath(path);
 	bool removed1 = path->terminalNode[1]->RemovePath(path);
 	IMZADI_ASSERT(removed0 && removed1);
 
 	if (i < int(this->pathArray.size() - 1))
+	{
 		this->pathArray[i].Set(this->pathArray[this->pathArray.size() - 1]);
+		this->pathArray[i]->ordinal = i;
+	}
 
 	this->pathArray.pop_back();
+	this->version++;
 	return true;
 }
 
@@ -383,44 +450,22 @@ void NavGraph::DebugDraw(DebugLines& debugLines) const
 
 const NavGraph::Node* NavGraph::FindNearestNode(const Vector3& location) const
 {
-	double minSquareDistance = std::numeric_limits<double>::max();
-	const Node* foundNode = nullptr;
-	for (const Reference<Node>& node : this->nodeArray)
-	{
-		double squareDistance = (node->location - location).SquareLength();
-		if (squareDistance < minSquareDistance)
-		{
-			minSquareDistance = squareDistance;
-			foundNode = node;
-		}
-	}
-
-	return foundNode;
+	return this->spatialIndex.FindNearestNode(location, std::numeric_limits<double>::infinity());
 }
 
 const NavGraph::Node* NavGraph::FindNearestNodeWithinDistance(const Vector3& location, double maxDistance) const
 {
-	const Node* foundNode = this->FindNearestNode(location);
-	if (!foundNode)
-		return nullptr;
-
-	double distance = (foundNode->location - location).Length();
-	return (distance <= maxDistance) ? foundNode : nullptr;
+	return this->spatialIndex.FindNearestNode(location, maxDistance);
 }
 
 const NavGraph::Path* NavGraph::FindNearestPath(const Vector3& location, int* i /*= nullptr*/) const
 {
-	double shortestDistance = std::numeric_limits<double>::max();
-	const Path* foundPath = nullptr;
-	for (const Path* path : this->pathArray)
-	{
-		double distance = path->GetPathSegment().ShortestDistanceTo(location);
-		if (distance < shortestDistance)
-		{
-			foundPath = path;
-			shortestDistance = distance;
-		}
-	}
+	return this->FindNearestPathWithinDistance(location, std::numeric_limits<double>::infinity(), i);
+}
+
+const NavGraph::Path* NavGraph::FindNearestPathWithinDistance(const Vector3& location, double maxDistance, int* i /*= nullptr*/) const
+{
+	const Path* foundPath = this->spatialIndex.FindNearestPath(location, maxDistance);
 
 	if (i)
 	{
@@ -437,61 +482,131 @@ const NavGraph::Path* NavGraph::FindNearestPath(const Vector3& location, int* i
 	return foundPath;
 }
 
-// See Chapter 25, Single-Source Shortest Paths of "Intro to Algorithms" by Rivest, et. al.
-bool NavGraph::FindShortestPath(const Node* nodeA, const Node* nodeB, std::list<int>& pathList) const
+void NavGraph::FindNodesWithinDistance(const Vector3& location, double radius, std::vector<const Node*>& foundNodeArray) const
 {
-	pathList.clear();
-	if (nodeA == nodeB)
-		return true;
+	this->spatialIndex.FindNodesWithinDistance(location, radius, foundNodeArray);
+}
 
-	for (const Reference<Node>& node : this->nodeArray)
+void NavGraph::FindPathsWithinDistance(const Vector3& location, double radius, std::vector<const Path*>& foundPathArray) const
+{
+	this->spatialIndex.FindPathsWithinDistance(location, radius, foundPathArray);
+}
+
+bool NavGraph::FindShortestPath(const Node* nodeA, const Node* nodeB, std::vector<int>& pathArray, SearchContext& context) const
+{
+	pathArray.clear();
+
+	if (!this->BeginShortestPathSearch(nodeA, nodeB, context))
+		return false;
+
+	if (this->ContinueShortestPathSearch(context, std::numeric_limits<uint32_t>::max()) != SearchStatus::SEARCH_SUCCEEDED)
+		return false;
+
+	return this->GetShortestPath(context, pathArray);
+}
+
+bool NavGraph::BeginShortestPathSearch(const Node* nodeA, const Node* nodeB, SearchContext& context) const
+{
+	int numNodes = (int)this->nodeArray.size();
+	if (!(0 <= nodeA->ordinal && nodeA->ordinal < numNodes && this->nodeArray[nodeA->ordinal] == nodeA) ||
+		!(0 <= nodeB->ordinal && nodeB->ordinal < numNodes && this->nodeArray[nodeB->ordinal] == nodeB))
 	{
-		node->distance = (node.Get() == nodeA) ? 0.0 : std::numeric_limits<double>::max();
-		node->parentNode = nullptr;
+		IMZADI_LOG_ERROR("Can't find a path between nodes that aren't members of the graph.");
+		context.status = SearchStatus::SEARCH_FAILED;
+		return false;
 	}
 
-	struct NodeCompare
+	context.Begin(numNodes, nodeA->ordinal, nodeB->ordinal);
+
+	SearchContext::NodeState& startState = context.GetNodeState(nodeA->ordinal);
+	startState.costSoFar = 0.0;
+	context.openArray.push_back(SearchContext::OpenEntry{ (nodeB->location - nodeA->location).Length(), 0.0, nodeA->ordinal });
+
+	return true;
+}
+
+// See Chapter 4, Informed Search and Exploration of "Artificial Intelligence: A Modern Approach" by Russell and Norvig.
+NavGraph::SearchStatus NavGraph::ContinueShortestPathSearch(SearchContext& context, uint32_t maxNodesToExpand) const
+{
+	if (context.status != SearchStatus::SEARCH_IN_PROGRESS)
+		return context.status;
+
+	const Node* goalNode = this->nodeArray[context.goalOrdinal];
+
+	// The straight-line distance is never more than the length of any path, and it obeys the triangle
+	// inequality, so the first time we take a node off the heap, we've found the shortest path to it.
+	// In particular, we're done as soon as we take the goal off the heap.
+	for (uint32_t numNodesExpanded = 0; numNodesExpanded < maxNodesToExpand; )
 	{
-		bool operator()(const Node* left, const Node* right) const
+		if (context.openArray.size() == 0)
 		{
-			return left->distance > right->distance;
+			context.status = SearchStatus::SEARCH_FAILED;
+			break;
 		}
-	};
 
-	// Note that we can't terminate early here if we run into node B.
-	// We have to keep going until we've found a spanning tree of the whole graph.
-	// This is because parent nodes can get both assigned and re-assigned during
-	// the course of the algorithm.
-	std::priority_queue<const Node*, std::vector<const Node*>, NodeCompare> queue;
-	queue.push(nodeA);
-	while (queue.size() > 0)
-	{
-		const Node* parentNode = queue.top();
-		queue.pop();
+		std::pop_heap(context.openArray.begin(), context.openArray.end(), SearchContext::CompareOpenEntries);
+		SearchContext::OpenEntry entry = context.openArray.back();
+		context.openArray.pop_back();
+
+		SearchContext::NodeState& parentState = context.GetNodeState(entry.ordinal);
+		if (parentState.closed || entry.costSoFar > parentState.costSoFar)
+			continue;
+
+		if (entry.ordinal == context.goalOrdinal)
+		{
+			context.status = SearchStatus::SEARCH_SUCCEEDED;
+			break;
+		}
+
+		parentState.closed = true;
+		context.numNodesExpanded++;
+		numNodesExpanded++;
 
-		for (const Reference<Path>& path : parentNode->adjacentPathArray)
+		const Node* parentNode = this->nodeArray[entry.ordinal];
+		for (int i = 0; i < (int)parentNode->adjacentPathArray.size(); i++)
 		{
+			const Path* path = parentNode->adjacentPathArray[i];
 			const Node* childNode = path->Follow(parentNode);
-			double distance = parentNode->distance + path->length;
-			if (distance < childNode->distance)
+			SearchContext::NodeState& childState = context.GetNodeState(childNode->ordinal);
+			if (childState.closed)
+				continue;
+
+			double costSoFar = entry.costSoFar + path->length;
+			if (costSoFar < childState.costSoFar)
 			{
-				childNode->distance = distance;
-				childNode->parentNode = parentNode;
-				queue.push(childNode);
+				childState.costSoFar = costSoFar;
+				childState.parentOrdinal = entry.ordinal;
+				childState.parentAdjacency = i;
+
+				double estimatedCost = costSoFar + (goalNode->location - childNode->location).Length();
+				context.openArray.push_back(SearchContext::OpenEntry{ estimatedCost, costSoFar, childNode->ordinal });
+				std::push_heap(context.openArray.begin(), context.openArray.end(), SearchContext::CompareOpenEntries);
 			}
 		}
 	}
 
-	while (nodeB->parentNode)
+	if (context.status != SearchStatus::SEARCH_IN_PROGRESS)
+		context.openArray.clear();
+
+	return context.status;
+}
+
+bool NavGraph::GetShortestPath(const SearchContext& context, std::vector<int>& pathArray) const
+{
+	pathArray.clear();
+
+	if (context.status != SearchStatus::SEARCH_SUCCEEDED)
+		return false;
+
+	for (int ordinal = context.goalOrdinal; ordinal != context.startOrdinal; )
 	{
-		const Node* parentNode = nodeB->parentNode;
-		int i = parentNode->FindAdjacencyIndex(nodeB);
-		IMZADI_ASSERT(i != -1);
-		pathList.push_front(i);
-		nodeB = parentNode;
+		const SearchContext::NodeState& state = context.nodeStateArray[ordinal];
+		pathArray.push_back(state.parentAdjacency);
+		ordinal = state.parentOrdinal;
 	}
 
-	return pathList.size() > 0;
+	std::reverse(pathArray.begin(), pathArray.end());
+	return true;
 }
 
 const NavGraph::Node* NavGraph::GetRandomNode(Random& random) const
@@ -507,8 +622,7 @@ const NavGraph::Node* NavGraph::GetRandomNode(Random& random) const
 
 NavGraph::Node::Node()
 {
-	this->distance = 0.0;
-	this->parentNode = nullptr;
+	this->ordinal = -1;
 }
 
 /*virtual*/ NavGraph::Node::~Node()
@@ -562,6 +676,7 @@ const NavGraph::Node* NavGraph::Node::GetAdjacentNode(int i) const
 NavGraph::Path::Path()
 {
 	this->length = 0.0;
+	this->ordinal = -1;
 }
 
 /*virtual*/ NavGraph::Path::~Path()
@@ -607,4 +722,389 @@ bool NavGraph::Path::JoinsNodes(const Node* nodeA, const Node* nodeB) const
 		return true;
 
 	return false;
+}
+
+//------------------------------------- NavGraph::SearchContext -------------------------------------
+
+NavGraph::SearchContext::SearchContext()
+{
+	this->stamp = 0;
+	this->numNodesExpanded = 0;
+	this->startOrdinal = -1;
+	this->goalOrdinal = -1;
+	this->status = SearchStatus::SEARCH_FAILED;
+}
+
+/*virtual*/ NavGraph::SearchContext::~SearchContext()
+{
+}
+
+void NavGraph::SearchContext::Clear()
+{
+	this->nodeStateArray.clear();
+	this->openArray.clear();
+	this->stamp = 0;
+	this->numNodesExpanded = 0;
+	this->startOrdinal = -1;
+	this->goalOrdinal = -1;
+	this->status = SearchStatus::SEARCH_FAILED;
+}
+
+void NavGraph::SearchContext::Begin(int numNodes, int startOrdinal, int goalOrdinal)
+{
+	// Bumping the stamp invalidates the state of every node at once, so a search only
+	// pays for the nodes it actually touches, not for the size of the whole graph.
+	if ((int)this->nodeStateArray.size() < numNodes)
+	{
+		NodeState staleState{ 0.0, -1, -1, 0, false };
+		this->nodeStateArray.resize(numNodes, staleState);
+	}
+
+	this->stamp++;
+	if (this->stamp == 0)
+	{
+		for (NodeState& state : this->nodeStateArray)
+			state.stamp = 0;
+
+		this->stamp = 1;
+	}
+
+	this->openArray.clear();
+	this->numNodesExpanded = 0;
+	this->startOrdinal = startOrdinal;
+	this->goalOrdinal = goalOrdinal;
+	this->status = SearchStatus::SEARCH_IN_PROGRESS;
+}
+
+// This makes the binary heap of open entries a min-heap on the estimated cost.
+/*static*/ bool NavGraph::SearchContext::CompareOpenEntries(const OpenEntry& entryA, const OpenEntry& entryB)
+{
+	return entryA.estimatedCost > entryB.estimatedCost;
+}
+
+NavGraph::SearchContext::NodeState& NavGraph::SearchContext::GetNodeState(int ordinal)
+{
+	NodeState& state = this->nodeStateArray[ordinal];
+	if (state.stamp != this->stamp)
+	{
+		state.costSoFar = std::numeric_limits<double>::max();
+		state.parentOrdinal = -1;
+		state.parentAdjacency = -1;
+		state.stamp = this->stamp;
+		state.closed = false;
+	}
+
+	return state;
+}
+
+//------------------------------------- NavGraph::SpatialIndex -------------------------------------
+
+NavGraph::SpatialIndex::SpatialIndex()
+{
+	this->cellSize = 10.0;
+	this->occupiedRect = CellRect{ 0, 0, -1, -1 };
+}
+
+/*virtual*/ NavGraph::SpatialIndex::~SpatialIndex()
+{
+}
+
+void NavGraph::SpatialIndex::Clear(double cellSize)
+{
+	this->cellSize = cellSize;
+	this->cellMap.clear();
+	this->occupiedRect = CellRect{ 0, 0, -1, -1 };
+}
+
+int NavGraph::SpatialIndex::CalcCellCoord(double x) const
+{
+	// Clamp so that a huge search radius can't overflow the cell coordinates.
+	return (int)::floor(IMZADI_CLAMP(x / this->cellSize, -1e9, 1e9));
+}
+
+NavGraph::SpatialIndex::CellRect NavGraph::SpatialIndex::CalcCellRect(const Vector3& location, double radius) const
+{
+	CellRect rect;
+	rect.minX = this->CalcCellCoord(location.x - radius);
+	rect.minZ = this->CalcCellCoord(location.z - radius);
+	rect.maxX = this->CalcCellCoord(location.x + radius);
+	rect.maxZ = this->CalcCellCoord(location.z + radius);
+	return rect;
+}
+
+NavGraph::SpatialIndex::CellRect NavGraph::SpatialIndex::CalcCellRect(const Path* path) const
+{
+	const Vector3& pointA = path->terminalNode[0]->location;
+	const Vector3& pointB = path->terminalNode[1]->location;
+
+	CellRect rect;
+	rect.minX = this->CalcCellCoord(IMZADI_MIN(pointA.x, pointB.x));
+	rect.minZ = this->CalcCellCoord(IMZADI_MIN(pointA.z, pointB.z));
+	rect.maxX = this->CalcCellCoord(IMZADI_MAX(pointA.x, pointB.x));
+	rect.maxZ = this->CalcCellCoord(IMZADI_MAX(pointA.z, pointB.z));
+	return rect;
+}
+
+/*static*/ uint64_t NavGraph::SpatialIndex::MakeCellKey(int x, int z)
+{
+	return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(z));
+}
+
+void NavGraph::SpatialIndex::AddNode(const Node* node)
+{
+	int x = this->CalcCellCoord(node->location.x);
+	int z = this->CalcCellCoord(node->location.z);
+
+	if (this->cellMap.size() == 0)
+		this->occupiedRect = CellRect{ x, z, x, z };
+	else
+	{
+		this->occupiedRect.minX = IMZADI_MIN(this->occupiedRect.minX, x);
+		this->occupiedRect.minZ = IMZADI_MIN(this->occupiedRect.minZ, z);
+		this->occupiedRect.maxX = IMZADI_MAX(this->occupiedRect.maxX, x);
+		this->occupiedRect.maxZ = IMZADI_MAX(this->occupiedRect.maxZ, z);
+	}
+
+	this->cellMap[MakeCellKey(x, z)].nodeArray.push_back(node);
+}
+
+void NavGraph::SpatialIndex::AddPath(const Path* path)
+{
+	CellRect rect = this->CalcCellRect(path);
+
+	if (this->cellMap.size() == 0)
+		this->occupiedRect = rect;
+	else
+	{
+		this->occupiedRect.minX = IMZADI_MIN(this->occupiedRect.minX, rect.minX);
+		this->occupiedRect.minZ = IMZADI_MIN(this->occupiedRect.minZ, rect.minZ);
+		this->occupiedRect.maxX = IMZADI_MAX(this->occupiedRect.maxX, rect.maxX);
+		this->occupiedRect.maxZ = IMZADI_MAX(this->occupiedRect.maxZ, rect.maxZ);
+	}
+
+	for (int x = rect.minX; x <= rect.maxX; x++)
+		for (int z = rect.minZ; z <= rect.maxZ; z++)
+			this->cellMap[MakeCellKey(x, z)].pathArray.push_back(path);
+}
+
+void NavGraph::SpatialIndex::RemovePath(const Path* path)
+{
+	// Note that we don't bother shrinking the occupied rectangle here.  It only has to bound what's in the grid.
+	CellRect rect = this->CalcCellRect(path);
+
+	for (int x = rect.minX; x <= rect.maxX; x++)
+	{
+		for (int z = rect.minZ; z <= rect.maxZ; z++)
+		{
+			auto iter = this->cellMap.find(MakeCellKey(x, z));
+			if (iter == this->cellMap.end())
+				continue;
+
+			Cell& cell = iter->second;
+			for (int i = 0; i < (int)cell.pathArray.size(); i++)
+			{
+				if (cell.pathArray[i] == path)
+				{
+					cell.pathArray[i] = cell.pathArray[cell.pathArray.size() - 1];
+					cell.pathArray.pop_back();
+					break;
+				}
+			}
+
+			if (cell.nodeArray.size() == 0 && cell.pathArray.size() == 0)
+				this->cellMap.erase(iter);
+		}
+	}
+}
+
+// Visit the cells in square rings of increasing size around the given location until the best distance found
+// so far is less than the distance to the nearest ring not yet visited.  Everything in the grid is found this
+// way without looking at every cell, as long as the cell function lowers the best distance as it goes.
+template<typename CellFunc>
+void NavGraph::SpatialIndex::SearchOutward(const Vector3& location, double& bestDistance, CellFunc cellFunc) const
+{
+	if (this->cellMap.size() == 0)
+		return;
+
+	int centerX = this->CalcCellCoord(location.x);
+	int centerZ = this->CalcCellCoord(location.z);
+
+	const CellRect& rect = this->occupiedRect;
+	int maxRing = IMZADI_MAX(IMZADI_MAX(centerX - rect.minX, rect.maxX - centerX), IMZADI_MAX(centerZ - rect.minZ, rect.maxZ - centerZ));
+
+	auto visitCell = [this, &rect, &cellFunc](int x, int z)
+	{
+		if (x < rect.minX || x > rect.maxX || z < rect.minZ || z > rect.maxZ)
+			return;
+
+		auto iter = this->cellMap.find(MakeCellKey(x, z));
+		if (iter != this->cellMap.end())
+			cellFunc(iter->second);
+	};
+
+	for (int ring = 0; ring <= maxRing; ring++)
+	{
+		// Anything in this ring or beyond is at least this far away horizontally, let alone in 3D.
+		if (ring > 0 && bestDistance <= double(ring - 1) * this->cellSize)
+			break;
+
+		// Once the rings get big compared to the number of occupied cells, it's cheaper to just visit all of those.
+		if (uint64_t(2 * ring + 1) * uint64_t(2 * ring + 1) > 2 * uint64_t(this->cellMap.size()))
+		{
+			for (const auto& pair : this->cellMap)
+				cellFunc(pair.second);
+
+			break;
+		}
+
+		if (ring == 0)
+		{
+			visitCell(centerX, centerZ);
+			continue;
+		}
+
+		for (int x = centerX - ring; x <= centerX + ring; x++)
+		{
+			visitCell(x, centerZ - ring);
+			visitCell(x, centerZ + ring);
+		}
+
+		for (int z = centerZ - ring + 1; z <= centerZ + ring - 1; z++)
+		{
+			visitCell(centerX - ring, z);
+			visitCell(centerX + ring, z);
+		}
+	}
+}
+
+const NavGraph::Node* NavGraph::SpatialIndex::FindNearestNode(const Vector3& location, double maxDistance) const
+{
+	// Nudge the bound up so that a node exactly at the maximum distance still counts.
+	double bestDistance = std::nextafter(maxDistance, std::numeric_limits<double>::infinity());
+	const Node* foundNode = nullptr;
+
+	this->SearchOutward(location, bestDistance, [&location, &bestDistance, &foundNode](const Cell& cell)
+		{
+			for (const Node* node : cell.nodeArray)
+			{
+				double distance = (node->location - location).Length();
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					foundNode = node;
+				}
+			}
+		});
+
+	return foundNode;
+}
+
+const NavGraph::Path* NavGraph::SpatialIndex::FindNearestPath(const Vector3& location, double maxDistance) const
+{
+	double bestDistance = std::nextafter(maxDistance, std::numeric_limits<double>::infinity());
+	const Path* foundPath = nullptr;
+
+	this->SearchOutward(location, bestDistance, [&location, &bestDistance, &foundPath](const Cell& cell)
+		{
+			for (const Path* path : cell.pathArray)
+			{
+				if (path == foundPath)
+					continue;
+
+				double distance = path->GetPathSegment().ShortestDistanceTo(location);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					foundPath = path;
+				}
+			}
+		});
+
+	return foundPath;
+}
+
+void NavGraph::SpatialIndex::FindNodesWithinDistance(const Vector3& location, double radius, std::vector<const Node*>& foundNodeArray) const
+{
+	if (this->cellMap.size() == 0 || radius < 0.0)
+		return;
+
+	auto visitCell = [&location, radius, &foundNodeArray](const Cell& cell)
+	{
+		for (const Node* node : cell.nodeArray)
+			if ((node->location - location).Length() <= radius)
+				foundNodeArray.push_back(node);
+	};
+
+	CellRect rect = this->CalcCellRect(location, radius);
+	rect.minX = IMZADI_MAX(rect.minX, this->occupiedRect.minX);
+	rect.minZ = IMZADI_MAX(rect.minZ, this->occupiedRect.minZ);
+	rect.maxX = IMZADI_MIN(rect.maxX, this->occupiedRect.maxX);
+	rect.maxZ = IMZADI_MIN(rect.maxZ, this->occupiedRect.maxZ);
+
+	if (rect.minX > rect.maxX || rect.minZ > rect.maxZ)
+		return;
+
+	if (uint64_t(rect.maxX - rect.minX + 1) * uint64_t(rect.maxZ - rect.minZ + 1) > uint64_t(this->cellMap.size()))
+	{
+		for (const auto& pair : this->cellMap)
+			visitCell(pair.second);
+
+		return;
+	}
+
+	for (int x = rect.minX; x <= rect.maxX; x++)
+	{
+		for (int z = rect.minZ; z <= rect.maxZ; z++)
+		{
+			auto iter = this->cellMap.find(MakeCellKey(x, z));
+			if (iter != this->cellMap.end())
+				visitCell(iter->second);
+		}
+	}
+}
+
+void NavGraph::SpatialIndex::FindPathsWithinDistance(const Vector3& location, double radius, std::vector<const Path*>& foundPathArray) const
+{
+	if (this->cellMap.size() == 0 || radius < 0.0)
+		return;
+
+	size_t firstFound = foundPathArray.size();
+
+	auto visitCell = [&location, radius, &foundPathArray](const Cell& cell)
+	{
+		for (const Path* path : cell.pathArray)
+			if (path->GetPathSegment().ShortestDistanceTo(location) <= radius)
+				foundPathArray.push_back(path);
+	};
+
+	CellRect rect = this->CalcCellRect(location, radius);
+	rect.minX = IMZADI_MAX(rect.minX, this->occupiedRect.minX);
+	rect.minZ = IMZADI_MAX(rect.minZ, this->occupiedRect.minZ);
+	rect.maxX = IMZADI_MIN(rect.maxX, this->occupiedRect.maxX);
+	rect.maxZ = IMZADI_MIN(rect.maxZ, this->occupiedRect.maxZ);
+
+	if (rect.minX > rect.maxX || rect.minZ > rect.maxZ)
+		return;
+
+	if (uint64_t(rect.maxX - rect.minX + 1) * uint64_t(rect.maxZ - rect.minZ + 1) > uint64_t(this->cellMap.size()))
+	{
+		for (const auto& pair : this->cellMap)
+			visitCell(pair.second);
+	}
+	else
+	{
+		for (int x = rect.minX; x <= rect.maxX; x++)
+		{
+			for (int z = rect.minZ; z <= rect.maxZ; z++)
+			{
+				auto iter = this->cellMap.find(MakeCellKey(x, z));
+				if (iter != this->cellMap.end())
+					visitCell(iter->second);
+			}
+		}
+	}
+
+	// A path that spans several cells gets found once in each of them.
+	std::sort(foundPathArray.begin() + firstFound, foundPathArray.end());
+	foundPathArray.erase(std::unique(foundPathArray.begin() + firstFound, foundPathArray.end()), foundPathArray.end());
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include "Math/Polygon.h"
 #include "Math/Random.h"
 #include "Reference.h"
+#include <unordered_map>
 
 namespace Imzadi
 {
@@ -39,6 +40,28 @@ namespace Imzadi
 		 */
 		bool IsValid() const;
 
+		/**
+		 * Make this graph a copy of the given graph.  Nodes and paths keep their ordinals, and each node
+		 * keeps the order of its adjacency array, so a path found in the copy is also a path in the original
+		 * (as long as the original hasn't since changed; see @ref GetVersion).
+		 */
+		void CopyFrom(const NavGraph& navGraph);
+
+		/**
+		 * Return a number that changes whenever the structure of this graph changes.
+		 */
+		uint32_t GetVersion() const { return this->version; }
+
+		/**
+		 * These are the possible states of a shortest-path search.
+		 */
+		enum SearchStatus
+		{
+			SEARCH_IN_PROGRESS,
+			SEARCH_SUCCEEDED,
+			SEARCH_FAILED
+		};
+
 		class Path;
 
 		/**
@@ -59,8 +82,7 @@ namespace Imzadi
 		public:
 			Vector3 location;
 			std::vector<Reference<Path>> adjacentPathArray;
-			mutable double distance;
-			mutable const Node* parentNode;
+			int ordinal;	///< This is the offset of this node into the graph's node array, which is how a @ref SearchContext refers to it.
 		};
 
 		/**
@@ -81,6 +103,80 @@ namespace Imzadi
 		public:
 			Reference<Node> terminalNode[2];
 			mutable double length;
+			int ordinal;	///< This is the offset of this path into the graph's path array.
+		};
+
+		/**
+		 * All the state of a shortest-path search lives here rather than in the graph,
+		 * so that any number of searches (on any number of threads) can run against the
+		 * same graph at once, as long as nobody is changing the graph at the time.  A
+		 * context is meant to be kept around and reused by its owner; it's sized to the
+		 * graph on first use, and it doesn't have to be reset between searches.
+		 */
+		class IMZADI_API SearchContext
+		{
+			friend class NavGraph;
+
+		public:
+			SearchContext();
+			virtual ~SearchContext();
+
+			/**
+			 * Free the memory held by this context.
+			 */
+			void Clear();
+
+			/**
+			 * Tell the caller how many nodes the last search had to expand before it found the goal.
+			 */
+			uint32_t GetNumNodesExpanded() const { return this->numNodesExpanded; }
+
+			/**
+			 * Tell the caller where the current (or last) search stands.
+			 */
+			SearchStatus GetStatus() const { return this->status; }
+
+		private:
+
+			/**
+			 * Get ready for a new search of a graph with the given number of nodes.
+			 */
+			void Begin(int numNodes, int startOrdinal, int goalOrdinal);
+
+			/**
+			 * Here we keep the search state of one node.  The state is stale (i.e., the node
+			 * hasn't been seen yet by the current search) unless its stamp matches ours.
+			 */
+			struct NodeState
+			{
+				double costSoFar;
+				int parentOrdinal;
+				int parentAdjacency;
+				uint32_t stamp;
+				bool closed;
+			};
+
+			/**
+			 * These go in a binary heap keyed on the estimated total cost.  A node can be in the
+			 * heap more than once; entries that no longer match the node's state are just skipped.
+			 */
+			struct OpenEntry
+			{
+				double estimatedCost;
+				double costSoFar;
+				int ordinal;
+			};
+
+			NodeState& GetNodeState(int ordinal);
+			static bool CompareOpenEntries(const OpenEntry& entryA, const OpenEntry& entryB);
+
+			std::vector<NodeState> nodeStateArray;
+			std::vector<OpenEntry> openArray;
+			uint32_t stamp;
+			uint32_t numNodesExpanded;
+			int startOrdinal;
+			int goalOrdinal;
+			SearchStatus status;
 		};
 
 		/**
@@ -165,9 +261,8 @@ namespace Imzadi
 		 * Find the node in this graph nearest the given location.
 		 * If more than one such node exists, the first found is returned,
 		 * which is really undefined since no order on the nodes is enforced.
-		 * Note that for now, we're doing a linear search here, which is
-		 * reasonable, because the number of vertices in a nav-graph should
-		 * never be so many that such a search becomes too slow.
+		 * The spatial index is used here, so only the nodes in the cells
+		 * around the given location are ever looked at.
 		 * 
 		 * @param[in] location All nodes of the graph are tested against this location.
 		 * @return A pointer to the nearest node is returned.  Don't delete it.  Null is returned if the graph is empty.
@@ -190,20 +285,100 @@ namespace Imzadi
 		 */
 		const Path* FindNearestPath(const Vector3& location, int* i = nullptr) const;
 
+		/**
+		 * This works just like the @ref FindNearestPath method, but requires
+		 * that the returned edge be within the given maximum distance.  If no
+		 * such edge exists, null is returned.
+		 */
+		const Path* FindNearestPathWithinDistance(const Vector3& location, double maxDistance, int* i = nullptr) const;
+
+		/**
+		 * Append to the given array all nodes of this graph within the given distance of the given location.
+		 */
+		void FindNodesWithinDistance(const Vector3& location, double radius, std::vector<const Node*>& foundNodeArray) const;
+
+		/**
+		 * Append to the given array all edges of this graph that pass within the given distance of the given location.
+		 */
+		void FindPathsWithinDistance(const Vector3& location, double radius, std::vector<const Path*>& foundPathArray) const;
+
+		/**
+		 * Rebuild, from scratch, the spatial index used to answer the nearest-node, nearest-path and radius
+		 * queries.  This is done for you when the graph is loaded, and the index is kept up-to-date as the
+		 * graph is modified, but it can be called to re-fit the cell size to the graph after a lot of editing.
+		 *
+		 * @param[in] cellSize This is the width and depth of each cell.  If zero, the average edge length is used.
+		 */
+		void RebuildSpatialIndex(double cellSize = 0.0);
+
+		/**
+		 * Return the width and depth of the cells of the spatial index.
+		 */
+		double GetSpatialIndexCellSize() const { return this->spatialIndex.GetCellSize(); }
+
 		/**
 		 * Find and return the shortest path between two nodes of the nav-graph
-		 * using Dijkstra's algorihm.  (There can possibly exist more than one
+		 * using the A* algorithm, with the straight-line distance to the goal as
+		 * the heuristic.  Since no path can be shorter than that, the search can
+		 * stop as soon as it reaches the goal.  (There can possibly exist more than one
 		 * path of the shortest possible length, but for now, we don't define here
 		 * which one we return.)  Note that the path is returned as a sequence of
 		 * indices (or turns, if you will) into the adjacency arrays of the nodes
 		 * of the graph, starting at the first given node.
 		 * 
+		 * This method doesn't modify the graph, so it's safe to call from several
+		 * threads at once, provided each thread uses its own search context.
+		 * 
 		 * @parma[in] nodeA This is the node where the path should start.
 		 * @param[in] nodeB This is the node where the path should end.
-		 * @param[out] pathList This will be populated with the turns made in the found path.
+		 * @param[out] pathArray This will be populated with the turns made in the found path.
+		 * @param[in,out] context This holds the state of the search.  See @ref SearchContext.
 		 * @return True is returned on success; false, otherwise.  Failure can occur here if there is no path between the two given nodes.
 		 */
-		bool FindShortestPath(const Node* nodeA, const Node* nodeB, std::list<int>& pathList) const;
+		bool FindShortestPath(const Node* nodeA, const Node* nodeB, std::vector<int>& pathArray, SearchContext& context) const;
+
+		/**
+		 * This is the same as @ref FindShortestPath, but broken up into steps, so that a long search can be spread
+		 * out over time.  Start the search with this method, then call @ref ContinueShortestPathSearch until it's done,
+		 * and then, if it succeeded, get the path with @ref GetShortestPath.  The graph must not change in the meantime.
+		 *
+		 * @return False is returned if either node isn't a member of this graph; true, otherwise.
+		 */
+		bool BeginShortestPathSearch(const Node* nodeA, const Node* nodeB, SearchContext& context) const;
+
+		/**
+		 * Carry on with the search in the given context by expanding, at most, the given number of nodes.
+		 *
+		 * @return The status of the search is returned.
+		 */
+		SearchStatus ContinueShortestPathSearch(SearchContext& context, uint32_t maxNodesToExpand) const;
+
+		/**
+		 * Get the path found by a successful search as a sequence of turns.  See @ref FindShortestPath.
+		 *
+		 * @return False is returned if the search in the given context didn't succeed; true, otherwise.
+		 */
+		bool GetShortestPath(const SearchContext& context, std::vector<int>& pathArray) const;
+
+		/**
+		 * Return the number of vertices in this graph.
+		 */
+		int GetNumNodes() const { return (int)this->nodeArray.size(); }
+
+		/**
+		 * Return the vertex of this graph having the given ordinal.
+		 */
+		const Node* GetNode(int i) const { return this->nodeArray[i].Get(); }
+
+		/**
+		 * Return the number of edges in this graph.
+		 */
+		int GetNumPaths() const { return (int)this->pathArray.size(); }
+
+		/**
+		 * Return the edge of this graph having the given ordinal.
+		 */
+		const Path* GetPath(int i) const { return this->pathArray[i].Get(); }
 
 		/**
 		 * Return a random node in the graph.
@@ -215,11 +390,65 @@ namespace Imzadi
 
 	private:
 
+		/**
+		 * This is a uniform grid over the XZ-plane that buckets the nodes and paths of the graph,
+		 * so that we only have to look at those in the cells near a location to find the ones
+		 * nearest it.  Levels are spread out mostly horizontally, so we don't bother dividing
+		 * space vertically.  Only cells that have something in them are stored.  A path is put
+		 * into every cell overlapped by its bounding box.
+		 */
+		class SpatialIndex
+		{
+		public:
+			SpatialIndex();
+			virtual ~SpatialIndex();
+
+			void Clear(double cellSize);
+			void AddNode(const Node* node);
+			void AddPath(const Path* path);
+			void RemovePath(const Path* path);
+
+			const Node* FindNearestNode(const Vector3& location, double maxDistance) const;
+			const Path* FindNearestPath(const Vector3& location, double maxDistance) const;
+			void FindNodesWithinDistance(const Vector3& location, double radius, std::vector<const Node*>& foundNodeArray) const;
+			void FindPathsWithinDistance(const Vector3& location, double radius, std::vector<const Path*>& foundPathArray) const;
+
+			double GetCellSize() const { return this->cellSize; }
+
+		private:
+
+			struct Cell
+			{
+				std::vector<const Node*> nodeArray;
+				std::vector<const Path*> pathArray;
+			};
+
+			struct CellRect
+			{
+				int minX, minZ;
+				int maxX, maxZ;
+			};
+
+			int CalcCellCoord(double x) const;
+			CellRect CalcCellRect(const Vector3& location, double radius) const;
+			CellRect CalcCellRect(const Path* path) const;
+			static uint64_t MakeCellKey(int x, int z);
+
+			template<typename CellFunc>
+			void SearchOutward(const Vector3& location, double& bestDistance, CellFunc cellFunc) const;
+
+			double cellSize;
+			std::unordered_map<uint64_t, Cell> cellMap;
+			CellRect occupiedRect;
+		};
+
 		// Note that for the memory to get freed correctly, it is
 		// not enough to just clear these arrays.  Each node and path
 		// must be cleared individually as well.  This is because we
 		// have to account for the possibility of circular references.
 		std::vector<Reference<Node>> nodeArray;
 		std::vector<Reference<Path>> pathArray;
+		SpatialIndex spatialIndex;
+		uint32_t version;
 	};
 }
\ No newline at end of file
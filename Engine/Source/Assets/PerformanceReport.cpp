@@ -0,0 +1,178 @@
+#include "PerformanceReport.h"
+#include "Log.h"
+#include <algorithm>
+#include <format>
+
+using namespace Imzadi;
+
+PerformanceReport::PerformanceReport()
+{
+	this->numFrames = 0;
+}
+
+/*virtual*/ PerformanceReport::~PerformanceReport()
+{
+}
+
+/*virtual*/ bool PerformanceReport::CanBeCached() const
+{
+	return false;
+}
+
+/*virtual*/ bool PerformanceReport::Load(const rapidjson::Document& jsonDoc, AssetCache* assetCache)
+{
+	this->Unload();
+
+	if (!jsonDoc.IsObject() || !jsonDoc.HasMember("stages") || !jsonDoc["stages"].IsObject())
+	{
+		IMZADI_LOG_ERROR("No \"stages\" member found or it's not an object.");
+		return false;
+	}
+
+	if (jsonDoc.HasMember("level") && jsonDoc["level"].IsString())
+		this->levelName = jsonDoc["level"].GetString();
+
+	if (jsonDoc.HasMember("num_frames") && jsonDoc["num_frames"].IsUint())
+		this->numFrames = jsonDoc["num_frames"].GetUint();
+
+	const rapidjson::Value& stagesValue = jsonDoc["stages"];
+	for (auto iter = stagesValue.MemberBegin(); iter != stagesValue.MemberEnd(); ++iter)
+	{
+		const rapidjson::Value& stageValue = iter->value;
+		if (!stageValue.IsObject() || !stageValue.HasMember("avg_ms") || !stageValue["avg_ms"].IsNumber())
+		{
+			IMZADI_LOG_ERROR("Stage \"%s\" is not an object or has no \"avg_ms\" member.", iter->name.GetString());
+			return false;
+		}
+
+		StageStats stats{};
+		stats.averageMilliseconds = stageValue["avg_ms"].GetDouble();
+
+		if (stageValue.HasMember("min_ms") && stageValue["min_ms"].IsNumber())
+			stats.minMilliseconds = stageValue["min_ms"].GetDouble();
+
+		if (stageValue.HasMember("max_ms") && stageValue["max_ms"].IsNumber())
+			stats.maxMilliseconds = stageValue["max_ms"].GetDouble();
+
+		if (stageValue.HasMember("p95_ms") && stageValue["p95_ms"].IsNumber())
+			stats.p95Milliseconds = stageValue["p95_ms"].GetDouble();
+
+		this->stageStatsMap.insert(std::pair<std::string, StageStats>(iter->name.GetString(), stats));
+	}
+
+	return true;
+}
+
+/*virtual*/ bool PerformanceReport::Save(rapidjson::Document& jsonDoc) const
+{
+	jsonDoc.SetObject();
+
+	jsonDoc.AddMember("level", rapidjson::Value().SetString(this->levelName.c_str(), jsonDoc.GetAllocator()), jsonDoc.GetAllocator());
+	jsonDoc.AddMember("num_frames", rapidjson::Value().SetUint(this->numFrames), jsonDoc.GetAllocator());
+
+	rapidjson::Value stagesValue;
+	stagesValue.SetObject();
+
+	for (const auto& pair : this->stageStatsMap)
+	{
+		const StageStats& stats = pair.second;
+
+		rapidjson::Value stageValue;
+		stageValue.SetObject();
+		stageValue.AddMember("avg_ms", rapidjson::Value().SetDouble(stats.averageMilliseconds), jsonDoc.GetAllocator());
+		stageValue.AddMember("min_ms", rapidjson::Value().SetDouble(stats.minMilliseconds), jsonDoc.GetAllocator());
+		stageValue.AddMember("max_ms", rapidjson::Value().SetDouble(stats.maxMilliseconds), jsonDoc.GetAllocator());
+		stageValue.AddMember("p95_ms", rapidjson::Value().SetDouble(stats.p95Milliseconds), jsonDoc.GetAllocator());
+
+		stagesValue.AddMember(rapidjson::Value().SetString(pair.first.c_str(), jsonDoc.GetAllocator()), stageValue, jsonDoc.GetAllocator());
+	}
+
+	jsonDoc.AddMember("stages", stagesValue, jsonDoc.GetAllocator());
+	return true;
+}
+
+/*virtual*/ bool PerformanceReport::Unload()
+{
+	this->levelName = "";
+	this->numFrames = 0;
+	this->stageSampleMap.clear();
+	this->stageStatsMap.clear();
+	return true;
+}
+
+void PerformanceReport::RecordFrame(const std::unordered_map<std::string, double>& stageTimeMap)
+{
+	// A stage seen for the first time took no time in all the frames before this one.
+	for (const auto& pair : stageTimeMap)
+		if (this->stageSampleMap.find(pair.first) == this->stageSampleMap.end())
+			this->stageSampleMap.insert(std::pair<std::string, std::vector<double>>(pair.first, std::vector<double>(this->numFrames, 0.0)));
+
+	for (auto& pair : this->stageSampleMap)
+	{
+		auto iter = stageTimeMap.find(pair.first);
+		pair.second.push_back((iter == stageTimeMap.end()) ? 0.0 : iter->second);
+	}
+
+	this->numFrames++;
+}
+
+void PerformanceReport::CalculateStats()
+{
+	this->stageStatsMap.clear();
+
+	for (const auto& pair : this->stageSampleMap)
+	{
+		std::vector<double> sampleArray = pair.second;
+		if (sampleArray.size() == 0)
+			continue;
+
+		std::sort(sampleArray.begin(), sampleArray.end());
+
+		StageStats stats{};
+		for (double sample : sampleArray)
+			stats.averageMilliseconds += sample;
+		stats.averageMilliseconds /= double(sampleArray.size());
+		stats.minMilliseconds = sampleArray[0];
+		stats.maxMilliseconds = sampleArray[sampleArray.size() - 1];
+		stats.p95Milliseconds = sampleArray[(sampleArray.size() - 1) * 95 / 100];
+
+		this->stageStatsMap.insert(std::pair<std::string, StageStats>(pair.first, stats));
+	}
+}
+
+bool PerformanceReport::CompareWithBaseline(const PerformanceReport* baselineReport, double tolerance, std::vector<std::string>& regressionArray) const
+{
+	bool passed = true;
+
+	for (const auto& pair : this->stageStatsMap)
+	{
+		auto iter = baselineReport->stageStatsMap.find(pair.first);
+		if (iter == baselineReport->stageStatsMap.end())
+			continue;
+
+		double averageMilliseconds = pair.second.averageMilliseconds;
+		double baselineMilliseconds = iter->second.averageMilliseconds;
+
+		if (averageMilliseconds > baselineMilliseconds * (1.0 + tolerance) && averageMilliseconds - baselineMilliseconds > MIN_REGRESSION_MILLISECONDS)
+		{
+			regressionArray.push_back(std::format("{}: {:.3f} ms, up from {:.3f} ms ({:+.1f}%)", pair.first.c_str(), averageMilliseconds, baselineMilliseconds, 100.0 * (averageMilliseconds / baselineMilliseconds - 1.0)));
+			passed = false;
+		}
+	}
+
+	return passed;
+}
+
+std::string PerformanceReport::PrintStats() const
+{
+	std::string text = std::format("Level: {}, frames: {}\n", this->levelName.c_str(), this->numFrames);
+	text += std::format("{:<32} {:>10} {:>10} {:>10} {:>10}\n", "Stage", "Avg (ms)", "Min (ms)", "P95 (ms)", "Max (ms)");
+
+	for (const auto& pair : this->stageStatsMap)
+	{
+		const StageStats& stats = pair.second;
+		text += std::format("{:<32} {:>10.3f} {:>10.3f} {:>10.3f} {:>10.3f}\n", pair.first.c_str(), stats.averageMilliseconds, stats.minMilliseconds, stats.p95Milliseconds, stats.maxMilliseconds);
+	}
+
+	return text;
+}
\ No newline at end of file
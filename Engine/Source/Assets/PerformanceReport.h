@@ -0,0 +1,76 @@
+#pragma once
+
+#include "AssetCache.h"
+#include <map>
+#include <unordered_map>
+
+namespace Imzadi
+{
+	/**
+	 * This holds the timings recorded over a headless run of a level, broken down
+	 * by stage of the frame (tick passes, collision flushes, animation, etc.)
+	 * Reports can be saved, and a later run can be checked against a saved report
+	 * to catch performance regressions.
+	 */
+	class IMZADI_API PerformanceReport : public Asset
+	{
+	public:
+		PerformanceReport();
+		virtual ~PerformanceReport();
+
+		virtual bool Load(const rapidjson::Document& jsonDoc, AssetCache* assetCache) override;
+		virtual bool Save(rapidjson::Document& jsonDoc) const override;
+		virtual bool Unload() override;
+		virtual bool CanBeCached() const override;
+
+		/**
+		 * Record how long, in milliseconds, each stage took in one frame.  A stage
+		 * not given here is taken to have taken no time in this frame.
+		 */
+		void RecordFrame(const std::unordered_map<std::string, double>& stageTimeMap);
+
+		/**
+		 * Summarize the recorded frames.  This must be called before saving or comparing.
+		 */
+		void CalculateStats();
+
+		/**
+		 * Compare the average stage times of this report against those of the given baseline report.
+		 *
+		 * @param[in] baselineReport This is typically a report saved by a previous run of the same level and input track.
+		 * @param[in] tolerance A stage regresses if it's more than this fraction slower than in the baseline.
+		 * @param[out] regressionArray A description of each regressed stage is added to this array.
+		 * @return True is returned if no stage regressed; false, otherwise.
+		 */
+		bool CompareWithBaseline(const PerformanceReport* baselineReport, double tolerance, std::vector<std::string>& regressionArray) const;
+
+		/**
+		 * Produce a human-readable table of the stats.
+		 */
+		std::string PrintStats() const;
+
+		void SetLevelName(const std::string& levelName) { this->levelName = levelName; }
+		const std::string& GetLevelName() const { return this->levelName; }
+		uint32_t GetNumFrames() const { return this->numFrames; }
+
+		/**
+		 * Stages shorter than this, in milliseconds, are never called regressions,
+		 * because at that size, the timings are mostly noise.
+		 */
+		static constexpr double MIN_REGRESSION_MILLISECONDS = 0.05;
+
+		struct StageStats
+		{
+			double averageMilliseconds;
+			double minMilliseconds;
+			double maxMilliseconds;
+			double p95Milliseconds;
+		};
+
+	private:
+		std::string levelName;
+		uint32_t numFrames;
+		std::map<std::string, std::vector<double>> stageSampleMap;
+		std::map<std::string, StageStats> stageStatsMap;
+	};
+}
\ No newline at end of file
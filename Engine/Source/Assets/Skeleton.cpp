@@ -9,7 +9,7 @@ using namespace Imzadi;
 Skeleton::Skeleton()
 {
 	this->rootBone = nullptr;
-	this->boneMapValid = false;
+	this->flattened = false;
 }
 
 /*virtual*/ Skeleton::~Skeleton()
@@ -44,8 +44,7 @@ Skeleton::Skeleton()
 		return false;
 	}
 	
-	this->UpdateCachedTransforms(BoneTransformType::BIND_POSE);
-	this->ResetCurrentPose();
+	this->FlattenBones();
 
 	return true;
 }
@@ -82,7 +81,7 @@ void Skeleton::SetRootBone(Bone* bone)
 {
 	delete this->rootBone;
 	this->rootBone = bone;
-	this->boneMapValid = false;
+	this->InvalidateFlattenedBones();
 }
 
 bool Skeleton::ChopRoot()
@@ -99,91 +98,209 @@ bool Skeleton::ChopRoot()
 	this->rootBone->ClearChildBonesWithoutDelete();
 	delete this->rootBone;
 	this->rootBone = childBone;
+	this->InvalidateFlattenedBones();
 	return true;
 }
 
-void Skeleton::InvalidateBoneMap() const
+void Skeleton::InvalidateFlattenedBones() const
 {
-	this->boneMapValid = false;
+	this->flattened = false;
 }
 
-Bone* Skeleton::FindBone(const std::string& name)
+void Skeleton::EnsureFlattened() const
+{
+	if (!this->flattened)
+		const_cast<Skeleton*>(this)->FlattenBones();
+}
+
+void Skeleton::FlattenBones()
 {
+	this->boneArray.clear();
+	this->parentIndexArray.clear();
+	this->boneDepthArray.clear();
+	this->boneIndexMap.clear();
+	this->flattened = true;
+
 	if (!this->rootBone)
-		return nullptr;
+		return;
 
-	if (!this->boneMapValid)
+	// A breadth-first traversal of the tree guarantees that every parent lands
+	// in the array before any of its children, which is all we need for a single
+	// linear pass to propagate transforms from the root outward.
+	std::unordered_map<const Bone*, int> indexMap;
+	this->boneArray.push_back(this->rootBone);
+	for (int i = 0; i < (int)this->boneArray.size(); i++)
 	{
-		this->boneMap.clear();
-		this->rootBone->PopulateBoneMap(this->boneMap);
-		this->boneMapValid = true;
+		Bone* bone = this->boneArray[i];
+		indexMap.insert(std::pair<const Bone*, int>(bone, i));
+		this->boneIndexMap.insert(std::pair<std::string, int>(bone->GetName(), i));
+
+		int parentIndex = -1;
+		if (bone->GetParentBone())
+		{
+			auto iter = indexMap.find(bone->GetParentBone());
+			IMZADI_ASSERT(iter != indexMap.end());
+			parentIndex = iter->second;
+		}
+
+		this->parentIndexArray.push_back(parentIndex);
+		this->boneDepthArray.push_back(parentIndex >= 0 ? this->boneDepthArray[parentIndex] + 1 : 0);
+
+		for (int j = 0; j < (int)bone->GetNumChildBones(); j++)
+			this->boneArray.push_back(bone->GetChildBone(j));
 	}
 
-	BoneMap::iterator iter = this->boneMap.find(name);
-	if (iter == this->boneMap.end())
-		return nullptr;
+	size_t numBones = this->boneArray.size();
+
+	this->bindPose.childToParentArray.resize(numBones);
+	this->bindPose.boneToObjectArray.resize(numBones);
+	this->currentPose.childToParentArray.resize(numBones);
+	this->currentPose.boneToObjectArray.resize(numBones);
+	this->bindPoseObjectToBoneArray.resize(numBones);
+
+	for (int i = 0; i < (int)numBones; i++)
+		this->bindPose.childToParentArray[i] = this->boneArray[i]->GetBindPoseChildToParent();
+
+	this->UpdateCachedTransforms(BoneTransformType::BIND_POSE);
+	this->ResetCurrentPose();
+	this->UpdateCachedTransforms(BoneTransformType::CURRENT_POSE);
+}
+
+size_t Skeleton::GetNumBones() const
+{
+	this->EnsureFlattened();
+	return this->boneArray.size();
+}
+
+Skeleton::Pose* Skeleton::GetPose(BoneTransformType transformType)
+{
+	switch (transformType)
+	{
+	case BoneTransformType::BIND_POSE:
+		return &this->bindPose;
+	case BoneTransformType::CURRENT_POSE:
+		return &this->currentPose;
+	}
+
+	return nullptr;
+}
+
+const Skeleton::Pose* Skeleton::GetPose(BoneTransformType transformType) const
+{
+	return const_cast<Skeleton*>(this)->GetPose(transformType);
+}
+
+int Skeleton::FindBoneIndex(const std::string& name) const
+{
+	this->EnsureFlattened();
+
+	BoneIndexMap::const_iterator iter = this->boneIndexMap.find(name);
+	if (iter == this->boneIndexMap.end())
+		return -1;
 
 	return iter->second;
 }
 
+Bone* Skeleton::FindBone(const std::string& name)
+{
+	int boneIndex = this->FindBoneIndex(name);
+	if (boneIndex < 0)
+		return nullptr;
+
+	return this->boneArray[boneIndex];
+}
+
 const Bone* Skeleton::FindBone(const std::string& name) const
 {
 	return const_cast<Skeleton*>(this)->FindBone(name);
 }
 
-void Skeleton::DebugDraw(BoneTransformType transformType, const Transform& objectToWorld) const
+void Skeleton::DebugDraw(BoneTransformType transformType, const Transform& objectToWorld)
 {
-	if (this->rootBone)
+	DebugLines* debugLines = Game::Get()->GetDebugLines();
+	if (!debugLines)
+		return;
+
+	this->UpdateCachedTransforms(transformType);
+
+	const Pose* pose = this->GetPose(transformType);
+
+	DebugLines::Line line;
+	line.color.SetComponents(0.5, 0.5, 0.5);
+
+	for (int i = 0; i < (int)this->boneArray.size(); i++)
 	{
-		this->UpdateCachedTransforms(transformType);
-		this->rootBone->DebugDraw(transformType, objectToWorld);
+		int parentIndex = this->parentIndexArray[i];
+		line.segment.point[0] = pose->boneToObjectArray[i].translation;
+		line.segment.point[1] = (parentIndex >= 0) ? pose->boneToObjectArray[parentIndex].translation : Vector3(0.0, 0.0, 0.0);
+		line.segment = objectToWorld.TransformLineSegment(line.segment);
+		debugLines->AddLine(line);
 	}
 }
 
-void Skeleton::UpdateCachedTransforms(BoneTransformType transformType) const
+bool Skeleton::UpdateCachedTransforms(BoneTransformType transformType)
 {
-	if (this->rootBone)
-		const_cast<Bone*>(this->rootBone)->UpdateCachedTransforms(transformType);
+	this->EnsureFlattened();
+
+	Pose* pose = this->GetPose(transformType);
+	size_t numBones = this->boneArray.size();
+
+	const int* parentIndex = this->parentIndexArray.data();
+	const Transform* childToParent = pose->childToParentArray.data();
+	Transform* boneToObject = pose->boneToObjectArray.data();
+
+	for (size_t i = 0; i < numBones; i++)
+	{
+		if (parentIndex[i] < 0)
+			boneToObject[i] = childToParent[i];
+		else
+			boneToObject[i] = boneToObject[parentIndex[i]] * childToParent[i];
+	}
+
+	if (transformType == BoneTransformType::BIND_POSE)
+	{
+		for (size_t i = 0; i < numBones; i++)
+		{
+			if (!this->bindPoseObjectToBoneArray[i].Invert(boneToObject[i]))
+			{
+				IMZADI_LOG_ERROR("Failed to invert bind-pose transform of bone \"%s\".", this->boneArray[i]->GetName().c_str());
+				return false;
+			}
+		}
+	}
+
+	return true;
 }
 
 void Skeleton::ResetCurrentPose()
 {
-	std::vector<Bone*> boneArray;
-	if (this->GatherBones(boneArray))
-		for (Bone* bone : boneArray)
-			bone->SetCurrentPoseChildToParent(bone->GetBindPoseChildToParent());
+	this->EnsureFlattened();
+	this->currentPose.childToParentArray = this->bindPose.childToParentArray;
 }
 
 bool Skeleton::GatherBones(std::vector<Bone*>& boneArray)
 {
-	if (!this->rootBone)
+	this->EnsureFlattened();
+	if (this->boneArray.size() == 0)
 		return false;
 
-	boneArray.clear();
-	std::list<Bone*> boneQueue;
-	boneQueue.push_back(this->rootBone);
-	while (boneQueue.size() > 0)
-	{
-		Bone* bone = boneQueue.front();
-		boneQueue.pop_front();
-
-		for (int i = 0; i < bone->GetNumChildBones(); i++)
-			boneQueue.push_back(bone->GetChildBone(i));
-
-		boneArray.push_back(bone);
-	}
-
+	boneArray = this->boneArray;
 	return true;
 }
 
-bool Skeleton::GatherBones(const Vector3& position, BoneTransformType boneTransformType, std::vector<Bone*>& boneArray)
+bool Skeleton::GatherBones(const Vector3& position, BoneTransformType boneTransformType, std::vector<int>& boneIndexArray)
 {
-	if (!this->GatherBones(boneArray))
+	this->EnsureFlattened();
+	if (this->boneArray.size() == 0)
 		return false;
 
-	std::sort(boneArray.begin(), boneArray.end(), [&position, boneTransformType](const Bone* boneA, const Bone* boneB) -> bool {
-		const Vector3& centerA = boneA->CalcObjectSpaceCenter(boneTransformType);
-		const Vector3& centerB = boneB->CalcObjectSpaceCenter(boneTransformType);
+	boneIndexArray.resize(this->boneArray.size());
+	for (int i = 0; i < (int)boneIndexArray.size(); i++)
+		boneIndexArray[i] = i;
+
+	std::sort(boneIndexArray.begin(), boneIndexArray.end(), [this, &position, boneTransformType](int boneIndexA, int boneIndexB) -> bool {
+		const Vector3& centerA = this->CalcBoneObjectSpaceCenter(boneTransformType, boneIndexA);
+		const Vector3& centerB = this->CalcBoneObjectSpaceCenter(boneTransformType, boneIndexB);
 		double distanceA = (position - centerA).Length();
 		double distanceB = (position - centerB).Length();
 		return distanceA < distanceB;
@@ -192,14 +309,25 @@ bool Skeleton::GatherBones(const Vector3& position, BoneTransformType boneTransf
 	return true;
 }
 
+Vector3 Skeleton::CalcBoneObjectSpaceCenter(BoneTransformType transformType, int boneIndex) const
+{
+	const Pose* pose = this->GetPose(transformType);
+	int parentIndex = this->parentIndexArray[boneIndex];
+	const Transform& childToParent = pose->childToParentArray[boneIndex];
+
+	if (parentIndex >= 0)
+		return pose->boneToObjectArray[parentIndex].TransformPoint(childToParent.translation / 2.0);
+
+	return childToParent.translation / 2.0;
+}
+
 //-------------------------------- Bone --------------------------------
 
 Bone::Bone()
 {
 	this->canBeWeightedAgainst = true;
 	this->parentBone = nullptr;
-	this->bindPose.childToParent.SetIdentity();
-	this->currentPose.childToParent.SetIdentity();
+	this->bindPoseChildToParent.SetIdentity();
 }
 
 /*virtual*/ Bone::~Bone()
@@ -223,7 +351,7 @@ bool Bone::Load(const rapidjson::Value& boneValue)
 		return false;
 	}
 
-	if (!Asset::LoadTransform(boneValue["bind_pose_child_to_parent"], this->bindPose.childToParent))
+	if (!Asset::LoadTransform(boneValue["bind_pose_child_to_parent"], this->bindPoseChildToParent))
 	{
 		IMZADI_LOG_ERROR("Failed to load transform from member \"bind_pose_child_to_parent\".");
 		return false;
@@ -261,7 +389,7 @@ bool Bone::Load(const rapidjson::Value& boneValue)
 bool Bone::Save(rapidjson::Value& boneValue, rapidjson::Document* doc) const
 {
 	rapidjson::Value bindPoseChildToParentValue;
-	Asset::SaveTransform(bindPoseChildToParentValue, this->bindPose.childToParent, doc);
+	Asset::SaveTransform(bindPoseChildToParentValue, this->bindPoseChildToParent, doc);
 
 	boneValue.SetObject();
 	boneValue.AddMember("name", rapidjson::Value().SetString(this->name.c_str(), doc->GetAllocator()), doc->GetAllocator());
@@ -302,105 +430,4 @@ void Bone::DeleteAllChildBones()
 void Bone::ClearChildBonesWithoutDelete()
 {
 	this->childBoneArray.clear();
-}
-
-const Bone::Transforms* Bone::GetTransforms(BoneTransformType transformType) const
-{
-	return const_cast<Bone*>(this)->GetTransforms(transformType);
-}
-
-Bone::Transforms* Bone::GetTransforms(BoneTransformType transformType)
-{
-	switch (transformType)
-	{
-	case BoneTransformType::BIND_POSE:
-		return &this->bindPose;
-	case BoneTransformType::CURRENT_POSE:
-		return &this->currentPose;
-	}
-
-	return nullptr;
-}
-
-void Bone::UpdateCachedTransforms(BoneTransformType transformType)
-{
-	const Transforms* parentTransforms = this->parentBone ? this->parentBone->GetTransforms(transformType) : nullptr;
-	Transforms* transforms = this->GetTransforms(transformType);
-
-	if (!parentTransforms)
-		transforms->boneToObject = transforms->childToParent;
-	else
-		transforms->boneToObject = parentTransforms->boneToObject * transforms->childToParent;
-	
-	bool inverted = transforms->objectToBone.Invert(transforms->boneToObject);
-	assert(inverted);
-
-	for (Bone* childBone : this->childBoneArray)
-		childBone->UpdateCachedTransforms(transformType);
-}
-
-Vector3 Bone::CalcObjectSpaceCenter(BoneTransformType transformType) const
-{
-	const Transforms* parentTransforms = this->parentBone ? this->parentBone->GetTransforms(transformType) : nullptr;
-	const Transforms* transforms = this->GetTransforms(transformType);
-
-	if(parentTransforms)
-		return parentTransforms->boneToObject.TransformPoint(transforms->childToParent.translation / 2.0);
-
-	return transforms->childToParent.translation / 2.0;
-}
-
-void Bone::PopulateBoneMap(BoneMap& boneMap) const
-{
-	boneMap.insert(std::pair<std::string, Bone*>(this->name, const_cast<Bone*>(this)));
-
-	for (Bone* childBone : this->childBoneArray)
-		childBone->PopulateBoneMap(boneMap);
-}
-
-void Bone::DebugDraw(BoneTransformType transformType, const Transform& objectToWorld) const
-{
-	DebugLines* debugLines = Game::Get()->GetDebugLines();
-	if (!debugLines)
-		return;
-
-	const Transforms* transforms = this->GetTransforms(transformType);
-
-	Vector3 origin = transforms->boneToObject.TransformPoint(Vector3(0.0, 0.0, 0.0));
-	Vector3 xAxis = transforms->boneToObject.TransformVector(Vector3(0.1, 0.0, 0.0));
-	Vector3 yAxis = transforms->boneToObject.TransformVector(Vector3(0.0, 0.1, 0.0));
-	Vector3 zAxis = transforms->boneToObject.TransformVector(Vector3(0.0, 0.0, 0.1));
-
-	DebugLines::Line line;
-	
-#if 0		// Can't really draw these anymore, because 3Ds Max, for reasons that are beyond me, introduces a crap-load of scale into the matrices.
-	line.color.SetComponents(1.0, 0.0, 0.0);
-	line.segment.point[0] = origin;
-	line.segment.point[1] = origin + xAxis;
-	line.segment = objectToWorld.TransformLineSegment(line.segment);
-	debugLines->AddLine(line);
-
-	line.color.SetComponents(0.0, 1.0, 0.0);
-	line.segment.point[0] = origin;
-	line.segment.point[1] = origin + yAxis;
-	line.segment = objectToWorld.TransformLineSegment(line.segment);
-	debugLines->AddLine(line);
-
-	line.color.SetComponents(0.0, 0.0, 1.0);
-	line.segment.point[0] = origin;
-	line.segment.point[1] = origin + zAxis;
-	line.segment = objectToWorld.TransformLineSegment(line.segment);
-	debugLines->AddLine(line);
-#endif
-
-	const Transforms* parentTransforms = this->parentBone ? this->parentBone->GetTransforms(transformType) : nullptr;
-
-	line.color.SetComponents(0.5, 0.5, 0.5);
-	line.segment.point[0] = origin;
-	line.segment.point[1] = parentTransforms ? parentTransforms->boneToObject.translation : Vector3(0.0, 0.0, 0.0);
-	line.segment = objectToWorld.TransformLineSegment(line.segment);
-	debugLines->AddLine(line);
-
-	for (const Bone* childBone : this->childBoneArray)
-		childBone->DebugDraw(transformType, objectToWorld);
 }
\ No newline at end of file
@@ -10,8 +10,6 @@ namespace Imzadi
 	class Bone;
 	class KeyFrame;
 
-	typedef std::unordered_map<std::string, Bone*> BoneMap;
-
 	enum BoneTransformType
 	{
 		BIND_POSE,
@@ -42,43 +40,118 @@ namespace Imzadi
 		Bone* GetRootBone() { return this->rootBone; }
 		const Bone* GetRootBone() const { return this->rootBone; }
 
+		/**
+		 * Find a bone of the bone tree by name.  This is meant for load-time and
+		 * tool-time use only.  At run-time, bones should be referred to by index.
+		 */
 		Bone* FindBone(const std::string& name);
 		const Bone* FindBone(const std::string& name) const;
-		void InvalidateBoneMap() const;
 
+		/**
+		 * Find the index of the named bone in the flattened skeleton.  Again, this
+		 * is meant for load-time use only, where names can be resolved once into
+		 * indices that are then used every frame.
+		 *
+		 * @return The bone's index is returned, or -1 if the bone is not found.
+		 */
+		int FindBoneIndex(const std::string& name) const;
+
+		/**
+		 * Call this if the bone tree has been changed in any way so that the
+		 * flattened representation of the skeleton gets rebuilt from the tree.
+		 * SetRootBone() and ChopRoot() do this for you, but bones don't know what
+		 * skeleton they're in, so anyone editing the tree through Bone, such as by
+		 * Bone::AddChildBone(), must call this once they're done.
+		 */
+		void InvalidateFlattenedBones() const;
+
+		/**
+		 * Gather all bones of the skeleton into the given array.  The order of the
+		 * array is the same as that of the flattened skeleton; namely, parents
+		 * always come before their children.
+		 */
 		bool GatherBones(std::vector<Bone*>& boneArray);
 
 		/**
-		 * Gather all bones of the skeleton into the given array, but order
+		 * Gather the indices of all bones of the skeleton into the given array, but order
 		 * them closest to furthest from the given position.
 		 *
 		 * @param[in] position Bones are sorted based on distance to this point from the bone centers.
 		 * @param[in] boneTransformType Are we looking at the bind pose or the current pose?
-		 * @param[out] boneArray The sorted list of bones is returned in this array.
+		 * @param[out] boneIndexArray The sorted list of bone indices is returned in this array.
 		 * @return False is returned if there are no bones to return; true, otherwise.
 		 */
-		bool GatherBones(const Vector3& position, BoneTransformType boneTransformType, std::vector<Bone*>& boneArray);
+		bool GatherBones(const Vector3& position, BoneTransformType boneTransformType, std::vector<int>& boneIndexArray);
 
 		/**
 		 * Update all internally-cached transforms that are a function of our single-source-of-truth transforms.
 		 * This must be called after posing a skeleton and before using it to deform a mesh.
+		 * This is a single linear pass over the flattened skeleton.  Inverses are only
+		 * calculated for the bind-pose, since that's all that skinning needs.
+		 *
+		 * @return False is returned if a bind-pose transform could not be inverted; true, otherwise.
 		 */
-		void UpdateCachedTransforms(BoneTransformType transformType) const;
+		bool UpdateCachedTransforms(BoneTransformType transformType);
 
 		/**
 		 * Reset the current pose to the bind pose.
 		 */
 		void ResetCurrentPose();
 
-		void DebugDraw(BoneTransformType transformType, const Transform& objectToWorld) const;
+		void DebugDraw(BoneTransformType transformType, const Transform& objectToWorld);
 
 		bool ChopRoot();
 
+		/**
+		 * Return the number of bones in the flattened skeleton.
+		 */
+		size_t GetNumBones() const;
+
+		// The following accessors assume the skeleton is already flattened, which
+		// will be the case once it is loaded, or once any of the above methods that
+		// return bone indices or counts has been called.  No bounds check is performed!
+
+		Bone* GetBone(int boneIndex) { return this->boneArray[boneIndex]; }
+		const Bone* GetBone(int boneIndex) const { return this->boneArray[boneIndex]; }
+		int GetParentBoneIndex(int boneIndex) const { return this->parentIndexArray[boneIndex]; }
+		int GetBoneDepth(int boneIndex) const { return this->boneDepthArray[boneIndex]; }
+
+		void SetCurrentPoseChildToParent(int boneIndex, const Transform& childToParent) { this->currentPose.childToParentArray[boneIndex] = childToParent; }
+		const Transform& GetChildToParent(BoneTransformType transformType, int boneIndex) const { return this->GetPose(transformType)->childToParentArray[boneIndex]; }
+		const Transform& GetBoneToObject(BoneTransformType transformType, int boneIndex) const { return this->GetPose(transformType)->boneToObjectArray[boneIndex]; }
+		const Transform& GetBindPoseObjectToBone(int boneIndex) const { return this->bindPoseObjectToBoneArray[boneIndex]; }
+
+		Vector3 CalcBoneObjectSpaceCenter(BoneTransformType transformType, int boneIndex) const;
+
 	private:
+
+		/**
+		 * These are contiguous arrays of transforms for a pose of the skeleton,
+		 * indexed in the same way as our flattened bone array.
+		 */
+		struct Pose
+		{
+			std::vector<Transform> childToParentArray;
+			std::vector<Transform> boneToObjectArray;
+		};
+
+		Pose* GetPose(BoneTransformType transformType);
+		const Pose* GetPose(BoneTransformType transformType) const;
+
+		void FlattenBones();
+		void EnsureFlattened() const;
+
 		Bone* rootBone;
 
-		mutable BoneMap boneMap;
-		mutable bool boneMapValid;
+		std::vector<Bone*> boneArray;
+		std::vector<int> parentIndexArray;
+		std::vector<int> boneDepthArray;
+		Pose bindPose;
+		Pose currentPose;
+		std::vector<Transform> bindPoseObjectToBoneArray;
+		typedef std::unordered_map<std::string, int> BoneIndexMap;
+		BoneIndexMap boneIndexMap;
+		mutable bool flattened;
 	};
 
 	/**
@@ -88,6 +161,10 @@ namespace Imzadi
 	 * tree is a hierarchy of spaces.  A child's transform is relative
 	 * to its parent, so to get the space of a node you must concatinate
 	 * transforms from the root of the tree to the node in question.
+	 *
+	 * Note that the bone tree is the authored (and saved) form of the skeleton.
+	 * At run-time, the skeleton is posed and its transforms calculated using a
+	 * flattened form of the tree that is owned by the skeleton.
 	 */
 	class IMZADI_API Bone
 	{
@@ -111,40 +188,18 @@ namespace Imzadi
 		void SetWeightable(bool weightable) { this->canBeWeightedAgainst = weightable; }
 		bool GetWeightable() const { return this->canBeWeightedAgainst; }
 
-		void SetBindPoseChildToParent(const Transform& childToParent) { this->bindPose.childToParent = childToParent; }
-		const Transform& GetBindPoseChildToParent() const { return this->bindPose.childToParent; }
-
-		void SetCurrentPoseChildToParent(const Transform& childToParent) { this->currentPose.childToParent = childToParent; }
-		const Transform& GetCurrentPoseChildToParent() { return this->currentPose.childToParent; }
-
-		void UpdateCachedTransforms(BoneTransformType transformType);
-
-		void PopulateBoneMap(BoneMap& boneMap) const;
-
-		void DebugDraw(BoneTransformType transformType, const Transform& objectToWorld) const;
+		void SetBindPoseChildToParent(const Transform& childToParent) { this->bindPoseChildToParent = childToParent; }
+		const Transform& GetBindPoseChildToParent() const { return this->bindPoseChildToParent; }
 
 		bool Load(const rapidjson::Value& boneValue);
 		bool Save(rapidjson::Value& boneValue, rapidjson::Document* doc) const;
 
-		Imzadi::Vector3 CalcObjectSpaceCenter(BoneTransformType transformType) const;
-
-		struct Transforms
-		{
-			Transform childToParent;
-			Transform boneToObject;
-			Transform objectToBone;
-		};
-
-		Transforms* GetTransforms(BoneTransformType transformType);
-		const Transforms* GetTransforms(BoneTransformType transformType) const;
-
 	private:
 
 		std::string name;
 		Bone* parentBone;
 		std::vector<Bone*> childBoneArray;
-		Transforms bindPose;
-		Transforms currentPose;
+		Transform bindPoseChildToParent;
 		bool canBeWeightedAgainst;
 	};
 }
\ No newline at end of file
@@ -154,7 +154,8 @@ bool SkinWeights::AutoSkin(const Skeleton* skeleton, const BareBuffer* bindPoseV
 	if (vertexOffset + 3 * sizeof(float) > elementStride)
 		return false;
 
-	skeleton->UpdateCachedTransforms(BoneTransformType::BIND_POSE);
+	if (!const_cast<Skeleton*>(skeleton)->UpdateCachedTransforms(BoneTransformType::BIND_POSE))
+		return false;
 
 	this->Clear();
 
@@ -168,21 +169,22 @@ bool SkinWeights::AutoSkin(const Skeleton* skeleton, const BareBuffer* bindPoseV
 		position.y = *positionBuffer++;
 		position.z = *positionBuffer++;
 
-		std::vector<Bone*> boneArray;
-		if (!const_cast<Skeleton*>(skeleton)->GatherBones(position, BoneTransformType::BIND_POSE, boneArray))
+		std::vector<int> boneIndexArray;
+		if (!const_cast<Skeleton*>(skeleton)->GatherBones(position, BoneTransformType::BIND_POSE, boneIndexArray))
 			return false;
 
-		if (boneArray.size() == 0)
+		if (boneIndexArray.size() == 0)
 			return false;
 
 		std::vector<BoneWeight> boneWeightArray;
 
-		for (const Bone* bone : boneArray)
+		for (int boneIndex : boneIndexArray)
 		{
+			const Bone* bone = skeleton->GetBone(boneIndex);
 			if (!bone->GetWeightable())
 				continue;
 
-			double distance = (position - bone->CalcObjectSpaceCenter(BoneTransformType::BIND_POSE)).Length();
+			double distance = (position - skeleton->CalcBoneObjectSpaceCenter(BoneTransformType::BIND_POSE, boneIndex)).Length();
 			BoneWeight boneWeight;
 			boneWeight.weight = radius - distance;
 			boneWeight.boneName = bone->GetName();
@@ -197,8 +199,9 @@ bool SkinWeights::AutoSkin(const Skeleton* skeleton, const BareBuffer* bindPoseV
 		else
 		{
 			const Bone* foundBone = nullptr;
-			for (const Bone* bone : boneArray)
+			for (int boneIndex : boneIndexArray)
 			{
+				const Bone* bone = skeleton->GetBone(boneIndex);
 				if (bone->GetWeightable())
 				{
 					foundBone = bone;
@@ -4,6 +4,7 @@
 #include "SkinWeights.h"
 #include "Game.h"
 #include "Log.h"
+#include <math.h>
 
 using namespace Imzadi;
 
@@ -96,6 +97,12 @@ SkinnedRenderMesh::SkinnedRenderMesh()
 
 	this->normalOffset = jsonDoc["normal_offset"].GetInt();
 
+	if (!this->BindSkinWeights())
+	{
+		IMZADI_LOG_ERROR("Failed to bind skin-weights to skeleton.");
+		return false;
+	}
+
 	uint32_t strideBytes = this->vertexBuffer->GetStride();
 
 	if (this->positionOffset + 3 * sizeof(float) > strideBytes)
@@ -113,6 +120,7 @@ SkinnedRenderMesh::SkinnedRenderMesh()
 	if (jsonDoc.HasMember("animations") && jsonDoc["animations"].IsArray())
 	{
 		this->animationMap.clear();
+		this->boneBindingMap.clear();
 
 		const rapidjson::Value& animationsArrayValue = jsonDoc["animations"];
 		for (int i = 0; i < animationsArrayValue.Size(); i++)
@@ -145,7 +153,15 @@ SkinnedRenderMesh::SkinnedRenderMesh()
 				return false;
 			}
 
+			BoneBinding boneBinding;
+			if (!animation->BindToSkeleton(this->skeleton.Get(), boneBinding))
+			{
+				IMZADI_LOG_ERROR(std::format("Failed to bind animation \"{}\" to skeleton.", animation->GetName().c_str()));
+				return false;
+			}
+
 			this->animationMap.insert(std::pair<std::string, Reference<Animation>>(animation->GetName(), animation));
+			this->boneBindingMap.insert(std::pair<std::string, BoneBinding>(animation->GetName(), boneBinding));
 		}
 	}
 
@@ -158,9 +174,15 @@ SkinnedRenderMesh::SkinnedRenderMesh()
 
 	this->bindPoseVertices.Reset();
 	this->currentPoseVertices.Reset();
+	this->sourcePoseVertices.Reset();
+	this->targetPoseVertices.Reset();
 	this->skeleton.Reset();
 	this->skinWeights.Reset();
 	this->animationMap.clear();
+	this->boneBindingMap.clear();
+	this->vertexWeightOffsetArray.clear();
+	this->vertexWeightArray.clear();
+	this->skinningTransformArray.clear();
 
 	return true;
 }
@@ -172,17 +194,121 @@ void SkinnedRenderMesh::GetAnimationNames(std::unordered_set<std::string>& anima
 		animationNameSet.insert(pair.first);
 }
 
+bool SkinnedRenderMesh::BindSkinWeights()
+{
+	uint32_t numVertices = this->vertexBuffer->GetNumElements();
+	if (this->skinWeights->GetNumVertices() < numVertices)
+	{
+		IMZADI_LOG_ERROR(std::format("Skin-weights cover {} vertices, but the mesh has {}.", this->skinWeights->GetNumVertices(), numVertices));
+		return false;
+	}
+
+	this->vertexWeightOffsetArray.clear();
+	this->vertexWeightArray.clear();
+
+	for (uint32_t i = 0; i < numVertices; i++)
+	{
+		this->vertexWeightOffsetArray.push_back(uint32_t(this->vertexWeightArray.size()));
+
+		const std::vector<SkinWeights::BoneWeight>& boneWeightArray = this->skinWeights->GetBoneWeightsForVertex(i);
+		for (const SkinWeights::BoneWeight& boneWeight : boneWeightArray)
+		{
+			SkinningWeight skinningWeight;
+			skinningWeight.boneIndex = this->skeleton->FindBoneIndex(boneWeight.boneName);
+			skinningWeight.weight = boneWeight.weight;
+			if (skinningWeight.boneIndex < 0)
+			{
+				IMZADI_LOG_ERROR(std::format("Vertex {} is weighted to bone \"{}\", which is not in the skeleton.", i, boneWeight.boneName.c_str()));
+				return false;
+			}
+
+			this->vertexWeightArray.push_back(skinningWeight);
+		}
+	}
+
+	this->vertexWeightOffsetArray.push_back(uint32_t(this->vertexWeightArray.size()));
+	this->skinningTransformArray.resize(this->skeleton->GetNumBones());
+	return true;
+}
+
 void SkinnedRenderMesh::DeformMesh()
 {
+	this->SkinVertices(this->currentPoseVertices->GetBuffer());
+	this->UploadVertices();
+}
+
+void SkinnedRenderMesh::DeformMeshForBlending()
+{
+	if (!this->sourcePoseVertices)
+		this->sourcePoseVertices.Set(this->currentPoseVertices->Clone());
+	else
+		::memcpy(this->sourcePoseVertices->GetBuffer(), this->currentPoseVertices->GetBuffer(), this->currentPoseVertices->GetSize());
+
+	if (!this->targetPoseVertices)
+		this->targetPoseVertices.Set(this->currentPoseVertices->Clone());
+
+	this->SkinVertices(this->targetPoseVertices->GetBuffer());
+}
+
+void SkinnedRenderMesh::BlendDeformedMesh(double alpha)
+{
+	if (!this->sourcePoseVertices || !this->targetPoseVertices)
+		return;
+
 	uint32_t numVertices = this->vertexBuffer->GetNumElements();
 	uint32_t strideBytes = this->vertexBuffer->GetStride();
-	BYTE* bindPoseBuffer = this->bindPoseVertices->GetBuffer();
+	const BYTE* sourcePoseBuffer = this->sourcePoseVertices->GetBuffer();
+	const BYTE* targetPoseBuffer = this->targetPoseVertices->GetBuffer();
 	BYTE* currentPoseBuffer = this->currentPoseVertices->GetBuffer();
+	float blend = float(alpha);
 
 	for (uint32_t i = 0; i < numVertices; i++)
 	{
-		const std::vector<SkinWeights::BoneWeight>& boneWeightArray = this->skinWeights->GetBoneWeightsForVertex(i);
+		const float* sourcePosition = (const float*)&sourcePoseBuffer[i * strideBytes + this->positionOffset];
+		const float* targetPosition = (const float*)&targetPoseBuffer[i * strideBytes + this->positionOffset];
+		float* currentPosition = (float*)&currentPoseBuffer[i * strideBytes + this->positionOffset];
+
+		const float* sourceNormal = (const float*)&sourcePoseBuffer[i * strideBytes + this->normalOffset];
+		const float* targetNormal = (const float*)&targetPoseBuffer[i * strideBytes + this->normalOffset];
+		float* currentNormal = (float*)&currentPoseBuffer[i * strideBytes + this->normalOffset];
+
+		float normal[3];
+		for (int j = 0; j < 3; j++)
+		{
+			currentPosition[j] = sourcePosition[j] + (targetPosition[j] - sourcePosition[j]) * blend;
+			normal[j] = sourceNormal[j] + (targetNormal[j] - sourceNormal[j]) * blend;
+		}
+
+		float length = ::sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length > 0.0f)
+		{
+			for (int j = 0; j < 3; j++)
+				currentNormal[j] = normal[j] / length;
+		}
+		else
+		{
+			for (int j = 0; j < 3; j++)
+				currentNormal[j] = targetNormal[j];
+		}
+	}
+
+	this->UploadVertices();
+}
 
+void SkinnedRenderMesh::SkinVertices(BYTE* poseBuffer)
+{
+	uint32_t numVertices = this->vertexBuffer->GetNumElements();
+	uint32_t strideBytes = this->vertexBuffer->GetStride();
+	BYTE* bindPoseBuffer = this->bindPoseVertices->GetBuffer();
+	BYTE* currentPoseBuffer = poseBuffer;
+
+	// Concatinate the bind-pose inverse with the current pose just once per bone
+	// rather than once per vertex weight.
+	for (int i = 0; i < (int)this->skinningTransformArray.size(); i++)
+		this->skinningTransformArray[i] = this->skeleton->GetBoneToObject(BoneTransformType::CURRENT_POSE, i) * this->skeleton->GetBindPoseObjectToBone(i);
+
+	for (uint32_t i = 0; i < numVertices; i++)
+	{
 		const float* bindPosePositionBuffer = (float*)&bindPoseBuffer[i * strideBytes + this->positionOffset];
 		float* currentPosePositionBuffer = (float*)&currentPoseBuffer[i * strideBytes + this->positionOffset];
 
@@ -202,23 +328,13 @@ void SkinnedRenderMesh::DeformMesh()
 		Vector3 currentPosePosition(0.0, 0.0, 0.0);
 		Vector3 currentPoseNormal(0.0, 0.0, 0.0);
 
-		for (uint32_t j = 0; j < boneWeightArray.size(); j++)
+		for (uint32_t j = this->vertexWeightOffsetArray[i]; j < this->vertexWeightOffsetArray[i + 1]; j++)
 		{
-			const SkinWeights::BoneWeight& boneWeight = boneWeightArray[j];
-			const Bone* bone = this->skeleton->FindBone(boneWeight.boneName);
-			assert(bone != nullptr);
-
-			const Bone::Transforms* bindPoseTransforms = bone->GetTransforms(BoneTransformType::BIND_POSE);
-			const Bone::Transforms* currentPoseTransforms = bone->GetTransforms(BoneTransformType::CURRENT_POSE);
+			const SkinningWeight& skinningWeight = this->vertexWeightArray[j];
+			const Transform& skinningTransform = this->skinningTransformArray[skinningWeight.boneIndex];
 
-			Vector3 skinPoint = bindPoseTransforms->objectToBone.TransformPoint(bindPosePosition);
-			skinPoint = currentPoseTransforms->boneToObject.TransformPoint(skinPoint);
-
-			Vector3 skinNormal = bindPoseTransforms->objectToBone.TransformVector(bindPoseNormal);
-			skinNormal = currentPoseTransforms->boneToObject.TransformVector(skinNormal);
-			
-			currentPosePosition += skinPoint * boneWeight.weight;
-			currentPoseNormal += skinNormal * boneWeight.weight;
+			currentPosePosition += skinningTransform.TransformPoint(bindPosePosition) * skinningWeight.weight;
+			currentPoseNormal += skinningTransform.TransformVector(bindPoseNormal) * skinningWeight.weight;
 		}
 		
 		if (!currentPoseNormal.Normalize())
@@ -232,7 +348,10 @@ void SkinnedRenderMesh::DeformMesh()
 		currentPoseNormalBuffer[1] = currentPoseNormal.y;
 		currentPoseNormalBuffer[2] = currentPoseNormal.z;
 	}
+}
 
+void SkinnedRenderMesh::UploadVertices()
+{
 	ID3D11DeviceContext* deviceContext = Game::Get()->GetDeviceContext();
 
 	// Note that we read form a bare buffer and wrote into a bare buffer beforehand so that
@@ -266,4 +385,13 @@ Animation* SkinnedRenderMesh::GetAnimation(const std::string& animationName)
 		return nullptr;
 
 	return iter->second;
+}
+
+const BoneBinding* SkinnedRenderMesh::GetAnimationBoneBinding(const std::string& animationName) const
+{
+	BoneBindingMap::const_iterator iter = this->boneBindingMap.find(animationName);
+	if (iter == this->boneBindingMap.end())
+		return nullptr;
+
+	return &iter->second;
 }
\ No newline at end of file
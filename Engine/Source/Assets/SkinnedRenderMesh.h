@@ -36,18 +36,69 @@ namespace Imzadi
 		 */
 		void DeformMesh();
 
+		/**
+		 * This is like @ref DeformMesh, but the result is kept aside as the pose to blend
+		 * towards, and the vertex buffer is left alone.  The pose the vertex buffer has now
+		 * becomes the one to blend from.
+		 */
+		void DeformMeshForBlending();
+
+		/**
+		 * Write the vertex buffer as the given blend between the two poses remembered by
+		 * the last call to @ref DeformMeshForBlending.  This is a good deal cheaper than skinning.
+		 *
+		 * @param[in] alpha Zero gives the pose blended from; one, the pose blended towards.
+		 */
+		void BlendDeformedMesh(double alpha);
+
 		Animation* GetAnimation(const std::string& animationName);
 
+		/**
+		 * Return the binding of the named animation to our skeleton, made when
+		 * the animation was loaded; null, if no such animation is found.
+		 */
+		const BoneBinding* GetAnimationBoneBinding(const std::string& animationName) const;
+
 		void GetAnimationNames(std::unordered_set<std::string>& animationNameSet);
 
 	private:
+
+		/**
+		 * Resolve our skin-weights against the bones of our skeleton.  This is done once
+		 * at load-time so that skinning never has to look up a bone by name.
+		 */
+		bool BindSkinWeights();
+
+		/**
+		 * Skin the bind-pose vertices by the skeleton's current pose into the given vertex buffer.
+		 */
+		void SkinVertices(BYTE* poseBuffer);
+
+		/**
+		 * Copy the current pose's vertices to the GPU.
+		 */
+		void UploadVertices();
+
+		struct SkinningWeight
+		{
+			int boneIndex;
+			double weight;
+		};
+
 		Reference<BareBuffer> bindPoseVertices;
 		Reference<BareBuffer> currentPoseVertices;
+		Reference<BareBuffer> sourcePoseVertices;
+		Reference<BareBuffer> targetPoseVertices;
 		Reference<Skeleton> skeleton;
 		Reference<SkinWeights> skinWeights;
 		uint32_t positionOffset;
 		uint32_t normalOffset;
 		typedef std::unordered_map<std::string, Reference<Animation>> AnimationMap;
 		AnimationMap animationMap;
+		typedef std::unordered_map<std::string, BoneBinding> BoneBindingMap;
+		BoneBindingMap boneBindingMap;
+		std::vector<uint32_t> vertexWeightOffsetArray;
+		std::vector<SkinningWeight> vertexWeightArray;
+		std::vector<Transform> skinningTransformArray;
 	};
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "Texture.h"
 #include "Game.h"
+#include "LZCodec.h"
 #include "Log.h"
 #include <compressapi.h>
 
@@ -44,14 +45,27 @@ Texture::Texture()
 		return false;
 	}
 
+	// Block-compressed formats store each 4x4 block of texels in a fixed number of bytes.
+	// We treat uncompressed formats as having 1x1 blocks the size of a texel.
 	std::string format = jsonDoc["format"].GetString();
-	uint32_t texelSizeBytes = 0;
+	uint32_t blockSizeBytes = 0;
+	uint32_t blockDimension = 1;
 	if (format == "RGBA")
-		texelSizeBytes = 4;
+		blockSizeBytes = 4;
 	else if (format == "RGB")
-		texelSizeBytes = 3;
+		blockSizeBytes = 3;
 	else if (format == "A")
-		texelSizeBytes = 1;
+		blockSizeBytes = 1;
+	else if (format == "BC1" || format == "BC4")
+	{
+		blockSizeBytes = 8;
+		blockDimension = 4;
+	}
+	else if (format == "BC3" || format == "BC7")
+	{
+		blockSizeBytes = 16;
+		blockDimension = 4;
+	}
 	else
 	{
 		IMZADI_LOG_ERROR("Format \"%s\" not recognized or not yet supported.", format.c_str());
@@ -87,39 +101,45 @@ Texture::Texture()
 		return false;
 	}
 
-	std::unique_ptr<unsigned char> dataBuffer(new unsigned char[dataSizeBytes]);
-	fileStream.read((char*)dataBuffer.get(), dataSizeBytes);
-	fileStream.close();
-
-	const unsigned char* textureData = dataBuffer.get();
-
 	uint32_t numMips = 1;
 	if (jsonDoc.HasMember("num_mips") && jsonDoc["num_mips"].IsUint())
 		numMips = jsonDoc["num_mips"].GetUint();
 
-	std::unique_ptr<unsigned char> decompressedDataBuffer;
+	std::unique_ptr<unsigned char> dataBuffer;
 	if (jsonDoc.HasMember("compressed") && jsonDoc["compressed"].GetBool())
 	{
-		DECOMPRESSOR_HANDLE decompressor = NULL;
+		uint32_t uncompressedSizeBytes = this->CalcUncompressedTextureSize(numMips, blockSizeBytes, blockDimension, textureWidth, textureHeight);
+		dataBuffer.reset(new unsigned char[uncompressedSizeBytes]);
 
-		if (!CreateDecompressor(COMPRESS_ALGORITHM_XPRESS, NULL, &decompressor))
+		// Our own payloads are streamed from the file, chunk by chunk, each decompressed in parallel
+		// straight into its place among the mips, so the compressed file is never loaded all at once.
+		if (LZCodec::IsPayload(fileStream))
 		{
-			IMZADI_LOG_ERROR("Failed to create decompressor.  Error code: %d", GetLastError());
-			return false;
+			LZCodec codec;
+			if (!codec.Decompress(fileStream, dataBuffer.get(), uncompressedSizeBytes, Game::Get()->GetJobSystem()))
+			{
+				IMZADI_LOG_ERROR("Failed to decompress texture data file: %s", textureDataFile.c_str());
+				return false;
+			}
 		}
-
-		ULONG_PTR uncompressedSizeBytes = this->CalcUncompressedTextureSize(numMips, texelSizeBytes, textureWidth, textureHeight);
-		decompressedDataBuffer.reset(new unsigned char[uncompressedSizeBytes]);
-
-		if (!Decompress(decompressor, dataBuffer.get(), dataSizeBytes, decompressedDataBuffer.get(), uncompressedSizeBytes, &uncompressedSizeBytes))
+		else
 		{
-			IMZADI_LOG_ERROR("Failed to decompress texture data.  Error code: %d", GetLastError());
-			return false;
+			// The system decompressor only works on whole buffers.
+			std::unique_ptr<unsigned char> payloadBuffer(new unsigned char[dataSizeBytes]);
+			fileStream.read((char*)payloadBuffer.get(), dataSizeBytes);
+			if (!this->DecompressLegacyPayload(payloadBuffer.get(), dataSizeBytes, dataBuffer.get(), uncompressedSizeBytes))
+				return false;
 		}
-
-		CloseDecompressor(decompressor);
-		textureData = decompressedDataBuffer.get();
 	}
+	else
+	{
+		dataBuffer.reset(new unsigned char[dataSizeBytes]);
+		fileStream.read((char*)dataBuffer.get(), dataSizeBytes);
+	}
+
+	fileStream.close();
+
+	const unsigned char* textureData = dataBuffer.get();
 
 	D3D11_TEXTURE2D_DESC textureDesc{};
 	textureDesc.Width = textureWidth;
@@ -140,7 +160,15 @@ Texture::Texture()
 	if(format == "RGBA")
 		textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
 	else if (format == "A")
-		textureDesc.Format = DXGI_FORMAT_A8_UNORM;
+		textureDesc.Format = DXGI_FORMAT_R8_UNORM;
+	else if (format == "BC1")
+		textureDesc.Format = DXGI_FORMAT_BC1_UNORM_SRGB;
+	else if (format == "BC3")
+		textureDesc.Format = DXGI_FORMAT_BC3_UNORM_SRGB;
+	else if (format == "BC4")
+		textureDesc.Format = DXGI_FORMAT_BC4_UNORM;
+	else if (format == "BC7")
+		textureDesc.Format = DXGI_FORMAT_BC7_UNORM_SRGB;
 	else
 	{
 		IMZADI_LOG_ERROR("Could not use format \"%s\".", format.c_str());
@@ -154,8 +182,8 @@ Texture::Texture()
 	{
 		D3D11_SUBRESOURCE_DATA* subResource = &subResourceArray.get()[i];
 		subResource->pSysMem = mipTextureData;
-		subResource->SysMemPitch = textureWidth * texelSizeBytes;
-		mipTextureData += textureWidth * textureHeight * texelSizeBytes;
+		subResource->SysMemPitch = this->CalcNumBlocks(textureWidth, blockDimension) * blockSizeBytes;
+		mipTextureData += subResource->SysMemPitch * this->CalcNumBlocks(textureHeight, blockDimension);
 		textureWidth >>= 1;
 		textureHeight >>= 1;
 	}
@@ -188,14 +216,41 @@ Texture::Texture()
 	return true;
 }
 
-uint32_t Texture::CalcUncompressedTextureSize(uint32_t numMips, uint32_t texelSize, uint32_t textureWidth, uint32_t textureHeight)
+bool Texture::DecompressLegacyPayload(const unsigned char* payload, uint32_t payloadSize, unsigned char* data, uint32_t dataSize)
+{
+	DECOMPRESSOR_HANDLE decompressor = NULL;
+
+	if (!CreateDecompressor(COMPRESS_ALGORITHM_XPRESS, NULL, &decompressor))
+	{
+		IMZADI_LOG_ERROR("Failed to create decompressor.  Error code: %d", GetLastError());
+		return false;
+	}
+
+	ULONG_PTR uncompressedSizeBytes = dataSize;
+	if (!Decompress(decompressor, payload, payloadSize, data, uncompressedSizeBytes, &uncompressedSizeBytes))
+	{
+		IMZADI_LOG_ERROR("Failed to decompress texture data.  Error code: %d", GetLastError());
+		CloseDecompressor(decompressor);
+		return false;
+	}
+
+	CloseDecompressor(decompressor);
+	return true;
+}
+
+uint32_t Texture::CalcNumBlocks(uint32_t numTexels, uint32_t blockDimension)
+{
+	return (numTexels + blockDimension - 1) / blockDimension;
+}
+
+uint32_t Texture::CalcUncompressedTextureSize(uint32_t numMips, uint32_t blockSizeBytes, uint32_t blockDimension, uint32_t textureWidth, uint32_t textureHeight)
 {
 	uint32_t textureSize = 0;
 
 	while (numMips-- > 0)
 	{
 		IMZADI_ASSERT(textureWidth > 0 && textureHeight > 0);
-		textureSize += textureWidth * textureHeight * texelSize;
+		textureSize += this->CalcNumBlocks(textureWidth, blockDimension) * this->CalcNumBlocks(textureHeight, blockDimension) * blockSizeBytes;
 		textureWidth >>= 1;
 		textureHeight >>= 1;
 	}
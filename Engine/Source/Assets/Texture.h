@@ -21,7 +21,14 @@ namespace Imzadi
 		ID3D11ShaderResourceView* GetTextureView() { return this->textureView; }
 
 	private:
-		uint32_t CalcUncompressedTextureSize(uint32_t numMips, uint32_t texelSize, uint32_t textureWidth, uint32_t textureHeight);
+		uint32_t CalcUncompressedTextureSize(uint32_t numMips, uint32_t blockSizeBytes, uint32_t blockDimension, uint32_t textureWidth, uint32_t textureHeight);
+		uint32_t CalcNumBlocks(uint32_t numTexels, uint32_t blockDimension);
+
+		/**
+		 * Texture data made before we had our own codec was compressed with the Windows XPRESS
+		 * algorithm.  Those payloads can still be loaded, but only here, and only on Windows.
+		 */
+		bool DecompressLegacyPayload(const unsigned char* payload, uint32_t payloadSize, unsigned char* data, uint32_t dataSize);
 
 		ID3D11Texture2D* texture;
 		ID3D11ShaderResourceView* textureView;
@@ -22,11 +22,17 @@ AudioSystem::AudioSystem()
 {
 }
 
-bool AudioSystem::Initialize()
+bool AudioSystem::Initialize(bool nullOutput /*= false*/)
 {
 	if (this->audio)
 		return false;
 
+	if (nullOutput)
+	{
+		IMZADI_LOG_INFO("Audio output is disabled.");
+		return true;
+	}
+
 	HRESULT result = XAudio2Create(&this->audio, 0, XAUDIO2_DEFAULT_PROCESSOR);
 	if (FAILED(result))
 	{
@@ -148,6 +154,10 @@ bool AudioSystem::PlaySound(const std::string& sound, float volume /*= 1.0f*/)
 		return false;
 	}
 
+	// With no output, there's nothing more to do.
+	if (!this->audio)
+		return true;
+
 	const AudioSystemAsset* audioSystemAsset = iter->second.Get();
 
 	auto audioAsset = dynamic_cast<const Audio*>(audioSystemAsset);
@@ -255,7 +265,7 @@ bool AudioSystem::LoadAudioDirectory(const std::string& audioDirectory, bool rec
 
 void AudioSystem::ClearSourceCache()
 {
-	for (auto pair : this->audioSourceCache)
+	for (auto& pair : this->audioSourceCache)
 		pair.second->Clear();
 
 	this->audioSourceCache.clear();
@@ -380,6 +390,7 @@ AudioSystem::MidiThread::MidiThread() : midiSongQueueSemaphore(0)
 	this->exitSignaled = false;
 	this->midiOut = nullptr;
 	this->playing = false;
+	this->midiChannelID = 0;
 }
 
 /*virtual*/ AudioSystem::MidiThread::~MidiThread()
@@ -422,6 +433,9 @@ bool AudioSystem::MidiThread::Startup()
 		return false;
 	}
 
+	// The MIDI thread sends its events by ID so that it never has to look up a channel by name.
+	this->midiChannelID = Game::Get()->GetEventSystem()->GetChannelID("MIDI");
+
 	this->exitSignaled = false;
 	this->thread = new std::thread(&MidiThread::ThreadEntryProc, this);
 	return true;
@@ -537,7 +551,7 @@ void AudioSystem::MidiThread::PlayMidiSong(MidiSong* midiSong)
 	AudioDataLib::Error error;
 	if (player.Setup(error))
 	{
-		Game::Get()->GetEventSystem()->SendEvent("MIDI", new MidiSongEvent(MidiSongEvent::Type::SONG_STARTED, midiSong->GetName()));
+		Game::Get()->GetEventSystem()->SendEvent(this->midiChannelID, new MidiSongEvent(MidiSongEvent::Type::SONG_STARTED, midiSong->GetName()));
 
 		while (!player.NoMoreToPlay() && !this->exitSignaled)
 		{
@@ -547,6 +561,6 @@ void AudioSystem::MidiThread::PlayMidiSong(MidiSong* midiSong)
 
 		player.Shutdown(error);
 
-		Game::Get()->GetEventSystem()->SendEvent("MIDI", new MidiSongEvent(MidiSongEvent::Type::SONG_FINISHED, midiSong->GetName()));
+		Game::Get()->GetEventSystem()->SendEvent(this->midiChannelID, new MidiSongEvent(MidiSongEvent::Type::SONG_FINISHED, midiSong->GetName()));
 	}
 }
\ No newline at end of file
@@ -39,7 +39,12 @@ namespace Imzadi
 		AudioSystem();
 		virtual ~AudioSystem();
 
-		bool Initialize();
+		/**
+		 * Start up the audio sub-system.
+		 *
+		 * @param[in] nullOutput If true, nothing is ever actually played.  Sounds still load, and playing them succeeds, but they're never heard.  This is used when the game runs headless.
+		 */
+		bool Initialize(bool nullOutput = false);
 		bool Shutdown();
 		void Tick(double deltaTimeSeconds);
 
@@ -166,6 +171,7 @@ namespace Imzadi
 			std::thread* thread;
 			bool exitSignaled;
 			RtMidiOut* midiOut;
+			EventChannelID midiChannelID;
 		};
 
 		MidiThread* midiThread;
@@ -1,6 +1,7 @@
 #include "Camera.h"
 #include "Scene.h"
 #include "Math/Matrix4x4.h"
+#include "Math/Plane.h"
 
 using namespace Imzadi;
 
@@ -31,7 +32,12 @@ bool Camera::IsApproximatelyVisible(const RenderObject* renderObject) const
 	{
 		case ViewMode::ORTHOGRAPHIC:
 		{
-			// TODO: Handle this case later.
+			center = this->GetWorldToCameraTransform().TransformPoint(center);
+			std::vector<Plane> planeArray;
+			this->GetOrthographicPlanes(planeArray);
+			for (const Plane& plane : planeArray)
+				if (plane.SignedDistanceTo(center) >= radius)
+					return false;
 			return true;
 		}
 		case ViewMode::PERSPECTIVE:
@@ -44,6 +50,33 @@ bool Camera::IsApproximatelyVisible(const RenderObject* renderObject) const
 	return true;
 }
 
+bool Camera::GetWorldFrustumPlanes(std::vector<Plane>& planeArray) const
+{
+	planeArray.clear();
+
+	switch (this->viewMode)
+	{
+		case ViewMode::ORTHOGRAPHIC:
+		{
+			std::vector<Plane> cameraPlaneArray;
+			this->GetOrthographicPlanes(cameraPlaneArray);
+			for (const Plane& plane : cameraPlaneArray)
+				planeArray.push_back(this->cameraToWorld.TransformPlane(plane));
+			return true;
+		}
+		case ViewMode::PERSPECTIVE:
+		{
+			std::vector<Plane> cameraPlaneArray;
+			this->frustum.GetPlanes(cameraPlaneArray);
+			for (const Plane& plane : cameraPlaneArray)
+				planeArray.push_back(this->cameraToWorld.TransformPlane(plane));
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void Camera::SetCameraToWorldTransform(const Imzadi::Transform& cameraToWorld)
 {
 	this->cameraToWorld = cameraToWorld;
@@ -81,16 +114,8 @@ void Camera::GetProjectionMatrix(Matrix4x4& matrix) const
 		}
 		case ViewMode::ORTHOGRAPHIC:
 		{
-			double width = this->orthoParams.width;
-			double height = this->orthoParams.height;
-
-			if (this->orthoParams.desiredAspectRatio != 0.0)
-			{
-				if (this->orthoParams.adjustWidth)
-					width += height * this->orthoParams.desiredAspectRatio - width;
-				else
-					height += width / this->orthoParams.desiredAspectRatio - height;
-			}
+			double width = 0.0, height = 0.0;
+			this->GetOrthographicExtents(width, height);
 
 			matrix.SetIdentity();
 			matrix.ele[0][0] = 2.0 / width;
@@ -105,4 +130,31 @@ void Camera::GetProjectionMatrix(Matrix4x4& matrix) const
 			break;
 		}
 	}
+}
+
+void Camera::GetOrthographicExtents(double& width, double& height) const
+{
+	width = this->orthoParams.width;
+	height = this->orthoParams.height;
+
+	if (this->orthoParams.desiredAspectRatio != 0.0)
+	{
+		if (this->orthoParams.adjustWidth)
+			width += height * this->orthoParams.desiredAspectRatio - width;
+		else
+			height += width / this->orthoParams.desiredAspectRatio - height;
+	}
+}
+
+void Camera::GetOrthographicPlanes(std::vector<Plane>& planeArray) const
+{
+	double width = 0.0, height = 0.0;
+	this->GetOrthographicExtents(width, height);
+
+	planeArray.push_back(Plane(Vector3(0.0, 0.0, -this->orthoParams.nearClip), Vector3(0.0, 0.0, 1.0)));
+	planeArray.push_back(Plane(Vector3(0.0, 0.0, -this->orthoParams.farClip), Vector3(0.0, 0.0, -1.0)));
+	planeArray.push_back(Plane(Vector3(width / 2.0, 0.0, 0.0), Vector3(1.0, 0.0, 0.0)));
+	planeArray.push_back(Plane(Vector3(-width / 2.0, 0.0, 0.0), Vector3(-1.0, 0.0, 0.0)));
+	planeArray.push_back(Plane(Vector3(0.0, height / 2.0, 0.0), Vector3(0.0, 1.0, 0.0)));
+	planeArray.push_back(Plane(Vector3(0.0, -height / 2.0, 0.0), Vector3(0.0, -1.0, 0.0)));
 }
\ No newline at end of file
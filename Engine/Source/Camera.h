@@ -7,6 +7,7 @@
 namespace Imzadi
 {
 	class RenderObject;
+	class Plane;
 
 	/**
 	 * An instance of this class describes how we are viewing a scene.
@@ -39,6 +40,15 @@ namespace Imzadi
 		 */
 		bool IsApproximatelyVisible(const RenderObject* renderObject) const;
 
+		/**
+		 * Calculate the planes bounding this camera's view in world space.  Their normals point
+		 * out of the view, so a sphere is outside of it if it's entirely in front of any one of them.
+		 *
+		 * @param[out] planeArray The planes are returned here.
+		 * @return False is returned if the view can't be bounded by planes, in which case everything should be considered visible.
+		 */
+		bool GetWorldFrustumPlanes(std::vector<Plane>& planeArray) const;
+
 		/**
 		 * Specify the position and orientation of this camera.  Remember that camera
 		 * space is thought of as being at origin looking down -Z with +X right and +Y up.
@@ -90,9 +100,16 @@ namespace Imzadi
 		const OrthographicParams& GetOrthographicParameters() const { return this->orthoParams; }
 		void SetOrthographicParams(const OrthographicParams& orthoParams) { this->orthoParams = orthoParams; }
 
+		/**
+		 * Calculate the width and height of this camera's orthographic view, having been adjusted for the desired aspect ratio, if any.
+		 */
+		void GetOrthographicExtents(double& width, double& height) const;
+
 		const Vector3& GetEyePoint() const { return this->cameraToWorld.translation; }
 
 	private:
+		void GetOrthographicPlanes(std::vector<Plane>& planeArray) const;
+
 		ViewMode viewMode;
 		OrthographicParams orthoParams;
 		Frustum frustum;
@@ -197,7 +197,7 @@ void BoundingBoxTree::RayCast(const Ray& ray, const AxisAlignedBoundingBox& boun
 
 bool BoundingBoxTree::CalculateCollision(const Shape* shape, uint64_t userFlagsMask, CollisionQueryResult* collisionResult) const
 {
-	IMZADI_COLLISION_PROFILE("Collision Calculation");
+	IMZADI_PROFILE("Collision Calculation");
 
 	const BoundingBoxNode* node = shape->node;
 	if (!node)
@@ -128,7 +128,7 @@ ObjectToWorldCommand::ObjectToWorldCommand()
 {
 	// TODO: This is also really slow.  First of all, why are there
 	//       so many of these commands being executed per frame?
-	IMZADI_COLLISION_PROFILE("Object-to-World Cmd");
+	IMZADI_PROFILE("Object-to-World Cmd");
 
 	Shape* shape = thread->FindShape(this->shapeID);
 	if (!shape)
@@ -152,7 +152,7 @@ ResetProfileDataCommand::ResetProfileDataCommand()
 
 /*virtual*/ void ResetProfileDataCommand::Execute(Thread* thread)
 {
-	collisionProfileData.Reset();
+	Profiler::Get()->ResetThreadStats();
 }
 
 //------------------------------- FileCommand -------------------------------
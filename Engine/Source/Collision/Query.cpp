@@ -66,7 +66,7 @@ DebugRenderQuery::DebugRenderQuery()
 
 /*virtual*/ Result* DebugRenderQuery::ExecuteQuery(Thread* thread)
 {
-	IMZADI_COLLISION_PROFILE("Debug Render Query");
+	IMZADI_PROFILE("Debug Render Query");
 	auto renderResult = new DebugRenderResult();
 	thread->DebugVisualize(renderResult, this->drawFlags);
 	return renderResult;
@@ -90,7 +90,7 @@ RayCastQuery::RayCastQuery()
 	//       Optimize this.  I think that one obvious optimization here is to limit the
 	//       length of ray-casts.  In any case, the infinite-length ray-cast is probably
 	//       written wrong, and I should start by trying to fix it.
-	IMZADI_COLLISION_PROFILE("Ray Cast Query");
+	IMZADI_PROFILE("Ray Cast Query");
 	const BoundingBoxTree& boxTree = thread->GetBoundingBoxTree();
 	auto result = new RayCastResult();
 	boxTree.RayCast(this->ray, this->boundingBox, this->userFlagsMask, result);
@@ -109,7 +109,7 @@ ObjectToWorldQuery::ObjectToWorldQuery()
 
 /*virtual*/ Result* ObjectToWorldQuery::ExecuteQuery(Thread* thread)
 {
-	IMZADI_COLLISION_PROFILE("Object-to-World Query");
+	IMZADI_PROFILE("Object-to-World Query");
 
 	Shape* shape = thread->FindShape(this->shapeID);
 	if (!shape)
@@ -136,7 +136,7 @@ CollisionQuery::CollisionQuery()
 
 /*virtual*/ Result* CollisionQuery::ExecuteQuery(Thread* thread)
 {
-	IMZADI_COLLISION_PROFILE("Collision Query");
+	IMZADI_PROFILE("Collision Query");
 
 	Shape* shape = thread->FindShape(this->shapeID);
 	if (!shape)
@@ -173,7 +173,7 @@ ShapeInBoundsQuery::ShapeInBoundsQuery()
 
 /*virtual*/ Result* ShapeInBoundsQuery::ExecuteQuery(Thread* thread)
 {
-	IMZADI_COLLISION_PROFILE("Shape-in-Bounds Query");
+	IMZADI_PROFILE("Shape-in-Bounds Query");
 
 	auto result = new BoolResult();
 	result->SetAnswer(false);
@@ -199,6 +199,6 @@ ProfileStatsQuery::ProfileStatsQuery()
 /*virtual*/ Result* ProfileStatsQuery::ExecuteQuery(Thread* thread)
 {
 	auto result = new StringResult();
-	result->SetText(collisionProfileData.PrintStats());
+	result->SetText(Profiler::Get()->PrintThreadStats());
 	return result;
 }
\ No newline at end of file
@@ -122,7 +122,7 @@ const ShapePairCollisionStatus* CollisionQueryResult::GetMostEgregiousCollision(
 	double largestLength = 0.0;
 	const ShapePairCollisionStatus* foundStatus = nullptr;
 
-	for (auto collisionStatusPair : this->collisionStatusArray)
+	for (const auto& collisionStatusPair : this->collisionStatusArray)
 	{
 		if (collisionStatusPair->AreInCollision())
 		{
@@ -143,7 +143,7 @@ Vector3 CollisionQueryResult::GetAverageSeparationDelta(ShapeID shapeID) const
 	Vector3 averageSeparationDelta(0.0, 0.0, 0.0);
 	double count = 0.0;
 
-	for (auto collisionStatusPair : this->collisionStatusArray)
+	for (const auto& collisionStatusPair : this->collisionStatusArray)
 	{
 		if (collisionStatusPair->AreInCollision())
 		{
@@ -3,6 +3,7 @@
 #include "Thread.h"
 #include "Query.h"
 #include "Command.h"
+#include "Profile.h"
 
 using namespace Imzadi;
 using namespace Imzadi::Collision;
@@ -105,6 +106,8 @@ Result* System::ObtainQueryResult(TaskID taskID)
 
 bool System::FlushAllTasks()
 {
+	IMZADI_PROFILE("Collision Flush");
+
 	if (!this->thread)
 		return false;
 
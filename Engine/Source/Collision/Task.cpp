@@ -3,11 +3,12 @@
 using namespace Imzadi;
 using namespace Imzadi::Collision;
 
-TaskID Task::nextTaskID = 0;
+std::atomic<TaskID> Task::nextTaskID = 0;
 
 Task::Task()
 {
-	this->taskID = nextTaskID++;
+	// Tasks may be made on any thread (e.g., by entities ticking on the job system.)
+	this->taskID = nextTaskID.fetch_add(1, std::memory_order_relaxed);
 }
 
 /*virtual*/ Task::~Task()
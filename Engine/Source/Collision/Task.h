@@ -2,6 +2,7 @@
 
 #include "Defines.h"
 #include <stdint.h>
+#include <atomic>
 
 namespace Imzadi {
 namespace Collision {
@@ -42,7 +43,7 @@ public:
 
 private:
 	TaskID taskID;
-	static TaskID nextTaskID;
+	static std::atomic<TaskID> nextTaskID;
 };
 
 } // namespace Collision {
@@ -11,14 +11,6 @@
 using namespace Imzadi;
 using namespace Imzadi::Collision;
 
-namespace Imzadi
-{
-	namespace Collision
-	{
-		ProfileData collisionProfileData;
-	}
-}
-
 Thread::Thread(const AxisAlignedBoundingBox& collisionWorldExtents) : boxTree(collisionWorldExtents), taskQueueSemaphore(0)
 {
 	this->thread = nullptr;
@@ -61,6 +53,7 @@ bool Thread::Shutdown()
 void Thread::Run()
 {
 	SetThreadDescription(GetCurrentThread(), L"Collision");
+	IMZADI_PROFILE_THREAD("Collision");
 
 	while (!this->signaledToExit)
 	{
@@ -82,7 +75,7 @@ void Thread::Run()
 
 		if (task)
 		{
-			IMZADI_COLLISION_PROFILE("Task Execution");
+			IMZADI_PROFILE("Task Execution");
 
 			// Process the task.
 			task->Execute(this);
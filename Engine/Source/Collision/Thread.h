@@ -12,17 +12,9 @@
 #include <semaphore>
 #include <unordered_map>
 
-#if defined IMZADI_COLLISION_PROFILING_ENABLED
-#	define IMZADI_COLLISION_PROFILE(name)	ProfileBlock profileBlock(&collisionProfileData, name)
-#else
-#	define IMZADI_COLLISION_PROFILE(name)
-#endif
-
 namespace Imzadi {
 namespace Collision {
 
-extern ProfileData collisionProfileData;
-
 class Task;
 class Result;
 class DebugRenderResult;
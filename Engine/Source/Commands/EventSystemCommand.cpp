@@ -0,0 +1,162 @@
+#include "EventSystemCommand.h"
+#include "EventSystem.h"
+#include "Clock.h"
+#include <format>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+using namespace Imzadi;
+
+static EventSystemCommand eventSystemCommand;
+
+namespace
+{
+	class BenchEvent : public Event
+	{
+	public:
+		BenchEvent(int threadIndex, int sequence) : Event("Bench")
+		{
+			this->threadIndex = threadIndex;
+			this->sequence = sequence;
+		}
+
+		int threadIndex;
+		int sequence;
+	};
+
+	/**
+	 * Have each of the given number of threads send the given number of events, all at once, and return the time taken in milliseconds.
+	 */
+	double SendFromThreads(int numThreads, int numEvents, const std::function<void(int, int)>& sendFunc)
+	{
+		std::atomic<int> numReadyThreads = 0;
+		std::atomic<bool> go = false;
+
+		std::vector<std::thread> threadArray;
+		for (int i = 0; i < numThreads; i++)
+		{
+			threadArray.push_back(std::thread([&numReadyThreads, &go, &sendFunc, numEvents, i]() {
+				numReadyThreads++;
+				while (!go)
+					std::this_thread::yield();
+				for (int j = 0; j < numEvents; j++)
+					sendFunc(i, j);
+			}));
+		}
+
+		while (numReadyThreads < numThreads)
+			std::this_thread::yield();
+
+		Clock clock;
+		clock.Reset();
+		go = true;
+
+		for (std::thread& thread : threadArray)
+			thread.join();
+
+		return clock.GetCurrentTimeMilliseconds();
+	}
+}
+
+EventSystemCommand::EventSystemCommand()
+{
+}
+
+/*virtual*/ EventSystemCommand::~EventSystemCommand()
+{
+}
+
+/*virtual*/ std::string EventSystemCommand::GetName()
+{
+	return "events";
+}
+
+/*virtual*/ std::string EventSystemCommand::GetSyntaxHelp()
+{
+	return "events bench <num-threads> <num-events>";
+}
+
+/*virtual*/ std::string EventSystemCommand::GetHelpDescription()
+{
+	return "Stress the event system from many threads.";
+}
+
+/*virtual*/ std::string EventSystemCommand::GetDetailedHelp()
+{
+	return	"events bench <num-threads> <num-events> -- On a private event system, have the given number of threads\n"
+			"    (default 4) each send the given number of events (default 100000) at the same time, first by channel\n"
+			"    name and then by channel ID, dispatch them all, and report the send and dispatch times.  Each thread's\n"
+			"    events must arrive in the order they were sent, and none may be lost.";
+}
+
+/*virtual*/ bool EventSystemCommand::Execute(const std::vector<std::string>& arguments, std::vector<std::string>& results)
+{
+	if (arguments.size() < 1 || arguments[0] != "bench")
+		return false;
+
+	int numThreads = (arguments.size() >= 2) ? ::atoi(arguments[1].c_str()) : 4;
+	int numEvents = (arguments.size() >= 3) ? ::atoi(arguments[2].c_str()) : 100000;
+	if (numThreads <= 0 || numEvents <= 0)
+		return false;
+
+	EventSystem eventSystem;
+	EventChannelID channelID = eventSystem.GetChannelID("Bench");
+
+	// The order of events across threads is arbitrary, but those of any one thread must arrive in the order sent.
+	uint64_t numReceived = 0;
+	uint64_t numOutOfOrder = 0;
+	std::vector<int> nextSequenceArray;
+	eventSystem.RegisterEventListener(channelID, EventListenerType::PERMINANT, new LambdaEventListener([&](const Event* event) {
+		auto benchEvent = static_cast<const BenchEvent*>(event);
+		int& nextSequence = nextSequenceArray[benchEvent->threadIndex];
+		if (benchEvent->sequence != nextSequence)
+			numOutOfOrder++;
+		nextSequence = benchEvent->sequence + 1;
+		numReceived++;
+	}));
+
+	uint64_t numExpected = uint64_t(numThreads) * uint64_t(numEvents);
+	bool passed = true;
+
+	struct Mode
+	{
+		const char* name;
+		std::function<void(int, int)> sendFunc;
+	};
+
+	Mode modeArray[] =
+	{
+		{"by name", [&eventSystem](int i, int j) { eventSystem.SendEvent("Bench", new BenchEvent(i, j)); }},
+		{"by ID", [&eventSystem, channelID](int i, int j) { eventSystem.SendEvent(channelID, new BenchEvent(i, j)); }}
+	};
+
+	results.push_back(std::format("{} threads, {} events each:", numThreads, numEvents));
+
+	for (const Mode& mode : modeArray)
+	{
+		numReceived = 0;
+		numOutOfOrder = 0;
+		nextSequenceArray.assign(numThreads, 0);
+
+		double sendTime = SendFromThreads(numThreads, numEvents, mode.sendFunc);
+
+		Clock clock;
+		clock.Reset();
+		eventSystem.DispatchAllPendingEvents();
+		double dispatchTime = clock.GetCurrentTimeMilliseconds();
+
+		bool modePassed = (numReceived == numExpected && numOutOfOrder == 0);
+		passed = passed && modePassed;
+
+		results.push_back(std::format("    send {}: {:.2f} ms ({:.0f} ns/event); dispatch: {:.2f} ms ({:.0f} ns/event); received {} of {}{}",
+			mode.name,
+			sendTime, sendTime * 1e6 / double(numExpected),
+			dispatchTime, dispatchTime * 1e6 / double(numExpected),
+			numReceived, numExpected,
+			modePassed ? "" : " (FAILED)"));
+	}
+
+	results.push_back(passed ? "All events were delivered in order." : "Some events were lost or arrived out of order!");
+	return true;
+}
\ No newline at end of file
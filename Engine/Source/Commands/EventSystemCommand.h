@@ -0,0 +1,20 @@
+#include "Command.h"
+
+namespace Imzadi
+{
+	/**
+	 * This command can be used to stress the event system with events sent from many threads at once.
+	 */
+	class IMZADI_API EventSystemCommand : public ConsoleCommand
+	{
+	public:
+		EventSystemCommand();
+		virtual ~EventSystemCommand();
+
+		virtual std::string GetName() override;
+		virtual std::string GetSyntaxHelp() override;
+		virtual std::string GetHelpDescription() override;
+		virtual std::string GetDetailedHelp() override;
+		virtual bool Execute(const std::vector<std::string>& arguments, std::vector<std::string>& results) override;
+	};
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "InfoCommand.h"
 #include "Game.h"
 #include "Entity.h"
+#include "RenderObjects/AnimatedMeshInstance.h"
 
 using namespace Imzadi;
 
@@ -21,7 +22,7 @@ InfoCommand::InfoCommand()
 
 /*virtual*/ std::string InfoCommand::GetSyntaxHelp()
 {
-	return "info [entity] <entity-name>";
+	return "info [entity|anim_lod] <entity-name>";
 }
 
 /*virtual*/ std::string InfoCommand::GetHelpDescription()
@@ -45,6 +46,13 @@ InfoCommand::InfoCommand()
 				results.push_back(info);
 			}
 		}
+		else if (arguments[0] == "anim_lod")
+		{
+			const AnimatedMeshInstance::LODStats& stats = AnimatedMeshInstance::GetLODStats();
+			results.push_back(std::format("Full animation updates: {}", stats.fullUpdateCount));
+			results.push_back(std::format("Partial animation updates: {}", stats.partialUpdateCount));
+			results.push_back(std::format("Skipped animation updates: {}", stats.skippedUpdateCount));
+		}
 	}
 
 	return true;
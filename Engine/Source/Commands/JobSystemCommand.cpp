@@ -0,0 +1,130 @@
+#include "JobSystemCommand.h"
+#include "Game.h"
+#include "Clock.h"
+#include "Math/Transform.h"
+#include "Math/Vector3.h"
+#include <format>
+
+using namespace Imzadi;
+
+static JobSystemCommand jobSystemCommand;
+
+JobSystemCommand::JobSystemCommand()
+{
+}
+
+/*virtual*/ JobSystemCommand::~JobSystemCommand()
+{
+}
+
+/*virtual*/ std::string JobSystemCommand::GetName()
+{
+	return "jobs";
+}
+
+/*virtual*/ std::string JobSystemCommand::GetSyntaxHelp()
+{
+	return "jobs [stats|bench|entities] <num-frames|on|off>";
+}
+
+/*virtual*/ std::string JobSystemCommand::GetHelpDescription()
+{
+	return "Inspect the job system, or measure how it scales with the number of workers.";
+}
+
+/*virtual*/ std::string JobSystemCommand::GetDetailedHelp()
+{
+	return	"jobs stats -- Show the number of workers and how long each task of the last frame took.\n"
+			"jobs bench <num-frames> -- Run a synthetic, skinning-like workload for the given number\n"
+			"    of frames (default 100) with 0, 1, ..., N workers, and report the average frame time.\n"
+			"jobs entities [on|off] -- Show how the entities are split up into tick groups, and optionally\n"
+			"    turn parallel entity ticking on or off.";
+}
+
+/*virtual*/ bool JobSystemCommand::Execute(const std::vector<std::string>& arguments, std::vector<std::string>& results)
+{
+	if (arguments.size() < 1)
+		return false;
+
+	JobSystem* jobSystem = Game::Get()->GetJobSystem();
+
+	if (arguments[0] == "stats")
+	{
+		results.push_back(std::format("Worker threads: {} ({} active)", jobSystem->GetNumWorkers(), jobSystem->GetNumActiveWorkers()));
+
+		const TaskGraph* graph = Game::Get()->GetFrameTaskGraph();
+		results.push_back(std::format("Last frame task graph: {:.3f} ms", graph->GetExecutionTimeMilliseconds()));
+		for (int i = 0; i < graph->GetNumTasks(); i++)
+			results.push_back(std::format("    {}: {:.3f} ms", graph->GetTaskName(i).c_str(), graph->GetTaskTimeMilliseconds(i)));
+	}
+	else if (arguments[0] == "bench")
+	{
+		int numFrames = (arguments.size() >= 2) ? ::atoi(arguments[1].c_str()) : 100;
+		if (numFrames <= 0)
+			return false;
+
+		// This roughly approximates skinning a few dozen characters per frame.
+		const uint32_t numVertices = 256 * 1024;
+		const uint32_t grainSize = 2048;
+		std::vector<Vector3> sourceArray(numVertices), targetArray(numVertices);
+		for (uint32_t i = 0; i < numVertices; i++)
+			sourceArray[i].SetComponents(double(i % 97), double(i % 89), double(i % 83));
+
+		Transform transformA, transformB;
+		transformA.matrix.SetFromAxisAngle(Vector3(0.0, 1.0, 0.0), 0.3);
+		transformA.translation.SetComponents(1.0, 2.0, 3.0);
+		transformB.matrix.SetFromAxisAngle(Vector3(1.0, 0.0, 0.0), -0.7);
+
+		auto kernel = [&sourceArray, &targetArray, &transformA, &transformB](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+				targetArray[i] = transformA.TransformPoint(sourceArray[i]) * 0.6 + transformB.TransformPoint(sourceArray[i]) * 0.4;
+		};
+
+		uint32_t numActiveWorkers = jobSystem->GetNumActiveWorkers();
+		double baselineMilliseconds = 0.0;
+
+		for (uint32_t numWorkers = 0; numWorkers <= jobSystem->GetNumWorkers(); numWorkers++)
+		{
+			jobSystem->SetNumActiveWorkers(numWorkers);
+
+			Clock clock;
+			clock.Reset();
+
+			for (int i = 0; i < numFrames; i++)
+				jobSystem->ParallelFor(numVertices, grainSize, kernel);
+
+			double frameMilliseconds = clock.GetCurrentTimeMilliseconds() / double(numFrames);
+			if (numWorkers == 0)
+				baselineMilliseconds = frameMilliseconds;
+
+			results.push_back(std::format("{} workers: {:.3f} ms/frame ({:.2f}x)", numWorkers, frameMilliseconds, baselineMilliseconds / frameMilliseconds));
+		}
+
+		jobSystem->SetNumActiveWorkers(numActiveWorkers);
+	}
+	else if (arguments[0] == "entities")
+	{
+		if (arguments.size() >= 2)
+		{
+			if (arguments[1] == "on")
+				Game::Get()->SetParallelEntityTicking(true);
+			else if (arguments[1] == "off")
+				Game::Get()->SetParallelEntityTicking(false);
+			else
+				return false;
+		}
+
+		uint32_t numGroups = 0, numParallelEntities = 0, numSerialEntities = 0;
+		Game::Get()->GetEntityTickGroupStats(numGroups, numParallelEntities, numSerialEntities);
+
+		results.push_back(std::format("Parallel entity ticking: {}", Game::Get()->GetParallelEntityTicking() ? "on" : "off"));
+		results.push_back(std::format("Tick groups: {}", numGroups));
+		results.push_back(std::format("Parallel entities: {}", numParallelEntities));
+		results.push_back(std::format("Serial entities: {}", numSerialEntities));
+	}
+	else
+		return false;
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "Command.h"
+
+namespace Imzadi
+{
+	/**
+	 * This command can be used to inspect the job system and measure how well it scales.
+	 */
+	class IMZADI_API JobSystemCommand : public ConsoleCommand
+	{
+	public:
+		JobSystemCommand();
+		virtual ~JobSystemCommand();
+
+		virtual std::string GetName() override;
+		virtual std::string GetSyntaxHelp() override;
+		virtual std::string GetHelpDescription() override;
+		virtual std::string GetDetailedHelp() override;
+		virtual bool Execute(const std::vector<std::string>& arguments, std::vector<std::string>& results) override;
+	};
+}
\ No newline at end of file
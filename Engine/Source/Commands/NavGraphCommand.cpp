@@ -0,0 +1,626 @@
+#include "NavGraphCommand.h"
+#include "Assets/NavGraph.h"
+#include "NavGraphHierarchy.h"
+#include "FlowField.h"
+#include "Entities/Level.h"
+#include "JobSystem.h"
+#include "Game.h"
+#include "Clock.h"
+#include "Math/Random.h"
+#include <format>
+
+using namespace Imzadi;
+
+static NavGraphCommand navGraphCommand;
+
+namespace
+{
+	/**
+	 * Make a nav-graph that is a square grid of the given size, with the nodes jittered
+	 * a bit and some of the edges knocked out, so that the shortest paths aren't trivial.
+	 * We go through the JSON loader here, because adding a location to a graph one at a
+	 * time has to look for nodes to snap to, which is too slow for large graphs.
+	 */
+	Reference<NavGraph> MakeGridGraph(int gridSize, Random& random)
+	{
+		const double spacing = 10.0;
+		const double jitter = 3.0;
+		const double dropProbability = 0.2;
+
+		rapidjson::Document jsonDoc;
+		jsonDoc.SetObject();
+
+		std::vector<std::vector<int>> adjacencyArray(gridSize * gridSize);
+		rapidjson::Value pathArrayValue;
+		pathArrayValue.SetArray();
+
+		auto addPath = [&](int i, int j)
+		{
+			if (random.InRange(0.0, 1.0) < dropProbability)
+				return;
+
+			int k = (int)pathArrayValue.Size();
+			rapidjson::Value pathValue;
+			pathValue.SetObject();
+			pathValue.AddMember("i", rapidjson::Value().SetInt(i), jsonDoc.GetAllocator());
+			pathValue.AddMember("j", rapidjson::Value().SetInt(j), jsonDoc.GetAllocator());
+			pathArrayValue.PushBack(pathValue, jsonDoc.GetAllocator());
+			adjacencyArray[i].push_back(k);
+			adjacencyArray[j].push_back(k);
+		};
+
+		for (int row = 0; row < gridSize; row++)
+		{
+			for (int col = 0; col < gridSize; col++)
+			{
+				int i = row * gridSize + col;
+				if (col + 1 < gridSize)
+					addPath(i, i + 1);
+				if (row + 1 < gridSize)
+					addPath(i, i + gridSize);
+			}
+		}
+
+		rapidjson::Value nodeArrayValue;
+		nodeArrayValue.SetArray();
+
+		for (int i = 0; i < gridSize * gridSize; i++)
+		{
+			Vector3 location;
+			location.x = double(i % gridSize) * spacing + random.InRange(-jitter, jitter);
+			location.y = random.InRange(-jitter, jitter);
+			location.z = double(i / gridSize) * spacing + random.InRange(-jitter, jitter);
+
+			rapidjson::Value locationValue;
+			Asset::SaveVector(locationValue, location, &jsonDoc);
+
+			rapidjson::Value adjacentPathArrayValue;
+			adjacentPathArrayValue.SetArray();
+			for (int k : adjacencyArray[i])
+				adjacentPathArrayValue.PushBack(rapidjson::Value().SetInt(k), jsonDoc.GetAllocator());
+
+			rapidjson::Value nodeValue;
+			nodeValue.SetObject();
+			nodeValue.AddMember("location", locationValue, jsonDoc.GetAllocator());
+			nodeValue.AddMember("adj_path_array", adjacentPathArrayValue, jsonDoc.GetAllocator());
+			nodeArrayValue.PushBack(nodeValue, jsonDoc.GetAllocator());
+		}
+
+		jsonDoc.AddMember("node_array", nodeArrayValue, jsonDoc.GetAllocator());
+		jsonDoc.AddMember("path_array", pathArrayValue, jsonDoc.GetAllocator());
+
+		Reference<NavGraph> navGraph(new NavGraph());
+		if (!navGraph->Load(jsonDoc, nullptr))
+			navGraph.Reset();
+
+		return navGraph;
+	}
+
+	/**
+	 * Add up the lengths of the edges taken by the given path.
+	 */
+	double CalcPathLength(const NavGraph::Node* node, const std::vector<int>& pathArray)
+	{
+		double length = 0.0;
+		for (int i : pathArray)
+		{
+			length += node->adjacentPathArray[i]->length;
+			node = node->GetAdjacentNode(i);
+		}
+
+		return length;
+	}
+
+	/**
+	 * Find shortest paths between the same random pairs of nodes, first on the calling
+	 * thread, and then spread across the job system with a search context per thread,
+	 * making sure that both ways give us paths of the same lengths.
+	 */
+	void BenchGraph(const std::string& graphName, const NavGraph* navGraph, int numSearches, std::vector<std::string>& results)
+	{
+		int numNodes = navGraph->GetNumNodes();
+		if (numNodes < 2)
+		{
+			results.push_back(std::format("{}: too few nodes to bench.", graphName.c_str()));
+			return;
+		}
+
+		Random random;
+		random.SetSeed(0);
+		std::vector<std::pair<int, int>> searchArray;
+		for (int i = 0; i < numSearches; i++)
+			searchArray.push_back(std::pair<int, int>(random.InRange(0, numNodes - 1), random.InRange(0, numNodes - 1)));
+
+		std::vector<double> serialLengthArray(numSearches, -1.0);
+		std::vector<int> pathArray;
+		NavGraph::SearchContext context;
+		uint64_t totalNodesExpanded = 0;
+		int numPathsFound = 0;
+
+		Clock clock;
+		clock.Reset();
+
+		for (int i = 0; i < numSearches; i++)
+		{
+			const NavGraph::Node* nodeA = navGraph->GetNode(searchArray[i].first);
+			const NavGraph::Node* nodeB = navGraph->GetNode(searchArray[i].second);
+			if (navGraph->FindShortestPath(nodeA, nodeB, pathArray, context))
+			{
+				serialLengthArray[i] = CalcPathLength(nodeA, pathArray);
+				numPathsFound++;
+			}
+
+			totalNodesExpanded += context.GetNumNodesExpanded();
+		}
+
+		double serialTimeMilliseconds = clock.GetCurrentTimeMilliseconds();
+
+		JobSystem* jobSystem = Game::Get()->GetJobSystem();
+		std::vector<NavGraph::SearchContext> contextArray(jobSystem->GetNumWorkers() + 1);
+		std::vector<double> parallelLengthArray(numSearches, -1.0);
+
+		clock.Reset();
+
+		jobSystem->ParallelFor(numSearches, 16, [&](uint32_t begin, uint32_t end)
+			{
+				int threadIndex = JobSystem::GetThreadIndex();
+				IMZADI_ASSERT(0 <= threadIndex && threadIndex < (int)contextArray.size());
+				NavGraph::SearchContext& threadContext = contextArray[threadIndex];
+				std::vector<int> threadPathArray;
+
+				for (uint32_t i = begin; i < end; i++)
+				{
+					const NavGraph::Node* nodeA = navGraph->GetNode(searchArray[i].first);
+					const NavGraph::Node* nodeB = navGraph->GetNode(searchArray[i].second);
+					if (navGraph->FindShortestPath(nodeA, nodeB, threadPathArray, threadContext))
+						parallelLengthArray[i] = CalcPathLength(nodeA, threadPathArray);
+				}
+			});
+
+		double parallelTimeMilliseconds = clock.GetCurrentTimeMilliseconds();
+
+		int numMismatches = 0;
+		for (int i = 0; i < numSearches; i++)
+			if (::fabs(serialLengthArray[i] - parallelLengthArray[i]) > 1e-6)
+				numMismatches++;
+
+		// Dijkstra's algorithm, as we used to do it, always expanded every node reachable from the start.
+		double averageNodesExpanded = double(totalNodesExpanded) / double(numSearches);
+		results.push_back(std::format("{}: {} nodes, {} paths, {} searches ({} found a path)", graphName.c_str(), numNodes, navGraph->GetNumPaths(), numSearches, numPathsFound));
+		results.push_back(std::format("    nodes expanded per search: {:.1f} ({:.1f}% of the graph)", averageNodesExpanded, 100.0 * averageNodesExpanded / double(numNodes)));
+		results.push_back(std::format("    1 thread:   {:.2f} us/search", serialTimeMilliseconds * 1000.0 / double(numSearches)));
+		results.push_back(std::format("    {} threads: {:.2f} us/search ({:.2f}x)", contextArray.size(), parallelTimeMilliseconds * 1000.0 / double(numSearches), serialTimeMilliseconds / parallelTimeMilliseconds));
+		if (numMismatches > 0)
+			results.push_back(std::format("    ERROR: {} searches found paths of different lengths on different threads!", numMismatches));
+	}
+
+	/**
+	 * Time nearest-node and nearest-path queries at random locations over the given graph, using the
+	 * spatial index, and then by brute force, making sure that both ways find things equally near.
+	 */
+	void BenchQueries(const std::string& graphName, const NavGraph* navGraph, int numQueries, std::vector<std::string>& results)
+	{
+		int numNodes = navGraph->GetNumNodes();
+		int numPaths = navGraph->GetNumPaths();
+		if (numNodes == 0 || numPaths == 0)
+		{
+			results.push_back(std::format("{}: too few nodes to bench.", graphName.c_str()));
+			return;
+		}
+
+		Vector3 minCorner = navGraph->GetNode(0)->location;
+		Vector3 maxCorner = minCorner;
+		for (int i = 0; i < numNodes; i++)
+		{
+			const Vector3& location = navGraph->GetNode(i)->location;
+			minCorner.SetComponents(IMZADI_MIN(minCorner.x, location.x), IMZADI_MIN(minCorner.y, location.y), IMZADI_MIN(minCorner.z, location.z));
+			maxCorner.SetComponents(IMZADI_MAX(maxCorner.x, location.x), IMZADI_MAX(maxCorner.y, location.y), IMZADI_MAX(maxCorner.z, location.z));
+		}
+
+		Random random;
+		random.SetSeed(0);
+		std::vector<Vector3> locationArray;
+		for (int i = 0; i < numQueries; i++)
+		{
+			Vector3 location;
+			location.x = random.InRange(minCorner.x, maxCorner.x);
+			location.y = random.InRange(minCorner.y, maxCorner.y);
+			location.z = random.InRange(minCorner.z, maxCorner.z);
+			locationArray.push_back(location);
+		}
+
+		std::vector<double> indexedDistanceArray;
+		Clock clock;
+		clock.Reset();
+
+		for (const Vector3& location : locationArray)
+		{
+			const NavGraph::Node* node = navGraph->FindNearestNode(location);
+			const NavGraph::Path* path = navGraph->FindNearestPath(location);
+			indexedDistanceArray.push_back((node->location - location).Length() + path->GetPathSegment().ShortestDistanceTo(location));
+		}
+
+		double indexedTimeMilliseconds = clock.GetCurrentTimeMilliseconds();
+
+		std::vector<double> bruteDistanceArray;
+		clock.Reset();
+
+		for (const Vector3& location : locationArray)
+		{
+			double nodeDistance = std::numeric_limits<double>::max();
+			for (int i = 0; i < numNodes; i++)
+				nodeDistance = IMZADI_MIN(nodeDistance, (navGraph->GetNode(i)->location - location).Length());
+
+			double pathDistance = std::numeric_limits<double>::max();
+			for (int i = 0; i < numPaths; i++)
+				pathDistance = IMZADI_MIN(pathDistance, navGraph->GetPath(i)->GetPathSegment().ShortestDistanceTo(location));
+
+			bruteDistanceArray.push_back(nodeDistance + pathDistance);
+		}
+
+		double bruteTimeMilliseconds = clock.GetCurrentTimeMilliseconds();
+
+		int numMismatches = 0;
+		for (int i = 0; i < numQueries; i++)
+			if (::fabs(indexedDistanceArray[i] - bruteDistanceArray[i]) > 1e-6)
+				numMismatches++;
+
+		results.push_back(std::format("{}: {} nodes, {} paths, {} queries", graphName.c_str(), numNodes, numPaths, numQueries));
+		results.push_back(std::format("    brute force:   {:.2f} us/query", bruteTimeMilliseconds * 1000.0 / double(numQueries)));
+		results.push_back(std::format("    spatial index: {:.2f} us/query ({:.2f}x)", indexedTimeMilliseconds * 1000.0 / double(numQueries), bruteTimeMilliseconds / indexedTimeMilliseconds));
+		if (numMismatches > 0)
+			results.push_back(std::format("    ERROR: {} queries found different nearest distances with and without the index!", numMismatches));
+	}
+
+	/**
+	 * Build a hierarchy over a copy of the given graph, and then find paths between random pairs of nodes
+	 * with it and with plain A*, comparing the times and the path lengths.  Then knock an edge out of the
+	 * copy and time how long it takes to bring the hierarchy up-to-date.
+	 */
+	void BenchHierarchy(const std::string& graphName, const NavGraph* navGraph, int numSearches, std::vector<std::string>& results)
+	{
+		int numNodes = navGraph->GetNumNodes();
+		if (numNodes < 2 || navGraph->GetNumPaths() == 0)
+		{
+			results.push_back(std::format("{}: too few nodes to bench.", graphName.c_str()));
+			return;
+		}
+
+		Reference<NavGraph> editGraph(new NavGraph());
+		editGraph->CopyFrom(*navGraph);
+
+		JobSystem* jobSystem = Game::Get()->GetJobSystem();
+		NavGraphHierarchy hierarchy;
+		Clock clock;
+		clock.Reset();
+
+		if (!hierarchy.Build(editGraph, 0.0, jobSystem))
+		{
+			results.push_back(std::format("{}: failed to build hierarchy.", graphName.c_str()));
+			return;
+		}
+
+		double buildTimeMilliseconds = clock.GetCurrentTimeMilliseconds();
+
+		Random random;
+		random.SetSeed(0);
+		std::vector<std::pair<int, int>> searchArray;
+		for (int i = 0; i < numSearches; i++)
+			searchArray.push_back(std::pair<int, int>(random.InRange(0, numNodes - 1), random.InRange(0, numNodes - 1)));
+
+		std::vector<double> flatLengthArray(numSearches, -1.0);
+		std::vector<int> pathArray;
+		NavGraph::SearchContext flatContext;
+		uint64_t flatNodesExpanded = 0;
+		clock.Reset();
+
+		for (int i = 0; i < numSearches; i++)
+		{
+			const NavGraph::Node* nodeA = editGraph->GetNode(searchArray[i].first);
+			const NavGraph::Node* nodeB = editGraph->GetNode(searchArray[i].second);
+			if (editGraph->FindShortestPath(nodeA, nodeB, pathArray, flatContext))
+				flatLengthArray[i] = CalcPathLength(nodeA, pathArray);
+
+			flatNodesExpanded += flatContext.GetNumNodesExpanded();
+		}
+
+		double flatTimeMilliseconds = clock.GetCurrentTimeMilliseconds();
+
+		// This is what an entity pays up-front: the route, and only the first leg of it.
+		NavGraphHierarchy::SearchContext context;
+		NavGraphHierarchy::Route route;
+		uint64_t routeNodesExpanded = 0;
+		clock.Reset();
+
+		for (int i = 0; i < numSearches; i++)
+		{
+			const NavGraph::Node* nodeA = editGraph->GetNode(searchArray[i].first);
+			const NavGraph::Node* nodeB = editGraph->GetNode(searchArray[i].second);
+			if (hierarchy.FindRoute(nodeA, nodeB, route, context))
+			{
+				pathArray.clear();
+				hierarchy.RefineNextLeg(route, pathArray, context);
+			}
+
+			routeNodesExpanded += context.GetNumNodesExpanded();
+		}
+
+		double routeTimeMilliseconds = clock.GetCurrentTimeMilliseconds();
+
+		std::vector<double> hierarchicalLengthArray(numSearches, -1.0);
+		clock.Reset();
+
+		for (int i = 0; i < numSearches; i++)
+		{
+			const NavGraph::Node* nodeA = editGraph->GetNode(searchArray[i].first);
+			const NavGraph::Node* nodeB = editGraph->GetNode(searchArray[i].second);
+			if (hierarchy.FindPath(nodeA, nodeB, pathArray, context))
+				hierarchicalLengthArray[i] = CalcPathLength(nodeA, pathArray);
+		}
+
+		double pathTimeMilliseconds = clock.GetCurrentTimeMilliseconds();
+
+		int numMismatches = 0;
+		int numCompared = 0;
+		double totalRatio = 0.0;
+		double worstRatio = 1.0;
+		for (int i = 0; i < numSearches; i++)
+		{
+			if ((flatLengthArray[i] < 0.0) != (hierarchicalLengthArray[i] < 0.0) || hierarchicalLengthArray[i] < flatLengthArray[i] - 1e-6)
+				numMismatches++;
+			else if (flatLengthArray[i] > 0.0)
+			{
+				double ratio = hierarchicalLengthArray[i] / flatLengthArray[i];
+				totalRatio += ratio;
+				worstRatio = IMZADI_MAX(worstRatio, ratio);
+				numCompared++;
+			}
+		}
+
+		editGraph->RemovePath(random.InRange(0, editGraph->GetNumPaths() - 1));
+		clock.Reset();
+		hierarchy.Update(editGraph, jobSystem);
+		double updateTimeMilliseconds = clock.GetCurrentTimeMilliseconds();
+
+		double averageRatio = (numCompared > 0) ? (totalRatio / double(numCompared)) : 1.0;
+		results.push_back(std::format("{}: {} nodes, {} paths, {} searches", graphName.c_str(), numNodes, navGraph->GetNumPaths(), numSearches));
+		results.push_back(std::format("    hierarchy: {} clusters, {} entrances, {} abstract edges, built in {:.2f} ms", hierarchy.GetNumClusters(), hierarchy.GetNumEntrances(), hierarchy.GetNumAbstractEdges(), buildTimeMilliseconds));
+		results.push_back(std::format("    A*:                 {:.2f} us/search, {:.1f} nodes expanded", flatTimeMilliseconds * 1000.0 / double(numSearches), double(flatNodesExpanded) / double(numSearches)));
+		results.push_back(std::format("    route + first leg:  {:.2f} us/search, {:.1f} nodes expanded ({:.2f}x)", routeTimeMilliseconds * 1000.0 / double(numSearches), double(routeNodesExpanded) / double(numSearches), flatTimeMilliseconds / routeTimeMilliseconds));
+		results.push_back(std::format("    fully refined path: {:.2f} us/search ({:.2f}x)", pathTimeMilliseconds * 1000.0 / double(numSearches), flatTimeMilliseconds / pathTimeMilliseconds));
+		results.push_back(std::format("    path length vs A*:  {:.3f} average, {:.3f} worst", averageRatio, worstRatio));
+		results.push_back(std::format("    update after removing an edge: {:.2f} ms ({} of {} clusters rebuilt)", updateTimeMilliseconds, hierarchy.GetNumClustersLastRebuilt(), hierarchy.GetNumClusters()));
+		if (numMismatches > 0)
+			results.push_back(std::format("    ERROR: {} searches disagreed with A* about whether there was a path, or found a shorter one!", numMismatches));
+	}
+
+	/**
+	 * Put the given number of agents at random nodes of the given graph, all chasing a goal that wanders
+	 * from node to adjacent node.  Time how long it takes every agent to find its own path to the goal, and
+	 * compare that with building a flow field to the goal, and then with updating the field each time the
+	 * goal moves, making sure the updated field agrees with one built from scratch, and with A*.
+	 */
+	void BenchFlowField(const std::string& graphName, const NavGraph* navGraph, int numAgents, std::vector<std::string>& results)
+	{
+		const int numGoalMoves = 50;
+
+		int numNodes = navGraph->GetNumNodes();
+		if (numNodes < 2 || navGraph->GetNumPaths() == 0)
+		{
+			results.push_back(std::format("{}: too few nodes to bench.", graphName.c_str()));
+			return;
+		}
+
+		Random random;
+		random.SetSeed(0);
+		std::vector<const NavGraph::Node*> agentArray;
+		for (int i = 0; i < numAgents; i++)
+			agentArray.push_back(navGraph->GetNode(random.InRange(0, numNodes - 1)));
+
+		const NavGraph::Node* goalNode = navGraph->GetNode(random.InRange(0, numNodes - 1));
+		while (goalNode->adjacentPathArray.size() == 0)
+			goalNode = navGraph->GetNode(random.InRange(0, numNodes - 1));
+
+		// This is what it costs to have every agent find its own way to the goal, just once.
+		std::vector<double> searchDistanceArray(numAgents, std::numeric_limits<double>::infinity());
+		std::vector<int> pathArray;
+		NavGraph::SearchContext context;
+		Clock clock;
+		clock.Reset();
+
+		for (int i = 0; i < numAgents; i++)
+			if (navGraph->FindShortestPath(agentArray[i], goalNode, pathArray, context))
+				searchDistanceArray[i] = CalcPathLength(agentArray[i], pathArray);
+
+		double searchTimeMilliseconds = clock.GetCurrentTimeMilliseconds();
+
+		FlowField flowField;
+		clock.Reset();
+		flowField.Build(navGraph, goalNode);
+		double buildTimeMilliseconds = clock.GetCurrentTimeMilliseconds();
+
+		int numMismatches = 0;
+		for (int i = 0; i < numAgents; i++)
+			if (::fabs(flowField.GetDistanceToGoal(agentArray[i]) - searchDistanceArray[i]) > 1e-6 && flowField.CanReachGoal(agentArray[i]))
+				numMismatches++;
+
+		// Now let the goal wander, and each time it moves, update the field and step every agent along it.
+		FlowField rebuiltField;
+		double updateTimeMilliseconds = 0.0;
+		double rebuildTimeMilliseconds = 0.0;
+		double stepTimeMilliseconds = 0.0;
+		uint64_t totalNodesUpdated = 0;
+		int numFieldMismatches = 0;
+
+		for (int i = 0; i < numGoalMoves; i++)
+		{
+			goalNode = goalNode->GetAdjacentNode(random.InRange(0, (int)goalNode->adjacentPathArray.size() - 1));
+
+			clock.Reset();
+			flowField.SetGoal(navGraph, goalNode);
+			updateTimeMilliseconds += clock.GetCurrentTimeMilliseconds();
+			totalNodesUpdated += flowField.GetNumNodesUpdated();
+
+			clock.Reset();
+			rebuiltField.Build(navGraph, goalNode);
+			rebuildTimeMilliseconds += clock.GetCurrentTimeMilliseconds();
+
+			clock.Reset();
+			for (const NavGraph::Node*& agentNode : agentArray)
+			{
+				const NavGraph::Node* nextNode = flowField.GetNextNode(agentNode);
+				if (nextNode)
+					agentNode = nextNode;
+			}
+			stepTimeMilliseconds += clock.GetCurrentTimeMilliseconds();
+
+			for (int j = 0; j < numNodes; j++)
+			{
+				const NavGraph::Node* node = navGraph->GetNode(j);
+				if (flowField.CanReachGoal(node) != rebuiltField.CanReachGoal(node) ||
+					(flowField.CanReachGoal(node) && ::fabs(flowField.GetDistanceToGoal(node) - rebuiltField.GetDistanceToGoal(node)) > 1e-6))
+				{
+					numFieldMismatches++;
+				}
+			}
+		}
+
+		double averageNodesUpdated = double(totalNodesUpdated) / double(numGoalMoves);
+		results.push_back(std::format("{}: {} nodes, {} paths, {} agents, {} goal moves", graphName.c_str(), numNodes, navGraph->GetNumPaths(), numAgents, numGoalMoves));
+		results.push_back(std::format("    A* for every agent:   {:.3f} ms", searchTimeMilliseconds));
+		results.push_back(std::format("    flow field, built:    {:.3f} ms ({:.1f}x)", buildTimeMilliseconds, searchTimeMilliseconds / buildTimeMilliseconds));
+		results.push_back(std::format("    flow field, rebuilt:  {:.3f} ms/move", rebuildTimeMilliseconds / double(numGoalMoves)));
+		results.push_back(std::format("    flow field, updated:  {:.3f} ms/move, {:.1f} nodes updated ({:.1f}% of the graph)", updateTimeMilliseconds / double(numGoalMoves), averageNodesUpdated, 100.0 * averageNodesUpdated / double(numNodes)));
+		results.push_back(std::format("    next-step lookups:    {:.3f} us/agent", stepTimeMilliseconds * 1000.0 / double(numGoalMoves * numAgents)));
+		if (numMismatches > 0)
+			results.push_back(std::format("    ERROR: {} agents are a different distance from the goal by the flow field than by A*!", numMismatches));
+		if (numFieldMismatches > 0)
+			results.push_back(std::format("    ERROR: {} nodes are a different distance from the goal in the updated field than in the rebuilt one!", numFieldMismatches));
+	}
+}
+
+NavGraphCommand::NavGraphCommand()
+{
+}
+
+/*virtual*/ NavGraphCommand::~NavGraphCommand()
+{
+}
+
+/*virtual*/ std::string NavGraphCommand::GetName()
+{
+	return "nav";
+}
+
+/*virtual*/ std::string NavGraphCommand::GetSyntaxHelp()
+{
+	return "nav [stats|bench|query|hpa|flow|service] <num-searches|num-queries|num-agents|budget-ms>";
+}
+
+/*virtual*/ std::string NavGraphCommand::GetHelpDescription()
+{
+	return "Inspect the nav-graph of the level, or measure how fast paths are found in it.";
+}
+
+/*virtual*/ std::string NavGraphCommand::GetDetailedHelp()
+{
+	return	"nav stats -- Show the size of the level's nav-graph.\n"
+			"nav bench <num-searches> -- Find shortest paths between the given number (default 1000) of random\n"
+			"    pairs of nodes in the level's nav-graph, and in synthetic grid graphs of increasing size, on one\n"
+			"    thread and then on all the job system's threads, and report the average time per search.\n"
+			"nav query <num-queries> -- Find the nearest node and path to the given number (default 1000) of random\n"
+			"    locations in the same graphs, with and without the spatial index, and report the average time per query.\n"
+			"nav hpa <num-searches> -- Find paths between random pairs of nodes in the same graphs with a hierarchy of\n"
+			"    clusters built over them, and with plain A*, and compare the times and the path lengths.\n"
+			"nav flow <num-agents> -- Have the given number (default 1000) of agents in the same graphs chase a goal\n"
+			"    that wanders from node to node, and compare finding every agent a path with A* to sharing a flow field.\n"
+			"nav service <budget-ms> -- Show what the pathfinding service has done since this was last run, and\n"
+			"    optionally set how many milliseconds per frame it may spend on searches.";
+}
+
+/*virtual*/ bool NavGraphCommand::Execute(const std::vector<std::string>& arguments, std::vector<std::string>& results)
+{
+	if (arguments.size() < 1)
+		return false;
+
+	const NavGraph* levelNavGraph = nullptr;
+	std::vector<Level*> foundLevelsArray;
+	Game::Get()->FindAllEntitiesOfType<Level>(foundLevelsArray);
+	if (foundLevelsArray.size() == 1)
+		levelNavGraph = foundLevelsArray[0]->GetNavGraph();
+
+	if (arguments[0] == "stats")
+	{
+		if (!levelNavGraph)
+			results.push_back("The level has no nav-graph.");
+		else
+		{
+			results.push_back(std::format("Nodes: {}", levelNavGraph->GetNumNodes()));
+			results.push_back(std::format("Paths: {}", levelNavGraph->GetNumPaths()));
+			results.push_back(std::format("Spatial index cell size: {:.2f}", levelNavGraph->GetSpatialIndexCellSize()));
+			results.push_back(std::format("Valid: {}", levelNavGraph->IsValid() ? "yes" : "no"));
+		}
+	}
+	else if (arguments[0] == "bench" || arguments[0] == "query" || arguments[0] == "hpa" || arguments[0] == "flow")
+	{
+		int numSearches = (arguments.size() >= 2) ? ::atoi(arguments[1].c_str()) : 1000;
+		if (numSearches <= 0)
+			return false;
+
+		auto benchFunc = BenchGraph;
+		if (arguments[0] == "query")
+			benchFunc = BenchQueries;
+		else if (arguments[0] == "hpa")
+			benchFunc = BenchHierarchy;
+		else if (arguments[0] == "flow")
+			benchFunc = BenchFlowField;
+
+		if (levelNavGraph)
+			benchFunc("level", levelNavGraph, numSearches, results);
+
+		Random random;
+		random.SetSeed(0);
+		int gridSizeArray[] = { 32, 128, 512 };
+		for (int gridSize : gridSizeArray)
+		{
+			Reference<NavGraph> navGraph = MakeGridGraph(gridSize, random);
+			if (!navGraph.Get())
+			{
+				results.push_back(std::format("Failed to make {}x{} grid graph.", gridSize, gridSize));
+				return false;
+			}
+
+			benchFunc(std::format("{}x{} grid", gridSize, gridSize), navGraph.Get(), numSearches, results);
+		}
+	}
+	else if (arguments[0] == "service")
+	{
+		PathfindingService* pathfindingService = Game::Get()->GetPathfindingService();
+
+		if (arguments.size() >= 2)
+		{
+			double timeBudgetMilliseconds = ::atof(arguments[1].c_str());
+			if (timeBudgetMilliseconds <= 0.0)
+				return false;
+
+			pathfindingService->SetTimeBudgetMilliseconds(timeBudgetMilliseconds);
+		}
+
+		PathfindingService::Stats stats;
+		pathfindingService->GetStats(stats);
+		pathfindingService->ResetStats();
+
+		results.push_back(std::format("Time budget: {:.2f} ms/frame", pathfindingService->GetTimeBudgetMilliseconds()));
+		results.push_back(std::format("Requests: {}", stats.numRequests));
+		results.push_back(std::format("    cache hits:   {}", stats.numCacheHits));
+		results.push_back(std::format("    deduplicated: {}", stats.numDeduplicated));
+		results.push_back(std::format("Searches finished: {}", stats.numSearches));
+		results.push_back(std::format("Searches pending: {}", stats.numPending));
+		results.push_back(std::format("Ticks out of time: {}", stats.numTimeSlicedTicks));
+		results.push_back(std::format("Last tick: {:.3f} ms", stats.lastTickMilliseconds));
+	}
+	else
+		return false;
+
+	return true;
+}
\ No newline at end of file
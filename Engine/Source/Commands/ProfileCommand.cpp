@@ -0,0 +1,122 @@
+#include "ProfileCommand.h"
+#include "Profile.h"
+#include "Clock.h"
+#include <format>
+#include <sstream>
+
+using namespace Imzadi;
+
+static ProfileCommand profileCommand;
+
+ProfileCommand::ProfileCommand()
+{
+}
+
+/*virtual*/ ProfileCommand::~ProfileCommand()
+{
+}
+
+/*virtual*/ std::string ProfileCommand::GetName()
+{
+	return "profile";
+}
+
+/*virtual*/ std::string ProfileCommand::GetSyntaxHelp()
+{
+	return "profile [on|off|stats|trace|bench] <num-frames|file-path> <num-frames>";
+}
+
+/*virtual*/ std::string ProfileCommand::GetHelpDescription()
+{
+	return "Control the profiler, summarize what it has recorded, or export it as a trace.";
+}
+
+/*virtual*/ std::string ProfileCommand::GetDetailedHelp()
+{
+	return	"profile on|off -- Turn recording of profile samples on or off.\n"
+			"profile stats <num-frames> -- Summarize, per thread, the time spent in each profile zone\n"
+			"    over the given number of most recent frames (default 1).\n"
+			"profile trace <file-path> <num-frames> -- Write the given number of most recent frames (default 10)\n"
+			"    of all threads to the given file in the Chrome trace event format.  Open it with\n"
+			"    chrome://tracing or https://ui.perfetto.dev.\n"
+			"profile bench -- Measure the cost of hitting a profile zone.";
+}
+
+/*virtual*/ bool ProfileCommand::Execute(const std::vector<std::string>& arguments, std::vector<std::string>& results)
+{
+	if (arguments.size() < 1)
+		return false;
+
+	Profiler* profiler = Profiler::Get();
+
+	if (arguments[0] == "on")
+	{
+		profiler->SetEnabled(true);
+		results.push_back("Profiling is on.");
+	}
+	else if (arguments[0] == "off")
+	{
+		profiler->SetEnabled(false);
+		results.push_back("Profiling is off.");
+	}
+	else if (arguments[0] == "stats")
+	{
+		int numFrames = (arguments.size() >= 2) ? ::atoi(arguments[1].c_str()) : 1;
+		if (numFrames <= 0)
+			return false;
+
+		std::istringstream stream(profiler->PrintFrameStats(numFrames));
+		std::string line;
+		while (std::getline(stream, line))
+			results.push_back(line);
+	}
+	else if (arguments[0] == "trace")
+	{
+		if (arguments.size() < 2)
+			return false;
+
+		int numFrames = (arguments.size() >= 3) ? ::atoi(arguments[2].c_str()) : 10;
+		if (numFrames <= 0)
+			return false;
+
+		if (!profiler->ExportChromeTrace(arguments[1], numFrames))
+			return false;
+
+		results.push_back(std::format("Wrote {} frames to {}.", numFrames, arguments[1].c_str()));
+	}
+	else if (arguments[0] == "bench")
+	{
+		const int numIterations = 1000000;
+		bool wasEnabled = profiler->IsEnabled();
+
+		// Each pass hits a nested pair of zones, which is the common case.
+		auto hitZones = [numIterations]() -> double
+		{
+			Clock clock;
+			clock.Reset();
+
+			for (int i = 0; i < numIterations; i++)
+			{
+				IMZADI_PROFILE("Bench Outer");
+				{
+					IMZADI_PROFILE("Bench Inner");
+				}
+			}
+
+			return clock.GetCurrentTimeMilliseconds() * 1e6 / double(2 * numIterations);
+		};
+
+		profiler->SetEnabled(true);
+		double enabledTime = hitZones();
+		profiler->SetEnabled(false);
+		double disabledTime = hitZones();
+		profiler->SetEnabled(wasEnabled);
+
+		results.push_back(std::format("Enabled: {:.1f} ns/zone", enabledTime));
+		results.push_back(std::format("Disabled: {:.1f} ns/zone", disabledTime));
+	}
+	else
+		return false;
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "Command.h"
+
+namespace Imzadi
+{
+	/**
+	 * This command can be used to look at what the profiler has recorded, or to export it as a trace.
+	 */
+	class IMZADI_API ProfileCommand : public ConsoleCommand
+	{
+	public:
+		ProfileCommand();
+		virtual ~ProfileCommand();
+
+		virtual std::string GetName() override;
+		virtual std::string GetSyntaxHelp() override;
+		virtual std::string GetHelpDescription() override;
+		virtual std::string GetDetailedHelp() override;
+		virtual bool Execute(const std::vector<std::string>& arguments, std::vector<std::string>& results) override;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "ReferenceCommand.h"
+#include "Reference.h"
+#include "Scene.h"
+#include "Game.h"
+#include "Clock.h"
+#include <format>
+#include <unordered_map>
+#include <functional>
+
+using namespace Imzadi;
+
+static ReferenceCommand referenceCommand;
+
+namespace
+{
+	class BenchObject : public ReferenceCounted
+	{
+	public:
+		BenchObject(RefCountPolicy refCountPolicy) : ReferenceCounted(refCountPolicy)
+		{
+			this->value = 1;
+		}
+
+		uint32_t value;
+	};
+
+	typedef std::unordered_map<std::string, Reference<BenchObject>> BenchObjectMap;
+
+	/**
+	 * Time the given function over the given number of frames and return the average number of nanoseconds per frame.
+	 */
+	double TimeFrames(int numFrames, const std::function<uint32_t()>& frameFunc, uint32_t& checksum)
+	{
+		Clock clock;
+		clock.Reset();
+
+		for (int i = 0; i < numFrames; i++)
+			checksum += frameFunc();
+
+		return clock.GetCurrentTimeMilliseconds() * 1e6 / double(numFrames);
+	}
+}
+
+ReferenceCommand::ReferenceCommand()
+{
+}
+
+/*virtual*/ ReferenceCommand::~ReferenceCommand()
+{
+}
+
+/*virtual*/ std::string ReferenceCommand::GetName()
+{
+	return "refs";
+}
+
+/*virtual*/ std::string ReferenceCommand::GetSyntaxHelp()
+{
+	return "refs [stats|bench] <num-frames>";
+}
+
+/*virtual*/ std::string ReferenceCommand::GetHelpDescription()
+{
+	return "Measure the cost of reference counting.";
+}
+
+/*virtual*/ std::string ReferenceCommand::GetDetailedHelp()
+{
+	return	"refs stats -- Estimate how many ref-count operations per frame the scene's loops used to\n"
+			"    make by copying references, which they no longer do.\n"
+			"refs bench <num-frames> -- Walk a map of references the way the scene does, and fill an array of\n"
+			"    references, for the given number of frames (default 100), copying versus borrowing or moving\n"
+			"    the references, for both atomic and single-threaded ref-counts, and report the average frame time.";
+}
+
+/*virtual*/ bool ReferenceCommand::Execute(const std::vector<std::string>& arguments, std::vector<std::string>& results)
+{
+	if (arguments.size() < 1)
+		return false;
+
+	if (arguments[0] == "stats")
+	{
+		// Each copy of a reference is an increment and a decrement.  The scene walks its render
+		// objects when preparing them, just before rendering, and then once per render pass.
+		uint32_t numRenderObjects = Game::Get()->GetScene()->GetNumRenderObjects();
+		const uint32_t numSceneWalks = 4;
+		results.push_back(std::format("Render objects in scene: {}", numRenderObjects));
+		results.push_back(std::format("Ref-count ops per frame when copying in scene walks: {}", numRenderObjects * numSceneWalks * 2));
+		results.push_back("Ref-count ops per frame when borrowing in scene walks: 0");
+	}
+	else if (arguments[0] == "bench")
+	{
+		int numFrames = (arguments.size() >= 2) ? ::atoi(arguments[1].c_str()) : 100;
+		if (numFrames <= 0)
+			return false;
+
+		const uint32_t numObjects = 4096;
+		uint32_t checksum = 0;
+
+		ReferenceCounted::RefCountPolicy policyArray[] = { ReferenceCounted::RefCountPolicy::THREAD_SAFE, ReferenceCounted::RefCountPolicy::SINGLE_THREADED };
+		for (ReferenceCounted::RefCountPolicy policy : policyArray)
+		{
+			BenchObjectMap objectMap;
+			for (uint32_t i = 0; i < numObjects; i++)
+				objectMap.insert(std::pair<std::string, Reference<BenchObject>>(std::format("object{}", i), new BenchObject(policy)));
+
+			double copyWalkTime = TimeFrames(numFrames, [&objectMap]() -> uint32_t {
+				uint32_t sum = 0;
+				for (auto pair : objectMap)
+					sum += pair.second->value;
+				return sum;
+			}, checksum);
+
+			double borrowWalkTime = TimeFrames(numFrames, [&objectMap]() -> uint32_t {
+				uint32_t sum = 0;
+				for (auto& pair : objectMap)
+				{
+					BorrowedReference<BenchObject> object(pair.second);
+					sum += object->value;
+				}
+				return sum;
+			}, checksum);
+
+			double copyFillTime = TimeFrames(numFrames, [&objectMap]() -> uint32_t {
+				std::vector<Reference<BenchObject>> objectArray;
+				for (auto& pair : objectMap)
+				{
+					Reference<BenchObject> object(pair.second);
+					objectArray.push_back(object);
+				}
+				return (uint32_t)objectArray.size();
+			}, checksum);
+
+			double moveFillTime = TimeFrames(numFrames, [&objectMap]() -> uint32_t {
+				std::vector<Reference<BenchObject>> objectArray;
+				for (auto& pair : objectMap)
+				{
+					Reference<BenchObject> object(pair.second);
+					objectArray.push_back(std::move(object));
+				}
+				return (uint32_t)objectArray.size();
+			}, checksum);
+
+			const char* policyName = (policy == ReferenceCounted::RefCountPolicy::THREAD_SAFE) ? "atomic" : "single-threaded";
+			results.push_back(std::format("{} ref-counts, {} objects:", policyName, numObjects));
+			results.push_back(std::format("    map walk, copying:   {:.0f} ns/frame", copyWalkTime));
+			results.push_back(std::format("    map walk, borrowing: {:.0f} ns/frame ({:.2f}x)", borrowWalkTime, copyWalkTime / borrowWalkTime));
+			results.push_back(std::format("    array fill, copying: {:.0f} ns/frame", copyFillTime));
+			results.push_back(std::format("    array fill, moving:  {:.0f} ns/frame ({:.2f}x)", moveFillTime, copyFillTime / moveFillTime));
+		}
+
+		results.push_back(std::format("(checksum {})", checksum));
+	}
+	else
+		return false;
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "Command.h"
+
+namespace Imzadi
+{
+	/**
+	 * This command can be used to measure the cost of the ref-count traffic typical of a frame.
+	 */
+	class IMZADI_API ReferenceCommand : public ConsoleCommand
+	{
+	public:
+		ReferenceCommand();
+		virtual ~ReferenceCommand();
+
+		virtual std::string GetName() override;
+		virtual std::string GetSyntaxHelp() override;
+		virtual std::string GetHelpDescription() override;
+		virtual std::string GetDetailedHelp() override;
+		virtual bool Execute(const std::vector<std::string>& arguments, std::vector<std::string>& results) override;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,747 @@
+#include "SceneCommand.h"
+#include "Scene.h"
+#include "SceneTree.h"
+#include "ShadowCascades.h"
+#include "RenderQueue.h"
+#include "Camera.h"
+#include "Game.h"
+#include "Clock.h"
+#include "JobSystem.h"
+#include "Math/Random.h"
+#include "Math/Polygon.h"
+#include "Math/Ray.h"
+#include "Math/Plane.h"
+#include <unordered_map>
+#include <algorithm>
+#include <format>
+
+using namespace Imzadi;
+
+static SceneCommand sceneCommand;
+
+namespace
+{
+	/**
+	 * This stands in for a render object in the culling benchmark.  It draws nothing.
+	 */
+	class CullBenchObject : public RenderObject
+	{
+	public:
+		virtual void Render(Camera* camera, RenderPass renderPass) override
+		{
+		}
+
+		virtual bool GetWorldBoundingSphere(Vector3& center, double& radius) const override
+		{
+			center = this->center;
+			radius = this->radius;
+			return true;
+		}
+
+		Vector3 center;
+		Vector3 velocity;
+		double radius;
+		int index;
+	};
+
+	/**
+	 * Scatter the given number of objects over a large, flat area, some of them moving, and view them from
+	 * a camera circling about.  Each frame, cull them by testing every one against the camera the way the
+	 * scene used to, and by using a scene tree, keeping the tree up-to-date with the objects as they move.
+	 */
+	void BenchCulling(int numObjects, int numFrames, std::vector<std::string>& results)
+	{
+		const double worldHalfSize = 1000.0;
+
+		Random random;
+		random.SetSeed(0);
+
+		std::vector<Reference<CullBenchObject>> objectArray;
+		std::unordered_map<std::string, Reference<RenderObject>> objectMap;
+		SceneTree sceneTree;
+
+		for (int i = 0; i < numObjects; i++)
+		{
+			Reference<CullBenchObject> object(new CullBenchObject());
+			object->SetName(std::format("object{}", i));
+			object->index = i;
+			object->center.SetComponents(random.InRange(-worldHalfSize, worldHalfSize), random.InRange(0.0, 50.0), random.InRange(-worldHalfSize, worldHalfSize));
+			object->radius = (random.InRange(0, 99) == 0) ? random.InRange(50.0, 200.0) : random.InRange(0.5, 8.0);
+			if (random.InRange(0, 4) == 0)
+				object->velocity.SetComponents(random.InRange(-5.0, 5.0), 0.0, random.InRange(-5.0, 5.0));
+
+			objectArray.push_back(object);
+			objectMap.insert(std::pair<std::string, Reference<RenderObject>>(object->GetName(), object.Get()));
+			sceneTree.Insert(object.Get());
+		}
+
+		sceneTree.RebuildIfNecessary();
+
+		Reference<Camera> camera(new Camera());
+		Frustum frustum;
+		frustum.SetFromAspectRatio(16.0 / 9.0, M_PI / 3.0, 0.1, 600.0);
+		camera->SetFrustum(frustum);
+
+		double updateTimeMilliseconds = 0.0;
+		double bruteTimeMilliseconds = 0.0;
+		double treeTimeMilliseconds = 0.0;
+		uint64_t totalVisible = 0, totalCellsVisited = 0, totalCellsAccepted = 0, totalSpheresTested = 0;
+		int numMissed = 0, numExtra = 0;
+		std::vector<RenderObject*> bruteVisibleArray, treeVisibleArray;
+		std::vector<int> visibleFlagArray(numObjects, 0);
+		Clock clock;
+
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			for (Reference<CullBenchObject>& object : objectArray)
+			{
+				object->center += object->velocity;
+				if (::fabs(object->center.x) > worldHalfSize)
+					object->velocity.x = -object->velocity.x;
+				if (::fabs(object->center.z) > worldHalfSize)
+					object->velocity.z = -object->velocity.z;
+			}
+
+			double angle = 2.0 * M_PI * double(frame) / double(numFrames);
+			Vector3 eyePoint(0.8 * worldHalfSize * ::cos(angle), 60.0, 0.8 * worldHalfSize * ::sin(angle));
+			Vector3 focalPoint(0.3 * worldHalfSize * ::cos(3.0 * angle), 0.0, 0.3 * worldHalfSize * ::sin(2.0 * angle));
+			camera->LookAt(eyePoint, focalPoint, Vector3(0.0, 1.0, 0.0));
+
+			// This is what the scene does in its pre-render.
+			clock.Reset();
+			for (auto& pair : objectMap)
+				sceneTree.Update(pair.second.Get());
+			sceneTree.RebuildIfNecessary();
+			updateTimeMilliseconds += clock.GetCurrentTimeMilliseconds();
+
+			clock.Reset();
+			bruteVisibleArray.clear();
+			for (auto& pair : objectMap)
+				if (camera->IsApproximatelyVisible(pair.second.Get()))
+					bruteVisibleArray.push_back(pair.second.Get());
+			bruteTimeMilliseconds += clock.GetCurrentTimeMilliseconds();
+
+			clock.Reset();
+			treeVisibleArray.clear();
+			SceneTree::CullStats cullStats{};
+			sceneTree.FindVisibleObjects(camera.Get(), treeVisibleArray, &cullStats);
+			treeTimeMilliseconds += clock.GetCurrentTimeMilliseconds();
+
+			totalVisible += bruteVisibleArray.size();
+			totalCellsVisited += cullStats.numCellsVisited;
+			totalCellsAccepted += cullStats.numCellsAccepted;
+			totalSpheresTested += cullStats.numSpheresTested;
+
+			// The tree may be a little more generous than testing one by one, but it must not miss anything.
+			for (RenderObject* renderObject : treeVisibleArray)
+				visibleFlagArray[((CullBenchObject*)renderObject)->index] = frame + 1;
+			for (RenderObject* renderObject : bruteVisibleArray)
+				if (visibleFlagArray[((CullBenchObject*)renderObject)->index] != frame + 1)
+					numMissed++;
+			numExtra += int(treeVisibleArray.size()) - int(bruteVisibleArray.size() - numMissed);
+		}
+
+		double frames = double(numFrames);
+		results.push_back(std::format("{} objects, {} frames, {:.1f} visible per frame", numObjects, numFrames, double(totalVisible) / frames));
+		results.push_back(std::format("    one by one:   {:.3f} ms/cull", bruteTimeMilliseconds / frames));
+		results.push_back(std::format("    scene tree:   {:.3f} ms/cull ({:.1f}x), {:.3f} ms/frame to update", treeTimeMilliseconds / frames, bruteTimeMilliseconds / treeTimeMilliseconds, updateTimeMilliseconds / frames));
+		results.push_back(std::format("    per cull:     {:.1f} cells visited, {:.1f} accepted whole, {:.1f} spheres tested", double(totalCellsVisited) / frames, double(totalCellsAccepted) / frames, double(totalSpheresTested) / frames));
+		results.push_back(std::format("    {} cells, {} objects out of bounds, {} rebuilds, {:.2f} extra objects per cull", sceneTree.GetNumCells(), sceneTree.GetNumOverflowObjects(), sceneTree.GetNumRebuilds(), double(numExtra) / frames));
+		if (numMissed > 0)
+			results.push_back(std::format("    ERROR: The scene tree culled {} objects that were visible!", numMissed));
+
+		sceneTree.Clear();
+	}
+
+	/**
+	 * Scatter the given number of objects over a large, flat area, and view them from a camera circling
+	 * about.  Each frame, fit shadow cascades to the view and cull the shadow casters of each against a
+	 * scene tree.  Before cascades, the one light camera culled nothing, so every object cast a shadow.
+	 * Make sure that everything centered in view within shadow range is seen by some cascade, so that
+	 * no receiver goes without shadows, and that the tree agrees with testing casters one by one.
+	 */
+	void BenchShadowCascades(int numObjects, int numFrames, std::vector<std::string>& results)
+	{
+		const double worldHalfSize = 1000.0;
+
+		Random random;
+		random.SetSeed(0);
+
+		std::vector<Reference<CullBenchObject>> objectArray;
+		SceneTree sceneTree;
+
+		for (int i = 0; i < numObjects; i++)
+		{
+			Reference<CullBenchObject> object(new CullBenchObject());
+			object->index = i;
+			object->center.SetComponents(random.InRange(-worldHalfSize, worldHalfSize), random.InRange(0.0, 50.0), random.InRange(-worldHalfSize, worldHalfSize));
+			object->radius = (random.InRange(0, 99) == 0) ? random.InRange(50.0, 200.0) : random.InRange(0.5, 8.0);
+			objectArray.push_back(object);
+			sceneTree.Insert(object.Get());
+		}
+
+		sceneTree.RebuildIfNecessary();
+
+		Reference<Camera> camera(new Camera());
+		Frustum frustum;
+		frustum.SetFromAspectRatio(16.0 / 9.0, M_PI / 3.0, 0.1, 1000.0);
+		camera->SetFrustum(frustum);
+
+		ShadowCascades shadowCascades;
+		Vector3 lightDirection = Vector3(0.2, -1.0, 0.2).Normalized();
+		const double casterDistance = 200.0;
+
+		double fitTimeMilliseconds = 0.0;
+		double cullTimeMilliseconds = 0.0;
+		uint64_t totalCasters[ShadowCascades::MAX_CASCADES] = { 0, 0, 0, 0 };
+		uint64_t totalDistinctCasters = 0;
+		int numUncovered = 0, numMissed = 0;
+		std::vector<RenderObject*> casterArray;
+		std::vector<int> casterFlagArray(numObjects, 0);
+		std::vector<int> cascadeFlagArray(numObjects, 0);
+		Clock clock;
+
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			double angle = 2.0 * M_PI * double(frame) / double(numFrames);
+			Vector3 eyePoint(0.8 * worldHalfSize * ::cos(angle), 60.0, 0.8 * worldHalfSize * ::sin(angle));
+			Vector3 focalPoint(0.3 * worldHalfSize * ::cos(3.0 * angle), 0.0, 0.3 * worldHalfSize * ::sin(2.0 * angle));
+			camera->LookAt(eyePoint, focalPoint, Vector3(0.0, 1.0, 0.0));
+
+			clock.Reset();
+			shadowCascades.Update(camera.Get(), lightDirection, casterDistance);
+			fitTimeMilliseconds += clock.GetCurrentTimeMilliseconds();
+
+			for (int i = 0; i < shadowCascades.GetNumCascades(); i++)
+			{
+				const Camera* lightCamera = shadowCascades.GetCascadeCamera(i);
+				int cascadeFlag = frame * ShadowCascades::MAX_CASCADES + i + 1;
+
+				clock.Reset();
+				casterArray.clear();
+				sceneTree.FindVisibleObjects(lightCamera, casterArray);
+				cullTimeMilliseconds += clock.GetCurrentTimeMilliseconds();
+
+				totalCasters[i] += casterArray.size();
+				for (RenderObject* renderObject : casterArray)
+				{
+					int index = ((CullBenchObject*)renderObject)->index;
+					if (casterFlagArray[index] != frame + 1)
+						totalDistinctCasters++;
+					casterFlagArray[index] = frame + 1;
+					cascadeFlagArray[index] = cascadeFlag;
+				}
+
+				for (Reference<CullBenchObject>& object : objectArray)
+					if (cascadeFlagArray[object->index] != cascadeFlag && lightCamera->IsApproximatelyVisible(object.Get()))
+						numMissed++;
+			}
+
+			// Anything centered in view within shadow range is a receiver, and must be seen by some cascade.
+			Frustum shadowFrustum = frustum;
+			shadowFrustum.farClip = shadowCascades.GetFarDistance(shadowCascades.GetNumCascades() - 1);
+			for (Reference<CullBenchObject>& object : objectArray)
+			{
+				if (casterFlagArray[object->index] == frame + 1)
+					continue;
+
+				Vector3 cameraCenter = camera->GetWorldToCameraTransform().TransformPoint(object->center);
+				if (shadowFrustum.IntersectedBySphere(cameraCenter, 0.0))
+					numUncovered++;
+			}
+		}
+
+		double frames = double(numFrames);
+		int lastCascade = shadowCascades.GetNumCascades() - 1;
+		results.push_back(std::format("{} objects, {} frames, {} cascades out to {:.1f}", numObjects, numFrames, shadowCascades.GetNumCascades(), shadowCascades.GetFarDistance(lastCascade)));
+		results.push_back(std::format("    one light camera: {} casters drawn per frame", numObjects));
+		results.push_back(std::format("    cascades:         {:.1f} distinct casters per frame, {:.3f} ms to fit, {:.3f} ms to cull", double(totalDistinctCasters) / frames, fitTimeMilliseconds / frames, cullTimeMilliseconds / frames));
+		for (int i = 0; i < shadowCascades.GetNumCascades(); i++)
+			results.push_back(std::format("    cascade {}: [{:.1f}, {:.1f}], {:.1f} casters per frame", i, shadowCascades.GetNearDistance(i), shadowCascades.GetFarDistance(i), double(totalCasters[i]) / frames));
+		if (numUncovered > 0)
+			results.push_back(std::format("    ERROR: {} objects in view went uncovered by any cascade!", numUncovered));
+		if (numMissed > 0)
+			results.push_back(std::format("    ERROR: The scene tree culled {} casters that a light camera could see!", numMissed));
+
+		sceneTree.Clear();
+	}
+
+	/**
+	 * Add to the given array a wall standing on the ground from one given point to the other.
+	 */
+	void AddWall(const Vector3& pointA, const Vector3& pointB, double height, std::vector<Polygon>& polygonArray)
+	{
+		Polygon polygon;
+		polygon.vertexArray.push_back(pointA);
+		polygon.vertexArray.push_back(pointB);
+		polygon.vertexArray.push_back(pointB + Vector3(0.0, height, 0.0));
+		polygon.vertexArray.push_back(pointA + Vector3(0.0, height, 0.0));
+		polygonArray.push_back(polygon);
+	}
+
+	/**
+	 * Build a grid of rooms, with doors between some of them, and scatter the given number of objects
+	 * throughout.  Then look around from the middle room, culling the objects by frustum, and then
+	 * by occlusion, with the walls as occluders.  Every object found to be occluded is checked by
+	 * casting rays from the eye at points on it in view, which must all hit a wall before reaching it.
+	 */
+	void BenchOcclusion(int numObjects, int numFrames, std::vector<std::string>& results)
+	{
+		const int numRooms = 15;
+		const double roomSize = 40.0;
+		const double wallHeight = 12.0;
+		const double doorWidth = 10.0;
+		const double mazeSize = double(numRooms) * roomSize;
+
+		Random random;
+		random.SetSeed(0);
+
+		std::vector<Polygon> wallArray;
+		for (int i = 0; i <= numRooms; i++)
+		{
+			for (int j = 0; j < numRooms; j++)
+			{
+				for (int k = 0; k < 2; k++)
+				{
+					auto wallPoint = [k, i, roomSize](double along) -> Vector3 {
+						return (k == 0) ? Vector3(double(i) * roomSize, 0.0, along) : Vector3(along, 0.0, double(i) * roomSize);
+					};
+
+					double start = double(j) * roomSize;
+					double end = start + roomSize;
+					if (i == 0 || i == numRooms || random.InRange(0, 3) == 0)
+					{
+						AddWall(wallPoint(start), wallPoint(end), wallHeight, wallArray);
+					}
+					else
+					{
+						double middle = (start + end) / 2.0;
+						AddWall(wallPoint(start), wallPoint(middle - doorWidth / 2.0), wallHeight, wallArray);
+						AddWall(wallPoint(middle + doorWidth / 2.0), wallPoint(end), wallHeight, wallArray);
+					}
+				}
+			}
+		}
+
+		Polygon ground;
+		ground.vertexArray.push_back(Vector3(0.0, 0.0, 0.0));
+		ground.vertexArray.push_back(Vector3(0.0, 0.0, mazeSize));
+		ground.vertexArray.push_back(Vector3(mazeSize, 0.0, mazeSize));
+		ground.vertexArray.push_back(Vector3(mazeSize, 0.0, 0.0));
+		wallArray.push_back(ground);
+
+		std::vector<Reference<CullBenchObject>> objectArray;
+		for (int i = 0; i < numObjects; i++)
+		{
+			Reference<CullBenchObject> object(new CullBenchObject());
+			object->index = i;
+			object->center.SetComponents(random.InRange(0.0, mazeSize), random.InRange(1.0, 10.0), random.InRange(0.0, mazeSize));
+			object->radius = random.InRange(0.3, 2.0);
+			objectArray.push_back(object);
+		}
+
+		OcclusionCuller occlusionCuller;
+		occlusionCuller.SetOccluders(wallArray);
+
+		Reference<Camera> camera(new Camera());
+		Frustum frustum;
+		frustum.SetFromAspectRatio(16.0 / 9.0, M_PI / 3.0, 0.1, 1000.0);
+		camera->SetFrustum(frustum);
+
+		JobSystem* jobSystem = Game::Get()->GetJobSystem();
+		double serialTimeMilliseconds = 0.0;
+		double parallelTimeMilliseconds = 0.0;
+		double testTimeMilliseconds = 0.0;
+		uint64_t totalInFrustum = 0, totalOccluded = 0, totalTrianglesRasterized = 0, totalChecked = 0;
+		int numSuspects = 0;
+		std::vector<CullBenchObject*> frustumVisibleArray, occludedArray;
+		Clock clock;
+
+		Vector3 eyePoint(mazeSize / 2.0, 6.0, mazeSize / 2.0);
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			double angle = 2.0 * M_PI * double(frame) / double(numFrames);
+			camera->LookAt(eyePoint, eyePoint + Vector3(::cos(angle), -0.05, ::sin(angle)), Vector3(0.0, 1.0, 0.0));
+
+			frustumVisibleArray.clear();
+			for (Reference<CullBenchObject>& object : objectArray)
+				if (camera->IsApproximatelyVisible(object.Get()))
+					frustumVisibleArray.push_back(object.Get());
+
+			clock.Reset();
+			occlusionCuller.Rasterize(camera.Get(), nullptr);
+			serialTimeMilliseconds += clock.GetCurrentTimeMilliseconds();
+
+			clock.Reset();
+			occlusionCuller.Rasterize(camera.Get(), jobSystem);
+			parallelTimeMilliseconds += clock.GetCurrentTimeMilliseconds();
+
+			clock.Reset();
+			occludedArray.clear();
+			for (CullBenchObject* object : frustumVisibleArray)
+				if (occlusionCuller.IsOccluded(object))
+					occludedArray.push_back(object);
+			testTimeMilliseconds += clock.GetCurrentTimeMilliseconds();
+
+			totalInFrustum += frustumVisibleArray.size();
+			totalOccluded += occludedArray.size();
+			totalTrianglesRasterized += occlusionCuller.GetStats().numTrianglesRasterized;
+
+			// Casting rays at everything is slow, so only check some of the frames.
+			if (frame % 10 != 0)
+				continue;
+
+			std::vector<Plane> viewPlaneArray;
+			camera->GetWorldFrustumPlanes(viewPlaneArray);
+
+			for (CullBenchObject* object : occludedArray)
+			{
+				totalChecked++;
+
+				std::vector<Vector3> samplePointArray;
+				samplePointArray.push_back(object->center);
+				samplePointArray.push_back(object->center + Vector3(object->radius, 0.0, 0.0));
+				samplePointArray.push_back(object->center - Vector3(object->radius, 0.0, 0.0));
+				samplePointArray.push_back(object->center + Vector3(0.0, object->radius, 0.0));
+				samplePointArray.push_back(object->center - Vector3(0.0, object->radius, 0.0));
+				samplePointArray.push_back(object->center + Vector3(0.0, 0.0, object->radius));
+				samplePointArray.push_back(object->center - Vector3(0.0, 0.0, object->radius));
+
+				// The edges of an object are what peek out past an occluder first, so also sample the
+				// silhouette: the circle where rays from the eye just graze the bounding sphere.
+				Vector3 eyeToCenter = object->center - eyePoint;
+				double centerDistance = eyeToCenter.Length();
+				if (centerDistance > object->radius)
+				{
+					Vector3 viewDirection = eyeToCenter / centerDistance;
+					Vector3 axisU;
+					axisU.SetAsOrthogonalTo(viewDirection);
+					axisU = axisU.Normalized();
+					Vector3 axisV = viewDirection.Cross(axisU);
+
+					double squaredRadius = object->radius * object->radius;
+					Vector3 rimCenter = object->center - viewDirection * (squaredRadius / centerDistance);
+					double rimRadius = object->radius * ::sqrt(centerDistance * centerDistance - squaredRadius) / centerDistance;
+
+					constexpr int numRimPoints = 16;
+					for (int i = 0; i < numRimPoints; i++)
+					{
+						double angle = 2.0 * M_PI * double(i) / double(numRimPoints);
+						samplePointArray.push_back(rimCenter + (axisU * ::cos(angle) + axisV * ::sin(angle)) * rimRadius);
+					}
+				}
+
+				for (const Vector3& samplePoint : samplePointArray)
+				{
+					// What's outside of the view can't be seen whether it's occluded or not.
+					bool inView = true;
+					for (const Plane& plane : viewPlaneArray)
+						if (plane.SignedDistanceTo(samplePoint) > 0.0)
+							inView = false;
+
+					if (!inView)
+						continue;
+
+					Vector3 delta = samplePoint - eyePoint;
+					double distance = delta.Length();
+					Ray ray(eyePoint, delta / distance);
+
+					bool blocked = false;
+					for (const Polygon& wall : wallArray)
+					{
+						double alpha = 0.0;
+						Vector3 normal;
+						if (wall.RayCast(ray, alpha, normal) && alpha < distance)
+						{
+							blocked = true;
+							break;
+						}
+					}
+
+					if (!blocked)
+					{
+						numSuspects++;
+						break;
+					}
+				}
+			}
+		}
+
+		double frames = double(numFrames);
+		const OcclusionCuller::Stats& stats = occlusionCuller.GetStats();
+		results.push_back(std::format("{} objects, {} frames, {} occluder triangles, {:.1f} rasterized per frame", numObjects, numFrames, stats.numOccluderTriangles, double(totalTrianglesRasterized) / frames));
+		results.push_back(std::format("    {:.1f} objects in the frustum per frame, {:.1f} of them occluded ({:.1f}%)", double(totalInFrustum) / frames, double(totalOccluded) / frames, 100.0 * double(totalOccluded) / double(IMZADI_MAX(totalInFrustum, 1ULL))));
+		results.push_back(std::format("    rasterize:    {:.3f} ms serial, {:.3f} ms on the job system ({:.1f}x)", serialTimeMilliseconds / frames, parallelTimeMilliseconds / frames, serialTimeMilliseconds / parallelTimeMilliseconds));
+		results.push_back(std::format("    test:         {:.3f} ms/frame", testTimeMilliseconds / frames));
+		results.push_back(std::format("    {} occluded objects checked by ray-cast, {} had a point in view the eye can see", totalChecked, numSuspects));
+	}
+
+	/**
+	 * This stands in for a mesh instance in the render queue benchmark.  It submits one packet
+	 * for its mesh, and draws it by binding through the queue, but never touches the GPU.
+	 */
+	class QueueBenchObject : public RenderObject
+	{
+	public:
+		virtual void Render(Camera* camera, RenderPass renderPass) override
+		{
+		}
+
+		virtual void Submit(Camera* camera, RenderPass renderPass, RenderQueue& renderQueue) override
+		{
+			double distance = (this->center - camera->GetCameraToWorldTransform().translation).Length();
+			renderQueue.Submit(this, this->layer, this->shader, this->texture, this->mesh, distance);
+		}
+
+		virtual void Draw(Camera* camera, RenderPass renderPass, const DrawPacket& packet, RenderQueue& renderQueue) override
+		{
+			renderQueue.BindPipelineState(this->layer + 1);
+			renderQueue.BindShader(packet.shader);
+			renderQueue.BindMesh(packet.mesh);
+			renderQueue.BindTexture(packet.texture);
+		}
+
+		Vector3 center;
+		int layer;
+		Shader* shader;
+		Texture* texture;
+		RenderMeshAsset* mesh;
+	};
+
+	/**
+	 * Have the given number of objects, sharing a few meshes, shaders and textures, submit draw packets
+	 * to a render queue from a moving camera.  Each frame, sort the queue with its radix sort, check the
+	 * order against a stable comparison sort, and count the binds made drawing it, both sorted and not.
+	 * The resources are just distinct addresses, since the queue never looks at what they point to.
+	 */
+	void BenchRenderQueue(int numObjects, int numFrames, std::vector<std::string>& results)
+	{
+		const double worldHalfSize = 1000.0;
+		const int numShaders = 6;
+		const int numTextures = 48;
+		const int numMeshes = 120;
+
+		Random random;
+		random.SetSeed(0);
+
+		std::vector<char> resourceArray(numShaders + numTextures + numMeshes);
+		std::vector<Shader*> meshShaderArray;
+		std::vector<Texture*> meshTextureArray;
+		for (int i = 0; i < numMeshes; i++)
+		{
+			meshShaderArray.push_back((Shader*)&resourceArray[random.InRange(0, numShaders - 1)]);
+			meshTextureArray.push_back((Texture*)&resourceArray[numShaders + random.InRange(0, numTextures - 1)]);
+		}
+
+		std::vector<Reference<QueueBenchObject>> objectArray;
+		for (int i = 0; i < numObjects; i++)
+		{
+			Reference<QueueBenchObject> object(new QueueBenchObject());
+			int meshIndex = random.InRange(0, numMeshes - 1);
+			object->center.SetComponents(random.InRange(-worldHalfSize, worldHalfSize), random.InRange(0.0, 50.0), random.InRange(-worldHalfSize, worldHalfSize));
+			object->layer = (random.InRange(0, 19) == 0) ? 1 : 0;
+			object->shader = meshShaderArray[meshIndex];
+			object->texture = meshTextureArray[meshIndex];
+			object->mesh = (RenderMeshAsset*)&resourceArray[numShaders + numTextures + meshIndex];
+			objectArray.push_back(object);
+		}
+
+		Reference<Camera> camera(new Camera());
+		Frustum frustum;
+		frustum.SetFromAspectRatio(16.0 / 9.0, M_PI / 3.0, 0.1, 3000.0);
+		camera->SetFrustum(frustum);
+
+		RenderQueue renderQueue;
+		RenderQueue unsortedQueue;
+		std::vector<DrawPacket> packetArray;
+		double radixSortMilliseconds = 0.0;
+		double comparisonSortMilliseconds = 0.0;
+		uint64_t totalSortPasses = 0;
+		uint64_t totalBinds = 0, totalBindsSaved = 0, totalUnsortedBinds = 0;
+		int numMisordered = 0;
+		Clock clock;
+
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			double angle = 2.0 * M_PI * double(frame) / double(numFrames);
+			Vector3 eyePoint(0.8 * worldHalfSize * ::cos(angle), 60.0, 0.8 * worldHalfSize * ::sin(angle));
+			camera->LookAt(eyePoint, Vector3(0.0, 0.0, 0.0), Vector3(0.0, 1.0, 0.0));
+
+			renderQueue.Begin(camera.Get(), RenderPass::MAIN_PASS);
+			unsortedQueue.Begin(camera.Get(), RenderPass::MAIN_PASS);
+			for (Reference<QueueBenchObject>& object : objectArray)
+			{
+				object->Submit(camera.Get(), RenderPass::MAIN_PASS, renderQueue);
+				object->Submit(camera.Get(), RenderPass::MAIN_PASS, unsortedQueue);
+			}
+
+			packetArray.clear();
+			for (uint32_t i = 0; i < renderQueue.GetNumPackets(); i++)
+				packetArray.push_back(renderQueue.GetPacket(i));
+
+			clock.Reset();
+			std::stable_sort(packetArray.begin(), packetArray.end(), [](const DrawPacket& packetA, const DrawPacket& packetB) -> bool {
+				return packetA.sortKey < packetB.sortKey;
+			});
+			comparisonSortMilliseconds += clock.GetCurrentTimeMilliseconds();
+
+			renderQueue.Sort();
+			radixSortMilliseconds += renderQueue.GetStats().sortMilliseconds;
+			totalSortPasses += renderQueue.GetStats().numSortPasses;
+
+			for (uint32_t i = 0; i < renderQueue.GetNumPackets(); i++)
+				if (renderQueue.GetPacket(i).renderObject != packetArray[i].renderObject)
+					numMisordered++;
+
+			renderQueue.Execute();
+			unsortedQueue.Execute();
+
+			totalBinds += renderQueue.GetStats().numBinds;
+			totalBindsSaved += renderQueue.GetStats().numBindsSaved;
+			totalUnsortedBinds += unsortedQueue.GetStats().numBinds;
+		}
+
+		double frames = double(numFrames);
+		results.push_back(std::format("{} packets, {} frames, {} shaders, {} textures, {} meshes", numObjects, numFrames, numShaders, numTextures, numMeshes));
+		results.push_back(std::format("    sort:     {:.3f} ms radix ({:.1f} passes), {:.3f} ms std::stable_sort ({:.1f}x)", radixSortMilliseconds / frames, double(totalSortPasses) / frames, comparisonSortMilliseconds / frames, comparisonSortMilliseconds / radixSortMilliseconds));
+		results.push_back(std::format("    unsorted: {:.1f} binds per frame", double(totalUnsortedBinds) / frames));
+		results.push_back(std::format("    sorted:   {:.1f} binds per frame, {:.1f} saved", double(totalBinds) / frames, double(totalBindsSaved) / frames));
+		if (numMisordered > 0)
+			results.push_back(std::format("    ERROR: {} packets were out of order!", numMisordered));
+	}
+}
+
+SceneCommand::SceneCommand()
+{
+}
+
+/*virtual*/ SceneCommand::~SceneCommand()
+{
+}
+
+/*virtual*/ std::string SceneCommand::GetName()
+{
+	return "scene";
+}
+
+/*virtual*/ std::string SceneCommand::GetSyntaxHelp()
+{
+	return "scene [stats|cull|occlusion|occlude|shadows|queue] <num-objects|on|off>";
+}
+
+/*virtual*/ std::string SceneCommand::GetHelpDescription()
+{
+	return "Inspect the scene's culling and render queue, or measure how fast they work.";
+}
+
+/*virtual*/ std::string SceneCommand::GetDetailedHelp()
+{
+	return	"scene stats -- Show how the scene's render objects are spread over its tree, and how much\n"
+			"    work culling and drawing from the render queue took in the last frame.\n"
+			"scene cull <num-objects> -- Cull the given number (default 10000) of synthetic, partly moving\n"
+			"    objects for 100 frames, testing them one by one, and with a scene tree, and compare.\n"
+			"scene occlusion [on|off] -- Turn occlusion culling on or off, or show how it did in the last frame.\n"
+			"scene occlude <num-objects> -- Cull the given number (default 20000) of synthetic objects in a maze\n"
+			"    of walls for 100 frames by occlusion, and check the results by ray-casting.\n"
+			"scene shadows <num-objects> -- Fit shadow cascades to a moving view of the given number (default 10000)\n"
+			"    of synthetic objects for 100 frames, and count the shadow casters each cascade culls down to.\n"
+			"scene queue <num-objects> -- Queue, sort and draw packets for the given number (default 10000) of\n"
+			"    synthetic objects for 100 frames without the GPU, and count the binds the sort saves.";
+}
+
+/*virtual*/ bool SceneCommand::Execute(const std::vector<std::string>& arguments, std::vector<std::string>& results)
+{
+	if (arguments.size() < 1)
+		return false;
+
+	if (arguments[0] == "stats")
+	{
+		const Scene* scene = Game::Get()->GetScene();
+		const SceneTree& sceneTree = scene->GetSceneTree();
+		results.push_back(std::format("Render objects: {}", scene->GetNumRenderObjects()));
+		results.push_back(std::format("Tree cells: {}", sceneTree.GetNumCells()));
+		results.push_back(std::format("Out of bounds: {}", sceneTree.GetNumOverflowObjects()));
+		results.push_back(std::format("Unbounded: {}", sceneTree.GetNumUnboundedObjects()));
+		results.push_back(std::format("Rebuilds: {}", sceneTree.GetNumRebuilds()));
+
+		const char* passNameArray[] = { "Main", "Shadow" };
+		for (int i = 0; i < 2; i++)
+		{
+			const SceneTree::CullStats& cullStats = scene->GetCullStats(RenderPass(i));
+			results.push_back(std::format("{} pass: {} cells visited, {} accepted whole, {} spheres tested, {} visible",
+				passNameArray[i], cullStats.numCellsVisited, cullStats.numCellsAccepted, cullStats.numSpheresTested, cullStats.numObjectsVisible));
+		}
+
+		const ShadowCascades* shadowCascades = Game::Get()->GetShadowCascades();
+		for (int i = 0; i < shadowCascades->GetNumCascades(); i++)
+		{
+			const SceneTree::CullStats& cullStats = shadowCascades->GetCullStats(i);
+			results.push_back(std::format("Shadow cascade {} [{:.1f}, {:.1f}]: {} cells visited, {} spheres tested, {} casters",
+				i, shadowCascades->GetNearDistance(i), shadowCascades->GetFarDistance(i), cullStats.numCellsVisited, cullStats.numSpheresTested, cullStats.numObjectsVisible));
+		}
+
+		for (int i = 0; i < 2; i++)
+		{
+			const RenderQueue::Stats& queueStats = scene->GetRenderQueueStats(RenderPass(i));
+			results.push_back(std::format("{} pass queue: {} packets, {} binds, {} binds saved, {:.3f} ms sorting",
+				passNameArray[i], queueStats.numPackets, queueStats.numBinds, queueStats.numBindsSaved, queueStats.sortMilliseconds));
+		}
+	}
+	else if (arguments[0] == "cull")
+	{
+		int numObjects = (arguments.size() >= 2) ? ::atoi(arguments[1].c_str()) : 10000;
+		if (numObjects <= 0)
+			return false;
+
+		BenchCulling(numObjects, 100, results);
+	}
+	else if (arguments[0] == "occlusion")
+	{
+		OcclusionCuller* occlusionCuller = Game::Get()->GetScene()->GetOcclusionCuller();
+		if (arguments.size() >= 2)
+		{
+			if (arguments[1] == "on")
+				occlusionCuller->SetEnabled(true);
+			else if (arguments[1] == "off")
+				occlusionCuller->SetEnabled(false);
+			else
+				return false;
+		}
+
+		const OcclusionCuller::Stats& stats = occlusionCuller->GetStats();
+		results.push_back(std::format("Occlusion culling: {}", occlusionCuller->IsEnabled() ? "on" : "off"));
+		results.push_back(std::format("Occluder triangles: {} chosen, {} rasterized, {} binned to tiles", stats.numOccluderTriangles, stats.numTrianglesRasterized, stats.numTileTriangles));
+		results.push_back(std::format("Objects: {} tested, {} occluded", stats.numObjectsTested, stats.numObjectsOccluded));
+		results.push_back(std::format("Rasterize time: {:.3f} ms", stats.rasterizeMilliseconds));
+	}
+	else if (arguments[0] == "occlude")
+	{
+		int numObjects = (arguments.size() >= 2) ? ::atoi(arguments[1].c_str()) : 20000;
+		if (numObjects <= 0)
+			return false;
+
+		BenchOcclusion(numObjects, 100, results);
+	}
+	else if (arguments[0] == "shadows")
+	{
+		int numObjects = (arguments.size() >= 2) ? ::atoi(arguments[1].c_str()) : 10000;
+		if (numObjects <= 0)
+			return false;
+
+		BenchShadowCascades(numObjects, 100, results);
+	}
+	else if (arguments[0] == "queue")
+	{
+		int numObjects = (arguments.size() >= 2) ? ::atoi(arguments[1].c_str()) : 10000;
+		if (numObjects <= 0)
+			return false;
+
+		BenchRenderQueue(numObjects, 100, results);
+	}
+	else
+	{
+		return false;
+	}
+
+	return true;
+}
\ No newline at end of file
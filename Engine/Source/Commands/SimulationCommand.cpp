@@ -0,0 +1,72 @@
+#include "SimulationCommand.h"
+#include "Game.h"
+#include <format>
+
+using namespace Imzadi;
+
+static SimulationCommand simulationCommand;
+
+SimulationCommand::SimulationCommand()
+{
+}
+
+/*virtual*/ SimulationCommand::~SimulationCommand()
+{
+}
+
+/*virtual*/ std::string SimulationCommand::GetName()
+{
+	return "sim";
+}
+
+/*virtual*/ std::string SimulationCommand::GetSyntaxHelp()
+{
+	return "sim [stats|fixed|variable] <rate-hz>";
+}
+
+/*virtual*/ std::string SimulationCommand::GetHelpDescription()
+{
+	return "Inspect or change how the simulation is stepped each frame.";
+}
+
+/*virtual*/ std::string SimulationCommand::GetDetailedHelp()
+{
+	return	"sim stats -- Show the time-step mode, the number of simulation steps taken last frame,\n"
+			"    and how far between simulation steps the last frame was rendered.\n"
+			"sim fixed <rate-hz> -- Step the simulation at a fixed rate (default 60 Hz), and interpolate\n"
+			"    render transforms between simulation steps.\n"
+			"sim variable -- Step the simulation once per frame by the frame time.";
+}
+
+/*virtual*/ bool SimulationCommand::Execute(const std::vector<std::string>& arguments, std::vector<std::string>& results)
+{
+	if (arguments.size() < 1)
+		return false;
+
+	Game* game = Game::Get();
+
+	if (arguments[0] == "fixed")
+	{
+		double rateHz = (arguments.size() >= 2) ? ::atof(arguments[1].c_str()) : 60.0;
+		if (rateHz <= 0.0)
+			return false;
+
+		game->SetFixedTimeStepSeconds(1.0 / rateHz);
+		game->SetFixedTimeStep(true);
+	}
+	else if (arguments[0] == "variable")
+		game->SetFixedTimeStep(false);
+	else if (arguments[0] != "stats")
+		return false;
+
+	if (game->IsFixedTimeStep())
+		results.push_back(std::format("Time-step: fixed at {:.2f} Hz ({:.3f} ms)", 1.0 / game->GetFixedTimeStepSeconds(), game->GetFixedTimeStepSeconds() * 1000.0));
+	else
+		results.push_back("Time-step: variable");
+
+	results.push_back(std::format("Frame time: {:.3f} ms", game->GetFrameDeltaTime() * 1000.0));
+	results.push_back(std::format("Simulation steps last frame: {} (max {})", game->GetNumSimulationStepsLastFrame(), game->GetMaxSimulationStepsPerFrame()));
+	results.push_back(std::format("Interpolation alpha: {:.3f}", game->GetInterpolationAlpha()));
+
+	return true;
+}
\ No newline at end of file
@@ -40,6 +40,19 @@
 #define IMZADI_SHAPE_FLAG_TRIGGER_BOX				0x0000000000000004
 #define IMZADI_SHAPE_FLAG_NON_RELATIVE				0x0000000000000008
 
+#define IMZADI_ENTITY_SERVICE_COLLISION				0x00000001
+#define IMZADI_ENTITY_SERVICE_EVENTS				0x00000002
+#define IMZADI_ENTITY_SERVICE_AUDIO					0x00000004
+#define IMZADI_ENTITY_SERVICE_SCENE					0x00000008
+#define IMZADI_ENTITY_SERVICE_RENDER_DEVICE			0x00000010
+#define IMZADI_ENTITY_SERVICE_ENTITY_LIST			0x00000020
+#define IMZADI_ENTITY_SERVICE_DEBUG_DRAW			0x00000040
+#define IMZADI_ENTITY_SERVICE_INPUT					0x00000080
+#define IMZADI_ENTITY_SERVICE_ALL					0xFFFFFFFF
+#define IMZADI_ENTITY_SERVICE_MAIN_THREAD_ONLY		(IMZADI_ENTITY_SERVICE_SCENE | IMZADI_ENTITY_SERVICE_RENDER_DEVICE | IMZADI_ENTITY_SERVICE_ENTITY_LIST | IMZADI_ENTITY_SERVICE_DEBUG_DRAW | IMZADI_ENTITY_SERVICE_INPUT)
+
+#define IMZADI_ENTITY_TICK_GRAIN_SIZE				8
+
 template<typename T>
 void IMZADI_API SafeRelease(T*& thing)
 {
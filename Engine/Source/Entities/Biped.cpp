@@ -27,6 +27,8 @@ Biped::Biped()
 	this->canRestart = true;
 	this->mass = 1.0;
 	this->continuouslyUpdatePlatformTransform = true;
+	this->speedParameter = -1;
+	this->blendStateParameter = -1;
 }
 
 /*virtual*/ Biped::~Biped()
@@ -38,6 +40,12 @@ Biped::Biped()
 	return shapeID == this->collisionShapeID;
 }
 
+/*virtual*/ void Biped::GetCollisionShapes(std::vector<Collision::ShapeID>& shapeArray) const
+{
+	if (this->collisionShapeID != 0)
+		shapeArray.push_back(this->collisionShapeID);
+}
+
 /*virtual*/ Collision::ShapeID Biped::GetGroundContactShape() const
 {
 	if (!this->inContactWithGround)
@@ -67,6 +75,51 @@ Biped::Biped()
 	this->objectToPlatform = this->restartTransformObjectToWorld;
 	this->inContactWithGround = false;
 	this->groundShapeID = 0;
+
+	auto animatedMesh = dynamic_cast<AnimatedMeshInstance*>(this->renderMesh.Get());
+	if (animatedMesh && !this->SetupAnimationBlendGraph(animatedMesh))
+		return false;
+
+	return true;
+}
+
+/*virtual*/ bool Biped::SetupAnimationBlendGraph(AnimatedMeshInstance* animatedMesh)
+{
+	SkinnedRenderMesh* skinnedMesh = animatedMesh->GetSkinnedMesh();
+	if (!skinnedMesh)
+		return true;
+
+	Reference<AnimationBlendGraph> blendGraph(new AnimationBlendGraph());
+	if (!blendGraph->Setup(skinnedMesh))
+		return false;
+
+	this->speedParameter = blendGraph->AddParameter("speed", 0.0);
+	this->blendStateParameter = blendGraph->AddParameter("state", double(BlendState::LOCOMOTION_STATE));
+
+	// Idle blends into run as we get up to speed, and the run plays faster the faster we go.
+	static double conversionFactor = 0.1;
+	AnimationClipNode* idleNode = blendGraph->AddClipNode(this->GetAnimName(AnimType::IDLE), true);
+	AnimationClipNode* runNode = blendGraph->AddClipNode(this->GetAnimName(AnimType::RUN), true);
+	runNode->SetRateParameter(this->speedParameter, conversionFactor);
+
+	auto locomotionNode = blendGraph->AddNode(new AnimationBlendSpace1DNode(this->speedParameter));
+	locomotionNode->AddChild(idleNode, 0.0);
+	locomotionNode->AddChild(runNode, 1.0);
+
+	auto stateNode = blendGraph->AddNode(new AnimationCrossFadeNode(this->blendStateParameter, animatedMesh->GetTransitionTime()));
+	stateNode->AddChild(locomotionNode);
+	stateNode->AddChild(blendGraph->AddClipNode(this->GetAnimName(AnimType::JUMP), true));
+
+	AnimType deathAnimTypeArray[] = { AnimType::FATAL_LANDING, AnimType::ABYSS_FALLING, AnimType::HIT_FALLING };
+	for (AnimType animType : deathAnimTypeArray)
+	{
+		AnimationClipNode* deathNode = blendGraph->AddClipNode(this->GetAnimName(animType), false);
+		deathNode->SetRate(0.2);
+		stateNode->AddChild(deathNode);
+	}
+
+	blendGraph->SetRootNode(stateNode);
+	animatedMesh->SetBlendGraph(blendGraph);
 	return true;
 }
 
@@ -301,14 +354,18 @@ Biped::Biped()
 
 /*virtual*/ bool Biped::ManageAnimation(double deltaTime)
 {
-	// Make sure we're playing an appropriate animation and pump the animation system.
+	// Tell the blend graph what we're doing and pump the animation system.
 
 	auto animatedMesh = dynamic_cast<AnimatedMeshInstance*>(this->renderMesh.Get());
 	if (!animatedMesh)
 		return true;
-	
-	bool canLoop = true;
-	double animationRate = 1.0;
+
+	AnimationBlendGraph* blendGraph = animatedMesh->GetBlendGraph();
+	if (!blendGraph)
+		return true;
+
+	BlendState blendState = BlendState::LOCOMOTION_STATE;
+	double speed = this->velocity.Length();
 
 	switch (this->animationMode)
 	{
@@ -317,49 +374,30 @@ Biped::Biped()
 			const Transform& objectToWorld = this->renderMesh->GetObjectToWorldTransform();
 			double heightAboveGround = (objectToWorld.translation - this->groundSurfacePoint).Length();
 			if (!this->inContactWithGround && heightAboveGround > 1.0)
-				animatedMesh->SetAnimation(this->GetAnimName(AnimType::JUMP));
-			else
-			{
-				double threshold = 1.0;
-				if (this->velocity.Length() < threshold)
-					animatedMesh->SetAnimation(this->GetAnimName(AnimType::IDLE));
-				else
-				{
-					animatedMesh->SetAnimation(this->GetAnimName(AnimType::RUN));
-
-					static double conversionFactor = 0.1;
-					double speed = this->velocity.Length();
-
-					animationRate = speed * conversionFactor;
-				}
-			}
-
+				blendState = BlendState::JUMP_STATE;
 			break;
 		}
 		case AnimationMode::DEATH_BY_ABYSS_FALLING:
 		{
-			animatedMesh->SetAnimation(this->GetAnimName(AnimType::ABYSS_FALLING));
-			canLoop = false;
-			animationRate = 0.2;
+			blendState = BlendState::ABYSS_FALLING_STATE;
 			break;
 		}
 		case AnimationMode::DEATH_BY_FATAL_LANDING:
 		{
-			animatedMesh->SetAnimation(this->GetAnimName(AnimType::FATAL_LANDING));
-			canLoop = false;
-			animationRate = 0.2;
+			blendState = BlendState::FATAL_LANDING_STATE;
 			break;
 		}
 		case AnimationMode::DEATH_BY_BADDY_HIT:
 		{
-			animatedMesh->SetAnimation(this->GetAnimName(AnimType::HIT_FALLING));
-			canLoop = false;
-			animationRate = 0.2;
+			blendState = BlendState::HIT_FALLING_STATE;
 			break;
 		}
 	}
 
-	if (!animatedMesh->AdvanceAnimation(deltaTime * animationRate, canLoop))
+	blendGraph->SetParameter(this->speedParameter, speed);
+	blendGraph->SetParameter(this->blendStateParameter, double(blendState));
+
+	if (!animatedMesh->AdvanceBlendGraph(deltaTime))
 	{
 		if (this->animationMode == AnimationMode::DEATH_BY_FATAL_LANDING ||
 			this->animationMode == AnimationMode::DEATH_BY_ABYSS_FALLING ||
@@ -14,6 +14,8 @@
 
 namespace Imzadi
 {
+	class AnimatedMeshInstance;
+
 	/**
 	 * Instances of this class represent any sort of person in the game,
 	 * whether they be the main protagonist, an antogonist, or just some
@@ -53,6 +55,7 @@ namespace Imzadi
 		virtual void OnBipedAbyssFalling();
 		virtual void ConfigureCollisionCapsule(Collision::CapsuleShape* capsule);
 		virtual bool OwnsCollisionShape(Collision::ShapeID shapeID) const override;
+		virtual void GetCollisionShapes(std::vector<Collision::ShapeID>& shapeArray) const override;
 		virtual Collision::ShapeID GetGroundContactShape() const override;
 		virtual uint32_t TickOrder() const override;
 		virtual std::string GetInfo() const override;
@@ -82,10 +85,29 @@ namespace Imzadi
 			DEATH_BY_FATAL_LANDING
 		};
 
+		/**
+		 * These are the states of the cross-fade node at the root of our blend graph.
+		 */
+		enum BlendState
+		{
+			LOCOMOTION_STATE,
+			JUMP_STATE,
+			FATAL_LANDING_STATE,
+			ABYSS_FALLING_STATE,
+			HIT_FALLING_STATE
+		};
+
 		void SetAnimationMode(AnimationMode newMode);
 
 		virtual bool ManageAnimation(double deltaTime);
 
+		/**
+		 * Build the blend graph that drives the given mesh from our speed and
+		 * animation mode.  Derivatives can override this to build a different graph,
+		 * but should then also override @ref ManageAnimation to drive it.
+		 */
+		virtual bool SetupAnimationBlendGraph(AnimatedMeshInstance* animatedMesh);
+
 		void HandleWorldSurfaceCollisionResult(Collision::CollisionQueryResult* collisionResult);
 
 		bool canRestart;
@@ -105,6 +127,8 @@ namespace Imzadi
 		Vector3 groundSurfaceNormal;
 		Vector3 groundSurfacePoint;
 		AnimationMode animationMode;
+		int speedParameter;
+		int blendStateParameter;
 		bool continuouslyUpdatePlatformTransform;
 	};
 
@@ -10,6 +10,7 @@
 #include "Assets/NavGraph.h"
 #include "RenderObjects/SkyDomeRenderObject.h"
 #include "RenderObjects/DebugLines.h"
+#include "Collision/Shapes/Polygon.h"
 #include "MovingPlatform.h"
 #include "WarpTunnel.h"
 #include "TriggerBox.h"
@@ -116,7 +117,25 @@ Level::Level()
 	if (!Game::Get()->GetCollisionSystem()->Initialize(collisionWorldBox))
 		return false;
 
-	for (auto collisionShapeSet : collisionShapeSetArray)
+	// The level's big, static polygons make good occluders.  Grab them before the collision system takes the shapes.
+	std::vector<Polygon> occluderArray;
+	for (auto& collisionShapeSet : collisionShapeSetArray)
+	{
+		for (const Collision::Shape* shape : collisionShapeSet->GetCollisionShapeArray())
+		{
+			auto polygonShape = dynamic_cast<const Collision::PolygonShape*>(shape);
+			if (polygonShape)
+			{
+				Polygon polygon;
+				polygon.vertexArray = polygonShape->GetWorldVertices();
+				occluderArray.push_back(polygon);
+			}
+		}
+	}
+
+	Game::Get()->GetScene()->GetOcclusionCuller()->SetOccluders(occluderArray);
+
+	for (auto& collisionShapeSet : collisionShapeSetArray)
 	{
 		for (Collision::Shape* shape : collisionShapeSet->GetCollisionShapeArray())
 			Game::Get()->GetCollisionSystem()->AddShape(shape, 0 /*IMZADI_ADD_FLAG_ALLOW_SPLIT*/);	// TODO: Figure out why splitting fails.
@@ -172,6 +191,8 @@ Level::Level()
 			IMZADI_LOG_ERROR("Whatever loaded for the nav-graph wasn't a nav-graph.");
 			return false;
 		}
+
+		Game::Get()->GetPathfindingService()->SetNavGraph(this->navGraph.Get());
 	}
 
 	return true;
@@ -189,6 +210,7 @@ Level::Level()
 	Game::Get()->GetCollisionSystem()->Shutdown();
 	Game::Get()->GetScene()->Clear();
 	Game::Get()->GetEventSystem()->ResetForNextLevel();
+	Game::Get()->GetPathfindingService()->SetNavGraph(nullptr);
 
 	return true;
 }
@@ -185,6 +185,12 @@ MovingPlatform::MovingPlatform()
 	return true;
 }
 
+/*virtual*/ uint32_t MovingPlatform::GetTickServices() const
+{
+	// Moving our render mesh touches the scene as much as moving our collision shapes touches the collision system.
+	return IMZADI_ENTITY_SERVICE_COLLISION | IMZADI_ENTITY_SERVICE_SCENE;
+}
+
 void MovingPlatform::UpdateCollisionTransforms()
 {
 	for (Collision::ShapeID shapeID : this->collisionShapeArray)
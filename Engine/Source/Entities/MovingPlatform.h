@@ -33,6 +33,11 @@ namespace Imzadi
 		 */
 		virtual bool Tick(TickPass tickPass, double deltaTime) override;
 
+		/**
+		 * A platform only moves its own render mesh and collision shapes, so it can tick in parallel.
+		 */
+		virtual uint32_t GetTickServices() const override;
+
 		/**
 		 * Specify where this platform's configuration data is on disk.
 		 */
@@ -11,6 +11,7 @@ TriggerBox::TriggerBox()
 {
 	this->collisionShapeID = 0;
 	this->collisionQueryTaskID = 0;
+	this->eventChannelID = 0;
 }
 
 /*virtual*/ TriggerBox::~TriggerBox()
@@ -30,6 +31,9 @@ TriggerBox::TriggerBox()
 
 	this->SetName(this->data->GetName());
 
+	// Resolve the channel once here so that sending events as shapes come and go doesn't have to look it up by name.
+	this->eventChannelID = Game::Get()->GetEventSystem()->GetChannelID(this->data->GetEventChannelName());
+
 	const AxisAlignedBoundingBox& box = this->data->GetBox();
 
 	Vector3 extents = (box.maxCorner - box.minCorner) / 2.0;
@@ -104,6 +108,11 @@ TriggerBox::TriggerBox()
 	return true;
 }
 
+/*virtual*/ uint32_t TriggerBox::GetTickServices() const
+{
+	return IMZADI_ENTITY_SERVICE_COLLISION | IMZADI_ENTITY_SERVICE_EVENTS;
+}
+
 void TriggerBox::UpdateCollisionState(Collision::CollisionQueryResult* collisionResult)
 {
 	const std::vector<Reference<Collision::ShapePairCollisionStatus>>& collisionStatusArray = collisionResult->GetCollisionStatusArray();
@@ -114,7 +123,7 @@ void TriggerBox::UpdateCollisionState(Collision::CollisionQueryResult* collision
 		if (this->shapeSet.find(shapeID) == this->shapeSet.end())
 		{
 			this->shapeSet.insert(shapeID);
-			Game::Get()->GetEventSystem()->SendEvent(this->data->GetEventChannelName(), new TriggerBoxEvent(TriggerBoxEvent::Type::SHAPE_ENTERED, shapeID, this->GetName()));
+			Game::Get()->GetEventSystem()->SendEvent(this->eventChannelID, new TriggerBoxEvent(TriggerBoxEvent::Type::SHAPE_ENTERED, shapeID, this->GetName()));
 		}
 	}
 
@@ -138,6 +147,6 @@ void TriggerBox::UpdateCollisionState(Collision::CollisionQueryResult* collision
 	for (Collision::ShapeID shapeID : shapesToRemoveArray)
 	{
 		this->shapeSet.erase(shapeID);
-		Game::Get()->GetEventSystem()->SendEvent(this->data->GetEventChannelName(), new TriggerBoxEvent(TriggerBoxEvent::Type::SHAPE_EXITED, shapeID, this->GetName()));
+		Game::Get()->GetEventSystem()->SendEvent(this->eventChannelID, new TriggerBoxEvent(TriggerBoxEvent::Type::SHAPE_EXITED, shapeID, this->GetName()));
 	}
 }
\ No newline at end of file
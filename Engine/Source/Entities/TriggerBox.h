@@ -21,6 +21,7 @@ namespace Imzadi
 		virtual bool Setup() override;
 		virtual bool Shutdown() override;
 		virtual bool Tick(TickPass tickPass, double deltaTime) override;
+		virtual uint32_t GetTickServices() const override;
 
 		void SetData(TriggerBoxData* data) { this->data.Set(data); }
 
@@ -30,6 +31,7 @@ namespace Imzadi
 		Collision::ShapeID collisionShapeID;
 		Collision::TaskID collisionQueryTaskID;
 		Reference<TriggerBoxData> data;
+		EventChannelID eventChannelID;
 		std::unordered_set<Collision::ShapeID> shapeSet;
 	};
 
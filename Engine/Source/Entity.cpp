@@ -46,11 +46,20 @@ Entity::Entity()
 	return 0;
 }
 
+/*virtual*/ uint32_t Entity::GetTickServices() const
+{
+	return IMZADI_ENTITY_SERVICE_ALL;
+}
+
 /*virtual*/ bool Entity::OwnsCollisionShape(Collision::ShapeID shapeID) const
 {
 	return false;
 }
 
+/*virtual*/ void Entity::GetCollisionShapes(std::vector<Collision::ShapeID>& shapeArray) const
+{
+}
+
 /*virtual*/ Collision::ShapeID Entity::GetGroundContactShape() const
 {
 	return 0;
@@ -65,6 +65,23 @@ namespace Imzadi
 		 */
 		virtual uint32_t TickOrder() const;
 
+		/**
+		 * Return the IMZADI_ENTITY_SERVICE_* flags for each engine service this entity
+		 * touches when it ticks.  Entities of the same tick order that stay clear of the
+		 * main-thread-only services (the scene, the render device, the entity list, debug
+		 * drawing and input) are ticked in parallel on the job system.  They must then also
+		 * not touch any other entity's state.  An entity's own render objects are part of the
+		 * scene, so moving or changing them counts as touching the scene.  By default, we claim to touch everything,
+		 * so that an entity is only ever ticked on the main thread unless it opts out.
+		 */
+		virtual uint32_t GetTickServices() const;
+
+		/**
+		 * Tell the caller if this entity can be ticked on a worker thread.
+		 * See @ref GetTickServices.
+		 */
+		bool CanTickInParallel() const { return (this->GetTickServices() & IMZADI_ENTITY_SERVICE_MAIN_THREAD_ONLY) == 0; }
+
 		/**
 		 * Again, this may not be applicable to all entities, but if it does, this is
 		 * where the entity can say whether or not it owns the given collision shape ID.
@@ -72,6 +89,15 @@ namespace Imzadi
 		 */
 		virtual bool OwnsCollisionShape(Collision::ShapeID shapeID) const;
 
+		/**
+		 * If applicable, append to the given array all the collision shapes owned by this
+		 * entity.  This should agree with @ref OwnsCollisionShape, and is what lets the game
+		 * find an entity by shape without asking every entity.  Since it's called when the
+		 * entity starts ticking, the shapes should be made in @ref Setup.  By default, we
+		 * don't add anything here.
+		 */
+		virtual void GetCollisionShapes(std::vector<Collision::ShapeID>& shapeArray) const;
+
 		/**
 		 * Again, only if applicable, return here the collision shape representing the
 		 * ground with which this entity is in contact.
@@ -0,0 +1,135 @@
+#include "EntityRegistry.h"
+#include "Entity.h"
+#include "Log.h"
+#include <format>
+
+using namespace Imzadi;
+
+EntityRegistry::EntityRegistry()
+{
+}
+
+/*virtual*/ EntityRegistry::~EntityRegistry()
+{
+	this->Clear();
+
+	for (auto pair : this->typeBucketMap)
+		delete pair.second;
+
+	this->typeBucketMap.clear();
+}
+
+void EntityRegistry::Register(Entity* entity)
+{
+	uint32_t handle = entity->GetHandle();
+	if (this->handleMap.find(handle) != this->handleMap.end())
+	{
+		IMZADI_LOG_ERROR(std::format("Entity \"{}\" is already registered.", entity->GetName().c_str()));
+		return;
+	}
+
+	Record record;
+	record.entity = entity;
+	record.name = entity->GetName();
+	entity->GetCollisionShapes(record.shapeArray);
+
+	this->entityArray.push_back(entity);
+
+	if (record.name.length() > 0)
+		this->nameMap[record.name].push_back(entity);
+
+	for (Collision::ShapeID shapeID : record.shapeArray)
+		this->shapeMap[shapeID] = entity;
+
+	for (auto pair : this->typeBucketMap)
+		pair.second->Add(entity);
+
+	this->handleMap.insert(std::pair<uint32_t, Record>(handle, record));
+}
+
+void EntityRegistry::Unregister(Entity* entity)
+{
+	HandleMap::iterator iter = this->handleMap.find(entity->GetHandle());
+	if (iter == this->handleMap.end())
+		return;
+
+	const Record& record = iter->second;
+
+	RemoveFromArray(this->entityArray, entity);
+
+	NameMap::iterator nameIter = this->nameMap.find(record.name);
+	if (nameIter != this->nameMap.end())
+	{
+		RemoveFromArray(nameIter->second, entity);
+		if (nameIter->second.size() == 0)
+			this->nameMap.erase(nameIter);
+	}
+
+	for (Collision::ShapeID shapeID : record.shapeArray)
+	{
+		ShapeMap::iterator shapeIter = this->shapeMap.find(shapeID);
+		if (shapeIter != this->shapeMap.end() && shapeIter->second == entity)
+			this->shapeMap.erase(shapeIter);
+	}
+
+	for (auto pair : this->typeBucketMap)
+		pair.second->Remove(entity);
+
+	this->handleMap.erase(iter);
+}
+
+void EntityRegistry::Clear()
+{
+	// Keep the type buckets around, since callers may be holding on to their arrays.
+	for (Entity* entity : std::vector<Entity*>(this->entityArray))
+		this->Unregister(entity);
+}
+
+/*static*/ void EntityRegistry::RemoveFromArray(std::vector<Entity*>& entityArray, Entity* entity)
+{
+	// Order is preserved so that lookups return entities in the order they were registered.
+	for (int i = 0; i < (int)entityArray.size(); i++)
+	{
+		if (entityArray[i] == entity)
+		{
+			entityArray.erase(entityArray.begin() + i);
+			break;
+		}
+	}
+}
+
+Entity* EntityRegistry::FindByName(const std::string& name) const
+{
+	NameMap::const_iterator iter = this->nameMap.find(name);
+	if (iter == this->nameMap.end())
+		return nullptr;
+
+	return iter->second[0];
+}
+
+const std::vector<Entity*>* EntityRegistry::FindAllByName(const std::string& name) const
+{
+	NameMap::const_iterator iter = this->nameMap.find(name);
+	if (iter == this->nameMap.end())
+		return nullptr;
+
+	return &iter->second;
+}
+
+Entity* EntityRegistry::FindByHandle(uint32_t handle) const
+{
+	HandleMap::const_iterator iter = this->handleMap.find(handle);
+	if (iter == this->handleMap.end())
+		return nullptr;
+
+	return iter->second.entity;
+}
+
+Entity* EntityRegistry::FindByShapeID(Collision::ShapeID shapeID) const
+{
+	ShapeMap::const_iterator iter = this->shapeMap.find(shapeID);
+	if (iter == this->shapeMap.end())
+		return nullptr;
+
+	return iter->second;
+}
\ No newline at end of file
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "Defines.h"
+#include "Collision/Shape.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <typeindex>
+#include <typeinfo>
+
+namespace Imzadi
+{
+	class Entity;
+
+	/**
+	 * This keeps indices of the ticking entities by name, by handle, by type and by
+	 * owned collision shape, so that game code can look entities up without scanning
+	 * every entity in the game.  The registry doesn't own the entities; the game adds
+	 * them as they start ticking and removes them as they go away.
+	 *
+	 * Type lookups are served from arrays of already-cast entity pointers, one array per
+	 * type asked for.  An array is built the first time its type is asked for, and from
+	 * then on kept up-to-date as entities come and go, so that a dynamic_cast is only
+	 * ever done when an entity is registered or unregistered, not when it's looked up.
+	 *
+	 * None of this is thread-safe.  The registry is only changed between tick passes on
+	 * the main thread, and may only be read by entities that tick on the main thread.
+	 */
+	class IMZADI_API EntityRegistry
+	{
+	public:
+		EntityRegistry();
+		virtual ~EntityRegistry();
+
+		/**
+		 * Add the given entity to all the indices.  Its name and owned collision shapes
+		 * are taken as they are now, so they should be set before the entity is registered.
+		 */
+		void Register(Entity* entity);
+
+		/**
+		 * Remove the given entity from all the indices.
+		 */
+		void Unregister(Entity* entity);
+
+		/**
+		 * Remove all entities from all the indices.
+		 */
+		void Clear();
+
+		/**
+		 * Return the first registered entity having the given name, or null if there is none.
+		 */
+		Entity* FindByName(const std::string& name) const;
+
+		/**
+		 * Return all registered entities having the given name, or null if there are none.
+		 */
+		const std::vector<Entity*>* FindAllByName(const std::string& name) const;
+
+		/**
+		 * Return the registered entity with the given handle, or null if there is none.
+		 */
+		Entity* FindByHandle(uint32_t handle) const;
+
+		/**
+		 * Return the registered entity owning the given collision shape, or null if there is none.
+		 */
+		Entity* FindByShapeID(Collision::ShapeID shapeID) const;
+
+		/**
+		 * Return all registered entities that are of (or derived from) the given type.
+		 * The returned array stays valid (and up-to-date) for the life of the registry.
+		 */
+		template<typename T>
+		const std::vector<T*>& GetEntitiesOfType()
+		{
+			std::type_index typeIndex(typeid(T));
+			TypeBucketMap::iterator iter = this->typeBucketMap.find(typeIndex);
+			if (iter != this->typeBucketMap.end())
+				return static_cast<TypeBucket<T>*>(iter->second)->entityArray;
+
+			auto typeBucket = new TypeBucket<T>();
+			for (Entity* entity : this->entityArray)
+				typeBucket->Add(entity);
+
+			this->typeBucketMap.insert(std::pair<std::type_index, TypeBucketBase*>(typeIndex, typeBucket));
+			return typeBucket->entityArray;
+		}
+
+		/**
+		 * Return all registered entities in the order they were registered.
+		 */
+		const std::vector<Entity*>& GetEntityArray() const { return this->entityArray; }
+
+	private:
+
+		class TypeBucketBase
+		{
+		public:
+			virtual ~TypeBucketBase() {}
+			virtual void Add(Entity* entity) = 0;
+			virtual void Remove(Entity* entity) = 0;
+		};
+
+		template<typename T>
+		class TypeBucket : public TypeBucketBase
+		{
+		public:
+			virtual void Add(Entity* entity) override
+			{
+				T* castedEntity = dynamic_cast<T*>(entity);
+				if (castedEntity)
+					this->entityArray.push_back(castedEntity);
+			}
+
+			virtual void Remove(Entity* entity) override
+			{
+				T* castedEntity = dynamic_cast<T*>(entity);
+				if (!castedEntity)
+					return;
+
+				for (int i = 0; i < (int)this->entityArray.size(); i++)
+				{
+					if (this->entityArray[i] == castedEntity)
+					{
+						this->entityArray.erase(this->entityArray.begin() + i);
+						break;
+					}
+				}
+			}
+
+			std::vector<T*> entityArray;
+		};
+
+		/**
+		 * We remember what an entity was registered under so that we can still
+		 * unregister it properly if its name or shapes have changed since.
+		 */
+		struct Record
+		{
+			Entity* entity;
+			std::string name;
+			std::vector<Collision::ShapeID> shapeArray;
+		};
+
+		static void RemoveFromArray(std::vector<Entity*>& entityArray, Entity* entity);
+
+		typedef std::unordered_map<std::type_index, TypeBucketBase*> TypeBucketMap;
+		typedef std::unordered_map<std::string, std::vector<Entity*>> NameMap;
+		typedef std::unordered_map<uint32_t, Record> HandleMap;
+		typedef std::unordered_map<Collision::ShapeID, Entity*> ShapeMap;
+
+		std::vector<Entity*> entityArray;
+		TypeBucketMap typeBucketMap;
+		NameMap nameMap;
+		HandleMap handleMap;
+		ShapeMap shapeMap;
+	};
+}
\ No newline at end of file
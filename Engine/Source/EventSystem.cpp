@@ -1,4 +1,6 @@
 #include "EventSystem.h"
+#include "Log.h"
+#include <format>
 
 using namespace Imzadi;
 
@@ -7,20 +9,80 @@ using namespace Imzadi;
 EventSystem::EventSystem()
 {
 	this->nextHandle = 1;
+	this->dispatchDepth = 0;
+
+	for (uint32_t i = 0; i < MAX_CHANNELS; i++)
+		this->channelArray[i] = nullptr;
+
+	// Channel ID zero is never handed out.
+	this->numChannels = 1;
 }
 
 /*virtual*/ EventSystem::~EventSystem()
 {
 	this->Clear();
+
+	uint32_t count = this->numChannels.load();
+	for (uint32_t i = 1; i < count; i++)
+		delete this->channelArray[i];
+}
+
+EventChannelID EventSystem::GetChannelID(const std::string& channelName)
+{
+	std::scoped_lock lock(this->channelNameMutex);
+
+	auto iter = this->channelIDMap.find(channelName);
+	if (iter != this->channelIDMap.end())
+		return iter->second;
+
+	EventChannelID channelID = this->numChannels.load(std::memory_order_relaxed);
+	if (channelID >= MAX_CHANNELS)
+	{
+		IMZADI_LOG_ERROR(std::format("Can't make event channel \"{}\", because we've run out of channels.", channelName.c_str()));
+		return 0;
+	}
+
+	this->channelArray[channelID] = new EventChannel(channelName);
+	this->channelIDMap.insert(std::pair<std::string, EventChannelID>(channelName, channelID));
+
+	// Publish the channel only once it's been fully made so that senders on other threads never see it half-made.
+	this->numChannels.store(channelID + 1, std::memory_order_release);
+	return channelID;
+}
+
+EventChannelID EventSystem::FindChannelID(const std::string& channelName)
+{
+	std::scoped_lock lock(this->channelNameMutex);
+
+	auto iter = this->channelIDMap.find(channelName);
+	if (iter == this->channelIDMap.end())
+		return 0;
+
+	return iter->second;
+}
+
+EventChannel* EventSystem::GetChannel(EventChannelID channelID)
+{
+	if (channelID == 0 || channelID >= this->numChannels.load(std::memory_order_acquire))
+		return nullptr;
+
+	return this->channelArray[channelID];
 }
 
 bool EventSystem::SendEvent(const std::string& channelName, Event* event)
 {
-	std::scoped_lock lock(this->mutex);
+	return this->SendEvent(this->FindChannelID(channelName), event);
+}
 
-	EventChannel* channel = this->GetOrCreateChannel(channelName, false);
+bool EventSystem::SendEvent(EventChannelID channelID, Event* event)
+{
+	EventChannel* channel = this->GetChannel(channelID);
 	if (!channel)
+	{
+		// We own the event, so it dies here if nobody else is holding on to it.
+		Reference<Event> eventRef(event);
 		return false;
+	}
 
 	channel->EnqueueEvent(event);
 	return true;
@@ -28,181 +90,250 @@ bool EventSystem::SendEvent(const std::string& channelName, Event* event)
 
 bool EventSystem::SendEventNow(const std::string& channelName, Event* event)
 {
-	std::scoped_lock lock(this->mutex);
+	return this->SendEventNow(this->FindChannelID(channelName), event);
+}
+
+bool EventSystem::SendEventNow(EventChannelID channelID, Event* event)
+{
+	Reference<Event> eventRef(event);
 
-	EventChannel* channel = this->GetOrCreateChannel(channelName, false);
+	EventChannel* channel = this->GetChannel(channelID);
 	if (!channel)
 		return false;
 
-	channel->DispatchEventNow(event);
-	delete event;
+	std::scoped_lock lock(this->listenerMutex);
+
+	this->dispatchDepth++;
+	channel->DispatchEvent(event);
+	this->dispatchDepth--;
+
+	if (this->dispatchDepth == 0)
+		this->CompactChannels();
+
 	return true;
 }
 
 EventListenerHandle EventSystem::RegisterEventListener(const std::string& channelName, EventListenerType eventListenerType, Reference<EventListener> eventListener)
 {
-	std::scoped_lock lock(this->mutex);
+	return this->RegisterEventListener(this->GetChannelID(channelName), eventListenerType, eventListener);
+}
+
+EventListenerHandle EventSystem::RegisterEventListener(EventChannelID channelID, EventListenerType eventListenerType, Reference<EventListener> eventListener)
+{
+	EventChannel* channel = this->GetChannel(channelID);
+	if (!channel)
+		return 0;
+
+	std::scoped_lock lock(this->listenerMutex);
 
 	eventListener->eventListenerType = eventListenerType;
 	EventListenerHandle handle = this->nextHandle++;
-	EventChannel* channel = this->GetOrCreateChannel(channelName, true);
-	IMZADI_ASSERT(channel);
-	if (!channel->AddSubscriber(handle, eventListener))
-		handle = 0;
+
+	// A listener added during dispatch goes at the end of the array, so it won't see the event being dispatched.
+	channel->subscriberArray.push_back({ handle, eventListener });
+	this->listenerChannelMap.insert(std::pair<EventListenerHandle, EventChannelID>(handle, channelID));
 	return handle;
 }
 
 bool EventSystem::UnregisterEventListener(EventListenerHandle eventListenerHandle)
 {
-	std::scoped_lock lock(this->mutex);
+	std::scoped_lock lock(this->listenerMutex);
+
+	auto iter = this->listenerChannelMap.find(eventListenerHandle);
+	if (iter == this->listenerChannelMap.end())
+		return false;
+
+	EventChannel* channel = this->GetChannel(iter->second);
+	this->listenerChannelMap.erase(iter);
 
-	for (auto pair : this->eventChannelMap)
+	for (uint32_t i = 0; i < (uint32_t)channel->subscriberArray.size(); i++)
 	{
-		EventChannel* channel = pair.second;
-		if (channel->RemoveSubscriber(eventListenerHandle))
+		if (channel->subscriberArray[i].handle == eventListenerHandle)
+		{
+			this->RemoveSubscriber(channel, i);
 			return true;
+		}
 	}
 
 	return false;
 }
 
+void EventSystem::RemoveSubscriber(EventChannel* channel, uint32_t i)
+{
+	// The array can't be changed while a dispatch may be walking it, so we just mark the
+	// subscriber dead, which also keeps the listener alive until it's back out of our call.
+	if (this->dispatchDepth > 0)
+	{
+		channel->subscriberArray[i].handle = 0;
+		channel->needsCompaction = true;
+	}
+	else
+	{
+		channel->subscriberArray.erase(channel->subscriberArray.begin() + i);
+	}
+}
+
+void EventSystem::CompactChannels()
+{
+	uint32_t count = this->numChannels.load(std::memory_order_acquire);
+	for (uint32_t i = 1; i < count; i++)
+	{
+		EventChannel* channel = this->channelArray[i];
+		if (channel->needsCompaction)
+		{
+			std::erase_if(channel->subscriberArray, [](const EventChannel::Subscriber& subscriber) { return subscriber.handle == 0; });
+			channel->needsCompaction = false;
+		}
+	}
+}
+
 void EventSystem::DispatchAllPendingEvents()
 {
-	std::scoped_lock lock(this->mutex);
+	std::scoped_lock lock(this->listenerMutex);
 
-	std::vector<EventDispatch> eventDispatchArray;
-	for (auto pair : this->eventChannelMap)
+	// Take everything that's been queued so far before calling any listeners.
+	// That way, events sent by the listeners themselves wait for the next call.
+	std::vector<std::pair<EventChannel*, Event*>> eventListArray;
+	uint32_t count = this->numChannels.load(std::memory_order_acquire);
+	for (uint32_t i = 1; i < count; i++)
 	{
-		EventChannel* channel = pair.second;
-		channel->GenerateDispatches(eventDispatchArray);
+		EventChannel* channel = this->channelArray[i];
+		Event* eventList = channel->DequeueAllEvents();
+		if (eventList)
+			eventListArray.push_back(std::pair<EventChannel*, Event*>(channel, eventList));
 	}
 
-	// We call the listeners like this, because it should be
-	// fine for an event handler to mutate the event system,
-	// because we can't let the event system be mutated while
-	// we're trying to iterate over its data-structures.
-	for (auto& eventDispatch : eventDispatchArray)
-		eventDispatch.listener->ProcessEvent(eventDispatch.event);
+	this->dispatchDepth++;
+
+	for (auto& pair : eventListArray)
+		pair.first->DispatchEventList(pair.second);
+
+	this->dispatchDepth--;
+
+	if (this->dispatchDepth == 0)
+		this->CompactChannels();
 }
 
 void EventSystem::Clear()
 {
-	std::scoped_lock lock(this->mutex);
-	this->eventChannelMap.clear();
+	std::scoped_lock lock(this->listenerMutex);
+	this->RemoveListeners(false);
 }
 
 void EventSystem::ResetForNextLevel()
 {
-	std::scoped_lock lock(this->mutex);
-
-	for (auto pair : this->eventChannelMap)
-	{
-		EventChannel* channel = pair.second;
-		channel->ResetForNextLevel();
-	}
+	std::scoped_lock lock(this->listenerMutex);
+	this->RemoveListeners(true);
 }
 
-EventChannel* EventSystem::GetOrCreateChannel(const std::string& channelName, bool canCreateIfNoneExistent)
+void EventSystem::RemoveListeners(bool transitoryOnly)
 {
-	EventChannel* channel = nullptr;
-
-	EventChannelMap::iterator iter = this->eventChannelMap.find(channelName);
-	if (iter != this->eventChannelMap.end())
-		channel = iter->second;
-	else if (canCreateIfNoneExistent)
+	// Note that channels themselves are never removed, so that any cached channel IDs stay valid.
+	uint32_t count = this->numChannels.load(std::memory_order_acquire);
+	for (uint32_t i = 1; i < count; i++)
 	{
-		channel = new EventChannel();
-		this->eventChannelMap.insert(std::pair<std::string, Reference<EventChannel>>(channelName, channel));
-	}
+		EventChannel* channel = this->channelArray[i];
+		channel->DiscardAllEvents();
 
-	return channel;
+		for (int j = (int)channel->subscriberArray.size() - 1; j >= 0; j--)
+		{
+			EventChannel::Subscriber& subscriber = channel->subscriberArray[j];
+			if (subscriber.handle == 0)
+				continue;
+
+			if (!transitoryOnly || subscriber.listener->eventListenerType == EventListenerType::TRANSITORY)
+			{
+				this->listenerChannelMap.erase(subscriber.handle);
+				this->RemoveSubscriber(channel, j);
+			}
+		}
+	}
 }
 
 //-------------------------------------- EventChannel --------------------------------------
 
-EventChannel::EventChannel()
+EventChannel::EventChannel(const std::string& name)
 {
+	this->name = name;
+	this->needsCompaction = false;
+	this->eventStack = nullptr;
 }
 
 /*virtual*/ EventChannel::~EventChannel()
 {
-	this->Clear();
+	this->DiscardAllEvents();
 }
 
-bool EventChannel::AddSubscriber(EventListenerHandle eventListenerHandle, Reference<EventListener>& eventListener)
+void EventChannel::EnqueueEvent(Event* event)
 {
-	EventListenerMap::iterator iter = this->eventListenerMap.find(eventListenerHandle);
-	if (iter != this->eventListenerMap.end())
-		return false;
+	// The reference we take here is released once the event has been dispatched.
+	event->IncRef();
 
-	this->eventListenerMap.insert(std::pair<EventListenerHandle, Reference<EventListener>>(eventListenerHandle, eventListener));
-	return true;
+	Event* topEvent = this->eventStack.load(std::memory_order_relaxed);
+	do
+	{
+		event->nextQueuedEvent = topEvent;
+	} while (!this->eventStack.compare_exchange_weak(topEvent, event, std::memory_order_release, std::memory_order_relaxed));
 }
 
-bool EventChannel::RemoveSubscriber(EventListenerHandle eventListenerHandle)
+Event* EventChannel::DequeueAllEvents()
 {
-	EventListenerMap::iterator iter = this->eventListenerMap.find(eventListenerHandle);
-	if (iter == this->eventListenerMap.end())
-		return false;
+	Event* event = this->eventStack.exchange(nullptr, std::memory_order_acquire);
 
-	this->eventListenerMap.erase(iter);
-	return true;
-}
+	// The stack gives us the events newest first, so reverse the list to get them in the order they were sent.
+	Event* eventList = nullptr;
+	while (event)
+	{
+		Event* nextEvent = event->nextQueuedEvent;
+		event->nextQueuedEvent = eventList;
+		eventList = event;
+		event = nextEvent;
+	}
 
-void EventChannel::EnqueueEvent(Event* event)
-{
-	this->eventQueue.push_back(event);
+	return eventList;
 }
 
-void EventChannel::GenerateDispatches(std::vector<EventDispatch>& eventDispatchArray)
+void EventChannel::DispatchEvent(Event* event)
 {
-	while (this->eventQueue.size() > 0)
+	// Only listeners already registered before the dispatch began will receive the event.
+	uint32_t count = (uint32_t)this->subscriberArray.size();
+	for (uint32_t i = 0; i < count; i++)
 	{
-		std::list<Reference<Event>>::iterator iter = this->eventQueue.begin();
-		Event* event = *iter;
-
-		for (auto pair : this->eventListenerMap)
+		// Listeners may be added to the array as we go, so don't hold on to a pointer into it.
+		if (this->subscriberArray[i].handle != 0)
 		{
-			EventListener* eventListener = pair.second;
-			eventDispatchArray.push_back({ eventListener, event });
+			EventListener* eventListener = this->subscriberArray[i].listener.Get();
+			eventListener->ProcessEvent(event);
 		}
-
-		this->eventQueue.erase(iter);
 	}
 }
 
-void EventChannel::DispatchEventNow(Event* event)
+void EventChannel::DispatchEventList(Event* eventList)
 {
-	for (auto pair : this->eventListenerMap)
+	while (eventList)
 	{
-		EventListener* eventListener = pair.second;
-		eventListener->ProcessEvent(event);
+		Event* event = eventList;
+		eventList = event->nextQueuedEvent;
+		event->nextQueuedEvent = nullptr;
+		this->DispatchEvent(event);
+		event->DecRef();
 	}
 }
 
-void EventChannel::Clear()
-{
-	for (Event* event : this->eventQueue)
-		delete event;
-
-	this->eventQueue.clear();
-}
-
-void EventChannel::ResetForNextLevel()
+/*static*/ void EventChannel::ReleaseEventList(Event* eventList)
 {
-	this->Clear();
-
-	std::vector<EventListenerHandle> doomedListenersArray;
-
-	for (auto pair : this->eventListenerMap)
+	while (eventList)
 	{
-		EventListener* eventListener = pair.second;
-		if (eventListener->eventListenerType == EventListenerType::TRANSITORY)
-			doomedListenersArray.push_back(pair.first);
+		Event* event = eventList;
+		eventList = event->nextQueuedEvent;
+		event->nextQueuedEvent = nullptr;
+		event->DecRef();
 	}
+}
 
-	for (auto handle : doomedListenersArray)
-		this->eventListenerMap.erase(handle);
+void EventChannel::DiscardAllEvents()
+{
+	ReleaseEventList(this->DequeueAllEvents());
 }
 
 //-------------------------------------- Event --------------------------------------
@@ -210,11 +341,13 @@ void EventChannel::ResetForNextLevel()
 Event::Event()
 {
 	this->name = "?";
+	this->nextQueuedEvent = nullptr;
 }
 
 Event::Event(const std::string& name)
 {
 	this->name = name;
+	this->nextQueuedEvent = nullptr;
 }
 
 /*virtual*/ Event::~Event()
@@ -2,10 +2,12 @@
 
 #include "Defines.h"
 #include "Reference.h"
-#include <list>
 #include <string>
+#include <vector>
 #include <unordered_map>
 #include <functional>
+#include <atomic>
+#include <mutex>
 
 namespace Imzadi
 {
@@ -14,14 +16,13 @@ namespace Imzadi
 	class EventChannel;
 	typedef std::function<void(const Event*)> EventListenerCallback;
 	typedef uint64_t EventListenerHandle;
-	typedef std::unordered_map<EventListenerHandle, Reference<EventListener>> EventListenerMap;
-	typedef std::unordered_map<std::string, Reference<EventChannel>> EventChannelMap;
 
-	struct EventDispatch
-	{
-		Reference<EventListener> listener;
-		Reference<Event> event;
-	};
+	/**
+	 * Channels are known by name, but a name is resolved (interned) into one of these
+	 * just once, after which the ID can be used to send events without any look-up.
+	 * Zero is never a valid channel ID.
+	 */
+	typedef uint32_t EventChannelID;
 
 	enum EventListenerType
 	{
@@ -44,8 +45,10 @@ namespace Imzadi
 	 * generates.  Conversely, a system shouldn't necessarily care where events
 	 * it processes come from.  The event system is a message broker.
 	 * 
-	 * Note that this class *should* be thread-safe, but you probably don't want
-	 * any event listener to be dispatched on any thread other than the main thread.
+	 * Sending an event (asynchronously) is lock-free and can be done from any thread
+	 * (e.g., the collision or MIDI threads), since each channel queues its events on
+	 * a lock-free, multiple-producer, single-consumer stack.  Everything else (in
+	 * particular, dispatching events to listeners) should be done on the main thread.
 	 */
 	class IMZADI_API EventSystem
 	{
@@ -53,6 +56,21 @@ namespace Imzadi
 		EventSystem();
 		virtual ~EventSystem();
 
+		/**
+		 * Resolve the given channel name into an ID, creating the channel if it doesn't yet exist.
+		 * Channels are never destroyed, so the returned ID stays valid for the life of the system.
+		 *
+		 * @return Zero is returned if we've run out of channels; the channel ID, otherwise.
+		 */
+		EventChannelID GetChannelID(const std::string& channelName);
+
+		/**
+		 * Resolve the given channel name into an ID, but don't create the channel if it doesn't exist.
+		 *
+		 * @return Zero is returned if no channel of the given name exists; the channel ID, otherwise.
+		 */
+		EventChannelID FindChannelID(const std::string& channelName);
+
 		/**
 		 * This will send the given event asynchronously.  That is,
 		 * the event is queued, and will be dispatched to all applicable
@@ -65,6 +83,12 @@ namespace Imzadi
 		 */
 		bool SendEvent(const std::string& channelName, Event* event);
 
+		/**
+		 * This is the same as the other SendEvent method, but doesn't have to look up the channel by name.
+		 * This doesn't lock anything and can be called from any thread.
+		 */
+		bool SendEvent(EventChannelID channelID, Event* event);
+
 		/**
 		 * This will send the given event synchronously.  That is, the event
 		 * will have been sent and processed by all listeners before this call
@@ -77,6 +101,7 @@ namespace Imzadi
 		 * the main thread.
 		 */
 		bool SendEventNow(const std::string& channelName, Event* event);
+		bool SendEventNow(EventChannelID channelID, Event* event);
 
 		/**
 		 * Register an event listener with the system.
@@ -87,9 +112,11 @@ namespace Imzadi
 		 * @return A handle is returned that the user can pass to the UnregisterEventListener method.  Note that zero is an invalid handle value.
 		 */
 		EventListenerHandle RegisterEventListener(const std::string& channelName, EventListenerType eventListenerType, Reference<EventListener> eventListener);
+		EventListenerHandle RegisterEventListener(EventChannelID channelID, EventListenerType eventListenerType, Reference<EventListener> eventListener);
 
 		/**
-		 * Unregister a previously registered event listener.
+		 * Unregister a previously registered event listener.  This is safe to do
+		 * from within an event listener, even for the listener being called.
 		 * 
 		 * @param[in] eventListenerHandle This is the handle returned from the RegisterEventListener method.
 		 * @return True is returned on success; false, otherwise.
@@ -100,7 +127,8 @@ namespace Imzadi
 		 * This should get called once per frame to send all queued events.
 		 * This should probably only get called from the main thread, because
 		 * event listeners are called here and they can't be expected to be
-		 * thread-safe.
+		 * thread-safe.  Events sent by the listeners themselves are left for
+		 * the next call.
 		 */
 		void DispatchAllPendingEvents();
 
@@ -114,36 +142,89 @@ namespace Imzadi
 		 */
 		void ResetForNextLevel();
 
+		/**
+		 * This is the most channels the system can have.
+		 */
+		static const uint32_t MAX_CHANNELS = 1024;
+
 	private:
 
-		std::recursive_mutex mutex;
+		EventChannel* GetChannel(EventChannelID channelID);
+		void RemoveSubscriber(EventChannel* channel, uint32_t i);
+		void RemoveListeners(bool transitoryOnly);
+		void CompactChannels();
 
-		EventChannel* GetOrCreateChannel(const std::string& channelName, bool canCreateIfNoneExistent);
+		std::mutex channelNameMutex;
+		std::unordered_map<std::string, EventChannelID> channelIDMap;
+		EventChannel* channelArray[MAX_CHANNELS];
+		std::atomic<uint32_t> numChannels;
 
-		EventChannelMap eventChannelMap;
+		std::recursive_mutex listenerMutex;
+		std::unordered_map<EventListenerHandle, EventChannelID> listenerChannelMap;
 		EventListenerHandle nextHandle;
+		int dispatchDepth;
 	};
 
 	/**
 	 * These are used internally by the EventSystem class to manage channels.
+	 * The event system takes care of all the locking; a channel only makes
+	 * sure that queuing an event to it is safe from any thread.
 	 */
-	class EventChannel : public ReferenceCounted
+	class EventChannel
 	{
+		friend class EventSystem;
+
 	public:
-		EventChannel();
+		EventChannel(const std::string& name);
 		virtual ~EventChannel();
 
-		bool AddSubscriber(EventListenerHandle eventListenerHandle, Reference<EventListener>& eventListener);
-		bool RemoveSubscriber(EventListenerHandle eventListenerHandle);
+		/**
+		 * Queue the given event to be dispatched later.  This can be called from any thread.
+		 */
 		void EnqueueEvent(Event* event);
-		void GenerateDispatches(std::vector<EventDispatch>& eventDispatchArray);
-		void DispatchEventNow(Event* event);
-		void Clear();
-		void ResetForNextLevel();
+
+		/**
+		 * Take all queued events.  They're returned in the order they were queued.
+		 * The caller inherits the reference each one of them holds on itself.
+		 */
+		Event* DequeueAllEvents();
+
+		/**
+		 * Call every listener of this channel with the given event.  Listeners are
+		 * called in place, so while this is going on, listeners can't be removed
+		 * from the array; they can only be marked dead.  See @ref EventSystem::CompactChannels.
+		 */
+		void DispatchEvent(Event* event);
+
+		/**
+		 * Dispatch each event of the given list (as returned by @ref DequeueAllEvents) in order, then release them.
+		 */
+		void DispatchEventList(Event* eventList);
+
+		/**
+		 * Release each event of the given list (as returned by @ref DequeueAllEvents) without dispatching it.
+		 */
+		static void ReleaseEventList(Event* eventList);
+
+		/**
+		 * Release all queued events without dispatching them.
+		 */
+		void DiscardAllEvents();
+
+		const std::string& GetName() const { return this->name; }
 
 	private:
-		EventListenerMap eventListenerMap;
-		std::list<Reference<Event>> eventQueue;
+
+		struct Subscriber
+		{
+			EventListenerHandle handle;		///< This is zero for a listener that's been removed, but not yet compacted away.
+			Reference<EventListener> listener;
+		};
+
+		std::string name;
+		std::vector<Subscriber> subscriberArray;
+		bool needsCompaction;
+		std::atomic<Event*> eventStack;
 	};
 
 	/**
@@ -167,6 +248,11 @@ namespace Imzadi
 
 	protected:
 		std::string name;
+
+	private:
+		friend class EventChannel;
+
+		Event* nextQueuedEvent;		///< This links the event into the queue of a channel while it's waiting to be dispatched.
 	};
 
 	/**
@@ -0,0 +1,197 @@
+#include "FlowField.h"
+#include "Log.h"
+#include <algorithm>
+#include <limits>
+
+using namespace Imzadi;
+
+FlowField::FlowField()
+{
+	this->navGraph = nullptr;
+	this->graphVersion = 0;
+	this->goalOrdinal = -1;
+	this->distanceOffset = 0.0;
+	this->numNodesUpdated = 0;
+}
+
+/*virtual*/ FlowField::~FlowField()
+{
+}
+
+void FlowField::Clear()
+{
+	this->navGraph = nullptr;
+	this->graphVersion = 0;
+	this->goalOrdinal = -1;
+	this->distanceOffset = 0.0;
+	this->cellArray.clear();
+	this->openArray.clear();
+	this->numNodesUpdated = 0;
+}
+
+bool FlowField::IsValidFor(const NavGraph* navGraph) const
+{
+	return navGraph && this->navGraph == navGraph && this->graphVersion == navGraph->GetVersion() && this->goalOrdinal >= 0;
+}
+
+const NavGraph::Node* FlowField::GetGoalNode() const
+{
+	if (!this->navGraph || this->goalOrdinal < 0)
+		return nullptr;
+
+	return this->navGraph->GetNode(this->goalOrdinal);
+}
+
+bool FlowField::Build(const NavGraph* navGraph, const NavGraph::Node* goalNode)
+{
+	this->Clear();
+
+	if (!navGraph || !goalNode)
+	{
+		IMZADI_LOG_ERROR("Can't build a flow field without a nav-graph and a goal.");
+		return false;
+	}
+
+	if (!(0 <= goalNode->ordinal && goalNode->ordinal < navGraph->GetNumNodes()) || navGraph->GetNode(goalNode->ordinal) != goalNode)
+	{
+		IMZADI_LOG_ERROR("The goal of a flow field must be a node of its nav-graph.");
+		return false;
+	}
+
+	this->navGraph = navGraph;
+	this->graphVersion = navGraph->GetVersion();
+	this->goalOrdinal = goalNode->ordinal;
+	this->cellArray.resize(navGraph->GetNumNodes(), Cell{ std::numeric_limits<double>::infinity(), -1 });
+
+	this->cellArray[this->goalOrdinal].distance = 0.0;
+	this->openArray.push_back(OpenEntry{ 0.0, this->goalOrdinal });
+	this->Propagate();
+
+	return true;
+}
+
+bool FlowField::SetGoal(const NavGraph* navGraph, const NavGraph::Node* goalNode)
+{
+	if (!this->IsValidFor(navGraph) || !goalNode)
+		return this->Build(navGraph, goalNode);
+
+	if (!(0 <= goalNode->ordinal && goalNode->ordinal < navGraph->GetNumNodes()) || navGraph->GetNode(goalNode->ordinal) != goalNode)
+	{
+		IMZADI_LOG_ERROR("The goal of a flow field must be a node of its nav-graph.");
+		return false;
+	}
+
+	if (goalNode->ordinal == this->goalOrdinal)
+	{
+		this->numNodesUpdated = 0;
+		return true;
+	}
+
+	double shift = this->GetDistance(goalNode->ordinal);
+	if (shift == std::numeric_limits<double>::infinity())
+		return this->Build(navGraph, goalNode);
+
+	// The way from the new goal to the old one is a shortest path between them, so it's also the way
+	// back, and we know exactly how far each node along it is from the new goal.  Turn it around, and
+	// start the search from all of it.  Every other node's distance becomes its old distance plus the
+	// shift, which is true of going by way of the old goal, until the search finds a shorter way.
+	this->openArray.clear();
+	int ordinal = goalNode->ordinal;
+	int previousOrdinal = -1;
+	for (int i = 0; ordinal >= 0; i++)
+	{
+		if (i >= (int)this->cellArray.size())
+		{
+			IMZADI_LOG_ERROR("The flow field leads around in a circle.  Rebuilding it.");
+			return this->Build(navGraph, goalNode);
+		}
+
+		Cell& cell = this->cellArray[ordinal];
+		int nextOrdinal = cell.nextOrdinal;
+		double distance = shift - this->GetDistance(ordinal);
+
+		cell.distance = distance - (this->distanceOffset + shift);
+		cell.nextOrdinal = previousOrdinal;
+		this->openArray.push_back(OpenEntry{ distance, ordinal });
+
+		previousOrdinal = ordinal;
+		ordinal = nextOrdinal;
+	}
+
+	std::make_heap(this->openArray.begin(), this->openArray.end(), CompareOpenEntries);
+
+	this->distanceOffset += shift;
+	this->goalOrdinal = goalNode->ordinal;
+	this->Propagate();
+
+	return true;
+}
+
+/*static*/ bool FlowField::CompareOpenEntries(const OpenEntry& entryA, const OpenEntry& entryB)
+{
+	// The standard heap functions make a max-heap, but we want the nearest entry on top.
+	return entryA.distance > entryB.distance;
+}
+
+void FlowField::Propagate()
+{
+	this->numNodesUpdated = 0;
+
+	// This is Dijkstra's algorithm, outward from the goal, except that it stops wherever it can't improve on what a node already has.
+	while (this->openArray.size() > 0)
+	{
+		std::pop_heap(this->openArray.begin(), this->openArray.end(), CompareOpenEntries);
+		OpenEntry entry = this->openArray.back();
+		this->openArray.pop_back();
+
+		// Cells hold their distances less the offset, and adding the offset back doesn't always give
+		// exactly what was pushed, so compare them as they're stored, lest we skip entries that aren't stale.
+		if (entry.distance - this->distanceOffset > this->cellArray[entry.ordinal].distance)
+			continue;
+
+		this->numNodesUpdated++;
+
+		const NavGraph::Node* node = this->navGraph->GetNode(entry.ordinal);
+		for (int i = 0; i < (int)node->adjacentPathArray.size(); i++)
+		{
+			const NavGraph::Node* adjacentNode = node->GetAdjacentNode(i);
+			double distance = entry.distance + node->adjacentPathArray[i]->length;
+
+			// A little tolerance keeps round-off from making us revisit nodes that haven't really gotten any closer.
+			Cell& cell = this->cellArray[adjacentNode->ordinal];
+			if (distance - this->distanceOffset < cell.distance - 1e-9)
+			{
+				cell.distance = distance - this->distanceOffset;
+				cell.nextOrdinal = entry.ordinal;
+
+				this->openArray.push_back(OpenEntry{ distance, adjacentNode->ordinal });
+				std::push_heap(this->openArray.begin(), this->openArray.end(), CompareOpenEntries);
+			}
+		}
+	}
+}
+
+const NavGraph::Node* FlowField::GetNextNode(const NavGraph::Node* node) const
+{
+	if (!node || !(0 <= node->ordinal && node->ordinal < (int)this->cellArray.size()))
+		return nullptr;
+
+	int nextOrdinal = this->cellArray[node->ordinal].nextOrdinal;
+	if (nextOrdinal < 0)
+		return nullptr;
+
+	return this->navGraph->GetNode(nextOrdinal);
+}
+
+double FlowField::GetDistanceToGoal(const NavGraph::Node* node) const
+{
+	if (!node || !(0 <= node->ordinal && node->ordinal < (int)this->cellArray.size()))
+		return std::numeric_limits<double>::infinity();
+
+	return this->GetDistance(node->ordinal);
+}
+
+bool FlowField::CanReachGoal(const NavGraph::Node* node) const
+{
+	return this->GetDistanceToGoal(node) != std::numeric_limits<double>::infinity();
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "Assets/NavGraph.h"
+#include <vector>
+
+namespace Imzadi
+{
+	/**
+	 * When many entities are all headed for the same place, rather than each finding its own
+	 * path there, they can share one of these.  A flow field knows, for every node of a nav-graph,
+	 * how far it is from the goal, and which adjacent node to go to next to get there the
+	 * quickest way.  It costs one search of the whole graph to build, but after that, looking up
+	 * the next step from any node is just an array access, no matter how many entities there are.
+	 *
+	 * When the goal moves, the field is updated rather than rebuilt.  Any node's new distance to
+	 * the goal is no more than its old distance plus the distance between the old goal and the
+	 * new, by way of the old goal, so we start from that, and only revisit the nodes for which
+	 * there's now a shorter way.  Adding the same amount to every node's distance is done by
+	 * keeping that amount on the side, rather than touching every node.  When a chased entity
+	 * crosses an edge, the nodes behind it, which still get to it by way of where it was, are
+	 * left alone; only those on the side it moved toward are revisited.
+	 *
+	 * The field must be updated from one thread at a time, and not while it's being read,
+	 * but any number of threads can read it at once.
+	 */
+	class IMZADI_API FlowField
+	{
+	public:
+		FlowField();
+		virtual ~FlowField();
+
+		/**
+		 * Free all memory and forget the graph and the goal.
+		 */
+		void Clear();
+
+		/**
+		 * Build the field over the given graph from scratch, for the given goal.
+		 *
+		 * @param[in] navGraph This is the graph over which to build the field.  It must outlive the field, or else be replaced by another call to this method.
+		 * @param[in] goalNode This is the node every entity is trying to reach.
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool Build(const NavGraph* navGraph, const NavGraph::Node* goalNode);
+
+		/**
+		 * Move the goal of the field to the given node, updating the field if it's still valid for the given
+		 * graph, and the new goal is reachable from the old one; otherwise, building it from scratch.
+		 *
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool SetGoal(const NavGraph* navGraph, const NavGraph::Node* goalNode);
+
+		/**
+		 * Tell the caller if this field is up-to-date with the given graph.
+		 */
+		bool IsValidFor(const NavGraph* navGraph) const;
+
+		/**
+		 * Return the node the field leads to, if any.
+		 */
+		const NavGraph::Node* GetGoalNode() const;
+
+		/**
+		 * Return the adjacent node to go to from the given node to get to the goal the quickest way.
+		 * Null is returned if the given node is the goal, or if the goal can't be reached from it.
+		 */
+		const NavGraph::Node* GetNextNode(const NavGraph::Node* node) const;
+
+		/**
+		 * Return the length of the shortest path from the given node to the goal, or infinity if there isn't one.
+		 */
+		double GetDistanceToGoal(const NavGraph::Node* node) const;
+
+		/**
+		 * Tell the caller if the goal can be reached from the given node.
+		 */
+		bool CanReachGoal(const NavGraph::Node* node) const;
+
+		/**
+		 * Tell the caller how many nodes were given new distances by the last call to @ref Build or @ref SetGoal.
+		 */
+		uint32_t GetNumNodesUpdated() const { return this->numNodesUpdated; }
+
+	private:
+
+		struct Cell
+		{
+			double distance;	///< This is the distance to the goal, less the offset that applies to every node.
+			int nextOrdinal;	///< This is the adjacent node to go to next, or -1 if there isn't one.
+		};
+
+		struct OpenEntry
+		{
+			double distance;
+			int ordinal;
+		};
+
+		static bool CompareOpenEntries(const OpenEntry& entryA, const OpenEntry& entryB);
+
+		double GetDistance(int ordinal) const { return this->cellArray[ordinal].distance + this->distanceOffset; }
+		void Propagate();
+
+		const NavGraph* navGraph;
+		uint32_t graphVersion;
+		int goalOrdinal;
+		double distanceOffset;
+		std::vector<Cell> cellArray;
+		std::vector<OpenEntry> openArray;
+		uint32_t numNodesUpdated;
+	};
+}
\ No newline at end of file
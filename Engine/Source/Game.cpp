@@ -12,8 +12,15 @@
 #include "Collision/Query.h"
 #include "Collision/Result.h"
 #include "Log.h"
+#include "Profile.h"
+#include "Input/ScriptedInput.h"
+#include "Assets/InputTrack.h"
+#include "Assets/PerformanceReport.h"
 #include <format>
 #include <math.h>
+#include <sstream>
+#include <iomanip>
+#include <filesystem>
 
 using namespace Imzadi;
 
@@ -25,6 +32,21 @@ Game::Game(HINSTANCE instance)
 	this->collisionSystemDebugDrawFlags = 0;
 	this->debugDrawVisibilityBoxes = false;
 	this->deltaTimeSeconds = 0.0;
+	this->frameDeltaTimeSeconds = 0.0;
+	this->fixedTimeStep = true;
+	this->fixedTimeStepSeconds = 1.0 / 60.0;
+	this->accumulatedTimeSeconds = 0.0;
+	this->interpolationAlpha = 0.0;
+	this->maxSimulationStepsPerFrame = 4;
+	this->numSimulationStepsLastFrame = 0;
+	this->hasPreviousCameraToWorld = false;
+	this->headless = false;
+	this->headlessParams.numFrames = 1000;
+	this->headlessParams.numWarmUpFrames = 60;
+	this->headlessParams.regressionTolerance = 0.1;
+	this->headlessFrameCount = 0;
+	this->exitCode = 0;
+	this->parallelEntityTicking = true;
 	this->instance = instance;
 	this->mainWindowHandle = NULL;
 	this->keepRunning = false;
@@ -168,6 +190,16 @@ EventSystem* Game::GetEventSystem()
 	return &this->eventSystem;
 }
 
+JobSystem* Game::GetJobSystem()
+{
+	return &this->jobSystem;
+}
+
+PathfindingService* Game::GetPathfindingService()
+{
+	return &this->pathfindingService;
+}
+
 DebugLines* Game::GetDebugLines()
 {
 	return this->debugLines.Get();
@@ -176,6 +208,7 @@ DebugLines* Game::GetDebugLines()
 /*virtual*/ bool Game::Initialize()
 {
 	IMZADI_LOG_INFO("Initializing game...");
+	IMZADI_PROFILE_THREAD("Main");
 
 	if (!this->PreInit())
 	{
@@ -183,25 +216,51 @@ DebugLines* Game::GetDebugLines()
 		return false;
 	}
 
-	if (!this->CreateRenderWindow())
+	if (!this->jobSystem.Startup())
 	{
-		IMZADI_LOG_ERROR("Failed to create (or acquire) render window.");
+		IMZADI_LOG_ERROR("Failed to start job system.");
 		return false;
 	}
 
-	if (!this->inputSystem.Setup(this->mainWindowHandle))
+	if (!this->pathfindingService.Startup(&this->jobSystem, &this->eventSystem))
 	{
-		IMZADI_LOG_ERROR("Failed to initialize input system.");
-		MessageBox(NULL, TEXT("Failed to initialize input system!"), TEXT("Error!"), MB_ICONERROR | MB_OK);
+		IMZADI_LOG_ERROR("Failed to start pathfinding service.");
 		return false;
 	}
 
+	if (this->headless)
+	{
+		if (!this->inputSystem.SetupScripted())
+		{
+			IMZADI_LOG_ERROR("Failed to initialize scripted input.");
+			return false;
+		}
+	}
+	else
+	{
+		if (!this->CreateRenderWindow())
+		{
+			IMZADI_LOG_ERROR("Failed to create (or acquire) render window.");
+			return false;
+		}
+
+		if (!this->inputSystem.Setup(this->mainWindowHandle))
+		{
+			IMZADI_LOG_ERROR("Failed to initialize input system.");
+			MessageBox(NULL, TEXT("Failed to initialize input system!"), TEXT("Error!"), MB_ICONERROR | MB_OK);
+			return false;
+		}
+	}
+
 	D3D_FEATURE_LEVEL featureLevels[] = { D3D_FEATURE_LEVEL_11_1 };
 	UINT creationFlags = D3D11_CREATE_DEVICE_BGRA_SUPPORT;
 #if defined _DEBUG
-	creationFlags |= D3D11_CREATE_DEVICE_DEBUG;
+	if (!this->headless)
+		creationFlags |= D3D11_CREATE_DEVICE_DEBUG;
 #endif
 
+	HRESULT result = 0;
+
 	DXGI_SWAP_CHAIN_DESC swapChainDesc{};
 	swapChainDesc.BufferDesc.Width = 0;
 	swapChainDesc.BufferDesc.Height = 0;
@@ -215,10 +274,21 @@ DebugLines* Game::GetDebugLines()
 	swapChainDesc.Flags = 0;
 	swapChainDesc.OutputWindow = this->mainWindowHandle;
 
-	HRESULT result = D3D11CreateDeviceAndSwapChain(NULL, D3D_DRIVER_TYPE_HARDWARE, NULL,
-													creationFlags, featureLevels, ARRAYSIZE(featureLevels),
-													D3D11_SDK_VERSION, &swapChainDesc, &this->swapChain,
-													&this->device, NULL, &this->deviceContext);
+	if (this->headless)
+	{
+		// There's no window to present to, and there may be no GPU, so we use the software rasterizer.
+		// Nothing is ever drawn with it, but assets still need somewhere to put their buffers and textures.
+		result = D3D11CreateDevice(NULL, D3D_DRIVER_TYPE_WARP, NULL,
+									creationFlags, featureLevels, ARRAYSIZE(featureLevels),
+									D3D11_SDK_VERSION, &this->device, NULL, &this->deviceContext);
+	}
+	else
+	{
+		result = D3D11CreateDeviceAndSwapChain(NULL, D3D_DRIVER_TYPE_HARDWARE, NULL,
+												creationFlags, featureLevels, ARRAYSIZE(featureLevels),
+												D3D11_SDK_VERSION, &swapChainDesc, &this->swapChain,
+												&this->device, NULL, &this->deviceContext);
+	}
 
 	if (FAILED(result))
 	{
@@ -249,32 +319,33 @@ DebugLines* Game::GetDebugLines()
 		return false;
 
 	this->windowResized = false;
-	if (!this->RecreateViews())
+	if (this->headless)
+	{
+		this->mainPassViewport.Width = FLOAT(IMZADI_HEADLESS_VIEWPORT_WIDTH);
+		this->mainPassViewport.Height = FLOAT(IMZADI_HEADLESS_VIEWPORT_HEIGHT);
+		this->mainPassViewport.MaxDepth = 1.0f;
+		this->UpdateCameraFrustum();
+	}
+	else if (!this->RecreateViews())
 	{
 		IMZADI_LOG_ERROR("Initial view creation failed.");
 		return false;
 	}
 
-	Camera::OrthographicParams orthoParams{};
-	orthoParams.nearClip = 0.0;
-	orthoParams.farClip = 10000.0;
-	orthoParams.width = 400.0;
-	orthoParams.height = 400.0;
-
-	this->lightSourceCamera.Set(new Camera());
-	this->lightSourceCamera->SetViewMode(Camera::ViewMode::ORTHOGRAPHIC);
-	this->lightSourceCamera->SetOrthographicParams(orthoParams);
+	// Each shadow cascade renders into its own tile of the shadow buffer.
+	const UINT shadowBufferSize = 4096;
+	this->shadowCascades.SetTileResolution(shadowBufferSize / ShadowCascades::ATLAS_TILES_PER_ROW);
 
-	this->shadowPassViewport.Width = 4096.0f;
-	this->shadowPassViewport.Height = 4096.0f;
+	this->shadowPassViewport.Width = FLOAT(this->shadowCascades.GetTileResolution());
+	this->shadowPassViewport.Height = FLOAT(this->shadowCascades.GetTileResolution());
 	this->shadowPassViewport.TopLeftX = 0.0f;
 	this->shadowPassViewport.TopLeftY = 0.0f;
 	this->shadowPassViewport.MinDepth = 0.0f;
 	this->shadowPassViewport.MaxDepth = 1.0f;
 
 	D3D11_TEXTURE2D_DESC shadowBufferDesc{};
-	shadowBufferDesc.Width = 4096;
-	shadowBufferDesc.Height = 4096;
+	shadowBufferDesc.Width = shadowBufferSize;
+	shadowBufferDesc.Height = shadowBufferSize;
 	shadowBufferDesc.MipLevels = 1;
 	shadowBufferDesc.ArraySize = 1;
 	shadowBufferDesc.Format = DXGI_FORMAT_R32_TYPELESS;
@@ -335,18 +406,30 @@ DebugLines* Game::GetDebugLines()
 		return false;
 	}
 
-	if (!this->audioSystem.Initialize())
+	if (!this->audioSystem.Initialize(this->headless))
 	{
 		IMZADI_LOG_ERROR("Failed to initialize the audio sub-system.");
 		return false;
 	}
 
+	if (!this->BuildFrameTaskGraph())
+	{
+		IMZADI_LOG_ERROR("Failed to build frame task graph.");
+		return false;
+	}
+
 	if (!this->PostInit())
 	{
 		IMZADI_LOG_ERROR("Post initialization failed.");
 		return false;
 	}
 
+	if (this->headless && !this->BeginHeadlessRun())
+	{
+		IMZADI_LOG_ERROR("Failed to begin headless run.");
+		return false;
+	}
+
 	this->keepRunning = true;
 	return true;
 }
@@ -445,6 +528,13 @@ bool Game::RecreateViews()
 
 	IMZADI_LOG_INFO("Viewport dimensions: %d x %d", int(this->mainPassViewport.Width), int(this->mainPassViewport.Height));
 
+	this->UpdateCameraFrustum();
+
+	return true;
+}
+
+void Game::UpdateCameraFrustum()
+{
 	double aspectRatio = double(this->mainPassViewport.Width) / double(this->mainPassViewport.Height);
 
 	Frustum frustum;
@@ -453,8 +543,6 @@ bool Game::RecreateViews()
 	Camera::OrthographicParams orthoParams = this->camera->GetOrthographicParameters();
 	orthoParams.desiredAspectRatio = aspectRatio;
 	this->camera->SetOrthographicParams(orthoParams);
-
-	return true;
 }
 
 /*virtual*/ void Game::PumpWindowsMessages()
@@ -472,28 +560,54 @@ bool Game::RecreateViews()
 
 /*virtual*/ bool Game::Run()
 {
+	IMZADI_PROFILE_FRAME();
+
+	if (this->headless)
+		return this->RunHeadless();
+
+	IMZADI_PROFILE("Frame");
+
 	if (this->frameClock.NeverBeenReset())
 		this->frameClock.Reset();
-	this->deltaTimeSeconds = this->frameClock.GetCurrentTimeSeconds();
+	this->frameDeltaTimeSeconds = this->frameClock.GetCurrentTimeSeconds();
 	this->frameClock.Reset();
-	if (this->deltaTimeSeconds >= 0.1)	// This is useful for being paused in the debugger.
-		return true;
 
-	this->debugLines->Clear();
+	if (!this->fixedTimeStep)
+	{
+		if (this->frameDeltaTimeSeconds >= 0.1)	// This is useful for being paused in the debugger.
+			return true;
 
-	this->inputSystem.Tick(this->deltaTimeSeconds);
-	this->audioSystem.Tick(this->deltaTimeSeconds);
+		this->deltaTimeSeconds = this->frameDeltaTimeSeconds;
+		this->interpolationAlpha = 1.0;
+		this->hasPreviousCameraToWorld = false;
+		this->RunSimulationStep();
+		this->numSimulationStepsLastFrame = 1;
+	}
+	else
+	{
+		// Step the simulation as many times as it takes to catch up with real time.
+		// Whatever time is left over carries into the next frame, and we render that
+		// fraction of the way between the last two simulation steps.
+		this->deltaTimeSeconds = this->fixedTimeStepSeconds;
+		this->accumulatedTimeSeconds += this->frameDeltaTimeSeconds;
+		this->numSimulationStepsLastFrame = 0;
+		while (this->accumulatedTimeSeconds >= this->fixedTimeStepSeconds && this->numSimulationStepsLastFrame < this->maxSimulationStepsPerFrame)
+		{
+			this->RunSimulationStep();
+			this->accumulatedTimeSeconds -= this->fixedTimeStepSeconds;
+			this->numSimulationStepsLastFrame++;
+		}
 
-	this->PumpWindowsMessages();
+		// If we couldn't keep up (or were paused in the debugger), just drop the time we didn't simulate.
+		if (this->accumulatedTimeSeconds >= this->fixedTimeStepSeconds)
+			this->accumulatedTimeSeconds = ::fmod(this->accumulatedTimeSeconds, this->fixedTimeStepSeconds);
 
-	this->CreateOrDestroyEntities();
+		this->interpolationAlpha = this->accumulatedTimeSeconds / this->fixedTimeStepSeconds;
 
-	this->Tick(TickPass::MOVE_UNCONSTRAINTED);
-	this->collisionSystem.FlushAllTasks();
-	this->Tick(TickPass::SUBMIT_COLLISION_QUERIES);
-	this->Tick(TickPass::PARALLEL_WORK);
-	this->collisionSystem.FlushAllTasks();
-	this->Tick(TickPass::RESOLVE_COLLISIONS);
+		// The window must stay responsive even on frames where the simulation didn't step.
+		if (this->numSimulationStepsLastFrame == 0)
+			this->PumpWindowsMessages();
+	}
 
 	if (this->windowResized)
 	{
@@ -502,7 +616,10 @@ bool Game::RecreateViews()
 		this->windowResized = false;
 	}
 
-	if (this->collisionSystemDebugDrawFlags != 0)
+	// Debug lines are cleared each simulation step, so only add these once per step, or they'd pile up.
+	bool simulated = this->numSimulationStepsLastFrame > 0;
+
+	if (this->collisionSystemDebugDrawFlags != 0 && simulated)
 	{
 		auto query = new Collision::DebugRenderQuery();
 		query->SetDrawFlags(this->collisionSystemDebugDrawFlags);
@@ -521,14 +638,283 @@ bool Game::RecreateViews()
 		}
 	}
 
-	if (this->debugDrawVisibilityBoxes)
+	if (this->debugDrawVisibilityBoxes && simulated)
 		this->scene->DrawVisibilityBoxes();
 
+	bool interpolate = this->fixedTimeStep;
+	Transform simulatedCameraToWorld = this->camera->GetCameraToWorldTransform();
+	if (interpolate)
+	{
+		this->scene->BeginInterpolatedRender(this->interpolationAlpha);
+
+		if (this->hasPreviousCameraToWorld)
+		{
+			Transform cameraToWorld;
+			cameraToWorld.Interpolate(this->previousCameraToWorld, simulatedCameraToWorld, this->interpolationAlpha);
+			this->camera->SetCameraToWorldTransform(cameraToWorld);
+		}
+	}
+
 	this->Render();
 
+	if (interpolate)
+	{
+		this->scene->EndInterpolatedRender();
+		this->camera->SetCameraToWorldTransform(simulatedCameraToWorld);
+	}
+
+	return this->keepRunning;
+}
+
+void Game::RunSimulationStep()
+{
+	IMZADI_PROFILE("Simulation Step");
+
+	if (this->fixedTimeStep)
+	{
+		this->scene->SaveSimulationState();
+		this->previousCameraToWorld = this->camera->GetCameraToWorldTransform();
+		this->hasPreviousCameraToWorld = true;
+	}
+
+	this->debugLines->Clear();
+
+	AnimatedMeshInstance::ResetLODStats();
+
+	this->frameTaskGraph.Execute(&this->jobSystem);
+}
+
+void Game::SetFixedTimeStepSeconds(double fixedTimeStepSeconds)
+{
+	if (fixedTimeStepSeconds <= 0.0)
+	{
+		IMZADI_LOG_ERROR("The fixed time-step must be positive, not %f.", fixedTimeStepSeconds);
+		return;
+	}
+
+	this->fixedTimeStepSeconds = fixedTimeStepSeconds;
+}
+
+bool Game::ParseCommandLine(const std::string& commandLine)
+{
+	std::vector<std::string> argumentArray;
+	std::istringstream stream(commandLine);
+	std::string argument;
+	while (stream >> std::quoted(argument))
+		argumentArray.push_back(argument);
+
+	for (int i = 0; i < (int)argumentArray.size(); i++)
+	{
+		const std::string& option = argumentArray[i];
+
+		if (option == "-headless")
+		{
+			this->headless = true;
+			continue;
+		}
+
+		if (i + 1 >= (int)argumentArray.size())
+		{
+			IMZADI_LOG_ERROR("Expected a value after command-line option \"%s\".", option.c_str());
+			return false;
+		}
+
+		const std::string& value = argumentArray[++i];
+
+		if (option == "-level")
+			this->headlessParams.levelName = value;
+		else if (option == "-input_track")
+			this->headlessParams.inputTrackFile = value;
+		else if (option == "-report")
+			this->headlessParams.reportFile = value;
+		else if (option == "-baseline")
+			this->headlessParams.baselineReportFile = value;
+		else if (option == "-frames")
+			this->headlessParams.numFrames = (uint32_t)::atoi(value.c_str());
+		else if (option == "-warm_up_frames")
+			this->headlessParams.numWarmUpFrames = (uint32_t)::atoi(value.c_str());
+		else if (option == "-tolerance")
+			this->headlessParams.regressionTolerance = ::atof(value.c_str());
+		else if (option == "-log")
+		{
+			auto logFileRoute = new LogFileRoute();
+			logFileRoute->SetLogFilePath(std::filesystem::absolute(value));
+			LoggingSystem::Get()->AddRoute(logFileRoute);
+		}
+		else
+		{
+			IMZADI_LOG_ERROR("Unknown command-line option \"%s\".", option.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Game::SetHeadless(const HeadlessParams& headlessParams)
+{
+	this->headless = true;
+	this->headlessParams = headlessParams;
+}
+
+bool Game::BeginHeadlessRun()
+{
+	this->headlessFrameCount = 0;
+	this->headlessProfileCursor.clear();
+	this->performanceReport.Set(new PerformanceReport());
+	this->performanceReport->SetLevelName(this->headlessParams.levelName);
+
+	// Every headless frame is exactly one simulation step.  See RunHeadless.
+	this->fixedTimeStep = true;
+
+	if (this->headlessParams.inputTrackFile.length() > 0)
+	{
+		Reference<Asset> asset;
+		if (!this->assetCache->LoadAsset(std::filesystem::absolute(this->headlessParams.inputTrackFile).string(), asset))
+			return false;
+
+		Reference<InputTrack> inputTrack;
+		inputTrack.SafeSet(asset.Get());
+		if (!inputTrack)
+		{
+			IMZADI_LOG_ERROR("The file %s is not an input track.", this->headlessParams.inputTrackFile.c_str());
+			return false;
+		}
+
+		auto scriptedInput = dynamic_cast<ScriptedInput*>(this->inputSystem.GetInput(0));
+		if (!scriptedInput)
+			return false;
+
+		scriptedInput->SetInputTrack(inputTrack);
+	}
+
+	IMZADI_LOG_INFO("Running headless for %d frames (after %d warm-up frames).", this->headlessParams.numFrames, this->headlessParams.numWarmUpFrames);
+	return true;
+}
+
+bool Game::RunHeadless()
+{
+	// Simulated time advances by exactly one step per frame, however long the frame
+	// really takes, so that every run of the same level and input track plays out the same.
+	this->frameDeltaTimeSeconds = this->fixedTimeStepSeconds;
+	this->deltaTimeSeconds = this->fixedTimeStepSeconds;
+	this->numSimulationStepsLastFrame = 1;
+	this->interpolationAlpha = 1.0;
+
+	Clock stepClock;
+	stepClock.Reset();
+	this->RunSimulationStep();
+	double stepMilliseconds = stepClock.GetCurrentTimeMilliseconds();
+
+	// The profile zones give us collision flushes, animation, and so on, but only if profiling is compiled in.
+	// The task graph times every tick pass regardless.  Either way, the cursor must be kept current.
+	std::unordered_map<std::string, double> stageTimeMap;
+	Profiler::Get()->AccumulateZoneTimes(this->headlessProfileCursor, stageTimeMap);
+
+	if (this->headlessFrameCount >= this->headlessParams.numWarmUpFrames)
+	{
+		for (int i = 0; i < this->frameTaskGraph.GetNumTasks(); i++)
+			stageTimeMap[this->frameTaskGraph.GetTaskName(i)] = this->frameTaskGraph.GetTaskTimeMilliseconds(i);
+
+		stageTimeMap["Simulation Step"] = stepMilliseconds;
+		this->performanceReport->RecordFrame(stageTimeMap);
+	}
+
+	if (++this->headlessFrameCount >= this->headlessParams.numWarmUpFrames + this->headlessParams.numFrames)
+	{
+		this->FinishHeadlessRun();
+		return false;
+	}
+
 	return this->keepRunning;
 }
 
+void Game::FinishHeadlessRun()
+{
+	this->performanceReport->CalculateStats();
+	IMZADI_LOG_INFO("Headless run finished.\n" + this->performanceReport->PrintStats());
+
+	if (this->headlessParams.reportFile.length() > 0)
+	{
+		Reference<Asset> asset(this->performanceReport.Get());
+		if (!this->assetCache->SaveAsset(std::filesystem::absolute(this->headlessParams.reportFile).string(), asset))
+			this->exitCode = 1;
+	}
+
+	if (this->headlessParams.baselineReportFile.length() > 0)
+	{
+		Reference<Asset> asset;
+		Reference<PerformanceReport> baselineReport;
+		if (this->assetCache->LoadAsset(std::filesystem::absolute(this->headlessParams.baselineReportFile).string(), asset))
+			baselineReport.SafeSet(asset.Get());
+
+		if (!baselineReport)
+		{
+			IMZADI_LOG_ERROR("Failed to load baseline performance report: %s", this->headlessParams.baselineReportFile.c_str());
+			this->exitCode = 1;
+		}
+		else
+		{
+			std::vector<std::string> regressionArray;
+			if (this->performanceReport->CompareWithBaseline(baselineReport.Get(), this->headlessParams.regressionTolerance, regressionArray))
+				IMZADI_LOG_INFO("No performance regressions found.");
+			else
+			{
+				for (const std::string& regression : regressionArray)
+					IMZADI_LOG_ERROR("Performance regression: " + regression);
+
+				this->exitCode = 2;
+			}
+		}
+	}
+}
+
+/*virtual*/ bool Game::BuildFrameTaskGraph()
+{
+	TaskGraph* graph = &this->frameTaskGraph;
+	graph->Clear();
+
+	// The tick passes are driven from the main thread, because most entities are free
+	// to do anything in their tick, including talking to the D3D immediate context.
+	// Entities that declare otherwise are farmed out to the workers by AdvanceEntities.
+	// Audio only talks to XAudio2, which is thread-safe, so it can overlap with input
+	// processing and message pumping, which must be done on the main thread.
+	TaskID inputTaskID = graph->AddTask("input", [this]() { this->inputSystem.Tick(this->deltaTimeSeconds); }, true);
+	TaskID audioTaskID = graph->AddTask("audio", [this]() { this->audioSystem.Tick(this->deltaTimeSeconds); }, false);
+	TaskID pumpMessagesTaskID = graph->AddTask("pump_messages", [this]() { this->PumpWindowsMessages(); }, true);
+	TaskID spawnTaskID = graph->AddTask("spawn_entities", [this]() {
+		this->CreateOrDestroyEntities();
+		this->pathfindingService.UpdateSnapshot();
+	}, true);
+
+	// Path searches only ever look at a snapshot of the nav-graph, so they can overlap with all the ticking.
+	TaskID pathfindingTaskID = graph->AddTask("pathfinding", [this]() { this->pathfindingService.Tick(); }, false);
+
+	TaskID moveTaskID = graph->AddTask("move_unconstrained", [this]() {
+		this->Tick(TickPass::MOVE_UNCONSTRAINTED);
+		this->collisionSystem.FlushAllTasks();
+	}, true);
+
+	TaskID submitTaskID = graph->AddTask("submit_collision_queries", [this]() { this->Tick(TickPass::SUBMIT_COLLISION_QUERIES); }, true);
+	TaskID parallelWorkTaskID = graph->AddTask("parallel_work", [this]() { this->Tick(TickPass::PARALLEL_WORK); }, true);
+
+	TaskID resolveTaskID = graph->AddTask("resolve_collisions", [this]() {
+		this->collisionSystem.FlushAllTasks();
+		this->Tick(TickPass::RESOLVE_COLLISIONS);
+	}, true);
+
+	bool success = true;
+	success &= graph->AddDependency(pumpMessagesTaskID, inputTaskID);
+	success &= graph->AddDependency(spawnTaskID, pumpMessagesTaskID);
+	success &= graph->AddDependency(moveTaskID, spawnTaskID);
+	success &= graph->AddDependency(moveTaskID, audioTaskID);		// Entities may start or stop sounds when they tick.
+	success &= graph->AddDependency(submitTaskID, moveTaskID);
+	success &= graph->AddDependency(parallelWorkTaskID, submitTaskID);
+	success &= graph->AddDependency(resolveTaskID, parallelWorkTaskID);
+	success &= graph->AddDependency(pathfindingTaskID, spawnTaskID);
+	return success;
+}
+
 void Game::NotifyWindowResized()
 {
 	this->windowResized = true;
@@ -551,15 +937,14 @@ void Game::AddEntity(Entity* entity)
 
 bool Game::FindEntityByName(const std::string& name, Reference<Entity>& foundEntity)
 {
-	for (auto& entity : this->tickingEntityList)
+	Entity* registeredEntity = this->entityRegistry.FindByName(name);
+	if (registeredEntity)
 	{
-		if (entity->GetName() == name)
-		{
-			foundEntity = entity;
-			return true;
-		}
+		foundEntity.Set(registeredEntity);
+		return true;
 	}
 
+	// Entities waiting to be set up aren't registered yet, but there are usually only a few of them.
 	for (auto& entity : this->spawnedEntityQueue)
 	{
 		if (entity->GetName() == name)
@@ -576,30 +961,37 @@ bool Game::FindAllEntitiesWithName(const std::string& name, std::vector<Entity*>
 {
 	foundEntityArray.clear();
 
-	for (auto& entity : this->tickingEntityList)
-		if (entity->GetName() == name)
-			foundEntityArray.push_back(entity);
+	const std::vector<Entity*>* entityArray = this->entityRegistry.FindAllByName(name);
+	if (entityArray)
+		foundEntityArray = *entityArray;
 
 	return foundEntityArray.size() > 0;
 }
 
 bool Game::FindEntityByShapeID(Collision::ShapeID shapeID, Reference<Entity>& foundEntity)
 {
-	for (auto& entity : this->tickingEntityList)
-	{
-		if (entity->OwnsCollisionShape(shapeID))
-		{
-			foundEntity = entity;
-			return true;
-		}
-	}
+	Entity* entity = this->entityRegistry.FindByShapeID(shapeID);
+	if (!entity)
+		return false;
 
-	return false;
+	foundEntity.Set(entity);
+	return true;
+}
+
+bool Game::FindEntityByHandle(uint32_t handle, Reference<Entity>& foundEntity)
+{
+	Entity* entity = this->entityRegistry.FindByHandle(handle);
+	if (!entity)
+		return false;
+
+	foundEntity.Set(entity);
+	return true;
 }
 
 void Game::CreateOrDestroyEntities()
 {
 	bool resortNeeded = false;
+	bool regroupNeeded = false;
 
 	while (this->spawnedEntityQueue.size() > 0)
 	{
@@ -611,6 +1003,7 @@ void Game::CreateOrDestroyEntities()
 		else
 		{
 			this->tickingEntityList.push_back(entity);
+			this->entityRegistry.Register(entity);
 			resortNeeded = true;
 		}
 	}
@@ -625,7 +1018,9 @@ void Game::CreateOrDestroyEntities()
 		if (entity->IsDoomed())
 		{
 			entity->Shutdown();
+			this->entityRegistry.Unregister(entity);
 			this->tickingEntityList.erase(iter);
+			regroupNeeded = true;
 		}
 
 		iter = nextIter;
@@ -638,37 +1033,130 @@ void Game::CreateOrDestroyEntities()
 				return entityA->TickOrder() < entityB->TickOrder();
 			});
 	}
+
+	if (resortNeeded || regroupNeeded)
+		this->RebuildEntityTickGroups();
 }
 
-void Game::AdvanceEntities(TickPass tickPass)
+void Game::RebuildEntityTickGroups()
 {
+	this->entityTickGroupArray.clear();
+
+	// The list is sorted by tick order, so each group is just a run of the list.
 	for (Entity* entity : this->tickingEntityList)
 	{
-		if (!entity->Tick(tickPass, this->deltaTimeSeconds))
+		uint32_t tickOrder = entity->TickOrder();
+		if (this->entityTickGroupArray.size() == 0 || this->entityTickGroupArray.back().tickOrder != tickOrder)
 		{
-			entity->DoomEntity();
+			EntityTickGroup tickGroup;
+			tickGroup.tickOrder = tickOrder;
+			this->entityTickGroupArray.push_back(tickGroup);
 		}
+
+		EntityTickGroup& tickGroup = this->entityTickGroupArray.back();
+		if (entity->CanTickInParallel())
+			tickGroup.parallelEntityArray.push_back(entity);
+		else
+			tickGroup.serialEntityArray.push_back(entity);
 	}
 }
 
-/*virtual*/ void Game::Render()
+void Game::GetEntityTickGroupStats(uint32_t& numGroups, uint32_t& numParallelEntities, uint32_t& numSerialEntities) const
 {
-	this->scene->PreRender();
+	numGroups = (uint32_t)this->entityTickGroupArray.size();
+	numParallelEntities = 0;
+	numSerialEntities = 0;
 
-	Vector3 lightCameraPosition = this->camera->GetEyePoint() - this->lightParams.lightCameraDistance * this->lightParams.lightDirection;
-	if (!this->lightSourceCamera->LookAt(lightCameraPosition, this->camera->GetEyePoint(), Vector3(0.0, 1.0, 0.0)))
+	for (const EntityTickGroup& tickGroup : this->entityTickGroupArray)
 	{
-		Transform lightCameraToWorld;
-		lightCameraToWorld.translation = lightCameraPosition;
-		lightCameraToWorld.matrix.SetColumnVectors(Vector3(1.0, 0.0, 0.0), Vector3(0.0, 0.0, -1.0), Vector3(0.0, 1.0, 0.0));
-		this->lightSourceCamera->SetCameraToWorldTransform(lightCameraToWorld);
+		numParallelEntities += (uint32_t)tickGroup.parallelEntityArray.size();
+		numSerialEntities += (uint32_t)tickGroup.serialEntityArray.size();
+	}
+}
+
+void Game::AdvanceEntities(TickPass tickPass)
+{
+	if (!this->parallelEntityTicking || this->jobSystem.GetNumWorkers() == 0)
+	{
+		for (Entity* entity : this->tickingEntityList)
+		{
+			if (!entity->Tick(tickPass, this->deltaTimeSeconds))
+			{
+				entity->DoomEntity();
+			}
+		}
+
+		return;
 	}
 
-	// This is the shadow pass.
-	this->deviceContext->RSSetViewports(1, &this->shadowPassViewport);
+	for (EntityTickGroup& tickGroup : this->entityTickGroupArray)
+	{
+		const std::vector<Entity*>& parallelEntityArray = tickGroup.parallelEntityArray;
+		uint32_t numParallelEntities = (uint32_t)parallelEntityArray.size();
+		Job* rootJob = nullptr;
+
+		// Kick off the parallel entities first so that the workers can chew on them while
+		// we tick the serial entities here on the main thread.  Dooming an entity only
+		// touches that entity, so it's fine to do from a worker.
+		if (numParallelEntities > 0)
+		{
+			rootJob = this->jobSystem.CreateJob(nullptr);
+
+			for (uint32_t begin = 0; begin < numParallelEntities; begin += IMZADI_ENTITY_TICK_GRAIN_SIZE)
+			{
+				uint32_t end = IMZADI_MIN(begin + IMZADI_ENTITY_TICK_GRAIN_SIZE, numParallelEntities);
+				Job* job = this->jobSystem.CreateJob([this, &parallelEntityArray, tickPass, begin, end]()
+					{
+						for (uint32_t i = begin; i < end; i++)
+							if (!parallelEntityArray[i]->Tick(tickPass, this->deltaTimeSeconds))
+								parallelEntityArray[i]->DoomEntity();
+					}, rootJob);
+
+				this->jobSystem.Run(job);
+			}
+
+			this->jobSystem.Run(rootJob);
+		}
+
+		for (Entity* entity : tickGroup.serialEntityArray)
+		{
+			if (!entity->Tick(tickPass, this->deltaTimeSeconds))
+			{
+				entity->DoomEntity();
+			}
+		}
+
+		// The next group may depend on this one, so it can't start until this one is done.
+		if (rootJob)
+			this->jobSystem.Wait(rootJob);
+	}
+}
+
+/*virtual*/ void Game::Render()
+{
+	IMZADI_PROFILE("Render");
+
+	this->scene->PreRender();
+
+	// This is the shadow pass.  Each cascade only draws the casters its light camera can see.
 	this->deviceContext->ClearDepthStencilView(this->shadowBufferView, D3D11_CLEAR_DEPTH, 1.0f, 0);
 	this->deviceContext->OMSetRenderTargets(0, NULL, this->shadowBufferView);
-	this->scene->Render(this->lightSourceCamera.Get(), RenderPass::SHADOW_PASS);
+	if (this->shadowCascades.Update(this->camera.Get(), this->lightParams.lightDirection, this->lightParams.lightCameraDistance))
+	{
+		for (int i = 0; i < this->shadowCascades.GetNumCascades(); i++)
+		{
+			int column = 0, row = 0;
+			ShadowCascades::GetAtlasTile(i, column, row);
+
+			D3D11_VIEWPORT viewport = this->shadowPassViewport;
+			viewport.TopLeftX = FLOAT(column) * viewport.Width;
+			viewport.TopLeftY = FLOAT(row) * viewport.Height;
+			this->deviceContext->RSSetViewports(1, &viewport);
+
+			this->scene->Render(this->shadowCascades.GetCascadeCamera(i), RenderPass::SHADOW_PASS);
+			this->shadowCascades.SetCullStats(i, this->scene->GetCullStats(RenderPass::SHADOW_PASS));
+		}
+	}
 	
 	// Not sure if this is necessary, but this will unbind the shadow buffer as a render target so that it can be bound later as a shader resource.
 	// Maybe it gets unbound anyway with the next OMSetRenderTargets call below?
@@ -866,8 +1354,11 @@ void Game::ShutdownAllEntities()
 		std::list<Reference<Entity>>::iterator iter = this->tickingEntityList.begin();
 		Entity* entity = *iter;
 		entity->Shutdown();
+		this->entityRegistry.Unregister(entity);
 		this->tickingEntityList.erase(iter);
 	}
+
+	this->entityTickGroupArray.clear();
 }
 
 /*virtual*/ bool Game::Shutdown()
@@ -879,6 +1370,10 @@ void Game::ShutdownAllEntities()
 
 	this->inputSystem.Shutdown();
 
+	this->frameTaskGraph.Clear();
+	this->pathfindingService.Shutdown();
+	this->jobSystem.Shutdown();
+
 	this->eventSystem.Clear();
 
 	this->ShutdownAllEntities();
@@ -7,6 +7,7 @@
 #include <d3d11.h>
 #include <string>
 #include <list>
+#include <vector>
 #include <time.h>
 #include <functional>
 #include "Reference.h"
@@ -14,14 +15,23 @@
 #include "Math/Vector3.h"
 #include "Math/Vector4.h"
 #include "Math/Quaternion.h"
+#include "Math/Transform.h"
 #include "Input/System.h"
 #include "Collision/System.h"
 #include "Audio/System.h"
 #include "EventSystem.h"
+#include "JobSystem.h"
+#include "TaskGraph.h"
+#include "PathfindingService.h"
+#include "ShadowCascades.h"
+#include "EntityRegistry.h"
 #include "StateCache.h"
 #include "Clock.h"
+#include "Profile.h"
 
 #define IMZADI_GAME_WINDOW_CLASS_NAME		TEXT("ImzadiGameWindowClass")
+#define IMZADI_HEADLESS_VIEWPORT_WIDTH		1700
+#define IMZADI_HEADLESS_VIEWPORT_HEIGHT		800
 
 namespace Imzadi
 {
@@ -30,6 +40,7 @@ namespace Imzadi
 	class Camera;
 	class RenderObject;
 	class Entity;
+	class PerformanceReport;
 
 	/**
 	 * ...
@@ -145,8 +156,34 @@ namespace Imzadi
 		Collision::System* GetCollisionSystem();
 		AudioSystem* GetAudioSystem();
 		EventSystem* GetEventSystem();
+		JobSystem* GetJobSystem();
+		PathfindingService* GetPathfindingService();
 		DebugLines* GetDebugLines();
 
+		/**
+		 * This is the graph of tasks executed by @ref Run each frame.  Tasks can be
+		 * added to it in the PostInit() call, and made to depend on (or be depended
+		 * upon by) the tasks already there, which are named after the tick passes.
+		 */
+		TaskGraph* GetFrameTaskGraph() { return &this->frameTaskGraph; }
+
+		/**
+		 * When enabled (the default), entities that declare they can tick in parallel
+		 * (see @ref Entity::GetTickServices) are ticked on the job system's workers.
+		 * When disabled, every entity is ticked on the main thread in tick order.
+		 */
+		void SetParallelEntityTicking(bool parallelEntityTicking) { this->parallelEntityTicking = parallelEntityTicking; }
+		bool GetParallelEntityTicking() const { return this->parallelEntityTicking; }
+
+		/**
+		 * Report how the ticking entities were last divided up into tick groups.
+		 *
+		 * @param[out] numGroups This is the number of distinct tick orders among the ticking entities.
+		 * @param[out] numParallelEntities This is the number of entities ticked on the job system.
+		 * @param[out] numSerialEntities This is the number of entities ticked on the main thread.
+		 */
+		void GetEntityTickGroupStats(uint32_t& numGroups, uint32_t& numParallelEntities, uint32_t& numSerialEntities) const;
+
 		static Game* Get();
 		static void Set(Game* game);
 
@@ -161,12 +198,12 @@ namespace Imzadi
 			Vector4 lightColor;
 			double directionalLightIntensity;
 			double ambientLightIntensity;
-			double lightCameraDistance;
+			double lightCameraDistance;		///< This is how far toward the light, beyond the part of the view a shadow cascade covers, shadow casters are looked for.
 		};
 
 		const LightParams& GetLightParams() const { return this->lightParams; }
 		LightParams& GetLightParams() { return this->lightParams; }
-		Camera* GetLightSourceCamera() { return this->lightSourceCamera.Get(); }
+		ShadowCascades* GetShadowCascades() { return &this->shadowCascades; }
 
 		template<typename T>
 		T* SpawnEntity()
@@ -241,8 +278,93 @@ namespace Imzadi
 
 		const D3D11_VIEWPORT* GetViewportInfo() const { return &this->mainPassViewport; }
 		double GetAspectRatio() const;
+
+		/**
+		 * Return the amount of simulated time, in seconds, covered by the current tick.
+		 * When the simulation runs at a fixed rate, this is always the fixed time-step.
+		 */
 		double GetDeltaTime() const;
 
+		/**
+		 * Return the amount of real time, in seconds, between the last two frames.
+		 * This is what should be used for anything that isn't part of the simulation,
+		 * such as a frame-rate counter.
+		 */
+		double GetFrameDeltaTime() const { return this->frameDeltaTimeSeconds; }
+
+		/**
+		 * When enabled (the default), the simulation (i.e., the frame task graph) is stepped
+		 * at a fixed rate, as many times per frame as needed to catch up with real time, and
+		 * render objects are drawn interpolated between the last two simulation steps.  This
+		 * keeps integration and collision independent of the frame-rate.  When disabled, the
+		 * simulation is stepped once per frame by however long the last frame took.
+		 */
+		void SetFixedTimeStep(bool fixedTimeStep) { this->fixedTimeStep = fixedTimeStep; }
+		bool IsFixedTimeStep() const { return this->fixedTimeStep; }
+
+		/**
+		 * Set the rate at which the simulation is stepped when the fixed time-step is enabled.
+		 *
+		 * @param[in] fixedTimeStepSeconds This is the amount of time, in seconds, covered by each simulation step.
+		 */
+		void SetFixedTimeStepSeconds(double fixedTimeStepSeconds);
+		double GetFixedTimeStepSeconds() const { return this->fixedTimeStepSeconds; }
+
+		/**
+		 * If a frame takes so long that catching up would take more than this many simulation
+		 * steps, then the remaining time is dropped and the game just runs slower for a bit.
+		 * Otherwise, each catch-up frame would take longer still, and we'd never recover.
+		 */
+		void SetMaxSimulationStepsPerFrame(uint32_t maxSimulationStepsPerFrame) { this->maxSimulationStepsPerFrame = IMZADI_MAX(maxSimulationStepsPerFrame, 1); }
+		uint32_t GetMaxSimulationStepsPerFrame() const { return this->maxSimulationStepsPerFrame; }
+
+		/**
+		 * Return how far, in the range [0,1], the last frame was rendered between the
+		 * last two simulation steps, and how many simulation steps were taken that frame.
+		 */
+		double GetInterpolationAlpha() const { return this->interpolationAlpha; }
+		uint32_t GetNumSimulationStepsLastFrame() const { return this->numSimulationStepsLastFrame; }
+
+		/**
+		 * These configure a headless run of the game, in which there is no window, nothing
+		 * is drawn or heard, and player one is driven by an input track rather than a real
+		 * device.  The game's timings are recorded for a set number of frames, after which
+		 * the game quits.  This gives us a repeatable performance test of a level.
+		 */
+		struct HeadlessParams
+		{
+			std::string levelName;				///< The game is expected to load this level, if given, rather than whatever it normally would.
+			std::string inputTrackFile;			///< This is played back by player one's input.  If not given, nothing is ever pressed.
+			std::string reportFile;				///< If given, the performance report is saved here.
+			std::string baselineReportFile;		///< If given, the performance report is compared against this one, and regressions fail the run.
+			uint32_t numFrames;					///< This is the number of frames to record.
+			uint32_t numWarmUpFrames;			///< This is the number of frames to run before we start recording, giving the level time to load.
+			double regressionTolerance;			///< A stage regresses if it's slower than the baseline by more than this fraction.
+		};
+
+		/**
+		 * Configure the game from the given command-line, which should be done before @ref Initialize is called.
+		 * The recognized options are: -headless, -level <name>, -input_track <file>, -report <file>,
+		 * -baseline <file>, -frames <count>, -warm_up_frames <count>, -tolerance <fraction>, and
+		 * -log <file>, which sends all log messages to the given file.
+		 *
+		 * @return True is returned on success; false, if the command-line couldn't be understood.
+		 */
+		bool ParseCommandLine(const std::string& commandLine);
+
+		/**
+		 * Run headless with the given parameters.  This must be called before @ref Initialize.
+		 */
+		void SetHeadless(const HeadlessParams& headlessParams);
+		bool IsHeadless() const { return this->headless; }
+		const HeadlessParams& GetHeadlessParams() const { return this->headlessParams; }
+
+		/**
+		 * This is what the process should return once the game is done.  After a headless run,
+		 * it's non-zero if the report couldn't be saved or compared, or if a regression was found.
+		 */
+		int GetExitCode() const { return this->exitCode; }
+
 		StateCache<ID3D11RasterizerState, D3D11_RASTERIZER_DESC>* GetRasterStateCache() { return &this->rasterStateCache; }
 		StateCache<ID3D11DepthStencilState, D3D11_DEPTH_STENCIL_DESC>* GetDepthStencilStateCache() { return &this->depthStencilStateCache; }
 		StateCache<ID3D11BlendState, D3D11_BLEND_DESC>* GetBlendStateCache() { return &this->blendStateCache; }
@@ -287,18 +409,29 @@ namespace Imzadi
 		template<typename T>
 		bool FindAllEntitiesOfType(std::vector<T*>& foundEntityArray)
 		{
-			foundEntityArray.clear();
-
-			for (Entity* entity : this->tickingEntityList)
-			{
-				T* entityType = dynamic_cast<T*>(entity);
-				if (entityType)
-					foundEntityArray.push_back(entityType);
-			}
-
+			foundEntityArray = this->entityRegistry.GetEntitiesOfType<T>();
 			return foundEntityArray.size() > 0;
 		}
 
+		/**
+		 * Return all currently ticking entities of the desired type.  Unlike @ref FindAllEntitiesOfType,
+		 * nothing is copied here, and the returned array stays up-to-date as entities come and go.
+		 */
+		template<typename T>
+		const std::vector<T*>& GetEntitiesOfType()
+		{
+			return this->entityRegistry.GetEntitiesOfType<T>();
+		}
+
+		/**
+		 * Find the ticking entity with the given handle.
+		 *
+		 * @param[in] handle This is the handle (see @ref ReferenceCounted::GetHandle) of the entity saught after.
+		 * @param[out] foundEntity If found, the entity is returned in this reference pointer.
+		 * @return True is returned if an entity is found; false, otherwise, and the given reference pointer is left untouched.
+		 */
+		bool FindEntityByHandle(uint32_t handle, Reference<Entity>& foundEntity);
+
 		/**
 		 * Return the first entity found having the given shape.
 		 * 
@@ -319,23 +452,21 @@ namespace Imzadi
 		template<typename T>
 		bool CollectEntities(std::vector<T*>& collectedEntityList)
 		{
-			collectedEntityList.clear();
-
-			for (Reference<Entity>& entity : this->tickingEntityList)
-			{
-				T* castedEntity = dynamic_cast<T*>(entity.Get());
-				if (castedEntity)
-					collectedEntityList.push_back(castedEntity);
-			}
-
+			collectedEntityList = this->entityRegistry.GetEntitiesOfType<T>();
 			return collectedEntityList.size() > 0;
 		}
 
+		/**
+		 * Get access to the indices kept on the ticking entities.
+		 */
+		EntityRegistry* GetEntityRegistry() { return &this->entityRegistry; }
+
 	protected:
 
 		void AddEntity(Entity* entity);
 		void AdvanceEntities(TickPass tickPass);
 		void CreateOrDestroyEntities();
+		void RebuildEntityTickGroups();
 
 		/**
 		 * This performse the typical Win32 API of grabbing and dispatching windows messages.
@@ -349,6 +480,25 @@ namespace Imzadi
 		 */
 		virtual void Render();
 
+		/**
+		 * Step the simulation once by executing the frame task graph.  When the simulation
+		 * runs at a fixed rate, the state of the scene and camera are saved first so that
+		 * rendering can interpolate from there.
+		 */
+		void RunSimulationStep();
+
+		/**
+		 * These carry out a headless run.  See @ref HeadlessParams.
+		 */
+		bool BeginHeadlessRun();
+		bool RunHeadless();
+		void FinishHeadlessRun();
+
+		/**
+		 * Fit the camera's frustum to the main viewport.
+		 */
+		void UpdateCameraFrustum();
+
 		/**
 		 * Override this call to handle windows messages, but don't forget to call this
 		 * base class method as well.
@@ -364,6 +514,14 @@ namespace Imzadi
 		void ToggleRenderObject(const std::string& name, std::function<RenderObject*()> renderObjectCreatorFunc);
 		void ShutdownAllEntities();
 
+		/**
+		 * Lay out the work of a single frame (ticking the entities, the
+		 * collision system, etc.) as a task graph.  Any task that doesn't
+		 * have to happen on the main thread, and doesn't depend on another,
+		 * is free to overlap with other work on the job system's workers.
+		 */
+		virtual bool BuildFrameTaskGraph();
+
 		TCHAR windowTitle[256];
 		HINSTANCE instance;
 		HWND mainWindowHandle;
@@ -385,19 +543,54 @@ namespace Imzadi
 		Reference<Scene> scene;
 		Reference<AssetCache> assetCache;
 		Reference<Camera> camera;
-		Reference<Camera> lightSourceCamera;
+		ShadowCascades shadowCascades;
 		LightParams lightParams;
 		std::list<Reference<Entity>> spawnedEntityQueue;
 		std::list<Reference<Entity>> tickingEntityList;
+
+		/**
+		 * The ticking entities are grouped by tick order.  Groups are ticked one after
+		 * another, but within a group, the parallel entities tick on the job system
+		 * while the serial ones tick on the main thread.  These arrays don't own the
+		 * entities; they're rebuilt whenever the ticking entity list changes.
+		 */
+		struct EntityTickGroup
+		{
+			uint32_t tickOrder;
+			std::vector<Entity*> parallelEntityArray;
+			std::vector<Entity*> serialEntityArray;
+		};
+
+		std::vector<EntityTickGroup> entityTickGroupArray;
+		EntityRegistry entityRegistry;
+		bool parallelEntityTicking;
 		InputSystem inputSystem;
 		Collision::System collisionSystem;
 		AudioSystem audioSystem;
 		EventSystem eventSystem;
+		JobSystem jobSystem;
+		PathfindingService pathfindingService;
+		TaskGraph frameTaskGraph;
 		double accelerationDuetoGravity;
 		Reference<DebugLines> debugLines;
 		uint32_t collisionSystemDebugDrawFlags;
 		bool debugDrawVisibilityBoxes;
 		double deltaTimeSeconds;
+		double frameDeltaTimeSeconds;
+		bool fixedTimeStep;
+		double fixedTimeStepSeconds;
+		double accumulatedTimeSeconds;
+		double interpolationAlpha;
+		uint32_t maxSimulationStepsPerFrame;
+		uint32_t numSimulationStepsLastFrame;
+		Transform previousCameraToWorld;
+		bool hasPreviousCameraToWorld;
+		bool headless;
+		HeadlessParams headlessParams;
+		uint32_t headlessFrameCount;
+		ProfileCursor headlessProfileCursor;
+		Reference<PerformanceReport> performanceReport;
+		int exitCode;
 		Clock frameClock;
 		static Game* gameSingleton;
 	};
@@ -0,0 +1,109 @@
+#include "ScriptedInput.h"
+
+using namespace Imzadi;
+
+ScriptedInput::ScriptedInput(int playerNumber) : Input(playerNumber)
+{
+	this->currentKeyFrame.frameNumber = 0;
+	this->currentKeyFrame.buttonFlags = 0;
+	this->currentKeyFrame.leftJoyStick.SetComponents(0.0, 0.0);
+	this->currentKeyFrame.rightJoyStick.SetComponents(0.0, 0.0);
+	this->currentKeyFrame.leftTrigger = 0.0;
+	this->currentKeyFrame.rightTrigger = 0.0;
+	this->previousButtonFlags = 0;
+	this->consumedButtonPresses = 0;
+	this->consumedButtonReleases = 0;
+	this->frameNumber = 0;
+}
+
+/*virtual*/ ScriptedInput::~ScriptedInput()
+{
+}
+
+/*virtual*/ bool ScriptedInput::Setup(HWND windowHandle)
+{
+	return true;
+}
+
+/*virtual*/ bool ScriptedInput::Shutdown()
+{
+	this->inputTrack.Reset();
+	return true;
+}
+
+/*virtual*/ void ScriptedInput::Update(double deltaTime)
+{
+	this->previousButtonFlags = this->currentKeyFrame.buttonFlags;
+	this->consumedButtonPresses = 0;
+	this->consumedButtonReleases = 0;
+
+	if (this->inputTrack)
+		this->currentKeyFrame = this->inputTrack->GetKeyFrame(this->frameNumber);
+
+	this->frameNumber++;
+}
+
+void ScriptedInput::SetInputTrack(InputTrack* inputTrack)
+{
+	this->inputTrack.Set(inputTrack);
+	this->frameNumber = 0;
+}
+
+bool ScriptedInput::IsTrackFinished() const
+{
+	return !this->inputTrack || this->frameNumber > this->inputTrack->GetLastFrameNumber();
+}
+
+/*virtual*/ Vector2 ScriptedInput::GetAnalogJoyStick(Button button)
+{
+	switch (button)
+	{
+	case Button::L_JOY_STICK:
+		return this->currentKeyFrame.leftJoyStick;
+	case Button::R_JOY_STICK:
+		return this->currentKeyFrame.rightJoyStick;
+	}
+
+	return Vector2(0.0, 0.0);
+}
+
+/*virtual*/ double ScriptedInput::GetTrigger(Button button)
+{
+	switch (button)
+	{
+	case Button::L_TRIGGER:
+		return this->currentKeyFrame.leftTrigger;
+	case Button::R_TRIGGER:
+		return this->currentKeyFrame.rightTrigger;
+	}
+
+	return 0.0;
+}
+
+/*virtual*/ bool ScriptedInput::ButtonPressed(Button button, bool consume /*= false*/)
+{
+	uint32_t buttonFlag = 1 << uint32_t(button);
+	bool pressed = ((this->currentKeyFrame.buttonFlags & buttonFlag) != 0 && (this->previousButtonFlags & buttonFlag) == 0 && (this->consumedButtonPresses & buttonFlag) == 0);
+	if (consume)
+		this->consumedButtonPresses |= buttonFlag;
+	return pressed;
+}
+
+/*virtual*/ bool ScriptedInput::ButtonReleased(Button button, bool consume /*= false*/)
+{
+	uint32_t buttonFlag = 1 << uint32_t(button);
+	bool released = ((this->currentKeyFrame.buttonFlags & buttonFlag) == 0 && (this->previousButtonFlags & buttonFlag) != 0 && (this->consumedButtonReleases & buttonFlag) == 0);
+	if (consume)
+		this->consumedButtonReleases |= buttonFlag;
+	return released;
+}
+
+/*virtual*/ bool ScriptedInput::ButtonDown(Button button)
+{
+	return (this->currentKeyFrame.buttonFlags & (1 << uint32_t(button))) != 0;
+}
+
+/*virtual*/ bool ScriptedInput::ButtonUp(Button button)
+{
+	return (this->currentKeyFrame.buttonFlags & (1 << uint32_t(button))) == 0;
+}
\ No newline at end of file
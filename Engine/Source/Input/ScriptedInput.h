@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Input.h"
+#include "Reference.h"
+#include "Assets/InputTrack.h"
+
+namespace Imzadi
+{
+	/**
+	 * Provide input by playing back an input track, one key-frame per update, so that
+	 * a run of the game can be repeated exactly.  This is used by the headless mode of
+	 * the game.  Until a track is given, nothing is ever pressed.
+	 */
+	class IMZADI_API ScriptedInput : public Input
+	{
+	public:
+		ScriptedInput(int playerNumber);
+		virtual ~ScriptedInput();
+
+		virtual bool Setup(HWND windowHandle) override;
+		virtual bool Shutdown() override;
+		virtual void Update(double deltaTime) override;
+		virtual Vector2 GetAnalogJoyStick(Button button) override;
+		virtual double GetTrigger(Button button) override;
+		virtual bool ButtonPressed(Button button, bool consume = false) override;
+		virtual bool ButtonReleased(Button button, bool consume = false) override;
+		virtual bool ButtonDown(Button button) override;
+		virtual bool ButtonUp(Button button) override;
+
+		/**
+		 * Start playing back the given track from its beginning.
+		 */
+		void SetInputTrack(InputTrack* inputTrack);
+
+		/**
+		 * Tell the caller if we've gone past the last key-frame of the track.
+		 */
+		bool IsTrackFinished() const;
+
+	private:
+		Reference<InputTrack> inputTrack;
+		InputTrack::KeyFrame currentKeyFrame;
+		uint32_t previousButtonFlags;
+		uint32_t consumedButtonPresses;
+		uint32_t consumedButtonReleases;
+		uint32_t frameNumber;
+	};
+}
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "PCInput.h"
 #include "XInput.h"
 #include "DInput.h"
+#include "ScriptedInput.h"
 
 using namespace Imzadi;
 
@@ -37,6 +38,16 @@ bool InputSystem::Setup(HWND windowHandle)
 	return this->playerMap.size() > 0;
 }
 
+bool InputSystem::SetupScripted()
+{
+	Player* player = this->MakePlayer<ScriptedInput>(0, NULL);
+	if (!player)
+		return false;
+
+	this->playerMap.insert(std::pair<int, Player*>(0, player));
+	return true;
+}
+
 bool InputSystem::Shutdown()
 {
 	for (auto pair : this->playerMap)
@@ -21,6 +21,12 @@ namespace Imzadi
 
 		bool Setup(HWND windowHandle);
 
+		/**
+		 * Rather than look for real devices, give player one a @ref ScriptedInput.
+		 * This is what the game uses when it runs headless.
+		 */
+		bool SetupScripted();
+
 		bool Shutdown();
 
 		void Tick(double deltaTime);
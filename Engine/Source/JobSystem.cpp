@@ -0,0 +1,442 @@
+#include "JobSystem.h"
+#include "Log.h"
+#include "Profile.h"
+#include <algorithm>
+#include <format>
+
+using namespace Imzadi;
+
+static thread_local int jobSystemThreadIndex = -1;
+
+//------------------------------- JobCounter -------------------------------
+
+JobCounter::JobCounter()
+{
+	this->count = 0;
+}
+
+/*virtual*/ JobCounter::~JobCounter()
+{
+}
+
+//------------------------------- Job -------------------------------
+
+Job::Job()
+{
+	this->parent = nullptr;
+	this->counter = nullptr;
+	this->unfinishedJobs = 0;
+}
+
+/*virtual*/ Job::~Job()
+{
+}
+
+//------------------------------- WorkStealingQueue -------------------------------
+
+WorkStealingQueue::WorkStealingQueue()
+{
+	this->top = 0;
+	this->bottom = 0;
+
+	for (int64_t i = 0; i < CAPACITY; i++)
+		this->jobArray[i] = nullptr;
+}
+
+/*virtual*/ WorkStealingQueue::~WorkStealingQueue()
+{
+}
+
+bool WorkStealingQueue::Push(Job* job)
+{
+	int64_t b = this->bottom.load(std::memory_order_relaxed);
+	int64_t t = this->top.load(std::memory_order_acquire);
+	if (b - t >= CAPACITY)
+		return false;
+
+	// The release here makes sure a thief that sees the new bottom also sees the job.
+	this->jobArray[b & MASK].store(job, std::memory_order_relaxed);
+	this->bottom.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+Job* WorkStealingQueue::Pop()
+{
+	int64_t b = this->bottom.load(std::memory_order_relaxed) - 1;
+	this->bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = this->top.load(std::memory_order_relaxed);
+
+	if (t > b)
+	{
+		// The deque was already empty.
+		this->bottom.store(b + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = this->jobArray[b & MASK].load(std::memory_order_relaxed);
+	if (t == b)
+	{
+		// This was the last job, so we may be racing a thief for it.
+		if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = nullptr;
+
+		this->bottom.store(b + 1, std::memory_order_relaxed);
+	}
+
+	return job;
+}
+
+Job* WorkStealingQueue::Steal()
+{
+	int64_t t = this->top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = this->bottom.load(std::memory_order_acquire);
+
+	if (t >= b)
+		return nullptr;
+
+	Job* job = this->jobArray[t & MASK].load(std::memory_order_relaxed);
+	if (!this->top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return nullptr;
+
+	return job;
+}
+
+//------------------------------- JobSystem -------------------------------
+
+JobSystem::JobSystem()
+{
+	this->numActiveWorkers = 0;
+	this->numQueuedJobs = 0;
+	this->numSleepingWorkers = 0;
+	this->signaledToExit = false;
+	this->externalJobPool = nullptr;
+	this->nextExternalJob = 0;
+}
+
+/*virtual*/ JobSystem::~JobSystem()
+{
+	this->Shutdown();
+}
+
+/*static*/ int JobSystem::GetThreadIndex()
+{
+	return jobSystemThreadIndex;
+}
+
+bool JobSystem::Startup(uint32_t numWorkers /*= 0*/)
+{
+	if (this->workerArray.size() > 0)
+	{
+		IMZADI_LOG_ERROR("Job system already started.");
+		return false;
+	}
+
+	if (numWorkers == 0)
+	{
+		uint32_t numHardwareThreads = std::thread::hardware_concurrency();
+		numWorkers = (numHardwareThreads > 1) ? (numHardwareThreads - 1) : 0;
+	}
+
+	this->signaledToExit = false;
+	this->numQueuedJobs = 0;
+	this->numSleepingWorkers = 0;
+	this->numActiveWorkers = numWorkers;
+
+	this->externalJobPool = new Job[JOB_POOL_SIZE];
+	this->nextExternalJob = 0;
+
+	// Slot zero is for the calling thread, which we consider the main thread.
+	for (uint32_t i = 0; i <= numWorkers; i++)
+	{
+		auto worker = new Worker();
+		worker->jobPool = new Job[JOB_POOL_SIZE];
+		worker->nextJob = 0;
+		worker->thread = nullptr;
+		this->workerArray.push_back(worker);
+	}
+
+	jobSystemThreadIndex = 0;
+
+	for (uint32_t i = 1; i <= numWorkers; i++)
+		this->workerArray[i]->thread = new std::thread(&JobSystem::EntryFunc, this, int(i));
+
+	IMZADI_LOG_INFO(std::format("Job system started with {} worker threads.", numWorkers));
+	return true;
+}
+
+bool JobSystem::Shutdown()
+{
+	if (this->workerArray.size() == 0)
+		return true;
+
+	// Drain whatever is left so that no job is silently dropped.
+	while (this->HelpWithWork())
+	{
+	}
+
+	this->signaledToExit = true;
+	{
+		std::lock_guard<std::mutex> lock(this->sleepMutex);
+		this->sleepCondVar.notify_all();
+	}
+
+	// Don't free anything until all workers are gone, since they steal from one another.
+	for (Worker* worker : this->workerArray)
+	{
+		if (worker->thread)
+		{
+			worker->thread->join();
+			delete worker->thread;
+			worker->thread = nullptr;
+		}
+	}
+
+	for (Worker* worker : this->workerArray)
+	{
+		delete[] worker->jobPool;
+		delete worker;
+	}
+
+	this->workerArray.clear();
+
+	delete[] this->externalJobPool;
+	this->externalJobPool = nullptr;
+
+	if (jobSystemThreadIndex == 0)
+		jobSystemThreadIndex = -1;
+
+	return true;
+}
+
+void JobSystem::SetNumActiveWorkers(uint32_t numActiveWorkers)
+{
+	this->numActiveWorkers = std::min(numActiveWorkers, this->GetNumWorkers());
+	this->WakeWorkers();
+}
+
+/*static*/ void JobSystem::EntryFunc(JobSystem* jobSystem, int threadIndex)
+{
+	jobSystemThreadIndex = threadIndex;
+	IMZADI_PROFILE_THREAD(std::format("Worker {}", threadIndex));
+	jobSystem->WorkerRun(threadIndex);
+}
+
+void JobSystem::WorkerRun(int threadIndex)
+{
+	int idleCount = 0;
+
+	while (!this->signaledToExit)
+	{
+		bool active = (uint32_t)threadIndex <= this->numActiveWorkers.load(std::memory_order_relaxed);
+
+		Job* job = active ? this->FindJob(threadIndex) : nullptr;
+		if (job)
+		{
+			this->Execute(job);
+			idleCount = 0;
+			continue;
+		}
+
+		// Spinning for a bit helps keep latency down within a frame, but we don't want to burn a core between frames.
+		if (active && ++idleCount < 64)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(this->sleepMutex);
+		this->numSleepingWorkers++;
+		this->sleepCondVar.wait(lock, [this, threadIndex]() -> bool {
+			if (this->signaledToExit)
+				return true;
+
+			return this->numQueuedJobs.load() > 0 && (uint32_t)threadIndex <= this->numActiveWorkers.load();
+		});
+		this->numSleepingWorkers--;
+		idleCount = 0;
+	}
+}
+
+void JobSystem::WakeWorkers()
+{
+	// Note that the sequentially consistent load here pairs with the store made by a worker going to sleep.
+	if (this->numSleepingWorkers.load() > 0)
+	{
+		std::lock_guard<std::mutex> lock(this->sleepMutex);
+		this->sleepCondVar.notify_all();
+	}
+}
+
+Job* JobSystem::AllocateJob(int threadIndex)
+{
+	Job* jobPool = nullptr;
+	uint32_t* nextJob = nullptr;
+
+	std::unique_lock<std::mutex> lock(this->externalMutex, std::defer_lock);
+	if (threadIndex < 0)
+	{
+		lock.lock();
+		jobPool = this->externalJobPool;
+		nextJob = &this->nextExternalJob;
+	}
+	else
+	{
+		Worker* worker = this->workerArray[threadIndex];
+		jobPool = worker->jobPool;
+		nextJob = &worker->nextJob;
+	}
+
+	// Jobs are recycled round-robin, but a job can stay in flight for a long time (e.g., a
+	// parent job waited on further up the call-stack), so skip over any that aren't finished.
+	while (true)
+	{
+		for (uint32_t i = 0; i < JOB_POOL_SIZE; i++)
+		{
+			Job* job = &jobPool[(*nextJob)++ % JOB_POOL_SIZE];
+			if (job->IsFinished())
+				return job;
+		}
+
+		if (threadIndex < 0 || !this->HelpWithWork())
+			std::this_thread::yield();
+	}
+
+	return nullptr;
+}
+
+Job* JobSystem::CreateJob(JobFunc func, Job* parent /*= nullptr*/, JobCounter* counter /*= nullptr*/)
+{
+	Job* job = this->AllocateJob(jobSystemThreadIndex);
+	job->func = func;
+	job->parent = parent;
+	job->counter = counter;
+	job->unfinishedJobs.store(1, std::memory_order_relaxed);
+
+	if (parent)
+		parent->unfinishedJobs.fetch_add(1, std::memory_order_relaxed);
+
+	if (counter)
+		counter->Increment();
+
+	return job;
+}
+
+void JobSystem::Run(Job* job)
+{
+	int threadIndex = jobSystemThreadIndex;
+	if (threadIndex < 0 || this->workerArray.size() == 0)
+	{
+		this->Execute(job);
+		return;
+	}
+
+	if (!this->workerArray[threadIndex]->queue.Push(job))
+	{
+		this->Execute(job);
+		return;
+	}
+
+	this->numQueuedJobs.fetch_add(1);
+	this->WakeWorkers();
+}
+
+void JobSystem::Wait(const Job* job)
+{
+	while (!job->IsFinished())
+		if (!this->HelpWithWork())
+			std::this_thread::yield();
+}
+
+void JobSystem::WaitForCounter(const JobCounter* counter)
+{
+	while (!counter->IsZero())
+		if (!this->HelpWithWork())
+			std::this_thread::yield();
+}
+
+bool JobSystem::HelpWithWork()
+{
+	int threadIndex = jobSystemThreadIndex;
+	if (threadIndex < 0 || this->workerArray.size() == 0)
+		return false;
+
+	Job* job = this->FindJob(threadIndex);
+	if (!job)
+		return false;
+
+	this->Execute(job);
+	return true;
+}
+
+Job* JobSystem::FindJob(int threadIndex)
+{
+	Job* job = this->workerArray[threadIndex]->queue.Pop();
+
+	if (!job)
+	{
+		// Start with our neighbor so that the thieves don't all gang up on the same victim.
+		int numThreads = (int)this->workerArray.size();
+		for (int i = 1; i < numThreads && !job; i++)
+			job = this->workerArray[(threadIndex + i) % numThreads]->queue.Steal();
+	}
+
+	if (job)
+		this->numQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+
+	return job;
+}
+
+void JobSystem::Execute(Job* job)
+{
+	if (job->func)
+	{
+		IMZADI_PROFILE("Job");
+		job->func();
+	}
+
+	this->Finish(job);
+}
+
+void JobSystem::Finish(Job* job)
+{
+	// Once the count hits zero, the job can be recycled by another thread, so read what we need first.
+	Job* parent = job->parent;
+	JobCounter* counter = job->counter;
+
+	if (job->unfinishedJobs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		if (parent)
+			this->Finish(parent);
+
+		if (counter)
+			counter->Decrement();
+	}
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& func)
+{
+	if (count == 0)
+		return;
+
+	grainSize = std::max(grainSize, 1u);
+	if (count <= grainSize || this->GetNumWorkers() == 0 || jobSystemThreadIndex < 0)
+	{
+		func(0, count);
+		return;
+	}
+
+	Job* rootJob = this->CreateJob(nullptr);
+
+	for (uint32_t begin = 0; begin < count; begin += grainSize)
+	{
+		uint32_t end = std::min(begin + grainSize, count);
+		Job* job = this->CreateJob([&func, begin, end]() { func(begin, end); }, rootJob);
+		this->Run(job);
+	}
+
+	// The root job has nothing to do itself, so just drop its own claim on being unfinished.
+	this->Finish(rootJob);
+	this->Wait(rootJob);
+}
\ No newline at end of file
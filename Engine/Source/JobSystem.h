@@ -0,0 +1,228 @@
+#pragma once
+
+#include "Defines.h"
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+namespace Imzadi
+{
+	class JobSystem;
+
+	typedef std::function<void()> JobFunc;
+
+	/**
+	 * A counter is a way to wait for an arbitrary set of jobs to finish.  Each job
+	 * made with a counter bumps the counter when it's created, and drops it when it
+	 * finishes.  This is the same idea as a parent job (see @ref JobSystem::CreateJob),
+	 * except that a counter doesn't have to be a job itself, and can be shared by
+	 * jobs that otherwise have nothing to do with one another.
+	 */
+	class IMZADI_API JobCounter
+	{
+	public:
+		JobCounter();
+		virtual ~JobCounter();
+
+		void Increment() { this->count.fetch_add(1, std::memory_order_relaxed); }
+		void Decrement() { this->count.fetch_sub(1, std::memory_order_acq_rel); }
+		bool IsZero() const { return this->count.load(std::memory_order_acquire) == 0; }
+		int32_t GetCount() const { return this->count.load(std::memory_order_acquire); }
+
+	private:
+		std::atomic<int32_t> count;
+	};
+
+	/**
+	 * A job is a function to call on some thread of the job system.  A job is not
+	 * finished until its function has returned and all of its child jobs (if any)
+	 * have also finished.  Jobs are owned by the job system and recycled, so don't
+	 * hold on to a job pointer any longer than it takes to wait on it.
+	 */
+	class IMZADI_API Job
+	{
+		friend class JobSystem;
+
+	public:
+		Job();
+		virtual ~Job();
+
+		bool IsFinished() const { return this->unfinishedJobs.load(std::memory_order_acquire) == 0; }
+
+	private:
+		JobFunc func;
+		Job* parent;
+		JobCounter* counter;
+		std::atomic<int32_t> unfinishedJobs;
+	};
+
+	/**
+	 * This is a fixed-capacity, lock-free, work-stealing deque of jobs.  Only the
+	 * thread that owns the deque may push and pop (at the bottom), but any thread
+	 * may steal (from the top.)  This is the well-known Chase-Lev algorithm.
+	 */
+	class IMZADI_API WorkStealingQueue
+	{
+	public:
+		WorkStealingQueue();
+		virtual ~WorkStealingQueue();
+
+		/**
+		 * Add a job to the bottom of the deque.  Call this only from the owning thread.
+		 *
+		 * @return False is returned if the deque is full, in which case the caller should just execute the job.
+		 */
+		bool Push(Job* job);
+
+		/**
+		 * Take a job from the bottom of the deque.  Call this only from the owning thread.
+		 *
+		 * @return Null is returned if the deque is empty.
+		 */
+		Job* Pop();
+
+		/**
+		 * Take a job from the top of the deque.  This can be called from any thread.
+		 *
+		 * @return Null is returned if the deque is empty or if we lost a race for the last job.
+		 */
+		Job* Steal();
+
+	private:
+		static const int64_t CAPACITY = 4096;
+		static const int64_t MASK = CAPACITY - 1;
+
+		alignas(64) std::atomic<int64_t> top;
+		alignas(64) std::atomic<int64_t> bottom;
+		std::atomic<Job*> jobArray[CAPACITY];
+	};
+
+	/**
+	 * This is a pool of worker threads that execute jobs.  Each thread (including
+	 * the main thread, which participates whenever it waits) has its own deque of
+	 * jobs, and threads that run out of work steal from the others.  Parallelism
+	 * is expressed as fork/join: a job can spawn child jobs, and waiting on a job
+	 * waits for all of its children too.  While waiting, a thread executes other
+	 * jobs rather than going to sleep.
+	 *
+	 * Only the thread that called @ref Startup (the main thread) and the worker
+	 * threads may create and run jobs.  Any other thread that tries to run a job
+	 * will just execute it immediately.
+	 */
+	class IMZADI_API JobSystem
+	{
+	public:
+		JobSystem();
+		virtual ~JobSystem();
+
+		/**
+		 * Spin up the worker threads.
+		 *
+		 * @param[in] numWorkers This is the number of worker threads to create.  If zero, we use one less than the number of hardware threads.
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool Startup(uint32_t numWorkers = 0);
+
+		/**
+		 * Wait for the worker threads to exit.  Any jobs still queued are executed first.
+		 */
+		bool Shutdown();
+
+		/**
+		 * Make a job that can then be kicked off with @ref Run.
+		 *
+		 * @param[in] func This is the work to be done by the job.  It can be null, in which case the job is just a place-holder parent.
+		 * @param[in] parent If given, this job won't be finished until the returned job is finished.  The parent must not yet be finished.
+		 * @param[in] counter If given, this counter is incremented now, and decremented when the returned job finishes.
+		 */
+		Job* CreateJob(JobFunc func, Job* parent = nullptr, JobCounter* counter = nullptr);
+
+		/**
+		 * Queue the given job for execution on the calling thread's deque.
+		 */
+		void Run(Job* job);
+
+		/**
+		 * Block until the given job (and all its children) are finished.  Other jobs are executed while we wait.
+		 */
+		void Wait(const Job* job);
+
+		/**
+		 * Block until the given counter drops to zero.  Other jobs are executed while we wait.
+		 */
+		void WaitForCounter(const JobCounter* counter);
+
+		/**
+		 * Call the given function over the range [0,count) in chunks of the given size, in parallel, and then wait for it all to finish.
+		 *
+		 * @param[in] count This is the number of items to process.
+		 * @param[in] grainSize This is the maximum number of items handled by each job.
+		 * @param[in] func This is called with a half-open range [begin,end) of items to process.
+		 */
+		void ParallelFor(uint32_t count, uint32_t grainSize, const std::function<void(uint32_t begin, uint32_t end)>& func);
+
+		/**
+		 * Execute at most one queued job on the calling thread.
+		 *
+		 * @return True is returned if a job was executed; false, otherwise.
+		 */
+		bool HelpWithWork();
+
+		/**
+		 * Return the number of worker threads, not counting the main thread.
+		 */
+		uint32_t GetNumWorkers() const { return (uint32_t)this->workerArray.size() - 1; }
+
+		/**
+		 * Limit how many of the worker threads are allowed to take jobs.  This is
+		 * mainly for measuring how well things scale with the number of cores.
+		 */
+		void SetNumActiveWorkers(uint32_t numActiveWorkers);
+		uint32_t GetNumActiveWorkers() const { return this->numActiveWorkers.load(std::memory_order_relaxed); }
+
+		/**
+		 * Return the index of the calling thread in the job system: zero for the
+		 * main thread, [1,N] for the workers, and -1 for any other thread.
+		 */
+		static int GetThreadIndex();
+
+	private:
+
+		/**
+		 * This is the number of jobs each thread can have in flight at once.
+		 * A thread that runs out has to help finish some before it can make more.
+		 */
+		static const uint32_t JOB_POOL_SIZE = 4096;
+
+		struct Worker
+		{
+			WorkStealingQueue queue;
+			Job* jobPool;
+			uint32_t nextJob;
+			std::thread* thread;
+		};
+
+		static void EntryFunc(JobSystem* jobSystem, int threadIndex);
+
+		void WorkerRun(int threadIndex);
+		Job* FindJob(int threadIndex);
+		void Execute(Job* job);
+		void Finish(Job* job);
+		Job* AllocateJob(int threadIndex);
+		void WakeWorkers();
+
+		std::vector<Worker*> workerArray;
+		std::atomic<uint32_t> numActiveWorkers;
+		std::atomic<int32_t> numQueuedJobs;
+		std::atomic<int32_t> numSleepingWorkers;
+		std::atomic<bool> signaledToExit;
+		std::mutex sleepMutex;
+		std::condition_variable sleepCondVar;
+		std::mutex externalMutex;
+		Job* externalJobPool;
+		uint32_t nextExternalJob;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,567 @@
+#include "LZCodec.h"
+#include "JobSystem.h"
+#include "Log.h"
+#include <string.h>
+#include <bit>
+
+using namespace Imzadi;
+
+namespace
+{
+	const int HASH_BITS = 16;
+	const int LAZY_LEVEL = 4;
+	const uint32_t HEADER_SIZE = 4 * sizeof(uint32_t);
+	const uint32_t STREAM_BATCH_CHUNKS = 16;
+
+	uint32_t HashSequence(const unsigned char* bytes)
+	{
+		uint32_t sequence = 0;
+		::memcpy(&sequence, bytes, sizeof(uint32_t));
+		return (sequence * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	/**
+	 * Count how many bytes at the two given places are the same, eight at a time.
+	 */
+	uint32_t CountMatchingBytes(const unsigned char* earlier, const unsigned char* current, const unsigned char* currentEnd)
+	{
+		const unsigned char* start = current;
+
+		while (currentEnd - current >= (ptrdiff_t)sizeof(uint64_t))
+		{
+			uint64_t earlierBytes = 0, currentBytes = 0;
+			::memcpy(&earlierBytes, earlier, sizeof(uint64_t));
+			::memcpy(&currentBytes, current, sizeof(uint64_t));
+			uint64_t difference = earlierBytes ^ currentBytes;
+			if (difference != 0)
+				return uint32_t(current - start) + std::countr_zero(difference) / 8;
+
+			earlier += sizeof(uint64_t);
+			current += sizeof(uint64_t);
+		}
+
+		while (current < currentEnd && *earlier == *current)
+		{
+			earlier++;
+			current++;
+		}
+
+		return uint32_t(current - start);
+	}
+
+	unsigned char* WriteLength(unsigned char* output, uint32_t length)
+	{
+		while (length >= 255)
+		{
+			*output++ = 255;
+			length -= 255;
+		}
+
+		*output++ = (unsigned char)length;
+		return output;
+	}
+
+	bool ReadLength(const unsigned char*& input, const unsigned char* inputEnd, uint32_t maxLength, uint32_t& length)
+	{
+		uint32_t byte = 0;
+		do
+		{
+			if (input >= inputEnd || length > maxLength)
+				return false;
+
+			byte = *input++;
+			length += byte;
+		} while (byte == 255);
+
+		return true;
+	}
+
+	/**
+	 * Write out the given literals followed by a match of the given length, if any.
+	 */
+	unsigned char* WriteSequence(unsigned char* output, const unsigned char* literals, uint32_t numLiterals, uint32_t offset, uint32_t matchLength)
+	{
+		unsigned char* token = output++;
+		*token = (unsigned char)(IMZADI_MIN(numLiterals, 15u) << 4);
+		if (numLiterals >= 15)
+			output = WriteLength(output, numLiterals - 15);
+
+		::memcpy(output, literals, numLiterals);
+		output += numLiterals;
+
+		if (matchLength > 0)
+		{
+			*output++ = (unsigned char)(offset & 0xFF);
+			*output++ = (unsigned char)(offset >> 8);
+
+			uint32_t matchCode = matchLength - LZCodec::MIN_MATCH;
+			*token |= (unsigned char)IMZADI_MIN(matchCode, 15u);
+			if (matchCode >= 15)
+				output = WriteLength(output, matchCode - 15);
+		}
+
+		return output;
+	}
+}
+
+LZCodec::LZCodec()
+{
+}
+
+/*virtual*/ LZCodec::~LZCodec()
+{
+}
+
+bool LZCodec::Compress(const unsigned char* data, uint32_t dataSize, std::vector<unsigned char>& payload, int level, uint32_t chunkSize, JobSystem* jobSystem)
+{
+	if (level < MIN_LEVEL || level > MAX_LEVEL)
+	{
+		IMZADI_LOG_ERROR("Compression level %d is not in the range [%d, %d].", level, MIN_LEVEL, MAX_LEVEL);
+		return false;
+	}
+
+	if (chunkSize == 0 || (chunkSize & STORED_CHUNK_FLAG) != 0)
+	{
+		IMZADI_LOG_ERROR("Chunk size %u is not supported.", chunkSize);
+		return false;
+	}
+
+	uint32_t numChunks = uint32_t((uint64_t(dataSize) + chunkSize - 1) / chunkSize);
+	std::vector<std::vector<unsigned char>> chunkArray(numChunks);
+	std::vector<uint32_t> chunkSizeArray(numChunks);
+
+	auto compressFunc = [=, &chunkArray, &chunkSizeArray](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			const unsigned char* chunkData = &data[i * chunkSize];
+			uint32_t chunkDataSize = IMZADI_MIN(chunkSize, dataSize - i * chunkSize);
+
+			// A chunk can't grow by more than a byte per 255 literals, plus a token.
+			std::vector<unsigned char>& chunk = chunkArray[i];
+			chunk.resize(chunkDataSize + chunkDataSize / 255 + 16);
+			uint32_t compressedSize = CompressChunk(chunkData, chunkDataSize, chunk.data(), level);
+			if (compressedSize < chunkDataSize)
+			{
+				chunk.resize(compressedSize);
+				chunkSizeArray[i] = compressedSize;
+			}
+			else
+			{
+				chunk.assign(chunkData, chunkData + chunkDataSize);
+				chunkSizeArray[i] = chunkDataSize | STORED_CHUNK_FLAG;
+			}
+		}
+	};
+
+	if (jobSystem)
+		jobSystem->ParallelFor(numChunks, 1, compressFunc);
+	else
+		compressFunc(0, numChunks);
+
+	uint64_t payloadSize = HEADER_SIZE + numChunks * sizeof(uint32_t);
+	for (const std::vector<unsigned char>& chunk : chunkArray)
+		payloadSize += chunk.size();
+
+	if (payloadSize > 0xFFFFFFFF)
+	{
+		IMZADI_LOG_ERROR("Compressed payload would be too big.");
+		return false;
+	}
+
+	payload.resize(payloadSize);
+	unsigned char* output = payload.data();
+	WriteUint32(&output[0], MAGIC);
+	WriteUint32(&output[4], dataSize);
+	WriteUint32(&output[8], chunkSize);
+	WriteUint32(&output[12], numChunks);
+	output += HEADER_SIZE;
+
+	for (uint32_t i = 0; i < numChunks; i++)
+	{
+		WriteUint32(output, chunkSizeArray[i]);
+		output += sizeof(uint32_t);
+	}
+
+	for (const std::vector<unsigned char>& chunk : chunkArray)
+	{
+		::memcpy(output, chunk.data(), chunk.size());
+		output += chunk.size();
+	}
+
+	return true;
+}
+
+bool LZCodec::Decompress(const unsigned char* payload, uint32_t payloadSize, unsigned char* data, uint32_t dataSize, JobSystem* jobSystem)
+{
+	if (!IsPayload(payload, payloadSize))
+	{
+		IMZADI_LOG_ERROR("Buffer is not a compressed payload.");
+		return false;
+	}
+
+	uint32_t chunkSize = 0, numChunks = 0;
+	if (!ReadHeader(payload, dataSize, chunkSize, numChunks))
+		return false;
+
+	if (HEADER_SIZE + uint64_t(numChunks) * sizeof(uint32_t) > payloadSize)
+	{
+		IMZADI_LOG_ERROR("Payload is truncated.");
+		return false;
+	}
+
+	// Find where each chunk starts so that they can all be decompressed at once.
+	const unsigned char* chunkTable = &payload[HEADER_SIZE];
+	std::vector<const unsigned char*> chunkArray(numChunks);
+	uint64_t chunkOffset = HEADER_SIZE + numChunks * sizeof(uint32_t);
+	for (uint32_t i = 0; i < numChunks; i++)
+	{
+		chunkArray[i] = &payload[chunkOffset];
+		chunkOffset += ReadUint32(&chunkTable[i * sizeof(uint32_t)]) & ~STORED_CHUNK_FLAG;
+		if (chunkOffset > payloadSize)
+		{
+			IMZADI_LOG_ERROR("Payload is truncated.");
+			return false;
+		}
+	}
+
+	return DecompressChunks(chunkArray.data(), chunkTable, 0, numChunks, chunkSize, data, dataSize, jobSystem);
+}
+
+bool LZCodec::Decompress(std::istream& stream, unsigned char* data, uint32_t dataSize, JobSystem* jobSystem)
+{
+	unsigned char header[HEADER_SIZE];
+	if (!stream.read((char*)header, HEADER_SIZE) || ReadUint32(header) != MAGIC)
+	{
+		IMZADI_LOG_ERROR("Stream does not hold a compressed payload.");
+		return false;
+	}
+
+	uint32_t chunkSize = 0, numChunks = 0;
+	if (!ReadHeader(header, dataSize, chunkSize, numChunks))
+		return false;
+
+	std::vector<unsigned char> chunkTable(numChunks * sizeof(uint32_t));
+	if (!stream.read((char*)chunkTable.data(), chunkTable.size()))
+	{
+		IMZADI_LOG_ERROR("Payload is truncated.");
+		return false;
+	}
+
+	// Stored chunks are read straight into their place in the data.  Compressed ones are read
+	// a batch at a time into a staging buffer and then decompressed in parallel, so that no more
+	// than a batch of compressed chunks is ever held in memory alongside the data.
+	std::vector<unsigned char> stagingBuffer;
+	std::vector<const unsigned char*> chunkArray;
+	for (uint32_t firstChunk = 0; firstChunk < numChunks; firstChunk += STREAM_BATCH_CHUNKS)
+	{
+		uint32_t numBatchChunks = IMZADI_MIN(STREAM_BATCH_CHUNKS, numChunks - firstChunk);
+
+		// A chunk is only compressed if that makes it smaller, which also bounds the staging buffer.
+		uint32_t stagingSize = 0;
+		for (uint32_t i = firstChunk; i < firstChunk + numBatchChunks; i++)
+		{
+			uint32_t chunkEntry = ReadUint32(&chunkTable[i * sizeof(uint32_t)]);
+			if ((chunkEntry & STORED_CHUNK_FLAG) != 0)
+				continue;
+
+			if (chunkEntry >= chunkSize)
+			{
+				IMZADI_LOG_ERROR("Chunk %u of the payload is corrupt.", i);
+				return false;
+			}
+
+			stagingSize += chunkEntry;
+		}
+
+		stagingBuffer.resize(stagingSize);
+		chunkArray.resize(numBatchChunks);
+		uint32_t stagingOffset = 0;
+
+		for (uint32_t i = firstChunk; i < firstChunk + numBatchChunks; i++)
+		{
+			uint32_t chunkEntry = ReadUint32(&chunkTable[i * sizeof(uint32_t)]);
+			uint32_t compressedSize = chunkEntry & ~STORED_CHUNK_FLAG;
+			unsigned char* chunk = nullptr;
+
+			if ((chunkEntry & STORED_CHUNK_FLAG) == 0)
+			{
+				chunk = stagingBuffer.data() + stagingOffset;
+				stagingOffset += compressedSize;
+			}
+			else
+			{
+				if (compressedSize != IMZADI_MIN(chunkSize, dataSize - i * chunkSize))
+				{
+					IMZADI_LOG_ERROR("Chunk %u of the payload is corrupt.", i);
+					return false;
+				}
+
+				chunk = &data[i * chunkSize];
+			}
+
+			if (!stream.read((char*)chunk, compressedSize))
+			{
+				IMZADI_LOG_ERROR("Payload is truncated.");
+				return false;
+			}
+
+			chunkArray[i - firstChunk] = chunk;
+		}
+
+		if (!DecompressChunks(chunkArray.data(), chunkTable.data(), firstChunk, numBatchChunks, chunkSize, data, dataSize, jobSystem))
+			return false;
+	}
+
+	return true;
+}
+
+/*static*/ bool LZCodec::IsPayload(const unsigned char* payload, uint32_t payloadSize)
+{
+	return payloadSize >= HEADER_SIZE && ReadUint32(payload) == MAGIC;
+}
+
+/*static*/ bool LZCodec::IsPayload(std::istream& stream)
+{
+	std::streampos position = stream.tellg();
+	unsigned char header[HEADER_SIZE];
+	bool isPayload = stream.read((char*)header, HEADER_SIZE) && ReadUint32(header) == MAGIC;
+	stream.clear();
+	stream.seekg(position);
+	return isPayload;
+}
+
+/*static*/ bool LZCodec::GetDecompressedSize(const unsigned char* payload, uint32_t payloadSize, uint32_t& dataSize)
+{
+	if (!IsPayload(payload, payloadSize))
+	{
+		IMZADI_LOG_ERROR("Buffer is not a compressed payload.");
+		return false;
+	}
+
+	dataSize = ReadUint32(&payload[4]);
+	return true;
+}
+
+/*static*/ uint32_t LZCodec::CompressChunk(const unsigned char* data, uint32_t dataSize, unsigned char* chunk, int level)
+{
+	// Each level doubles how many earlier occurrences of a sequence we look at for the longest match.
+	// From the lazy level up, we also check if waiting a byte would give a longer match.
+	uint32_t maxSearchLength = 1 << (level - 1);
+	bool lazy = level >= LAZY_LEVEL;
+
+	// For each hash of MIN_MATCH bytes, this is the last place they were seen, and for each
+	// place, this is the one before it with the same hash.
+	std::vector<int32_t> hashHeadArray(1 << HASH_BITS, -1);
+	std::vector<int32_t> hashChainArray(dataSize);
+	uint32_t numHashed = 0;
+
+	auto findMatch = [&](uint32_t position, uint32_t& offset) -> uint32_t
+	{
+		while (numHashed < position)
+		{
+			uint32_t hash = HashSequence(&data[numHashed]);
+			hashChainArray[numHashed] = hashHeadArray[hash];
+			hashHeadArray[hash] = int32_t(numHashed++);
+		}
+
+		uint32_t bestLength = 0;
+		int32_t candidate = hashHeadArray[HashSequence(&data[position])];
+		for (uint32_t i = 0; i < maxSearchLength && candidate >= 0; i++, candidate = hashChainArray[candidate])
+		{
+			if (position - candidate > MAX_OFFSET)
+				break;
+
+			// Only a match longer than the best so far is of interest, so check its last byte first.
+			if (data[candidate + bestLength] != data[position + bestLength])
+				continue;
+
+			uint32_t length = CountMatchingBytes(&data[candidate], &data[position], &data[dataSize]);
+			if (length > bestLength)
+			{
+				bestLength = length;
+				offset = position - candidate;
+				if (position + length == dataSize)
+					break;
+			}
+		}
+
+		return (bestLength >= MIN_MATCH) ? bestLength : 0;
+	};
+
+	unsigned char* output = chunk;
+	uint32_t literalStart = 0;
+	uint32_t position = 0;
+	while (position + MIN_MATCH <= dataSize)
+	{
+		uint32_t offset = 0;
+		uint32_t length = findMatch(position, offset);
+		if (length == 0)
+		{
+			position++;
+			continue;
+		}
+
+		while (lazy && position + 1 + MIN_MATCH <= dataSize)
+		{
+			uint32_t nextOffset = 0;
+			uint32_t nextLength = findMatch(position + 1, nextOffset);
+			if (nextLength <= length)
+				break;
+
+			position++;
+			length = nextLength;
+			offset = nextOffset;
+		}
+
+		output = WriteSequence(output, &data[literalStart], position - literalStart, offset, length);
+		position += length;
+		literalStart = position;
+	}
+
+	// The chunk always ends with a sequence of just literals, even if there are none.
+	output = WriteSequence(output, &data[literalStart], dataSize - literalStart, 0, 0);
+	return uint32_t(output - chunk);
+}
+
+/*static*/ bool LZCodec::ReadHeader(const unsigned char* header, uint32_t dataSize, uint32_t& chunkSize, uint32_t& numChunks)
+{
+	uint32_t decompressedSize = ReadUint32(&header[4]);
+	if (decompressedSize != dataSize)
+	{
+		IMZADI_LOG_ERROR("Payload decompresses to %u bytes, but %u were expected.", decompressedSize, dataSize);
+		return false;
+	}
+
+	chunkSize = ReadUint32(&header[8]);
+	numChunks = ReadUint32(&header[12]);
+	if (chunkSize == 0 || uint64_t(numChunks) != (uint64_t(dataSize) + chunkSize - 1) / chunkSize)
+	{
+		IMZADI_LOG_ERROR("Payload header is corrupt.");
+		return false;
+	}
+
+	return true;
+}
+
+/*static*/ bool LZCodec::DecompressChunks(const unsigned char* const* chunkArray, const unsigned char* chunkTable, uint32_t firstChunk, uint32_t numChunks, uint32_t chunkSize, unsigned char* data, uint32_t dataSize, JobSystem* jobSystem)
+{
+	std::vector<unsigned char> chunkValidArray(numChunks);
+
+	auto decompressFunc = [=, &chunkValidArray](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t j = begin; j < end; j++)
+		{
+			uint32_t i = firstChunk + j;
+			unsigned char* chunkData = &data[i * chunkSize];
+			uint32_t chunkDataSize = IMZADI_MIN(chunkSize, dataSize - i * chunkSize);
+			uint32_t chunkEntry = ReadUint32(&chunkTable[i * sizeof(uint32_t)]);
+			uint32_t compressedSize = chunkEntry & ~STORED_CHUNK_FLAG;
+			const unsigned char* chunk = chunkArray[j];
+
+			if ((chunkEntry & STORED_CHUNK_FLAG) == 0)
+				chunkValidArray[j] = DecompressChunk(chunk, compressedSize, chunkData, chunkDataSize);
+			else if (compressedSize == chunkDataSize)
+			{
+				// A stored chunk streamed in was already read into place.
+				if (chunk != chunkData)
+					::memcpy(chunkData, chunk, chunkDataSize);
+
+				chunkValidArray[j] = true;
+			}
+		}
+	};
+
+	if (jobSystem)
+		jobSystem->ParallelFor(numChunks, 1, decompressFunc);
+	else
+		decompressFunc(0, numChunks);
+
+	for (uint32_t j = 0; j < numChunks; j++)
+	{
+		if (!chunkValidArray[j])
+		{
+			IMZADI_LOG_ERROR("Chunk %u of the payload is corrupt.", firstChunk + j);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*static*/ bool LZCodec::DecompressChunk(const unsigned char* chunk, uint32_t chunkSize, unsigned char* data, uint32_t dataSize)
+{
+	const unsigned char* input = chunk;
+	const unsigned char* inputEnd = chunk + chunkSize;
+	unsigned char* output = data;
+	unsigned char* outputEnd = data + dataSize;
+
+	while (input < inputEnd)
+	{
+		uint32_t token = *input++;
+
+		uint32_t numLiterals = token >> 4;
+		if (numLiterals == 15 && !ReadLength(input, inputEnd, dataSize, numLiterals))
+			return false;
+
+		if (numLiterals > uint32_t(inputEnd - input) || numLiterals > uint32_t(outputEnd - output))
+			return false;
+
+		::memcpy(output, input, numLiterals);
+		input += numLiterals;
+		output += numLiterals;
+
+		if (input == inputEnd)
+			return output == outputEnd;
+
+		if (inputEnd - input < 2)
+			return false;
+
+		uint32_t offset = uint32_t(input[0]) | (uint32_t(input[1]) << 8);
+		input += 2;
+		if (offset == 0 || offset > uint32_t(output - data))
+			return false;
+
+		uint32_t matchLength = token & 0x0F;
+		if (matchLength == 15 && !ReadLength(input, inputEnd, dataSize, matchLength))
+			return false;
+
+		matchLength += MIN_MATCH;
+		if (matchLength > uint32_t(outputEnd - output))
+			return false;
+
+		const unsigned char* match = output - offset;
+		if (offset >= matchLength)
+			::memcpy(output, match, matchLength);
+		else
+		{
+			// An overlapping match repeats its first offset bytes, so once those are copied,
+			// what's been written so far can be copied again, doubling it each time.
+			::memcpy(output, match, offset);
+			uint32_t numCopied = offset;
+			while (numCopied < matchLength)
+			{
+				uint32_t copySize = IMZADI_MIN(numCopied, matchLength - numCopied);
+				::memcpy(&output[numCopied], output, copySize);
+				numCopied += copySize;
+			}
+		}
+
+		output += matchLength;
+	}
+
+	return false;
+}
+
+/*static*/ uint32_t LZCodec::ReadUint32(const unsigned char* buffer)
+{
+	return uint32_t(buffer[0]) | (uint32_t(buffer[1]) << 8) | (uint32_t(buffer[2]) << 16) | (uint32_t(buffer[3]) << 24);
+}
+
+/*static*/ void LZCodec::WriteUint32(unsigned char* buffer, uint32_t value)
+{
+	buffer[0] = (unsigned char)(value & 0xFF);
+	buffer[1] = (unsigned char)((value >> 8) & 0xFF);
+	buffer[2] = (unsigned char)((value >> 16) & 0xFF);
+	buffer[3] = (unsigned char)((value >> 24) & 0xFF);
+}
\ No newline at end of file
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "Defines.h"
+#include <vector>
+#include <istream>
+
+namespace Imzadi
+{
+	class JobSystem;
+
+	/**
+	 * This is a small LZ77 codec, in the spirit of LZ4, used for asset payloads such as
+	 * texture data.  It favors decode speed over ratio: there's no entropy coding, just
+	 * runs of literal bytes alternating with copies of up to 64 KB back, so decoding is
+	 * little more than a series of memcpy() calls.  How hard the encoder looks for long
+	 * matches is set by a level from MIN_LEVEL to MAX_LEVEL.
+	 *
+	 * The data is split into fixed-size chunks, each compressed on its own, so that chunks
+	 * can be compressed and decompressed in parallel on the job system, each decoding straight
+	 * into its own part of the destination buffer.  A chunk that doesn't shrink is stored as-is.
+	 *
+	 * A payload is laid out as follows, with all integers little-endian.
+	 *
+	 *  - uint32 MAGIC
+	 *  - uint32 size of the data once decompressed
+	 *  - uint32 chunk size (the last chunk may be smaller)
+	 *  - uint32 number of chunks
+	 *  - uint32 per chunk, its size in the payload, with STORED_CHUNK_FLAG set if it isn't compressed
+	 *  - the chunks, back to back
+	 *
+	 * Within a compressed chunk, each sequence starts with a token byte whose high nibble is
+	 * the number of literals and whose low nibble is the match length, less MIN_MATCH.  A nibble
+	 * of 15 is followed by bytes added on to it, up to and including the first that isn't 255.
+	 * Then come the literals, and then, unless the chunk ends there, a 16-bit match offset.
+	 */
+	class IMZADI_API LZCodec
+	{
+	public:
+		LZCodec();
+		virtual ~LZCodec();
+
+		static const uint32_t MAGIC = 0x5A4C5A49;		// "IZLZ"
+		static const uint32_t STORED_CHUNK_FLAG = 0x80000000;
+		static const uint32_t DEFAULT_CHUNK_SIZE = 256 * 1024;
+		static const uint32_t MIN_MATCH = 4;
+		static const uint32_t MAX_OFFSET = 0xFFFF;
+		static const int MIN_LEVEL = 1;
+		static const int MAX_LEVEL = 9;
+		static const int DEFAULT_LEVEL = 6;
+
+		/**
+		 * Compress the given data into a payload.
+		 *
+		 * @param[in] data This is the data to compress.
+		 * @param[in] dataSize This is the size of the data in bytes.
+		 * @param[out] payload This is overwritten with the payload.
+		 * @param[in] level Higher levels search harder for matches, which is slower, but compresses better.
+		 * @param[in] chunkSize This is how many bytes of the data go into each chunk.
+		 * @param[in] jobSystem If given, chunks are compressed in parallel on this job system.
+		 * @return True is returned on success; false otherwise.
+		 */
+		bool Compress(const unsigned char* data, uint32_t dataSize, std::vector<unsigned char>& payload, int level, uint32_t chunkSize, JobSystem* jobSystem);
+
+		/**
+		 * Decompress the given payload into the given buffer, which must be exactly the size
+		 * the data was before it was compressed.  The payload is validated as it's decoded, so
+		 * a corrupt or truncated payload makes this fail rather than write out of bounds.
+		 *
+		 * @param[in] jobSystem If given, chunks are decompressed in parallel on this job system.
+		 * @return True is returned on success; false otherwise.
+		 */
+		bool Decompress(const unsigned char* payload, uint32_t payloadSize, unsigned char* data, uint32_t dataSize, JobSystem* jobSystem);
+
+		/**
+		 * Decompress a payload read from the given stream into the given buffer, which must be exactly
+		 * the size the data was before it was compressed.  This never holds the whole payload in memory.
+		 * Chunks stored as-is are read straight into place, and compressed ones are read a few at a time
+		 * and decompressed in parallel.
+		 *
+		 * @param[in] stream The payload is read from here, starting at the stream's current position.
+		 * @param[in] jobSystem If given, chunks are decompressed in parallel on this job system.
+		 * @return True is returned on success; false otherwise.
+		 */
+		bool Decompress(std::istream& stream, unsigned char* data, uint32_t dataSize, JobSystem* jobSystem);
+
+		/**
+		 * Tell if the given buffer starts like a payload made by this codec.
+		 */
+		static bool IsPayload(const unsigned char* payload, uint32_t payloadSize);
+
+		/**
+		 * Tell if the given stream, from its current position, starts like a payload made by this codec.
+		 * The stream is left where it was.
+		 */
+		static bool IsPayload(std::istream& stream);
+
+		/**
+		 * Get the size the data in the given payload will be once decompressed.
+		 */
+		static bool GetDecompressedSize(const unsigned char* payload, uint32_t payloadSize, uint32_t& dataSize);
+
+	private:
+
+		static uint32_t CompressChunk(const unsigned char* data, uint32_t dataSize, unsigned char* chunk, int level);
+		static bool DecompressChunk(const unsigned char* chunk, uint32_t chunkSize, unsigned char* data, uint32_t dataSize);
+		static bool DecompressChunks(const unsigned char* const* chunkArray, const unsigned char* chunkTable, uint32_t firstChunk, uint32_t numChunks, uint32_t chunkSize, unsigned char* data, uint32_t dataSize, JobSystem* jobSystem);
+		static bool ReadHeader(const unsigned char* header, uint32_t dataSize, uint32_t& chunkSize, uint32_t& numChunks);
+
+		static uint32_t ReadUint32(const unsigned char* buffer);
+		static void WriteUint32(unsigned char* buffer, uint32_t value);
+	};
+}
\ No newline at end of file
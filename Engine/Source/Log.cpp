@@ -1,5 +1,6 @@
 #include "Log.h"
 #include <ctime>
+#include <format>
 #include <stdarg.h>
 #include <windows.h>
 
@@ -9,11 +10,25 @@ using namespace Imzadi;
 
 LoggingSystem::LoggingSystem()
 {
+	this->numRoutes = 0;
+	this->slotArray = new Slot[QUEUE_SIZE];
+	for (uint32_t i = 0; i < QUEUE_SIZE; i++)
+		this->slotArray[i].sequence = i;
+	this->enqueuePosition = 0;
+	this->dequeuePosition = 0;
+	this->flushedPosition = 0;
+	this->numDroppedMessages = 0;
+	this->numReportedDroppedMessages = 0;
+	this->writerThread = nullptr;
+	this->writerThreadExitSignaled = false;
+	this->writerThreadWakeCount = 0;
 }
 
 /*virtual*/ LoggingSystem::~LoggingSystem()
 {
 	this->ClearAllRoutes();
+
+	delete[] this->slotArray;
 }
 
 void LoggingSystem::PrintLogMessage(uint32_t messageFlags, const char* format, ...)
@@ -21,103 +36,312 @@ void LoggingSystem::PrintLogMessage(uint32_t messageFlags, const char* format, .
 	va_list args;
 	va_start(args, format);
 
-	char logMessageBuffer[1024];
+	static thread_local char logMessageBuffer[MAX_MESSAGE_LENGTH];
 	vsprintf_s(logMessageBuffer, sizeof(logMessageBuffer), format, args);
 
-	std::string logMessage(logMessageBuffer);
-	this->PrintLogMessage(messageFlags, logMessage);
-
 	va_end(args);
+
+	this->EnqueueLogMessage(messageFlags, logMessageBuffer);
+
+	if ((messageFlags & IMZADI_LOG_FATAL_ERROR_FLAG) != 0)
+		this->HaltOnFatalError();
 }
 
 void LoggingSystem::PrintLogMessage(uint32_t messageFlags, const std::string& logMessage)
 {
-	std::time_t time = std::time(nullptr);
-	char timeBuffer[128];
-	std::strftime(timeBuffer, sizeof(timeBuffer), "%T", std::localtime(&time));
-	std::string timeStampedLogMessage = std::format("{}: {}\n", timeBuffer, logMessage.c_str());
+	this->EnqueueLogMessage(messageFlags, logMessage.c_str());
 
-	std::lock_guard guard(this->mutex);
+	if ((messageFlags & IMZADI_LOG_FATAL_ERROR_FLAG) != 0)
+		this->HaltOnFatalError();
+}
+
+void LoggingSystem::HaltOnFatalError()
+{
+	// Make sure the reason we're halting gets written out.
+	this->Flush();
+
+	// We've encountered an error so bad that the program can't continue.
+	// Just hang out here until we're terminated.
 
-	for (auto pair : this->logRouteMap)
+	if (IsDebuggerPresent())
 	{
-		LogRoute* logRoute = pair.second;
-		if ((logRoute->GetFilterFlags() & messageFlags) != 0)
-			logRoute->PrintLogMessage(messageFlags, timeStampedLogMessage);
+		while (true)
+		{
+			DebugBreak();
+		}
 	}
-
-	if ((messageFlags & IMZADI_LOG_FATAL_ERROR_FLAG) != 0)
+	else
 	{
-		// We've encountered an error so bad that the program can't continue.
-		// Just hang out here until we're terminated.
+		while (true)
+		{
+			IMZADI_ASSERT(false);
+		}
+	}
+}
 
-		if (IsDebuggerPresent())
+void LoggingSystem::EnqueueLogMessage(uint32_t messageFlags, const char* logMessage)
+{
+	// With nowhere for the message to go, don't bother queuing it.
+	if (this->numRoutes.load(std::memory_order_relaxed) == 0)
+		return;
+
+	std::time_t time = std::time(nullptr);
+	std::tm localTime;
+	localtime_s(&localTime, &time);
+	char timeBuffer[128];
+	std::strftime(timeBuffer, sizeof(timeBuffer), "%T", &localTime);
+
+	// Claim the next slot, unless the queue is full.  A fatal error is never dropped; we wait for room instead.
+	Slot* slot = nullptr;
+	uint64_t position = this->enqueuePosition.load(std::memory_order_relaxed);
+	while (true)
+	{
+		slot = &this->slotArray[position & (QUEUE_SIZE - 1)];
+		int64_t difference = int64_t(slot->sequence.load(std::memory_order_acquire)) - int64_t(position);
+		if (difference == 0)
 		{
-			while (true)
+			if (this->enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (difference < 0)
+		{
+			if ((messageFlags & IMZADI_LOG_FATAL_ERROR_FLAG) == 0)
 			{
-				DebugBreak();
+				this->numDroppedMessages.fetch_add(1, std::memory_order_relaxed);
+				return;
 			}
+
+			this->WakeWriterThread();
+			std::this_thread::yield();
+			position = this->enqueuePosition.load(std::memory_order_relaxed);
 		}
 		else
 		{
-			while (true)
+			position = this->enqueuePosition.load(std::memory_order_relaxed);
+		}
+	}
+
+	int length = ::snprintf(slot->text, MAX_MESSAGE_LENGTH, "%s: %s\n", timeBuffer, logMessage);
+	if (length < 0)
+		length = 0;
+	else if (length >= int(MAX_MESSAGE_LENGTH))
+	{
+		length = MAX_MESSAGE_LENGTH - 1;
+		slot->text[length - 1] = '\n';
+	}
+
+	slot->messageFlags = messageFlags;
+	slot->length = uint32_t(length);
+	slot->sequence.store(position + 1, std::memory_order_release);
+
+	this->WakeWriterThread();
+}
+
+bool LoggingSystem::DequeueLogMessage(uint32_t& messageFlags, std::string& logMessage)
+{
+	Slot* slot = &this->slotArray[this->dequeuePosition & (QUEUE_SIZE - 1)];
+	if (slot->sequence.load(std::memory_order_acquire) != this->dequeuePosition + 1)
+		return false;
+
+	messageFlags = slot->messageFlags;
+	logMessage.assign(slot->text, slot->length);
+
+	// Hand the slot back to the producers for their next lap around the ring.
+	slot->sequence.store(this->dequeuePosition + QUEUE_SIZE, std::memory_order_release);
+	this->dequeuePosition++;
+	return true;
+}
+
+void LoggingSystem::Flush()
+{
+	{
+		std::lock_guard guard(this->writerThreadMutex);
+		if (!this->writerThread || this->writerThread->get_id() == std::this_thread::get_id())
+			return;
+	}
+
+	uint64_t targetPosition = this->enqueuePosition.load(std::memory_order_acquire);
+	this->WakeWriterThread();
+
+	uint64_t position = this->flushedPosition.load(std::memory_order_acquire);
+	while (position < targetPosition)
+	{
+		this->flushedPosition.wait(position, std::memory_order_acquire);
+		position = this->flushedPosition.load(std::memory_order_acquire);
+	}
+}
+
+void LoggingSystem::WakeWriterThread()
+{
+	this->writerThreadWakeCount.fetch_add(1, std::memory_order_release);
+	this->writerThreadWakeCount.notify_one();
+}
+
+void LoggingSystem::StartWriterThread()
+{
+	std::lock_guard guard(this->writerThreadMutex);
+
+	if (!this->writerThread)
+	{
+		this->writerThreadExitSignaled = false;
+		this->flushedPosition = this->dequeuePosition;
+		this->writerThread = new std::thread(&LoggingSystem::WriterThreadRun, this);
+	}
+}
+
+void LoggingSystem::StopWriterThread()
+{
+	std::lock_guard guard(this->writerThreadMutex);
+
+	if (this->writerThread)
+	{
+		this->writerThreadExitSignaled = true;
+		this->WakeWriterThread();
+		this->writerThread->join();
+		delete this->writerThread;
+		this->writerThread = nullptr;
+	}
+}
+
+void LoggingSystem::WriterThreadRun()
+{
+	SetThreadDescription(GetCurrentThread(), L"Log Writer");
+
+	uint32_t messageFlags = 0;
+	std::string logMessage;
+	logMessage.reserve(MAX_MESSAGE_LENGTH);
+
+	while (true)
+	{
+		// Read these before draining the queue so that we never miss a wake-up, and so that we drain it one last time before exiting.
+		uint32_t wakeCount = this->writerThreadWakeCount.load(std::memory_order_acquire);
+		bool exitSignaled = this->writerThreadExitSignaled.load(std::memory_order_acquire);
+
+		{
+			std::lock_guard guard(this->routeMutex);
+
+			bool wroteMessages = false;
+			while (this->DequeueLogMessage(messageFlags, logMessage))
+			{
+				for (auto& pair : this->logRouteMap)
+				{
+					LogRoute* logRoute = pair.second;
+					if ((logRoute->GetFilterFlags() & messageFlags) != 0)
+						logRoute->PrintLogMessage(messageFlags, logMessage);
+				}
+
+				wroteMessages = true;
+			}
+
+			uint64_t numDroppedMessages = this->numDroppedMessages.load(std::memory_order_relaxed);
+			if (numDroppedMessages > this->numReportedDroppedMessages)
+			{
+				logMessage = std::format("{} log messages were dropped, because the log queue was full.\n", numDroppedMessages - this->numReportedDroppedMessages);
+				this->numReportedDroppedMessages = numDroppedMessages;
+
+				for (auto& pair : this->logRouteMap)
+				{
+					LogRoute* logRoute = pair.second;
+					if ((logRoute->GetFilterFlags() & IMZADI_LOG_WARNING_FLAG) != 0)
+						logRoute->PrintLogMessage(IMZADI_LOG_WARNING_FLAG, logMessage);
+				}
+
+				wroteMessages = true;
+			}
+
+			if (wroteMessages)
 			{
-				IMZADI_ASSERT(false);
+				for (auto& pair : this->logRouteMap)
+				{
+					LogRoute* logRoute = pair.second;
+					logRoute->Flush();
+				}
 			}
 		}
+
+		this->flushedPosition.store(this->dequeuePosition, std::memory_order_release);
+		this->flushedPosition.notify_all();
+
+		if (exitSignaled)
+			break;
+
+		this->writerThreadWakeCount.wait(wakeCount, std::memory_order_acquire);
 	}
+
+	// Don't leave anyone waiting on a message that a producer hadn't quite finished queuing as we left.
+	this->flushedPosition.store(UINT64_MAX, std::memory_order_release);
+	this->flushedPosition.notify_all();
 }
 
 bool LoggingSystem::AddRoute(LogRoute* logRoute)
 {
-	std::lock_guard guard(this->mutex);
-	
-	LogRouteMap::iterator iter = this->logRouteMap.find(logRoute->GetName());
-	if (iter != this->logRouteMap.end())
-		return false;
+	{
+		std::lock_guard guard(this->routeMutex);
+
+		LogRouteMap::iterator iter = this->logRouteMap.find(logRoute->GetName());
+		if (iter != this->logRouteMap.end())
+			return false;
+
+		this->logRouteMap.insert(std::pair<std::string, LogRoute*>(logRoute->GetName(), logRoute));
+		logRoute->RouteRegistered();
+		this->numRoutes = (uint32_t)this->logRouteMap.size();
+	}
 
-	this->logRouteMap.insert(std::pair<std::string, LogRoute*>(logRoute->GetName(), logRoute));
-	logRoute->RouteRegistered();
+	this->StartWriterThread();
 	return true;
 }
 
 bool LoggingSystem::RemoveRoute(const std::string& logRouteName)
 {
-	std::lock_guard guard(this->mutex);
+	// Let the route see everything that was logged before it was removed.
+	this->Flush();
 
-	LogRouteMap::iterator iter = this->logRouteMap.find(logRouteName);
-	if (iter == this->logRouteMap.end())
-		return false;
+	{
+		std::lock_guard guard(this->routeMutex);
 
-	LogRoute* logRoute = iter->second;
-	logRoute->RouteUnregistered();
-	this->logRouteMap.erase(iter);
+		LogRouteMap::iterator iter = this->logRouteMap.find(logRouteName);
+		if (iter == this->logRouteMap.end())
+			return false;
+
+		LogRoute* logRoute = iter->second;
+		logRoute->RouteUnregistered();
+		this->logRouteMap.erase(iter);
+		this->numRoutes = (uint32_t)this->logRouteMap.size();
+		if (this->logRouteMap.size() > 0)
+			return true;
+	}
+
+	this->StopWriterThread();
 	return true;
 }
 
 bool LoggingSystem::RouteExists(const std::string& logRouteName)
 {
-	std::lock_guard guard(this->mutex);
+	std::lock_guard guard(this->routeMutex);
 
 	return this->logRouteMap.find(logRouteName) != this->logRouteMap.end();
 }
 
 void LoggingSystem::ClearAllRoutes()
 {
-	std::lock_guard guard(this->mutex);
+	// Stopping the writer thread drains the queue first.
+	this->StopWriterThread();
 
-	for (auto pair : this->logRouteMap)
+	std::lock_guard guard(this->routeMutex);
+
+	for (auto& pair : this->logRouteMap)
 	{
 		LogRoute* logRoute = pair.second;
 		logRoute->RouteUnregistered();
 	}
 
 	this->logRouteMap.clear();
+	this->numRoutes = 0;
 }
 
 void LoggingSystem::SetRouteFilter(const std::string& routeName, uint32_t filterFlags)
 {
-	std::lock_guard guard(this->mutex);
+	std::lock_guard guard(this->routeMutex);
 
 	if (routeName.length() == 0)
 	{
@@ -140,7 +364,7 @@ void LoggingSystem::SetRouteFilter(const std::string& routeName, uint32_t filter
 
 uint32_t LoggingSystem::GetRouteFilter(const std::string& routeName)
 {
-	std::lock_guard guard(this->mutex);
+	std::lock_guard guard(this->routeMutex);
 
 	LogRouteMap::iterator iter = this->logRouteMap.find(routeName);
 	if (iter == this->logRouteMap.end())
@@ -167,6 +391,10 @@ LogRoute::LogRoute()
 {
 }
 
+/*virtual*/ void LogRoute::Flush()
+{
+}
+
 /*virtual*/ void LogRoute::RouteRegistered()
 {
 }
@@ -190,10 +418,13 @@ LogFileRoute::LogFileRoute()
 /*virtual*/ void LogFileRoute::PrintLogMessage(uint32_t messageFlags, const std::string& logMessage)
 {
 	if (this->fileStream.is_open())
-	{
 		this->fileStream << logMessage;
+}
+
+/*virtual*/ void LogFileRoute::Flush()
+{
+	if (this->fileStream.is_open())
 		this->fileStream.flush();
-	}
 }
 
 /*virtual*/ void LogFileRoute::RouteRegistered()
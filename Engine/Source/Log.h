@@ -5,6 +5,8 @@
 #include <unordered_map>
 #include <string>
 #include <mutex>
+#include <atomic>
+#include <thread>
 #include <filesystem>
 #include <fstream>
 
@@ -41,6 +43,13 @@ namespace Imzadi
 	 * from any thread.  Also, the issuance of errors and warnings in the
 	 * logs can be a way of trapping faults when debugging.
 	 * 
+	 * Logging is asynchronous.  A message is formatted on the calling thread and
+	 * put on a bounded, lock-free queue, from which a writer thread hands batches
+	 * of messages to the routes.  If the queue is full, the message is dropped
+	 * rather than making the caller wait, and the writer later reports how many
+	 * were dropped.  A fatal error flushes the queue before halting, so that the
+	 * message that explains the halt always makes it out.
+	 * 
 	 * Different types of log messages will be supported here so that the logs
 	 * can be filtered on the receiving end.  Also, logs can be routed wherever
 	 * the user wants them to go.
@@ -76,6 +85,16 @@ namespace Imzadi
 		 */
 		void PrintLogMessage(uint32_t messageFlags, const std::string& logMessage);
 
+		/**
+		 * Wait until every message logged so far has been handed to the routes and the routes have been flushed.
+		 */
+		void Flush();
+
+		/**
+		 * Return the number of messages dropped so far because the queue was full.
+		 */
+		uint64_t GetNumDroppedMessages() const { return this->numDroppedMessages.load(std::memory_order_relaxed); }
+
 		/**
 		 * Register the given logging route with the system.
 		 * 
@@ -123,10 +142,55 @@ namespace Imzadi
 		 */
 		static LoggingSystem* Get();
 
+		/**
+		 * This is the longest a message can be, including its time-stamp.  Longer messages are truncated.
+		 */
+		static const uint32_t MAX_MESSAGE_LENGTH = 1024;
+
+		/**
+		 * This is how many messages can be waiting for the writer thread before we start dropping them.
+		 * It must be a power of two.
+		 */
+		static const uint32_t QUEUE_SIZE = 1024;
+
 	private:
-		std::mutex mutex;
+
+		/**
+		 * A slot is free for the producer whose position matches its sequence number,
+		 * and full for the consumer when its sequence number is one past its position.
+		 */
+		struct Slot
+		{
+			std::atomic<uint64_t> sequence;
+			uint32_t messageFlags;
+			uint32_t length;
+			char text[MAX_MESSAGE_LENGTH];
+		};
+
+		void EnqueueLogMessage(uint32_t messageFlags, const char* logMessage);
+		bool DequeueLogMessage(uint32_t& messageFlags, std::string& logMessage);
+		void HaltOnFatalError();
+		void StartWriterThread();
+		void StopWriterThread();
+		void WriterThreadRun();
+		void WakeWriterThread();
+
+		std::mutex routeMutex;
 		typedef std::unordered_map<std::string, Reference<LogRoute>> LogRouteMap;
 		LogRouteMap logRouteMap;
+		std::atomic<uint32_t> numRoutes;
+
+		Slot* slotArray;
+		std::atomic<uint64_t> enqueuePosition;
+		uint64_t dequeuePosition;
+		std::atomic<uint64_t> flushedPosition;
+		std::atomic<uint64_t> numDroppedMessages;
+		uint64_t numReportedDroppedMessages;
+
+		std::mutex writerThreadMutex;
+		std::thread* writerThread;
+		std::atomic<bool> writerThreadExitSignaled;
+		std::atomic<uint32_t> writerThreadWakeCount;
 	};
 
 	/**
@@ -140,16 +204,21 @@ namespace Imzadi
 
 		/**
 		 * A derived class must override this to consume a log message.
-		 * Note that while no two calls to this method will ever happen
-		 * simultaneously on seperate threads, this call itself must
-		 * be thread-safe.  If in doubt, enqueue the given message on
-		 * a thread-safe queue, then consume that queue on your own thread.
+		 * This is always called from the logging system's writer thread,
+		 * never from the thread that logged the message, so no two calls
+		 * to this method ever happen simultaneously.  Messages come in
+		 * batches, and @ref Flush is called at the end of each batch.
 		 * 
 		 * @param[in] messageFlags These are the same flags that were sent to the logging system before being routed here.  Use them however you like (e.g., to color-code the message.)
 		 * @param[in] logMessage This is the message to be routed by the router.
 		 */
 		virtual void PrintLogMessage(uint32_t messageFlags, const std::string& logMessage) = 0;
 
+		/**
+		 * Override this to make sure any messages this route has buffered have gone out.
+		 */
+		virtual void Flush();
+
 		/**
 		 * Override this to do something on registration of the route with the system.
 		 */
@@ -173,8 +242,9 @@ namespace Imzadi
 
 	/**
 	 * Provide a way to route log messages to disk.  Messages
-	 * get flushed immediately so that the log is complete up
-	 * to a program crash.
+	 * get flushed at the end of each batch so that the log is
+	 * nearly complete up to a program crash, and complete up
+	 * to a fatal error.
 	 */
 	class IMZADI_API LogFileRoute : public LogRoute
 	{
@@ -183,6 +253,7 @@ namespace Imzadi
 		virtual ~LogFileRoute();
 
 		virtual void PrintLogMessage(uint32_t messageFlags, const std::string& logMessage) override;
+		virtual void Flush() override;
 		virtual void RouteRegistered() override;
 		virtual void RouteUnregistered() override;
 
@@ -171,6 +171,40 @@ void Transform::InterapolateBoneTransforms(const Transform& transformA, const Tr
 	this->translation = vector * length;
 }
 
+void Transform::Interpolate(const Transform& transformA, const Transform& transformB, double alpha)
+{
+	this->translation.Lerp(transformA.translation, transformB.translation, alpha);
+
+	if (transformA.matrix == transformB.matrix)
+	{
+		this->matrix = transformA.matrix;
+		return;
+	}
+
+	Vector3 xAxisA, yAxisA, zAxisA;
+	transformA.matrix.GetColumnVectors(xAxisA, yAxisA, zAxisA);
+
+	Vector3 xAxisB, yAxisB, zAxisB;
+	transformB.matrix.GetColumnVectors(xAxisB, yAxisB, zAxisB);
+
+	Vector3 scaleA(xAxisA.Length(), yAxisA.Length(), zAxisA.Length());
+	Vector3 scaleB(xAxisB.Length(), yAxisB.Length(), zAxisB.Length());
+
+	Matrix3x3 orientationA, orientationB;
+	orientationA.SetColumnVectors(xAxisA / scaleA.x, yAxisA / scaleA.y, zAxisA / scaleA.z);
+	orientationB.SetColumnVectors(xAxisB / scaleB.x, yAxisB / scaleB.y, zAxisB / scaleB.z);
+
+	Vector3 scale;
+	scale.Lerp(scaleA, scaleB, alpha);
+
+	Matrix3x3 orientation;
+	orientation.InterpolateOrientations(orientationA, orientationB, alpha);
+
+	Vector3 xAxis, yAxis, zAxis;
+	orientation.GetColumnVectors(xAxis, yAxis, zAxis);
+	this->matrix.SetColumnVectors(xAxis * scale.x, yAxis * scale.y, zAxis * scale.z);
+}
+
 bool Transform::MoveTo(const Transform& transformA, const Transform& transformB, double translationStep, double rotationStep)
 {
 	bool moved = false;
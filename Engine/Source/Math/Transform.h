@@ -202,6 +202,19 @@ namespace Imzadi
 		 */
 		void InterapolateBoneTransforms(const Transform& transformA, const Transform& transformB, double alpha);
 
+		/**
+		 * Here we interpolate between the two given transforms by the given alpha, as
+		 * an object moves between two of its poses.  The matrices are taken to be a
+		 * rotation followed by a scale along each axis, and the translations are lerped.
+		 * If the matrices are the same, which is the common case, only the translation
+		 * is interpolated.
+		 * 
+		 * @param[in] transformA This will be the result when alpha is zero.
+		 * @param[in] transformB This will be the result when alpha is one.
+		 * @param[in] alpha This is the interpolation amount, typically in the range [0,1].
+		 */
+		void Interpolate(const Transform& transformA, const Transform& transformB, double alpha);
+
 		/**
 		 * Assign this transform to be transform A moved toward transform B.
 		 * This is similar to interpolation, but the translation and rotation
@@ -0,0 +1,762 @@
+#include "NavGraphHierarchy.h"
+#include "JobSystem.h"
+#include "Profile.h"
+#include "Log.h"
+#include <algorithm>
+
+using namespace Imzadi;
+
+namespace
+{
+	/**
+	 * Scramble the given bits so that the signatures of clusters differing only a little don't collide.
+	 * This is the finalizer of the SplitMix64 generator.
+	 */
+	uint64_t MixBits(uint64_t bits)
+	{
+		bits ^= bits >> 30;
+		bits *= 0xbf58476d1ce4e5b9ULL;
+		bits ^= bits >> 27;
+		bits *= 0x94d049bb133111ebULL;
+		bits ^= bits >> 31;
+		return bits;
+	}
+
+	uint64_t DoubleBits(double value)
+	{
+		uint64_t bits = 0;
+		::memcpy(&bits, &value, sizeof(double));
+		return bits;
+	}
+}
+
+//------------------------------------- NavGraphHierarchy -------------------------------------
+
+NavGraphHierarchy::NavGraphHierarchy()
+{
+	this->navGraph = nullptr;
+	this->graphVersion = 0;
+	this->clusterSize = 0.0;
+	this->numClustersLastRebuilt = 0;
+}
+
+/*virtual*/ NavGraphHierarchy::~NavGraphHierarchy()
+{
+}
+
+void NavGraphHierarchy::Clear()
+{
+	this->navGraph = nullptr;
+	this->graphVersion = 0;
+	this->clusterSize = 0.0;
+	this->clusterArray.clear();
+	this->nodeInfoArray.clear();
+	this->clusterMap.clear();
+	this->numClustersLastRebuilt = 0;
+}
+
+bool NavGraphHierarchy::Build(const NavGraph* navGraph, double clusterSize /*= 0.0*/, JobSystem* jobSystem /*= nullptr*/)
+{
+	this->Clear();
+
+	if (!navGraph)
+	{
+		IMZADI_LOG_ERROR("Can't build a nav-graph hierarchy without a nav-graph.");
+		return false;
+	}
+
+	// The spatial index cells are about an edge across, so this makes a cluster several edges across.
+	if (clusterSize <= 0.0)
+		clusterSize = 8.0 * navGraph->GetSpatialIndexCellSize();
+
+	if (clusterSize <= 0.0)
+	{
+		IMZADI_LOG_ERROR("The cluster size of a nav-graph hierarchy must be positive, not %f.", clusterSize);
+		return false;
+	}
+
+	this->clusterSize = clusterSize;
+	return this->Update(navGraph, jobSystem);
+}
+
+bool NavGraphHierarchy::Update(const NavGraph* navGraph, JobSystem* jobSystem /*= nullptr*/)
+{
+	if (!navGraph)
+	{
+		IMZADI_LOG_ERROR("Can't update a nav-graph hierarchy without a nav-graph.");
+		return false;
+	}
+
+	// Nodes are never removed from a graph, except when it's cleared, in which case we have to start over.
+	if (this->clusterSize <= 0.0 || navGraph->GetNumNodes() < (int)this->nodeInfoArray.size())
+		return this->Build(navGraph, this->clusterSize, jobSystem);
+
+	bool isBuilt = (this->navGraph != nullptr);
+	this->navGraph = navGraph;
+	this->numClustersLastRebuilt = 0;
+
+	if (isBuilt && navGraph->GetVersion() == this->graphVersion)
+		return true;
+
+	IMZADI_PROFILE("Nav-Graph Hierarchy Update");
+
+	for (int i = (int)this->nodeInfoArray.size(); i < navGraph->GetNumNodes(); i++)
+	{
+		int clusterIndex = this->FindOrAddCluster(navGraph->GetNode(i)->location);
+		Cluster& cluster = this->clusterArray[clusterIndex];
+
+		NodeInfo info;
+		info.clusterIndex = clusterIndex;
+		info.localIndex = (int)cluster.nodeOrdinalArray.size();
+		info.componentIndex = -1;
+		info.isEntrance = false;
+		this->nodeInfoArray.push_back(info);
+		cluster.nodeOrdinalArray.push_back(i);
+	}
+
+	// Rather than have the graph tell us what changed, we just look for clusters that aren't
+	// what they were.  That's a pass over the whole graph, but it's cheap compared to the
+	// searches needed to rebuild a cluster, which we only do for those that changed.
+	std::vector<uint64_t> signatureArray(this->clusterArray.size());
+	auto signFunc = [this, &signatureArray](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+			signatureArray[i] = this->CalcClusterSignature(this->clusterArray[i]);
+	};
+
+	if (jobSystem)
+		jobSystem->ParallelFor((uint32_t)this->clusterArray.size(), 64, signFunc);
+	else
+		signFunc(0, (uint32_t)this->clusterArray.size());
+
+	std::vector<bool> changedArray(this->clusterArray.size(), false);
+	for (int i = 0; i < (int)this->clusterArray.size(); i++)
+	{
+		Cluster& cluster = this->clusterArray[i];
+		if (!isBuilt || cluster.signature != signatureArray[i])
+		{
+			cluster.signature = signatureArray[i];
+			changedArray[i] = true;
+		}
+	}
+
+	// The entrances on the border between two clusters depend on both of them,
+	// so the neighbors of a changed cluster have to be rebuilt along with it.
+	std::vector<bool> dirtyArray(changedArray);
+	for (int i = 0; i < (int)this->clusterArray.size(); i++)
+	{
+		if (!changedArray[i])
+			continue;
+
+		for (int ordinal : this->clusterArray[i].nodeOrdinalArray)
+		{
+			const NavGraph::Node* node = navGraph->GetNode(ordinal);
+			for (const Reference<NavGraph::Path>& path : node->adjacentPathArray)
+				dirtyArray[this->nodeInfoArray[path->Follow(node)->ordinal].clusterIndex] = true;
+		}
+	}
+
+	std::vector<int> dirtyClusterArray;
+	for (int i = 0; i < (int)this->clusterArray.size(); i++)
+		if (dirtyArray[i])
+			dirtyClusterArray.push_back(i);
+
+	this->RebuildClusters(dirtyClusterArray, jobSystem);
+	this->numClustersLastRebuilt = (int)dirtyClusterArray.size();
+	this->graphVersion = navGraph->GetVersion();
+	return true;
+}
+
+int NavGraphHierarchy::FindOrAddCluster(const Vector3& location)
+{
+	int x = (int)::floor(IMZADI_CLAMP(location.x / this->clusterSize, -1e9, 1e9));
+	int z = (int)::floor(IMZADI_CLAMP(location.z / this->clusterSize, -1e9, 1e9));
+	uint64_t key = (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(z));
+
+	auto iter = this->clusterMap.find(key);
+	if (iter != this->clusterMap.end())
+		return iter->second;
+
+	int clusterIndex = (int)this->clusterArray.size();
+	this->clusterArray.push_back(Cluster{});
+	this->clusterMap.insert(std::pair<uint64_t, int>(key, clusterIndex));
+	return clusterIndex;
+}
+
+uint64_t NavGraphHierarchy::CalcClusterSignature(const Cluster& cluster) const
+{
+	// The terms are added rather than chained so that the order of the edges around a node doesn't matter.
+	uint64_t signature = MixBits(cluster.nodeOrdinalArray.size());
+
+	for (int ordinal : cluster.nodeOrdinalArray)
+	{
+		const NavGraph::Node* node = this->navGraph->GetNode(ordinal);
+		signature += MixBits(uint64_t(ordinal) ^ MixBits(DoubleBits(node->location.x) ^ MixBits(DoubleBits(node->location.z))));
+
+		for (const Reference<NavGraph::Path>& path : node->adjacentPathArray)
+		{
+			const NavGraph::Node* adjacentNode = path->Follow(node);
+			signature += MixBits((uint64_t(uint32_t(ordinal)) << 32) | uint64_t(uint32_t(adjacentNode->ordinal))) ^ MixBits(DoubleBits(path->length));
+		}
+	}
+
+	return signature;
+}
+
+void NavGraphHierarchy::RebuildClusters(const std::vector<int>& clusterIndexArray, JobSystem* jobSystem)
+{
+	// Each pass only writes to the clusters it's given and their own nodes, so any number of
+	// clusters can go through a pass at once.  Choosing entrances looks at the components of
+	// neighboring clusters, though, so all components have to be labeled before that starts.
+	std::vector<SearchContext> contextArray(jobSystem ? jobSystem->GetNumWorkers() + 1 : 1);
+
+	auto labelFunc = [this, &clusterIndexArray](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+			this->LabelComponents(clusterIndexArray[i]);
+	};
+
+	auto rebuildFunc = [this, &clusterIndexArray, &contextArray](uint32_t begin, uint32_t end)
+	{
+		// The work is done right here on the calling thread if it doesn't belong to the job system.
+		int threadIndex = IMZADI_MAX(JobSystem::GetThreadIndex(), 0);
+		for (uint32_t i = begin; i < end; i++)
+			this->RebuildCluster(clusterIndexArray[i], contextArray[threadIndex]);
+	};
+
+	if (jobSystem && clusterIndexArray.size() > 1)
+	{
+		jobSystem->ParallelFor((uint32_t)clusterIndexArray.size(), 16, labelFunc);
+		jobSystem->ParallelFor((uint32_t)clusterIndexArray.size(), 4, rebuildFunc);
+	}
+	else
+	{
+		labelFunc(0, (uint32_t)clusterIndexArray.size());
+		contextArray.resize(1);
+		for (int clusterIndex : clusterIndexArray)
+			this->RebuildCluster(clusterIndex, contextArray[0]);
+	}
+}
+
+void NavGraphHierarchy::LabelComponents(int clusterIndex)
+{
+	const Cluster& cluster = this->clusterArray[clusterIndex];
+
+	for (int ordinal : cluster.nodeOrdinalArray)
+		this->nodeInfoArray[ordinal].componentIndex = -1;
+
+	int numComponents = 0;
+	std::vector<int> stackArray;
+
+	for (int ordinal : cluster.nodeOrdinalArray)
+	{
+		if (this->nodeInfoArray[ordinal].componentIndex != -1)
+			continue;
+
+		this->nodeInfoArray[ordinal].componentIndex = numComponents;
+		stackArray.push_back(ordinal);
+
+		while (stackArray.size() > 0)
+		{
+			const NavGraph::Node* node = this->navGraph->GetNode(stackArray.back());
+			stackArray.pop_back();
+
+			for (const Reference<NavGraph::Path>& path : node->adjacentPathArray)
+			{
+				NodeInfo& adjacentInfo = this->nodeInfoArray[path->Follow(node)->ordinal];
+				if (adjacentInfo.clusterIndex == clusterIndex && adjacentInfo.componentIndex == -1)
+				{
+					adjacentInfo.componentIndex = numComponents;
+					stackArray.push_back(path->Follow(node)->ordinal);
+				}
+			}
+		}
+
+		numComponents++;
+	}
+}
+
+void NavGraphHierarchy::RebuildCluster(int clusterIndex, SearchContext& context)
+{
+	Cluster& cluster = this->clusterArray[clusterIndex];
+	cluster.entranceArray.clear();
+
+	// Gather up the edges leaving this cluster, in an order that doesn't depend on which of the two
+	// clusters they join is looking at them, so that both will choose the same ones as entrances.
+	std::vector<BorderEdge> borderEdgeArray;
+	for (int ordinal : cluster.nodeOrdinalArray)
+	{
+		NodeInfo& info = this->nodeInfoArray[ordinal];
+		info.isEntrance = false;
+		info.abstractEdgeArray.clear();
+
+		const NavGraph::Node* node = this->navGraph->GetNode(ordinal);
+		for (const Reference<NavGraph::Path>& path : node->adjacentPathArray)
+		{
+			const NavGraph::Node* adjacentNode = path->Follow(node);
+			int adjacentClusterIndex = this->nodeInfoArray[adjacentNode->ordinal].clusterIndex;
+			if (adjacentClusterIndex != clusterIndex)
+			{
+				BorderEdge borderEdge;
+				borderEdge.path = path;
+				borderEdge.clusterIndex = adjacentClusterIndex;
+				borderEdge.ordinal = ordinal;
+				borderEdge.adjacentOrdinal = adjacentNode->ordinal;
+				borderEdge.lowOrdinal = (adjacentClusterIndex < clusterIndex) ? adjacentNode->ordinal : ordinal;
+				borderEdge.highOrdinal = (adjacentClusterIndex < clusterIndex) ? ordinal : adjacentNode->ordinal;
+				borderEdgeArray.push_back(borderEdge);
+			}
+		}
+	}
+
+	std::sort(borderEdgeArray.begin(), borderEdgeArray.end(), [](const BorderEdge& edgeA, const BorderEdge& edgeB) -> bool
+		{
+			if (edgeA.clusterIndex != edgeB.clusterIndex)
+				return edgeA.clusterIndex < edgeB.clusterIndex;
+			if (edgeA.lowOrdinal != edgeB.lowOrdinal)
+				return edgeA.lowOrdinal < edgeB.lowOrdinal;
+			return edgeA.highOrdinal < edgeB.highOrdinal;
+		});
+
+	// Edges between the same two components of the same two clusters are interchangeable as
+	// far as getting from one cluster to the other goes, so we only need one of them, but we
+	// keep a few spread along the border so that the paths we find don't go too far out of their
+	// way to cross it.  Keeping fewer entrances makes for a smaller abstract graph, but longer paths.
+	const double entranceSpacing = this->clusterSize / 4.0;
+	std::vector<const BorderEdge*> chosenEdgeArray;
+	for (int i = 0; i < (int)borderEdgeArray.size(); i++)
+	{
+		const BorderEdge& borderEdge = borderEdgeArray[i];
+		if (i == 0 || borderEdge.clusterIndex != borderEdgeArray[i - 1].clusterIndex)
+			chosenEdgeArray.clear();
+
+		int lowComponent = this->nodeInfoArray[borderEdge.lowOrdinal].componentIndex;
+		int highComponent = this->nodeInfoArray[borderEdge.highOrdinal].componentIndex;
+		Vector3 midpoint = (borderEdge.path->terminalNode[0]->location + borderEdge.path->terminalNode[1]->location) / 2.0;
+
+		bool covered = false;
+		for (const BorderEdge* chosenEdge : chosenEdgeArray)
+		{
+			if (this->nodeInfoArray[chosenEdge->lowOrdinal].componentIndex == lowComponent &&
+				this->nodeInfoArray[chosenEdge->highOrdinal].componentIndex == highComponent &&
+				((chosenEdge->path->terminalNode[0]->location + chosenEdge->path->terminalNode[1]->location) / 2.0 - midpoint).Length() < entranceSpacing)
+			{
+				covered = true;
+				break;
+			}
+		}
+
+		if (covered)
+			continue;
+
+		chosenEdgeArray.push_back(&borderEdge);
+
+		NodeInfo& info = this->nodeInfoArray[borderEdge.ordinal];
+		if (!info.isEntrance)
+		{
+			info.isEntrance = true;
+			cluster.entranceArray.push_back(borderEdge.ordinal);
+		}
+
+		info.abstractEdgeArray.push_back(AbstractEdge{ borderEdge.adjacentOrdinal, borderEdge.path->length });
+	}
+
+	for (int ordinal : cluster.entranceArray)
+	{
+		this->SearchCluster(clusterIndex, ordinal, -1, context);
+
+		NodeInfo& info = this->nodeInfoArray[ordinal];
+		for (int otherOrdinal : cluster.entranceArray)
+		{
+			if (otherOrdinal == ordinal)
+				continue;
+
+			const SearchContext::NodeState* state = context.FindNodeState(context.clusterStateArray, this->nodeInfoArray[otherOrdinal].localIndex);
+			if (state)
+				info.abstractEdgeArray.push_back(AbstractEdge{ otherOrdinal, state->costSoFar });
+		}
+	}
+}
+
+// This is A* if given a goal, and Dijkstra's algorithm, visiting every node of the cluster reachable from the start, if not.
+bool NavGraphHierarchy::SearchCluster(int clusterIndex, int startOrdinal, int goalOrdinal, SearchContext& context) const
+{
+	const Cluster& cluster = this->clusterArray[clusterIndex];
+	const NavGraph::Node* goalNode = (goalOrdinal >= 0) ? this->navGraph->GetNode(goalOrdinal) : nullptr;
+
+	context.Begin(context.clusterStateArray, (int)cluster.nodeOrdinalArray.size());
+
+	int startIndex = this->nodeInfoArray[startOrdinal].localIndex;
+	context.GetNodeState(context.clusterStateArray, startIndex).costSoFar = 0.0;
+	context.openArray.push_back(SearchContext::OpenEntry{ 0.0, 0.0, startIndex });
+
+	while (context.openArray.size() > 0)
+	{
+		std::pop_heap(context.openArray.begin(), context.openArray.end(), SearchContext::CompareOpenEntries);
+		SearchContext::OpenEntry entry = context.openArray.back();
+		context.openArray.pop_back();
+
+		SearchContext::NodeState& parentState = context.GetNodeState(context.clusterStateArray, entry.index);
+		if (parentState.closed || entry.costSoFar > parentState.costSoFar)
+			continue;
+
+		int parentOrdinal = cluster.nodeOrdinalArray[entry.index];
+		if (parentOrdinal == goalOrdinal)
+		{
+			context.openArray.clear();
+			return true;
+		}
+
+		parentState.closed = true;
+		context.numNodesExpanded++;
+
+		const NavGraph::Node* parentNode = this->navGraph->GetNode(parentOrdinal);
+		for (int i = 0; i < (int)parentNode->adjacentPathArray.size(); i++)
+		{
+			const NavGraph::Path* path = parentNode->adjacentPathArray[i];
+			const NavGraph::Node* childNode = path->Follow(parentNode);
+			if (childNode->ordinal >= (int)this->nodeInfoArray.size())
+				continue;
+
+			const NodeInfo& childInfo = this->nodeInfoArray[childNode->ordinal];
+			if (childInfo.clusterIndex != clusterIndex)
+				continue;
+
+			SearchContext::NodeState& childState = context.GetNodeState(context.clusterStateArray, childInfo.localIndex);
+			if (childState.closed)
+				continue;
+
+			double costSoFar = entry.costSoFar + path->length;
+			if (costSoFar < childState.costSoFar)
+			{
+				childState.costSoFar = costSoFar;
+				childState.parentOrdinal = entry.index;
+				childState.parentAdjacency = i;
+
+				double estimatedCost = costSoFar + (goalNode ? (goalNode->location - childNode->location).Length() : 0.0);
+				context.openArray.push_back(SearchContext::OpenEntry{ estimatedCost, costSoFar, childInfo.localIndex });
+				std::push_heap(context.openArray.begin(), context.openArray.end(), SearchContext::CompareOpenEntries);
+			}
+		}
+	}
+
+	return goalOrdinal < 0;
+}
+
+bool NavGraphHierarchy::IsMember(const NavGraph::Node* node) const
+{
+	return this->navGraph && node &&
+		0 <= node->ordinal && node->ordinal < (int)this->nodeInfoArray.size() &&
+		node->ordinal < this->navGraph->GetNumNodes() && this->navGraph->GetNode(node->ordinal) == node;
+}
+
+bool NavGraphHierarchy::FindRoute(const NavGraph::Node* nodeA, const NavGraph::Node* nodeB, Route& route, SearchContext& context) const
+{
+	route.Clear();
+	context.numNodesExpanded = 0;
+
+	if (!this->IsMember(nodeA) || !this->IsMember(nodeB))
+	{
+		IMZADI_LOG_ERROR("Can't find a route between nodes that aren't members of the hierarchy's nav-graph.");
+		return false;
+	}
+
+	int startCluster = this->nodeInfoArray[nodeA->ordinal].clusterIndex;
+	int goalCluster = this->nodeInfoArray[nodeB->ordinal].clusterIndex;
+	double bestCost = std::numeric_limits<double>::max();
+	int bestOrdinal = -1;
+
+	// Find how far it is from the start to each entrance of its cluster, and, if the goal
+	// is in the same cluster, straight to the goal.  That may not be the best way to go,
+	// though, since going out of the cluster and back in again might be shorter.
+	this->SearchCluster(startCluster, nodeA->ordinal, -1, context);
+
+	context.startEntranceArray.clear();
+	for (int ordinal : this->clusterArray[startCluster].entranceArray)
+	{
+		const SearchContext::NodeState* state = context.FindNodeState(context.clusterStateArray, this->nodeInfoArray[ordinal].localIndex);
+		if (state)
+			context.startEntranceArray.push_back(SearchContext::EntranceCost{ ordinal, state->costSoFar });
+	}
+
+	if (startCluster == goalCluster)
+	{
+		const SearchContext::NodeState* state = context.FindNodeState(context.clusterStateArray, this->nodeInfoArray[nodeB->ordinal].localIndex);
+		if (state)
+			bestCost = state->costSoFar;
+	}
+
+	// The graph is undirected, so how far it is from the goal to each entrance of its cluster is how far it is back again.
+	this->SearchCluster(goalCluster, nodeB->ordinal, -1, context);
+
+	context.goalEntranceArray.clear();
+	for (int ordinal : this->clusterArray[goalCluster].entranceArray)
+	{
+		const SearchContext::NodeState* state = context.FindNodeState(context.clusterStateArray, this->nodeInfoArray[ordinal].localIndex);
+		if (state)
+			context.goalEntranceArray.push_back(SearchContext::EntranceCost{ ordinal, state->costSoFar });
+	}
+
+	// Now do an A* search of the abstract graph, starting from all entrances of the start cluster
+	// at once.  Every abstract edge is at least as long as the straight line between its ends, so
+	// once the best estimate left on the heap is no better than the best way to the goal found so
+	// far, there's no better way left to find.
+	context.Begin(context.abstractStateArray, this->navGraph->GetNumNodes());
+
+	for (const SearchContext::EntranceCost& entranceCost : context.startEntranceArray)
+	{
+		SearchContext::NodeState& state = context.GetNodeState(context.abstractStateArray, entranceCost.ordinal);
+		state.costSoFar = entranceCost.cost;
+
+		double estimatedCost = entranceCost.cost + (nodeB->location - this->navGraph->GetNode(entranceCost.ordinal)->location).Length();
+		context.openArray.push_back(SearchContext::OpenEntry{ estimatedCost, entranceCost.cost, entranceCost.ordinal });
+	}
+
+	std::make_heap(context.openArray.begin(), context.openArray.end(), SearchContext::CompareOpenEntries);
+
+	while (context.openArray.size() > 0)
+	{
+		std::pop_heap(context.openArray.begin(), context.openArray.end(), SearchContext::CompareOpenEntries);
+		SearchContext::OpenEntry entry = context.openArray.back();
+		context.openArray.pop_back();
+
+		if (entry.estimatedCost >= bestCost)
+			break;
+
+		SearchContext::NodeState& parentState = context.GetNodeState(context.abstractStateArray, entry.index);
+		if (parentState.closed || entry.costSoFar > parentState.costSoFar)
+			continue;
+
+		parentState.closed = true;
+		context.numNodesExpanded++;
+
+		const NodeInfo& parentInfo = this->nodeInfoArray[entry.index];
+		if (parentInfo.clusterIndex == goalCluster)
+		{
+			for (const SearchContext::EntranceCost& entranceCost : context.goalEntranceArray)
+			{
+				if (entranceCost.ordinal == entry.index && entry.costSoFar + entranceCost.cost < bestCost)
+				{
+					bestCost = entry.costSoFar + entranceCost.cost;
+					bestOrdinal = entry.index;
+				}
+			}
+		}
+
+		for (const AbstractEdge& edge : parentInfo.abstractEdgeArray)
+		{
+			SearchContext::NodeState& childState = context.GetNodeState(context.abstractStateArray, edge.ordinal);
+			if (childState.closed)
+				continue;
+
+			double costSoFar = entry.costSoFar + edge.cost;
+			if (costSoFar < childState.costSoFar)
+			{
+				childState.costSoFar = costSoFar;
+				childState.parentOrdinal = entry.index;
+
+				double estimatedCost = costSoFar + (nodeB->location - this->navGraph->GetNode(edge.ordinal)->location).Length();
+				context.openArray.push_back(SearchContext::OpenEntry{ estimatedCost, costSoFar, edge.ordinal });
+				std::push_heap(context.openArray.begin(), context.openArray.end(), SearchContext::CompareOpenEntries);
+			}
+		}
+	}
+
+	context.openArray.clear();
+
+	if (bestCost == std::numeric_limits<double>::max())
+		return false;
+
+	// If we never found a better way than the one inside the cluster, the route goes straight to the goal.
+	for (int ordinal = bestOrdinal; ordinal != -1; ordinal = context.abstractStateArray[ordinal].parentOrdinal)
+		route.waypointArray.push_back(ordinal);
+
+	std::reverse(route.waypointArray.begin(), route.waypointArray.end());
+
+	if (route.waypointArray.size() == 0 || route.waypointArray[0] != nodeA->ordinal)
+		route.waypointArray.insert(route.waypointArray.begin(), nodeA->ordinal);
+
+	if (route.waypointArray[route.waypointArray.size() - 1] != nodeB->ordinal)
+		route.waypointArray.push_back(nodeB->ordinal);
+
+	route.nextLeg = 0;
+	route.length = bestCost;
+	route.graphVersion = this->graphVersion;
+	return true;
+}
+
+bool NavGraphHierarchy::RefineNextLeg(Route& route, std::vector<int>& pathArray, SearchContext& context) const
+{
+	if (route.IsFullyRefined())
+		return false;
+
+	if (!this->navGraph || route.graphVersion != this->graphVersion)
+		return false;
+
+	int ordinalA = route.waypointArray[route.nextLeg];
+	int ordinalB = route.waypointArray[route.nextLeg + 1];
+	int clusterIndex = this->nodeInfoArray[ordinalA].clusterIndex;
+
+	if (clusterIndex != this->nodeInfoArray[ordinalB].clusterIndex)
+	{
+		// Legs between clusters are always just one edge.
+		int i = this->navGraph->GetNode(ordinalA)->FindAdjacencyIndex(this->navGraph->GetNode(ordinalB));
+		if (i < 0)
+			return false;
+
+		pathArray.push_back(i);
+	}
+	else
+	{
+		if (!this->SearchCluster(clusterIndex, ordinalA, ordinalB, context))
+			return false;
+
+		const Cluster& cluster = this->clusterArray[clusterIndex];
+		int startIndex = this->nodeInfoArray[ordinalA].localIndex;
+		int firstTurn = (int)pathArray.size();
+
+		for (int index = this->nodeInfoArray[ordinalB].localIndex; index != startIndex; )
+		{
+			const SearchContext::NodeState& state = context.clusterStateArray[index];
+			pathArray.push_back(state.parentAdjacency);
+			index = state.parentOrdinal;
+		}
+
+		std::reverse(pathArray.begin() + firstTurn, pathArray.end());
+	}
+
+	route.nextLeg++;
+	return true;
+}
+
+bool NavGraphHierarchy::FindPath(const NavGraph::Node* nodeA, const NavGraph::Node* nodeB, std::vector<int>& pathArray, SearchContext& context) const
+{
+	pathArray.clear();
+
+	Route route;
+	if (!this->FindRoute(nodeA, nodeB, route, context))
+		return false;
+
+	while (!route.IsFullyRefined())
+		if (!this->RefineNextLeg(route, pathArray, context))
+			return false;
+
+	return true;
+}
+
+int NavGraphHierarchy::GetNumEntrances() const
+{
+	int numEntrances = 0;
+	for (const Cluster& cluster : this->clusterArray)
+		numEntrances += (int)cluster.entranceArray.size();
+
+	return numEntrances;
+}
+
+int NavGraphHierarchy::GetNumAbstractEdges() const
+{
+	int numAbstractEdges = 0;
+	for (const NodeInfo& info : this->nodeInfoArray)
+		numAbstractEdges += (int)info.abstractEdgeArray.size();
+
+	return numAbstractEdges;
+}
+
+//------------------------------------- NavGraphHierarchy::Route -------------------------------------
+
+NavGraphHierarchy::Route::Route()
+{
+	this->nextLeg = 0;
+	this->length = 0.0;
+	this->graphVersion = 0;
+}
+
+/*virtual*/ NavGraphHierarchy::Route::~Route()
+{
+}
+
+void NavGraphHierarchy::Route::Clear()
+{
+	this->waypointArray.clear();
+	this->nextLeg = 0;
+	this->length = 0.0;
+	this->graphVersion = 0;
+}
+
+//------------------------------------- NavGraphHierarchy::SearchContext -------------------------------------
+
+NavGraphHierarchy::SearchContext::SearchContext()
+{
+	this->stamp = 0;
+	this->numNodesExpanded = 0;
+}
+
+/*virtual*/ NavGraphHierarchy::SearchContext::~SearchContext()
+{
+}
+
+void NavGraphHierarchy::SearchContext::Clear()
+{
+	this->clusterStateArray.clear();
+	this->abstractStateArray.clear();
+	this->openArray.clear();
+	this->startEntranceArray.clear();
+	this->goalEntranceArray.clear();
+	this->stamp = 0;
+	this->numNodesExpanded = 0;
+}
+
+void NavGraphHierarchy::SearchContext::Begin(std::vector<NodeState>& stateArray, int numStates)
+{
+	// As with the nav-graph's own searches, bumping the stamp invalidates all node states at once.
+	if ((int)stateArray.size() < numStates)
+	{
+		NodeState staleState{ 0.0, -1, -1, 0, false };
+		stateArray.resize(numStates, staleState);
+	}
+
+	this->stamp++;
+	if (this->stamp == 0)
+	{
+		for (NodeState& state : this->clusterStateArray)
+			state.stamp = 0;
+
+		for (NodeState& state : this->abstractStateArray)
+			state.stamp = 0;
+
+		this->stamp = 1;
+	}
+
+	this->openArray.clear();
+}
+
+// This makes the binary heap of open entries a min-heap on the estimated cost.
+/*static*/ bool NavGraphHierarchy::SearchContext::CompareOpenEntries(const OpenEntry& entryA, const OpenEntry& entryB)
+{
+	return entryA.estimatedCost > entryB.estimatedCost;
+}
+
+NavGraphHierarchy::SearchContext::NodeState& NavGraphHierarchy::SearchContext::GetNodeState(std::vector<NodeState>& stateArray, int index)
+{
+	NodeState& state = stateArray[index];
+	if (state.stamp != this->stamp)
+	{
+		state.costSoFar = std::numeric_limits<double>::max();
+		state.parentOrdinal = -1;
+		state.parentAdjacency = -1;
+		state.stamp = this->stamp;
+		state.closed = false;
+	}
+
+	return state;
+}
+
+// Only nodes reached by the current search have any state worth looking at.
+const NavGraphHierarchy::SearchContext::NodeState* NavGraphHierarchy::SearchContext::FindNodeState(const std::vector<NodeState>& stateArray, int index) const
+{
+	const NodeState& state = stateArray[index];
+	if (state.stamp != this->stamp || state.costSoFar == std::numeric_limits<double>::max())
+		return nullptr;
+
+	return &state;
+}
\ No newline at end of file
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "Assets/NavGraph.h"
+#include <vector>
+#include <unordered_map>
+
+namespace Imzadi
+{
+	class JobSystem;
+
+	/**
+	 * This is a two-level abstraction of a nav-graph that makes paths across large graphs cheap
+	 * to find, at the cost of them being a little longer than the shortest paths.  (See "Near
+	 * Optimal Hierarchical Path-Finding" by Botea, Muller and Schaeffer.)  The nodes of the graph
+	 * are partitioned into clusters by a uniform grid over the XZ-plane.  A few of the edges of
+	 * the nav-graph between each pair of neighboring clusters are chosen to be crossings, and the
+	 * nodes at their ends are the entrances of the clusters.  The entrances are the nodes of the
+	 * abstract graph, which has an edge for each crossing, and an edge between each pair of
+	 * entrances of the same cluster, costing the length of the shortest path between them that
+	 * stays inside the cluster.  Those costs are found up-front.
+	 *
+	 * A search then only has to look inside the clusters of the start and goal nodes, and
+	 * otherwise only at the abstract graph.  What it finds is a @ref Route, which is a sequence
+	 * of entrances to pass through.  Only when an entity is about to walk a leg of the route does
+	 * it need to refine that leg into edges of the nav-graph, which is a search of a single cluster.
+	 *
+	 * Clusters are identified with the ordinals of their nodes, not the nodes themselves, so the
+	 * hierarchy can be updated from a copy of the graph it was built from (see @ref NavGraph::CopyFrom).
+	 * When the graph is edited, only the clusters whose nodes or edges changed are rebuilt.
+	 */
+	class IMZADI_API NavGraphHierarchy
+	{
+	public:
+		NavGraphHierarchy();
+		virtual ~NavGraphHierarchy();
+
+		/**
+		 * Free all memory and forget the graph.
+		 */
+		void Clear();
+
+		/**
+		 * Partition the given graph into clusters and build the abstract graph over it from scratch.
+		 * The graph must outlive this hierarchy, or else be replaced by a call to @ref Update.
+		 *
+		 * @param[in] navGraph This is the graph to abstract.
+		 * @param[in] clusterSize This is the width and depth of each cluster.  If zero, a size spanning several edges of the graph is chosen.
+		 * @param[in] jobSystem If given, the clusters are built in parallel on this job system.
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool Build(const NavGraph* navGraph, double clusterSize = 0.0, JobSystem* jobSystem = nullptr);
+
+		/**
+		 * Bring this hierarchy up-to-date with the given graph, which should be the graph
+		 * it was built from, or a copy of it, since edited.  Clusters that have gained nodes,
+		 * or whose nodes have gained or lost edges, are rebuilt, along with their neighbors, since
+		 * the crossings between clusters depend on both sides; the rest are left alone.
+		 * Nothing is done if the graph hasn't changed.
+		 *
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool Update(const NavGraph* navGraph, JobSystem* jobSystem = nullptr);
+
+		/**
+		 * This is a path through the abstract graph, given as the ordinals of the nav-graph nodes
+		 * to pass through, starting with the start node and ending with the goal node.  Each leg of
+		 * the route is either an edge of the nav-graph between two clusters, or a path inside a
+		 * single cluster, yet to be found.
+		 */
+		class IMZADI_API Route
+		{
+			friend class NavGraphHierarchy;
+
+		public:
+			Route();
+			virtual ~Route();
+
+			void Clear();
+
+			const std::vector<int>& GetWaypointArray() const { return this->waypointArray; }
+
+			/**
+			 * Tell the caller if every leg of this route has been refined.
+			 */
+			bool IsFullyRefined() const { return this->nextLeg + 1 >= (int)this->waypointArray.size(); }
+
+			/**
+			 * This is what the route will be as long as, once fully refined.
+			 */
+			double GetLength() const { return this->length; }
+
+		private:
+			std::vector<int> waypointArray;
+			int nextLeg;
+			double length;
+			uint32_t graphVersion;
+		};
+
+		/**
+		 * Like @ref NavGraph::SearchContext, this holds all the state of a search, so that any
+		 * number of searches can run against the same hierarchy at once, as long as each has
+		 * its own context, and nobody is updating the hierarchy at the time.
+		 */
+		class IMZADI_API SearchContext
+		{
+			friend class NavGraphHierarchy;
+
+		public:
+			SearchContext();
+			virtual ~SearchContext();
+
+			void Clear();
+
+			/**
+			 * Tell the caller how many nodes, abstract or not, have been expanded since the last route was found.
+			 */
+			uint32_t GetNumNodesExpanded() const { return this->numNodesExpanded; }
+
+		private:
+
+			struct NodeState
+			{
+				double costSoFar;
+				int parentOrdinal;
+				int parentAdjacency;
+				uint32_t stamp;
+				bool closed;
+			};
+
+			/**
+			 * Depending on the search, these refer to nodes by their ordinals, or by their offsets into a cluster.
+			 */
+			struct OpenEntry
+			{
+				double estimatedCost;
+				double costSoFar;
+				int index;
+			};
+
+			struct EntranceCost
+			{
+				int ordinal;
+				double cost;
+			};
+
+			void Begin(std::vector<NodeState>& stateArray, int numStates);
+			NodeState& GetNodeState(std::vector<NodeState>& stateArray, int index);
+			const NodeState* FindNodeState(const std::vector<NodeState>& stateArray, int index) const;
+			static bool CompareOpenEntries(const OpenEntry& entryA, const OpenEntry& entryB);
+
+			std::vector<NodeState> clusterStateArray;		///< A search inside a cluster keeps its state here, by offset into the cluster.
+			std::vector<NodeState> abstractStateArray;		///< A search of the abstract graph keeps its state here, by node ordinal.
+			std::vector<OpenEntry> openArray;
+			std::vector<EntranceCost> startEntranceArray;
+			std::vector<EntranceCost> goalEntranceArray;
+			uint32_t stamp;
+			uint32_t numNodesExpanded;
+		};
+
+		/**
+		 * Find a route between the two given nodes through the abstract graph.  Nothing of the
+		 * route is refined yet; see @ref RefineNextLeg.  This doesn't modify the hierarchy, so
+		 * it's safe to call from several threads at once, provided each uses its own context.
+		 *
+		 * @param[in] nodeA This is the node where the route should start.
+		 * @param[in] nodeB This is the node where the route should end.
+		 * @param[out] route This will be populated with the route found.
+		 * @param[in,out] context This holds the state of the search.
+		 * @return True is returned on success; false, otherwise.  Failure can occur here if there is no path between the two given nodes.
+		 */
+		bool FindRoute(const NavGraph::Node* nodeA, const NavGraph::Node* nodeB, Route& route, SearchContext& context) const;
+
+		/**
+		 * Find the edges of the nav-graph to take along the next unrefined leg of the given route,
+		 * and append them to the given array as turns, just as @ref NavGraph::FindShortestPath
+		 * would give them.  An entity can call this each time it's about to run out of turns.
+		 *
+		 * @return True is returned if a leg was refined; false, if the route is already fully refined, or no longer fits the graph.
+		 */
+		bool RefineNextLeg(Route& route, std::vector<int>& pathArray, SearchContext& context) const;
+
+		/**
+		 * Find a route between the two given nodes and refine all of it.
+		 *
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool FindPath(const NavGraph::Node* nodeA, const NavGraph::Node* nodeB, std::vector<int>& pathArray, SearchContext& context) const;
+
+		int GetNumClusters() const { return (int)this->clusterArray.size(); }
+		int GetNumEntrances() const;
+		int GetNumAbstractEdges() const;
+		double GetClusterSize() const { return this->clusterSize; }
+
+		/**
+		 * Tell the caller how many clusters were rebuilt by the last call to @ref Build or @ref Update.
+		 */
+		int GetNumClustersLastRebuilt() const { return this->numClustersLastRebuilt; }
+
+	private:
+
+		/**
+		 * This is an edge of the abstract graph, leading to the entrance with the given ordinal.
+		 */
+		struct AbstractEdge
+		{
+			int ordinal;
+			double cost;
+		};
+
+		struct NodeInfo
+		{
+			int clusterIndex;
+			int localIndex;			///< This is the offset of the node into its cluster's node array.
+			int componentIndex;		///< Nodes of a cluster with the same component index can reach one another without leaving the cluster.
+			bool isEntrance;
+			std::vector<AbstractEdge> abstractEdgeArray;
+		};
+
+		/**
+		 * This is an edge of the nav-graph leaving a cluster, as seen from inside the cluster.
+		 */
+		struct BorderEdge
+		{
+			const NavGraph::Path* path;
+			int clusterIndex;		///< This is the cluster on the other side of the edge.
+			int ordinal;			///< This is the node on our side of the edge.
+			int adjacentOrdinal;	///< This is the node on the other side of the edge.
+			int lowOrdinal;			///< This is the node of the edge in the cluster of lower index.
+			int highOrdinal;		///< This is the node of the edge in the cluster of higher index.
+		};
+
+		struct Cluster
+		{
+			std::vector<int> nodeOrdinalArray;
+			std::vector<int> entranceArray;
+			uint64_t signature;
+		};
+
+		int FindOrAddCluster(const Vector3& location);
+		uint64_t CalcClusterSignature(const Cluster& cluster) const;
+		void LabelComponents(int clusterIndex);
+		void RebuildCluster(int clusterIndex, SearchContext& context);
+		void RebuildClusters(const std::vector<int>& clusterIndexArray, JobSystem* jobSystem);
+		bool SearchCluster(int clusterIndex, int startOrdinal, int goalOrdinal, SearchContext& context) const;
+		bool IsMember(const NavGraph::Node* node) const;
+
+		const NavGraph* navGraph;
+		uint32_t graphVersion;
+		double clusterSize;
+		std::vector<Cluster> clusterArray;
+		std::vector<NodeInfo> nodeInfoArray;
+		std::unordered_map<uint64_t, int> clusterMap;
+		int numClustersLastRebuilt;
+	};
+}
\ No newline at end of file
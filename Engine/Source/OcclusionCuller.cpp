@@ -0,0 +1,431 @@
+#include "OcclusionCuller.h"
+#include "Camera.h"
+#include "Scene.h"
+#include "JobSystem.h"
+#include "Clock.h"
+#include "Profile.h"
+#include <xmmintrin.h>
+#include <algorithm>
+#include <math.h>
+#include <float.h>
+
+using namespace Imzadi;
+
+#define IMZADI_OCCLUSION_TRANSFORM_GRAIN_SIZE		256
+#define IMZADI_OCCLUSION_MAX_CLIPPED_VERTICES		12
+
+OcclusionCuller::OcclusionCuller()
+{
+	this->enabled = true;
+	this->rasterized = false;
+	this->minOccluderArea = 20.0;
+	this->maxOccluderTriangles = 4096;
+	this->nearClip = 0.1;
+	this->scaleX = 1.0;
+	this->scaleY = 1.0;
+	this->depthBuffer.resize(WIDTH * HEIGHT, 0.0f);
+	this->blockDepthBuffer.resize((WIDTH / BLOCK_SIZE) * (HEIGHT / BLOCK_SIZE), 0.0f);
+	this->tileBinArray.resize((WIDTH / TILE_WIDTH) * (HEIGHT / TILE_HEIGHT));
+	::memset(&this->stats, 0, sizeof(Stats));
+}
+
+/*virtual*/ OcclusionCuller::~OcclusionCuller()
+{
+}
+
+void OcclusionCuller::Clear()
+{
+	this->occluderVertexArray.clear();
+	this->rasterized = false;
+	this->stats.numOccluderTriangles = 0;
+}
+
+void OcclusionCuller::SetOccluders(const std::vector<Polygon>& polygonArray)
+{
+	this->Clear();
+
+	std::vector<std::pair<double, const Polygon*>> candidateArray;
+	for (const Polygon& polygon : polygonArray)
+	{
+		if (polygon.vertexArray.size() < 3)
+			continue;
+
+		double area = polygon.Area();
+		if (area >= this->minOccluderArea)
+			candidateArray.push_back(std::pair<double, const Polygon*>(area, &polygon));
+	}
+
+	std::sort(candidateArray.begin(), candidateArray.end(), [](const std::pair<double, const Polygon*>& candidateA, const std::pair<double, const Polygon*>& candidateB) -> bool {
+		return candidateA.first > candidateB.first;
+	});
+
+	for (const std::pair<double, const Polygon*>& candidate : candidateArray)
+	{
+		const Polygon* polygon = candidate.second;
+		uint32_t numTriangles = (uint32_t)polygon->vertexArray.size() - 2;
+		if (this->occluderVertexArray.size() / 3 + numTriangles > this->maxOccluderTriangles)
+			break;
+
+		for (uint32_t i = 0; i < numTriangles; i++)
+		{
+			this->occluderVertexArray.push_back(polygon->vertexArray[0]);
+			this->occluderVertexArray.push_back(polygon->vertexArray[i + 1]);
+			this->occluderVertexArray.push_back(polygon->vertexArray[i + 2]);
+		}
+	}
+
+	this->stats.numOccluderTriangles = (uint32_t)this->occluderVertexArray.size() / 3;
+}
+
+bool OcclusionCuller::Rasterize(const Camera* camera, JobSystem* jobSystem)
+{
+	IMZADI_PROFILE("Occlusion Rasterize");
+
+	Clock clock;
+	clock.Reset();
+
+	this->rasterized = false;
+	this->stats.numTrianglesRasterized = 0;
+	this->stats.numTileTriangles = 0;
+	this->stats.numObjectsTested = 0;
+	this->stats.numObjectsOccluded = 0;
+	this->stats.rasterizeMilliseconds = 0.0;
+
+	// Only perspective cameras are occlusion culled.  Orthographic views are rare enough (editor views, mostly)
+	// that they aren't worth rasterizing a second kind of depth for.
+	if (!this->enabled || this->occluderVertexArray.size() == 0 || camera->GetViewMode() != Camera::ViewMode::PERSPECTIVE)
+		return false;
+
+	const Frustum& frustum = camera->GetFrustum();
+	this->worldToCamera = camera->GetWorldToCameraTransform();
+	this->nearClip = frustum.nearClip;
+	this->scaleX = 1.0 / ::tan(frustum.hfovi / 2.0);
+	this->scaleY = 1.0 / ::tan(frustum.vfovi / 2.0);
+	this->clipPlaneArray.clear();
+	frustum.GetPlanes(this->clipPlaneArray);
+
+	// Clip and project the occluders, each job putting its triangles in its own array.
+	uint32_t numTriangles = (uint32_t)this->occluderVertexArray.size() / 3;
+	uint32_t numChunks = (numTriangles + IMZADI_OCCLUSION_TRANSFORM_GRAIN_SIZE - 1) / IMZADI_OCCLUSION_TRANSFORM_GRAIN_SIZE;
+	this->chunkTriangleArray.resize(numChunks);
+	for (std::vector<ScreenTriangle>& chunkTriangles : this->chunkTriangleArray)
+		chunkTriangles.clear();
+
+	auto transformFunc = [this](uint32_t begin, uint32_t end)
+	{
+		this->TransformTriangles(begin, end, this->chunkTriangleArray[begin / IMZADI_OCCLUSION_TRANSFORM_GRAIN_SIZE]);
+	};
+
+	if (jobSystem)
+		jobSystem->ParallelFor(numTriangles, IMZADI_OCCLUSION_TRANSFORM_GRAIN_SIZE, transformFunc);
+	else
+		transformFunc(0, numTriangles);
+
+	// Gather them up and sort them into the tiles they overlap.
+	this->screenTriangleArray.clear();
+	for (const std::vector<ScreenTriangle>& chunkTriangles : this->chunkTriangleArray)
+		this->screenTriangleArray.insert(this->screenTriangleArray.end(), chunkTriangles.begin(), chunkTriangles.end());
+
+	for (std::vector<int>& tileBin : this->tileBinArray)
+		tileBin.clear();
+
+	const int numTilesX = WIDTH / TILE_WIDTH;
+	for (int i = 0; i < (int)this->screenTriangleArray.size(); i++)
+	{
+		const ScreenTriangle& triangle = this->screenTriangleArray[i];
+		for (int tileY = triangle.minY / TILE_HEIGHT; tileY <= triangle.maxY / TILE_HEIGHT; tileY++)
+			for (int tileX = triangle.minX / TILE_WIDTH; tileX <= triangle.maxX / TILE_WIDTH; tileX++)
+				this->tileBinArray[tileY * numTilesX + tileX].push_back(i);
+	}
+
+	// No two tiles share any pixels, so they can all be rasterized at once.
+	auto rasterizeFunc = [this](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t i = begin; i < end; i++)
+			this->RasterizeTile(int(i));
+	};
+
+	uint32_t numTiles = (uint32_t)this->tileBinArray.size();
+	if (jobSystem)
+		jobSystem->ParallelFor(numTiles, 1, rasterizeFunc);
+	else
+		rasterizeFunc(0, numTiles);
+
+	this->stats.numTrianglesRasterized = (uint32_t)this->screenTriangleArray.size();
+	for (const std::vector<int>& tileBin : this->tileBinArray)
+		this->stats.numTileTriangles += (uint32_t)tileBin.size();
+
+	this->rasterized = true;
+	this->stats.rasterizeMilliseconds = clock.GetCurrentTimeMilliseconds();
+	return true;
+}
+
+void OcclusionCuller::ProjectToScreen(const Vector3& cameraPoint, float& x, float& y) const
+{
+	double depth = IMZADI_MAX(-cameraPoint.z, this->nearClip);
+	x = float((0.5 + 0.5 * this->scaleX * cameraPoint.x / depth) * double(WIDTH));
+	y = float((0.5 - 0.5 * this->scaleY * cameraPoint.y / depth) * double(HEIGHT));
+}
+
+void OcclusionCuller::TransformTriangles(uint32_t begin, uint32_t end, std::vector<ScreenTriangle>& screenTriangles) const
+{
+	Vector3 vertexArray[2][IMZADI_OCCLUSION_MAX_CLIPPED_VERTICES];
+
+	for (uint32_t i = begin; i < end; i++)
+	{
+		int numVertices = 3;
+		Vector3* polygon = vertexArray[0];
+		Vector3* clippedPolygon = vertexArray[1];
+		for (int j = 0; j < 3; j++)
+			polygon[j] = this->worldToCamera.TransformPoint(this->occluderVertexArray[i * 3 + j]);
+
+		// Clip the triangle to the frustum, so that what's left projects onto the screen without trouble.
+		for (const Plane& plane : this->clipPlaneArray)
+		{
+			int numClippedVertices = 0;
+			for (int j = 0; j < numVertices && numClippedVertices + 2 <= IMZADI_OCCLUSION_MAX_CLIPPED_VERTICES; j++)
+			{
+				const Vector3& vertexA = polygon[j];
+				const Vector3& vertexB = polygon[(j + 1) % numVertices];
+				double distanceA = plane.SignedDistanceTo(vertexA);
+				double distanceB = plane.SignedDistanceTo(vertexB);
+
+				if (distanceA <= 0.0)
+					clippedPolygon[numClippedVertices++] = vertexA;
+
+				if ((distanceA < 0.0 && distanceB > 0.0) || (distanceA > 0.0 && distanceB < 0.0))
+				{
+					double alpha = distanceA / (distanceA - distanceB);
+					clippedPolygon[numClippedVertices++] = vertexA + alpha * (vertexB - vertexA);
+				}
+			}
+
+			numVertices = numClippedVertices;
+			std::swap(polygon, clippedPolygon);
+			if (numVertices < 3)
+				break;
+		}
+
+		if (numVertices < 3)
+			continue;
+
+		float screenX[IMZADI_OCCLUSION_MAX_CLIPPED_VERTICES];
+		float screenY[IMZADI_OCCLUSION_MAX_CLIPPED_VERTICES];
+		float reciprocalDepth[IMZADI_OCCLUSION_MAX_CLIPPED_VERTICES];
+		for (int j = 0; j < numVertices; j++)
+		{
+			this->ProjectToScreen(polygon[j], screenX[j], screenY[j]);
+			reciprocalDepth[j] = float(1.0 / IMZADI_MAX(-polygon[j].z, this->nearClip));
+		}
+
+		for (int j = 1; j + 1 < numVertices; j++)
+		{
+			ScreenTriangle triangle;
+			int indexArray[3] = { 0, j, j + 1 };
+			for (int k = 0; k < 3; k++)
+			{
+				triangle.x[k] = screenX[indexArray[k]];
+				triangle.y[k] = screenY[indexArray[k]];
+				triangle.reciprocalDepth[k] = reciprocalDepth[indexArray[k]];
+			}
+
+			float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) - (triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+			if (::fabsf(area) < 1e-6f)
+				continue;
+
+			// A pixel is covered if its center is, so find the range of pixels whose centers are within the triangle's bounds.
+			float minX = IMZADI_MIN(triangle.x[0], IMZADI_MIN(triangle.x[1], triangle.x[2]));
+			float maxX = IMZADI_MAX(triangle.x[0], IMZADI_MAX(triangle.x[1], triangle.x[2]));
+			float minY = IMZADI_MIN(triangle.y[0], IMZADI_MIN(triangle.y[1], triangle.y[2]));
+			float maxY = IMZADI_MAX(triangle.y[0], IMZADI_MAX(triangle.y[1], triangle.y[2]));
+			triangle.minX = IMZADI_MAX(0, int(::ceilf(minX - 0.5f)));
+			triangle.maxX = IMZADI_MIN(WIDTH - 1, int(::floorf(maxX - 0.5f)));
+			triangle.minY = IMZADI_MAX(0, int(::ceilf(minY - 0.5f)));
+			triangle.maxY = IMZADI_MIN(HEIGHT - 1, int(::floorf(maxY - 0.5f)));
+			if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+				continue;
+
+			screenTriangles.push_back(triangle);
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTile(int tile)
+{
+	const int numTilesX = WIDTH / TILE_WIDTH;
+	int tileMinX = (tile % numTilesX) * TILE_WIDTH;
+	int tileMinY = (tile / numTilesX) * TILE_HEIGHT;
+	int tileMaxX = tileMinX + TILE_WIDTH;
+	int tileMaxY = tileMinY + TILE_HEIGHT;
+
+	for (int y = tileMinY; y < tileMaxY; y++)
+		::memset(&this->depthBuffer[y * WIDTH + tileMinX], 0, TILE_WIDTH * sizeof(float));
+
+	for (int i : this->tileBinArray[tile])
+		this->RasterizeTriangle(this->screenTriangleArray[i], tileMinX, tileMinY, tileMaxX, tileMaxY);
+
+	// Now find the furthest depth of each block in the tile.
+	const int numBlocksX = WIDTH / BLOCK_SIZE;
+	for (int blockY = tileMinY / BLOCK_SIZE; blockY < tileMaxY / BLOCK_SIZE; blockY++)
+	{
+		for (int blockX = tileMinX / BLOCK_SIZE; blockX < tileMaxX / BLOCK_SIZE; blockX++)
+		{
+			__m128 minDepth = _mm_set1_ps(FLT_MAX);
+			for (int y = blockY * BLOCK_SIZE; y < (blockY + 1) * BLOCK_SIZE; y++)
+				for (int x = blockX * BLOCK_SIZE; x < (blockX + 1) * BLOCK_SIZE; x += 4)
+					minDepth = _mm_min_ps(minDepth, _mm_loadu_ps(&this->depthBuffer[y * WIDTH + x]));
+
+			minDepth = _mm_min_ps(minDepth, _mm_shuffle_ps(minDepth, minDepth, _MM_SHUFFLE(1, 0, 3, 2)));
+			minDepth = _mm_min_ps(minDepth, _mm_shuffle_ps(minDepth, minDepth, _MM_SHUFFLE(2, 3, 0, 1)));
+			this->blockDepthBuffer[blockY * numBlocksX + blockX] = _mm_cvtss_f32(minDepth);
+		}
+	}
+}
+
+void OcclusionCuller::RasterizeTriangle(const ScreenTriangle& triangle, int tileMinX, int tileMinY, int tileMaxX, int tileMaxY)
+{
+	const float* x = triangle.x;
+	const float* y = triangle.y;
+	const float* z = triangle.reciprocalDepth;
+
+	// Each edge function is positive on the inside of its edge, whichever way the triangle winds.
+	// Occluders are rasterized inner-conservatively: an edge function is linear, so over a pixel it
+	// dips below its value at the center by at most half of (|A| + |B|).  Pulling each edge in by
+	// that much means a pixel only passes if the triangle covers all of it, so the silhouette of an
+	// occluder never claims a pixel that something behind it might show through.
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	float sign = (area > 0.0f) ? 1.0f : -1.0f;
+	float edgeA[3], edgeB[3], edgeC[3];
+	for (int i = 0; i < 3; i++)
+	{
+		int j = (i + 1) % 3;
+		edgeA[i] = sign * (y[i] - y[j]);
+		edgeB[i] = sign * (x[j] - x[i]);
+		edgeC[i] = sign * ((y[j] - y[i]) * x[i] - (x[j] - x[i]) * y[i]);
+		edgeC[i] -= 0.5f * (fabsf(edgeA[i]) + fabsf(edgeB[i]));
+	}
+
+	// Reciprocal depth is a linear function of screen position.  For the same reason as above,
+	// we write the farthest depth the triangle reaches within the pixel, not the depth at its center.
+	float depthDX = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+	float depthDY = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+	float depthBias = 0.5f * (fabsf(depthDX) + fabsf(depthDY));
+	float maxDepth = float(1.0 / this->nearClip);
+
+	int minX = IMZADI_MAX(triangle.minX, tileMinX) & ~3;
+	int maxX = IMZADI_MIN(triangle.maxX, tileMaxX - 1);
+	int minY = IMZADI_MAX(triangle.minY, tileMinY);
+	int maxY = IMZADI_MIN(triangle.maxY, tileMaxY - 1);
+
+	__m128 packedEdgeA[3], packedEdgeB[3], packedEdgeC[3];
+	for (int i = 0; i < 3; i++)
+	{
+		packedEdgeA[i] = _mm_set1_ps(edgeA[i]);
+		packedEdgeB[i] = _mm_set1_ps(edgeB[i]);
+		packedEdgeC[i] = _mm_set1_ps(edgeC[i]);
+	}
+
+	__m128 packedDepthDX = _mm_set1_ps(depthDX);
+	__m128 packedMaxDepth = _mm_set1_ps(maxDepth);
+	__m128 zero = _mm_setzero_ps();
+	__m128 pixelOffset = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+
+	for (int pixelY = minY; pixelY <= maxY; pixelY++)
+	{
+		__m128 centerY = _mm_set1_ps(float(pixelY) + 0.5f);
+		__m128 rowDepth = _mm_set1_ps(z[0] + depthDY * (float(pixelY) + 0.5f - y[0]) - depthDX * x[0] - depthBias);
+		__m128 rowEdge[3];
+		for (int i = 0; i < 3; i++)
+			rowEdge[i] = _mm_add_ps(_mm_mul_ps(packedEdgeB[i], centerY), packedEdgeC[i]);
+
+		float* depthRow = &this->depthBuffer[pixelY * WIDTH];
+
+		for (int pixelX = minX; pixelX <= maxX; pixelX += 4)
+		{
+			__m128 centerX = _mm_add_ps(_mm_set1_ps(float(pixelX)), pixelOffset);
+
+			__m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(packedEdgeA[0], centerX), rowEdge[0]), zero);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(packedEdgeA[1], centerX), rowEdge[1]), zero));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(packedEdgeA[2], centerX), rowEdge[2]), zero));
+			if (_mm_movemask_ps(inside) == 0)
+				continue;
+
+			// Keep the nearest depth, which is the greatest reciprocal depth.
+			__m128 depth = _mm_min_ps(_mm_add_ps(rowDepth, _mm_mul_ps(packedDepthDX, centerX)), packedMaxDepth);
+			__m128 oldDepth = _mm_loadu_ps(&depthRow[pixelX]);
+			__m128 newDepth = _mm_max_ps(oldDepth, depth);
+			_mm_storeu_ps(&depthRow[pixelX], _mm_or_ps(_mm_and_ps(inside, newDepth), _mm_andnot_ps(inside, oldDepth)));
+		}
+	}
+}
+
+bool OcclusionCuller::IsOccluded(const RenderObject* renderObject) const
+{
+	Vector3 center;
+	double radius = 0.0;
+	if (!renderObject->GetWorldBoundingSphere(center, radius))
+		return false;
+
+	return this->IsOccluded(center, radius);
+}
+
+bool OcclusionCuller::IsOccluded(const Vector3& center, double radius) const
+{
+	if (!this->rasterized)
+		return false;
+
+	this->stats.numObjectsTested++;
+
+	Vector3 cameraCenter = this->worldToCamera.TransformPoint(center);
+	double nearDepth = -cameraCenter.z - radius;
+	double farDepth = -cameraCenter.z + radius;
+	if (nearDepth <= this->nearClip)
+		return false;
+
+	// Bound the sphere by a box, and then bound the projection of the box on screen.
+	double minX = cameraCenter.x - radius;
+	double maxX = cameraCenter.x + radius;
+	double minY = cameraCenter.y - radius;
+	double maxY = cameraCenter.y + radius;
+	minX /= (minX < 0.0) ? nearDepth : farDepth;
+	maxX /= (maxX > 0.0) ? nearDepth : farDepth;
+	minY /= (minY < 0.0) ? nearDepth : farDepth;
+	maxY /= (maxY > 0.0) ? nearDepth : farDepth;
+
+	int pixelMinX = int(::floor((0.5 + 0.5 * this->scaleX * minX) * double(WIDTH)));
+	int pixelMaxX = int(::floor((0.5 + 0.5 * this->scaleX * maxX) * double(WIDTH)));
+	int pixelMinY = int(::floor((0.5 - 0.5 * this->scaleY * maxY) * double(HEIGHT)));
+	int pixelMaxY = int(::floor((0.5 - 0.5 * this->scaleY * minY) * double(HEIGHT)));
+	if (pixelMaxX < 0 || pixelMinX >= WIDTH || pixelMaxY < 0 || pixelMinY >= HEIGHT)
+		return false;
+
+	pixelMinX = IMZADI_MAX(pixelMinX, 0);
+	pixelMaxX = IMZADI_MIN(pixelMaxX, WIDTH - 1);
+	pixelMinY = IMZADI_MAX(pixelMinY, 0);
+	pixelMaxY = IMZADI_MIN(pixelMaxY, HEIGHT - 1);
+
+	// The object is occluded if every pixel it covers has something nearer in it than the nearest point of the object.
+	// Whole blocks can be passed over if even the furthest thing in them is nearer than that.
+	float objectDepth = float(1.0 / nearDepth);
+	const int numBlocksX = WIDTH / BLOCK_SIZE;
+	for (int blockY = pixelMinY / BLOCK_SIZE; blockY <= pixelMaxY / BLOCK_SIZE; blockY++)
+	{
+		for (int blockX = pixelMinX / BLOCK_SIZE; blockX <= pixelMaxX / BLOCK_SIZE; blockX++)
+		{
+			if (this->blockDepthBuffer[blockY * numBlocksX + blockX] > objectDepth)
+				continue;
+
+			int blockMinX = IMZADI_MAX(pixelMinX, blockX * BLOCK_SIZE);
+			int blockMaxX = IMZADI_MIN(pixelMaxX, (blockX + 1) * BLOCK_SIZE - 1);
+			int blockMinY = IMZADI_MAX(pixelMinY, blockY * BLOCK_SIZE);
+			int blockMaxY = IMZADI_MIN(pixelMaxY, (blockY + 1) * BLOCK_SIZE - 1);
+			for (int y = blockMinY; y <= blockMaxY; y++)
+				for (int x = blockMinX; x <= blockMaxX; x++)
+					if (this->depthBuffer[y * WIDTH + x] <= objectDepth)
+						return false;
+		}
+	}
+
+	this->stats.numObjectsOccluded++;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "Defines.h"
+#include "Math/Vector3.h"
+#include "Math/Polygon.h"
+#include "Math/Transform.h"
+#include "Math/Plane.h"
+#include <vector>
+
+namespace Imzadi
+{
+	class Camera;
+	class JobSystem;
+	class RenderObject;
+
+	/**
+	 * This decides, on the CPU, which render objects are hidden behind others, so that they
+	 * needn't be drawn.  A handful of big polygons, picked from the level's collision geometry,
+	 * serve as occluders.  Each frame, these are rasterized into a small depth buffer as seen
+	 * from the camera, and then the bounding sphere of each render object that made it through
+	 * frustum culling is compared with the depths where it would appear on screen.  An object
+	 * that is further away than everything in front of it is occluded.
+	 *
+	 * The depth buffer is divided into tiles, each of which is rasterized independently of the
+	 * others on the job system, four pixels at a time using SSE.  The buffer stores reciprocal
+	 * depth, which can be interpolated linearly across a triangle on screen, with zero meaning
+	 * that nothing is there.  For every 8x8 block of pixels, we also keep the furthest depth in
+	 * it, so that most objects can be tested by looking at just a few blocks.
+	 *
+	 * None of this touches the GPU, so it can all be tested without one.
+	 */
+	class IMZADI_API OcclusionCuller
+	{
+	public:
+		OcclusionCuller();
+		virtual ~OcclusionCuller();
+
+		static const int WIDTH = 320;
+		static const int HEIGHT = 192;
+		static const int TILE_WIDTH = 64;
+		static const int TILE_HEIGHT = 32;
+		static const int BLOCK_SIZE = 8;
+
+		/**
+		 * Forget all occluders.
+		 */
+		void Clear();
+
+		/**
+		 * Choose occluders from among the given polygons.  Those smaller than the minimum area
+		 * are skipped, and the largest are taken first, until there are as many triangles as allowed.
+		 * The given polygons must be convex.
+		 *
+		 * @param[in] polygonArray These are world-space polygons, typically of a level's collision geometry.
+		 */
+		void SetOccluders(const std::vector<Polygon>& polygonArray);
+
+		/**
+		 * Rasterize the occluders as seen by the given camera.  This must be done before any
+		 * object is tested for occlusion, and the camera must not move in-between.
+		 *
+		 * @param[in] camera This is the camera whose view is rasterized.
+		 * @param[in] jobSystem If given, the tiles of the depth buffer are rasterized in parallel on this job system.
+		 * @return False is returned if nothing could be rasterized, in which case nothing will be considered occluded.
+		 */
+		bool Rasterize(const Camera* camera, JobSystem* jobSystem);
+
+		/**
+		 * Tell the caller if the given world-space sphere is hidden behind the occluders last rasterized.
+		 */
+		bool IsOccluded(const Vector3& center, double radius) const;
+
+		/**
+		 * Tell the caller if the given render object's bounding sphere is hidden behind the occluders last rasterized.
+		 * Objects without a bounding sphere are never considered occluded.
+		 */
+		bool IsOccluded(const RenderObject* renderObject) const;
+
+		void SetEnabled(bool enabled) { this->enabled = enabled; }
+		bool IsEnabled() const { return this->enabled; }
+
+		void SetMinOccluderArea(double minOccluderArea) { this->minOccluderArea = minOccluderArea; }
+		double GetMinOccluderArea() const { return this->minOccluderArea; }
+
+		void SetMaxOccluderTriangles(uint32_t maxOccluderTriangles) { this->maxOccluderTriangles = maxOccluderTriangles; }
+		uint32_t GetMaxOccluderTriangles() const { return this->maxOccluderTriangles; }
+
+		struct Stats
+		{
+			uint32_t numOccluderTriangles;		///< This is how many triangles were chosen as occluders.
+			uint32_t numTrianglesRasterized;	///< This is how many triangles were left to rasterize after clipping to the view.
+			uint32_t numTileTriangles;			///< This is how many times a triangle was rasterized into a tile.
+			uint32_t numObjectsTested;			///< This is how many objects were tested since the last rasterization.
+			uint32_t numObjectsOccluded;		///< This is how many of those were found to be occluded.
+			double rasterizeMilliseconds;		///< This is how long the last rasterization took.
+		};
+
+		const Stats& GetStats() const { return this->stats; }
+
+		/**
+		 * Return the reciprocal depth of the given pixel of the depth buffer, or zero if no occluder covers it.
+		 */
+		float GetReciprocalDepth(int x, int y) const { return this->depthBuffer[y * WIDTH + x]; }
+
+	private:
+
+		/**
+		 * This is an occluder triangle clipped to the view and projected onto the depth buffer.
+		 */
+		struct ScreenTriangle
+		{
+			float x[3];
+			float y[3];
+			float reciprocalDepth[3];
+			int minX, minY, maxX, maxY;
+		};
+
+		void TransformTriangles(uint32_t begin, uint32_t end, std::vector<ScreenTriangle>& screenTriangleArray) const;
+		void RasterizeTile(int tile);
+		void RasterizeTriangle(const ScreenTriangle& triangle, int tileMinX, int tileMinY, int tileMaxX, int tileMaxY);
+		void ProjectToScreen(const Vector3& cameraPoint, float& x, float& y) const;
+
+		bool enabled;
+		bool rasterized;
+		double minOccluderArea;
+		uint32_t maxOccluderTriangles;
+		std::vector<Vector3> occluderVertexArray;		///< Every three of these make a world-space occluder triangle.
+		std::vector<std::vector<ScreenTriangle>> chunkTriangleArray;	///< These are the screen triangles made by each job of the transform stage.
+		std::vector<ScreenTriangle> screenTriangleArray;
+		std::vector<std::vector<int>> tileBinArray;		///< For each tile, these are the screen triangles overlapping it.
+		std::vector<float> depthBuffer;
+		std::vector<float> blockDepthBuffer;			///< For each block of pixels, this is the least reciprocal depth in it.
+		Transform worldToCamera;
+		std::vector<Plane> clipPlaneArray;
+		double nearClip;
+		double scaleX, scaleY;
+		mutable Stats stats;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,354 @@
+#include "PathfindingService.h"
+#include "JobSystem.h"
+#include "Profile.h"
+#include "Log.h"
+#include <algorithm>
+
+using namespace Imzadi;
+
+//------------------------------------- PathRequest -------------------------------------
+
+PathRequest::PathRequest()
+{
+	this->startOrdinal = -1;
+	this->goalOrdinal = -1;
+	this->graphVersion = 0;
+	this->status = NavGraph::SearchStatus::SEARCH_IN_PROGRESS;
+}
+
+/*virtual*/ PathRequest::~PathRequest()
+{
+}
+
+//------------------------------------- PathfindingService -------------------------------------
+
+PathfindingService::PathfindingService()
+{
+	this->jobSystem = nullptr;
+	this->eventSystem = nullptr;
+	this->timeBudgetMilliseconds = 1.0;
+	this->cacheCapacity = 256;
+	this->numInProgress = 0;
+	this->ResetStats();
+}
+
+/*virtual*/ PathfindingService::~PathfindingService()
+{
+}
+
+bool PathfindingService::Startup(JobSystem* jobSystem, EventSystem* eventSystem)
+{
+	if (this->slotArray.size() > 0)
+	{
+		IMZADI_LOG_ERROR("Pathfinding service already started.");
+		return false;
+	}
+
+	this->jobSystem = jobSystem;
+	this->eventSystem = eventSystem;
+
+	// One slot per thread of the job system lets every thread work on a search at once.
+	this->slotArray.resize(jobSystem->GetNumWorkers() + 1);
+
+	return true;
+}
+
+void PathfindingService::Shutdown()
+{
+	this->SetNavGraph(nullptr);
+	this->slotArray.clear();
+	this->jobSystem = nullptr;
+	this->eventSystem = nullptr;
+}
+
+void PathfindingService::SetNavGraph(NavGraph* navGraph)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->FailAllRequests();
+	this->navGraph.Set(navGraph);
+	this->snapshot.Reset();
+}
+
+void PathfindingService::FailAllRequests()
+{
+	for (SearchSlot& slot : this->slotArray)
+	{
+		if (slot.request.Get())
+		{
+			slot.request->snapshot.Reset();
+			slot.request->status.store(NavGraph::SearchStatus::SEARCH_FAILED, std::memory_order_release);
+			slot.request.Reset();
+		}
+	}
+
+	for (Reference<PathRequest>& request : this->pendingRequestList)
+	{
+		request->snapshot.Reset();
+		request->status.store(NavGraph::SearchStatus::SEARCH_FAILED, std::memory_order_release);
+	}
+
+	this->pendingRequestList.clear();
+	this->inFlightMap.clear();
+	this->cacheOrderList.clear();
+	this->cacheMap.clear();
+	this->numInProgress = 0;
+}
+
+void PathfindingService::UpdateSnapshot()
+{
+	if (!this->navGraph.Get())
+		return;
+
+	if (this->snapshot.Get() && this->snapshot->GetVersion() == this->navGraph->GetVersion())
+		return;
+
+	IMZADI_PROFILE("Pathfinding Snapshot");
+
+	Reference<NavGraph> newSnapshot(new NavGraph());
+	newSnapshot->CopyFrom(*this->navGraph);
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	// Searches already going on carry on against the old snapshot, which they keep alive,
+	// but new requests must not be joined with them, nor answered with cached paths of the old graph.
+	this->snapshot = newSnapshot;
+	this->inFlightMap.clear();
+	this->cacheOrderList.clear();
+	this->cacheMap.clear();
+}
+
+/*static*/ PathfindingService::PathKey PathfindingService::MakePathKey(int startOrdinal, int goalOrdinal)
+{
+	return (uint64_t(uint32_t(startOrdinal)) << 32) | uint64_t(uint32_t(goalOrdinal));
+}
+
+Reference<PathRequest> PathfindingService::RequestPath(const NavGraph::Node* startNode, const NavGraph::Node* goalNode, EventChannelID channelID /*= 0*/)
+{
+	Reference<PathRequest> request;
+
+	if (!startNode || !goalNode)
+		return request;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	if (!this->snapshot.Get())
+		return request;
+
+	int numNodes = this->snapshot->GetNumNodes();
+	if (!(0 <= startNode->ordinal && startNode->ordinal < numNodes) || !(0 <= goalNode->ordinal && goalNode->ordinal < numNodes))
+		return request;
+
+	this->stats.numRequests++;
+
+	PathKey key = MakePathKey(startNode->ordinal, goalNode->ordinal);
+
+	auto cacheIter = this->cacheMap.find(key);
+	if (cacheIter != this->cacheMap.end())
+	{
+		this->stats.numCacheHits++;
+		this->cacheOrderList.splice(this->cacheOrderList.begin(), this->cacheOrderList, cacheIter->second.second);
+		request = cacheIter->second.first;
+
+		if (channelID != 0)
+			this->eventSystem->SendEvent(channelID, new PathfindingEvent(request));
+
+		return request;
+	}
+
+	auto inFlightIter = this->inFlightMap.find(key);
+	if (inFlightIter != this->inFlightMap.end())
+	{
+		this->stats.numDeduplicated++;
+		request = inFlightIter->second;
+
+		if (channelID != 0 && std::find(request->channelIDArray.begin(), request->channelIDArray.end(), channelID) == request->channelIDArray.end())
+			request->channelIDArray.push_back(channelID);
+
+		return request;
+	}
+
+	request.Set(new PathRequest());
+	request->startOrdinal = startNode->ordinal;
+	request->goalOrdinal = goalNode->ordinal;
+	request->graphVersion = this->snapshot->GetVersion();
+	request->snapshot = this->snapshot;
+	if (channelID != 0)
+		request->channelIDArray.push_back(channelID);
+
+	this->pendingRequestList.push_back(request);
+	this->inFlightMap.insert(std::pair<PathKey, Reference<PathRequest>>(key, request));
+
+	return request;
+}
+
+void PathfindingService::Tick()
+{
+	IMZADI_PROFILE("Pathfinding");
+
+	Clock clock;
+	clock.Reset();
+
+	bool haveWork = false;
+	for (const SearchSlot& slot : this->slotArray)
+		if (slot.request.Get())
+			haveWork = true;
+
+	if (!haveWork)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		haveWork = this->pendingRequestList.size() > 0;
+	}
+
+	if (!haveWork)
+		return;
+
+	this->jobSystem->ParallelFor((uint32_t)this->slotArray.size(), 1, [this, &clock](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t i = begin; i < end; i++)
+				this->WorkOnSlot(this->slotArray[i], clock);
+		});
+
+	uint32_t numInProgress = 0;
+	for (const SearchSlot& slot : this->slotArray)
+		if (slot.request.Get())
+			numInProgress++;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->stats.lastTickMilliseconds = clock.GetCurrentTimeMilliseconds();
+	this->numInProgress = numInProgress;
+	if (numInProgress > 0 || this->pendingRequestList.size() > 0)
+		this->stats.numTimeSlicedTicks++;
+}
+
+void PathfindingService::WorkOnSlot(SearchSlot& slot, const Clock& clock)
+{
+	// Checking the clock isn't free, so only do it every so many nodes.
+	const uint32_t nodesPerClockCheck = 32;
+
+	while (clock.GetCurrentTimeMilliseconds() < this->timeBudgetMilliseconds)
+	{
+		if (!slot.request.Get())
+		{
+			slot.request = this->TakeNextRequest();
+			if (!slot.request.Get())
+				break;
+
+			const NavGraph* snapshot = slot.request->snapshot.Get();
+			const NavGraph::Node* startNode = snapshot->GetNode(slot.request->startOrdinal);
+			const NavGraph::Node* goalNode = snapshot->GetNode(slot.request->goalOrdinal);
+			if (!snapshot->BeginShortestPathSearch(startNode, goalNode, slot.context))
+			{
+				this->FinishRequest(slot);
+				continue;
+			}
+		}
+
+		if (slot.request->snapshot->ContinueShortestPathSearch(slot.context, nodesPerClockCheck) != NavGraph::SearchStatus::SEARCH_IN_PROGRESS)
+			this->FinishRequest(slot);
+	}
+}
+
+Reference<PathRequest> PathfindingService::TakeNextRequest()
+{
+	Reference<PathRequest> request;
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	if (this->pendingRequestList.size() > 0)
+	{
+		request = this->pendingRequestList.front();
+		this->pendingRequestList.pop_front();
+	}
+
+	return request;
+}
+
+void PathfindingService::FinishRequest(SearchSlot& slot)
+{
+	Reference<PathRequest> request = slot.request;
+	slot.request.Reset();
+
+	request->snapshot->GetShortestPath(slot.context, request->pathArray);
+	request->snapshot.Reset();
+	request->status.store(slot.context.GetStatus(), std::memory_order_release);
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->stats.numSearches++;
+
+	PathKey key = MakePathKey(request->startOrdinal, request->goalOrdinal);
+
+	auto iter = this->inFlightMap.find(key);
+	if (iter != this->inFlightMap.end() && iter->second.Get() == request.Get())
+		this->inFlightMap.erase(iter);
+
+	if (this->snapshot.Get() && this->snapshot->GetVersion() == request->graphVersion)
+		this->AddToCache(key, request);
+
+	for (EventChannelID channelID : request->channelIDArray)
+		this->eventSystem->SendEvent(channelID, new PathfindingEvent(request));
+
+	request->channelIDArray.clear();
+}
+
+void PathfindingService::AddToCache(PathKey key, PathRequest* request)
+{
+	if (this->cacheCapacity == 0)
+		return;
+
+	auto iter = this->cacheMap.find(key);
+	if (iter != this->cacheMap.end())
+	{
+		this->cacheOrderList.erase(iter->second.second);
+		this->cacheMap.erase(iter);
+	}
+
+	while (this->cacheMap.size() >= this->cacheCapacity)
+	{
+		this->cacheMap.erase(this->cacheOrderList.back());
+		this->cacheOrderList.pop_back();
+	}
+
+	this->cacheOrderList.push_front(key);
+	this->cacheMap.insert(std::pair(key, std::pair(Reference<PathRequest>(request), this->cacheOrderList.begin())));
+}
+
+void PathfindingService::SetTimeBudgetMilliseconds(double timeBudgetMilliseconds)
+{
+	if (timeBudgetMilliseconds <= 0.0)
+	{
+		IMZADI_LOG_ERROR("The pathfinding time budget must be positive, not %f.", timeBudgetMilliseconds);
+		return;
+	}
+
+	this->timeBudgetMilliseconds = timeBudgetMilliseconds;
+}
+
+void PathfindingService::SetCacheCapacity(uint32_t cacheCapacity)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->cacheCapacity = cacheCapacity;
+
+	while (this->cacheMap.size() > this->cacheCapacity)
+	{
+		this->cacheMap.erase(this->cacheOrderList.back());
+		this->cacheOrderList.pop_back();
+	}
+}
+
+void PathfindingService::GetStats(Stats& stats)
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	stats = this->stats;
+	stats.numPending = (uint32_t)this->pendingRequestList.size() + this->numInProgress;
+}
+
+void PathfindingService::ResetStats()
+{
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	::memset(&this->stats, 0, sizeof(Stats));
+}
\ No newline at end of file
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "Assets/NavGraph.h"
+#include "EventSystem.h"
+#include "Clock.h"
+#include <list>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+
+namespace Imzadi
+{
+	class JobSystem;
+
+	/**
+	 * This is the handle given back by the pathfinding service for each path asked of it.
+	 * The requester can just hold onto it and poll it each tick until it's done.  Identical
+	 * requests made while a search is still going on all get the same handle.
+	 */
+	class IMZADI_API PathRequest : public ReferenceCounted
+	{
+		friend class PathfindingService;
+
+	public:
+		PathRequest();
+		virtual ~PathRequest();
+
+		/**
+		 * Tell the caller where the search for this path stands.  This can be called from any thread.
+		 */
+		NavGraph::SearchStatus GetStatus() const { return this->status.load(std::memory_order_acquire); }
+
+		/**
+		 * Tell the caller if the search for this path is over, whether or not a path was found.
+		 */
+		bool IsDone() const { return this->GetStatus() != NavGraph::SearchStatus::SEARCH_IN_PROGRESS; }
+
+		/**
+		 * Once the search has succeeded, this is the path found, as a sequence of turns taken from
+		 * the start node.  See @ref NavGraph::FindShortestPath.
+		 */
+		const std::vector<int>& GetPathArray() const { return this->pathArray; }
+
+		int GetStartOrdinal() const { return this->startOrdinal; }
+		int GetGoalOrdinal() const { return this->goalOrdinal; }
+
+		/**
+		 * The search is made against a snapshot of the nav-graph, which may since have been edited.
+		 * Tell the caller if the turns of the found path can still be taken in the given graph.
+		 */
+		bool IsValidFor(const NavGraph* navGraph) const { return navGraph && navGraph->GetVersion() == this->graphVersion; }
+
+	private:
+		int startOrdinal;
+		int goalOrdinal;
+		uint32_t graphVersion;
+		std::vector<int> pathArray;
+		std::atomic<NavGraph::SearchStatus> status;
+		Reference<NavGraph> snapshot;					///< This is the graph we search, and is released once the search is done.
+		std::vector<EventChannelID> channelIDArray;		///< These are the channels to notify when the search is done.  They're guarded by the service's mutex.
+	};
+
+	/**
+	 * These are sent by the pathfinding service when a search is done, but only
+	 * to the channels given when the path was requested.
+	 */
+	class IMZADI_API PathfindingEvent : public Event
+	{
+	public:
+		PathfindingEvent(PathRequest* request)
+		{
+			this->request.Set(request);
+		}
+
+		virtual ~PathfindingEvent()
+		{
+		}
+
+	public:
+		Reference<PathRequest> request;
+	};
+
+	/**
+	 * Rather than have entities find their paths right there in their tick, they can ask this
+	 * service to do it for them.  The searches are run on the job system against a read-only
+	 * copy of the level's nav-graph, which is only refreshed when the graph is edited, and
+	 * only at the start of a frame, so entities are free to edit the graph while searches are
+	 * going on.  Each frame, the service works on searches for no more than its time budget;
+	 * whatever searches aren't done by then are picked up again next frame.  Paths recently
+	 * found are cached, so an entity that keeps asking for the same path gets it right away.
+	 */
+	class IMZADI_API PathfindingService
+	{
+	public:
+		PathfindingService();
+		virtual ~PathfindingService();
+
+		bool Startup(JobSystem* jobSystem, EventSystem* eventSystem);
+		void Shutdown();
+
+		/**
+		 * Make the service search the given graph.  All outstanding requests fail, and the cache is cleared.
+		 * This should be called from the main thread, but not while the service is ticking.
+		 */
+		void SetNavGraph(NavGraph* navGraph);
+		NavGraph* GetNavGraph() { return this->navGraph.Get(); }
+
+		/**
+		 * Copy the nav-graph again if it's changed since we last did.  This should be called from the main
+		 * thread once per frame, at a time when no entity is editing the graph.
+		 */
+		void UpdateSnapshot();
+
+		/**
+		 * Ask for the shortest path between the two given nodes of the nav-graph.  This can be called from any thread.
+		 *
+		 * @param[in] startNode This is where the path should start.
+		 * @param[in] goalNode This is where the path should end.
+		 * @param[in] channelID If non-zero, a @ref PathfindingEvent is sent on this channel when the search is done.
+		 * @return A handle to the request is returned, which may already be done if the path was cached.  Null is returned if there is no nav-graph, or if the given nodes aren't in it.
+		 */
+		Reference<PathRequest> RequestPath(const NavGraph::Node* startNode, const NavGraph::Node* goalNode, EventChannelID channelID = 0);
+
+		/**
+		 * Work on outstanding searches until they're all done or the time budget is spent.
+		 * This is called once per frame by the frame task graph, and can be called from any thread.
+		 */
+		void Tick();
+
+		/**
+		 * Set the wall-clock time, in milliseconds, the service may spend on searches each frame.
+		 */
+		void SetTimeBudgetMilliseconds(double timeBudgetMilliseconds);
+		double GetTimeBudgetMilliseconds() const { return this->timeBudgetMilliseconds; }
+
+		/**
+		 * Set how many paths, at most, are remembered by the cache.
+		 */
+		void SetCacheCapacity(uint32_t cacheCapacity);
+		uint32_t GetCacheCapacity() const { return this->cacheCapacity; }
+
+		/**
+		 * These are counted since the last call to @ref ResetStats.
+		 */
+		struct Stats
+		{
+			uint32_t numRequests;			///< This is how many paths were asked for.
+			uint32_t numCacheHits;			///< This is how many requests were answered right away from the cache.
+			uint32_t numDeduplicated;		///< This is how many requests joined a search that was already going on.
+			uint32_t numSearches;			///< This is how many searches were finished.
+			uint32_t numTimeSlicedTicks;	///< This is how many ticks ran out of time before all searches were done.
+			uint32_t numPending;			///< This is how many searches are waiting or in progress right now.
+			double lastTickMilliseconds;	///< This is how long the last tick spent on searches.
+		};
+
+		void GetStats(Stats& stats);
+		void ResetStats();
+
+	private:
+
+		typedef uint64_t PathKey;
+
+		static PathKey MakePathKey(int startOrdinal, int goalOrdinal);
+
+		/**
+		 * We keep one of these per thread that can work on searches at once.  A search
+		 * that isn't done by the end of a tick stays in its slot until the next tick.
+		 */
+		struct SearchSlot
+		{
+			Reference<PathRequest> request;
+			NavGraph::SearchContext context;
+		};
+
+		void WorkOnSlot(SearchSlot& slot, const Clock& clock);
+		Reference<PathRequest> TakeNextRequest();
+		void FinishRequest(SearchSlot& slot);
+		void FailAllRequests();
+		void AddToCache(PathKey key, PathRequest* request);
+
+		JobSystem* jobSystem;
+		EventSystem* eventSystem;
+		Reference<NavGraph> navGraph;
+		Reference<NavGraph> snapshot;
+		std::vector<SearchSlot> slotArray;
+		double timeBudgetMilliseconds;
+		uint32_t cacheCapacity;
+
+		std::mutex mutex;
+		std::list<Reference<PathRequest>> pendingRequestList;
+		std::unordered_map<PathKey, Reference<PathRequest>> inFlightMap;
+		std::list<PathKey> cacheOrderList;		///< The most recently used path is at the front.
+		std::unordered_map<PathKey, std::pair<Reference<PathRequest>, std::list<PathKey>::iterator>> cacheMap;
+		uint32_t numInProgress;		///< This is how many slots were left holding unfinished searches by the last tick.
+		Stats stats;
+	};
+}
\ No newline at end of file
@@ -1,58 +1,285 @@
 #include "Profile.h"
+#include "Log.h"
 #include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <format>
 
 using namespace Imzadi;
 
-ProfileBlock::ProfileBlock(ProfileData* data, const std::string& name)
+//------------------------------- ProfileScope -------------------------------
+
+ProfileScope::ProfileScope(const ProfileZone* zone)
 {
-	this->data = data;
-	this->name = name;
-	this->clock.Reset();
+	if (!Profiler::Get()->IsEnabled())
+	{
+		this->buffer = nullptr;
+		return;
+	}
+
+	this->buffer = Profiler::GetThreadBuffer();
+	this->zone = zone;
+	this->depth = this->buffer->depth++;
+	this->startTimeNS = Profiler::GetTimeNS();
 }
 
-/*virtual*/ ProfileBlock::~ProfileBlock()
+ProfileScope::~ProfileScope()
 {
-	double timeSpentMS = this->clock.GetCurrentTimeMilliseconds();
-	this->data->AccumulateInfo(this->name, timeSpentMS);
+	if (!this->buffer)
+		return;
+
+	uint64_t endTimeNS = Profiler::GetTimeNS();
+	this->buffer->depth--;
+	this->buffer->Write(this->zone, this->startTimeNS, endTimeNS, this->depth);
 }
 
-ProfileData::ProfileData()
+//------------------------------- ProfileThreadBuffer -------------------------------
+
+ProfileThreadBuffer::ProfileThreadBuffer(uint32_t threadID)
 {
+	this->threadID = threadID;
+	this->depth = 0;
+	this->statsStartIndex = 0;
+	this->slotArray = new Slot[SAMPLE_CAPACITY];
+	this->writeStartIndex = 0;
+	this->writeIndex = 0;
 }
 
-/*virtual*/ ProfileData::~ProfileData()
+/*virtual*/ ProfileThreadBuffer::~ProfileThreadBuffer()
 {
+	delete[] this->slotArray;
 }
 
-void ProfileData::AccumulateInfo(const std::string& blockName, double timeSpentMS)
+void ProfileThreadBuffer::Write(const ProfileZone* zone, uint64_t startTimeNS, uint64_t endTimeNS, uint32_t depth)
 {
-	BlockMap::iterator iter = this->blockMap.find(blockName);
-	if (iter != this->blockMap.end())
+	uint64_t index = this->writeIndex.load(std::memory_order_relaxed);
+
+	// Let readers know we're about to overwrite the slot before we touch it.
+	this->writeStartIndex.store(index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	Slot& slot = this->slotArray[index & (SAMPLE_CAPACITY - 1)];
+	slot.zone.store(zone, std::memory_order_relaxed);
+	slot.startTimeNS.store(startTimeNS, std::memory_order_relaxed);
+	slot.endTimeNS.store(endTimeNS, std::memory_order_relaxed);
+	slot.depth.store(depth, std::memory_order_relaxed);
+
+	this->writeIndex.store(index + 1, std::memory_order_release);
+}
+
+uint64_t ProfileThreadBuffer::Read(std::vector<ProfileSample>& sampleArray, uint64_t sinceIndex /*= 0*/) const
+{
+	uint64_t endIndex = this->writeIndex.load(std::memory_order_acquire);
+	uint64_t beginIndex = IMZADI_MAX(sinceIndex, (endIndex > SAMPLE_CAPACITY) ? (endIndex - SAMPLE_CAPACITY) : 0);
+	if (beginIndex >= endIndex)
+		return IMZADI_MAX(sinceIndex, endIndex);
+
+	std::vector<ProfileSample> copiedSampleArray;
+	copiedSampleArray.reserve(size_t(endIndex - beginIndex));
+	for (uint64_t i = beginIndex; i < endIndex; i++)
 	{
-		Block& block = iter->second;
-		block.hitCount++;
-		block.totalTimeMS += timeSpentMS;
+		const Slot& slot = this->slotArray[i & (SAMPLE_CAPACITY - 1)];
+		ProfileSample sample;
+		sample.zone = slot.zone.load(std::memory_order_relaxed);
+		sample.startTimeNS = slot.startTimeNS.load(std::memory_order_relaxed);
+		sample.endTimeNS = slot.endTimeNS.load(std::memory_order_relaxed);
+		sample.depth = slot.depth.load(std::memory_order_relaxed);
+		copiedSampleArray.push_back(sample);
 	}
-	else
+
+	// Any slot the owning thread started overwriting while we were copying can't be trusted.
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint64_t writeStartIndex = this->writeStartIndex.load(std::memory_order_relaxed);
+	uint64_t firstValidIndex = (writeStartIndex > SAMPLE_CAPACITY) ? (writeStartIndex - SAMPLE_CAPACITY) : 0;
+
+	for (uint64_t i = IMZADI_MAX(beginIndex, firstValidIndex); i < endIndex; i++)
+		sampleArray.push_back(copiedSampleArray[size_t(i - beginIndex)]);
+
+	return endIndex;
+}
+
+//------------------------------- Profiler -------------------------------
+
+Profiler::Profiler()
+{
+	this->enabled = true;
+	this->baseTimeNS = GetTimeNS();
+	this->frameCount = 0;
+
+	for (uint32_t i = 0; i < MAX_FRAMES; i++)
+		this->frameStartArray[i] = 0;
+}
+
+/*virtual*/ Profiler::~Profiler()
+{
+	for (ProfileThreadBuffer* buffer : this->threadBufferArray)
+		delete buffer;
+
+	for (auto& pair : this->internedZoneMap)
+		delete pair.second;
+}
+
+/*static*/ Profiler* Profiler::Get()
+{
+	static Profiler profiler;
+	return &profiler;
+}
+
+/*static*/ uint64_t Profiler::GetTimeNS()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*static*/ ProfileThreadBuffer* Profiler::GetThreadBuffer()
+{
+	// The buffer outlives its thread so that what the thread recorded can still be looked at.
+	static thread_local ProfileThreadBuffer* buffer = nullptr;
+	if (!buffer)
+		buffer = Get()->RegisterThread();
+
+	return buffer;
+}
+
+ProfileThreadBuffer* Profiler::RegisterThread()
+{
+	std::lock_guard guard(this->mutex);
+
+	auto buffer = new ProfileThreadBuffer((uint32_t)this->threadBufferArray.size() + 1);
+	buffer->name = std::format("Thread {}", buffer->GetThreadID());
+	this->threadBufferArray.push_back(buffer);
+	return buffer;
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	ProfileThreadBuffer* buffer = GetThreadBuffer();
+
+	std::lock_guard guard(this->mutex);
+	buffer->name = name;
+}
+
+void Profiler::MarkFrame()
+{
+	uint64_t count = this->frameCount.load(std::memory_order_relaxed);
+	this->frameStartArray[count % MAX_FRAMES].store(GetTimeNS(), std::memory_order_relaxed);
+	this->frameCount.store(count + 1, std::memory_order_release);
+}
+
+uint64_t Profiler::GetFrameStartTime(uint32_t numFrames) const
+{
+	uint64_t count = this->frameCount.load(std::memory_order_acquire);
+	uint64_t numKnownFrames = IMZADI_MIN(count, uint64_t(MAX_FRAMES));
+	if (numFrames == 0 || numKnownFrames == 0)
+		return 0;
+
+	numFrames = (uint32_t)IMZADI_MIN(uint64_t(numFrames), numKnownFrames);
+	return this->frameStartArray[(count - numFrames) % MAX_FRAMES].load(std::memory_order_relaxed);
+}
+
+const ProfileZone* Profiler::InternZone(const std::string& name)
+{
+	std::lock_guard guard(this->mutex);
+
+	auto iter = this->internedZoneMap.find(name);
+	if (iter != this->internedZoneMap.end())
+		return iter->second;
+
+	// The map's nodes never move, so its copy of the name can be used by the zone.
+	iter = this->internedZoneMap.insert(std::pair<std::string, ProfileZone*>(name, nullptr)).first;
+	iter->second = new ProfileZone{ iter->first.c_str() };
+	return iter->second;
+}
+
+std::string Profiler::PrintThreadStats()
+{
+	ProfileThreadBuffer* buffer = GetThreadBuffer();
+
+	std::vector<ProfileSample> sampleArray;
+	buffer->Read(sampleArray, buffer->statsStartIndex);
+	return PrintStats(sampleArray);
+}
+
+void Profiler::ResetThreadStats()
+{
+	ProfileThreadBuffer* buffer = GetThreadBuffer();
+	buffer->statsStartIndex = buffer->GetWriteIndex();
+}
+
+std::string Profiler::PrintFrameStats(uint32_t numFrames)
+{
+	uint64_t frameStartTimeNS = this->GetFrameStartTime(numFrames);
+
+	std::lock_guard guard(this->mutex);
+
+	std::string stats;
+	for (ProfileThreadBuffer* buffer : this->threadBufferArray)
 	{
-		Block block;
-		block.name = blockName;
-		block.hitCount = 1;
-		block.totalTimeMS = timeSpentMS;
-		this->blockMap.insert(std::pair<std::string, Block>(blockName, block));
+		std::vector<ProfileSample> sampleArray;
+		buffer->Read(sampleArray);
+		std::erase_if(sampleArray, [frameStartTimeNS](const ProfileSample& sample) { return sample.startTimeNS < frameStartTimeNS; });
+		if (sampleArray.size() == 0)
+			continue;
+
+		stats += std::format("Thread: {}\n", buffer->name.c_str());
+		stats += PrintStats(sampleArray);
 	}
+
+	return stats;
 }
 
-void ProfileData::Reset()
+void Profiler::AccumulateZoneTimes(ProfileCursor& cursor, std::unordered_map<std::string, double>& zoneTimeMap)
 {
-	this->blockMap.clear();
+	std::lock_guard guard(this->mutex);
+
+	std::vector<ProfileSample> sampleArray;
+	for (ProfileThreadBuffer* buffer : this->threadBufferArray)
+	{
+		sampleArray.clear();
+		uint64_t& readIndex = cursor[buffer];
+		readIndex = buffer->Read(sampleArray, readIndex);
+
+		for (const ProfileSample& sample : sampleArray)
+			zoneTimeMap[sample.zone->name] += double(sample.endTimeNS - sample.startTimeNS) / 1e6;
+	}
 }
 
-std::string ProfileData::PrintStats() const
+/*static*/ std::string Profiler::PrintStats(const std::vector<ProfileSample>& sampleArray)
 {
+	struct Block
+	{
+		const char* name;
+		uint32_t hitCount;
+		double totalTimeMS;
+		double selfTimeMS;
+	};
+
+	std::unordered_map<const ProfileZone*, Block> blockMap;
+
+	// Samples are written as zones are exited, so all of a zone's children come just before it.
+	// That lets us work out how much of a zone's time wasn't spent in its children.
+	std::vector<uint64_t> childTimeArray;
+	for (const ProfileSample& sample : sampleArray)
+	{
+		if (childTimeArray.size() < sample.depth + 2)
+			childTimeArray.resize(sample.depth + 2, 0);
+
+		uint64_t timeNS = sample.endTimeNS - sample.startTimeNS;
+		uint64_t childTimeNS = IMZADI_MIN(childTimeArray[sample.depth + 1], timeNS);
+		childTimeArray[sample.depth + 1] = 0;
+		childTimeArray[sample.depth] += timeNS;
+
+		auto iter = blockMap.find(sample.zone);
+		if (iter == blockMap.end())
+			iter = blockMap.insert(std::pair<const ProfileZone*, Block>(sample.zone, { sample.zone->name, 0, 0.0, 0.0 })).first;
+
+		Block& block = iter->second;
+		block.hitCount++;
+		block.totalTimeMS += double(timeNS) / 1e6;
+		block.selfTimeMS += double(timeNS - childTimeNS) / 1e6;
+	}
+
 	std::vector<Block> blockArray;
-	for (auto pair : this->blockMap)
+	for (auto& pair : blockMap)
 		blockArray.push_back(pair.second);
 
 	std::sort(blockArray.begin(), blockArray.end(), [](const Block& blockA, const Block& blockB) -> bool
@@ -67,10 +294,80 @@ std::string ProfileData::PrintStats() const
 	for (const Block& block : blockArray)
 	{
 		stats += "---------------------------------\n";
-		stats += std::format("Name: {}\n", block.name.c_str());
+		stats += std::format("Name: {}\n", block.name);
 		stats += std::format("Hit Count: {}\n", block.hitCount);
 		stats += std::format("Total Time MS: {}\n", block.totalTimeMS);
+		stats += std::format("Self Time MS: {}\n", block.selfTimeMS);
 	}
 
 	return stats;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& traceFilePath, uint32_t numFrames)
+{
+	std::ofstream fileStream(traceFilePath, std::ios::out);
+	if (!fileStream.is_open())
+	{
+		IMZADI_LOG_ERROR(std::format("Failed to open file {} for writing.", traceFilePath.c_str()));
+		return false;
+	}
+
+	auto escape = [](const char* name) -> std::string
+	{
+		std::string escapedName;
+		for (const char* ch = name; *ch != '\0'; ch++)
+		{
+			if (*ch == '"' || *ch == '\\')
+				escapedName += '\\';
+			escapedName += *ch;
+		}
+		return escapedName;
+	};
+
+	// Trace timestamps are in microseconds.
+	auto timeUS = [this](uint64_t timeNS) -> double
+	{
+		return double(timeNS - this->baseTimeNS) / 1000.0;
+	};
+
+	uint64_t frameStartTimeNS = IMZADI_MAX(this->GetFrameStartTime(numFrames), this->baseTimeNS);
+
+	fileStream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	fileStream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"Imzadi\"}}";
+
+	{
+		std::lock_guard guard(this->mutex);
+
+		for (ProfileThreadBuffer* buffer : this->threadBufferArray)
+		{
+			uint32_t threadID = buffer->GetThreadID();
+			fileStream << std::format(",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}", threadID, escape(buffer->name.c_str()));
+
+			std::vector<ProfileSample> sampleArray;
+			buffer->Read(sampleArray);
+
+			for (const ProfileSample& sample : sampleArray)
+			{
+				if (sample.startTimeNS < frameStartTimeNS)
+					continue;
+
+				fileStream << std::format(",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+					escape(sample.zone->name), threadID, timeUS(sample.startTimeNS), double(sample.endTimeNS - sample.startTimeNS) / 1000.0);
+			}
+		}
+	}
+
+	uint64_t count = this->frameCount.load(std::memory_order_acquire);
+	uint64_t numKnownFrames = IMZADI_MIN(count, uint64_t(MAX_FRAMES));
+	for (uint64_t i = count - numKnownFrames; i < count; i++)
+	{
+		uint64_t frameTimeNS = this->frameStartArray[i % MAX_FRAMES].load(std::memory_order_relaxed);
+		if (frameTimeNS >= frameStartTimeNS)
+			fileStream << std::format(",\n{{\"name\":\"Frame {}\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":{:.3f}}}", i, timeUS(frameTimeNS));
+	}
+
+	fileStream << "\n]}\n";
+	fileStream.close();
+
+	return true;
 }
\ No newline at end of file
@@ -1,57 +1,232 @@
 #pragma once
 
 #include "Defines.h"
-#include "Clock.h"
 #include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
 #include <unordered_map>
 
+#define IMZADI_PROFILE_CONCAT_INNER(a, b)	a##b
+#define IMZADI_PROFILE_CONCAT(a, b)			IMZADI_PROFILE_CONCAT_INNER(a, b)
+
+#if defined IMZADI_PROFILING_ENABLED
+#	define IMZADI_PROFILE(name)				static const Imzadi::ProfileZone IMZADI_PROFILE_CONCAT(profileZone, __LINE__) = { name }; \
+											Imzadi::ProfileScope IMZADI_PROFILE_CONCAT(profileScope, __LINE__)(&IMZADI_PROFILE_CONCAT(profileZone, __LINE__))
+#	define IMZADI_PROFILE_ZONE(zone)		Imzadi::ProfileScope IMZADI_PROFILE_CONCAT(profileScope, __LINE__)(zone)
+#	define IMZADI_PROFILE_THREAD(name)		Imzadi::Profiler::Get()->SetThreadName(name)
+#	define IMZADI_PROFILE_FRAME()			Imzadi::Profiler::Get()->MarkFrame()
+#else
+#	define IMZADI_PROFILE(name)
+#	define IMZADI_PROFILE_ZONE(zone)
+#	define IMZADI_PROFILE_THREAD(name)
+#	define IMZADI_PROFILE_FRAME()
+#endif
+
 namespace Imzadi
 {
-	class ProfileData;
+	class ProfileThreadBuffer;
+
+	/**
+	 * This remembers how far into each thread's ring we've read.  See @ref Profiler::AccumulateZoneTimes.
+	 */
+	typedef std::unordered_map<const ProfileThreadBuffer*, uint64_t> ProfileCursor;
 
 	/**
-	 * These can be used to measure the time spent in a scope block.
-	 * Macros should be used rather than this class directly so that
-	 * all instances of it can compile out of a release build.
-	 * 
-	 * Note that we don't handle recursive blocks here.
+	 * A zone is a named region of code that we time.  The IMZADI_PROFILE macro makes one of these
+	 * statically for each place it's used, so a zone's name is never copied or looked up
+	 * when the zone is hit; the zone is known just by its address.
 	 */
-	class IMZADI_API ProfileBlock
+	struct ProfileZone
+	{
+		const char* name;
+	};
+
+	/**
+	 * These time a scope block and record the result in the ring buffer of the calling thread.
+	 * Macros should be used rather than this class directly so that all instances of it can
+	 * compile out of a build, if desired.  Scopes may be nested (and may recurse).
+	 */
+	class IMZADI_API ProfileScope
 	{
 	public:
-		ProfileBlock(ProfileData* data, const std::string& name);
-		virtual ~ProfileBlock();
+		ProfileScope(const ProfileZone* zone);
+		~ProfileScope();
 
 	private:
-		Clock clock;
-		ProfileData* data;
-		std::string name;
+		ProfileThreadBuffer* buffer;
+		const ProfileZone* zone;
+		uint64_t startTimeNS;
+		uint32_t depth;
+	};
+
+	/**
+	 * This is what gets recorded each time a zone is exited.
+	 */
+	struct ProfileSample
+	{
+		const ProfileZone* zone;
+		uint64_t startTimeNS;
+		uint64_t endTimeNS;
+		uint32_t depth;
 	};
 
 	/**
-	 * An instance of this class can collect stats from a bunch of profile
-	 * blocks sprinkled throughout the code.  Note that it is not thread-safe.
-	 * Each thread should just use their own instance of this class.
+	 * Each thread that hits a zone gets one of these.  Only the owning thread ever writes to it,
+	 * and it does so without locking.  The newest samples overwrite the oldest ones once the ring
+	 * is full.  Other threads may read the ring at any time; a sample they read while the owning
+	 * thread was overwriting it is detected and thrown away, much like a sequence lock.
 	 */
-	class IMZADI_API ProfileData
+	class IMZADI_API ProfileThreadBuffer
 	{
 	public:
-		ProfileData();
-		virtual ~ProfileData();
+		ProfileThreadBuffer(uint32_t threadID);
+		virtual ~ProfileThreadBuffer();
+
+		/**
+		 * Record the given sample.  This must only be called by the owning thread.
+		 */
+		void Write(const ProfileZone* zone, uint64_t startTimeNS, uint64_t endTimeNS, uint32_t depth);
+
+		/**
+		 * Copy out all samples still in the ring that were written at or after the given sample index.
+		 * This can be called from any thread.
+		 *
+		 * @return The index just past the last sample looked at is returned, so that the next read can pick up from there.
+		 */
+		uint64_t Read(std::vector<ProfileSample>& sampleArray, uint64_t sinceIndex = 0) const;
 
-		void AccumulateInfo(const std::string& blockName, double timeSpentMS);
-		void Reset();
-		std::string PrintStats() const;
+		uint32_t GetThreadID() const { return this->threadID; }
+		uint64_t GetWriteIndex() const { return this->writeIndex.load(std::memory_order_acquire); }
+
+		/**
+		 * This must be a power of two.
+		 */
+		static const uint32_t SAMPLE_CAPACITY = 1 << 16;
+
+	public:
+		uint32_t depth;				///< This is how many zones the owning thread is in right now.
+		uint64_t statsStartIndex;	///< Thread stats are gathered from this sample index onward.
+		std::string name;			///< This is guarded by the profiler's mutex.
 
 	private:
-		struct Block
+
+		/**
+		 * The fields are atomic only so that a reader can race the owning thread without
+		 * undefined behavior; the owning thread doesn't pay anything for that on x64.
+		 */
+		struct Slot
 		{
-			std::string name;
-			uint32_t hitCount;
-			double totalTimeMS;
+			std::atomic<const ProfileZone*> zone;
+			std::atomic<uint64_t> startTimeNS;
+			std::atomic<uint64_t> endTimeNS;
+			std::atomic<uint32_t> depth;
 		};
 
-		typedef std::unordered_map<std::string, Block> BlockMap;
-		BlockMap blockMap;
+		uint32_t threadID;
+		Slot* slotArray;
+		std::atomic<uint64_t> writeStartIndex;
+		std::atomic<uint64_t> writeIndex;
+	};
+
+	/**
+	 * This collects samples from all threads that hit profile zones, and can either
+	 * summarize them as text or export them in the Chrome trace event format, which
+	 * can be viewed with chrome://tracing or Perfetto.  It's meant to be cheap enough
+	 * to leave on all the time: hitting a zone costs two clock reads and one write into
+	 * a thread-local ring, and nothing is ever locked except when a thread hits its
+	 * first zone, or when the samples are being gathered.
+	 */
+	class IMZADI_API Profiler
+	{
+	public:
+		Profiler();
+		virtual ~Profiler();
+
+		/**
+		 * Get a pointer to the profiler singleton.
+		 */
+		static Profiler* Get();
+
+		/**
+		 * Return the current time, in nanoseconds, on the clock used by the profiler.
+		 */
+		static uint64_t GetTimeNS();
+
+		/**
+		 * Return the ring buffer for the calling thread, making it if necessary.
+		 */
+		static ProfileThreadBuffer* GetThreadBuffer();
+
+		/**
+		 * Turn recording of samples on or off.  It's on by default.
+		 */
+		void SetEnabled(bool enabled) { this->enabled.store(enabled, std::memory_order_relaxed); }
+		bool IsEnabled() const { return this->enabled.load(std::memory_order_relaxed); }
+
+		/**
+		 * Give the calling thread a name to show in the stats and exported traces.
+		 */
+		void SetThreadName(const std::string& name);
+
+		/**
+		 * This should be called by the main thread at the start of each frame.
+		 */
+		void MarkFrame();
+
+		/**
+		 * Zones known only at run-time (e.g., tasks of a task graph) can get one here.
+		 * A zone is made once per name and lives as long as the profiler does, so this
+		 * should be called once up-front, not each time the zone is hit.
+		 */
+		const ProfileZone* InternZone(const std::string& name);
+
+		/**
+		 * Summarize what the calling thread has recorded since it last reset its stats.
+		 */
+		std::string PrintThreadStats();
+
+		/**
+		 * Start over the stats of the calling thread.
+		 */
+		void ResetThreadStats();
+
+		/**
+		 * Summarize what all threads have recorded over the given number of most recent frames.
+		 */
+		std::string PrintFrameStats(uint32_t numFrames);
+
+		/**
+		 * Add to the given map the time, in milliseconds, spent in each zone (by name) by all threads
+		 * since the last call made with the given cursor, then advance the cursor.  Unlike the
+		 * other methods here, this only looks at new samples, so it can be called every frame.
+		 */
+		void AccumulateZoneTimes(ProfileCursor& cursor, std::unordered_map<std::string, double>& zoneTimeMap);
+
+		/**
+		 * Write what all threads have recorded over the given number of most recent frames
+		 * to the given file in the Chrome trace event (JSON) format.
+		 *
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool ExportChromeTrace(const std::string& traceFilePath, uint32_t numFrames);
+
+		/**
+		 * This is how many frame starts we remember.
+		 */
+		static const uint32_t MAX_FRAMES = 256;
+
+	private:
+		ProfileThreadBuffer* RegisterThread();
+		uint64_t GetFrameStartTime(uint32_t numFrames) const;
+		static std::string PrintStats(const std::vector<ProfileSample>& sampleArray);
+
+		std::atomic<bool> enabled;
+		uint64_t baseTimeNS;
+		std::mutex mutex;
+		std::vector<ProfileThreadBuffer*> threadBufferArray;
+		std::unordered_map<std::string, ProfileZone*> internedZoneMap;
+		std::atomic<uint64_t> frameStartArray[MAX_FRAMES];
+		std::atomic<uint64_t> frameCount;
 	};
 }
\ No newline at end of file
@@ -2,71 +2,247 @@
 
 using namespace Imzadi;
 
-std::atomic<uint32_t> ReferenceCounted::nextHandle(1);
-
 //---------------------------- ReferenceCounted ----------------------------
 
 ReferenceCounted::ReferenceCounted()
 {
 	this->refCount = 0;
-	this->handle = nextHandle++;
-	HandleManager::Get()->Register(this);	// TODO: May need to optimize this to be O(1).
+	this->refCountPolicy = RefCountPolicy::THREAD_SAFE;
+	this->handle = HandleManager::Get()->Register(this);
 }
 
-/*virtual*/ ReferenceCounted::~ReferenceCounted()
+ReferenceCounted::ReferenceCounted(RefCountPolicy refCountPolicy)
 {
-	HandleManager::Get()->Unregister(this);	// TODO: May need to optimize this to be O(1).
+	this->refCount = 0;
+	this->refCountPolicy = refCountPolicy;
+	this->handle = HandleManager::Get()->Register(this);
 }
 
-void ReferenceCounted::IncRef() const
+/*virtual*/ ReferenceCounted::~ReferenceCounted()
 {
-	this->refCount++;
+	HandleManager::Get()->Unregister(this->handle);
 }
 
-void ReferenceCounted::DecRef() const
+bool ReferenceCounted::TryIncRef() const
 {
-	if (this->refCount > 0)
-	{
-		this->refCount--;
+	uint32_t count = this->refCount.load();
+	while (count > 0)
+		if (this->refCount.compare_exchange_weak(count, count + 1))
+			return true;
 
-		if (this->refCount == 0)
-			delete this;
-	}
+	return false;
 }
 
 //---------------------------- HandleManager ----------------------------
 
 HandleManager::HandleManager()
 {
+	for (uint32_t i = 0; i < MAX_CHUNKS; i++)
+		this->chunkArray[i] = nullptr;
+
+	// Index zero is never handed out so that a valid handle is always non-zero.
+	this->nextUnusedIndex = 1;
+	this->numFreeBatches = 0;
 }
 
 /*virtual*/ HandleManager::~HandleManager()
 {
+	for (uint32_t i = 0; i < MAX_CHUNKS; i++)
+		delete[] this->chunkArray[i].load();
+}
+
+HandleManager::FreeList::FreeList()
+{
+}
+
+HandleManager::FreeList::~FreeList()
+{
+	// The thread is going away, so give its free slots to the other threads.
+	if (this->indexQueue.size() > 0)
+	{
+		HandleManager* manager = HandleManager::Get();
+		std::lock_guard guard(manager->freeBatchMutex);
+		manager->freeBatchArray.push_back(std::vector<uint32_t>(this->indexQueue.begin(), this->indexQueue.end()));
+		manager->numFreeBatches.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+/*static*/ HandleManager::FreeList* HandleManager::GetThreadFreeList()
+{
+	static thread_local FreeList freeList;
+	return &freeList;
 }
 
-void HandleManager::Register(ReferenceCounted* refCounted)
+HandleManager::Slot* HandleManager::GetSlot(uint32_t index)
 {
-	std::lock_guard guard(this->mutex);
-	this->objectMap.insert(std::pair<uint32_t, ReferenceCounted*>(refCounted->GetHandle(), refCounted));
+	Slot* chunk = this->chunkArray[index >> CHUNK_BITS].load(std::memory_order_acquire);
+	if (!chunk)
+		return nullptr;
+
+	return &chunk[index & (CHUNK_SIZE - 1)];
 }
 
-void HandleManager::Unregister(ReferenceCounted* refCounted)
+uint32_t HandleManager::AllocateIndex()
 {
-	std::lock_guard guard(this->mutex);
-	this->objectMap.erase(refCounted->GetHandle());
+	FreeList* freeList = GetThreadFreeList();
+
+	// Only look at what other threads gave up when we're out of free slots of our own, and only
+	// take the lock if there's something there, so that allocating normally takes no lock at all.
+	if (freeList->indexQueue.size() == 0 && this->numFreeBatches.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard guard(this->freeBatchMutex);
+		if (this->freeBatchArray.size() > 0)
+		{
+			const std::vector<uint32_t>& batch = this->freeBatchArray.front();
+			freeList->indexQueue.insert(freeList->indexQueue.end(), batch.begin(), batch.end());
+			this->freeBatchArray.erase(this->freeBatchArray.begin());
+			this->numFreeBatches.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	if (freeList->indexQueue.size() > 0)
+	{
+		uint32_t index = freeList->indexQueue.front();
+		freeList->indexQueue.pop_front();
+		return index;
+	}
+
+	uint32_t index = 0;
+	if (this->nextUnusedIndex.load() <= INDEX_MASK)
+		index = this->nextUnusedIndex.fetch_add(1);
+
+	if (index == 0 || index > INDEX_MASK)
+	{
+		// As a last resort, bring back a retired slot.  This is the only way a stale handle could ever
+		// alias a new object, and it takes some four billion registrations to get here.
+		std::lock_guard guard(this->freeBatchMutex);
+		if (this->retiredIndexArray.size() == 0)
+			return 0;
+
+		index = this->retiredIndexArray.back();
+		this->retiredIndexArray.pop_back();
+		return index;
+	}
+
+	// The first thread to reach a new chunk allocates it.  If two threads race to do so, the loser just throws its chunk away.
+	uint32_t chunkIndex = index >> CHUNK_BITS;
+	if (!this->chunkArray[chunkIndex].load(std::memory_order_acquire))
+	{
+		Slot* chunk = new Slot[CHUNK_SIZE];
+		for (uint32_t i = 0; i < CHUNK_SIZE; i++)
+		{
+			chunk[i].lock.clear();
+			chunk[i].generation = 1;
+			chunk[i].refCounted = nullptr;
+		}
+
+		Slot* expectedChunk = nullptr;
+		if (!this->chunkArray[chunkIndex].compare_exchange_strong(expectedChunk, chunk, std::memory_order_acq_rel))
+			delete[] chunk;
+	}
+
+	return index;
+}
+
+void HandleManager::FreeIndex(uint32_t index)
+{
+	FreeList* freeList = GetThreadFreeList();
+	freeList->indexQueue.push_back(index);
+
+	// Threads that mostly destroy objects made by other threads would otherwise hoard free slots.
+	// The ones given away are the oldest, those that are next in line to be reused anyway.
+	if (freeList->indexQueue.size() >= 2 * FREE_BATCH_SIZE)
+	{
+		std::vector<uint32_t> batch(freeList->indexQueue.begin(), freeList->indexQueue.begin() + FREE_BATCH_SIZE);
+		freeList->indexQueue.erase(freeList->indexQueue.begin(), freeList->indexQueue.begin() + FREE_BATCH_SIZE);
+
+		std::lock_guard guard(this->freeBatchMutex);
+		this->freeBatchArray.push_back(std::move(batch));
+		this->numFreeBatches.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+uint32_t HandleManager::Register(ReferenceCounted* refCounted)
+{
+	uint32_t index = this->AllocateIndex();
+	if (index == 0)
+		return 0;
+
+	Slot* slot = this->GetSlot(index);
+
+	while (slot->lock.test_and_set(std::memory_order_acquire))
+	{
+	}
+
+	slot->refCounted = refCounted;
+	uint32_t generation = slot->generation;
+
+	slot->lock.clear(std::memory_order_release);
+
+	return (generation << INDEX_BITS) | index;
+}
+
+void HandleManager::Unregister(uint32_t handle)
+{
+	uint32_t index = handle & INDEX_MASK;
+	if (index == 0)
+		return;
+
+	Slot* slot = this->GetSlot(index);
+
+	while (slot->lock.test_and_set(std::memory_order_acquire))
+	{
+	}
+
+	slot->refCounted = nullptr;
+
+	// A slot whose generation would wrap around is retired rather than reused, so that a stale
+	// handle to it can never be mistaken for a handle to a later occupant.
+	slot->generation = (slot->generation + 1) & GENERATION_MASK;
+	bool retired = (slot->generation == 0);
+	if (retired)
+		slot->generation = 1;
+
+	slot->lock.clear(std::memory_order_release);
+
+	if (!retired)
+		this->FreeIndex(index);
+	else
+	{
+		std::lock_guard guard(this->freeBatchMutex);
+		this->retiredIndexArray.push_back(index);
+	}
 }
 
 bool HandleManager::GetObjectFromHandle(uint32_t handle, Reference<ReferenceCounted>& ref)
 {
-	std::lock_guard guard(this->mutex);
-	ObjectMap::iterator iter = this->objectMap.find(handle);
-	if (iter != this->objectMap.end() && iter->second->GetRefCount() > 0)
+	uint32_t index = handle & INDEX_MASK;
+	if (index == 0 || index >= this->nextUnusedIndex.load(std::memory_order_relaxed))
+		return false;
+
+	Slot* slot = this->GetSlot(index);
+	if (!slot)
+		return false;
+
+	// The object can't finish dying while we hold the lock, since it has to unregister
+	// first, so it's safe to look at its count.  If the count is zero, it's already dying.
+	ReferenceCounted* refCounted = nullptr;
+
+	while (slot->lock.test_and_set(std::memory_order_acquire))
 	{
-		ref.Set(iter->second);
-		return true;
 	}
 
-	return false;
+	if (slot->generation == (handle >> INDEX_BITS) && slot->refCounted && slot->refCounted->TryIncRef())
+		refCounted = slot->refCounted;
+
+	slot->lock.clear(std::memory_order_release);
+
+	if (!refCounted)
+		return false;
+
+	ref.Set(refCounted);
+	refCounted->DecRef();
+	return true;
 }
 
 /*static*/ HandleManager* HandleManager::Get()
@@ -4,6 +4,9 @@
 #include <stdint.h>
 #include <assert.h>
 #include <unordered_map>
+#include <vector>
+#include <deque>
+#include <atomic>
 #include <mutex>
 
 namespace Imzadi
@@ -28,31 +31,97 @@ namespace Imzadi
 	 * I don't recommend creating and destroying reference-counted objects every frame,
 	 * if you can help it.  There is some overhead in the construction and destruction
 	 * of these objects that could add up to a significant performance hit.
+	 *
+	 * Objects that are known to never be referenced from more than one thread can opt
+	 * out of the atomic read-modify-write operations on their count.  See RefCountPolicy.
 	 */
 	class IMZADI_API ReferenceCounted
 	{
 	public:
+		enum RefCountPolicy
+		{
+			/**
+			 * The count is updated atomically.  This is the default, and is always safe.
+			 */
+			THREAD_SAFE,
+
+			/**
+			 * The count is updated with plain loads and stores, which is cheaper, but only
+			 * safe if references to the object are only ever taken and dropped on one thread.
+			 */
+			SINGLE_THREADED
+		};
+
 		/**
 		 * Construct a new reference-counted object with a ref-count of zero.
 		 * Add this object to the set of all referenced objects.
 		 */
 		ReferenceCounted();
 
+		/**
+		 * Construct a new reference-counted object with the given policy for its ref-count.
+		 */
+		ReferenceCounted(RefCountPolicy refCountPolicy);
+
 		/**
 		 * Remove this object from the set of all referenced objects.
 		 */
 		virtual ~ReferenceCounted();
 
 		/**
-		 * Increment our reference count.
+		 * Increment our reference count.  Note that nothing is done with the
+		 * new count, so we don't need to order this with any other memory access.
+		 */
+		void IncRef() const
+		{
+			if (this->refCountPolicy == RefCountPolicy::SINGLE_THREADED)
+				this->refCount.store(this->refCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			else
+				this->refCount.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/**
+		 * Increment our reference count, but only if it isn't zero.  This is used to
+		 * safely take a reference to an object that may be in the middle of dying.
+		 *
+		 * @return True is returned if the count was incremented; false, otherwise.
 		 */
-		void IncRef() const;
+		bool TryIncRef() const;
 
 		/**
 		 * Decrement our reference count.  Warning: if the count goes from 1 to 0,
 		 * then we delete the this-pointer before returning from the call!
 		 */
-		void DecRef() const;
+		void DecRef() const
+		{
+			uint32_t count = this->refCount.load(std::memory_order_relaxed);
+
+			if (this->refCountPolicy == RefCountPolicy::SINGLE_THREADED)
+			{
+				if (count > 0)
+				{
+					this->refCount.store(count - 1, std::memory_order_relaxed);
+					if (count == 1)
+						delete this;
+				}
+
+				return;
+			}
+
+			// Only the thread that takes the count from one to zero may delete the object.
+			// The release makes our writes to the object visible to whichever thread that is,
+			// and the acquire makes the writes of all the other releasers visible to us.
+			while (count > 0)
+			{
+				if (this->refCount.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+				{
+					if (count == 1)
+						delete this;
+
+					break;
+				}
+			}
+		}
 
 		/**
 		 * Return a handle that can be later used to get a pointer to this object
@@ -66,10 +135,15 @@ namespace Imzadi
 		 */
 		uint32_t GetRefCount() const { return this->refCount; }
 
+		/**
+		 * Return how the ref-count of this object is maintained.
+		 */
+		RefCountPolicy GetRefCountPolicy() const { return this->refCountPolicy; }
+
 	private:
 		mutable std::atomic<uint32_t> refCount;		///< This is used to keep track of how many Reference class instances are pointing to this object.
 		uint32_t handle;							///< This is used to track this object without holding onto a reference to the object.
-		static std::atomic<uint32_t> nextHandle;	///< A new object is assigned this handle.
+		RefCountPolicy refCountPolicy;				///< This says whether or not the ref-count needs to be updated atomically.
 	};
 
 	/**
@@ -95,6 +169,16 @@ namespace Imzadi
 			this->Set(ref.refCounted);
 		}
 
+		/**
+		 * Moving a reference just hands over the pointer, so the ref-count isn't touched.
+		 * Since this can't throw, STL containers will also move (not copy) our references when they grow.
+		 */
+		Reference(Reference&& ref) noexcept
+		{
+			this->refCounted = ref.refCounted;
+			ref.refCounted = nullptr;
+		}
+
 		Reference(ReferenceCounted* refCounted)
 		{
 			this->refCounted = nullptr;
@@ -111,6 +195,19 @@ namespace Imzadi
 			this->Set(ref.refCounted);
 		}
 
+		void operator=(Reference&& ref) noexcept
+		{
+			if (this != &ref)
+			{
+				ReferenceCounted* oldRefCounted = this->refCounted;
+				this->refCounted = ref.refCounted;
+				ref.refCounted = nullptr;
+
+				if (oldRefCounted)
+					oldRefCounted->DecRef();
+			}
+		}
+
 		T* operator->()
 		{
 			return this->Get();
@@ -182,8 +279,76 @@ namespace Imzadi
 		ReferenceCounted* refCounted;
 	};
 
+	/**
+	 * This is a non-owning view of a reference-counted object.  It's meant for hot loops
+	 * and short-lived arrays where someone else is known to be holding a reference to the
+	 * object for as long as the view is used, so there's no need to touch the ref-count.
+	 * It behaves like a C-pointer, but says, in the type, that it came from a reference
+	 * and must not outlive it.  Don't store one of these anywhere that outlives the frame.
+	 */
+	template<typename T>
+	class BorrowedReference
+	{
+	public:
+		BorrowedReference()
+		{
+			this->object = nullptr;
+		}
+
+		BorrowedReference(const Reference<T>& ref)
+		{
+			this->object = const_cast<T*>(ref.Get());
+		}
+
+		BorrowedReference(T* object)
+		{
+			this->object = object;
+		}
+
+		T* operator->() const
+		{
+			return this->object;
+		}
+
+		operator T* () const
+		{
+			return this->object;
+		}
+
+		T* Get() const
+		{
+			return this->object;
+		}
+
+		/**
+		 * Take a real reference to the object, e.g., if it needs to be kept beyond the frame.
+		 */
+		Reference<T> Own() const
+		{
+			return Reference<T>(this->object);
+		}
+
+	private:
+		T* object;
+	};
+
 	/**
 	 * This class is used to book-keep reference-countables without holding references to them.
+	 *
+	 * Handles are slots in a table.  The low bits of a handle are the index of the slot,
+	 * and the high bits are the generation of the slot, which is bumped each time the slot
+	 * is freed, so that a stale handle to a slot that has since been reused can be told
+	 * apart from a handle to the slot's current occupant.  Looking up a handle is just an
+	 * array index and a generation check.  Each thread keeps its own queue of free slots,
+	 * so registering and unregistering objects doesn't contend on any shared lock; only
+	 * when a thread has too many (or too few) free slots of its own does it trade a batch
+	 * of them with the other threads.
+	 *
+	 * The generation has only so many bits, so a slot can't be reused forever without
+	 * a stale handle to it eventually finding an unrelated object.  Free slots are reused
+	 * first-in first-out, which spreads the wear over all of them, and a slot whose generation
+	 * would wrap around is retired instead of freed.  Retired slots come back only once the
+	 * table is otherwise full, which takes billions of registrations.
 	 */
 	class IMZADI_API HandleManager
 	{
@@ -191,8 +356,17 @@ namespace Imzadi
 		HandleManager();
 		virtual ~HandleManager();
 
-		void Register(ReferenceCounted* refCounted);
-		void Unregister(ReferenceCounted* refCounted);
+		/**
+		 * Give the given object a slot in the table.
+		 *
+		 * @return The handle of the object is returned.  This is zero if the table is full, in which case the object isn't tracked.
+		 */
+		uint32_t Register(ReferenceCounted* refCounted);
+
+		/**
+		 * Free the slot of the given handle.  Any outstanding copies of the handle become invalid.
+		 */
+		void Unregister(uint32_t handle);
 
 		/**
 		 * Try to dereference the given handle into a reference-counted object.
@@ -207,9 +381,50 @@ namespace Imzadi
 
 		static HandleManager* Get();
 
+		static const uint32_t INDEX_BITS = 20;
+		static const uint32_t INDEX_MASK = (1 << INDEX_BITS) - 1;
+		static const uint32_t GENERATION_BITS = 32 - INDEX_BITS;
+		static const uint32_t GENERATION_MASK = (1 << GENERATION_BITS) - 1;
+		static const uint32_t CHUNK_BITS = 10;
+		static const uint32_t CHUNK_SIZE = 1 << CHUNK_BITS;
+		static const uint32_t MAX_CHUNKS = (INDEX_MASK + 1) / CHUNK_SIZE;
+		static const uint32_t FREE_BATCH_SIZE = 128;
+
 	private:
-		typedef std::unordered_map<uint32_t, ReferenceCounted*> ObjectMap;
-		ObjectMap objectMap;
-		std::mutex mutex;
+
+		/**
+		 * The lock here only guards against a look-up of a stale handle racing the
+		 * slot's reuse, or the destruction of its object, so it's almost never contended.
+		 */
+		struct Slot
+		{
+			std::atomic_flag lock;
+			uint32_t generation;
+			ReferenceCounted* refCounted;
+		};
+
+		/**
+		 * This is a thread's own cache of free slot indices, oldest first.
+		 */
+		struct FreeList
+		{
+			FreeList();
+			~FreeList();
+
+			std::deque<uint32_t> indexQueue;
+		};
+
+		Slot* GetSlot(uint32_t index);
+		uint32_t AllocateIndex();
+		void FreeIndex(uint32_t index);
+
+		static FreeList* GetThreadFreeList();
+
+		std::atomic<Slot*> chunkArray[MAX_CHUNKS];
+		std::atomic<uint32_t> nextUnusedIndex;
+		std::atomic<uint32_t> numFreeBatches;
+		std::mutex freeBatchMutex;
+		std::vector<std::vector<uint32_t>> freeBatchArray;
+		std::vector<uint32_t> retiredIndexArray;
 	};
 }
\ No newline at end of file
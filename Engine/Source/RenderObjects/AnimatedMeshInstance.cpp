@@ -1,10 +1,15 @@
 #include "AnimatedMeshInstance.h"
 #include "Assets/SkinnedRenderMesh.h"
 #include "Assets/Skeleton.h"
+#include "Camera.h"
+#include "Game.h"
+#include "Profile.h"
 
 using namespace Imzadi;
 
 bool AnimatedMeshInstance::renderSkeletons = false;
+AnimatedMeshInstance::LODPolicy AnimatedMeshInstance::lodPolicy{ true, true, 80.0, 160.0, 120.0, 3, true };
+AnimatedMeshInstance::LODStats AnimatedMeshInstance::lodStats{ 0, 0, 0 };
 
 /*static*/ void AnimatedMeshInstance::SetRenderSkeletons(bool render)
 {
@@ -16,21 +21,49 @@ bool AnimatedMeshInstance::renderSkeletons = false;
 	return renderSkeletons;
 }
 
+/*static*/ void AnimatedMeshInstance::SetLODPolicy(const LODPolicy& policy)
+{
+	lodPolicy = policy;
+}
+
+/*static*/ const AnimatedMeshInstance::LODPolicy& AnimatedMeshInstance::GetLODPolicy()
+{
+	return lodPolicy;
+}
+
+/*static*/ const AnimatedMeshInstance::LODStats& AnimatedMeshInstance::GetLODStats()
+{
+	return lodStats;
+}
+
+/*static*/ void AnimatedMeshInstance::ResetLODStats()
+{
+	lodStats.fullUpdateCount = 0;
+	lodStats.partialUpdateCount = 0;
+	lodStats.skippedUpdateCount = 0;
+}
+
 AnimatedMeshInstance::AnimatedMeshInstance()
 {
 	this->transitionTime = 0.2;
 	this->currentTransitionTime = 0.0;
+	this->boneBinding = nullptr;
 	cursor.i = 0;
 	cursor.timeSeconds = 0.0;
+	this->lodFrameCounter = this->GetHandle();	// This staggers throttled instances across frames.
+	this->lodUpdateInterval = 1;
+	this->meshBlendInterval = 0;
+	this->meshBlendFrame = 0;
+	this->poseStale = true;
 }
 
 /*virtual*/ AnimatedMeshInstance::~AnimatedMeshInstance()
 {
 }
 
-/*virtual*/ void AnimatedMeshInstance::Render(Camera* camera, RenderPass renderPass)
+/*virtual*/ void AnimatedMeshInstance::Draw(Camera* camera, RenderPass renderPass, const DrawPacket& packet, RenderQueue& renderQueue)
 {
-	RenderMeshInstance::Render(camera, renderPass);
+	RenderMeshInstance::Draw(camera, renderPass, packet, renderQueue);
 
 	if (renderPass == RenderPass::MAIN_PASS)
 	{
@@ -48,18 +81,30 @@ bool AnimatedMeshInstance::SetAnimation(const std::string& animationName)
 	if (this->animation.Get() && this->animation->GetName() == animationName)
 		return true;
 
-	this->transitionalKeyFrame.Copy(this->currentKeyFrame);
+	bool wasAnimating = this->currentKeyFrame.GetPoseCount() > 0;
+	this->transitionalKeyFrame.Clear();
 
 	this->animation.Set(this->skinnedMesh->GetAnimation(animationName));
 	if (!this->animation)
 		return false;
 
+	this->boneBinding = this->skinnedMesh->GetAnimationBoneBinding(animationName);
+	if (!this->boneBinding)
+	{
+		this->animation.Set(nullptr);
+		return false;
+	}
+
 	if (!this->animation->MakeCursorFromTime(this->cursor, this->animation->GetStartTime()))
 	{
 		this->animation.Set(nullptr);
+		this->boneBinding = nullptr;
 		return false;
 	}
 
+	if (wasAnimating)
+		this->MakeTransitionalKeyFrame();
+
 	if (this->transitionalKeyFrame.GetPoseCount() > 0)
 	{
 		this->currentTransitionTime = this->animation->GetStartTime() - this->transitionTime;
@@ -69,14 +114,105 @@ bool AnimatedMeshInstance::SetAnimation(const std::string& animationName)
 	return true;
 }
 
+void AnimatedMeshInstance::MakeTransitionalKeyFrame()
+{
+	// We blend from the skeleton's current pose into the new animation, whose key-frames, and so whose bone
+	// binding, may list the bones in a different order than the old animation's did.  The transitional key-frame
+	// must list them in the new order, since it gets interpolated with the new key-frames and posed through the
+	// new binding.  Bones the skeleton doesn't have just hold the new animation's first pose of them.
+	Skeleton* skeleton = this->skinnedMesh->GetSkeleton();
+	const KeyFrame* firstKeyFrame = (this->animation->GetNumKeyFrames() > 0) ? this->animation->GetKeyFrame(0) : nullptr;
+	if (!skeleton || !firstKeyFrame)
+		return;
+
+	size_t numPoses = std::min(firstKeyFrame->GetPoseCount(), this->boneBinding->size());
+	for (size_t i = 0; i < numPoses; i++)
+	{
+		KeyFrame::PoseInfo poseInfo = firstKeyFrame->GetPoseInfo(int(i));
+
+		int boneIndex = (*this->boneBinding)[i];
+		if (boneIndex >= 0 && !poseInfo.childToParent.SetFromTransform(skeleton->GetChildToParent(BoneTransformType::CURRENT_POSE, boneIndex)))
+			poseInfo = firstKeyFrame->GetPoseInfo(int(i));
+
+		if (!this->transitionalKeyFrame.AddPoseInfo(poseInfo))
+		{
+			this->transitionalKeyFrame.Clear();
+			return;
+		}
+	}
+}
+
 void AnimatedMeshInstance::ClearTransition()
 {
 	this->transitionalKeyFrame.Clear();
 	this->currentKeyFrame.Clear();
+
+	if (this->blendGraph)
+		this->blendGraph->Reset();
+}
+
+AnimatedMeshInstance::LODLevel AnimatedMeshInstance::CalcLODLevel(bool& poseNeeded, int& maxBoneDepth)
+{
+	poseNeeded = true;
+	maxBoneDepth = -1;
+	this->lodUpdateInterval = 1;
+
+	if (!lodPolicy.enabled)
+		return LODLevel::FULL_UPDATE;
+
+	// Note that we only consult the main camera here.  An off-screen character
+	// may still cast a shadow into view, but it will just be a stale shadow.
+	Camera* camera = Game::Get()->GetCamera();
+	if (lodPolicy.skipOffScreen && camera && !camera->IsApproximatelyVisible(this))
+	{
+		poseNeeded = false;
+		return LODLevel::SKIPPED_UPDATE;
+	}
+
+	double distanceToCamera = this->GetLastDistanceToCamera();
+
+	uint32_t updateInterval = 1;
+	if (distanceToCamera > lodPolicy.quarterRateDistance)
+		updateInterval = 4;
+	else if (distanceToCamera > lodPolicy.halfRateDistance)
+		updateInterval = 2;
+
+	if (distanceToCamera > lodPolicy.reducedBoneSetDistance)
+		maxBoneDepth = lodPolicy.reducedBoneSetMaxDepth;
+
+	this->lodUpdateInterval = updateInterval;
+
+	// A stale pose (e.g., we just came back on-screen) is always refreshed immediately.
+	this->lodFrameCounter++;
+	if (!this->poseStale && this->lodFrameCounter % updateInterval != 0)
+		poseNeeded = false;
+
+	if (updateInterval == 1 && maxBoneDepth < 0)
+		return LODLevel::FULL_UPDATE;
+
+	return LODLevel::PARTIAL_UPDATE;
+}
+
+/*static*/ void AnimatedMeshInstance::CountLODLevel(LODLevel lodLevel)
+{
+	switch (lodLevel)
+	{
+	case LODLevel::FULL_UPDATE:
+		lodStats.fullUpdateCount++;
+		break;
+	case LODLevel::PARTIAL_UPDATE:
+		lodStats.partialUpdateCount++;
+		break;
+	case LODLevel::SKIPPED_UPDATE:
+		lodStats.skippedUpdateCount++;
+		break;
+	}
 }
 
 bool AnimatedMeshInstance::AdvanceAnimation(double deltaTime, bool canLoop)
 {
+	IMZADI_PROFILE("Animation");
+
 	Skeleton* skeleton = this->skinnedMesh->GetSkeleton();
 	if (!skeleton)
 		return false;
@@ -84,8 +220,16 @@ bool AnimatedMeshInstance::AdvanceAnimation(double deltaTime, bool canLoop)
 	if (!this->animation)
 		return false;
 
+	bool poseNeeded = true;
+	int maxBoneDepth = -1;
+	LODLevel lodLevel = this->CalcLODLevel(poseNeeded, maxBoneDepth);
+	CountLODLevel(lodLevel);
+
+	// Time always advances here, even if we don't pose, so that the key-frame
+	// we sample once we do pose is interpolated at the correct moment.
 	KeyFramePair keyFramePair{};
 	bool animationAdvanced = true;
+	bool interpolated = false;
 
 	if (this->transitionalKeyFrame.GetPoseCount() > 0)
 	{
@@ -95,12 +239,16 @@ bool AnimatedMeshInstance::AdvanceAnimation(double deltaTime, bool canLoop)
 		KeyFramePair transitionPair{ &this->transitionalKeyFrame, keyFramePair.lowerBound };
 
 		if (this->currentTransitionTime < keyFramePair.lowerBound->GetTime())
-			this->currentKeyFrame.Interpolate(transitionPair, this->currentTransitionTime);
+		{
+			if (poseNeeded)
+				interpolated = this->currentKeyFrame.Interpolate(transitionPair, this->currentTransitionTime);
+		}
 		else
 		{
 			this->animation->AdvanceCursor(cursor, this->currentTransitionTime - keyFramePair.lowerBound->GetTime(), true);
 			this->animation->GetKeyFramesFromCursor(this->cursor, keyFramePair);
-			this->currentKeyFrame.Interpolate(keyFramePair, this->cursor.timeSeconds);
+			if (poseNeeded)
+				interpolated = this->currentKeyFrame.Interpolate(keyFramePair, this->cursor.timeSeconds);
 			this->transitionalKeyFrame.Clear();
 		}
 	}
@@ -109,16 +257,99 @@ bool AnimatedMeshInstance::AdvanceAnimation(double deltaTime, bool canLoop)
 		if (!this->animation->AdvanceCursor(cursor, deltaTime, canLoop))
 			animationAdvanced = false;
 
-		this->animation->GetKeyFramesFromCursor(this->cursor, keyFramePair);
-		this->currentKeyFrame.Interpolate(keyFramePair, this->cursor.timeSeconds);
+		if (poseNeeded)
+		{
+			this->animation->GetKeyFramesFromCursor(this->cursor, keyFramePair);
+			interpolated = this->currentKeyFrame.Interpolate(keyFramePair, this->cursor.timeSeconds);
+		}
+	}
+
+	if (!poseNeeded)
+	{
+		if (lodLevel == LODLevel::SKIPPED_UPDATE)
+			this->poseStale = true;
+		else
+			this->BlendThrottledMesh();
+
+		return animationAdvanced;
 	}
 
-	this->currentKeyFrame.PoseSkeleton(skeleton);
+	// A key-frame that failed to interpolate may be empty, cut short, or left over from another
+	// animation, and so not line up with our bone binding.  Better to hold the last pose.
+	if (!interpolated)
+		return animationAdvanced;
+
+	this->currentKeyFrame.PoseSkeleton(skeleton, *this->boneBinding, maxBoneDepth);
 	skeleton->UpdateCachedTransforms(BoneTransformType::CURRENT_POSE);
-	this->skinnedMesh->DeformMesh();
+	this->SkinMesh();
 	return animationAdvanced;
 }
 
+void AnimatedMeshInstance::SkinMesh()
+{
+	// A stale pose isn't worth blending from, since it was never seen.
+	if (lodPolicy.blendThrottledUpdates && this->lodUpdateInterval > 1 && !this->poseStale)
+	{
+		this->skinnedMesh->DeformMeshForBlending();
+		this->meshBlendInterval = this->lodUpdateInterval;
+		this->meshBlendFrame = 0;
+		this->BlendThrottledMesh();
+	}
+	else
+	{
+		this->skinnedMesh->DeformMesh();
+		this->meshBlendInterval = 0;
+		this->meshBlendFrame = 0;
+	}
+
+	this->poseStale = false;
+}
+
+void AnimatedMeshInstance::BlendThrottledMesh()
+{
+	// The blend reaches the new pose on the frame before the next update, so the mesh runs that many frames behind.
+	if (this->meshBlendFrame >= this->meshBlendInterval)
+		return;
+
+	this->meshBlendFrame++;
+	this->skinnedMesh->BlendDeformedMesh(double(this->meshBlendFrame) / double(this->meshBlendInterval));
+}
+
+bool AnimatedMeshInstance::AdvanceBlendGraph(double deltaTime)
+{
+	IMZADI_PROFILE("Animation");
+
+	Skeleton* skeleton = this->skinnedMesh->GetSkeleton();
+	if (!skeleton)
+		return false;
+
+	if (!this->blendGraph)
+		return false;
+
+	bool poseNeeded = true;
+	int maxBoneDepth = -1;
+	LODLevel lodLevel = this->CalcLODLevel(poseNeeded, maxBoneDepth);
+	CountLODLevel(lodLevel);
+
+	// As above, the graph always advances so that its clips end when they should.
+	bool graphAdvanced = this->blendGraph->Advance(deltaTime);
+
+	if (!poseNeeded)
+	{
+		if (lodLevel == LODLevel::SKIPPED_UPDATE)
+			this->poseStale = true;
+		else
+			this->BlendThrottledMesh();
+
+		return graphAdvanced;
+	}
+
+	this->blendGraph->Evaluate(skeleton, maxBoneDepth);
+	skeleton->UpdateCachedTransforms(BoneTransformType::CURRENT_POSE);
+	this->SkinMesh();
+	return graphAdvanced;
+}
+
 bool AnimatedMeshInstance::SetAnimationLocation(double alpha)
 {
 	Skeleton* skeleton = this->skinnedMesh->GetSkeleton();
@@ -132,7 +363,7 @@ bool AnimatedMeshInstance::SetAnimationLocation(double alpha)
 	if (!animation->CalculateKeyFrameFromTime(animationLocationTime, keyFrame))
 		return false;
 
-	keyFrame.PoseSkeleton(skeleton);
+	keyFrame.PoseSkeleton(skeleton, *this->boneBinding);
 	skeleton->UpdateCachedTransforms(Imzadi::BoneTransformType::CURRENT_POSE);
 	this->skinnedMesh->DeformMesh();
 
@@ -151,7 +382,7 @@ bool AnimatedMeshInstance::SetAnimationLocation(int i)
 	if (!keyFrame)
 		return false;
 
-	keyFrame->PoseSkeleton(skeleton);
+	keyFrame->PoseSkeleton(skeleton, *this->boneBinding);
 	skeleton->UpdateCachedTransforms(Imzadi::BoneTransformType::CURRENT_POSE);
 	this->skinnedMesh->DeformMesh();
 
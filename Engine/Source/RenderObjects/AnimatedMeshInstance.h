@@ -3,6 +3,7 @@
 #include "RenderMeshInstance.h"
 #include "Assets/Animation.h"
 #include "Assets/SkinnedRenderMesh.h"
+#include "AnimationBlendGraph.h"
 
 namespace Imzadi
 {
@@ -12,7 +13,7 @@ namespace Imzadi
 		AnimatedMeshInstance();
 		virtual ~AnimatedMeshInstance();
 
-		virtual void Render(Camera* camera, RenderPass renderPass) override;
+		virtual void Draw(Camera* camera, RenderPass renderPass, const DrawPacket& packet, RenderQueue& renderQueue) override;
 
 		void SetTransitionTime(double transitionTime) { this->transitionTime = transitionTime; }
 		double GetTransitionTime() const { return this->transitionTime; }
@@ -22,6 +23,18 @@ namespace Imzadi
 		Animation* GetAnimation() { return this->animation.Get(); }
 		void ClearTransition();
 
+		/**
+		 * Alternative to @ref AdvanceAnimation, advance and evaluate our blend graph,
+		 * if we have one, and then deform the mesh with the result.  The same LOD
+		 * policy applies here as it does for @ref AdvanceAnimation.
+		 * 
+		 * @return False is returned if the graph finished playing something non-looping, or if we have no graph; true, otherwise.
+		 */
+		bool AdvanceBlendGraph(double deltaTime);
+
+		void SetBlendGraph(AnimationBlendGraph* blendGraph) { this->blendGraph.Set(blendGraph); }
+		AnimationBlendGraph* GetBlendGraph() { return this->blendGraph.Get(); }
+
 		/**
 		 * Alternative to @ref AdvanceAnimation, just orient the skeleton and deform the
 		 * mesh according to the given location value.
@@ -48,15 +61,101 @@ namespace Imzadi
 		static void SetRenderSkeletons(bool render);
 		static bool GetRenderSkeletons();
 
+		/**
+		 * These settings control how much work we're willing to skip when
+		 * animating instances that are far away or can't be seen.  Note that
+		 * animation time always advances at full rate so that animations end
+		 * (and loop) when they should; it's only the posing of the skeleton
+		 * and the skinning of the mesh that gets throttled here.
+		 */
+		struct LODPolicy
+		{
+			bool enabled;						///< If false, every instance is fully updated every frame.
+			bool skipOffScreen;					///< If true, instances outside the main camera's frustum are not posed or skinned.
+			double halfRateDistance;			///< Beyond this distance from the camera, we pose and skin every 2nd frame.
+			double quarterRateDistance;			///< Beyond this distance from the camera, we pose and skin every 4th frame.
+			double reducedBoneSetDistance;		///< Beyond this distance from the camera, we only pose bones up to the depth given below.
+			int reducedBoneSetMaxDepth;			///< This is the deepest bone posed for a far-away instance.
+			bool blendThrottledUpdates;			///< If true, a throttled instance blends its mesh from one update to the next over the frames in-between, a little behind, rather than jumping.
+		};
+
+		/**
+		 * These are the number of animation updates of each kind performed
+		 * since the start of the current frame.  A full update poses and skins
+		 * with all bones.  A partial update is one throttled by distance, either
+		 * because only a reduced bone set was posed or because the instance is
+		 * waiting for its turn to update.  A skipped update is one for an
+		 * instance that is off-screen.
+		 */
+		struct LODStats
+		{
+			uint32_t fullUpdateCount;
+			uint32_t partialUpdateCount;
+			uint32_t skippedUpdateCount;
+		};
+
+		static void SetLODPolicy(const LODPolicy& policy);
+		static const LODPolicy& GetLODPolicy();
+		static const LODStats& GetLODStats();
+		static void ResetLODStats();
+
 	private:
+		enum LODLevel
+		{
+			FULL_UPDATE,
+			PARTIAL_UPDATE,
+			SKIPPED_UPDATE
+		};
+
+		/**
+		 * Decide how much work to do for this instance this frame.
+		 * 
+		 * @param[out] poseNeeded This is set to true if the skeleton should be posed and the mesh skinned this frame.
+		 * @param[out] maxBoneDepth This is set to how deep into the skeleton we should pose; -1 for all bones.
+		 * @return The kind of update this frame will be is returned for book-keeping purposes.
+		 */
+		LODLevel CalcLODLevel(bool& poseNeeded, int& maxBoneDepth);
+
+		/**
+		 * Add the given kind of update to this frame's stats.
+		 */
+		static void CountLODLevel(LODLevel lodLevel);
+
+		/**
+		 * Skin the mesh once the skeleton has been posed.  A throttled instance, if the policy
+		 * says so, starts blending towards the new pose here rather than jumping to it.
+		 */
+		void SkinMesh();
+
+		/**
+		 * On the frames between a throttled instance's updates, move its mesh on towards the last pose skinned.
+		 */
+		void BlendThrottledMesh();
+
+		/**
+		 * Make the key-frame we blend from when switching to a new animation out of the skeleton's
+		 * current pose.  This must be called once the new animation and its bone binding are set.
+		 */
+		void MakeTransitionalKeyFrame();
+
 		static bool renderSkeletons;
+		static LODPolicy lodPolicy;
+		static LODStats lodStats;
+
+		uint32_t lodFrameCounter;
+		uint32_t lodUpdateInterval;
+		uint32_t meshBlendInterval;
+		uint32_t meshBlendFrame;
+		bool poseStale;
 
 		double transitionTime;
 		double currentTransitionTime;
 		KeyFrame transitionalKeyFrame;
 		KeyFrame currentKeyFrame;
 		Reference<Animation> animation;
+		const BoneBinding* boneBinding;
 		Animation::Cursor cursor;
 		Reference<SkinnedRenderMesh> skinnedMesh;
+		Reference<AnimationBlendGraph> blendGraph;
 	};
 }
\ No newline at end of file
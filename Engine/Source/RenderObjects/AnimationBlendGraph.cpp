@@ -0,0 +1,579 @@
+#include "AnimationBlendGraph.h"
+#include "Assets/Skeleton.h"
+#include "Math/Interval.h"
+#include "Math/Transform.h"
+#include "Log.h"
+#include <algorithm>
+
+using namespace Imzadi;
+
+//------------------------------- AnimationPosePool -------------------------------
+
+AnimationPosePool::AnimationPosePool()
+{
+}
+
+/*virtual*/ AnimationPosePool::~AnimationPosePool()
+{
+	this->Clear();
+}
+
+void AnimationPosePool::SetBindPose(const AnimationPose& bindPose)
+{
+	this->Clear();
+	this->bindPose = bindPose;
+}
+
+AnimationPose* AnimationPosePool::AcquirePose()
+{
+	AnimationPose* pose = nullptr;
+
+	if (this->freePoseArray.size() > 0)
+	{
+		pose = this->freePoseArray.back();
+		this->freePoseArray.pop_back();
+	}
+	else
+	{
+		pose = new AnimationPose();
+		this->allocatedPoseArray.push_back(pose);
+		this->freePoseArray.reserve(this->allocatedPoseArray.size());
+	}
+
+	// The pose already has the right size after its first use, so this doesn't allocate.
+	*pose = this->bindPose;
+	return pose;
+}
+
+void AnimationPosePool::ReleasePose(AnimationPose* pose)
+{
+	this->freePoseArray.push_back(pose);
+}
+
+void AnimationPosePool::Clear()
+{
+	for (AnimationPose* pose : this->allocatedPoseArray)
+		delete pose;
+
+	this->allocatedPoseArray.clear();
+	this->freePoseArray.clear();
+}
+
+//------------------------------- AnimationBlendNode -------------------------------
+
+AnimationBlendNode::AnimationBlendNode()
+{
+}
+
+/*virtual*/ AnimationBlendNode::~AnimationBlendNode()
+{
+}
+
+/*virtual*/ void AnimationBlendNode::Reset()
+{
+}
+
+/*virtual*/ bool AnimationBlendNode::IsFinished() const
+{
+	return false;
+}
+
+/*virtual*/ bool AnimationBlendNode::IsEmpty() const
+{
+	return false;
+}
+
+//------------------------------- AnimationClipNode -------------------------------
+
+AnimationClipNode::AnimationClipNode(Animation* animation, const BoneBinding* boneBinding, bool loop)
+{
+	this->animation.Set(animation);
+	this->boneBinding = boneBinding;
+	this->loop = loop;
+	this->finished = false;
+	this->rate = 1.0;
+	this->rateParameter = -1;
+	this->rateScale = 1.0;
+	this->cursor.i = 0;
+	this->cursor.timeSeconds = 0.0;
+
+	if (!this->boneBinding)
+		this->animation.Set(nullptr);
+
+	this->Reset();
+}
+
+/*virtual*/ AnimationClipNode::~AnimationClipNode()
+{
+}
+
+void AnimationClipNode::SetRateParameter(int parameter, double rateScale)
+{
+	this->rateParameter = parameter;
+	this->rateScale = rateScale;
+}
+
+/*virtual*/ void AnimationClipNode::Reset()
+{
+	this->finished = false;
+
+	if (this->animation && !this->animation->MakeCursorFromTime(this->cursor, this->animation->GetStartTime()))
+		this->animation.Set(nullptr);
+}
+
+/*virtual*/ bool AnimationClipNode::IsFinished() const
+{
+	return this->finished;
+}
+
+/*virtual*/ bool AnimationClipNode::IsEmpty() const
+{
+	return !this->animation;
+}
+
+/*virtual*/ void AnimationClipNode::Advance(AnimationBlendGraph* graph, double deltaTime)
+{
+	if (!this->animation || this->finished)
+		return;
+
+	double effectiveRate = this->rate;
+	if (this->rateParameter >= 0)
+		effectiveRate = graph->GetParameter(this->rateParameter) * this->rateScale;
+
+	if (!this->animation->AdvanceCursor(this->cursor, deltaTime * effectiveRate, this->loop))
+		this->finished = true;
+}
+
+/*virtual*/ void AnimationClipNode::Evaluate(AnimationBlendGraph* graph, AnimationPose& pose)
+{
+	if (!this->animation)
+		return;
+
+	KeyFramePair keyFramePair{};
+	if (!this->animation->GetKeyFramesFromCursor(this->cursor, keyFramePair))
+		return;
+
+	Interval interval(keyFramePair.lowerBound->GetTime(), keyFramePair.upperBound->GetTime());
+	double alpha = interval.IsValid() ? interval.Alpha(this->cursor.timeSeconds) : 0.0;
+	alpha = std::clamp(alpha, 0.0, 1.0);
+
+	// Rather than build an interpolated key-frame, we write straight into the pose.
+	const BoneBinding& binding = *this->boneBinding;
+	size_t numPoses = std::min(std::min(keyFramePair.lowerBound->GetPoseCount(), keyFramePair.upperBound->GetPoseCount()), binding.size());
+	for (int i = 0; i < (int)numPoses; i++)
+	{
+		int boneIndex = binding[i];
+		if (boneIndex < 0 || boneIndex >= (int)pose.size())
+			continue;
+
+		const AnimTransform& transformA = keyFramePair.lowerBound->GetPoseInfo(i).childToParent;
+		const AnimTransform& transformB = keyFramePair.upperBound->GetPoseInfo(i).childToParent;
+		pose[boneIndex].Interpolate(transformA, transformB, alpha);
+	}
+}
+
+//------------------------------- AnimationBlendSpace1DNode -------------------------------
+
+AnimationBlendSpace1DNode::AnimationBlendSpace1DNode(int parameter)
+{
+	this->parameter = parameter;
+	this->lowerEntry = -1;
+	this->upperEntry = -1;
+	this->alpha = 0.0;
+}
+
+/*virtual*/ AnimationBlendSpace1DNode::~AnimationBlendSpace1DNode()
+{
+}
+
+void AnimationBlendSpace1DNode::AddChild(AnimationBlendNode* node, double position)
+{
+	Entry entry{ node, position };
+	auto iter = std::upper_bound(this->entryArray.begin(), this->entryArray.end(), entry, [](const Entry& entryA, const Entry& entryB) -> bool {
+		return entryA.position < entryB.position;
+	});
+	this->entryArray.insert(iter, entry);
+}
+
+/*virtual*/ void AnimationBlendSpace1DNode::Reset()
+{
+	for (Entry& entry : this->entryArray)
+		entry.node->Reset();
+
+	this->lowerEntry = -1;
+	this->upperEntry = -1;
+	this->alpha = 0.0;
+}
+
+/*virtual*/ bool AnimationBlendSpace1DNode::IsFinished() const
+{
+	if (this->lowerEntry < 0)
+		return false;
+
+	if (this->entryArray[this->lowerEntry].node->IsFinished())
+		return true;
+
+	return this->upperEntry != this->lowerEntry && this->entryArray[this->upperEntry].node->IsFinished();
+}
+
+/*virtual*/ void AnimationBlendSpace1DNode::Advance(AnimationBlendGraph* graph, double deltaTime)
+{
+	int numEntries = (int)this->entryArray.size();
+	if (numEntries == 0)
+		return;
+
+	double value = graph->GetParameter(this->parameter);
+
+	if (value <= this->entryArray[0].position)
+	{
+		this->lowerEntry = this->upperEntry = 0;
+		this->alpha = 0.0;
+	}
+	else if (value >= this->entryArray[numEntries - 1].position)
+	{
+		this->lowerEntry = this->upperEntry = numEntries - 1;
+		this->alpha = 0.0;
+	}
+	else
+	{
+		int i = 0;
+		while (i < numEntries - 2 && value >= this->entryArray[i + 1].position)
+			i++;
+
+		Interval interval(this->entryArray[i].position, this->entryArray[i + 1].position);
+		this->lowerEntry = i;
+		this->upperEntry = i + 1;
+		this->alpha = interval.IsValid() ? interval.Alpha(value) : 0.0;
+	}
+
+	// Cull whichever side has no say in the blend so that it costs us nothing.
+	if (this->alpha <= 0.0)
+		this->upperEntry = this->lowerEntry;
+	else if (this->alpha >= 1.0)
+	{
+		this->lowerEntry = this->upperEntry;
+		this->alpha = 0.0;
+	}
+
+	this->entryArray[this->lowerEntry].node->Advance(graph, deltaTime);
+	if (this->upperEntry != this->lowerEntry)
+		this->entryArray[this->upperEntry].node->Advance(graph, deltaTime);
+}
+
+/*virtual*/ void AnimationBlendSpace1DNode::Evaluate(AnimationBlendGraph* graph, AnimationPose& pose)
+{
+	if (this->lowerEntry < 0)
+		return;
+
+	this->entryArray[this->lowerEntry].node->Evaluate(graph, pose);
+
+	if (this->upperEntry == this->lowerEntry)
+		return;
+
+	AnimationPosePool* posePool = graph->GetPosePool();
+	AnimationPose* upperPose = posePool->AcquirePose();
+	this->entryArray[this->upperEntry].node->Evaluate(graph, *upperPose);
+
+	for (int i = 0; i < (int)pose.size(); i++)
+	{
+		AnimTransform lowerTransform = pose[i];
+		pose[i].Interpolate(lowerTransform, (*upperPose)[i], this->alpha);
+	}
+
+	posePool->ReleasePose(upperPose);
+}
+
+//------------------------------- AnimationAdditiveNode -------------------------------
+
+AnimationAdditiveNode::AnimationAdditiveNode(AnimationBlendNode* baseNode, AnimationBlendNode* additiveNode, int weightParameter)
+{
+	this->baseNode = baseNode;
+	this->additiveNode = additiveNode;
+	this->weightParameter = weightParameter;
+	this->weight = 0.0;
+}
+
+/*virtual*/ AnimationAdditiveNode::~AnimationAdditiveNode()
+{
+}
+
+/*virtual*/ void AnimationAdditiveNode::Reset()
+{
+	this->baseNode->Reset();
+	this->additiveNode->Reset();
+	this->weight = 0.0;
+}
+
+/*virtual*/ bool AnimationAdditiveNode::IsFinished() const
+{
+	return this->baseNode->IsFinished();
+}
+
+/*virtual*/ void AnimationAdditiveNode::Advance(AnimationBlendGraph* graph, double deltaTime)
+{
+	this->baseNode->Advance(graph, deltaTime);
+
+	this->weight = std::clamp(graph->GetParameter(this->weightParameter), 0.0, 1.0);
+	if (this->weight > 0.0)
+		this->additiveNode->Advance(graph, deltaTime);
+}
+
+/*virtual*/ void AnimationAdditiveNode::Evaluate(AnimationBlendGraph* graph, AnimationPose& pose)
+{
+	this->baseNode->Evaluate(graph, pose);
+
+	if (this->weight <= 0.0 || this->additiveNode->IsEmpty())
+		return;
+
+	AnimationPosePool* posePool = graph->GetPosePool();
+	const AnimationPose& bindPose = posePool->GetBindPose();
+	AnimationPose* additivePose = posePool->AcquirePose();
+	this->additiveNode->Evaluate(graph, *additivePose);
+
+	// The additive pose is applied as its difference from the bind pose.
+	Quaternion identity;
+	for (int i = 0; i < (int)pose.size(); i++)
+	{
+		const AnimTransform& additiveTransform = (*additivePose)[i];
+		const AnimTransform& bindTransform = bindPose[i];
+
+		Quaternion deltaRotation = additiveTransform.rotation * bindTransform.rotation.Inverted();
+		Quaternion weightedRotation;
+		weightedRotation.Interpolate(identity, deltaRotation, this->weight);
+
+		pose[i].rotation = (weightedRotation * pose[i].rotation).Normalized();
+		pose[i].translation += (additiveTransform.translation - bindTransform.translation) * this->weight;
+	}
+
+	posePool->ReleasePose(additivePose);
+}
+
+//------------------------------- AnimationCrossFadeNode -------------------------------
+
+AnimationCrossFadeNode::AnimationCrossFadeNode(int selectionParameter, double fadeTime)
+{
+	this->selectionParameter = selectionParameter;
+	this->fadeTime = fadeTime;
+	this->requestedChild = -1;
+	this->currentChild = -1;
+	this->previousChild = -1;
+	this->fadeAlpha = 1.0;
+}
+
+/*virtual*/ AnimationCrossFadeNode::~AnimationCrossFadeNode()
+{
+}
+
+void AnimationCrossFadeNode::AddChild(AnimationBlendNode* node)
+{
+	this->childArray.push_back(node);
+}
+
+/*virtual*/ void AnimationCrossFadeNode::Reset()
+{
+	for (AnimationBlendNode* node : this->childArray)
+		node->Reset();
+
+	this->requestedChild = -1;
+	this->currentChild = -1;
+	this->previousChild = -1;
+	this->fadeAlpha = 1.0;
+}
+
+/*virtual*/ bool AnimationCrossFadeNode::IsFinished() const
+{
+	if (this->requestedChild < 0)
+		return false;
+
+	// If we were asked for something we can't play, then there is nothing to wait for.
+	const AnimationBlendNode* node = this->childArray[this->requestedChild];
+	return node->IsEmpty() || (this->requestedChild == this->currentChild && node->IsFinished());
+}
+
+/*virtual*/ void AnimationCrossFadeNode::Advance(AnimationBlendGraph* graph, double deltaTime)
+{
+	if (this->childArray.size() == 0)
+		return;
+
+	int selection = (int)::round(graph->GetParameter(this->selectionParameter));
+	this->requestedChild = std::clamp(selection, 0, int(this->childArray.size()) - 1);
+
+	// An empty child keeps whatever was playing before going.
+	if (this->requestedChild != this->currentChild && !this->childArray[this->requestedChild]->IsEmpty())
+	{
+		this->previousChild = this->currentChild;
+		this->currentChild = this->requestedChild;
+		this->childArray[this->currentChild]->Reset();
+
+		if (this->previousChild >= 0 && this->fadeTime > 0.0)
+			this->fadeAlpha = 0.0;
+		else
+		{
+			this->previousChild = -1;
+			this->fadeAlpha = 1.0;
+		}
+	}
+
+	if (this->previousChild >= 0)
+	{
+		this->fadeAlpha += deltaTime / this->fadeTime;
+		if (this->fadeAlpha >= 1.0)
+		{
+			this->fadeAlpha = 1.0;
+			this->previousChild = -1;
+		}
+		else
+			this->childArray[this->previousChild]->Advance(graph, deltaTime);
+	}
+
+	if (this->currentChild >= 0)
+		this->childArray[this->currentChild]->Advance(graph, deltaTime);
+}
+
+/*virtual*/ void AnimationCrossFadeNode::Evaluate(AnimationBlendGraph* graph, AnimationPose& pose)
+{
+	if (this->currentChild < 0)
+		return;
+
+	if (this->previousChild < 0)
+	{
+		this->childArray[this->currentChild]->Evaluate(graph, pose);
+		return;
+	}
+
+	this->childArray[this->previousChild]->Evaluate(graph, pose);
+
+	AnimationPosePool* posePool = graph->GetPosePool();
+	AnimationPose* currentPose = posePool->AcquirePose();
+	this->childArray[this->currentChild]->Evaluate(graph, *currentPose);
+
+	for (int i = 0; i < (int)pose.size(); i++)
+	{
+		AnimTransform previousTransform = pose[i];
+		pose[i].Interpolate(previousTransform, (*currentPose)[i], this->fadeAlpha);
+	}
+
+	posePool->ReleasePose(currentPose);
+}
+
+//------------------------------- AnimationBlendGraph -------------------------------
+
+AnimationBlendGraph::AnimationBlendGraph()
+{
+	this->rootNode = nullptr;
+}
+
+/*virtual*/ AnimationBlendGraph::~AnimationBlendGraph()
+{
+	this->Clear();
+}
+
+bool AnimationBlendGraph::Setup(SkinnedRenderMesh* skinnedMesh)
+{
+	this->Clear();
+
+	const Skeleton* skeleton = skinnedMesh->GetSkeleton();
+	if (!skeleton)
+	{
+		IMZADI_LOG_ERROR("Can't setup a blend graph for a mesh without a skeleton.");
+		return false;
+	}
+
+	AnimationPose bindPose;
+	bindPose.resize(skeleton->GetNumBones());
+	for (int i = 0; i < (int)bindPose.size(); i++)
+	{
+		if (!bindPose[i].SetFromTransform(skeleton->GetChildToParent(BoneTransformType::BIND_POSE, i)))
+		{
+			IMZADI_LOG_ERROR(std::format("Failed to decompose bind-pose of bone \"{}\".", skeleton->GetBone(i)->GetName().c_str()));
+			return false;
+		}
+	}
+
+	this->posePool.SetBindPose(bindPose);
+	this->skinnedMesh.Set(skinnedMesh);
+	return true;
+}
+
+void AnimationBlendGraph::Clear()
+{
+	for (AnimationBlendNode* node : this->nodeArray)
+		delete node;
+
+	this->nodeArray.clear();
+	this->rootNode = nullptr;
+	this->parameterArray.clear();
+	this->parameterMap.clear();
+}
+
+int AnimationBlendGraph::AddParameter(const std::string& name, double defaultValue)
+{
+	int parameter = this->FindParameter(name);
+	if (parameter >= 0)
+		return parameter;
+
+	parameter = (int)this->parameterArray.size();
+	this->parameterArray.push_back(defaultValue);
+	this->parameterMap.insert(std::pair<std::string, int>(name, parameter));
+	return parameter;
+}
+
+int AnimationBlendGraph::FindParameter(const std::string& name) const
+{
+	ParameterMap::const_iterator iter = this->parameterMap.find(name);
+	if (iter == this->parameterMap.end())
+		return -1;
+
+	return iter->second;
+}
+
+AnimationClipNode* AnimationBlendGraph::AddClipNode(const std::string& animationName, bool loop)
+{
+	Animation* animation = nullptr;
+	const BoneBinding* boneBinding = nullptr;
+
+	if (this->skinnedMesh)
+	{
+		animation = this->skinnedMesh->GetAnimation(animationName);
+		boneBinding = this->skinnedMesh->GetAnimationBoneBinding(animationName);
+	}
+
+	return this->AddNode(new AnimationClipNode(animation, boneBinding, loop));
+}
+
+void AnimationBlendGraph::Reset()
+{
+	if (this->rootNode)
+		this->rootNode->Reset();
+}
+
+bool AnimationBlendGraph::Advance(double deltaTime)
+{
+	if (!this->rootNode)
+		return false;
+
+	this->rootNode->Advance(this, deltaTime);
+	return !this->rootNode->IsFinished();
+}
+
+void AnimationBlendGraph::Evaluate(Skeleton* skeleton, int maxBoneDepth)
+{
+	if (!this->rootNode)
+		return;
+
+	AnimationPose* pose = this->posePool.AcquirePose();
+	this->rootNode->Evaluate(this, *pose);
+
+	int numBones = std::min((int)pose->size(), (int)skeleton->GetNumBones());
+	for (int i = 0; i < numBones; i++)
+	{
+		if (maxBoneDepth >= 0 && skeleton->GetBoneDepth(i) > maxBoneDepth)
+			continue;
+
+		Transform childToParent;
+		(*pose)[i].GetToTransform(childToParent);
+		skeleton->SetCurrentPoseChildToParent(i, childToParent);
+	}
+
+	this->posePool.ReleasePose(pose);
+}
\ No newline at end of file
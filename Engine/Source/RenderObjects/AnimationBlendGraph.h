@@ -0,0 +1,330 @@
+#pragma once
+
+#include "Reference.h"
+#include "Assets/Animation.h"
+#include "Assets/SkinnedRenderMesh.h"
+#include "Math/AnimTransform.h"
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+namespace Imzadi
+{
+	class Skeleton;
+	class AnimationBlendGraph;
+
+	/**
+	 * A pose is the child-to-parent transform of every bone of a skeleton,
+	 * indexed the same way as the bones of the flattened skeleton.
+	 */
+	typedef std::vector<AnimTransform> AnimationPose;
+
+	/**
+	 * Blend nodes need scratch poses to blend between, and we don't want to
+	 * allocate those every frame.  The pool hands out poses that are released
+	 * back to it once the caller is done with them.  The pool only grows if
+	 * more poses are needed at once than ever before, which, for a given graph,
+	 * stops happening after the first frame.
+	 */
+	class IMZADI_API AnimationPosePool
+	{
+	public:
+		AnimationPosePool();
+		virtual ~AnimationPosePool();
+
+		/**
+		 * Set the pose that all acquired poses are initialized to.  This also
+		 * empties the pool, so don't call it while poses are acquired.
+		 */
+		void SetBindPose(const AnimationPose& bindPose);
+
+		/**
+		 * Return a pose initialized to the bind pose.  Release it when done.
+		 */
+		AnimationPose* AcquirePose();
+
+		/**
+		 * Return the given pose to the pool.
+		 */
+		void ReleasePose(AnimationPose* pose);
+
+		/**
+		 * Delete all poses of the pool.
+		 */
+		void Clear();
+
+		const AnimationPose& GetBindPose() const { return this->bindPose; }
+
+		size_t GetNumAllocatedPoses() const { return this->allocatedPoseArray.size(); }
+
+	private:
+		AnimationPose bindPose;
+		std::vector<AnimationPose*> allocatedPoseArray;
+		std::vector<AnimationPose*> freePoseArray;
+	};
+
+	/**
+	 * This is the base class for all nodes of a blend graph.  Each frame, a graph
+	 * is first advanced, which is where nodes update their time and their blend
+	 * weights from the graph's parameters, and then evaluated, which is where nodes
+	 * write into a given pose.  Nodes with a weight of zero are neither advanced
+	 * nor evaluated.
+	 */
+	class IMZADI_API AnimationBlendNode
+	{
+	public:
+		AnimationBlendNode();
+		virtual ~AnimationBlendNode();
+
+		/**
+		 * Go back to the start of whatever it is this node plays.
+		 */
+		virtual void Reset();
+
+		/**
+		 * Move this node forward in time.
+		 */
+		virtual void Advance(AnimationBlendGraph* graph, double deltaTime) = 0;
+
+		/**
+		 * Write this node's pose into the given pose.  Note that bones not
+		 * driven by this node are left untouched, so the caller should provide
+		 * a pose initialized to something reasonable, like the bind pose.
+		 */
+		virtual void Evaluate(AnimationBlendGraph* graph, AnimationPose& pose) = 0;
+
+		/**
+		 * A node is finished once it has played through something non-looping.
+		 */
+		virtual bool IsFinished() const;
+
+		/**
+		 * An empty node is one that can't produce any pose, such as a clip node
+		 * for an animation the mesh doesn't have.
+		 */
+		virtual bool IsEmpty() const;
+	};
+
+	/**
+	 * Play a single animation clip.  The play-back rate can optionally be
+	 * made proportional to one of the graph's parameters.
+	 */
+	class IMZADI_API AnimationClipNode : public AnimationBlendNode
+	{
+	public:
+		AnimationClipNode(Animation* animation, const BoneBinding* boneBinding, bool loop);
+		virtual ~AnimationClipNode();
+
+		virtual void Reset() override;
+		virtual void Advance(AnimationBlendGraph* graph, double deltaTime) override;
+		virtual void Evaluate(AnimationBlendGraph* graph, AnimationPose& pose) override;
+		virtual bool IsFinished() const override;
+		virtual bool IsEmpty() const override;
+
+		void SetRate(double rate) { this->rate = rate; }
+		double GetRate() const { return this->rate; }
+
+		/**
+		 * Make the play-back rate of this clip the given parameter times the given scale.
+		 *
+		 * @param[in] parameter This is the index of a graph parameter, or -1 to use the fixed rate.
+		 * @param[in] rateScale The parameter is multiplied by this to get the rate.
+		 */
+		void SetRateParameter(int parameter, double rateScale);
+
+	private:
+		Reference<Animation> animation;
+		const BoneBinding* boneBinding;
+		Animation::Cursor cursor;
+		bool loop;
+		bool finished;
+		double rate;
+		int rateParameter;
+		double rateScale;
+	};
+
+	/**
+	 * Blend between children positioned along a line according to one of the graph's
+	 * parameters, such as speed.  At most two adjacent children contribute at any time.
+	 */
+	class IMZADI_API AnimationBlendSpace1DNode : public AnimationBlendNode
+	{
+	public:
+		AnimationBlendSpace1DNode(int parameter);
+		virtual ~AnimationBlendSpace1DNode();
+
+		virtual void Reset() override;
+		virtual void Advance(AnimationBlendGraph* graph, double deltaTime) override;
+		virtual void Evaluate(AnimationBlendGraph* graph, AnimationPose& pose) override;
+		virtual bool IsFinished() const override;
+
+		/**
+		 * Add the given node (owned by the graph) at the given position of the blend space.
+		 */
+		void AddChild(AnimationBlendNode* node, double position);
+
+	private:
+		struct Entry
+		{
+			AnimationBlendNode* node;
+			double position;
+		};
+
+		std::vector<Entry> entryArray;
+		int parameter;
+		int lowerEntry;
+		int upperEntry;
+		double alpha;
+	};
+
+	/**
+	 * Layer an additive animation on top of a base animation.  The additive child
+	 * is taken relative to the bind pose, and is applied with the weight given by
+	 * one of the graph's parameters.  If that weight is zero, the additive child
+	 * isn't advanced or evaluated at all.
+	 */
+	class IMZADI_API AnimationAdditiveNode : public AnimationBlendNode
+	{
+	public:
+		AnimationAdditiveNode(AnimationBlendNode* baseNode, AnimationBlendNode* additiveNode, int weightParameter);
+		virtual ~AnimationAdditiveNode();
+
+		virtual void Reset() override;
+		virtual void Advance(AnimationBlendGraph* graph, double deltaTime) override;
+		virtual void Evaluate(AnimationBlendGraph* graph, AnimationPose& pose) override;
+		virtual bool IsFinished() const override;
+
+	private:
+		AnimationBlendNode* baseNode;
+		AnimationBlendNode* additiveNode;
+		int weightParameter;
+		double weight;
+	};
+
+	/**
+	 * Play one of several children, selected by one of the graph's parameters,
+	 * and cross-fade from the previously selected child whenever the selection
+	 * changes.  The outgoing child keeps playing while it fades out.  A newly
+	 * selected child is started from the beginning.
+	 */
+	class IMZADI_API AnimationCrossFadeNode : public AnimationBlendNode
+	{
+	public:
+		AnimationCrossFadeNode(int selectionParameter, double fadeTime);
+		virtual ~AnimationCrossFadeNode();
+
+		virtual void Reset() override;
+		virtual void Advance(AnimationBlendGraph* graph, double deltaTime) override;
+		virtual void Evaluate(AnimationBlendGraph* graph, AnimationPose& pose) override;
+		virtual bool IsFinished() const override;
+
+		/**
+		 * Add the given node (owned by the graph) as the next selectable child.
+		 * The first child is selected by parameter value zero, the next by one, and so on.
+		 */
+		void AddChild(AnimationBlendNode* node);
+
+		void SetFadeTime(double fadeTime) { this->fadeTime = fadeTime; }
+		double GetFadeTime() const { return this->fadeTime; }
+
+	private:
+		std::vector<AnimationBlendNode*> childArray;
+		int selectionParameter;
+		int requestedChild;
+		int currentChild;
+		int previousChild;
+		double fadeTime;
+		double fadeAlpha;
+	};
+
+	/**
+	 * A blend graph is a tree of blend nodes, driven by a set of named, numeric
+	 * parameters, that produces a pose for a skinned mesh's skeleton.  Owners of
+	 * a graph (e.g., the @ref Biped class) set parameters, such as speed, rather
+	 * than swapping clips in and out of the mesh.
+	 *
+	 * Nodes and parameters are created at setup time.  Once set up, advancing and
+	 * evaluating a graph does not allocate any memory.
+	 */
+	class IMZADI_API AnimationBlendGraph : public ReferenceCounted
+	{
+	public:
+		AnimationBlendGraph();
+		virtual ~AnimationBlendGraph();
+
+		/**
+		 * Prepare this graph to drive the given mesh's skeleton.  This must be called before any clip nodes are made.
+		 */
+		bool Setup(SkinnedRenderMesh* skinnedMesh);
+
+		/**
+		 * Delete all nodes and parameters.
+		 */
+		void Clear();
+
+		/**
+		 * Add a parameter with the given name, or find the existing one of that name.
+		 *
+		 * @return The parameter's index is returned.  Use this, not the name, to set the parameter every frame.
+		 */
+		int AddParameter(const std::string& name, double defaultValue);
+
+		/**
+		 * Return the index of the named parameter, or -1 if it doesn't exist.
+		 */
+		int FindParameter(const std::string& name) const;
+
+		void SetParameter(int parameter, double value) { this->parameterArray[parameter] = value; }
+		double GetParameter(int parameter) const { return (parameter >= 0) ? this->parameterArray[parameter] : 0.0; }
+
+		/**
+		 * Take ownership of the given node, and return it for convenience.
+		 */
+		template<typename T>
+		T* AddNode(T* node)
+		{
+			this->nodeArray.push_back(node);
+			return node;
+		}
+
+		/**
+		 * Make a clip node for the named animation of our mesh.  If the mesh has no
+		 * such animation, we still return a node, but it will be an empty one.
+		 */
+		AnimationClipNode* AddClipNode(const std::string& animationName, bool loop);
+
+		void SetRootNode(AnimationBlendNode* rootNode) { this->rootNode = rootNode; }
+		AnimationBlendNode* GetRootNode() { return this->rootNode; }
+
+		/**
+		 * Restart all nodes of the graph.
+		 */
+		void Reset();
+
+		/**
+		 * Move the graph forward in time.
+		 *
+		 * @return False is returned if the graph has played through to the end of something non-looping; true, otherwise.
+		 */
+		bool Advance(double deltaTime);
+
+		/**
+		 * Evaluate the graph and pose the given skeleton with the result.
+		 *
+		 * @param[in,out] skeleton This is the skeleton to pose.  Its cached transforms are not updated here.
+		 * @param[in] maxBoneDepth If non-negative, bones deeper than this are left as they are.
+		 */
+		void Evaluate(Skeleton* skeleton, int maxBoneDepth);
+
+		AnimationPosePool* GetPosePool() { return &this->posePool; }
+
+	private:
+		Reference<SkinnedRenderMesh> skinnedMesh;
+		AnimationBlendNode* rootNode;
+		std::vector<AnimationBlendNode*> nodeArray;
+		std::vector<double> parameterArray;
+		typedef std::unordered_map<std::string, int> ParameterMap;
+		ParameterMap parameterMap;
+		AnimationPosePool posePool;
+	};
+}
\ No newline at end of file
@@ -15,14 +15,36 @@ using namespace Imzadi;
 RenderMeshInstance::RenderMeshInstance()
 {
 	this->objectToWorld.SetIdentity();
+	this->hasPreviousObjectToWorld = false;
 	this->surfaceProperties.shininessExponent = 50.0;
 	this->drawPorts = false;
+	this->lastDistanceToCamera = 0.0;
 }
 
 /*virtual*/ RenderMeshInstance::~RenderMeshInstance()
 {
 }
 
+/*virtual*/ void RenderMeshInstance::SaveSimulationState()
+{
+	this->previousObjectToWorld = this->objectToWorld;
+	this->hasPreviousObjectToWorld = true;
+}
+
+/*virtual*/ void RenderMeshInstance::BeginInterpolatedRender(double alpha)
+{
+	this->simulatedObjectToWorld = this->objectToWorld;
+
+	// An instance added to the scene during the last simulation step has nowhere to come from.
+	if (this->hasPreviousObjectToWorld)
+		this->objectToWorld.Interpolate(this->previousObjectToWorld, this->simulatedObjectToWorld, alpha);
+}
+
+/*virtual*/ void RenderMeshInstance::EndInterpolatedRender()
+{
+	this->objectToWorld = this->simulatedObjectToWorld;
+}
+
 void RenderMeshInstance::SetRenderMesh(Reference<RenderMeshAsset> mesh, int lodNumber /*= 0*/)
 {
 	this->meshMap.insert(std::pair<int, Reference<RenderMeshAsset>>(lodNumber, mesh));
@@ -45,7 +67,7 @@ RenderMeshAsset* RenderMeshInstance::GetRenderMesh(int lodNumber /*= 0*/)
 		if (mesh)
 		{
 			DebugLines* debugLines = Game::Get()->GetDebugLines();
-			for (auto pair : mesh->GetPortMap())
+			for (const auto& pair : mesh->GetPortMap())
 			{
 				const Transform& portToObject = pair.second;
 				Transform portToWorld = this->objectToWorld * portToObject;
@@ -57,9 +79,18 @@ RenderMeshAsset* RenderMeshInstance::GetRenderMesh(int lodNumber /*= 0*/)
 
 /*virtual*/ void RenderMeshInstance::Render(Camera* camera, RenderPass renderPass)
 {
-	ID3D11DeviceContext* deviceContext = Game::Get()->GetDeviceContext();
+	// We're being drawn on our own rather than as part of the scene, so we get a queue of our own.
+	RenderQueue renderQueue;
+	renderQueue.Begin(camera, renderPass);
+	this->Submit(camera, renderPass, renderQueue);
+	renderQueue.Execute();
+}
 
+/*virtual*/ void RenderMeshInstance::Submit(Camera* camera, RenderPass renderPass, RenderQueue& renderQueue)
+{
 	double distanceToCamera = (this->objectToWorld.translation - camera->GetCameraToWorldTransform().translation).Length();
+	if (renderPass == RenderPass::MAIN_PASS)
+		this->lastDistanceToCamera = distanceToCamera;
 
 	RenderMeshAsset* mesh = nullptr;
 
@@ -81,11 +112,13 @@ RenderMeshAsset* RenderMeshInstance::GetRenderMesh(int lodNumber /*= 0*/)
 		return;
 
 	Shader* shader = nullptr;
+	Texture* texture = nullptr;
 
 	switch (renderPass)
 	{
 	case RenderPass::MAIN_PASS:
 		shader = mesh->GetShader();
+		texture = mesh->GetTexture();
 		break;
 	case RenderPass::SHADOW_PASS:
 		shader = mesh->GetShadowShader();
@@ -95,53 +128,82 @@ RenderMeshAsset* RenderMeshInstance::GetRenderMesh(int lodNumber /*= 0*/)
 	if (!shader)
 		return;
 
-	D3D11_BLEND_DESC blendDesc{};
-	blendDesc.RenderTarget[0].BlendEnable = TRUE;
-	blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
-	blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
-	blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-	blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
-	blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
-	blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-	blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
-	Game::Get()->GetBlendStateCache()->SetState(&blendDesc);
-
-	D3D11_RASTERIZER_DESC rasterizerDesc{};
-	rasterizerDesc.FillMode = D3D11_FILL_SOLID;
-	rasterizerDesc.CullMode = D3D11_CULL_BACK;
-	rasterizerDesc.FrontCounterClockwise = TRUE;
-	rasterizerDesc.DepthBias = 0;
-	rasterizerDesc.DepthClipEnable = TRUE;
-	rasterizerDesc.ScissorEnable = FALSE;
-	rasterizerDesc.MultisampleEnable = FALSE;
-	rasterizerDesc.AntialiasedLineEnable = FALSE;
-	Game::Get()->GetRasterStateCache()->SetState(&rasterizerDesc);
-
-	D3D11_DEPTH_STENCIL_DESC depthStencilDesc{};
-	depthStencilDesc.DepthEnable = TRUE;
-	depthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-	depthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS;
-	depthStencilDesc.StencilEnable = FALSE;
-	depthStencilDesc.StencilReadMask = 0;
-	depthStencilDesc.StencilWriteMask = 0;
-	Game::Get()->GetDepthStencilStateCache()->SetState(&depthStencilDesc);
+	renderQueue.Submit(this, this->SortKey(), shader, texture, mesh, distanceToCamera);
+}
+
+/*virtual*/ void RenderMeshInstance::Draw(Camera* camera, RenderPass renderPass, const DrawPacket& packet, RenderQueue& renderQueue)
+{
+	ID3D11DeviceContext* deviceContext = Game::Get()->GetDeviceContext();
+
+	RenderMeshAsset* mesh = packet.mesh;
+	Shader* shader = packet.shader;
+	Texture* texture = packet.texture;
+
+	if (renderQueue.BindPipelineState(PIPELINE_STATE))
+	{
+		D3D11_BLEND_DESC blendDesc{};
+		blendDesc.RenderTarget[0].BlendEnable = TRUE;
+		blendDesc.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+		blendDesc.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+		blendDesc.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+		blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+		blendDesc.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+		blendDesc.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+		blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+		Game::Get()->GetBlendStateCache()->SetState(&blendDesc);
+
+		D3D11_RASTERIZER_DESC rasterizerDesc{};
+		rasterizerDesc.FillMode = D3D11_FILL_SOLID;
+		rasterizerDesc.CullMode = D3D11_CULL_BACK;
+		rasterizerDesc.FrontCounterClockwise = TRUE;
+		rasterizerDesc.DepthBias = 0;
+		rasterizerDesc.DepthClipEnable = TRUE;
+		rasterizerDesc.ScissorEnable = FALSE;
+		rasterizerDesc.MultisampleEnable = FALSE;
+		rasterizerDesc.AntialiasedLineEnable = FALSE;
+		Game::Get()->GetRasterStateCache()->SetState(&rasterizerDesc);
+
+		D3D11_DEPTH_STENCIL_DESC depthStencilDesc{};
+		depthStencilDesc.DepthEnable = TRUE;
+		depthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+		depthStencilDesc.DepthFunc = D3D11_COMPARISON_LESS;
+		depthStencilDesc.StencilEnable = FALSE;
+		depthStencilDesc.StencilReadMask = 0;
+		depthStencilDesc.StencilWriteMask = 0;
+		Game::Get()->GetDepthStencilStateCache()->SetState(&depthStencilDesc);
+	}
 
 	Buffer* vertexBuffer = mesh->GetVertexBuffer();
 	Buffer* indexBuffer = mesh->GetIndexBuffer();
-	Texture* texture = mesh->GetTexture();
+	ID3D11Buffer* constantsBuffer = shader->GetConstantsBuffer();
 
-	deviceContext->IASetPrimitiveTopology(mesh->GetPrimType());
-	deviceContext->IASetInputLayout(shader->GetInputLayout());
+	if (renderQueue.BindShader(shader))
+	{
+		deviceContext->IASetInputLayout(shader->GetInputLayout());
+		deviceContext->VSSetShader(shader->GetVertexShader(), NULL, 0);
+		deviceContext->PSSetShader(shader->GetPixelShader(), NULL, 0);
 
-	deviceContext->VSSetShader(shader->GetVertexShader(), NULL, 0);
-	deviceContext->PSSetShader(shader->GetPixelShader(), NULL, 0);
+		// Mapping the constants buffer below doesn't unbind it, so it only needs to be bound with the shader.
+		if (constantsBuffer)
+		{
+			deviceContext->VSSetConstantBuffers(0, 1, &constantsBuffer);
+			deviceContext->PSSetConstantBuffers(0, 1, &constantsBuffer);
+		}
+	}
 
-	UINT stride = vertexBuffer->GetStride();
-	UINT offset = 0;
-	ID3D11Buffer* vertexBufferIface = vertexBuffer->GetBuffer();
-	deviceContext->IASetVertexBuffers(0, 1, &vertexBufferIface, &stride, &offset);
+	if (renderQueue.BindMesh(mesh))
+	{
+		deviceContext->IASetPrimitiveTopology(mesh->GetPrimType());
+
+		UINT stride = vertexBuffer->GetStride();
+		UINT offset = 0;
+		ID3D11Buffer* vertexBufferIface = vertexBuffer->GetBuffer();
+		deviceContext->IASetVertexBuffers(0, 1, &vertexBufferIface, &stride, &offset);
+
+		if (indexBuffer)
+			deviceContext->IASetIndexBuffer(indexBuffer->GetBuffer(), indexBuffer->GetFormat(), 0);
+	}
 
-	ID3D11Buffer* constantsBuffer = shader->GetConstantsBuffer();
 	if (constantsBuffer)
 	{
 		D3D11_MAPPED_SUBRESOURCE mappedSubresource;
@@ -189,95 +251,85 @@ RenderMeshAsset* RenderMeshInstance::GetRenderMesh(int lodNumber /*= 0*/)
 
 		if (renderPass == RenderPass::MAIN_PASS)
 		{
-			Camera* lightSourceCamera = Game::Get()->GetLightSourceCamera();
-			if (lightSourceCamera)
-			{
-				const Transform& lightCameraToWorld = lightSourceCamera->GetCameraToWorldTransform();
-				const Camera::OrthographicParams& orthoParams = lightSourceCamera->GetOrthographicParameters();
-
-				Vector3 lightCameraEyePoint = lightCameraToWorld.translation;
-				Vector3 lightCameraXAxis, lightCameraYAxis, lightCameraZAxis;
-				double lightCameraWidth = 0.0, lightCameraHeight = 0.0;
-				double lightCameraNear = 0.0, lightCameraFar = 0.0;
-				double shadowScale = this->GetRenderMesh()->GetShadowScale();
-
-				lightCameraToWorld.matrix.GetColumnVectors(lightCameraXAxis, lightCameraYAxis, lightCameraZAxis);
-				lightCameraWidth = orthoParams.width;
-				lightCameraHeight = orthoParams.height;
-				lightCameraNear = orthoParams.nearClip;
-				lightCameraFar = orthoParams.farClip;
-
-				if (shader->GetConstantInfo("lightCameraEyePoint", constant))
-					StoreShaderConstant(&mappedSubresource, constant, &lightCameraEyePoint);
+			static const char* eyePointNameArray[ShadowCascades::MAX_CASCADES] = { "lightCameraEyePoint0", "lightCameraEyePoint1", "lightCameraEyePoint2", "lightCameraEyePoint3" };
+			static const char* extentsNameArray[ShadowCascades::MAX_CASCADES] = { "lightCameraExtents0", "lightCameraExtents1", "lightCameraExtents2", "lightCameraExtents3" };
+
+			const ShadowCascades* shadowCascades = Game::Get()->GetShadowCascades();
+			int numCascades = shadowCascades->IsValid() ? shadowCascades->GetNumCascades() : 0;
+			double numShadowCascades = double(numCascades);
+			double shadowScale = this->GetRenderMesh()->GetShadowScale();
 
-				if (shader->GetConstantInfo("lightCameraXAxis", constant))
-					StoreShaderConstant(&mappedSubresource, constant, &lightCameraXAxis);
+			// All the light cameras share an orientation, so the axes of any one of them will do.
+			Vector3 lightCameraXAxis, lightCameraYAxis, lightCameraZAxis;
+			shadowCascades->GetCascadeCamera(0)->GetCameraToWorldTransform().matrix.GetColumnVectors(lightCameraXAxis, lightCameraYAxis, lightCameraZAxis);
 
-				if (shader->GetConstantInfo("lightCameraYAxis", constant))
-					StoreShaderConstant(&mappedSubresource, constant, &lightCameraYAxis);
+			if (shader->GetConstantInfo("lightCameraXAxis", constant))
+				StoreShaderConstant(&mappedSubresource, constant, &lightCameraXAxis);
 
-				if (shader->GetConstantInfo("lightCameraWidth", constant))
-					StoreShaderConstant(&mappedSubresource, constant, &lightCameraWidth);
+			if (shader->GetConstantInfo("lightCameraYAxis", constant))
+				StoreShaderConstant(&mappedSubresource, constant, &lightCameraYAxis);
 
-				if (shader->GetConstantInfo("lightCameraHeight", constant))
-					StoreShaderConstant(&mappedSubresource, constant, &lightCameraHeight);
+			if (shader->GetConstantInfo("numShadowCascades", constant))
+				StoreShaderConstant(&mappedSubresource, constant, &numShadowCascades);
 
-				if (shader->GetConstantInfo("lightCameraNear", constant))
-					StoreShaderConstant(&mappedSubresource, constant, &lightCameraNear);
+			if (shader->GetConstantInfo("shadowScale", constant))
+				StoreShaderConstant(&mappedSubresource, constant, &shadowScale);
 
-				if (shader->GetConstantInfo("lightCameraFar", constant))
-					StoreShaderConstant(&mappedSubresource, constant, &lightCameraFar);
+			for (int i = 0; i < numCascades; i++)
+			{
+				const Camera* lightCamera = shadowCascades->GetCascadeCamera(i);
+				const Camera::OrthographicParams& orthoParams = lightCamera->GetOrthographicParameters();
+				Vector3 lightCameraEyePoint = lightCamera->GetCameraToWorldTransform().translation;
+				Vector4 lightCameraExtents(orthoParams.width, orthoParams.height, orthoParams.nearClip, orthoParams.farClip);
+
+				if (shader->GetConstantInfo(eyePointNameArray[i], constant))
+					StoreShaderConstant(&mappedSubresource, constant, &lightCameraEyePoint);
 
-				if (shader->GetConstantInfo("shadowScale", constant))
-					StoreShaderConstant(&mappedSubresource, constant, &shadowScale);
+				if (shader->GetConstantInfo(extentsNameArray[i], constant))
+					StoreShaderConstant(&mappedSubresource, constant, &lightCameraExtents);
 			}
 		}
 
 		deviceContext->Unmap(constantsBuffer, 0);
-		deviceContext->VSSetConstantBuffers(0, 1, &constantsBuffer);
-		deviceContext->PSSetConstantBuffers(0, 1, &constantsBuffer);
 	}
 
-	if (renderPass == RenderPass::MAIN_PASS)
+	// The shadow buffer doesn't change during a pass, so only the texture decides whether anything needs binding here.
+	if (renderQueue.BindTexture(texture))
 	{
-		std::vector<ID3D11ShaderResourceView*> shaderResourceViewArray;
-		std::vector<ID3D11SamplerState*> samplerStateArray;
-
-		if (texture)
+		if (renderPass == RenderPass::MAIN_PASS)
 		{
-			shaderResourceViewArray.push_back(texture->GetTextureView());
-			samplerStateArray.push_back(Game::Get()->GetGeneralSamplerState());
-		}
+			std::vector<ID3D11ShaderResourceView*> shaderResourceViewArray;
+			std::vector<ID3D11SamplerState*> samplerStateArray;
 
-		ID3D11ShaderResourceView* shadowBufferResourceView = Game::Get()->GetShadowBufferResourceViewForShader();
-		ID3D11SamplerState* shadowBufferSamplerState = Game::Get()->GetGeneralSamplerState();
+			if (texture)
+			{
+				shaderResourceViewArray.push_back(texture->GetTextureView());
+				samplerStateArray.push_back(Game::Get()->GetGeneralSamplerState());
+			}
 
-		if (shadowBufferResourceView && shadowBufferSamplerState)
+			ID3D11ShaderResourceView* shadowBufferResourceView = Game::Get()->GetShadowBufferResourceViewForShader();
+			ID3D11SamplerState* shadowBufferSamplerState = Game::Get()->GetGeneralSamplerState();
+
+			if (shadowBufferResourceView && shadowBufferSamplerState)
+			{
+				shaderResourceViewArray.push_back(shadowBufferResourceView);
+				samplerStateArray.push_back(shadowBufferSamplerState);
+			}
+
+			deviceContext->PSSetShaderResources(0, shaderResourceViewArray.size(), shaderResourceViewArray.data());
+			deviceContext->PSSetSamplers(0, samplerStateArray.size(), samplerStateArray.data());
+		}
+		else if (renderPass == RenderPass::SHADOW_PASS)
 		{
-			shaderResourceViewArray.push_back(shadowBufferResourceView);
-			samplerStateArray.push_back(shadowBufferSamplerState);
+			deviceContext->PSSetShaderResources(0, 0, NULL);
+			deviceContext->PSSetSamplers(0, 0, NULL);
 		}
-
-		deviceContext->PSSetShaderResources(0, shaderResourceViewArray.size(), shaderResourceViewArray.data());
-		deviceContext->PSSetSamplers(0, samplerStateArray.size(), samplerStateArray.data());
-	}
-	else if (renderPass == RenderPass::SHADOW_PASS)
-	{
-		deviceContext->PSSetShaderResources(0, 0, NULL);
-		deviceContext->PSSetSamplers(0, 0, NULL);
 	}
 
 	if (!indexBuffer)
-		deviceContext->Draw(mesh->GetVertexBuffer()->GetNumElements(), 0);
+		deviceContext->Draw(vertexBuffer->GetNumElements(), 0);
 	else
-	{
-		ID3D11Buffer* indexBufferIface = indexBuffer->GetBuffer();
-		DXGI_FORMAT format = indexBuffer->GetFormat();
-		deviceContext->IASetIndexBuffer(indexBufferIface, format, 0);
-
-		UINT numElements = indexBuffer->GetNumElements();
-		deviceContext->DrawIndexed(numElements, 0, 0);
-	}
+		deviceContext->DrawIndexed(indexBuffer->GetNumElements(), 0, 0);
 }
 
 /*virtual*/ bool RenderMeshInstance::GetWorldBoundingSphere(Vector3& center, double& radius) const
@@ -20,8 +20,13 @@ namespace Imzadi
 		virtual ~RenderMeshInstance();
 
 		virtual void Render(Camera* camera, RenderPass renderPass) override;
+		virtual void Submit(Camera* camera, RenderPass renderPass, RenderQueue& renderQueue) override;
+		virtual void Draw(Camera* camera, RenderPass renderPass, const DrawPacket& packet, RenderQueue& renderQueue) override;
 		virtual bool GetWorldBoundingSphere(Vector3& center, double& radius) const override;
 		virtual void PreRender() override;
+		virtual void SaveSimulationState() override;
+		virtual void BeginInterpolatedRender(double alpha) override;
+		virtual void EndInterpolatedRender() override;
 
 		void SetRenderMesh(Reference<RenderMeshAsset> mesh, int lodNumber = 0);
 		RenderMeshAsset* GetRenderMesh(int lodNumber = 0);
@@ -31,6 +36,13 @@ namespace Imzadi
 		void SetDrawPorts(bool drawPorts) { this->drawPorts = drawPorts; }
 		bool GetDrawPorts() const { return this->drawPorts; }
 
+		/**
+		 * Return the distance from this instance to the main camera as it was
+		 * calculated during the last main render pass.  Before we're ever rendered,
+		 * this is zero, which is as near to the camera as you can get.
+		 */
+		double GetLastDistanceToCamera() const { return this->lastDistanceToCamera; }
+
 		/**
 		 * These parameters are used in the lighting calculations of the surface of the mesh.
 		 */
@@ -43,11 +55,21 @@ namespace Imzadi
 		const SurfaceProperties& GetSurfaceProperties() const { return this->surfaceProperties; }
 		void SetSurfaceProperties(const SurfaceProperties& surfaceProperties) { this->surfaceProperties = surfaceProperties; }
 
+		/**
+		 * All instances draw with the same blend, rasterizer and depth-stencil states.
+		 * This is what they tell the render queue so that the states are set only once.
+		 */
+		static const uint32_t PIPELINE_STATE = 1;
+
 	protected:
 		std::map<int, Reference<RenderMeshAsset>> meshMap;
 		AxisAlignedBoundingBox objectSpaceBoundingBox;
 		Transform objectToWorld;
+		Transform previousObjectToWorld;		///< This is where we were before the last simulation step.
+		Transform simulatedObjectToWorld;		///< This is where we really are while being drawn somewhere in between.
+		bool hasPreviousObjectToWorld;
 		SurfaceProperties surfaceProperties;
 		bool drawPorts;
+		double lastDistanceToCamera;
 	};
 }
\ No newline at end of file
@@ -576,7 +576,7 @@ FPSRenderObject::FPSRenderObject()
 
 /*virtual*/ void FPSRenderObject::Prepare()
 {
-	this->deltaTimeList.push_back(Game::Get()->GetDeltaTime());
+	this->deltaTimeList.push_back(Game::Get()->GetFrameDeltaTime());
 	while (this->deltaTimeList.size() > this->deltaTimeListMaxSize)
 		this->deltaTimeList.pop_front();
 
@@ -0,0 +1,195 @@
+#include "RenderQueue.h"
+#include "Scene.h"
+#include "Camera.h"
+#include "Clock.h"
+#include "Profile.h"
+
+using namespace Imzadi;
+
+RenderQueue::RenderQueue()
+{
+	this->camera = nullptr;
+	this->renderPass = RenderPass::MAIN_PASS;
+	this->depthScale = 0.0;
+	::memset(&this->stats, 0, sizeof(Stats));
+	this->InvalidateBinds();
+}
+
+/*virtual*/ RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::Begin(Camera* camera, RenderPass renderPass)
+{
+	this->camera = camera;
+	this->renderPass = renderPass;
+	this->packetArray.clear();
+	::memset(&this->stats, 0, sizeof(Stats));
+
+	// Depth is quantized over the range of the view, so that the whole range of the key's depth bits is put to use.
+	double farClip = 0.0;
+	if (camera->GetViewMode() == Camera::ViewMode::ORTHOGRAPHIC)
+		farClip = camera->GetOrthographicParameters().farClip;
+	else
+		farClip = camera->GetFrustum().farClip;
+
+	this->depthScale = (farClip > 0.0) ? double((1 << DEPTH_BITS) - 1) / farClip : 0.0;
+}
+
+void RenderQueue::Submit(RenderObject* renderObject, int layer, Shader* shader, Texture* texture, RenderMeshAsset* mesh, double distance)
+{
+	uint32_t shaderId = this->GetResourceId(shader, (1 << SHADER_BITS) - 1);
+	uint32_t textureId = this->GetResourceId(texture, (1 << TEXTURE_BITS) - 1);
+	uint32_t depth = (uint32_t)IMZADI_CLAMP(distance * this->depthScale, 0.0, double((1 << DEPTH_BITS) - 1));
+
+	DrawPacket packet;
+	packet.sortKey = MakeSortKey(this->renderPass, MakeLayer(layer), shaderId, textureId, depth);
+	packet.renderObject = renderObject;
+	packet.shader = shader;
+	packet.texture = texture;
+	packet.mesh = mesh;
+	this->packetArray.push_back(packet);
+
+	this->stats.numPackets++;
+}
+
+/*static*/ uint64_t RenderQueue::MakeSortKey(uint32_t renderPass, uint32_t layer, uint32_t shaderId, uint32_t textureId, uint32_t depth)
+{
+	uint64_t sortKey = 0;
+	sortKey = (sortKey << PASS_BITS) | uint64_t(renderPass & ((1 << PASS_BITS) - 1));
+	sortKey = (sortKey << LAYER_BITS) | uint64_t(layer & ((1 << LAYER_BITS) - 1));
+	sortKey = (sortKey << SHADER_BITS) | uint64_t(shaderId & ((1 << SHADER_BITS) - 1));
+	sortKey = (sortKey << TEXTURE_BITS) | uint64_t(textureId & ((1 << TEXTURE_BITS) - 1));
+	sortKey = (sortKey << DEPTH_BITS) | uint64_t(depth & ((1 << DEPTH_BITS) - 1));
+	return sortKey;
+}
+
+/*static*/ uint32_t RenderQueue::MakeLayer(int sortKey)
+{
+	// The sky uses -INT_MAX and debug lines use INT_MAX, so these must land on the lowest and highest layers.
+	int halfRange = 1 << (LAYER_BITS - 1);
+	return uint32_t(IMZADI_CLAMP(sortKey, -halfRange, halfRange - 1) + halfRange);
+}
+
+uint32_t RenderQueue::GetResourceId(const void* resource, uint32_t maxId)
+{
+	if (!resource)
+		return 0;
+
+	uint32_t id = 0;
+	std::unordered_map<const void*, uint32_t>::iterator iter = this->resourceIdMap.find(resource);
+	if (iter != this->resourceIdMap.end())
+		id = iter->second;
+	else
+	{
+		id = (uint32_t)this->resourceIdMap.size() + 1;
+		this->resourceIdMap.insert(std::pair<const void*, uint32_t>(resource, id));
+	}
+
+	// If there are ever more resources than ids, some will share an id.  That only makes the sort group them less well.
+	return 1 + (id - 1) % maxId;
+}
+
+void RenderQueue::Sort()
+{
+	IMZADI_PROFILE("Render Queue Sort");
+
+	Clock clock;
+
+	uint32_t numPackets = (uint32_t)this->packetArray.size();
+	if (numPackets == 0)
+		return;
+
+	this->scratchPacketArray.resize(numPackets);
+
+	// Count, in one go, how often each value of each byte of the keys occurs.
+	static const int NUM_PASSES = sizeof(uint64_t);
+	uint32_t histogram[NUM_PASSES][256];
+	::memset(histogram, 0, sizeof(histogram));
+	for (const DrawPacket& packet : this->packetArray)
+		for (int i = 0; i < NUM_PASSES; i++)
+			histogram[i][(packet.sortKey >> (8 * i)) & 0xFF]++;
+
+	// Sort by each byte in turn, from least to most significant.  A byte that is the same in all keys
+	// doesn't change the order, and is skipped, which is common since most keys share a pass and layer.
+	std::vector<DrawPacket>* sourceArray = &this->packetArray;
+	std::vector<DrawPacket>* destinationArray = &this->scratchPacketArray;
+	for (int i = 0; i < NUM_PASSES; i++)
+	{
+		uint32_t* count = histogram[i];
+		if (count[(this->packetArray[0].sortKey >> (8 * i)) & 0xFF] == numPackets)
+			continue;
+
+		uint32_t offset[256];
+		uint32_t total = 0;
+		for (int j = 0; j < 256; j++)
+		{
+			offset[j] = total;
+			total += count[j];
+		}
+
+		for (const DrawPacket& packet : *sourceArray)
+			(*destinationArray)[offset[(packet.sortKey >> (8 * i)) & 0xFF]++] = packet;
+
+		std::swap(sourceArray, destinationArray);
+		this->stats.numSortPasses++;
+	}
+
+	if (sourceArray != &this->packetArray)
+		this->packetArray.swap(this->scratchPacketArray);
+
+	this->stats.sortMilliseconds = clock.GetCurrentTimeMilliseconds();
+}
+
+void RenderQueue::Execute()
+{
+	IMZADI_PROFILE("Render Queue Execute");
+
+	// We don't know what was bound before we got here.
+	this->InvalidateBinds();
+
+	for (const DrawPacket& packet : this->packetArray)
+		packet.renderObject->Draw(this->camera, this->renderPass, packet, *this);
+}
+
+void RenderQueue::InvalidateBinds()
+{
+	this->shaderBinding.valid = false;
+	this->textureBinding.valid = false;
+	this->meshBinding.valid = false;
+	this->pipelineStateBinding.valid = false;
+}
+
+bool RenderQueue::Bind(Binding& binding, const void* resource)
+{
+	if (binding.valid && binding.resource == resource)
+	{
+		this->stats.numBindsSaved++;
+		return false;
+	}
+
+	binding.resource = resource;
+	binding.valid = true;
+	this->stats.numBinds++;
+	return true;
+}
+
+bool RenderQueue::BindShader(const Shader* shader)
+{
+	return this->Bind(this->shaderBinding, shader);
+}
+
+bool RenderQueue::BindTexture(const Texture* texture)
+{
+	return this->Bind(this->textureBinding, texture);
+}
+
+bool RenderQueue::BindMesh(const RenderMeshAsset* mesh)
+{
+	return this->Bind(this->meshBinding, mesh);
+}
+
+bool RenderQueue::BindPipelineState(uint32_t pipelineState)
+{
+	return this->Bind(this->pipelineStateBinding, reinterpret_cast<const void*>(uintptr_t(pipelineState)));
+}
\ No newline at end of file
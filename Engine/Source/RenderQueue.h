@@ -0,0 +1,162 @@
+#pragma once
+
+#include "Defines.h"
+#include <vector>
+#include <unordered_map>
+
+namespace Imzadi
+{
+	class Camera;
+	class RenderObject;
+	class Shader;
+	class Texture;
+	class RenderMeshAsset;
+
+	enum RenderPass
+	{
+		MAIN_PASS,
+		SHADOW_PASS
+	};
+
+	/**
+	 * This is what a render object leaves in the render queue for each draw-call it wants
+	 * made.  The resources are only remembered here so that the render object needn't look
+	 * them up again when it's asked to draw, and so that the queue can tell which of them
+	 * are already bound.  The queue itself never dereferences them.
+	 */
+	struct DrawPacket
+	{
+		uint64_t sortKey;
+		RenderObject* renderObject;
+		Shader* shader;
+		Texture* texture;
+		RenderMeshAsset* mesh;
+	};
+
+	/**
+	 * Rather than have each visible render object draw itself in whatever order they
+	 * were found, the scene has them each submit draw packets to this queue.  Each packet
+	 * gets a 64-bit key made, from most to least significant bits, of the render pass, the
+	 * object's layer (see RenderObject::SortKey), and then of its shader, its texture and
+	 * its distance from the camera.  Sorting by this key, which is done with a radix sort,
+	 * keeps the layers in order, but within a layer puts draws sharing a shader, and then a
+	 * texture, next to one another, and otherwise draws front-to-back.
+	 *
+	 * While the queue is executed, it keeps track of what is bound to the device context
+	 * so that render objects can skip binding what is already there.  It also counts how
+	 * many binds were made and how many were saved this way.
+	 *
+	 * None of this touches the GPU, so building and sorting the queue can be tested without one.
+	 */
+	class IMZADI_API RenderQueue
+	{
+	public:
+		RenderQueue();
+		virtual ~RenderQueue();
+
+		static const int PASS_BITS = 2;
+		static const int LAYER_BITS = 8;
+		static const int SHADER_BITS = 14;
+		static const int TEXTURE_BITS = 16;
+		static const int DEPTH_BITS = 24;
+
+		/**
+		 * Empty the queue in preparation for submissions from the given camera's view.
+		 */
+		void Begin(Camera* camera, RenderPass renderPass);
+
+		/**
+		 * Add a draw packet to the queue.
+		 *
+		 * @param[in] renderObject This is the render object that will be asked to draw the packet.
+		 * @param[in] layer This is typically what the render object returns from RenderObject::SortKey.  Lower layers draw first.
+		 * @param[in] shader This is the shader the draw will use, if any.
+		 * @param[in] texture This is the texture the draw will use, if any.
+		 * @param[in] mesh This is the mesh the draw will use, if any.
+		 * @param[in] distance This is the distance from the camera to what gets drawn.
+		 */
+		void Submit(RenderObject* renderObject, int layer, Shader* shader, Texture* texture, RenderMeshAsset* mesh, double distance);
+
+		/**
+		 * Put the submitted packets in the order of their keys.  The sort is stable.
+		 */
+		void Sort();
+
+		/**
+		 * Have each packet, in order, drawn by the render object that submitted it.
+		 */
+		void Execute();
+
+		/**
+		 * These are called by render objects as they draw a packet.  Each returns true
+		 * if the given resource needs to be bound, or false if it is already bound, and
+		 * remembers it as being bound either way.
+		 */
+		bool BindShader(const Shader* shader);
+		bool BindTexture(const Texture* texture);
+		bool BindMesh(const RenderMeshAsset* mesh);
+		bool BindPipelineState(uint32_t pipelineState);
+
+		/**
+		 * Forget what is bound.  This must be called by anything that binds to the device
+		 * context without going through the queue.
+		 */
+		void InvalidateBinds();
+
+		/**
+		 * Make a sort key out of its parts.  Each part is masked to the bits it has in the key.
+		 */
+		static uint64_t MakeSortKey(uint32_t renderPass, uint32_t layer, uint32_t shaderId, uint32_t textureId, uint32_t depth);
+
+		/**
+		 * Map the given RenderObject::SortKey value to a layer that fits in a sort key.
+		 * Values too big or too small to fit are sent to the highest or lowest layer.
+		 */
+		static uint32_t MakeLayer(int sortKey);
+
+		/**
+		 * Return a small number that stands for the given resource in sort keys.  The same
+		 * resource gets the same number from one frame to the next.  Null is always zero.
+		 */
+		uint32_t GetResourceId(const void* resource, uint32_t maxId);
+
+		uint32_t GetNumPackets() const { return (uint32_t)this->packetArray.size(); }
+		const DrawPacket& GetPacket(uint32_t i) const { return this->packetArray[i]; }
+
+		struct Stats
+		{
+			uint32_t numPackets;			///< This is how many draw packets were submitted.
+			uint32_t numBinds;				///< This is how many resources had to be bound.
+			uint32_t numBindsSaved;			///< This is how many binds were skipped because the resource was already bound.
+			uint32_t numSortPasses;			///< This is how many of the radix sort's passes weren't skipped.
+			double sortMilliseconds;		///< This is how long the sort took.
+		};
+
+		const Stats& GetStats() const { return this->stats; }
+
+	private:
+
+		/**
+		 * This is what we believe to be bound to one slot of the device context.
+		 */
+		struct Binding
+		{
+			const void* resource;
+			bool valid;
+		};
+
+		bool Bind(Binding& binding, const void* resource);
+
+		Camera* camera;
+		RenderPass renderPass;
+		double depthScale;
+		std::vector<DrawPacket> packetArray;
+		std::vector<DrawPacket> scratchPacketArray;
+		std::unordered_map<const void*, uint32_t> resourceIdMap;
+		Binding shaderBinding;
+		Binding textureBinding;
+		Binding meshBinding;
+		Binding pipelineStateBinding;
+		Stats stats;
+	};
+}
\ No newline at end of file
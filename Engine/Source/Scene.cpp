@@ -2,7 +2,6 @@
 #include "Camera.h"
 #include "Game.h"
 #include "RenderObjects/DebugLines.h"
-#include <algorithm>
 #include <format>
 
 using namespace Imzadi;
@@ -11,6 +10,8 @@ using namespace Imzadi;
 
 Scene::Scene()
 {
+	::memset(this->cullStats, 0, sizeof(this->cullStats));
+	::memset(this->renderQueueStats, 0, sizeof(this->renderQueueStats));
 }
 
 /*virtual*/ Scene::~Scene()
@@ -20,6 +21,8 @@ Scene::Scene()
 
 void Scene::Clear()
 {
+	this->sceneTree.Clear();
+	this->occlusionCuller.Clear();
 	this->renderObjectMap.clear();
 }
 
@@ -43,6 +46,7 @@ bool Scene::AddRenderObject(Reference<RenderObject> renderObject, bool adjustNam
 	}
 
 	this->renderObjectMap.insert(std::pair<std::string, Reference<RenderObject>>(name, renderObject));
+	this->sceneTree.Insert(renderObject.Get());
 	renderObject->OnPostAdded();
 	return true;
 }
@@ -57,6 +61,7 @@ bool Scene::RemoveRenderObject(const std::string& name, Reference<RenderObject>*
 		renderObject->Set(iter->second);
 
 	iter->second->OnPreRemoved();
+	this->sceneTree.Remove(iter->second.Get());
 	this->renderObjectMap.erase(iter);
 	return true;
 }
@@ -75,7 +80,7 @@ void Scene::DrawVisibilityBoxes()
 {
 	DebugLines* debugLines = Game::Get()->GetDebugLines();
 
-	for (auto pair : this->renderObjectMap)
+	for (auto& pair : this->renderObjectMap)
 	{
 		RenderObject* renderObject = pair.second.Get();
 		if (!renderObject->IsHidden())
@@ -95,30 +100,36 @@ void Scene::DrawVisibilityBoxes()
 void Scene::Render(Camera* camera, RenderPass renderPass)
 {
 	std::vector<RenderObject*> visibleObjects;
+	this->sceneTree.FindVisibleObjects(camera, visibleObjects, &this->cullStats[renderPass]);
 
-	for (auto pair : this->renderObjectMap)
+	// Shadows can be cast by what the camera can't see, so only the main pass is culled by occlusion.
+	bool cullOccluded = renderPass == RenderPass::MAIN_PASS && this->occlusionCuller.Rasterize(camera, Game::Get()->GetJobSystem());
+
+	this->renderQueue.Begin(camera, renderPass);
+
+	for (RenderObject* renderObject : visibleObjects)
 	{
-		RenderObject* renderObject = pair.second.Get();
-		if (renderObject->IsHidden())
+		if (renderObject->IsHidden() || (cullOccluded && this->occlusionCuller.IsOccluded(renderObject)))
 			continue;
 
-		if (!camera->IsApproximatelyVisible(renderObject))
-			continue;
-			
-		visibleObjects.push_back(renderObject);
+		renderObject->Submit(camera, renderPass, this->renderQueue);
 	}
 
-	std::sort(visibleObjects.begin(), visibleObjects.end(), [](const RenderObject* objectA, const RenderObject* objectB) -> bool {
-		return objectA->SortKey() < objectB->SortKey();
-	});
+	this->renderQueue.Sort();
+	this->renderQueue.Execute();
 
-	for (RenderObject* renderObject : visibleObjects)
-		renderObject->Render(camera, renderPass);
+	const RenderQueue::Stats& stats = this->renderQueue.GetStats();
+	RenderQueue::Stats& frameStats = this->renderQueueStats[renderPass];
+	frameStats.numPackets += stats.numPackets;
+	frameStats.numBinds += stats.numBinds;
+	frameStats.numBindsSaved += stats.numBindsSaved;
+	frameStats.numSortPasses += stats.numSortPasses;
+	frameStats.sortMilliseconds += stats.sortMilliseconds;
 }
 
 void Scene::PrepareRenderObjects()
 {
-	for (auto pair : this->renderObjectMap)
+	for (auto& pair : this->renderObjectMap)
 	{
 		RenderObject* renderObject = pair.second.Get();
 		renderObject->Prepare();
@@ -127,19 +138,53 @@ void Scene::PrepareRenderObjects()
 
 void Scene::PreRender()
 {
-	for (auto pair : this->renderObjectMap)
+	::memset(this->renderQueueStats, 0, sizeof(this->renderQueueStats));
+
+	for (auto& pair : this->renderObjectMap)
 	{
 		RenderObject* renderObject = pair.second.Get();
 		renderObject->PreRender();
+		this->sceneTree.Update(renderObject);
+	}
+
+	this->sceneTree.RebuildIfNecessary();
+}
+
+void Scene::SaveSimulationState()
+{
+	for (auto& pair : this->renderObjectMap)
+	{
+		RenderObject* renderObject = pair.second.Get();
+		renderObject->SaveSimulationState();
+	}
+}
+
+void Scene::BeginInterpolatedRender(double alpha)
+{
+	for (auto& pair : this->renderObjectMap)
+	{
+		RenderObject* renderObject = pair.second.Get();
+		renderObject->BeginInterpolatedRender(alpha);
+	}
+}
+
+void Scene::EndInterpolatedRender()
+{
+	for (auto& pair : this->renderObjectMap)
+	{
+		RenderObject* renderObject = pair.second.Get();
+		renderObject->EndInterpolatedRender();
 	}
 }
 
 //--------------------------- RenderObject ---------------------------
 
-RenderObject::RenderObject()
+// Render objects are only ever referenced on the main thread, so they don't need an atomic ref-count.
+RenderObject::RenderObject() : ReferenceCounted(RefCountPolicy::SINGLE_THREADED)
 {
 	this->hide = false;
 	this->name = std::format("{:#010x}", uintptr_t(this));
+	this->sceneTreeItem = -1;
 }
 
 /*virtual*/ RenderObject::~RenderObject()
@@ -151,6 +196,25 @@ RenderObject::RenderObject()
 	return 0;
 }
 
+/*virtual*/ void RenderObject::Submit(Camera* camera, RenderPass renderPass, RenderQueue& renderQueue)
+{
+	double distance = 0.0;
+	Vector3 center;
+	double radius = 0.0;
+	if (this->GetWorldBoundingSphere(center, radius))
+		distance = (center - camera->GetCameraToWorldTransform().translation).Length();
+
+	renderQueue.Submit(this, this->SortKey(), nullptr, nullptr, nullptr, distance);
+}
+
+/*virtual*/ void RenderObject::Draw(Camera* camera, RenderPass renderPass, const DrawPacket& packet, RenderQueue& renderQueue)
+{
+	this->Render(camera, renderPass);
+
+	// We have no idea what was bound by the render.
+	renderQueue.InvalidateBinds();
+}
+
 /*virtual*/ void RenderObject::Prepare()
 {
 }
@@ -159,6 +223,18 @@ RenderObject::RenderObject()
 {
 }
 
+/*virtual*/ void RenderObject::SaveSimulationState()
+{
+}
+
+/*virtual*/ void RenderObject::BeginInterpolatedRender(double alpha)
+{
+}
+
+/*virtual*/ void RenderObject::EndInterpolatedRender()
+{
+}
+
 /*virtual*/ void RenderObject::OnPostAdded()
 {
 }
@@ -2,6 +2,9 @@
 
 #include "Reference.h"
 #include "Math/AxisAlignedBoundingBox.h"
+#include "SceneTree.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
 #include <list>
 #include <unordered_map>
 
@@ -10,20 +13,18 @@ namespace Imzadi
 	class RenderObject;
 	class Camera;
 
-	enum RenderPass
-	{
-		MAIN_PASS,
-		SHADOW_PASS
-	};
-
 	/**
 	 * This class represents the entire renderable scene and how we're viewing it.
 	 * It is a collection of RenderObject instances and can be asked to draw each frame.
 	 * 
 	 * The scene here doesn't organize render objects into a hierarchy.  Maybe it should,
-	 * but for now it doesn't.  There's also no spacial sorting going on here for the
-	 * expidition of visible surface determination.  For now, I'm just doing a frustum
-	 * check for each render object.
+	 * but for now it doesn't.  It does, however, keep them sorted spacially in a SceneTree,
+	 * which is brought up-to-date with where they are once a frame, in PreRender, so that
+	 * each render pass only has to look at the parts of the scene its camera can see.
+	 *
+	 * Visible render objects don't draw themselves right away.  They submit draw packets
+	 * to a RenderQueue, which sorts them so that draws sharing resources are made one
+	 * after another, and so that binding those resources again can be skipped.
 	 */
 	class IMZADI_API Scene : public ReferenceCounted
 	{
@@ -99,22 +100,76 @@ namespace Imzadi
 		 */
 		void PreRender();
 
+		/**
+		 * When the game runs its simulation at a fixed rate, this is called before each
+		 * simulation step so that render objects can remember where they were.
+		 */
+		void SaveSimulationState();
+
+		/**
+		 * Have all render objects show themselves the given fraction of the way from
+		 * their state before the last simulation step to their state after it.
+		 *
+		 * @param[in] alpha This is in the range [0,1], and is how far we are into the next simulation step.
+		 */
+		void BeginInterpolatedRender(double alpha);
+
+		/**
+		 * Put all render objects back into their simulated state after rendering.
+		 */
+		void EndInterpolatedRender();
+
 		/**
 		 * This is used for debugging purposes so that we can visualize the bounding
 		 * boxes used to cull render objects against the view frustum.
 		 */
 		void DrawVisibilityBoxes();
 
+		/**
+		 * Return the number of render objects in the scene.
+		 */
+		uint32_t GetNumRenderObjects() const { return (uint32_t)this->renderObjectMap.size(); }
+
+		/**
+		 * Get read-only access to the spatial index of the scene's render objects.
+		 */
+		const SceneTree& GetSceneTree() const { return this->sceneTree; }
+
+		/**
+		 * Return how much work culling took in the last render of the given pass.
+		 */
+		const SceneTree::CullStats& GetCullStats(RenderPass renderPass) const { return this->cullStats[renderPass]; }
+
+		/**
+		 * Get access to what culls render objects hidden behind the level's geometry in the main pass.
+		 */
+		OcclusionCuller* GetOcclusionCuller() { return &this->occlusionCuller; }
+
+		/**
+		 * Return how many draw packets were queued in the given pass, and how many binds were
+		 * made and saved drawing them, totaled over all renders of that pass since the last PreRender.
+		 */
+		const RenderQueue::Stats& GetRenderQueueStats(RenderPass renderPass) const { return this->renderQueueStats[renderPass]; }
+
 	private:
 		typedef std::unordered_map<std::string, Reference<RenderObject>> RenderObjectMap;
 		RenderObjectMap renderObjectMap;
+		SceneTree sceneTree;
+		SceneTree::CullStats cullStats[2];
+		OcclusionCuller occlusionCuller;
+		RenderQueue renderQueue;
+		RenderQueue::Stats renderQueueStats[2];
 	};
 
 	/**
 	 * This is the base class for anything that can get rendered in the scene.
+	 * Render objects must only be referenced on the main thread, since their
+	 * ref-counts are not maintained atomically.
 	 */
 	class IMZADI_API RenderObject : public ReferenceCounted
 	{
+		friend class SceneTree;
+
 	public:
 		RenderObject();
 		virtual ~RenderObject();
@@ -128,6 +183,30 @@ namespace Imzadi
 		 */
 		virtual void Render(Camera* camera, RenderPass renderPass) = 0;
 
+		/**
+		 * Put whatever draw packets this object needs drawn into the given render queue.
+		 * By default, a single packet is submitted in our @ref SortKey layer, which
+		 * gets drawn by calling @ref Render.  Override this, along with @ref Draw, to let
+		 * the queue sort the draws by the resources they use.
+		 *
+		 * @param[in] camera This is the camera that is being used to render.
+		 * @param[in] renderPass This tells you what render pass we're doing.
+		 * @param[in] renderQueue This is where the packets are submitted.
+		 */
+		virtual void Submit(Camera* camera, RenderPass renderPass, RenderQueue& renderQueue);
+
+		/**
+		 * Make the draw-calls for one of the packets we submitted.  By default, this calls
+		 * @ref Render, and then tells the queue that anything might have been bound.  An
+		 * override should only skip binding what the queue says is already bound.
+		 *
+		 * @param[in] camera This is the camera that is being used to render.
+		 * @param[in] renderPass This tells you what render pass we're doing.
+		 * @param[in] packet This is the packet to draw.
+		 * @param[in] renderQueue This is the queue being executed, which keeps track of what is bound.
+		 */
+		virtual void Draw(Camera* camera, RenderPass renderPass, const DrawPacket& packet, RenderQueue& renderQueue);
+
 		/**
 		 * This is used to perform a frustum culling check.  If this render
 		 * object can't be seen by a frustum, then it is not rendered in
@@ -151,6 +230,15 @@ namespace Imzadi
 		 */
 		virtual void PreRender();
 
+		/**
+		 * These let a render object be drawn between simulation steps when the game runs
+		 * its simulation at a fixed rate.  See the same methods of the Scene class.  They do
+		 * nothing by default, which means the object is drawn as of the last simulation step.
+		 */
+		virtual void SaveSimulationState();
+		virtual void BeginInterpolatedRender(double alpha);
+		virtual void EndInterpolatedRender();
+
 		/**
 		 * This is called just after this object has been added to the scene.
 		 */
@@ -178,5 +266,6 @@ namespace Imzadi
 	private:
 		bool hide;
 		std::string name;
+		int sceneTreeItem;
 	};
 }
\ No newline at end of file
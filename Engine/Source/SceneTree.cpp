@@ -0,0 +1,544 @@
+#include "SceneTree.h"
+#include "Scene.h"
+#include "Camera.h"
+#include "Log.h"
+#include "Math/Plane.h"
+#include <xmmintrin.h>
+#include <math.h>
+#include <float.h>
+
+using namespace Imzadi;
+
+#define IMZADI_SCENE_TREE_MAX_PLANES		8
+
+/**
+ * These are the planes of a frustum, relative to the center of the tree, in the
+ * forms we need them for testing cells in doubles, and spheres in floats.
+ */
+struct SceneTree::CullPlanes
+{
+	int numPlanes;
+	double normalX[IMZADI_SCENE_TREE_MAX_PLANES];
+	double normalY[IMZADI_SCENE_TREE_MAX_PLANES];
+	double normalZ[IMZADI_SCENE_TREE_MAX_PLANES];
+	double distance[IMZADI_SCENE_TREE_MAX_PLANES];
+	__m128 packedNormalX[IMZADI_SCENE_TREE_MAX_PLANES];
+	__m128 packedNormalY[IMZADI_SCENE_TREE_MAX_PLANES];
+	__m128 packedNormalZ[IMZADI_SCENE_TREE_MAX_PLANES];
+	__m128 packedDistance[IMZADI_SCENE_TREE_MAX_PLANES];	///< These are pushed out a bit to make up for the spheres being stored in floats.
+};
+
+SceneTree::SceneTree()
+{
+	this->rootCell = -1;
+	this->rootHalfSize = 0.0;
+	this->numRebuilds = 0;
+}
+
+/*virtual*/ SceneTree::~SceneTree()
+{
+}
+
+void SceneTree::Clear()
+{
+	for (Item& item : this->itemArray)
+		if (item.renderObject)
+			item.renderObject->sceneTreeItem = -1;
+
+	this->itemArray.clear();
+	this->freeItemArray.clear();
+	this->cellArray.clear();
+	this->freeCellArray.clear();
+	this->overflowItemArray.clear();
+	this->unboundedItemArray.clear();
+	this->rootCell = -1;
+	this->rootCenter = Vector3(0.0, 0.0, 0.0);
+	this->rootHalfSize = 0.0;
+}
+
+bool SceneTree::Insert(RenderObject* renderObject)
+{
+	if (renderObject->sceneTreeItem >= 0)
+	{
+		IMZADI_LOG_ERROR("Render object \"%s\" is already in a scene tree.", renderObject->GetName().c_str());
+		return false;
+	}
+
+	int itemIndex = -1;
+	if (this->freeItemArray.size() > 0)
+	{
+		itemIndex = this->freeItemArray.back();
+		this->freeItemArray.pop_back();
+	}
+	else
+	{
+		itemIndex = (int)this->itemArray.size();
+		this->itemArray.push_back(Item{});
+	}
+
+	Item& item = this->itemArray[itemIndex];
+	item.renderObject = renderObject;
+	if (!renderObject->GetWorldBoundingSphere(item.center, item.radius))
+		item.radius = -1.0;
+
+	renderObject->sceneTreeItem = itemIndex;
+	this->Place(itemIndex);
+	return true;
+}
+
+bool SceneTree::Remove(RenderObject* renderObject)
+{
+	int itemIndex = renderObject->sceneTreeItem;
+	if (!(0 <= itemIndex && itemIndex < (int)this->itemArray.size()) || this->itemArray[itemIndex].renderObject != renderObject)
+	{
+		IMZADI_LOG_ERROR("Render object \"%s\" is not in this scene tree.", renderObject->GetName().c_str());
+		return false;
+	}
+
+	this->Unplace(itemIndex);
+	this->itemArray[itemIndex].renderObject = nullptr;
+	this->freeItemArray.push_back(itemIndex);
+	renderObject->sceneTreeItem = -1;
+	return true;
+}
+
+void SceneTree::Update(RenderObject* renderObject)
+{
+	int itemIndex = renderObject->sceneTreeItem;
+	if (itemIndex < 0)
+		return;
+
+	Item& item = this->itemArray[itemIndex];
+
+	Vector3 center;
+	double radius = 0.0;
+	if (!renderObject->GetWorldBoundingSphere(center, radius))
+		radius = -1.0;
+
+	if (radius < 0.0)
+	{
+		if (item.cell == UNBOUNDED_CELL)
+			return;
+	}
+	else if (item.cell >= 0)
+	{
+		// Most objects don't move at all.
+		if (center.x == item.center.x && center.y == item.center.y && center.z == item.center.z && radius == item.radius)
+			return;
+
+		// Of those that do, most are still in their cell, still a good size for it, and we just need to record where they are now.
+		Cell& cell = this->cellArray[item.cell];
+		if (::fabs(center.x - cell.center.x) <= cell.halfSize &&
+			::fabs(center.y - cell.center.y) <= cell.halfSize &&
+			::fabs(center.z - cell.center.z) <= cell.halfSize &&
+			radius <= cell.halfSize && (item.level == MAX_LEVEL || 2.0 * radius > cell.halfSize))
+		{
+			item.center = center;
+			item.radius = radius;
+			this->SetSphere(cell, item.slot, item);
+			return;
+		}
+	}
+
+	this->Unplace(itemIndex);
+	item.center = center;
+	item.radius = radius;
+	this->Place(itemIndex);
+}
+
+void SceneTree::RebuildIfNecessary()
+{
+	uint32_t numOverflowObjects = (uint32_t)this->overflowItemArray.size();
+	if (numOverflowObjects == 0)
+		return;
+
+	uint32_t numBoundedObjects = this->GetNumObjects() - this->GetNumUnboundedObjects();
+	if (this->rootCell >= 0 && (numOverflowObjects < 32 || 8 * numOverflowObjects < numBoundedObjects))
+		return;
+
+	this->Rebuild();
+}
+
+void SceneTree::Rebuild()
+{
+	Vector3 minCorner(DBL_MAX, DBL_MAX, DBL_MAX);
+	Vector3 maxCorner(-DBL_MAX, -DBL_MAX, -DBL_MAX);
+	bool anyBounded = false;
+
+	for (const Item& item : this->itemArray)
+	{
+		if (!item.renderObject || item.cell == UNBOUNDED_CELL)
+			continue;
+
+		minCorner.x = IMZADI_MIN(minCorner.x, item.center.x - item.radius);
+		minCorner.y = IMZADI_MIN(minCorner.y, item.center.y - item.radius);
+		minCorner.z = IMZADI_MIN(minCorner.z, item.center.z - item.radius);
+		maxCorner.x = IMZADI_MAX(maxCorner.x, item.center.x + item.radius);
+		maxCorner.y = IMZADI_MAX(maxCorner.y, item.center.y + item.radius);
+		maxCorner.z = IMZADI_MAX(maxCorner.z, item.center.z + item.radius);
+		anyBounded = true;
+	}
+
+	if (!anyBounded)
+		return;
+
+	// Leave some room around everything so that things moving about at the edges don't fall right out again.
+	Vector3 halfExtents = (maxCorner - minCorner) / 2.0;
+	this->rootCenter = (minCorner + maxCorner) / 2.0;
+	this->rootHalfSize = IMZADI_MAX(1.0, 1.25 * IMZADI_MAX(halfExtents.x, IMZADI_MAX(halfExtents.y, halfExtents.z)));
+
+	this->cellArray.clear();
+	this->freeCellArray.clear();
+	this->overflowItemArray.clear();
+	this->rootCell = this->AllocateCell(this->rootCenter, this->rootHalfSize, -1);
+
+	for (int i = 0; i < (int)this->itemArray.size(); i++)
+	{
+		const Item& item = this->itemArray[i];
+		if (item.renderObject && item.cell != UNBOUNDED_CELL)
+			this->Place(i);
+	}
+
+	this->numRebuilds++;
+}
+
+int SceneTree::AllocateCell(const Vector3& center, double halfSize, int parentCell)
+{
+	int cellIndex = -1;
+	if (this->freeCellArray.size() > 0)
+	{
+		cellIndex = this->freeCellArray.back();
+		this->freeCellArray.pop_back();
+	}
+	else
+	{
+		cellIndex = (int)this->cellArray.size();
+		this->cellArray.push_back(Cell{});
+	}
+
+	Cell& cell = this->cellArray[cellIndex];
+	cell.center = center;
+	cell.halfSize = halfSize;
+	cell.parentCell = parentCell;
+	cell.numItemsInSubtree = 0;
+	for (int i = 0; i < 8; i++)
+		cell.childCell[i] = -1;
+
+	return cellIndex;
+}
+
+void SceneTree::FreeCell(int cellIndex)
+{
+	Cell& cell = this->cellArray[cellIndex];
+	cell.itemArray.clear();
+	cell.centerX.clear();
+	cell.centerY.clear();
+	cell.centerZ.clear();
+	cell.radius.clear();
+	this->freeCellArray.push_back(cellIndex);
+}
+
+bool SceneTree::LocateCell(const Vector3& center, double radius, int& level, int& cellX, int& cellY, int& cellZ) const
+{
+	if (this->rootCell < 0 || radius < 0.0)
+		return false;
+
+	double rootSize = 2.0 * this->rootHalfSize;
+	if (2.0 * radius > rootSize)
+		return false;
+
+	Vector3 offset = center - this->rootCenter + Vector3(this->rootHalfSize, this->rootHalfSize, this->rootHalfSize);
+	if (!(0.0 <= offset.x && offset.x <= rootSize && 0.0 <= offset.y && offset.y <= rootSize && 0.0 <= offset.z && offset.z <= rootSize))
+		return false;
+
+	// Go as deep as we can while the cells are still at least as wide as the sphere.
+	level = MAX_LEVEL;
+	if (radius > 0.0)
+		level = IMZADI_CLAMP(int(::floor(::log2(rootSize / (2.0 * radius)))), 0, MAX_LEVEL);
+
+	int numCells = 1 << level;
+	double cellSize = rootSize / double(numCells);
+	cellX = IMZADI_CLAMP(int(offset.x / cellSize), 0, numCells - 1);
+	cellY = IMZADI_CLAMP(int(offset.y / cellSize), 0, numCells - 1);
+	cellZ = IMZADI_CLAMP(int(offset.z / cellSize), 0, numCells - 1);
+	return true;
+}
+
+void SceneTree::Place(int itemIndex)
+{
+	Item& item = this->itemArray[itemIndex];
+
+	if (item.radius < 0.0)
+	{
+		item.cell = UNBOUNDED_CELL;
+		item.slot = (int)this->unboundedItemArray.size();
+		this->unboundedItemArray.push_back(itemIndex);
+		return;
+	}
+
+	if (!this->LocateCell(item.center, item.radius, item.level, item.cellX, item.cellY, item.cellZ))
+	{
+		item.cell = OVERFLOW_CELL;
+		item.slot = (int)this->overflowItemArray.size();
+		this->overflowItemArray.push_back(itemIndex);
+		return;
+	}
+
+	int cellIndex = this->rootCell;
+	this->cellArray[cellIndex].numItemsInSubtree++;
+
+	for (int i = item.level - 1; i >= 0; i--)
+	{
+		int bitX = (item.cellX >> i) & 1;
+		int bitY = (item.cellY >> i) & 1;
+		int bitZ = (item.cellZ >> i) & 1;
+		int childIndex = bitX | (bitY << 1) | (bitZ << 2);
+
+		int childCell = this->cellArray[cellIndex].childCell[childIndex];
+		if (childCell < 0)
+		{
+			double halfSize = this->cellArray[cellIndex].halfSize / 2.0;
+			Vector3 center = this->cellArray[cellIndex].center + Vector3(bitX ? halfSize : -halfSize, bitY ? halfSize : -halfSize, bitZ ? halfSize : -halfSize);
+			childCell = this->AllocateCell(center, halfSize, cellIndex);
+			this->cellArray[cellIndex].childCell[childIndex] = childCell;
+		}
+
+		cellIndex = childCell;
+		this->cellArray[cellIndex].numItemsInSubtree++;
+	}
+
+	Cell& cell = this->cellArray[cellIndex];
+	item.cell = cellIndex;
+	item.slot = (int)cell.itemArray.size();
+	cell.itemArray.push_back(itemIndex);
+	cell.centerX.push_back(0.0f);
+	cell.centerY.push_back(0.0f);
+	cell.centerZ.push_back(0.0f);
+	cell.radius.push_back(0.0f);
+	this->SetSphere(cell, item.slot, item);
+}
+
+void SceneTree::Unplace(int itemIndex)
+{
+	const Item& item = this->itemArray[itemIndex];
+
+	if (item.cell < 0)
+	{
+		std::vector<int>& sideItemArray = (item.cell == OVERFLOW_CELL) ? this->overflowItemArray : this->unboundedItemArray;
+		int lastItemIndex = sideItemArray.back();
+		sideItemArray[item.slot] = lastItemIndex;
+		this->itemArray[lastItemIndex].slot = item.slot;
+		sideItemArray.pop_back();
+		return;
+	}
+
+	// Move the last item of the cell into the vacated slot.
+	Cell& cell = this->cellArray[item.cell];
+	int lastSlot = (int)cell.itemArray.size() - 1;
+	if (item.slot != lastSlot)
+	{
+		int lastItemIndex = cell.itemArray[lastSlot];
+		cell.itemArray[item.slot] = lastItemIndex;
+		cell.centerX[item.slot] = cell.centerX[lastSlot];
+		cell.centerY[item.slot] = cell.centerY[lastSlot];
+		cell.centerZ[item.slot] = cell.centerZ[lastSlot];
+		cell.radius[item.slot] = cell.radius[lastSlot];
+		this->itemArray[lastItemIndex].slot = item.slot;
+	}
+
+	cell.itemArray.pop_back();
+	cell.centerX.pop_back();
+	cell.centerY.pop_back();
+	cell.centerZ.pop_back();
+	cell.radius.pop_back();
+
+	// Cells left with nothing in them are pruned on the way back up.  Their children were already pruned.
+	int cellIndex = item.cell;
+	while (cellIndex >= 0)
+	{
+		Cell& ancestorCell = this->cellArray[cellIndex];
+		int parentCell = ancestorCell.parentCell;
+
+		if (--ancestorCell.numItemsInSubtree == 0 && cellIndex != this->rootCell)
+		{
+			Cell& parent = this->cellArray[parentCell];
+			for (int i = 0; i < 8; i++)
+				if (parent.childCell[i] == cellIndex)
+					parent.childCell[i] = -1;
+
+			this->FreeCell(cellIndex);
+		}
+
+		cellIndex = parentCell;
+	}
+}
+
+void SceneTree::SetSphere(Cell& cell, int slot, const Item& item)
+{
+	cell.centerX[slot] = float(item.center.x - this->rootCenter.x);
+	cell.centerY[slot] = float(item.center.y - this->rootCenter.y);
+	cell.centerZ[slot] = float(item.center.z - this->rootCenter.z);
+	cell.radius[slot] = float(item.radius);
+}
+
+void SceneTree::FindVisibleObjects(const Camera* camera, std::vector<RenderObject*>& visibleObjectArray, CullStats* cullStats /*= nullptr*/) const
+{
+	CullStats localCullStats{};
+	uint32_t initialSize = (uint32_t)visibleObjectArray.size();
+
+	std::vector<Plane> planeArray;
+	if (!camera->GetWorldFrustumPlanes(planeArray) || planeArray.size() > IMZADI_SCENE_TREE_MAX_PLANES)
+	{
+		for (const Item& item : this->itemArray)
+			if (item.renderObject)
+				visibleObjectArray.push_back(item.renderObject);
+	}
+	else
+	{
+		for (int itemIndex : this->unboundedItemArray)
+			visibleObjectArray.push_back(this->itemArray[itemIndex].renderObject);
+
+		for (int itemIndex : this->overflowItemArray)
+		{
+			const Item& item = this->itemArray[itemIndex];
+			localCullStats.numSpheresTested++;
+
+			bool visible = true;
+			for (const Plane& plane : planeArray)
+			{
+				if (plane.SignedDistanceTo(item.center) >= item.radius)
+				{
+					visible = false;
+					break;
+				}
+			}
+
+			if (visible)
+				visibleObjectArray.push_back(item.renderObject);
+		}
+
+		if (this->rootCell >= 0 && this->cellArray[this->rootCell].numItemsInSubtree > 0)
+		{
+			// Rounding the spheres to floats could put them a hair off from where they really are,
+			// but being a hair too generous with what we call visible doesn't matter.
+			float margin = float(1e-5 * this->rootHalfSize);
+
+			CullPlanes cullPlanes;
+			cullPlanes.numPlanes = (int)planeArray.size();
+			for (int i = 0; i < cullPlanes.numPlanes; i++)
+			{
+				const Plane& plane = planeArray[i];
+				cullPlanes.normalX[i] = plane.unitNormal.x;
+				cullPlanes.normalY[i] = plane.unitNormal.y;
+				cullPlanes.normalZ[i] = plane.unitNormal.z;
+				cullPlanes.distance[i] = plane.unitNormal.Dot(plane.center - this->rootCenter);
+				cullPlanes.packedNormalX[i] = _mm_set1_ps(float(cullPlanes.normalX[i]));
+				cullPlanes.packedNormalY[i] = _mm_set1_ps(float(cullPlanes.normalY[i]));
+				cullPlanes.packedNormalZ[i] = _mm_set1_ps(float(cullPlanes.normalZ[i]));
+				cullPlanes.packedDistance[i] = _mm_set1_ps(float(cullPlanes.distance[i]) + margin);
+			}
+
+			this->CullCell(this->rootCell, cullPlanes, (1 << cullPlanes.numPlanes) - 1, visibleObjectArray, localCullStats);
+		}
+	}
+
+	localCullStats.numObjectsVisible = (uint32_t)visibleObjectArray.size() - initialSize;
+	if (cullStats)
+		*cullStats = localCullStats;
+}
+
+void SceneTree::CullCell(int cellIndex, const CullPlanes& cullPlanes, uint32_t planeMask, std::vector<RenderObject*>& visibleObjectArray, CullStats& cullStats) const
+{
+	const Cell& cell = this->cellArray[cellIndex];
+	cullStats.numCellsVisited++;
+
+	// Test the cell's loose bounds against each plane it isn't already known to be behind.
+	Vector3 center = cell.center - this->rootCenter;
+	double looseHalfSize = 2.0 * cell.halfSize;
+	for (int i = 0; i < cullPlanes.numPlanes; i++)
+	{
+		if ((planeMask & (1 << i)) == 0)
+			continue;
+
+		double signedDistance = cullPlanes.normalX[i] * center.x + cullPlanes.normalY[i] * center.y + cullPlanes.normalZ[i] * center.z - cullPlanes.distance[i];
+		double extent = looseHalfSize * (::fabs(cullPlanes.normalX[i]) + ::fabs(cullPlanes.normalY[i]) + ::fabs(cullPlanes.normalZ[i]));
+		if (signedDistance >= extent)
+			return;
+
+		if (signedDistance <= -extent)
+			planeMask &= ~(1 << i);
+	}
+
+	if (planeMask == 0)
+	{
+		cullStats.numCellsAccepted++;
+		this->CollectSubtree(cellIndex, visibleObjectArray);
+		return;
+	}
+
+	// The cell straddles at least one plane, so test its spheres against those planes, four at a time.
+	int numItems = (int)cell.itemArray.size();
+	cullStats.numSpheresTested += numItems;
+	int i = 0;
+	for (; i + 4 <= numItems; i += 4)
+	{
+		__m128 centerX = _mm_loadu_ps(&cell.centerX[i]);
+		__m128 centerY = _mm_loadu_ps(&cell.centerY[i]);
+		__m128 centerZ = _mm_loadu_ps(&cell.centerZ[i]);
+		__m128 radius = _mm_loadu_ps(&cell.radius[i]);
+		__m128 outside = _mm_setzero_ps();
+
+		for (int j = 0; j < cullPlanes.numPlanes; j++)
+		{
+			if ((planeMask & (1 << j)) == 0)
+				continue;
+
+			__m128 signedDistance = _mm_mul_ps(centerX, cullPlanes.packedNormalX[j]);
+			signedDistance = _mm_add_ps(signedDistance, _mm_mul_ps(centerY, cullPlanes.packedNormalY[j]));
+			signedDistance = _mm_add_ps(signedDistance, _mm_mul_ps(centerZ, cullPlanes.packedNormalZ[j]));
+			signedDistance = _mm_sub_ps(signedDistance, cullPlanes.packedDistance[j]);
+			outside = _mm_or_ps(outside, _mm_cmpge_ps(signedDistance, radius));
+		}
+
+		int outsideBits = _mm_movemask_ps(outside);
+		for (int k = 0; k < 4; k++)
+			if ((outsideBits & (1 << k)) == 0)
+				visibleObjectArray.push_back(this->itemArray[cell.itemArray[i + k]].renderObject);
+	}
+
+	for (; i < numItems; i++)
+	{
+		bool visible = true;
+		for (int j = 0; j < cullPlanes.numPlanes && visible; j++)
+		{
+			if ((planeMask & (1 << j)) == 0)
+				continue;
+
+			float signedDistance = cell.centerX[i] * _mm_cvtss_f32(cullPlanes.packedNormalX[j]) + cell.centerY[i] * _mm_cvtss_f32(cullPlanes.packedNormalY[j]) + cell.centerZ[i] * _mm_cvtss_f32(cullPlanes.packedNormalZ[j]) - _mm_cvtss_f32(cullPlanes.packedDistance[j]);
+			if (signedDistance >= cell.radius[i])
+				visible = false;
+		}
+
+		if (visible)
+			visibleObjectArray.push_back(this->itemArray[cell.itemArray[i]].renderObject);
+	}
+
+	for (int j = 0; j < 8; j++)
+	{
+		int childCell = cell.childCell[j];
+		if (childCell >= 0)
+			this->CullCell(childCell, cullPlanes, planeMask, visibleObjectArray, cullStats);
+	}
+}
+
+void SceneTree::CollectSubtree(int cellIndex, std::vector<RenderObject*>& visibleObjectArray) const
+{
+	const Cell& cell = this->cellArray[cellIndex];
+
+	for (int itemIndex : cell.itemArray)
+		visibleObjectArray.push_back(this->itemArray[itemIndex].renderObject);
+
+	for (int i = 0; i < 8; i++)
+		if (cell.childCell[i] >= 0)
+			this->CollectSubtree(cell.childCell[i], visibleObjectArray);
+}
\ No newline at end of file
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "Defines.h"
+#include "Math/Vector3.h"
+#include <vector>
+
+namespace Imzadi
+{
+	class RenderObject;
+	class Camera;
+
+	/**
+	 * This is the spatial index the Scene class uses to find what render objects a camera
+	 * can see without having to look at every one of them.  It's a loose octree.  Each render
+	 * object lives in the deepest cell that is at least as wide as its bounding sphere, going by
+	 * where its center is, and each cell's bounds are twice as wide as the cell itself, so that
+	 * they contain every sphere in the cell.  Because an object's cell can be found directly from
+	 * its sphere, keeping the tree up-to-date as things move is cheap; most of the time, an object
+	 * stays in the same cell, and all we do is overwrite its sphere.
+	 *
+	 * Culling descends the tree, rejecting whole cells outside of the frustum, and accepting
+	 * whole cells inside of it without testing any of their contents.  Only the cells that
+	 * straddle a plane of the frustum have their spheres tested, and these are stored in a way
+	 * that lets us test four at a time with SSE.
+	 *
+	 * Objects that don't fit in the tree's bounds are kept on the side and tested one by one.
+	 * If too many of them pile up there, the tree is rebuilt around where everything is now.
+	 * Objects without a bounding sphere are always considered visible.
+	 */
+	class IMZADI_API SceneTree
+	{
+	public:
+		SceneTree();
+		virtual ~SceneTree();
+
+		/**
+		 * Remove all render objects from the tree and delete all its cells.
+		 */
+		void Clear();
+
+		/**
+		 * Add the given render object to the tree, where its bounding sphere is now.
+		 *
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool Insert(RenderObject* renderObject);
+
+		/**
+		 * Remove the given render object from the tree.
+		 *
+		 * @return True is returned on success; false, otherwise.
+		 */
+		bool Remove(RenderObject* renderObject);
+
+		/**
+		 * Move the given render object in the tree to where its bounding sphere is now.
+		 * This must be called for every object whose bounding sphere may have changed
+		 * since it was inserted or last updated, or else it may be culled when it shouldn't be.
+		 */
+		void Update(RenderObject* renderObject);
+
+		/**
+		 * Rebuild the tree if too many objects have wandered out of its bounds.
+		 * This is meant to be called once per frame, after all the updates.
+		 */
+		void RebuildIfNecessary();
+
+		struct CullStats
+		{
+			uint32_t numCellsVisited;		///< This is how many cells were tested against the frustum.
+			uint32_t numCellsAccepted;		///< This is how many cells were found to be entirely inside the frustum.
+			uint32_t numSpheresTested;		///< This is how many bounding spheres were tested against the frustum.
+			uint32_t numObjectsVisible;		///< This is how many objects were found to be visible.
+		};
+
+		/**
+		 * Find all render objects of the tree that might be visible to the given camera.
+		 *
+		 * @param[in] camera This is the camera whose frustum is used to cull the tree.
+		 * @param[out] visibleObjectArray The visible objects are appended to this array in no particular order.
+		 * @param[out] cullStats If given, this is populated with how much work was done.
+		 */
+		void FindVisibleObjects(const Camera* camera, std::vector<RenderObject*>& visibleObjectArray, CullStats* cullStats = nullptr) const;
+
+		/**
+		 * Return the number of render objects in the tree.
+		 */
+		uint32_t GetNumObjects() const { return (uint32_t)(this->itemArray.size() - this->freeItemArray.size()); }
+
+		/**
+		 * Return the number of cells of the tree in use.
+		 */
+		uint32_t GetNumCells() const { return (uint32_t)(this->cellArray.size() - this->freeCellArray.size()); }
+
+		/**
+		 * Return the number of objects that didn't fit in the tree's bounds.
+		 */
+		uint32_t GetNumOverflowObjects() const { return (uint32_t)this->overflowItemArray.size(); }
+
+		/**
+		 * Return the number of objects that have no bounding sphere.
+		 */
+		uint32_t GetNumUnboundedObjects() const { return (uint32_t)this->unboundedItemArray.size(); }
+
+		/**
+		 * Return the number of times the tree has been rebuilt.
+		 */
+		uint32_t GetNumRebuilds() const { return this->numRebuilds; }
+
+	private:
+
+		static const int OVERFLOW_CELL = -1;
+		static const int UNBOUNDED_CELL = -2;
+		static const int MAX_LEVEL = 10;
+
+		struct Item
+		{
+			RenderObject* renderObject;
+			Vector3 center;
+			double radius;
+			int cell;		///< This is the cell containing the item, or one of the negative values above.
+			int slot;		///< This is where the item is found in its cell, or in the overflow or unbounded array.
+			int level;		///< This and the following locate the cell the item belongs in.
+			int cellX, cellY, cellZ;
+		};
+
+		/**
+		 * The spheres of a cell's items are stored one component per array, relative to the
+		 * center of the tree, so that they can be loaded four at a time for testing.
+		 */
+		struct Cell
+		{
+			Vector3 center;
+			double halfSize;
+			int parentCell;
+			int childCell[8];
+			uint32_t numItemsInSubtree;
+			std::vector<int> itemArray;
+			std::vector<float> centerX;
+			std::vector<float> centerY;
+			std::vector<float> centerZ;
+			std::vector<float> radius;
+		};
+
+		struct CullPlanes;
+
+		int AllocateCell(const Vector3& center, double halfSize, int parentCell);
+		void FreeCell(int cell);
+		bool LocateCell(const Vector3& center, double radius, int& level, int& cellX, int& cellY, int& cellZ) const;
+		void Place(int itemIndex);
+		void Unplace(int itemIndex);
+		void SetSphere(Cell& cell, int slot, const Item& item);
+		void Rebuild();
+		void CullCell(int cell, const CullPlanes& cullPlanes, uint32_t planeMask, std::vector<RenderObject*>& visibleObjectArray, CullStats& cullStats) const;
+		void CollectSubtree(int cell, std::vector<RenderObject*>& visibleObjectArray) const;
+
+		std::vector<Item> itemArray;
+		std::vector<int> freeItemArray;
+		std::vector<Cell> cellArray;
+		std::vector<int> freeCellArray;
+		std::vector<int> overflowItemArray;
+		std::vector<int> unboundedItemArray;
+		int rootCell;
+		Vector3 rootCenter;
+		double rootHalfSize;
+		uint32_t numRebuilds;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "ShadowCascades.h"
+#include "Camera.h"
+#include "Math/Transform.h"
+#include <math.h>
+
+using namespace Imzadi;
+
+ShadowCascades::ShadowCascades()
+{
+	this->valid = false;
+	this->numCascades = MAX_CASCADES;
+	this->maxShadowDistance = 300.0;
+	this->splitBlend = 0.75;
+	this->tileResolution = 2048;
+
+	for (int i = 0; i < MAX_CASCADES; i++)
+	{
+		Cascade& cascade = this->cascadeArray[i];
+		cascade.camera.Set(new Camera());
+		cascade.camera->SetViewMode(Camera::ViewMode::ORTHOGRAPHIC);
+		cascade.nearDistance = 0.0;
+		cascade.farDistance = 0.0;
+		::memset(&cascade.cullStats, 0, sizeof(SceneTree::CullStats));
+	}
+}
+
+/*virtual*/ ShadowCascades::~ShadowCascades()
+{
+}
+
+void ShadowCascades::SetNumCascades(int numCascades)
+{
+	this->numCascades = IMZADI_CLAMP(numCascades, 1, MAX_CASCADES);
+}
+
+/*static*/ void ShadowCascades::GetAtlasTile(int cascade, int& column, int& row)
+{
+	column = cascade % ATLAS_TILES_PER_ROW;
+	row = cascade / ATLAS_TILES_PER_ROW;
+}
+
+bool ShadowCascades::Update(const Camera* viewCamera, const Vector3& lightDirection, double casterDistance)
+{
+	this->valid = false;
+
+	if (viewCamera->GetViewMode() != Camera::ViewMode::PERSPECTIVE)
+		return false;
+
+	const Frustum& frustum = viewCamera->GetFrustum();
+	double nearClip = frustum.nearClip;
+	double farClip = IMZADI_MIN(frustum.farClip, this->maxShadowDistance);
+	if (nearClip <= 0.0 || farClip <= nearClip)
+		return false;
+
+	// All the light cameras look down the light direction.  Which way is up for them doesn't much matter.
+	Vector3 xAxis, yAxis, zAxis;
+	Transform lightToWorld;
+	if (lightToWorld.LookAt(Vector3(0.0, 0.0, 0.0), lightDirection, Vector3(0.0, 1.0, 0.0)))
+	{
+		lightToWorld.matrix.GetColumnVectors(xAxis, yAxis, zAxis);
+	}
+	else
+	{
+		zAxis = -lightDirection;
+		xAxis.SetComponents(1.0, 0.0, 0.0);
+		yAxis = zAxis.Cross(xAxis);
+	}
+
+	// Blend between splitting the view evenly and splitting it logarithmically.
+	double distanceArray[MAX_CASCADES + 1];
+	for (int i = 0; i <= this->numCascades; i++)
+	{
+		double alpha = double(i) / double(this->numCascades);
+		double logDistance = nearClip * ::pow(farClip / nearClip, alpha);
+		double linearDistance = nearClip + (farClip - nearClip) * alpha;
+		distanceArray[i] = this->splitBlend * logDistance + (1.0 - this->splitBlend) * linearDistance;
+	}
+
+	const Transform& viewCameraToWorld = viewCamera->GetCameraToWorldTransform();
+	double tanHalfHorizontal = ::tan(frustum.hfovi / 2.0);
+	double tanHalfVertical = ::tan(frustum.vfovi / 2.0);
+
+	for (int i = 0; i < this->numCascades; i++)
+	{
+		Cascade& cascade = this->cascadeArray[i];
+		cascade.nearDistance = distanceArray[i];
+		cascade.farDistance = distanceArray[i + 1];
+
+		// Bound the slice with a sphere, centered on the view axis where it's as far from the near
+		// corners as from the far ones, unless that's past the far end of the slice.  Its radius depends
+		// only on the slice's distances and the field of view, so it doesn't change as the view turns or moves.
+		double nearDistance = cascade.nearDistance;
+		double farDistance = cascade.farDistance;
+		double cornerSlopeSquared = tanHalfHorizontal * tanHalfHorizontal + tanHalfVertical * tanHalfVertical;
+		double sphereDistance = IMZADI_MIN((nearDistance + farDistance) * (1.0 + cornerSlopeSquared) / 2.0, farDistance);
+		double nearCornerRadius = ::sqrt((sphereDistance - nearDistance) * (sphereDistance - nearDistance) + nearDistance * nearDistance * cornerSlopeSquared);
+		double farCornerRadius = ::sqrt((farDistance - sphereDistance) * (farDistance - sphereDistance) + farDistance * farDistance * cornerSlopeSquared);
+		double radius = IMZADI_MAX(nearCornerRadius, farCornerRadius);
+
+		// Round the radius up a little, so that floating-point noise can't change the texel size from one frame to the next.
+		radius = ::ceil(radius * 16.0) / 16.0;
+
+		Vector3 worldCenter = viewCameraToWorld.TransformPoint(Vector3(0.0, 0.0, -sphereDistance));
+		Vector3 lightCenter(worldCenter.Dot(xAxis), worldCenter.Dot(yAxis), worldCenter.Dot(zAxis));
+
+		// Pad by a couple of texels, so that we can snap the center to a whole texel without leaving any of the sphere out.
+		double texelSize = 2.0 * radius / double(this->tileResolution - 2);
+		double centerX = ::floor(lightCenter.x / texelSize + 0.5) * texelSize;
+		double centerY = ::floor(lightCenter.y / texelSize + 0.5) * texelSize;
+		double eyeZ = lightCenter.z + radius + casterDistance;
+
+		Camera::OrthographicParams orthoParams{};
+		orthoParams.width = texelSize * double(this->tileResolution);
+		orthoParams.height = texelSize * double(this->tileResolution);
+		orthoParams.nearClip = 0.0;
+		orthoParams.farClip = eyeZ - (lightCenter.z - radius);
+		orthoParams.desiredAspectRatio = 0.0;
+		cascade.camera->SetOrthographicParams(orthoParams);
+
+		Transform cameraToWorld;
+		cameraToWorld.matrix.SetColumnVectors(xAxis, yAxis, zAxis);
+		cameraToWorld.translation = centerX * xAxis + centerY * yAxis + eyeZ * zAxis;
+		cascade.camera->SetCameraToWorldTransform(cameraToWorld);
+	}
+
+	this->valid = true;
+	return true;
+}
\ No newline at end of file
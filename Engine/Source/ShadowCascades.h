@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Defines.h"
+#include "Reference.h"
+#include "SceneTree.h"
+#include "Math/Vector3.h"
+
+namespace Imzadi
+{
+	class Camera;
+
+	/**
+	 * This splits the view of the main camera, by distance from the eye, into a few slices,
+	 * and gives each slice its own orthographic light camera, fitted around the bounding sphere
+	 * of the slice.  A sphere looks the same from the light however the view turns, so each light
+	 * camera's texel size stays fixed, and shadow edges don't shimmer.  Near slices are short, so that shadows near
+	 * the viewer get lots of resolution, and far ones are long.  Each light camera extends
+	 * toward the light far enough to take in whatever might cast a shadow into its slice.
+	 *
+	 * Since each light camera is an ordinary orthographic camera, the scene culls shadow
+	 * casters against it just as it does anything else, and so each cascade draws only
+	 * what can actually shadow its part of the view.
+	 *
+	 * All cascades share one shadow buffer, each rendering into its own tile of it.
+	 */
+	class IMZADI_API ShadowCascades
+	{
+	public:
+		ShadowCascades();
+		virtual ~ShadowCascades();
+
+		static const int MAX_CASCADES = 4;
+		static const int ATLAS_TILES_PER_ROW = 2;
+
+		/**
+		 * Fit the light cameras to the given view for the given light.
+		 *
+		 * @param[in] viewCamera This is the camera whose view is to receive shadows.  It must have a perspective view.
+		 * @param[in] lightDirection This is the unit-length direction the light travels.
+		 * @param[in] casterDistance This is how far toward the light, beyond a slice, shadow casters are looked for.
+		 * @return False is returned if the cascades could not be fitted, in which case they should not be rendered.
+		 */
+		bool Update(const Camera* viewCamera, const Vector3& lightDirection, double casterDistance);
+
+		/**
+		 * Tell the caller if the last update succeeded, and so the cascades are fit to be rendered and sampled.
+		 */
+		bool IsValid() const { return this->valid; }
+
+		/**
+		 * Return the light camera of the given cascade.  Cascades are ordered from nearest to furthest.
+		 */
+		Camera* GetCascadeCamera(int cascade) { return this->cascadeArray[cascade].camera.Get(); }
+		const Camera* GetCascadeCamera(int cascade) const { return this->cascadeArray[cascade].camera.Get(); }
+
+		/**
+		 * Return the distance from the view's eye at which the given cascade's slice begins.
+		 */
+		double GetNearDistance(int cascade) const { return this->cascadeArray[cascade].nearDistance; }
+
+		/**
+		 * Return the distance from the view's eye at which the given cascade's slice ends.
+		 */
+		double GetFarDistance(int cascade) const { return this->cascadeArray[cascade].farDistance; }
+
+		/**
+		 * Remember how much work the scene did to cull shadow casters for the given cascade.
+		 */
+		void SetCullStats(int cascade, const SceneTree::CullStats& cullStats) { this->cascadeArray[cascade].cullStats = cullStats; }
+
+		/**
+		 * Return how much work the scene did to cull shadow casters for the given cascade the last time it was rendered.
+		 */
+		const SceneTree::CullStats& GetCullStats(int cascade) const { return this->cascadeArray[cascade].cullStats; }
+
+		/**
+		 * Set the number of cascades, which is clamped to [1,MAX_CASCADES].
+		 */
+		void SetNumCascades(int numCascades);
+		int GetNumCascades() const { return this->numCascades; }
+
+		/**
+		 * Set how far from the view's eye shadows are drawn.  The view's far clipping plane also limits this.
+		 */
+		void SetMaxShadowDistance(double maxShadowDistance) { this->maxShadowDistance = maxShadowDistance; }
+		double GetMaxShadowDistance() const { return this->maxShadowDistance; }
+
+		/**
+		 * Set how the split distances are chosen, from 0, where all slices are of equal length,
+		 * to 1, where each slice is the same number of times longer than the one before it.
+		 */
+		void SetSplitBlend(double splitBlend) { this->splitBlend = splitBlend; }
+		double GetSplitBlend() const { return this->splitBlend; }
+
+		/**
+		 * Set the width and height, in texels, of each cascade's tile of the shadow buffer.
+		 * Light cameras are moved only by whole texels, so that shadows don't crawl as the view moves.
+		 */
+		void SetTileResolution(int tileResolution) { this->tileResolution = tileResolution; }
+		int GetTileResolution() const { return this->tileResolution; }
+
+		/**
+		 * Return the column and row of the tile of the shadow buffer into which the given cascade is rendered.
+		 */
+		static void GetAtlasTile(int cascade, int& column, int& row);
+
+	private:
+
+		struct Cascade
+		{
+			Reference<Camera> camera;
+			double nearDistance;
+			double farDistance;
+			SceneTree::CullStats cullStats;
+		};
+
+		Cascade cascadeArray[MAX_CASCADES];
+		bool valid;
+		int numCascades;
+		double maxShadowDistance;
+		double splitBlend;
+		int tileResolution;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "TaskGraph.h"
+#include "JobSystem.h"
+#include "Clock.h"
+#include "Log.h"
+#include <format>
+
+using namespace Imzadi;
+
+TaskGraph::TaskGraph()
+{
+	this->jobSystem = nullptr;
+	this->numUnfinishedTasks = 0;
+	this->executionTimeMilliseconds = 0.0;
+}
+
+/*virtual*/ TaskGraph::~TaskGraph()
+{
+	this->Clear();
+}
+
+void TaskGraph::Clear()
+{
+	for (Task* task : this->taskArray)
+		delete task;
+
+	this->taskArray.clear();
+	this->mainThreadQueue.clear();
+}
+
+TaskID TaskGraph::AddTask(const std::string& name, TaskFunc func, bool mainThreadOnly)
+{
+	if (this->FindTask(name) >= 0)
+	{
+		IMZADI_LOG_ERROR(std::format("A task named \"{}\" is already in the graph.", name.c_str()));
+		return -1;
+	}
+
+	auto task = new Task();
+	task->name = name;
+	task->profileZone = Profiler::Get()->InternZone(name);
+	task->func = func;
+	task->mainThreadOnly = mainThreadOnly;
+	task->numPrerequisites = 0;
+	task->numPendingPrerequisites = 0;
+	task->timeMilliseconds = 0.0;
+	this->taskArray.push_back(task);
+
+	// Reserve now so that queuing main-thread tasks never allocates during execution.
+	this->mainThreadQueue.reserve(this->taskArray.size());
+
+	return TaskID(this->taskArray.size() - 1);
+}
+
+TaskID TaskGraph::FindTask(const std::string& name) const
+{
+	for (int i = 0; i < (int)this->taskArray.size(); i++)
+		if (this->taskArray[i]->name == name)
+			return i;
+
+	return -1;
+}
+
+bool TaskGraph::DependsOn(TaskID taskID, TaskID prerequisiteTaskID) const
+{
+	if (taskID == prerequisiteTaskID)
+		return true;
+
+	for (TaskID dependentID : this->taskArray[prerequisiteTaskID]->dependentArray)
+		if (this->DependsOn(taskID, dependentID))
+			return true;
+
+	return false;
+}
+
+bool TaskGraph::AddDependency(TaskID taskID, TaskID prerequisiteTaskID)
+{
+	if (taskID < 0 || taskID >= (int)this->taskArray.size() || prerequisiteTaskID < 0 || prerequisiteTaskID >= (int)this->taskArray.size())
+	{
+		IMZADI_LOG_ERROR("Can't add dependency between non-existent tasks.");
+		return false;
+	}
+
+	// If the prerequisite is already downstream of the task, this would make a cycle.
+	if (this->DependsOn(prerequisiteTaskID, taskID))
+	{
+		IMZADI_LOG_ERROR(std::format("Making task \"{}\" depend on task \"{}\" would create a cycle.", this->taskArray[taskID]->name.c_str(), this->taskArray[prerequisiteTaskID]->name.c_str()));
+		return false;
+	}
+
+	Task* prerequisiteTask = this->taskArray[prerequisiteTaskID];
+	for (TaskID dependentID : prerequisiteTask->dependentArray)
+		if (dependentID == taskID)
+			return true;
+
+	prerequisiteTask->dependentArray.push_back(taskID);
+	this->taskArray[taskID]->numPrerequisites++;
+	return true;
+}
+
+void TaskGraph::Execute(JobSystem* jobSystem)
+{
+	Clock clock;
+	clock.Reset();
+
+	this->jobSystem = jobSystem;
+	this->numUnfinishedTasks = (int32_t)this->taskArray.size();
+
+	for (Task* task : this->taskArray)
+		task->numPendingPrerequisites.store(task->numPrerequisites, std::memory_order_relaxed);
+
+	for (int i = 0; i < (int)this->taskArray.size(); i++)
+		if (this->taskArray[i]->numPrerequisites == 0)
+			this->Dispatch(i);
+
+	while (this->numUnfinishedTasks.load(std::memory_order_acquire) > 0)
+	{
+		TaskID taskID = -1;
+
+		{
+			std::lock_guard<std::mutex> lock(this->mainThreadQueueMutex);
+			if (this->mainThreadQueue.size() > 0)
+			{
+				taskID = this->mainThreadQueue.back();
+				this->mainThreadQueue.pop_back();
+			}
+		}
+
+		if (taskID >= 0)
+			this->RunTask(taskID);
+		else if (!jobSystem->HelpWithWork())
+			std::this_thread::yield();
+	}
+
+	this->executionTimeMilliseconds = clock.GetCurrentTimeMilliseconds();
+}
+
+void TaskGraph::Dispatch(TaskID taskID)
+{
+	Task* task = this->taskArray[taskID];
+
+	if (task->mainThreadOnly || this->jobSystem->GetNumWorkers() == 0)
+	{
+		std::lock_guard<std::mutex> lock(this->mainThreadQueueMutex);
+		this->mainThreadQueue.push_back(taskID);
+	}
+	else
+	{
+		Job* job = this->jobSystem->CreateJob([this, taskID]() { this->RunTask(taskID); });
+		this->jobSystem->Run(job);
+	}
+}
+
+void TaskGraph::RunTask(TaskID taskID)
+{
+	Task* task = this->taskArray[taskID];
+
+	Clock clock;
+	clock.Reset();
+
+	if (task->func)
+	{
+		IMZADI_PROFILE_ZONE(task->profileZone);
+		task->func();
+	}
+
+	task->timeMilliseconds = clock.GetCurrentTimeMilliseconds();
+
+	for (TaskID dependentID : task->dependentArray)
+		if (this->taskArray[dependentID]->numPendingPrerequisites.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			this->Dispatch(dependentID);
+
+	this->numUnfinishedTasks.fetch_sub(1, std::memory_order_acq_rel);
+}
\ No newline at end of file
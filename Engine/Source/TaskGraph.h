@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Defines.h"
+#include "Profile.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace Imzadi
+{
+	class JobSystem;
+
+	typedef std::function<void()> TaskFunc;
+	typedef int TaskID;
+
+	/**
+	 * A task graph is a set of named tasks with dependencies between them.  The graph
+	 * is built once and then executed any number of times (e.g., once per frame.)  When
+	 * executed, every task runs as soon as all of its prerequisites are done, so tasks
+	 * that don't depend on one another can overlap on the threads of the job system.
+	 *
+	 * Some work can only be done on the main thread (e.g., anything that touches the
+	 * D3D immediate context or pumps window messages), so tasks can be pinned there.
+	 */
+	class IMZADI_API TaskGraph
+	{
+	public:
+		TaskGraph();
+		virtual ~TaskGraph();
+
+		/**
+		 * Add a task to the graph.
+		 *
+		 * @param[in] name This is used to find the task later, and to report its timing.
+		 * @param[in] func This is the work the task does.
+		 * @param[in] mainThreadOnly If true, the task is always run on the thread that calls @ref Execute.
+		 * @return The ID of the new task is returned, or -1 if a task of the given name already exists.
+		 */
+		TaskID AddTask(const std::string& name, TaskFunc func, bool mainThreadOnly);
+
+		/**
+		 * Make the given task wait for the given prerequisite task.
+		 *
+		 * @return False is returned if either task doesn't exist, or if the dependency would create a cycle; true, otherwise.
+		 */
+		bool AddDependency(TaskID taskID, TaskID prerequisiteTaskID);
+
+		/**
+		 * Return the ID of the task of the given name, or -1 if there is no such task.
+		 */
+		TaskID FindTask(const std::string& name) const;
+
+		/**
+		 * Remove all tasks from the graph.
+		 */
+		void Clear();
+
+		/**
+		 * Run every task of the graph, in dependency order, and return once they're all done.
+		 * This must be called on the main thread of the given job system.
+		 */
+		void Execute(JobSystem* jobSystem);
+
+		int GetNumTasks() const { return (int)this->taskArray.size(); }
+		const std::string& GetTaskName(TaskID taskID) const { return this->taskArray[taskID]->name; }
+
+		/**
+		 * Return how long, in milliseconds, the given task took the last time the graph was executed.
+		 */
+		double GetTaskTimeMilliseconds(TaskID taskID) const { return this->taskArray[taskID]->timeMilliseconds; }
+
+		/**
+		 * Return how long, in milliseconds, the last execution of the whole graph took.
+		 */
+		double GetExecutionTimeMilliseconds() const { return this->executionTimeMilliseconds; }
+
+	private:
+
+		struct Task
+		{
+			std::string name;
+			const ProfileZone* profileZone;
+			TaskFunc func;
+			bool mainThreadOnly;
+			std::vector<TaskID> dependentArray;
+			int32_t numPrerequisites;
+			std::atomic<int32_t> numPendingPrerequisites;
+			double timeMilliseconds;
+		};
+
+		bool DependsOn(TaskID taskID, TaskID prerequisiteTaskID) const;
+		void Dispatch(TaskID taskID);
+		void RunTask(TaskID taskID);
+
+		std::vector<Task*> taskArray;
+		JobSystem* jobSystem;
+		std::atomic<int32_t> numUnfinishedTasks;
+		std::mutex mainThreadQueueMutex;
+		std::vector<TaskID> mainThreadQueue;
+		double executionTimeMilliseconds;
+	};
+}
\ No newline at end of file
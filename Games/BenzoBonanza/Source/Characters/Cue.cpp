@@ -13,6 +13,7 @@ Cue::Cue()
 	this->remainingStillTimeSeconds = 0.0;
 	this->debugDrawRunPath = false;
 	this->runSpeed = 0.0;
+	this->runPathIndex = 0;
 	this->canRestart = true;
 }
 
@@ -37,6 +38,7 @@ Cue::Cue()
 
 	this->aliceNode = nullptr;
 	this->cueNode = nullptr;
+	this->pathRequest.Reset();
 	this->navGraph.Reset();
 
 	return true;
@@ -102,9 +104,9 @@ Cue::Cue()
 			if (debugLines)
 			{
 				const Imzadi::NavGraph::Node* node = this->cueNode;
-				for(int i : this->runPathList)
+				for (int j = this->runPathIndex; j < (int)this->runPathArray.size(); j++)
 				{
-					const Imzadi::NavGraph::Node* nextNode = node->GetAdjacentNode(i);
+					const Imzadi::NavGraph::Node* nextNode = node->GetAdjacentNode(this->runPathArray[j]);
 					if (!nextNode)
 						break;
 					
@@ -169,14 +171,34 @@ void Cue::PersuePlayer()
 	const Imzadi::NavGraph::Node* node = path->terminalNode[terminalIndex];
 	if (node != this->aliceNode)
 	{
-		// Yes.  Calculate a shortest-path from where we are to where she is.
+		// Yes.  Ask for a shortest-path from where we are to where she is.
 		this->aliceNode = node;
 		const Imzadi::NavGraph::Path* path = this->navGraph->FindNearestPath(cueObjectToWorld.translation, &terminalIndex);
 		IMZADI_ASSERT(path);
 		this->cueNode = path->terminalNode[terminalIndex];
-		bool pathFound = this->navGraph->FindShortestPath(this->cueNode, this->aliceNode, this->runPathList);
+		this->runPathArray.clear();
+		this->runPathIndex = 0;
+		this->pathRequest = Imzadi::Game::Get()->GetPathfindingService()->RequestPath(this->cueNode, this->aliceNode);
+		if (!this->pathRequest.Get())
+		{
+			this->aliceNode = nullptr;
+			this->disposition = Disposition::NONE;
+			return;
+		}
+	}
+
+	// Has the path we asked for come back yet?
+	if (this->pathRequest.Get() && this->pathRequest->IsDone())
+	{
+		bool pathFound = this->pathRequest->GetStatus() == Imzadi::NavGraph::SearchStatus::SEARCH_SUCCEEDED && this->pathRequest->IsValidFor(this->navGraph);
+		if (pathFound)
+			this->runPathArray = this->pathRequest->GetPathArray();
+
+		this->pathRequest.Reset();
+
 		if (!pathFound)
 		{
+			this->aliceNode = nullptr;
 			this->disposition = Disposition::NONE;
 			return;
 		}
@@ -198,15 +220,21 @@ void Cue::PersuePlayer()
 			this->desiredVelocity.SetComponents(0.0, 0.0, 0.0);
 			this->aliceNode = nullptr;
 			this->cueNode = nullptr;
-			this->runPathList.clear();
+			this->runPathArray.clear();
+			this->runPathIndex = 0;
+			this->pathRequest.Reset();
 			this->disposition = Disposition::TELEPORT;
 		}
 	}
+	else if (this->pathRequest.Get())
+	{
+		// We're still waiting on our path, so just keep going the way we were going.
+	}
 	else
 	{
 		// No.  Run to the next nav-graph node in our path.
-		IMZADI_ASSERT(this->runPathList.size() > 0);
-		int i = *this->runPathList.begin();
+		IMZADI_ASSERT(this->runPathIndex < (int)this->runPathArray.size());
+		int i = this->runPathArray[this->runPathIndex];
 		const Imzadi::NavGraph::Node* nextNode = this->cueNode->GetAdjacentNode(i);
 		IMZADI_ASSERT(nextNode);
 		
@@ -217,7 +245,7 @@ void Cue::PersuePlayer()
 		{
 			// Yes.  Advance to the next node.
 			this->cueNode = nextNode;
-			this->runPathList.pop_front();
+			this->runPathIndex++;
 		}
 		else
 		{
@@ -232,7 +260,9 @@ void Cue::PersuePlayer()
 {
 	this->aliceNode = nullptr;
 	this->cueNode = nullptr;
-	this->runPathList.clear();
+	this->runPathArray.clear();
+	this->runPathIndex = 0;
+	this->pathRequest.Reset();
 	this->disposition = Disposition::NONE;
 
 	return Character::OnBipedDied();
@@ -3,6 +3,7 @@
 #include "Character.h"
 #include "Math/Random.h"
 #include "Assets/NavGraph.h"
+#include "PathfindingService.h"
 #include "Characters/Alice.h"
 
 /**
@@ -47,7 +48,9 @@ private:
 	Imzadi::Reference<Alice> alice;
 	const Imzadi::NavGraph::Node* aliceNode;
 	const Imzadi::NavGraph::Node* cueNode;
-	std::list<int> runPathList;
+	std::vector<int> runPathArray;
+	int runPathIndex;
+	Imzadi::Reference<Imzadi::PathRequest> pathRequest;
 	bool debugDrawRunPath;
 	double runSpeed;
 	Imzadi::Vector3 desiredVelocity;
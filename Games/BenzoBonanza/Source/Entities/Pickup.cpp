@@ -112,6 +112,12 @@ Pickup::Pickup()
 	return this->pickupShapeID == shapeID;
 }
 
+/*virtual*/ void Pickup::GetCollisionShapes(std::vector<Imzadi::Collision::ShapeID>& shapeArray) const
+{
+	if (this->pickupShapeID != 0)
+		shapeArray.push_back(this->pickupShapeID);
+}
+
 /*virtual*/ bool Pickup::Tick(Imzadi::TickPass tickPass, double deltaTime)
 {
 	if (!Entity::Tick(tickPass, deltaTime))
@@ -131,6 +137,12 @@ Pickup::Pickup()
 	return true;
 }
 
+/*virtual*/ uint32_t Pickup::GetTickServices() const
+{
+	// We spin our render mesh, which lives in the scene.
+	return IMZADI_ENTITY_SERVICE_SCENE;
+}
+
 /*virtual*/ void Pickup::Collect()
 {
 	this->DoomEntity();
@@ -31,6 +31,11 @@ public:
 	 */
 	virtual bool Tick(Imzadi::TickPass tickPass, double deltaTime) override;
 
+	/**
+	 * Spinning the pick-up only touches its own render mesh, so pick-ups can tick in parallel.
+	 */
+	virtual uint32_t GetTickServices() const override;
+
 	/**
 	 * Set the transform that will be used when the pick-up is created.
 	 * Once created, the pick-up location can't be changed, so this call doesn't do anything.
@@ -48,6 +53,11 @@ public:
 	 */
 	virtual bool OwnsCollisionShape(Imzadi::Collision::ShapeID shapeID) const override;
 
+	/**
+	 * Report the shape used to detect the pick-up.
+	 */
+	virtual void GetCollisionShapes(std::vector<Imzadi::Collision::ShapeID>& shapeArray) const override;
+
 	/**
 	 * Derivatives must override this to perform the collection process.
 	 * That is, to add something to the user's inventory, or do whatever
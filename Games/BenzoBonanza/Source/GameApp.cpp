@@ -41,16 +41,25 @@ GameApp::GameApp(HINSTANCE instance) : Game(instance)
 
 	this->assetCache->AddAssetFolder(R"(Games\BenzoBonanza\Assets)");
 
-	std::filesystem::path gameSavePath;
-	if (!this->GetGameSavePath(gameSavePath))
-		return false;
-
-	Imzadi::Reference<Imzadi::Asset> asset;
-	this->assetCache->LoadAsset(gameSavePath.string(), asset);
-	if (asset.Get())
-		this->gameProgress.SafeSet(asset.Get());
-	if (!this->gameProgress)
+	// A headless run always starts from scratch so that it plays out the same every time.
+	if (this->IsHeadless())
 		this->gameProgress.Set(new GameProgress());
+	else
+	{
+		std::filesystem::path gameSavePath;
+		if (!this->GetGameSavePath(gameSavePath))
+			return false;
+
+		Imzadi::Reference<Imzadi::Asset> asset;
+		this->assetCache->LoadAsset(gameSavePath.string(), asset);
+		if (asset.Get())
+			this->gameProgress.SafeSet(asset.Get());
+		if (!this->gameProgress)
+			this->gameProgress.Set(new GameProgress());
+	}
+
+	if (this->IsHeadless() && this->GetHeadlessParams().levelName.length() > 0)
+		this->gameProgress->SetLevelName(this->GetHeadlessParams().levelName);
 
 	Imzadi::EventSystem* eventSystem = Imzadi::Game::Get()->GetEventSystem();
 	eventSystem->RegisterEventListener("LevelTransition", Imzadi::EventListenerType::PERMINANT, new Imzadi::LambdaEventListener([=](const Imzadi::Event* event) {
@@ -96,7 +105,7 @@ bool GameApp::GetGameSavePath(std::filesystem::path& gameSavePath)
 {
 	Game::PreShutdown();
 
-	if (this->gameProgress)
+	if (this->gameProgress && !this->IsHeadless())
 	{
 		std::filesystem::path gameSavePath;
 		if (this->GetGameSavePath(gameSavePath))
@@ -6,14 +6,21 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prevInstance, LPSTR cmdLine, in
 	GameApp game(instance);
 	GameApp::Set(&game);
 
+	if (!game.ParseCommandLine(cmdLine))
+		return 1;
+
+	// A failure to initialize (e.g., a bad input track or level) must fail a headless run too.
+	int exitCode = 1;
 	if (game.Initialize())
 	{
 		while (game.Run())
 		{
 		}
+
+		exitCode = game.GetExitCode();
 	}
 
 	game.Shutdown();
 
-	return 0;
+	return exitCode;
 }
\ No newline at end of file
@@ -0,0 +1,1070 @@
+#include "BlockCompressor.h"
+#include "JobSystem.h"
+#include "Defines.h"
+#include <xmmintrin.h>
+#include <math.h>
+#include <float.h>
+#include <string.h>
+#include <algorithm>
+
+namespace
+{
+	/**
+	 * Find, for each texel, the nearest of the given palette entries, which are stored channel by
+	 * channel, and return the total squared error.  The number of entries must be a multiple of four.
+	 */
+	float FindNearestEntries(const float texel[16][4], const float palette[4][16], int numEntries, int numChannels, int* indexArray)
+	{
+		float totalError = 0.0f;
+
+		for (int i = 0; i < 16; i++)
+		{
+			float bestError = FLT_MAX;
+			int bestIndex = 0;
+
+			for (int j = 0; j < numEntries; j += 4)
+			{
+				__m128 error = _mm_setzero_ps();
+				for (int k = 0; k < numChannels; k++)
+				{
+					__m128 delta = _mm_sub_ps(_mm_loadu_ps(&palette[k][j]), _mm_set1_ps(texel[i][k]));
+					error = _mm_add_ps(error, _mm_mul_ps(delta, delta));
+				}
+
+				float errorArray[4];
+				_mm_storeu_ps(errorArray, error);
+				for (int k = 0; k < 4; k++)
+				{
+					if (errorArray[k] < bestError)
+					{
+						bestError = errorArray[k];
+						bestIndex = j + k;
+					}
+				}
+			}
+
+			indexArray[i] = bestIndex;
+			totalError += bestError;
+		}
+
+		return totalError;
+	}
+
+	/**
+	 * Find the endpoints of the line that best fits the given texels, which is the extent
+	 * of the texels along the direction in which they vary the most.
+	 */
+	void FindPrincipalEndpoints(const float texel[16][4], int numChannels, float endpointA[4], float endpointB[4])
+	{
+		float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float minimum[4] = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+		float maximum[4] = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (int i = 0; i < 16; i++)
+		{
+			for (int k = 0; k < numChannels; k++)
+			{
+				mean[k] += texel[i][k] / 16.0f;
+				minimum[k] = IMZADI_MIN(minimum[k], texel[i][k]);
+				maximum[k] = IMZADI_MAX(maximum[k], texel[i][k]);
+			}
+		}
+
+		float covariance[4][4];
+		::memset(covariance, 0, sizeof(covariance));
+		for (int i = 0; i < 16; i++)
+			for (int j = 0; j < numChannels; j++)
+				for (int k = 0; k < numChannels; k++)
+					covariance[j][k] += (texel[i][j] - mean[j]) * (texel[i][k] - mean[k]);
+
+		// The diagonal of the bounding box is a good place to start the power iteration.
+		float axis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int k = 0; k < numChannels; k++)
+			axis[k] = maximum[k] - minimum[k];
+
+		for (int iteration = 0; iteration < 8; iteration++)
+		{
+			float nextAxis[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			float length = 0.0f;
+			for (int j = 0; j < numChannels; j++)
+			{
+				for (int k = 0; k < numChannels; k++)
+					nextAxis[j] += covariance[j][k] * axis[k];
+
+				length = IMZADI_MAX(length, ::fabsf(nextAxis[j]));
+			}
+
+			if (length < 1e-6f)
+				break;
+
+			for (int k = 0; k < numChannels; k++)
+				axis[k] = nextAxis[k] / length;
+		}
+
+		float axisLengthSquared = 0.0f;
+		for (int k = 0; k < numChannels; k++)
+			axisLengthSquared += axis[k] * axis[k];
+
+		float minT = 0.0f, maxT = 0.0f;
+		if (axisLengthSquared > 1e-12f)
+		{
+			minT = FLT_MAX;
+			maxT = -FLT_MAX;
+			for (int i = 0; i < 16; i++)
+			{
+				float t = 0.0f;
+				for (int k = 0; k < numChannels; k++)
+					t += (texel[i][k] - mean[k]) * axis[k];
+
+				t /= axisLengthSquared;
+				minT = IMZADI_MIN(minT, t);
+				maxT = IMZADI_MAX(maxT, t);
+			}
+		}
+
+		for (int k = 0; k < numChannels; k++)
+		{
+			endpointA[k] = IMZADI_CLAMP(mean[k] + minT * axis[k], 0.0f, 255.0f);
+			endpointB[k] = IMZADI_CLAMP(mean[k] + maxT * axis[k], 0.0f, 255.0f);
+		}
+	}
+
+	/**
+	 * Find the endpoints that minimize the squared error of the given texels, where each texel
+	 * is the given fraction of the way from the first endpoint to the second.
+	 *
+	 * @return False is returned if the fractions don't determine the endpoints, as when they're all the same.
+	 */
+	bool FitEndpoints(const float texel[16][4], const float weight[16], int numChannels, float endpointA[4], float endpointB[4])
+	{
+		float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+		float ax[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		float bx[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; i++)
+		{
+			float b = weight[i];
+			float a = 1.0f - b;
+			aa += a * a;
+			bb += b * b;
+			ab += a * b;
+			for (int k = 0; k < numChannels; k++)
+			{
+				ax[k] += a * texel[i][k];
+				bx[k] += b * texel[i][k];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (::fabsf(determinant) < 1e-6f)
+			return false;
+
+		for (int k = 0; k < numChannels; k++)
+		{
+			endpointA[k] = IMZADI_CLAMP((ax[k] * bb - bx[k] * ab) / determinant, 0.0f, 255.0f);
+			endpointB[k] = IMZADI_CLAMP((bx[k] * aa - ax[k] * ab) / determinant, 0.0f, 255.0f);
+		}
+
+		return true;
+	}
+
+	/**
+	 * This writes a block's fields one after another, starting from its least significant bit.
+	 */
+	class BitWriter
+	{
+	public:
+		BitWriter(unsigned char* blockBytes, int numBytes) : blockBytes(blockBytes), bit(0)
+		{
+			::memset(blockBytes, 0, numBytes);
+		}
+
+		void Write(uint32_t value, int numBits)
+		{
+			for (int i = 0; i < numBits; i++, this->bit++)
+				if ((value >> i) & 1)
+					this->blockBytes[this->bit / 8] |= 1 << (this->bit % 8);
+		}
+
+	private:
+		unsigned char* blockBytes;
+		int bit;
+	};
+
+	/**
+	 * This reads a block's fields one after another, starting from its least significant bit.
+	 */
+	class BitReader
+	{
+	public:
+		BitReader(const unsigned char* blockBytes) : blockBytes(blockBytes), bit(0)
+		{
+		}
+
+		uint32_t Read(int numBits)
+		{
+			uint32_t value = 0;
+			for (int i = 0; i < numBits; i++, this->bit++)
+				value |= uint32_t((this->blockBytes[this->bit / 8] >> (this->bit % 8)) & 1) << i;
+			return value;
+		}
+
+	private:
+		const unsigned char* blockBytes;
+		int bit;
+	};
+
+	//--------------------------- BC1 ---------------------------
+
+	void QuantizeColor565(const float color[4], int quantized[3])
+	{
+		quantized[0] = IMZADI_CLAMP(int(::floorf(color[0] * 31.0f / 255.0f + 0.5f)), 0, 31);
+		quantized[1] = IMZADI_CLAMP(int(::floorf(color[1] * 63.0f / 255.0f + 0.5f)), 0, 63);
+		quantized[2] = IMZADI_CLAMP(int(::floorf(color[2] * 31.0f / 255.0f + 0.5f)), 0, 31);
+	}
+
+	void ExpandColor565(const int quantized[3], int color[3])
+	{
+		color[0] = (quantized[0] << 3) | (quantized[0] >> 2);
+		color[1] = (quantized[1] << 2) | (quantized[1] >> 4);
+		color[2] = (quantized[2] << 3) | (quantized[2] >> 2);
+	}
+
+	uint16_t PackColor565(const int quantized[3])
+	{
+		return uint16_t((quantized[0] << 11) | (quantized[1] << 5) | quantized[2]);
+	}
+
+	void UnpackColor565(uint16_t packed, int quantized[3])
+	{
+		quantized[0] = (packed >> 11) & 0x1F;
+		quantized[1] = (packed >> 5) & 0x3F;
+		quantized[2] = packed & 0x1F;
+	}
+
+	/**
+	 * Make the four-entry palette of a BC1 block.  Entries two and three are a third and two
+	 * thirds of the way from the first endpoint to the second.
+	 */
+	void MakeColorPalette(const int quantizedA[3], const int quantizedB[3], int palette[4][3])
+	{
+		ExpandColor565(quantizedA, palette[0]);
+		ExpandColor565(quantizedB, palette[1]);
+		for (int k = 0; k < 3; k++)
+		{
+			palette[2][k] = (2 * palette[0][k] + palette[1][k]) / 3;
+			palette[3][k] = (palette[0][k] + 2 * palette[1][k]) / 3;
+		}
+	}
+
+	float EvaluateColorEndpoints(const float texel[16][4], const int quantizedA[3], const int quantizedB[3], int* indexArray)
+	{
+		int palette[4][3];
+		MakeColorPalette(quantizedA, quantizedB, palette);
+
+		float channelPalette[4][16];
+		for (int j = 0; j < 4; j++)
+			for (int k = 0; k < 3; k++)
+				channelPalette[k][j] = float(palette[j][k]);
+
+		return FindNearestEntries(texel, channelPalette, 4, 3, indexArray);
+	}
+
+	//--------------------------- BC4 ---------------------------
+
+	/**
+	 * Make the eight-entry palette of a BC4 block.  If the first endpoint is greater than the second,
+	 * the other six entries are spread evenly between them.  Otherwise, four are, and the last two are 0 and 255.
+	 */
+	void MakeAlphaPalette(int endpointA, int endpointB, int palette[8])
+	{
+		palette[0] = endpointA;
+		palette[1] = endpointB;
+		if (endpointA > endpointB)
+		{
+			for (int i = 1; i <= 6; i++)
+				palette[i + 1] = ((7 - i) * endpointA + i * endpointB) / 7;
+		}
+		else
+		{
+			for (int i = 1; i <= 4; i++)
+				palette[i + 1] = ((5 - i) * endpointA + i * endpointB) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	float EvaluateAlphaEndpoints(const float texel[16][4], int endpointA, int endpointB, int* indexArray)
+	{
+		int palette[8];
+		MakeAlphaPalette(endpointA, endpointB, palette);
+
+		// The nearest entry search is done on the first channel, so put alpha there.
+		float alphaTexel[16][4];
+		for (int i = 0; i < 16; i++)
+			alphaTexel[i][0] = texel[i][3];
+
+		float channelPalette[4][16];
+		for (int j = 0; j < 8; j++)
+			channelPalette[0][j] = float(palette[j]);
+
+		return FindNearestEntries(alphaTexel, channelPalette, 8, 1, indexArray);
+	}
+
+	//--------------------------- BC7 ---------------------------
+
+	const int bc7WeightArray[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	/**
+	 * This is one endpoint of a mode 6 block: a 7-bit value for each channel, and a bit shared
+	 * by all of them, which becomes the least significant bit of each channel when expanded.
+	 */
+	struct BC7Endpoint
+	{
+		int value[4];
+		int pBit;
+
+		int Expand(int channel) const { return (this->value[channel] << 1) | this->pBit; }
+	};
+
+	void QuantizeBC7Endpoint(const float color[4], BC7Endpoint& endpoint)
+	{
+		float bestError = FLT_MAX;
+		for (int pBit = 0; pBit < 2; pBit++)
+		{
+			BC7Endpoint trial;
+			trial.pBit = pBit;
+			float error = 0.0f;
+			for (int k = 0; k < 4; k++)
+			{
+				trial.value[k] = IMZADI_CLAMP(int(::floorf((color[k] - float(pBit)) / 2.0f + 0.5f)), 0, 127);
+				float delta = float(trial.Expand(k)) - color[k];
+				error += delta * delta;
+			}
+
+			if (error < bestError)
+			{
+				bestError = error;
+				endpoint = trial;
+			}
+		}
+	}
+
+	void MakeBC7Palette(const BC7Endpoint& endpointA, const BC7Endpoint& endpointB, int palette[16][4])
+	{
+		for (int j = 0; j < 16; j++)
+		{
+			int weight = bc7WeightArray[j];
+			for (int k = 0; k < 4; k++)
+				palette[j][k] = ((64 - weight) * endpointA.Expand(k) + weight * endpointB.Expand(k) + 32) >> 6;
+		}
+	}
+
+	float EvaluateBC7Endpoints(const float texel[16][4], const BC7Endpoint& endpointA, const BC7Endpoint& endpointB, int* indexArray)
+	{
+		int palette[16][4];
+		MakeBC7Palette(endpointA, endpointB, palette);
+
+		float channelPalette[4][16];
+		for (int j = 0; j < 16; j++)
+			for (int k = 0; k < 4; k++)
+				channelPalette[k][j] = float(palette[j][k]);
+
+		return FindNearestEntries(texel, channelPalette, 16, 4, indexArray);
+	}
+
+	const int bc7Weight2Array[4] = { 0, 21, 43, 64 };
+
+	int ExpandBC7Color(int value)
+	{
+		return (value << 1) | (value >> 6);
+	}
+
+	void QuantizeBC7Color(const float color[4], int quantized[3])
+	{
+		for (int k = 0; k < 3; k++)
+			quantized[k] = IMZADI_CLAMP(int(::floorf(color[k] * 127.0f / 255.0f + 0.5f)), 0, 127);
+	}
+
+	/**
+	 * Score the 7-bit color endpoints of a mode 5 block against the color of the given texels.
+	 */
+	float EvaluateBC7ColorEndpoints(const float texel[16][4], const int quantizedA[3], const int quantizedB[3], int* indexArray)
+	{
+		float channelPalette[4][16];
+		for (int j = 0; j < 4; j++)
+		{
+			int weight = bc7Weight2Array[j];
+			for (int k = 0; k < 3; k++)
+				channelPalette[k][j] = float(((64 - weight) * ExpandBC7Color(quantizedA[k]) + weight * ExpandBC7Color(quantizedB[k]) + 32) >> 6);
+		}
+
+		return FindNearestEntries(texel, channelPalette, 4, 3, indexArray);
+	}
+
+	/**
+	 * Score the 8-bit alpha endpoints of a mode 5 block against the given texels, which have their alpha in the first channel.
+	 */
+	float EvaluateBC7AlphaEndpoints(const float alphaTexel[16][4], int alphaA, int alphaB, int* indexArray)
+	{
+		float channelPalette[4][16];
+		for (int j = 0; j < 4; j++)
+		{
+			int weight = bc7Weight2Array[j];
+			channelPalette[0][j] = float(((64 - weight) * alphaA + weight * alphaB + 32) >> 6);
+		}
+
+		return FindNearestEntries(alphaTexel, channelPalette, 4, 1, indexArray);
+	}
+}
+
+BlockCompressor::BlockCompressor()
+{
+}
+
+/*virtual*/ BlockCompressor::~BlockCompressor()
+{
+}
+
+/*static*/ const char* BlockCompressor::GetFormatName(Format format)
+{
+	switch (format)
+	{
+	case Format::BC1:
+		return "BC1";
+	case Format::BC3:
+		return "BC3";
+	case Format::BC4:
+		return "BC4";
+	case Format::BC7:
+		return "BC7";
+	}
+
+	return "?";
+}
+
+/*static*/ uint32_t BlockCompressor::GetBlockSizeBytes(Format format)
+{
+	switch (format)
+	{
+	case Format::BC1:
+	case Format::BC4:
+		return 8;
+	case Format::BC3:
+	case Format::BC7:
+		return 16;
+	}
+
+	return 0;
+}
+
+/*static*/ uint32_t BlockCompressor::GetImageSizeBytes(Format format, uint32_t width, uint32_t height)
+{
+	return ((width + 3) / 4) * ((height + 3) / 4) * GetBlockSizeBytes(format);
+}
+
+void BlockCompressor::Compress(const unsigned char* rgbaTexels, uint32_t width, uint32_t height, Format format, std::vector<unsigned char>& blockData, Imzadi::JobSystem* jobSystem)
+{
+	uint32_t numBlocksX = (width + 3) / 4;
+	uint32_t numBlocksY = (height + 3) / 4;
+	uint32_t blockSizeBytes = GetBlockSizeBytes(format);
+
+	size_t offset = blockData.size();
+	blockData.resize(offset + numBlocksX * numBlocksY * blockSizeBytes);
+	unsigned char* blockRows = &blockData[offset];
+
+	auto encodeFunc = [=](uint32_t begin, uint32_t end)
+	{
+		for (uint32_t blockY = begin; blockY < end; blockY++)
+		{
+			for (uint32_t blockX = 0; blockX < numBlocksX; blockX++)
+			{
+				// Blocks hanging off the edge of the image repeat its last row and column.
+				Block block;
+				for (int i = 0; i < 16; i++)
+				{
+					uint32_t x = IMZADI_MIN(blockX * 4 + (i % 4), width - 1);
+					uint32_t y = IMZADI_MIN(blockY * 4 + (i / 4), height - 1);
+					const unsigned char* rgbaTexel = &rgbaTexels[(y * width + x) * 4];
+					for (int k = 0; k < 4; k++)
+						block.texel[i][k] = float(rgbaTexel[k]);
+				}
+
+				unsigned char* blockBytes = &blockRows[(blockY * numBlocksX + blockX) * blockSizeBytes];
+				switch (format)
+				{
+				case Format::BC1:
+					EncodeColorBlock(block, blockBytes);
+					break;
+				case Format::BC3:
+					EncodeAlphaBlock(block, blockBytes);
+					EncodeColorBlock(block, blockBytes + 8);
+					break;
+				case Format::BC4:
+					EncodeAlphaBlock(block, blockBytes);
+					break;
+				case Format::BC7:
+					EncodeBC7Block(block, blockBytes);
+					break;
+				}
+			}
+		}
+	};
+
+	if (jobSystem)
+		jobSystem->ParallelFor(numBlocksY, 1, encodeFunc);
+	else
+		encodeFunc(0, numBlocksY);
+}
+
+void BlockCompressor::Decompress(const unsigned char* blockData, uint32_t width, uint32_t height, Format format, std::vector<unsigned char>& rgbaTexels)
+{
+	uint32_t numBlocksX = (width + 3) / 4;
+	uint32_t numBlocksY = (height + 3) / 4;
+	uint32_t blockSizeBytes = GetBlockSizeBytes(format);
+
+	rgbaTexels.resize(width * height * 4);
+
+	for (uint32_t blockY = 0; blockY < numBlocksY; blockY++)
+	{
+		for (uint32_t blockX = 0; blockX < numBlocksX; blockX++)
+		{
+			const unsigned char* blockBytes = &blockData[(blockY * numBlocksX + blockX) * blockSizeBytes];
+
+			unsigned char texel[16][4];
+			::memset(texel, 0, sizeof(texel));
+			switch (format)
+			{
+			case Format::BC1:
+				DecodeColorBlock(blockBytes, texel);
+				break;
+			case Format::BC3:
+				DecodeColorBlock(blockBytes + 8, texel);
+				DecodeAlphaBlock(blockBytes, texel);
+				break;
+			case Format::BC4:
+				DecodeAlphaBlock(blockBytes, texel);
+				break;
+			case Format::BC7:
+				DecodeBC7Block(blockBytes, texel);
+				break;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				uint32_t x = blockX * 4 + (i % 4);
+				uint32_t y = blockY * 4 + (i / 4);
+				if (x < width && y < height)
+					::memcpy(&rgbaTexels[(y * width + x) * 4], texel[i], 4);
+			}
+		}
+	}
+}
+
+/*static*/ double BlockCompressor::CalcPSNR(const unsigned char* originalTexels, const unsigned char* rgbaTexels, uint32_t width, uint32_t height, Format format)
+{
+	int firstChannel = 0, lastChannel = 3;
+	if (format == Format::BC1)
+		lastChannel = 2;
+	else if (format == Format::BC4)
+		firstChannel = 3;
+
+	double totalSquaredError = 0.0;
+	for (uint32_t i = 0; i < width * height; i++)
+	{
+		for (int k = firstChannel; k <= lastChannel; k++)
+		{
+			double delta = double(originalTexels[i * 4 + k]) - double(rgbaTexels[i * 4 + k]);
+			totalSquaredError += delta * delta;
+		}
+	}
+
+	double meanSquaredError = totalSquaredError / double(width * height * (lastChannel - firstChannel + 1));
+	if (meanSquaredError == 0.0)
+		return 100.0;
+
+	return IMZADI_MIN(10.0 * ::log10(255.0 * 255.0 / meanSquaredError), 100.0);
+}
+
+/*static*/ void BlockCompressor::EncodeColorBlock(const Block& block, unsigned char* blockBytes)
+{
+	float endpointA[4], endpointB[4];
+	FindPrincipalEndpoints(block.texel, 3, endpointA, endpointB);
+
+	int bestA[3], bestB[3], bestIndexArray[16];
+	QuantizeColor565(endpointA, bestA);
+	QuantizeColor565(endpointB, bestB);
+	float bestError = EvaluateColorEndpoints(block.texel, bestA, bestB, bestIndexArray);
+
+	// Fit the endpoints to the texels as the indices place them, which can move them beyond the extremes of the block.
+	static const float weightArray[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	for (int iteration = 0; iteration < 2; iteration++)
+	{
+		float weight[16];
+		for (int i = 0; i < 16; i++)
+			weight[i] = weightArray[bestIndexArray[i]];
+
+		if (!FitEndpoints(block.texel, weight, 3, endpointA, endpointB))
+			break;
+
+		int trialA[3], trialB[3], trialIndexArray[16];
+		QuantizeColor565(endpointA, trialA);
+		QuantizeColor565(endpointB, trialB);
+		float error = EvaluateColorEndpoints(block.texel, trialA, trialB, trialIndexArray);
+		if (error >= bestError)
+			break;
+
+		bestError = error;
+		::memcpy(bestA, trialA, sizeof(bestA));
+		::memcpy(bestB, trialB, sizeof(bestB));
+		::memcpy(bestIndexArray, trialIndexArray, sizeof(bestIndexArray));
+	}
+
+	// Rounding to 5:6:5 can land just off the best endpoints, so nudge each channel of each endpoint to see if that helps.
+	static const int maxQuantized[3] = { 31, 63, 31 };
+	bool improved = true;
+	for (int round = 0; round < 2 && improved; round++)
+	{
+		improved = false;
+		for (int trial = 0; trial < 12; trial++)
+		{
+			int trialA[3], trialB[3], trialIndexArray[16];
+			::memcpy(trialA, bestA, sizeof(trialA));
+			::memcpy(trialB, bestB, sizeof(trialB));
+
+			int* quantized = (trial < 6) ? trialA : trialB;
+			int channel = (trial % 6) / 2;
+			quantized[channel] += (trial % 2 == 0) ? -1 : 1;
+			if (quantized[channel] < 0 || quantized[channel] > maxQuantized[channel])
+				continue;
+
+			float error = EvaluateColorEndpoints(block.texel, trialA, trialB, trialIndexArray);
+			if (error < bestError)
+			{
+				bestError = error;
+				::memcpy(bestA, trialA, sizeof(bestA));
+				::memcpy(bestB, trialB, sizeof(bestB));
+				::memcpy(bestIndexArray, trialIndexArray, sizeof(bestIndexArray));
+				improved = true;
+			}
+		}
+	}
+
+	// The first endpoint must be the greater for the block to have four colors.
+	uint16_t packedA = PackColor565(bestA);
+	uint16_t packedB = PackColor565(bestB);
+	if (packedA < packedB)
+	{
+		std::swap(packedA, packedB);
+		static const int swapArray[4] = { 1, 0, 3, 2 };
+		for (int i = 0; i < 16; i++)
+			bestIndexArray[i] = swapArray[bestIndexArray[i]];
+	}
+	else if (packedA == packedB)
+	{
+		for (int i = 0; i < 16; i++)
+			bestIndexArray[i] = 0;
+	}
+
+	BitWriter writer(blockBytes, 8);
+	writer.Write(packedA, 16);
+	writer.Write(packedB, 16);
+	for (int i = 0; i < 16; i++)
+		writer.Write(bestIndexArray[i], 2);
+}
+
+/*static*/ void BlockCompressor::EncodeAlphaBlock(const Block& block, unsigned char* blockBytes)
+{
+	int minAlpha = 255, maxAlpha = 0;
+	int minInnerAlpha = 255, maxInnerAlpha = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		int alpha = int(block.texel[i][3]);
+		minAlpha = IMZADI_MIN(minAlpha, alpha);
+		maxAlpha = IMZADI_MAX(maxAlpha, alpha);
+		if (alpha != 0 && alpha != 255)
+		{
+			minInnerAlpha = IMZADI_MIN(minInnerAlpha, alpha);
+			maxInnerAlpha = IMZADI_MAX(maxInnerAlpha, alpha);
+		}
+	}
+
+	// Try spreading all eight entries over the whole range, and try spreading six over what's left
+	// once 0 and 255, which get entries of their own, are set aside.  The latter is often better for
+	// blocks on the edge of something opaque, like the glyphs of a font.
+	int bestA = maxAlpha, bestB = minAlpha, bestIndexArray[16];
+	float bestError = EvaluateAlphaEndpoints(block.texel, bestA, bestB, bestIndexArray);
+
+	if (bestError > 0.0f)
+	{
+		int innerA = (minInnerAlpha <= maxInnerAlpha) ? minInnerAlpha : 0;
+		int innerB = (minInnerAlpha <= maxInnerAlpha) ? maxInnerAlpha : 255;
+
+		int trialIndexArray[16];
+		float error = EvaluateAlphaEndpoints(block.texel, innerA, innerB, trialIndexArray);
+		if (error < bestError)
+		{
+			bestError = error;
+			bestA = innerA;
+			bestB = innerB;
+			::memcpy(bestIndexArray, trialIndexArray, sizeof(bestIndexArray));
+		}
+	}
+
+	BitWriter writer(blockBytes, 8);
+	writer.Write(bestA, 8);
+	writer.Write(bestB, 8);
+	for (int i = 0; i < 16; i++)
+		writer.Write(bestIndexArray[i], 3);
+}
+
+/*static*/ void BlockCompressor::EncodeBC7Block(const Block& block, unsigned char* blockBytes)
+{
+	// Mode 6 does well where alpha varies along with color, and mode 5 where it doesn't, so try both.
+	float error = EncodeBC7Mode6(block, blockBytes);
+	if (error > 0.0f)
+	{
+		unsigned char mode5BlockBytes[16];
+		if (EncodeBC7Mode5(block, mode5BlockBytes) < error)
+			::memcpy(blockBytes, mode5BlockBytes, sizeof(mode5BlockBytes));
+	}
+}
+
+/*static*/ float BlockCompressor::EncodeBC7Mode6(const Block& block, unsigned char* blockBytes)
+{
+	float endpointColorA[4], endpointColorB[4];
+	FindPrincipalEndpoints(block.texel, 4, endpointColorA, endpointColorB);
+
+	BC7Endpoint bestA, bestB;
+	int bestIndexArray[16];
+	QuantizeBC7Endpoint(endpointColorA, bestA);
+	QuantizeBC7Endpoint(endpointColorB, bestB);
+	float bestError = EvaluateBC7Endpoints(block.texel, bestA, bestB, bestIndexArray);
+
+	for (int iteration = 0; iteration < 2 && bestError > 0.0f; iteration++)
+	{
+		float weight[16];
+		for (int i = 0; i < 16; i++)
+			weight[i] = float(bc7WeightArray[bestIndexArray[i]]) / 64.0f;
+
+		if (!FitEndpoints(block.texel, weight, 4, endpointColorA, endpointColorB))
+			break;
+
+		BC7Endpoint trialA, trialB;
+		int trialIndexArray[16];
+		QuantizeBC7Endpoint(endpointColorA, trialA);
+		QuantizeBC7Endpoint(endpointColorB, trialB);
+		float error = EvaluateBC7Endpoints(block.texel, trialA, trialB, trialIndexArray);
+		if (error >= bestError)
+			break;
+
+		bestError = error;
+		bestA = trialA;
+		bestB = trialB;
+		::memcpy(bestIndexArray, trialIndexArray, sizeof(bestIndexArray));
+	}
+
+	// Nudge each channel of each endpoint, and flip each endpoint's shared bit, to see if that helps.
+	bool improved = true;
+	for (int round = 0; round < 2 && improved && bestError > 0.0f; round++)
+	{
+		improved = false;
+		for (int trial = 0; trial < 19; trial++)
+		{
+			BC7Endpoint trialA = bestA, trialB = bestB;
+			int trialIndexArray[16];
+
+			if (trial < 16)
+			{
+				BC7Endpoint& endpoint = (trial < 8) ? trialA : trialB;
+				int channel = (trial % 8) / 2;
+				endpoint.value[channel] += (trial % 2 == 0) ? -1 : 1;
+				if (endpoint.value[channel] < 0 || endpoint.value[channel] > 127)
+					continue;
+			}
+			else
+			{
+				int flip = trial - 15;
+				if (flip & 1)
+					trialA.pBit ^= 1;
+				if (flip & 2)
+					trialB.pBit ^= 1;
+			}
+
+			float error = EvaluateBC7Endpoints(block.texel, trialA, trialB, trialIndexArray);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestA = trialA;
+				bestB = trialB;
+				::memcpy(bestIndexArray, trialIndexArray, sizeof(bestIndexArray));
+				improved = true;
+			}
+		}
+	}
+
+	// The most significant bit of the first texel's index isn't stored, so it must be zero.
+	if (bestIndexArray[0] >= 8)
+	{
+		std::swap(bestA, bestB);
+		for (int i = 0; i < 16; i++)
+			bestIndexArray[i] = 15 - bestIndexArray[i];
+	}
+
+	BitWriter writer(blockBytes, 16);
+	writer.Write(1 << 6, 7);
+	for (int k = 0; k < 4; k++)
+	{
+		writer.Write(bestA.value[k], 7);
+		writer.Write(bestB.value[k], 7);
+	}
+	writer.Write(bestA.pBit, 1);
+	writer.Write(bestB.pBit, 1);
+	writer.Write(bestIndexArray[0], 3);
+	for (int i = 1; i < 16; i++)
+		writer.Write(bestIndexArray[i], 4);
+
+	return bestError;
+}
+
+/*static*/ float BlockCompressor::EncodeBC7Mode5(const Block& block, unsigned char* blockBytes)
+{
+	// Mode 5 gives color and alpha endpoints and indices of their own, so fit each separately.
+	float endpointColorA[4], endpointColorB[4];
+	FindPrincipalEndpoints(block.texel, 3, endpointColorA, endpointColorB);
+
+	int bestA[3], bestB[3], bestIndexArray[16];
+	QuantizeBC7Color(endpointColorA, bestA);
+	QuantizeBC7Color(endpointColorB, bestB);
+	float bestError = EvaluateBC7ColorEndpoints(block.texel, bestA, bestB, bestIndexArray);
+
+	for (int iteration = 0; iteration < 2 && bestError > 0.0f; iteration++)
+	{
+		float weight[16];
+		for (int i = 0; i < 16; i++)
+			weight[i] = float(bc7Weight2Array[bestIndexArray[i]]) / 64.0f;
+
+		if (!FitEndpoints(block.texel, weight, 3, endpointColorA, endpointColorB))
+			break;
+
+		int trialA[3], trialB[3], trialIndexArray[16];
+		QuantizeBC7Color(endpointColorA, trialA);
+		QuantizeBC7Color(endpointColorB, trialB);
+		float error = EvaluateBC7ColorEndpoints(block.texel, trialA, trialB, trialIndexArray);
+		if (error >= bestError)
+			break;
+
+		bestError = error;
+		::memcpy(bestA, trialA, sizeof(bestA));
+		::memcpy(bestB, trialB, sizeof(bestB));
+		::memcpy(bestIndexArray, trialIndexArray, sizeof(bestIndexArray));
+	}
+
+	bool improved = true;
+	for (int round = 0; round < 2 && improved && bestError > 0.0f; round++)
+	{
+		improved = false;
+		for (int trial = 0; trial < 12; trial++)
+		{
+			int trialA[3], trialB[3], trialIndexArray[16];
+			::memcpy(trialA, bestA, sizeof(trialA));
+			::memcpy(trialB, bestB, sizeof(trialB));
+
+			int* quantized = (trial < 6) ? trialA : trialB;
+			int channel = (trial % 6) / 2;
+			quantized[channel] += (trial % 2 == 0) ? -1 : 1;
+			if (quantized[channel] < 0 || quantized[channel] > 127)
+				continue;
+
+			float error = EvaluateBC7ColorEndpoints(block.texel, trialA, trialB, trialIndexArray);
+			if (error < bestError)
+			{
+				bestError = error;
+				::memcpy(bestA, trialA, sizeof(bestA));
+				::memcpy(bestB, trialB, sizeof(bestB));
+				::memcpy(bestIndexArray, trialIndexArray, sizeof(bestIndexArray));
+				improved = true;
+			}
+		}
+	}
+
+	float alphaTexel[16][4];
+	int minAlpha = 255, maxAlpha = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		alphaTexel[i][0] = block.texel[i][3];
+		minAlpha = IMZADI_MIN(minAlpha, int(block.texel[i][3]));
+		maxAlpha = IMZADI_MAX(maxAlpha, int(block.texel[i][3]));
+	}
+
+	int bestAlphaA = minAlpha, bestAlphaB = maxAlpha, bestAlphaIndexArray[16];
+	float bestAlphaError = EvaluateBC7AlphaEndpoints(alphaTexel, bestAlphaA, bestAlphaB, bestAlphaIndexArray);
+
+	for (int iteration = 0; iteration < 2 && bestAlphaError > 0.0f; iteration++)
+	{
+		float weight[16];
+		for (int i = 0; i < 16; i++)
+			weight[i] = float(bc7Weight2Array[bestAlphaIndexArray[i]]) / 64.0f;
+
+		float alphaA[4], alphaB[4];
+		if (!FitEndpoints(alphaTexel, weight, 1, alphaA, alphaB))
+			break;
+
+		int trialAlphaA = int(::floorf(alphaA[0] + 0.5f));
+		int trialAlphaB = int(::floorf(alphaB[0] + 0.5f));
+		int trialIndexArray[16];
+		float error = EvaluateBC7AlphaEndpoints(alphaTexel, trialAlphaA, trialAlphaB, trialIndexArray);
+		if (error >= bestAlphaError)
+			break;
+
+		bestAlphaError = error;
+		bestAlphaA = trialAlphaA;
+		bestAlphaB = trialAlphaB;
+		::memcpy(bestAlphaIndexArray, trialIndexArray, sizeof(bestAlphaIndexArray));
+	}
+
+	// As in mode 6, the most significant bit of the first texel's color and alpha indices isn't stored.
+	if (bestIndexArray[0] >= 2)
+	{
+		std::swap(bestA, bestB);
+		for (int i = 0; i < 16; i++)
+			bestIndexArray[i] = 3 - bestIndexArray[i];
+	}
+
+	if (bestAlphaIndexArray[0] >= 2)
+	{
+		std::swap(bestAlphaA, bestAlphaB);
+		for (int i = 0; i < 16; i++)
+			bestAlphaIndexArray[i] = 3 - bestAlphaIndexArray[i];
+	}
+
+	// We never rotate alpha into one of the color channels.
+	BitWriter writer(blockBytes, 16);
+	writer.Write(1 << 5, 6);
+	writer.Write(0, 2);
+	for (int k = 0; k < 3; k++)
+	{
+		writer.Write(bestA[k], 7);
+		writer.Write(bestB[k], 7);
+	}
+	writer.Write(bestAlphaA, 8);
+	writer.Write(bestAlphaB, 8);
+	writer.Write(bestIndexArray[0], 1);
+	for (int i = 1; i < 16; i++)
+		writer.Write(bestIndexArray[i], 2);
+	writer.Write(bestAlphaIndexArray[0], 1);
+	for (int i = 1; i < 16; i++)
+		writer.Write(bestAlphaIndexArray[i], 2);
+
+	return bestError + bestAlphaError;
+}
+
+/*static*/ void BlockCompressor::DecodeColorBlock(const unsigned char* blockBytes, unsigned char texel[16][4])
+{
+	BitReader reader(blockBytes);
+	uint16_t packedA = uint16_t(reader.Read(16));
+	uint16_t packedB = uint16_t(reader.Read(16));
+
+	int quantizedA[3], quantizedB[3];
+	UnpackColor565(packedA, quantizedA);
+	UnpackColor565(packedB, quantizedB);
+
+	int palette[4][3];
+	MakeColorPalette(quantizedA, quantizedB, palette);
+	int paletteAlpha[4] = { 255, 255, 255, 255 };
+
+	// Unless the first endpoint is the greater, there are only three colors, the third half-way between the endpoints, and then transparent black.
+	if (packedA <= packedB)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			palette[2][k] = (palette[0][k] + palette[1][k]) / 2;
+			palette[3][k] = 0;
+		}
+
+		paletteAlpha[3] = 0;
+	}
+
+	for (int i = 0; i < 16; i++)
+	{
+		int index = reader.Read(2);
+		for (int k = 0; k < 3; k++)
+			texel[i][k] = (unsigned char)palette[index][k];
+		texel[i][3] = (unsigned char)paletteAlpha[index];
+	}
+}
+
+/*static*/ void BlockCompressor::DecodeAlphaBlock(const unsigned char* blockBytes, unsigned char texel[16][4])
+{
+	BitReader reader(blockBytes);
+	int endpointA = reader.Read(8);
+	int endpointB = reader.Read(8);
+
+	int palette[8];
+	MakeAlphaPalette(endpointA, endpointB, palette);
+
+	for (int i = 0; i < 16; i++)
+		texel[i][3] = (unsigned char)palette[reader.Read(3)];
+}
+
+/*static*/ void BlockCompressor::DecodeBC7Block(const unsigned char* blockBytes, unsigned char texel[16][4])
+{
+	// We only ever encode modes 5 and 6, so those are all we decode.
+	BitReader reader(blockBytes);
+	int mode = 0;
+	while (mode < 8 && reader.Read(1) == 0)
+		mode++;
+
+	if (mode == 5)
+	{
+		int rotation = reader.Read(2);
+
+		int colorA[3], colorB[3];
+		for (int k = 0; k < 3; k++)
+		{
+			colorA[k] = ExpandBC7Color(reader.Read(7));
+			colorB[k] = ExpandBC7Color(reader.Read(7));
+		}
+		int alphaA = reader.Read(8);
+		int alphaB = reader.Read(8);
+
+		for (int i = 0; i < 16; i++)
+		{
+			int weight = bc7Weight2Array[reader.Read((i == 0) ? 1 : 2)];
+			for (int k = 0; k < 3; k++)
+				texel[i][k] = (unsigned char)(((64 - weight) * colorA[k] + weight * colorB[k] + 32) >> 6);
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int weight = bc7Weight2Array[reader.Read((i == 0) ? 1 : 2)];
+			texel[i][3] = (unsigned char)(((64 - weight) * alphaA + weight * alphaB + 32) >> 6);
+		}
+
+		if (rotation > 0)
+			for (int i = 0; i < 16; i++)
+				std::swap(texel[i][3], texel[i][rotation - 1]);
+
+		return;
+	}
+
+	if (mode != 6)
+		return;
+
+	BC7Endpoint endpointA, endpointB;
+	for (int k = 0; k < 4; k++)
+	{
+		endpointA.value[k] = reader.Read(7);
+		endpointB.value[k] = reader.Read(7);
+	}
+	endpointA.pBit = reader.Read(1);
+	endpointB.pBit = reader.Read(1);
+
+	int palette[16][4];
+	MakeBC7Palette(endpointA, endpointB, palette);
+
+	for (int i = 0; i < 16; i++)
+	{
+		int index = reader.Read((i == 0) ? 3 : 4);
+		for (int k = 0; k < 4; k++)
+			texel[i][k] = (unsigned char)palette[index][k];
+	}
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+namespace Imzadi
+{
+	class JobSystem;
+}
+
+/**
+ * This encodes images into the block-compressed formats the GPU can sample directly,
+ * so that a texture takes up a quarter or an eighth of the memory it would as raw texels.
+ * Every format here stores each 4x4 block of texels in a fixed number of bytes, as a pair
+ * of endpoint colors and, for each texel, an index into a small palette interpolated
+ * between them.
+ *
+ *  - BC1 stores opaque color in 8 bytes per block.
+ *  - BC3 stores color as BC1 does, plus alpha as BC4 does, in 16 bytes per block.
+ *  - BC4 stores a single channel in 8 bytes per block.  We take it from the alpha channel.
+ *  - BC7 stores color with alpha in 16 bytes per block.  It has eight modes, but we only
+ *    encode two of them, keeping whichever does better for each block.  Mode 6 gives a block
+ *    a single pair of RGBA endpoints and 16 palette entries, and mode 5 gives color and alpha
+ *    endpoints and 4-entry palettes of their own.  That's a good deal better than BC3 for
+ *    most images, though not the best BC7 can do, since we skip the modes that split a block.
+ *
+ * Endpoints are first found along the principal axis of a block's colors, and then refined
+ * by a least-squares fit to the indices they produce and by searching around them for any
+ * that do better.  Each trial is scored by finding the nearest palette entry to every texel,
+ * which is done with SSE, four palette entries at a time.  Rows of blocks are encoded in
+ * parallel on the job system.
+ */
+class BlockCompressor
+{
+public:
+	BlockCompressor();
+	virtual ~BlockCompressor();
+
+	enum Format
+	{
+		BC1,
+		BC3,
+		BC4,
+		BC7
+	};
+
+	/**
+	 * Return the name of the given format as it appears in texture files.
+	 */
+	static const char* GetFormatName(Format format);
+
+	/**
+	 * Return how many bytes each 4x4 block of texels takes up in the given format.
+	 */
+	static uint32_t GetBlockSizeBytes(Format format);
+
+	/**
+	 * Return how many bytes an image of the given size takes up in the given format.
+	 * Images whose dimensions aren't a multiple of four are padded out to whole blocks.
+	 */
+	static uint32_t GetImageSizeBytes(Format format, uint32_t width, uint32_t height);
+
+	/**
+	 * Encode the given image, appending its blocks to the given buffer.
+	 *
+	 * @param[in] rgbaTexels These are the texels of the image, four bytes each, row by row.
+	 * @param[in] width This is the width of the image in texels.
+	 * @param[in] height This is the height of the image in texels.
+	 * @param[in] format This is the format to encode into.
+	 * @param[out] blockData The blocks, row by row, are appended to this.
+	 * @param[in] jobSystem If given, rows of blocks are encoded in parallel on this job system.
+	 */
+	void Compress(const unsigned char* rgbaTexels, uint32_t width, uint32_t height, Format format, std::vector<unsigned char>& blockData, Imzadi::JobSystem* jobSystem);
+
+	/**
+	 * Decode the given blocks back into an image, four bytes per texel.  Channels that the
+	 * format doesn't store are decoded as they would be sampled: zero for color in BC4, and
+	 * opaque alpha in BC1.
+	 */
+	void Decompress(const unsigned char* blockData, uint32_t width, uint32_t height, Format format, std::vector<unsigned char>& rgbaTexels);
+
+	/**
+	 * Return the peak signal-to-noise ratio, in decibels, of the given image against the
+	 * original, over just the channels stored by the given format.  Identical images give 100.
+	 */
+	static double CalcPSNR(const unsigned char* originalTexels, const unsigned char* rgbaTexels, uint32_t width, uint32_t height, Format format);
+
+private:
+
+	/**
+	 * These are the texels of a block, as floats, in the order the block stores them.
+	 */
+	struct Block
+	{
+		float texel[16][4];
+	};
+
+	static void EncodeColorBlock(const Block& block, unsigned char* blockBytes);
+	static void EncodeAlphaBlock(const Block& block, unsigned char* blockBytes);
+	static void EncodeBC7Block(const Block& block, unsigned char* blockBytes);
+	static float EncodeBC7Mode5(const Block& block, unsigned char* blockBytes);
+	static float EncodeBC7Mode6(const Block& block, unsigned char* blockBytes);
+
+	static void DecodeColorBlock(const unsigned char* blockBytes, unsigned char texel[16][4]);
+	static void DecodeAlphaBlock(const unsigned char* blockBytes, unsigned char texel[16][4]);
+	static void DecodeBC7Block(const unsigned char* blockBytes, unsigned char texel[16][4]);
+};
\ No newline at end of file
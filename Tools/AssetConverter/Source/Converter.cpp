@@ -10,6 +10,8 @@
 #include "App.h"
 #include "Frame.h"
 #include "TextureMaker.h"
+#include "NavGraphGenerator.h"
+#include "Game.h"
 #include <wx/textdlg.h>
 
 Converter::Converter()
@@ -49,6 +51,7 @@ bool Converter::Convert(const wxString& assetFile)
 	}
 
 	this->navGraph.Clear();
+	this->navGraphPolygonArray.clear();
 
 	if ((this->flags & Flag::CONVERT_MESHES) != 0)
 	{
@@ -91,11 +94,28 @@ bool Converter::Convert(const wxString& assetFile)
 		}
 	}
 
-	if ((this->flags & Flag::MAKE_NAV_GRAPH) != 0)
+	if ((this->flags & Flag::GENERATE_NAV_GRAPH) != 0)
 	{
+		IMZADI_LOG_INFO("Generating nav-graph from %d collision polygons...", int(this->navGraphPolygonArray.size()));
+
+		NavGraphGenerator navGraphGenerator;
+		if (!navGraphGenerator.Generate(this->navGraphPolygonArray, this->navGraph, Imzadi::Game::Get()->GetJobSystem()))
+		{
+			IMZADI_LOG_ERROR("Failed to generate nav-graph.");
+			return false;
+		}
+
+		this->navGraphPolygonArray.clear();
+	}
+
+	if ((this->flags & (Flag::MAKE_NAV_GRAPH | Flag::GENERATE_NAV_GRAPH)) != 0)
+	{
+		// A generated nav-graph gets a name of its own so that it never replaces one authored in the scene.
 		wxFileName navGraphFile;
 		navGraphFile.SetPath(fileName.GetPath());
 		navGraphFile.SetName(fileName.GetName());
+		if ((this->flags & Flag::GENERATE_NAV_GRAPH) != 0)
+			navGraphFile.SetName(fileName.GetName() + ".generated");
 		navGraphFile.SetExt("nav_graph");
 
 		rapidjson::Document navGraphDoc;
@@ -851,6 +871,16 @@ bool Converter::ProcessMesh(const aiScene* scene, const aiNode* node, const aiMe
 				this->navGraph.AddPathSegment(worldPolygon);
 			}
 		}
+
+		if ((this->flags & Flag::GENERATE_NAV_GRAPH) != 0)
+		{
+			for (const Imzadi::Polygon& polygon : polygonArray)
+			{
+				Imzadi::Polygon worldPolygon;
+				objectToWorld.TransformPolygon(polygon, worldPolygon);
+				this->navGraphPolygonArray.push_back(worldPolygon);
+			}
+		}
 	}
 
 	if (mesh->HasBones())
@@ -1081,6 +1111,9 @@ bool Converter::GenerateSkeleton(Imzadi::Skeleton& skeleton, const aiMesh* mesh)
 	if (!this->GenerateSkeleton(skeleton.GetRootBone(), rootBoneNode, boneSet))
 		return false;
 
+	// The tree was built up under the root, so the skeleton doesn't yet know about it.
+	skeleton.InvalidateFlattenedBones();
+
 	while (true)
 	{
 		Imzadi::Bone* rootBone = skeleton.GetRootBone();
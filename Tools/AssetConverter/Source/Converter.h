@@ -13,6 +13,7 @@
 #include "Assets/SkinWeights.h"
 #include "Assets/Animation.h"
 #include "Assets/NavGraph.h"
+#include "Math/Polygon.h"
 #include "JsonUtils.h"
 #include "TextureMaker.h"
 #include <unordered_set>
@@ -32,7 +33,8 @@ public:
 		MAKE_COLLISION				= 0x00000008,
 		CENTER_OBJ_SPACE_AT_ORIGIN	= 0x00000010,
 		COMPRESS_COLLISION			= 0x00000020,
-		MAKE_NAV_GRAPH				= 0x00000040
+		MAKE_NAV_GRAPH				= 0x00000040,
+		GENERATE_NAV_GRAPH			= 0x00000080
 	};
 
 	void SetFlags(uint32_t flags) { this->flags = flags; }
@@ -41,6 +43,8 @@ public:
 	void SetTextureMakerFlags(uint32_t textureMakerFlags) { this->textureMakerFlags = textureMakerFlags; }
 	uint32_t GetTextureMakerFlags() const { return this->textureMakerFlags; }
 
+	void SetTextureCompressionLevel(int compressionLevel) { this->textureMaker.SetCompressionLevel(compressionLevel); }
+
 	bool Convert(const wxString& assetFile);
 
 private:
@@ -80,6 +84,7 @@ private:
 	std::unordered_map<const aiNode*, Imzadi::Transform> nodeToWorldMap;
 	TextureMaker textureMaker;
 	Imzadi::NavGraph navGraph;
+	std::vector<Imzadi::Polygon> navGraphPolygonArray;
 	uint32_t flags;
 	uint32_t textureMakerFlags;
 };
\ No newline at end of file
@@ -225,7 +225,7 @@ bool FontMaker::MakeFont(const wxString& fontFile)
 		fontDoc.AddMember("character_array", characterArrayValue, fontDoc.GetAllocator());
 
 		TextureMaker textureMaker;
-		if (!textureMaker.MakeTexture(atlasFileName.GetFullPath(), TextureMaker::Flag::ALPHA | TextureMaker::Flag::COMPRESS))
+		if (!textureMaker.MakeTexture(atlasFileName.GetFullPath(), TextureMaker::Flag::ALPHA | TextureMaker::Flag::BLOCK_COMPRESS | TextureMaker::Flag::COMPRESS))
 			break;
 
 		fontDoc.AddMember("texture", rapidjson::Value().SetString(wxGetApp().MakeAssetFileReference(textureMaker.GetTextureFilePath()), fontDoc.GetAllocator()), fontDoc.GetAllocator());
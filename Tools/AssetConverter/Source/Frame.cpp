@@ -8,14 +8,17 @@
 #include "RenderObjectList.h"
 #include "RenderObjectProperties.h"
 #include "FontMaker.h"
+#include "NavGraphGenerator.h"
 #include "RenderObjects/TextRenderObject.h"
 #include "AnimationSlider.h"
+#include "LZCodec.h"
 #include <wx/menu.h>
 #include <wx/sizer.h>
 #include <wx/aboutdlg.h>
 #include <wx/filedlg.h>
 #include <wx/msgdlg.h>
 #include <wx/choicdlg.h>
+#include <wx/numdlg.h>
 #include <wx/splitter.h>
 #include <wx/panel.h>
 #include <wx/filename.h>
@@ -152,6 +155,7 @@ void Frame::OnConvertAsset(wxCommandEvent& event)
 
 	uint32_t textureMakerFlags = 0;
 	uint32_t converterFlags = 0;
+	int textureCompressionLevel = Imzadi::LZCodec::DEFAULT_LEVEL;
 
 	bool textureMakerFlagsNeeded = false;
 	bool converterFlagsNeeded = false;
@@ -183,7 +187,8 @@ void Frame::OnConvertAsset(wxCommandEvent& event)
 			{"Compress Collision", Converter::Flag::COMPRESS_COLLISION},
 			{"Sky Dome", Converter::Flag::CONVERT_SKYDOME},
 			{"Center Obj. Space at Origin", Converter::Flag::CENTER_OBJ_SPACE_AT_ORIGIN},
-			{"Nav. Graph", Converter::Flag::MAKE_NAV_GRAPH}
+			{"Nav. Graph", Converter::Flag::MAKE_NAV_GRAPH},
+			{"Nav. Graph (Voxelized)", Converter::Flag::GENERATE_NAV_GRAPH}
 		};
 
 		if (!this->FlagsFromDialog("Import what (and how) across all chosen export files?", flagChoiceArray, converterFlags))
@@ -196,6 +201,8 @@ void Frame::OnConvertAsset(wxCommandEvent& event)
 			{"Color", TextureMaker::Flag::COLOR},
 			{"Alpha", TextureMaker::Flag::ALPHA},
 			{"Compress", TextureMaker::Flag::COMPRESS},
+			{"Block Compress", TextureMaker::Flag::BLOCK_COMPRESS},
+			{"Block Compress as BC7", TextureMaker::Flag::BLOCK_COMPRESS_BC7},
 			{"Flip Vertical", TextureMaker::Flag::FLIP_VERTICAL},
 			{"Flip Horizontal", TextureMaker::Flag::FLIP_HORIZONTAL},
 			{"Make Alpha", TextureMaker::Flag::MAKE_ALPHA},
@@ -205,6 +212,18 @@ void Frame::OnConvertAsset(wxCommandEvent& event)
 
 		if (!this->FlagsFromDialog("Build textures how across all selected textures or those found in all chosen export files?", flagChoiceArray, textureMakerFlags))
 			return;
+
+		if ((textureMakerFlags & TextureMaker::Flag::COMPRESS) != 0)
+		{
+			wxString prompt = "Compress textures at what level?  Higher levels make smaller files, but take longer to build.  They load just as fast.";
+			wxConfig* config = wxGetApp().GetConfig();
+			long level = wxGetNumberFromUser(prompt, "Level:", "Choose, Please", config->Read(prompt, long(textureCompressionLevel)), Imzadi::LZCodec::MIN_LEVEL, Imzadi::LZCodec::MAX_LEVEL, this);
+			if (level < 0)
+				return;
+
+			config->Write(prompt, level);
+			textureCompressionLevel = int(level);
+		}
 	}
 
 	for (const wxString& file : fileArray)
@@ -219,12 +238,19 @@ void Frame::OnConvertAsset(wxCommandEvent& event)
 		else if (ext == "png")
 		{
 			TextureMaker textureMaker;
+			textureMaker.SetCompressionLevel(textureCompressionLevel);
 			textureMaker.MakeTexture(file, textureMakerFlags);
 		}
+		else if (ext == "level")
+		{
+			NavGraphGenerator navGraphGenerator;
+			navGraphGenerator.GenerateForLevel(file);
+		}
 		else
 		{
 			converter.SetFlags(converterFlags);
 			converter.SetTextureMakerFlags(textureMakerFlags);
+			converter.SetTextureCompressionLevel(textureCompressionLevel);
 			converter.Convert(file);
 		}
 	}
@@ -0,0 +1,1060 @@
+#include "NavGraphGenerator.h"
+#include "JsonUtils.h"
+#include "Game.h"
+#include "JobSystem.h"
+#include "AssetCache.h"
+#include "Assets/CollisionShapeSet.h"
+#include "Collision/Shapes/Polygon.h"
+#include "Clock.h"
+#include "Log.h"
+#include <wx/filename.h>
+#include <algorithm>
+#include <functional>
+#include <climits>
+#include <cfloat>
+
+// These are indexed by direction: +X, +Z, -X, -Z.
+static const int directionX[4] = { 1, 0, -1, 0 };
+static const int directionZ[4] = { 0, 1, 0, -1 };
+
+static const uint8_t noConnection = 0xFF;
+
+/**
+ * Clip the given convex polygon against the half-space where the X or Z
+ * coordinate, times the given sign, is no less than the given bound times that sign.
+ */
+static int ClipToHalfSpace(const Imzadi::Vector3* inVertexArray, int numInVertices, Imzadi::Vector3* outVertexArray, bool alongX, double bound, double sign)
+{
+	int numOutVertices = 0;
+
+	for (int i = 0; i < numInVertices; i++)
+	{
+		const Imzadi::Vector3& vertexA = inVertexArray[i];
+		const Imzadi::Vector3& vertexB = inVertexArray[(i + 1) % numInVertices];
+
+		double distanceA = sign * ((alongX ? vertexA.x : vertexA.z) - bound);
+		double distanceB = sign * ((alongX ? vertexB.x : vertexB.z) - bound);
+
+		if (distanceA >= 0.0)
+			outVertexArray[numOutVertices++] = vertexA;
+
+		if ((distanceA >= 0.0) != (distanceB >= 0.0))
+		{
+			double alpha = distanceA / (distanceA - distanceB);
+			outVertexArray[numOutVertices++] = vertexA + (vertexB - vertexA) * alpha;
+		}
+	}
+
+	return numOutVertices;
+}
+
+NavGraphGenerator::NavGraphGenerator()
+{
+	this->settings.voxelSize = 0.5;
+	this->settings.voxelHeight = 0.25;
+	this->settings.agentHeight = 6.0;
+	this->settings.agentRadius = 1.0;
+	this->settings.maxSlopeDegrees = 45.0;
+	this->settings.maxStepHeight = 1.0;
+	this->settings.nodeSpacing = 16.0;
+	this->settings.tileSize = 128;
+
+	this->numColumnsX = 0;
+	this->numColumnsZ = 0;
+	this->numTilesX = 0;
+	this->numTilesZ = 0;
+	this->tileColumns = 0;
+	this->blockColumns = 0;
+	this->padColumns = 0;
+	this->heightVoxels = 0;
+	this->stepVoxels = 0;
+	this->radiusColumns = 0;
+}
+
+/*virtual*/ NavGraphGenerator::~NavGraphGenerator()
+{
+}
+
+bool NavGraphGenerator::Generate(const std::vector<Imzadi::Polygon>& worldPolygonArray, Imzadi::NavGraph& navGraph, Imzadi::JobSystem* jobSystem)
+{
+	Imzadi::Clock clock;
+	clock.Reset();
+
+	navGraph.Clear();
+	this->triangleArray.clear();
+	this->tileArray.clear();
+
+	if (this->settings.voxelSize <= 0.0 || this->settings.voxelHeight <= 0.0 || this->settings.nodeSpacing < this->settings.voxelSize || this->settings.tileSize <= 0)
+	{
+		IMZADI_LOG_ERROR("The nav-graph generator settings are not valid.");
+		return false;
+	}
+
+	// Walkability is decided per triangle, so break the polygons up into fans.
+	double minWalkableNormalY = ::cos(IMZADI_CLAMP(this->settings.maxSlopeDegrees, 0.0, 90.0) * M_PI / 180.0);
+	Imzadi::Vector3 maxCorner(-DBL_MAX, -DBL_MAX, -DBL_MAX);
+	this->minCorner.SetComponents(DBL_MAX, DBL_MAX, DBL_MAX);
+	for (const Imzadi::Polygon& polygon : worldPolygonArray)
+	{
+		for (int i = 1; i + 1 < (int)polygon.vertexArray.size(); i++)
+		{
+			Triangle triangle;
+			triangle.vertex[0] = polygon.vertexArray[0];
+			triangle.vertex[1] = polygon.vertexArray[i];
+			triangle.vertex[2] = polygon.vertexArray[i + 1];
+
+			Imzadi::Vector3 normal = (triangle.vertex[1] - triangle.vertex[0]).Cross(triangle.vertex[2] - triangle.vertex[0]);
+			double length = normal.Length();
+			if (length < 1e-9)
+				continue;
+
+			triangle.walkable = normal.y / length >= minWalkableNormalY;
+
+			for (const Imzadi::Vector3& vertex : triangle.vertex)
+			{
+				this->minCorner.SetComponents(IMZADI_MIN(this->minCorner.x, vertex.x), IMZADI_MIN(this->minCorner.y, vertex.y), IMZADI_MIN(this->minCorner.z, vertex.z));
+				maxCorner.SetComponents(IMZADI_MAX(maxCorner.x, vertex.x), IMZADI_MAX(maxCorner.y, vertex.y), IMZADI_MAX(maxCorner.z, vertex.z));
+			}
+
+			this->triangleArray.push_back(triangle);
+		}
+	}
+
+	if (this->triangleArray.size() == 0)
+	{
+		IMZADI_LOG_ERROR("There is no geometry from which to generate a nav-graph.");
+		return false;
+	}
+
+	double voxelSize = this->settings.voxelSize;
+	this->radiusColumns = (int)::ceil(this->settings.agentRadius / voxelSize);
+	this->padColumns = this->radiusColumns + 2;
+	this->heightVoxels = (int)::ceil(this->settings.agentHeight / this->settings.voxelHeight);
+	this->stepVoxels = (int)::floor(this->settings.maxStepHeight / this->settings.voxelHeight);
+	this->blockColumns = IMZADI_MAX(1, (int)::round(this->settings.nodeSpacing / voxelSize));
+	this->tileColumns = IMZADI_MAX(1, (this->settings.tileSize + this->blockColumns - 1) / this->blockColumns) * this->blockColumns;
+	this->numColumnsX = IMZADI_MAX(1, (int)::ceil((maxCorner.x - this->minCorner.x) / voxelSize));
+	this->numColumnsZ = IMZADI_MAX(1, (int)::ceil((maxCorner.z - this->minCorner.z) / voxelSize));
+	this->numTilesX = (this->numColumnsX + this->tileColumns - 1) / this->tileColumns;
+	this->numTilesZ = (this->numColumnsZ + this->tileColumns - 1) / this->tileColumns;
+
+	this->tileArray.resize(this->numTilesX * this->numTilesZ);
+	for (int tileZ = 0; tileZ < this->numTilesZ; tileZ++)
+	{
+		for (int tileX = 0; tileX < this->numTilesX; tileX++)
+		{
+			Tile& tile = this->tileArray[tileZ * this->numTilesX + tileX];
+			tile.x = tileX * this->tileColumns;
+			tile.z = tileZ * this->tileColumns;
+			tile.width = IMZADI_MIN(this->tileColumns, this->numColumnsX - tile.x);
+			tile.depth = IMZADI_MIN(this->tileColumns, this->numColumnsZ - tile.z);
+			tile.firstRegionNode = 0;
+			tile.firstPortalNode = 0;
+		}
+	}
+
+	// Give each tile the triangles that overlap it, counting its padding.
+	for (int i = 0; i < (int)this->triangleArray.size(); i++)
+	{
+		const Triangle& triangle = this->triangleArray[i];
+
+		double minX = IMZADI_MIN(triangle.vertex[0].x, IMZADI_MIN(triangle.vertex[1].x, triangle.vertex[2].x));
+		double maxX = IMZADI_MAX(triangle.vertex[0].x, IMZADI_MAX(triangle.vertex[1].x, triangle.vertex[2].x));
+		double minZ = IMZADI_MIN(triangle.vertex[0].z, IMZADI_MIN(triangle.vertex[1].z, triangle.vertex[2].z));
+		double maxZ = IMZADI_MAX(triangle.vertex[0].z, IMZADI_MAX(triangle.vertex[1].z, triangle.vertex[2].z));
+
+		int minTileX = IMZADI_MAX(0, ((int)::floor((minX - this->minCorner.x) / voxelSize) - this->padColumns) / this->tileColumns);
+		int maxTileX = IMZADI_MIN(this->numTilesX - 1, ((int)::floor((maxX - this->minCorner.x) / voxelSize) + this->padColumns) / this->tileColumns);
+		int minTileZ = IMZADI_MAX(0, ((int)::floor((minZ - this->minCorner.z) / voxelSize) - this->padColumns) / this->tileColumns);
+		int maxTileZ = IMZADI_MIN(this->numTilesZ - 1, ((int)::floor((maxZ - this->minCorner.z) / voxelSize) + this->padColumns) / this->tileColumns);
+
+		for (int tileZ = minTileZ; tileZ <= maxTileZ; tileZ++)
+			for (int tileX = minTileX; tileX <= maxTileX; tileX++)
+				this->tileArray[tileZ * this->numTilesX + tileX].triangleArray.push_back(i);
+	}
+
+	auto forEachTile = [this, jobSystem](const std::function<void(Tile&)>& func)
+		{
+			if (!jobSystem)
+			{
+				for (Tile& tile : this->tileArray)
+					func(tile);
+			}
+			else
+			{
+				jobSystem->ParallelFor((uint32_t)this->tileArray.size(), 1, [this, &func](uint32_t begin, uint32_t end)
+					{
+						for (uint32_t i = begin; i < end; i++)
+							func(this->tileArray[i]);
+					});
+			}
+		};
+
+	// Each tile is voxelized and cut into regions without regard to any other.
+	forEachTile([this](Tile& tile)
+		{
+			this->VoxelizeTile(tile);
+			this->FindRegions(tile);
+		});
+
+	int numNodes = 0;
+	for (Tile& tile : this->tileArray)
+	{
+		tile.firstRegionNode = numNodes;
+		numNodes += (int)tile.regionArray.size();
+	}
+
+	// With every tile's floors now known, the regions can be connected across tiles.
+	forEachTile([this](Tile& tile)
+		{
+			this->ConnectRegions(tile);
+		});
+
+	std::vector<Site> siteArray;
+	siteArray.reserve(numNodes);
+	for (Tile& tile : this->tileArray)
+		for (const Site& site : tile.regionArray)
+			siteArray.push_back(site);
+
+	for (Tile& tile : this->tileArray)
+	{
+		tile.firstPortalNode = (int)siteArray.size();
+		for (const Site& site : tile.portalArray)
+			siteArray.push_back(site);
+	}
+
+	numNodes = (int)siteArray.size();
+	std::vector<std::vector<int>> adjacencyArray(numNodes);
+	for (const Tile& tile : this->tileArray)
+	{
+		for (const std::pair<int, int>& edge : tile.edgeArray)
+		{
+			int i = (edge.first >= 0) ? edge.first : tile.firstPortalNode + ~edge.first;
+			int j = (edge.second >= 0) ? edge.second : tile.firstPortalNode + ~edge.second;
+			adjacencyArray[i].push_back(j);
+			adjacencyArray[j].push_back(i);
+		}
+	}
+
+	for (std::vector<int>& adjacentArray : adjacencyArray)
+	{
+		std::sort(adjacentArray.begin(), adjacentArray.end());
+		adjacentArray.erase(std::unique(adjacentArray.begin(), adjacentArray.end()), adjacentArray.end());
+	}
+
+	// A node with just two neighbors that can see one another adds nothing but a turn, so take it out.
+	std::vector<int> nodeQueue;
+	for (int i = numNodes - 1; i >= 0; i--)
+		nodeQueue.push_back(i);
+
+	while (nodeQueue.size() > 0)
+	{
+		int i = nodeQueue.back();
+		nodeQueue.pop_back();
+
+		std::vector<int>& adjacentArray = adjacencyArray[i];
+		if (adjacentArray.size() != 2)
+			continue;
+
+		int j = adjacentArray[0];
+		int k = adjacentArray[1];
+		if (!this->CanWalk(siteArray[j], siteArray[k]))
+			continue;
+
+		adjacentArray.clear();
+
+		for (int m : {j, k})
+		{
+			std::vector<int>& otherAdjacentArray = adjacencyArray[m];
+			otherAdjacentArray.erase(std::find(otherAdjacentArray.begin(), otherAdjacentArray.end(), i));
+
+			int n = (m == j) ? k : j;
+			auto iter = std::lower_bound(otherAdjacentArray.begin(), otherAdjacentArray.end(), n);
+			if (iter == otherAdjacentArray.end() || *iter != n)
+				otherAdjacentArray.insert(iter, n);
+
+			nodeQueue.push_back(m);
+		}
+	}
+
+	// Nodes left without neighbors are dropped.
+	rapidjson::Document navGraphDoc;
+	navGraphDoc.SetObject();
+
+	rapidjson::Value nodeArrayValue;
+	nodeArrayValue.SetArray();
+
+	rapidjson::Value pathArrayValue;
+	pathArrayValue.SetArray();
+
+	std::vector<int> nodeIndexArray(numNodes, -1);
+	std::vector<std::vector<int>> adjacentPathArray;
+	int numPaths = 0;
+	for (int i = 0; i < numNodes; i++)
+	{
+		if (adjacencyArray[i].size() == 0)
+			continue;
+
+		nodeIndexArray[i] = (int)adjacentPathArray.size();
+		adjacentPathArray.push_back(std::vector<int>());
+	}
+
+	for (int i = 0; i < numNodes; i++)
+	{
+		for (int j : adjacencyArray[i])
+		{
+			if (j < i)
+				continue;
+
+			rapidjson::Value pathValue;
+			pathValue.SetObject();
+			pathValue.AddMember("i", rapidjson::Value().SetInt(nodeIndexArray[i]), navGraphDoc.GetAllocator());
+			pathValue.AddMember("j", rapidjson::Value().SetInt(nodeIndexArray[j]), navGraphDoc.GetAllocator());
+			pathArrayValue.PushBack(pathValue, navGraphDoc.GetAllocator());
+
+			adjacentPathArray[nodeIndexArray[i]].push_back(numPaths);
+			adjacentPathArray[nodeIndexArray[j]].push_back(numPaths);
+			numPaths++;
+		}
+	}
+
+	for (int i = 0; i < numNodes; i++)
+	{
+		if (nodeIndexArray[i] < 0)
+			continue;
+
+		rapidjson::Value nodeValue;
+		nodeValue.SetObject();
+
+		rapidjson::Value locationValue;
+		Imzadi::Asset::SaveVector(locationValue, this->GetSiteLocation(siteArray[i]), &navGraphDoc);
+		nodeValue.AddMember("location", locationValue, navGraphDoc.GetAllocator());
+
+		rapidjson::Value adjPathArrayValue;
+		adjPathArrayValue.SetArray();
+		for (int j : adjacentPathArray[nodeIndexArray[i]])
+			adjPathArrayValue.PushBack(rapidjson::Value().SetInt(j), navGraphDoc.GetAllocator());
+
+		nodeValue.AddMember("adj_path_array", adjPathArrayValue, navGraphDoc.GetAllocator());
+		nodeArrayValue.PushBack(nodeValue, navGraphDoc.GetAllocator());
+	}
+
+	navGraphDoc.AddMember("node_array", nodeArrayValue, navGraphDoc.GetAllocator());
+	navGraphDoc.AddMember("path_array", pathArrayValue, navGraphDoc.GetAllocator());
+
+	int numTriangles = (int)this->triangleArray.size();
+	int numTiles = (int)this->tileArray.size();
+	this->triangleArray.clear();
+	this->tileArray.clear();
+
+	if (!navGraph.Load(navGraphDoc, nullptr))
+	{
+		IMZADI_LOG_ERROR("Failed to load generated nav-graph.");
+		return false;
+	}
+
+	IMZADI_LOG_INFO("Generated nav-graph of %d nodes and %d paths from %d triangles over %d tiles in %f seconds.",
+		navGraph.GetNumNodes(), navGraph.GetNumPaths(), numTriangles, numTiles, clock.GetCurrentTimeSeconds());
+
+	return true;
+}
+
+void NavGraphGenerator::VoxelizeTile(Tile& tile) const
+{
+	double voxelSize = this->settings.voxelSize;
+	double voxelHeight = this->settings.voxelHeight;
+
+	// The tile is voxelized along with a border wide enough that what we find
+	// at its edges is the same as what its neighbors find at theirs.
+	int paddedX = tile.x - this->padColumns;
+	int paddedZ = tile.z - this->padColumns;
+	int paddedWidth = tile.width + 2 * this->padColumns;
+	int paddedDepth = tile.depth + 2 * this->padColumns;
+
+	std::vector<Span> spanArray;
+
+	// A triangle clipped by the four sides of a column has no more than seven vertices.
+	Imzadi::Vector3 clipArray[3][8];
+
+	for (int i : tile.triangleArray)
+	{
+		const Triangle& triangle = this->triangleArray[i];
+
+		double minX = IMZADI_MIN(triangle.vertex[0].x, IMZADI_MIN(triangle.vertex[1].x, triangle.vertex[2].x));
+		double maxX = IMZADI_MAX(triangle.vertex[0].x, IMZADI_MAX(triangle.vertex[1].x, triangle.vertex[2].x));
+		double minZ = IMZADI_MIN(triangle.vertex[0].z, IMZADI_MIN(triangle.vertex[1].z, triangle.vertex[2].z));
+		double maxZ = IMZADI_MAX(triangle.vertex[0].z, IMZADI_MAX(triangle.vertex[1].z, triangle.vertex[2].z));
+
+		int minColumnX = IMZADI_MAX(paddedX, (int)::floor((minX - this->minCorner.x) / voxelSize));
+		int maxColumnX = IMZADI_MIN(paddedX + paddedWidth - 1, (int)::floor((maxX - this->minCorner.x) / voxelSize));
+		int minColumnZ = IMZADI_MAX(paddedZ, (int)::floor((minZ - this->minCorner.z) / voxelSize));
+		int maxColumnZ = IMZADI_MIN(paddedZ + paddedDepth - 1, (int)::floor((maxZ - this->minCorner.z) / voxelSize));
+
+		for (int z = minColumnZ; z <= maxColumnZ; z++)
+		{
+			// Always clip from the whole triangle, so that every tile finds the same spans for the same column.
+			double rowMinZ = this->minCorner.z + double(z) * voxelSize;
+			int numRowVertices = ClipToHalfSpace(triangle.vertex, 3, clipArray[0], false, rowMinZ, 1.0);
+			numRowVertices = ClipToHalfSpace(clipArray[0], numRowVertices, clipArray[1], false, rowMinZ + voxelSize, -1.0);
+			if (numRowVertices < 3)
+				continue;
+
+			for (int x = minColumnX; x <= maxColumnX; x++)
+			{
+				double columnMinX = this->minCorner.x + double(x) * voxelSize;
+				int numVertices = ClipToHalfSpace(clipArray[1], numRowVertices, clipArray[0], true, columnMinX, 1.0);
+				numVertices = ClipToHalfSpace(clipArray[0], numVertices, clipArray[2], true, columnMinX + voxelSize, -1.0);
+				if (numVertices < 3)
+					continue;
+
+				double minY = clipArray[2][0].y;
+				double maxY = clipArray[2][0].y;
+				for (int j = 1; j < numVertices; j++)
+				{
+					minY = IMZADI_MIN(minY, clipArray[2][j].y);
+					maxY = IMZADI_MAX(maxY, clipArray[2][j].y);
+				}
+
+				Span span;
+				span.column = (z - paddedZ) * paddedWidth + (x - paddedX);
+				span.yMin = (int)::floor((minY - this->minCorner.y) / voxelHeight);
+				span.yMax = IMZADI_MAX(span.yMin + 1, (int)::ceil((maxY - this->minCorner.y) / voxelHeight));
+				span.walkable = triangle.walkable ? 1 : 0;
+				spanArray.push_back(span);
+			}
+		}
+	}
+
+	tile.triangleArray.clear();
+	tile.triangleArray.shrink_to_fit();
+
+	// Sorting makes the merge below independent of the order in which the triangles were given.
+	std::sort(spanArray.begin(), spanArray.end(), [](const Span& spanA, const Span& spanB) -> bool
+		{
+			if (spanA.column != spanB.column)
+				return spanA.column < spanB.column;
+			if (spanA.yMin != spanB.yMin)
+				return spanA.yMin < spanB.yMin;
+			if (spanA.yMax != spanB.yMax)
+				return spanA.yMax < spanB.yMax;
+			return spanA.walkable < spanB.walkable;
+		});
+
+	std::vector<Column> paddedColumnArray(paddedWidth * paddedDepth, Column{ 0, 0 });
+	std::vector<Floor> paddedFloorArray;
+	std::vector<Span> mergedSpanArray;
+
+	for (int i = 0; i < (int)spanArray.size(); )
+	{
+		int columnIndex = spanArray[i].column;
+
+		// Overlapping spans merge, and whether the merged span is walkable is decided by
+		// what's on top of it, unless the tops are within a voxel of one another.
+		mergedSpanArray.clear();
+		for (; i < (int)spanArray.size() && spanArray[i].column == columnIndex; i++)
+		{
+			const Span& span = spanArray[i];
+
+			if (mergedSpanArray.size() == 0 || span.yMin > mergedSpanArray.back().yMax)
+			{
+				mergedSpanArray.push_back(span);
+				continue;
+			}
+
+			Span& mergedSpan = mergedSpanArray.back();
+			if (span.yMax > mergedSpan.yMax)
+			{
+				mergedSpan.walkable = (span.yMax - mergedSpan.yMax <= 1) ? (mergedSpan.walkable | span.walkable) : span.walkable;
+				mergedSpan.yMax = span.yMax;
+			}
+			else if (mergedSpan.yMax - span.yMax <= 1)
+				mergedSpan.walkable |= span.walkable;
+		}
+
+		Column& column = paddedColumnArray[columnIndex];
+		column.firstFloor = (int)paddedFloorArray.size();
+
+		for (int j = 0; j < (int)mergedSpanArray.size(); j++)
+		{
+			const Span& span = mergedSpanArray[j];
+			if (!span.walkable)
+				continue;
+
+			int ceiling = (j + 1 < (int)mergedSpanArray.size()) ? mergedSpanArray[j + 1].yMin : INT_MAX;
+			if (ceiling - span.yMax < this->heightVoxels)
+				continue;
+
+			Floor floor;
+			floor.y = span.yMax;
+			floor.ceiling = ceiling;
+			::memset(floor.connection, noConnection, sizeof(floor.connection));
+			floor.distance = 0;
+			floor.walkable = false;
+			floor.region = -1;
+			paddedFloorArray.push_back(floor);
+		}
+
+		column.numFloors = (int)paddedFloorArray.size() - column.firstFloor;
+	}
+
+	spanArray.clear();
+	spanArray.shrink_to_fit();
+
+	auto getNeighbor = [&paddedColumnArray, &paddedFloorArray, paddedWidth](int x, int z, const Floor& floor, int direction) -> Floor*
+		{
+			if (floor.connection[direction] == noConnection)
+				return nullptr;
+
+			const Column& column = paddedColumnArray[(z + directionZ[direction]) * paddedWidth + x + directionX[direction]];
+			return &paddedFloorArray[column.firstFloor + floor.connection[direction]];
+		};
+
+	// Connect each floor to the best floor of each neighboring column that an agent could step onto from it.
+	for (int z = 0; z < paddedDepth; z++)
+	{
+		for (int x = 0; x < paddedWidth; x++)
+		{
+			const Column& column = paddedColumnArray[z * paddedWidth + x];
+			for (int i = 0; i < column.numFloors; i++)
+			{
+				Floor& floor = paddedFloorArray[column.firstFloor + i];
+
+				for (int direction = 0; direction < 4; direction++)
+				{
+					int adjacentX = x + directionX[direction];
+					int adjacentZ = z + directionZ[direction];
+					if (adjacentX < 0 || adjacentX >= paddedWidth || adjacentZ < 0 || adjacentZ >= paddedDepth)
+						continue;
+
+					const Column& adjacentColumn = paddedColumnArray[adjacentZ * paddedWidth + adjacentX];
+					int bestStep = INT_MAX;
+					for (int j = 0; j < adjacentColumn.numFloors && j < noConnection; j++)
+					{
+						const Floor& adjacentFloor = paddedFloorArray[adjacentColumn.firstFloor + j];
+
+						int step = ::abs(adjacentFloor.y - floor.y);
+						int headroom = IMZADI_MIN(floor.ceiling, adjacentFloor.ceiling) - IMZADI_MAX(floor.y, adjacentFloor.y);
+						if (step <= this->stepVoxels && headroom >= this->heightVoxels && step < bestStep)
+						{
+							bestStep = step;
+							floor.connection[direction] = (uint8_t)j;
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Find how far each floor is from the nearest floor not connected all around.  This is a
+	// chamfer distance, in halves of a column, so that diagonal steps cost about right.
+	for (Floor& floor : paddedFloorArray)
+	{
+		bool bordered = floor.connection[0] == noConnection || floor.connection[1] == noConnection ||
+						floor.connection[2] == noConnection || floor.connection[3] == noConnection;
+		floor.distance = bordered ? 0 : 0xFFFF;
+	}
+
+	auto relax = [](Floor& floor, const Floor* neighbor, int cost)
+		{
+			if (neighbor)
+				floor.distance = (uint16_t)IMZADI_MIN(int(floor.distance), int(neighbor->distance) + cost);
+		};
+
+	for (int z = 0; z < paddedDepth; z++)
+	{
+		for (int x = 0; x < paddedWidth; x++)
+		{
+			const Column& column = paddedColumnArray[z * paddedWidth + x];
+			for (int i = 0; i < column.numFloors; i++)
+			{
+				Floor& floor = paddedFloorArray[column.firstFloor + i];
+
+				const Floor* neighbor = getNeighbor(x, z, floor, 2);
+				relax(floor, neighbor, 2);
+				if (neighbor)
+					relax(floor, getNeighbor(x - 1, z, *neighbor, 3), 3);
+
+				neighbor = getNeighbor(x, z, floor, 3);
+				relax(floor, neighbor, 2);
+				if (neighbor)
+					relax(floor, getNeighbor(x, z - 1, *neighbor, 0), 3);
+			}
+		}
+	}
+
+	for (int z = paddedDepth - 1; z >= 0; z--)
+	{
+		for (int x = paddedWidth - 1; x >= 0; x--)
+		{
+			const Column& column = paddedColumnArray[z * paddedWidth + x];
+			for (int i = 0; i < column.numFloors; i++)
+			{
+				Floor& floor = paddedFloorArray[column.firstFloor + i];
+
+				const Floor* neighbor = getNeighbor(x, z, floor, 0);
+				relax(floor, neighbor, 2);
+				if (neighbor)
+					relax(floor, getNeighbor(x + 1, z, *neighbor, 1), 3);
+
+				neighbor = getNeighbor(x, z, floor, 1);
+				relax(floor, neighbor, 2);
+				if (neighbor)
+					relax(floor, getNeighbor(x, z + 1, *neighbor, 2), 3);
+			}
+		}
+	}
+
+	// Keep what's inside the tile, marking what's too near an edge for the agent to stand on.
+	// Every floor is kept, walkable or not, so that the connections into neighboring tiles stay valid.
+	tile.columnArray.resize(tile.width * tile.depth);
+	tile.floorArray.clear();
+	for (int z = 0; z < tile.depth; z++)
+	{
+		for (int x = 0; x < tile.width; x++)
+		{
+			const Column& paddedColumn = paddedColumnArray[(z + this->padColumns) * paddedWidth + x + this->padColumns];
+			Column& column = tile.columnArray[z * tile.width + x];
+			column.firstFloor = (int)tile.floorArray.size();
+			column.numFloors = paddedColumn.numFloors;
+
+			for (int i = 0; i < paddedColumn.numFloors; i++)
+			{
+				Floor floor = paddedFloorArray[paddedColumn.firstFloor + i];
+				floor.walkable = floor.distance >= 2 * this->radiusColumns;
+				tile.floorArray.push_back(floor);
+			}
+		}
+	}
+}
+
+void NavGraphGenerator::FindRegions(Tile& tile) const
+{
+	tile.regionArray.clear();
+
+	std::vector<Site> siteStack;
+
+	for (int blockZ = 0; blockZ < tile.depth; blockZ += this->blockColumns)
+	{
+		for (int blockX = 0; blockX < tile.width; blockX += this->blockColumns)
+		{
+			int blockWidth = IMZADI_MIN(this->blockColumns, tile.width - blockX);
+			int blockDepth = IMZADI_MIN(this->blockColumns, tile.depth - blockZ);
+
+			for (int z = blockZ; z < blockZ + blockDepth; z++)
+			{
+				for (int x = blockX; x < blockX + blockWidth; x++)
+				{
+					const Column& column = tile.columnArray[z * tile.width + x];
+					for (int i = 0; i < column.numFloors; i++)
+					{
+						Floor& seedFloor = tile.floorArray[column.firstFloor + i];
+						if (!seedFloor.walkable || seedFloor.region >= 0)
+							continue;
+
+						// Flood the region, and put its node at the floor farthest from any edge,
+						// favoring floors near the middle of the block.
+						int region = (int)tile.regionArray.size();
+						Site bestSite{ x, z, i };
+						int bestDistance = -1;
+						int bestOffset = INT_MAX;
+
+						seedFloor.region = region;
+						siteStack.push_back(Site{ x, z, i });
+						while (siteStack.size() > 0)
+						{
+							Site site = siteStack.back();
+							siteStack.pop_back();
+
+							const Floor& floor = tile.floorArray[tile.columnArray[site.z * tile.width + site.x].firstFloor + site.layer];
+
+							int offsetX = 2 * (site.x - blockX) + 1 - blockWidth;
+							int offsetZ = 2 * (site.z - blockZ) + 1 - blockDepth;
+							int offset = offsetX * offsetX + offsetZ * offsetZ;
+							if (floor.distance > bestDistance || (floor.distance == bestDistance && offset < bestOffset))
+							{
+								bestSite = site;
+								bestDistance = floor.distance;
+								bestOffset = offset;
+							}
+
+							for (int direction = 0; direction < 4; direction++)
+							{
+								if (floor.connection[direction] == noConnection)
+									continue;
+
+								int adjacentX = site.x + directionX[direction];
+								int adjacentZ = site.z + directionZ[direction];
+								if (adjacentX < blockX || adjacentX >= blockX + blockWidth || adjacentZ < blockZ || adjacentZ >= blockZ + blockDepth)
+									continue;
+
+								Floor& adjacentFloor = tile.floorArray[tile.columnArray[adjacentZ * tile.width + adjacentX].firstFloor + floor.connection[direction]];
+								if (!adjacentFloor.walkable || adjacentFloor.region >= 0)
+									continue;
+
+								adjacentFloor.region = region;
+								siteStack.push_back(Site{ adjacentX, adjacentZ, floor.connection[direction] });
+							}
+						}
+
+						tile.regionArray.push_back(Site{ tile.x + bestSite.x, tile.z + bestSite.z, bestSite.layer });
+					}
+				}
+			}
+		}
+	}
+}
+
+void NavGraphGenerator::ConnectRegions(Tile& tile) const
+{
+	tile.edgeArray.clear();
+	tile.portalArray.clear();
+
+	// Each block connects to its neighbors on the +X and +Z sides, and on the two diagonals
+	// toward +Z, so that every pair of neighboring blocks is considered just once.
+	for (int blockZ = tile.z; blockZ < tile.z + tile.depth; blockZ += this->blockColumns)
+	{
+		for (int blockX = tile.x; blockX < tile.x + tile.width; blockX += this->blockColumns)
+		{
+			int blockEndX = IMZADI_MIN(blockX + this->blockColumns, tile.x + tile.width);
+			int blockEndZ = IMZADI_MIN(blockZ + this->blockColumns, tile.z + tile.depth);
+
+			this->ConnectAcross(tile, blockEndX - 1, blockZ, 0);
+			this->ConnectAcross(tile, blockX, blockEndZ - 1, 1);
+			this->ConnectDiagonally(tile, blockEndX - 1, blockEndZ - 1, 0, 1);
+			this->ConnectDiagonally(tile, blockX, blockEndZ - 1, 2, 1);
+		}
+	}
+}
+
+void NavGraphGenerator::ConnectAcross(Tile& tile, int x, int z, int direction) const
+{
+	struct Contact
+	{
+		int nodeA;
+		int nodeB;
+		Site siteA;
+		Site siteB;
+		Site site;
+	};
+
+	std::vector<Contact> contactArray;
+
+	// Walk the side of the block, noting every place where a region of ours touches a region of the next block.
+	int alongX = directionZ[direction];
+	int alongZ = directionX[direction];
+	int length = (direction == 0) ? IMZADI_MIN(this->blockColumns, tile.z + tile.depth - z) : IMZADI_MIN(this->blockColumns, tile.x + tile.width - x);
+	for (int i = 0; i < length; i++)
+	{
+		int sideX = x + i * alongX;
+		int sideZ = z + i * alongZ;
+		int adjacentX = sideX + directionX[direction];
+		int adjacentZ = sideZ + directionZ[direction];
+
+		const Column& column = tile.columnArray[(sideZ - tile.z) * tile.width + sideX - tile.x];
+		for (int j = 0; j < column.numFloors; j++)
+		{
+			const Floor* floor = &tile.floorArray[column.firstFloor + j];
+			if (!floor->walkable)
+				continue;
+
+			const Floor* adjacentFloor = this->GetNeighbor(sideX, sideZ, floor, direction);
+			if (!adjacentFloor)
+				continue;
+
+			Contact contact;
+			contact.nodeA = this->GetRegionNode(sideX, sideZ, floor);
+			contact.nodeB = this->GetRegionNode(adjacentX, adjacentZ, adjacentFloor);
+			contact.siteA = this->GetRegionSite(sideX, sideZ, floor);
+			contact.siteB = this->GetRegionSite(adjacentX, adjacentZ, adjacentFloor);
+			contact.site = Site{ sideX, sideZ, j };
+			contactArray.push_back(contact);
+		}
+	}
+
+	std::stable_sort(contactArray.begin(), contactArray.end(), [](const Contact& contactA, const Contact& contactB) -> bool
+		{
+			if (contactA.nodeA != contactB.nodeA)
+				return contactA.nodeA < contactB.nodeA;
+			return contactA.nodeB < contactB.nodeB;
+		});
+
+	for (int i = 0; i < (int)contactArray.size(); )
+	{
+		int j = i;
+		while (j < (int)contactArray.size() && contactArray[j].nodeA == contactArray[i].nodeA && contactArray[j].nodeB == contactArray[i].nodeB)
+			j++;
+
+		// Two regions that can see one another are joined directly.  Otherwise, a node
+		// is put in the middle of where they touch, and each is joined to that.
+		const Contact& contact = contactArray[i];
+		if (this->CanWalk(contact.siteA, contact.siteB))
+			tile.edgeArray.push_back(std::pair<int, int>(contact.nodeA, contact.nodeB));
+		else
+		{
+			int portal = ~(int)tile.portalArray.size();
+			tile.portalArray.push_back(contactArray[(i + j) / 2].site);
+			tile.edgeArray.push_back(std::pair<int, int>(contact.nodeA, portal));
+			tile.edgeArray.push_back(std::pair<int, int>(portal, contact.nodeB));
+		}
+
+		i = j;
+	}
+}
+
+void NavGraphGenerator::ConnectDiagonally(Tile& tile, int x, int z, int firstDirection, int secondDirection) const
+{
+	// Regions meeting only at the corners of their blocks are joined only if they can see one another,
+	// since there are always other ways between them, through the blocks to either side.
+	const Column& column = tile.columnArray[(z - tile.z) * tile.width + x - tile.x];
+	for (int i = 0; i < column.numFloors; i++)
+	{
+		const Floor* floor = &tile.floorArray[column.firstFloor + i];
+		if (!floor->walkable)
+			continue;
+
+		int diagonalX = x + directionX[firstDirection] + directionX[secondDirection];
+		int diagonalZ = z + directionZ[firstDirection] + directionZ[secondDirection];
+
+		const Floor* diagonalFloor = nullptr;
+		for (int j = 0; j < 2 && !diagonalFloor; j++)
+		{
+			int directionA = (j == 0) ? firstDirection : secondDirection;
+			int directionB = (j == 0) ? secondDirection : firstDirection;
+
+			const Floor* adjacentFloor = this->GetNeighbor(x, z, floor, directionA);
+			if (adjacentFloor)
+				diagonalFloor = this->GetNeighbor(x + directionX[directionA], z + directionZ[directionA], adjacentFloor, directionB);
+		}
+
+		if (!diagonalFloor)
+			continue;
+
+		int nodeA = this->GetRegionNode(x, z, floor);
+		int nodeB = this->GetRegionNode(diagonalX, diagonalZ, diagonalFloor);
+		if (nodeA != nodeB && this->CanWalk(this->GetRegionSite(x, z, floor), this->GetRegionSite(diagonalX, diagonalZ, diagonalFloor)))
+			tile.edgeArray.push_back(std::pair<int, int>(nodeA, nodeB));
+	}
+}
+
+const NavGraphGenerator::Tile* NavGraphGenerator::GetTile(int x, int z) const
+{
+	if (x < 0 || x >= this->numColumnsX || z < 0 || z >= this->numColumnsZ)
+		return nullptr;
+
+	return &this->tileArray[(z / this->tileColumns) * this->numTilesX + x / this->tileColumns];
+}
+
+const NavGraphGenerator::Floor* NavGraphGenerator::GetFloor(int x, int z, int layer) const
+{
+	const Tile* tile = this->GetTile(x, z);
+	if (!tile)
+		return nullptr;
+
+	const Column& column = tile->columnArray[(z - tile->z) * tile->width + x - tile->x];
+	if (layer < 0 || layer >= column.numFloors)
+		return nullptr;
+
+	return &tile->floorArray[column.firstFloor + layer];
+}
+
+const NavGraphGenerator::Floor* NavGraphGenerator::GetNeighbor(int x, int z, const Floor* floor, int direction, int* layer /*= nullptr*/) const
+{
+	if (floor->connection[direction] == noConnection)
+		return nullptr;
+
+	const Floor* adjacentFloor = this->GetFloor(x + directionX[direction], z + directionZ[direction], floor->connection[direction]);
+	if (!adjacentFloor || !adjacentFloor->walkable)
+		return nullptr;
+
+	if (layer)
+		*layer = floor->connection[direction];
+
+	return adjacentFloor;
+}
+
+int NavGraphGenerator::GetRegionNode(int x, int z, const Floor* floor) const
+{
+	return this->GetTile(x, z)->firstRegionNode + floor->region;
+}
+
+const NavGraphGenerator::Site& NavGraphGenerator::GetRegionSite(int x, int z, const Floor* floor) const
+{
+	return this->GetTile(x, z)->regionArray[floor->region];
+}
+
+bool NavGraphGenerator::CanWalk(const Site& siteA, const Site& siteB) const
+{
+	const Floor* floor = this->GetFloor(siteA);
+	if (!floor || !floor->walkable)
+		return false;
+
+	// Step from column to column along the line between the centers of the two columns, visiting every
+	// column the line passes through, and make sure there's a connected, walkable floor all the way.
+	int x = siteA.x;
+	int z = siteA.z;
+	int layer = siteA.layer;
+	int numStepsX = ::abs(siteB.x - siteA.x);
+	int numStepsZ = ::abs(siteB.z - siteA.z);
+	int directionAlongX = (siteB.x > siteA.x) ? 0 : 2;
+	int directionAlongZ = (siteB.z > siteA.z) ? 1 : 3;
+	int stepsX = 0;
+	int stepsZ = 0;
+
+	auto step = [this, &x, &z, &layer](const Floor*& floor, int direction) -> bool
+		{
+			floor = this->GetNeighbor(x, z, floor, direction, &layer);
+			if (!floor)
+				return false;
+
+			x += directionX[direction];
+			z += directionZ[direction];
+			return true;
+		};
+
+	while (stepsX < numStepsX || stepsZ < numStepsZ)
+	{
+		int64_t crossing = 0;
+		if (stepsX == numStepsX)
+			crossing = 1;
+		else if (stepsZ == numStepsZ)
+			crossing = -1;
+		else
+			crossing = int64_t(1 + 2 * stepsX) * numStepsZ - int64_t(1 + 2 * stepsZ) * numStepsX;
+
+		if (crossing < 0)
+		{
+			if (!step(floor, directionAlongX))
+				return false;
+
+			stepsX++;
+		}
+		else if (crossing > 0)
+		{
+			if (!step(floor, directionAlongZ))
+				return false;
+
+			stepsZ++;
+		}
+		else
+		{
+			// The line passes right through a corner, so either way around it will do.
+			int cornerX = x;
+			int cornerZ = z;
+			int cornerLayer = layer;
+			const Floor* cornerFloor = floor;
+
+			if (!step(floor, directionAlongX) || !step(floor, directionAlongZ))
+			{
+				x = cornerX;
+				z = cornerZ;
+				layer = cornerLayer;
+				floor = cornerFloor;
+
+				if (!step(floor, directionAlongZ) || !step(floor, directionAlongX))
+					return false;
+			}
+
+			stepsX++;
+			stepsZ++;
+		}
+	}
+
+	return layer == siteB.layer;
+}
+
+Imzadi::Vector3 NavGraphGenerator::GetSiteLocation(const Site& site) const
+{
+	const Floor* floor = this->GetFloor(site);
+
+	return Imzadi::Vector3(
+		this->minCorner.x + (double(site.x) + 0.5) * this->settings.voxelSize,
+		this->minCorner.y + double(floor->y) * this->settings.voxelHeight,
+		this->minCorner.z + (double(site.z) + 0.5) * this->settings.voxelSize);
+}
+
+bool NavGraphGenerator::GenerateForLevel(const wxString& levelFile)
+{
+	IMZADI_LOG_INFO("Generating nav-graph for level: %s", (const char*)levelFile.c_str());
+
+	rapidjson::Document levelDoc;
+	if (!JsonUtils::ReadJsonFile(levelDoc, levelFile))
+	{
+		IMZADI_LOG_ERROR("Failed to read level file: %s", (const char*)levelFile.c_str());
+		return false;
+	}
+
+	std::vector<std::string> collisionFileArray;
+	if (!levelDoc.IsObject() || !levelDoc.HasMember("static_collision") || !Imzadi::Asset::LoadStringArray(levelDoc["static_collision"], collisionFileArray))
+	{
+		IMZADI_LOG_ERROR("The level has no \"static_collision\" array from which to generate a nav-graph.");
+		return false;
+	}
+
+	Imzadi::AssetCache* assetCache = Imzadi::Game::Get()->GetAssetCache();
+
+	std::vector<Imzadi::Polygon> worldPolygonArray;
+	for (const std::string& collisionFile : collisionFileArray)
+	{
+		Imzadi::Reference<Imzadi::Asset> asset;
+		if (!assetCache->LoadAsset(collisionFile, asset))
+		{
+			IMZADI_LOG_ERROR("Failed to load collision file: %s", collisionFile.c_str());
+			return false;
+		}
+
+		auto collisionShapeSet = dynamic_cast<Imzadi::CollisionShapeSet*>(asset.Get());
+		if (!collisionShapeSet)
+		{
+			IMZADI_LOG_ERROR("The file %s is not a collision shape set.", collisionFile.c_str());
+			return false;
+		}
+
+		for (const Imzadi::Collision::Shape* shape : collisionShapeSet->GetCollisionShapeArray())
+		{
+			auto polygonShape = dynamic_cast<const Imzadi::Collision::PolygonShape*>(shape);
+			if (!polygonShape)
+				continue;
+
+			Imzadi::Polygon polygon;
+			polygon.vertexArray = polygonShape->GetWorldVertices();
+			worldPolygonArray.push_back(polygon);
+		}
+	}
+
+	Imzadi::NavGraph navGraph;
+	if (!this->Generate(worldPolygonArray, navGraph, Imzadi::Game::Get()->GetJobSystem()))
+	{
+		IMZADI_LOG_ERROR("Failed to generate nav-graph for level.");
+		return false;
+	}
+
+	// The level's own nav-graph may well be hand-authored, so we never overwrite it.  The generated
+	// one always goes next to the level, under a name of its own, and it's up to the user to point
+	// the level at it if they want to use it.
+	wxFileName navGraphFile(levelFile);
+	navGraphFile.SetName(navGraphFile.GetName() + ".generated");
+	navGraphFile.SetExt("nav_graph");
+	if (levelDoc.HasMember("nav_graph") && levelDoc["nav_graph"].IsString())
+	{
+		std::string navGraphPath = levelDoc["nav_graph"].GetString();
+		if (assetCache->ResolveAssetPath(navGraphPath) && wxFileName(navGraphPath) != navGraphFile)
+			IMZADI_LOG_INFO("Leaving the level's nav-graph file alone: %s", navGraphPath.c_str());
+	}
+
+	rapidjson::Document navGraphDoc;
+	if (!navGraph.Save(navGraphDoc))
+	{
+		IMZADI_LOG_ERROR("Failed to save nav-graph to JSON.");
+		return false;
+	}
+
+	if (!JsonUtils::WriteJsonFile(navGraphDoc, navGraphFile.GetFullPath()))
+	{
+		IMZADI_LOG_ERROR("Failed to write nav-graph file: %s", (const char*)navGraphFile.GetFullPath().c_str());
+		return false;
+	}
+
+	IMZADI_LOG_INFO("Wrote nav-graph file: %s", (const char*)navGraphFile.GetFullPath().c_str());
+
+	return true;
+}
\ No newline at end of file
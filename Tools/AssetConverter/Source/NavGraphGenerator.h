@@ -0,0 +1,155 @@
+#pragma once
+
+#include <wx/string.h>
+#include "Math/Vector3.h"
+#include "Math/Polygon.h"
+#include "Assets/NavGraph.h"
+#include <vector>
+
+namespace Imzadi
+{
+	class JobSystem;
+}
+
+/**
+ * This makes a nav-graph from a level's collision geometry, rather than from meshes modeled
+ * by hand for the purpose.  The geometry is voxelized into columns of solid spans, the tops of
+ * which are floors where an agent might stand.  Floors that are too steep, too low under the
+ * next span up, or too near a ledge or wall for the agent's radius are thrown out.  What's left
+ * is cut into blocks of a fixed size, and each connected region of floor in a block becomes a
+ * node of the graph.  Nodes of neighboring blocks are joined where their regions touch, and then
+ * any node that merely sits between two others it can see is removed.
+ *
+ * The level is divided into tiles, each of which is voxelized independently of the others, so the
+ * bulk of the work is done in parallel.  A tile looks at geometry a little beyond its own borders
+ * so that its results agree with those of its neighbors.
+ */
+class NavGraphGenerator
+{
+public:
+	NavGraphGenerator();
+	virtual ~NavGraphGenerator();
+
+	struct Settings
+	{
+		double voxelSize;			///< This is the width and depth of a column of voxels.
+		double voxelHeight;			///< This is the height of a voxel.
+		double agentHeight;			///< Floors with less headroom than this are not walkable.
+		double agentRadius;			///< Floors nearer than this to a wall or ledge are not walkable.
+		double maxSlopeDegrees;		///< Surfaces steeper than this are not walkable.
+		double maxStepHeight;		///< Neighboring floors whose heights differ by more than this are not connected.
+		double nodeSpacing;			///< This is the width and depth of the blocks, each region of which becomes a node.
+		int tileSize;				///< This is the width and depth of each tile in columns, rounded up to a whole number of blocks.
+	};
+
+	void SetSettings(const Settings& settings) { this->settings = settings; }
+	const Settings& GetSettings() const { return this->settings; }
+
+	/**
+	 * Generate a nav-graph for the given collision geometry.
+	 *
+	 * @param[in] worldPolygonArray These are the world-space polygons of the level's collision geometry.
+	 * @param[out] navGraph This is populated with the generated graph.
+	 * @param[in] jobSystem If given, the tiles are processed in parallel on this job system.
+	 * @return True is returned on success; false, otherwise.
+	 */
+	bool Generate(const std::vector<Imzadi::Polygon>& worldPolygonArray, Imzadi::NavGraph& navGraph, Imzadi::JobSystem* jobSystem);
+
+	/**
+	 * Generate a nav-graph for the static collision of the given level file and write it to
+	 * a file next to the level file, named after the level with a ".generated.nav_graph" extension.
+	 * The nav-graph file named by the level, which may be hand-authored, is never overwritten.
+	 *
+	 * @return True is returned on success; false, otherwise.
+	 */
+	bool GenerateForLevel(const wxString& levelFile);
+
+private:
+
+	struct Triangle
+	{
+		Imzadi::Vector3 vertex[3];
+		bool walkable;
+	};
+
+	/**
+	 * This is a solid run of voxels in a column, as found while voxelizing a tile.
+	 */
+	struct Span
+	{
+		int column;
+		int yMin;
+		int yMax;
+		int walkable;
+	};
+
+	/**
+	 * This is the top of a span that an agent could stand on, given enough room.
+	 */
+	struct Floor
+	{
+		int y;
+		int ceiling;
+		uint8_t connection[4];	///< This is the index of the connected floor in the neighboring column in each direction, if any.
+		uint16_t distance;		///< This is how far the floor is from the nearest unwalkable floor, in halves of a column.
+		bool walkable;
+		int region;				///< This is the index of the region of the tile containing the floor, if any.
+	};
+
+	struct Column
+	{
+		int firstFloor;
+		int numFloors;
+	};
+
+	/**
+	 * A site is a floor identified by its global column coordinates and its index in the column.
+	 */
+	struct Site
+	{
+		int x;
+		int z;
+		int layer;
+	};
+
+	struct Tile
+	{
+		int x, z;						///< This is the global column of the tile's corner.
+		int width, depth;				///< This is the number of columns the tile spans along each axis.
+		std::vector<int> triangleArray;	///< These are the triangles overlapping the tile or its padding.
+		std::vector<Column> columnArray;
+		std::vector<Floor> floorArray;
+		std::vector<Site> regionArray;	///< This is the node site of each region of the tile.
+		std::vector<Site> portalArray;	///< These are the extra nodes placed between regions that can't see one another.
+		std::vector<std::pair<int, int>> edgeArray;	///< These are pairs of global node indices, or, if negative, ones-complements of portal indices.
+		int firstRegionNode;
+		int firstPortalNode;
+	};
+
+	void VoxelizeTile(Tile& tile) const;
+	void FindRegions(Tile& tile) const;
+	void ConnectRegions(Tile& tile) const;
+	void ConnectAcross(Tile& tile, int x, int z, int direction) const;
+	void ConnectDiagonally(Tile& tile, int x, int z, int firstDirection, int secondDirection) const;
+	const Tile* GetTile(int x, int z) const;
+	const Floor* GetFloor(int x, int z, int layer) const;
+	const Floor* GetFloor(const Site& site) const { return this->GetFloor(site.x, site.z, site.layer); }
+	const Floor* GetNeighbor(int x, int z, const Floor* floor, int direction, int* layer = nullptr) const;
+	int GetRegionNode(int x, int z, const Floor* floor) const;
+	const Site& GetRegionSite(int x, int z, const Floor* floor) const;
+	bool CanWalk(const Site& siteA, const Site& siteB) const;
+	Imzadi::Vector3 GetSiteLocation(const Site& site) const;
+
+	Settings settings;
+	std::vector<Triangle> triangleArray;
+	std::vector<Tile> tileArray;
+	Imzadi::Vector3 minCorner;
+	int numColumnsX, numColumnsZ;
+	int numTilesX, numTilesZ;
+	int tileColumns;
+	int blockColumns;
+	int padColumns;
+	int heightVoxels;
+	int stepVoxels;
+	int radiusColumns;
+};
\ No newline at end of file
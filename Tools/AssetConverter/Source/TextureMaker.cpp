@@ -1,12 +1,16 @@
 #include "TextureMaker.h"
+#include "BlockCompressor.h"
 #include "App.h"
 #include "JsonUtils.h"
+#include "Game.h"
+#include "Clock.h"
+#include "LZCodec.h"
 #include "Log.h"
 #include <wx/image.h>
-#include <compressapi.h>
 
 TextureMaker::TextureMaker()
 {
+	this->compressionLevel = Imzadi::LZCodec::DEFAULT_LEVEL;
 }
 
 /*virtual*/ TextureMaker::~TextureMaker()
@@ -87,21 +91,33 @@ bool TextureMaker::MakeTexture(const wxString& imageFilePath, uint32_t flags)
 	if ((flags & Flag::FOR_CUBE_MAP) != 0)
 		textureDoc.AddMember("for_staging", rapidjson::Value().SetBool(true), textureDoc.GetAllocator());
 
+	bool blockCompress = (flags & Flag::BLOCK_COMPRESS) != 0;
+	if (blockCompress && (image.GetWidth() % 4 != 0 || image.GetHeight() % 4 != 0))
+	{
+		IMZADI_LOG_WARNING("Can't block-compress a texture whose dimensions (%d x %d) aren't a multiple of four.  Leaving it uncompressed.", image.GetWidth(), image.GetHeight());
+		blockCompress = false;
+	}
+
 	uint32_t texelSizeBytes = 0;
+	const char* format = nullptr;
+	BlockCompressor::Format blockFormat = BlockCompressor::Format::BC1;
 	if ((flags & (Flag::COLOR | Flag::ALPHA)) == (Flag::COLOR | Flag::ALPHA))
 	{
-		textureDoc.AddMember("format", rapidjson::Value().SetString("RGBA", textureDoc.GetAllocator()), textureDoc.GetAllocator());
+		format = "RGBA";
 		texelSizeBytes = 4;
+		blockFormat = ((flags & Flag::BLOCK_COMPRESS_BC7) != 0) ? BlockCompressor::Format::BC7 : BlockCompressor::Format::BC3;
 	}
 	else if ((flags & Flag::COLOR) == Flag::COLOR)
 	{
-		textureDoc.AddMember("format", rapidjson::Value().SetString("RGB", textureDoc.GetAllocator()), textureDoc.GetAllocator());
+		format = "RGB";
 		texelSizeBytes = 3;
+		blockFormat = BlockCompressor::Format::BC1;
 	}
 	else if ((flags & Flag::ALPHA) == Flag::ALPHA)
 	{
-		textureDoc.AddMember("format", rapidjson::Value().SetString("A", textureDoc.GetAllocator()), textureDoc.GetAllocator());
+		format = "A";
 		texelSizeBytes = 1;
+		blockFormat = BlockCompressor::Format::BC4;
 	}
 	else
 	{
@@ -109,6 +125,15 @@ bool TextureMaker::MakeTexture(const wxString& imageFilePath, uint32_t flags)
 		return false;
 	}
 
+	// The block compressor always takes four bytes per texel, and takes a single channel from alpha.
+	if (blockCompress)
+	{
+		format = BlockCompressor::GetFormatName(blockFormat);
+		texelSizeBytes = 4;
+	}
+
+	textureDoc.AddMember("format", rapidjson::Value().SetString(format, textureDoc.GetAllocator()), textureDoc.GetAllocator());
+
 	if ((flags & Flag::COMPRESS) == Flag::COMPRESS)
 		textureDoc.AddMember("compressed", rapidjson::Value().SetBool(true), textureDoc.GetAllocator());
 
@@ -136,6 +161,8 @@ bool TextureMaker::MakeTexture(const wxString& imageFilePath, uint32_t flags)
 	}
 
 	std::unique_ptr<unsigned char> textureDataBuffer(new unsigned char[textureDataBufferSize]);
+	if (blockCompress)
+		::memset(textureDataBuffer.get(), 0xFF, textureDataBufferSize);
 
 	wxImage originalImage = image;
 
@@ -173,7 +200,7 @@ bool TextureMaker::MakeTexture(const wxString& imageFilePath, uint32_t flags)
 				{
 					const unsigned char* alphaPixel = &image.GetAlpha()[row * width + col];
 
-					if ((flags & Flag::COLOR) != 0)
+					if ((flags & Flag::COLOR) != 0 || blockCompress)
 						texel[3] = *alphaPixel;
 					else
 						texel[0] = *alphaPixel;
@@ -193,6 +220,44 @@ bool TextureMaker::MakeTexture(const wxString& imageFilePath, uint32_t flags)
 		}
 	}
 
+	if (blockCompress)
+	{
+		BlockCompressor blockCompressor;
+		std::vector<unsigned char> blockDataBuffer;
+		blockDataBuffer.reserve(textureDataBufferSize / 4);
+
+		Imzadi::Clock clock;
+		mipTexture = textureDataBuffer.get();
+		width = originalImage.GetWidth();
+		height = originalImage.GetHeight();
+		for (uint32_t i = 0; i < numMips; i++)
+		{
+			blockCompressor.Compress(mipTexture, width, height, blockFormat, blockDataBuffer, Imzadi::Game::Get()->GetJobSystem());
+			mipTexture += width * height * texelSizeBytes;
+			width >>= 1;
+			height >>= 1;
+		}
+
+		double encodeSeconds = clock.GetCurrentTimeSeconds();
+		double numTexels = double(textureDataBufferSize / texelSizeBytes);
+
+		// Measure how much was lost, but just for the top mip, since that's the one we look at most.
+		std::vector<unsigned char> decodedTexelArray;
+		blockCompressor.Decompress(blockDataBuffer.data(), originalImage.GetWidth(), originalImage.GetHeight(), blockFormat, decodedTexelArray);
+		double psnr = BlockCompressor::CalcPSNR(textureDataBuffer.get(), decodedTexelArray.data(), originalImage.GetWidth(), originalImage.GetHeight(), blockFormat);
+
+		IMZADI_LOG_INFO("Block-compressed texture as %s at %.2f Mtexel/s with a PSNR of %.2f dB (%d bytes down to %d.)",
+			format,
+			(encodeSeconds > 0.0) ? numTexels / encodeSeconds / 1e6 : 0.0,
+			psnr,
+			textureDataBufferSize,
+			uint32_t(blockDataBuffer.size()));
+
+		textureDataBufferSize = (uint32_t)blockDataBuffer.size();
+		textureDataBuffer.reset(new unsigned char[textureDataBufferSize]);
+		::memcpy(textureDataBuffer.get(), blockDataBuffer.data(), textureDataBufferSize);
+	}
+
 	if ((flags & Flag::COMPRESS) == 0)
 	{
 		if (!this->DumpTextureData(textureDataFileName.GetFullPath(), textureDataBuffer.get(), textureDataBufferSize))
@@ -200,26 +265,17 @@ bool TextureMaker::MakeTexture(const wxString& imageFilePath, uint32_t flags)
 	}
 	else
 	{
-		COMPRESSOR_HANDLE compressor = NULL;
-		if (!CreateCompressor(COMPRESS_ALGORITHM_XPRESS, NULL, &compressor))
-		{
-			IMZADI_LOG_ERROR("Failed to create compressor.");
-			return false;
-		}
+		Imzadi::LZCodec codec;
+		std::vector<unsigned char> compressedBuffer;
 
-		ULONG_PTR compressedBufferSize = textureDataBufferSize;
-		std::unique_ptr<unsigned char> compressedBuffer(new unsigned char[compressedBufferSize]);
-		
 		// TODO: I'm seeing some compressed textures larger than the original PNG file.  :/
-		if (!Compress(compressor, textureDataBuffer.get(), textureDataBufferSize, compressedBuffer.get(), compressedBufferSize, &compressedBufferSize))
+		if (!codec.Compress(textureDataBuffer.get(), textureDataBufferSize, compressedBuffer, this->compressionLevel, Imzadi::LZCodec::DEFAULT_CHUNK_SIZE, Imzadi::Game::Get()->GetJobSystem()))
 		{
-			IMZADI_LOG_ERROR("Failed to compressed texture buffer.  Error code: %d", GetLastError());
+			IMZADI_LOG_ERROR("Failed to compress texture buffer.");
 			return false;
 		}
 
-		CloseCompressor(compressor);
-
-		if (!this->DumpTextureData(textureDataFileName.GetFullPath(), compressedBuffer.get(), compressedBufferSize))
+		if (!this->DumpTextureData(textureDataFileName.GetFullPath(), compressedBuffer.data(), (uint32_t)compressedBuffer.size()))
 			return false;
 	}
 
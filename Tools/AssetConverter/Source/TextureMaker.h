@@ -20,15 +20,21 @@ public:
 		FLIP_HORIZONTAL	= 0x00000020,
 		ALWAYS_MAKE		= 0x00000040,
 		FOR_CUBE_MAP	= 0x00000080,
-		MIP_MAPS		= 0x00000100
+		MIP_MAPS		= 0x00000100,
+		BLOCK_COMPRESS	= 0x00000200,
+		BLOCK_COMPRESS_BC7	= 0x00000400
 	};
 
 	bool MakeTexture(const wxString& imageFilePath, uint32_t flags);
 	
 	wxString GetTextureFilePath() const { return this->textureFileName.GetFullPath(); }
 
+	void SetCompressionLevel(int compressionLevel) { this->compressionLevel = compressionLevel; }
+	int GetCompressionLevel() const { return this->compressionLevel; }
+
 private:
 	wxFileName textureFileName;
+	int compressionLevel;
 
 	std::unordered_set<std::string> madeTextureSet;
 